@@ -78,6 +78,21 @@ extern "C" {
 
 #endif /* INTEROP_TEST_MODE */
 
+/*!
+  * Number of fragments queued while the decoder processes the previous ones.
+  *
+  * \remark This parameter has an impact on the memory footprint.
+  */
+#define FRAG_DECODER_QUEUE_SIZE                     4
+
+/*!
+  * Row operations (read and XOR, or write, of a fragment) of a decoder
+  * processing slice run by the fragmentation package.
+  *
+  * \remark This parameter bounds the time the package holds the sequencer.
+  */
+#define FRAG_DECODER_SLICE_BUDGET                   16
+
 /* Private macros ------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 /* Global variables ----------------------------------------------------------*/
@@ -113,6 +113,14 @@ typedef struct
      * \param [IN] channelDetected    Channel Activity detected during the CAD
      */
     void ( *CadDone ) ( bool channelActivityDetected );
+
+    /*!
+     * \brief Channel scan done callback prototype.
+     *
+     * \param [IN] index Index of the first free channel of the scan,
+     *                   -1 when all the channels are busy
+     */
+    void ( *ChannelScanDone )( int8_t index );
 }RadioEvents_t;
 
 /*!
@@ -442,6 +450,21 @@ struct Radio_s
      * \return 0 when no parameters error, -1 otherwise
      */
     int32_t (*RadioSetTxGenericConfig)( GenericModems_t modem, TxConfigGeneric_t* config, int8_t power, uint32_t timeout );
+    /*!
+     * \brief Starts a non blocking carrier sense of a list of channels
+     *
+     * \remark The channels are sensed in order until one is free, the RSSI
+     *         is sampled on a timer so the MCU can sleep between samples.
+     *         The result is signaled by the ChannelScanDone event.
+     *
+     * \param [IN] freqs               Channel RF frequencies, must remain valid
+     *                                 until the ChannelScanDone event
+     * \param [IN] nbFreqs             Number of channels
+     * \param [IN] rxBandwidth         Rx bandwidth to be used
+     * \param [IN] rssiThresh          RSSI threshold above which a channel is busy
+     * \param [IN] maxCarrierSenseTime Max time the RSSI is sensed on each channel [ms]
+     */
+    void    ( *StartChannelScan )( const uint32_t *freqs, uint8_t nbFreqs, uint32_t rxBandwidth, int16_t rssiThresh, uint32_t maxCarrierSenseTime );
 };
 
 /*!
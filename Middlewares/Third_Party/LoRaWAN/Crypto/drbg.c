@@ -0,0 +1,176 @@
+/*!
+ * \file      drbg.c
+ *
+ * \brief     AES-CTR deterministic random bit generator
+ */
+#include <stddef.h>
+
+#include "utilities.h"
+#include "lorawan_aes.h"
+#include "drbg.h"
+
+#define DRBG_BLOCK_SIZE                             16
+
+/*!
+ * Generator state
+ */
+static lorawan_aes_context AesContext;
+static uint8_t V[DRBG_BLOCK_SIZE];
+static uint32_t ReseedCounter = 0;
+static bool Instantiated = false;
+
+/*!
+ * Entropy pool, filled by DrbgAddEntropy
+ */
+static uint8_t Pool[DRBG_SEED_SIZE];
+static uint8_t PoolIndex = 0;
+
+/*!
+ * Output block split in 32 bits values by DrbgRandom32
+ */
+static uint8_t Cache[DRBG_BLOCK_SIZE];
+static uint8_t CacheIndex = DRBG_BLOCK_SIZE;
+
+static void IncrementV( void )
+{
+    for( int8_t i = DRBG_BLOCK_SIZE - 1; i >= 0; i-- )
+    {
+        if( ++V[i] != 0 )
+        {
+            break;
+        }
+    }
+}
+
+/*!
+ * \brief CTR_DRBG update function
+ *
+ * \param [IN] providedData Data mixed into the new state, may be NULL
+ */
+static void DrbgUpdate( const uint8_t *providedData )
+{
+    uint8_t temp[DRBG_SEED_SIZE];
+
+    for( uint8_t i = 0; i < DRBG_SEED_SIZE; i += DRBG_BLOCK_SIZE )
+    {
+        IncrementV( );
+        lorawan_aes_encrypt( V, &temp[i], &AesContext );
+    }
+    if( providedData != NULL )
+    {
+        for( uint8_t i = 0; i < DRBG_SEED_SIZE; i++ )
+        {
+            temp[i] ^= providedData[i];
+        }
+    }
+    lorawan_aes_set_key( temp, DRBG_BLOCK_SIZE, &AesContext );
+    memcpy1( V, &temp[DRBG_BLOCK_SIZE], DRBG_BLOCK_SIZE );
+    memset1( temp, 0, sizeof( temp ) );
+}
+
+/*!
+ * \brief CTR_DRBG instantiate function, from an all zero key and counter
+ *
+ * \param [IN] material Seed material, may be NULL
+ */
+static void DrbgInstantiate( const uint8_t *material )
+{
+    memset1( V, 0, sizeof( V ) );
+    lorawan_aes_set_key( V, DRBG_BLOCK_SIZE, &AesContext );
+    DrbgUpdate( material );
+
+    CacheIndex = DRBG_BLOCK_SIZE;
+    ReseedCounter = 0;
+    Instantiated = true;
+}
+
+void DrbgSeed( const uint8_t *seed, uint16_t size )
+{
+    uint8_t material[DRBG_SEED_SIZE] = { 0 };
+
+    // Longer seeds are folded into the seed material
+    for( uint16_t i = 0; ( seed != NULL ) && ( i < size ); i++ )
+    {
+        material[i % DRBG_SEED_SIZE] ^= seed[i];
+    }
+    DrbgInstantiate( material );
+    memset1( material, 0, sizeof( material ) );
+
+    memset1( Pool, 0, sizeof( Pool ) );
+    PoolIndex = 0;
+}
+
+void DrbgAddEntropy( const uint8_t *data, uint16_t size )
+{
+    if( data == NULL )
+    {
+        return;
+    }
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        Pool[PoolIndex] ^= data[i];
+        PoolIndex = ( PoolIndex + 1 ) % DRBG_SEED_SIZE;
+    }
+}
+
+void DrbgReseed( void )
+{
+    if( Instantiated == false )
+    {
+        DrbgInstantiate( Pool );
+    }
+    else
+    {
+        DrbgUpdate( Pool );
+        CacheIndex = DRBG_BLOCK_SIZE;
+        ReseedCounter = 0;
+    }
+    memset1( Pool, 0, sizeof( Pool ) );
+    PoolIndex = 0;
+}
+
+bool DrbgIsReseedRequired( void )
+{
+    return ( ReseedCounter >= DRBG_RESEED_INTERVAL );
+}
+
+void DrbgGenerate( uint8_t *buffer, uint16_t size )
+{
+    uint8_t block[DRBG_BLOCK_SIZE];
+
+    if( Instantiated == false )
+    {
+        DrbgInstantiate( NULL );
+    }
+    while( size > 0 )
+    {
+        uint8_t len = ( size < DRBG_BLOCK_SIZE ) ? size : DRBG_BLOCK_SIZE;
+
+        IncrementV( );
+        lorawan_aes_encrypt( V, block, &AesContext );
+        memcpy1( buffer, block, len );
+        buffer += len;
+        size -= len;
+    }
+    // Backtracking resistance
+    DrbgUpdate( NULL );
+    if( ReseedCounter < DRBG_RESEED_INTERVAL )
+    {
+        ReseedCounter++;
+    }
+}
+
+uint32_t DrbgRandom32( void )
+{
+    uint32_t random;
+
+    if( CacheIndex >= DRBG_BLOCK_SIZE )
+    {
+        DrbgGenerate( Cache, DRBG_BLOCK_SIZE );
+        CacheIndex = 0;
+    }
+    random = ( ( uint32_t )Cache[CacheIndex] ) | ( ( uint32_t )Cache[CacheIndex + 1] << 8 ) |
+             ( ( uint32_t )Cache[CacheIndex + 2] << 16 ) | ( ( uint32_t )Cache[CacheIndex + 3] << 24 );
+    CacheIndex += 4;
+    return random;
+}
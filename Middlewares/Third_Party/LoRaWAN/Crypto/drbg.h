@@ -0,0 +1,93 @@
+/*!
+ * \file      drbg.h
+ *
+ * \brief     AES-CTR deterministic random bit generator
+ *
+ * \details   CTR_DRBG (NIST SP 800-90A, AES-128, no derivation function)
+ *            built on lorawan_aes. The generator is seeded once from the
+ *            radio noise and stretched afterwards, so the random number
+ *            consumers (DevNonce, channel selection, back-off jitter) do
+ *            not reconfigure the radio on every draw.
+ *
+ *            Entropy gathered at idle moments is accumulated in a small
+ *            pool and mixed into the generator state by DrbgReseed.
+ *
+ *            DrbgSeed instantiates the generator from a fixed seed, the
+ *            output sequence is then reproducible, which is what the host
+ *            simulations rely on.
+ */
+#ifndef __DRBG_H__
+#define __DRBG_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * Size of the seed material and of the entropy pool
+ */
+#define DRBG_SEED_SIZE                              32
+
+/*!
+ * Number of generate requests after which DrbgIsReseedRequired reports
+ * that fresh entropy should be mixed in
+ */
+#ifndef DRBG_RESEED_INTERVAL
+#define DRBG_RESEED_INTERVAL                        1024
+#endif
+
+/*!
+ * \brief Instantiates the generator from a seed, discarding the entropy pool
+ *
+ * \remark The same seed always produces the same output sequence
+ *
+ * \param [IN] seed Seed material, may be NULL
+ * \param [IN] size Seed material size
+ */
+void DrbgSeed( const uint8_t *seed, uint16_t size );
+
+/*!
+ * \brief Adds entropy to the pool, it is used by the next DrbgReseed
+ *
+ * \param [IN] data Entropy source output
+ * \param [IN] size Data size
+ */
+void DrbgAddEntropy( const uint8_t *data, uint16_t size );
+
+/*!
+ * \brief Mixes the entropy pool into the generator state and clears the pool
+ */
+void DrbgReseed( void );
+
+/*!
+ * \brief Checks whether the generator produced DRBG_RESEED_INTERVAL outputs
+ *        since it was last seeded
+ *
+ * \retval required Returns true when fresh entropy should be added
+ */
+bool DrbgIsReseedRequired( void );
+
+/*!
+ * \brief Generates random bytes
+ *
+ * \param [OUT] buffer Random bytes
+ * \param [IN]  size   Number of bytes
+ */
+void DrbgGenerate( uint8_t *buffer, uint16_t size );
+
+/*!
+ * \brief Draws a 32 bits random value
+ *
+ * \retval random Random value
+ */
+uint32_t DrbgRandom32( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DRBG_H__
@@ -40,7 +40,7 @@
 #include <stdint.h>
 
 #include "lorawan_conf.h"  /* LORAWAN_KMS */
-#include "radio.h"         /* needed for Random */
+#include "drbg.h"          /* needed for Random */
 #include "utilities.h"
 #include "mw_log_conf.h"   /* needed for MW_LOG */
 #if (!defined (LORAWAN_KMS) || (LORAWAN_KMS == 0))
@@ -1241,7 +1241,7 @@ SecureElementStatus_t SecureElementRandomNumber( uint32_t* randomNum )
     {
         return SECURE_ELEMENT_ERROR_NPE;
     }
-    *randomNum = Radio.Random();
+    *randomNum = DrbgRandom32( );
     return SECURE_ELEMENT_SUCCESS;
 }
 
@@ -46,6 +46,8 @@
 #include "LmHandler.h"
 #include "LmhPackage.h"
 #include "LmhpCompliance.h"
+#include "LoRaMacProfile.h"
+#include "LoRaMacLinkQuality.h"
 #include "secure-element.h"
 #include "mw_log_conf.h"  /* needed for MW_LOG */
 #include "lorawan_version.h"
@@ -203,6 +205,23 @@ static bool IsClassBSwitchPending = false;
 
 static bool CtxRestoreDone = false;
 
+#if ( LORAMAC_LINK_QUALITY_ENABLED == 1 )
+/*!
+ * Link quality tracker driving the unconfirmed uplinks while ADR is off
+ */
+static LoRaMacLinkQuality_t LinkQuality;
+
+/*!
+ * TX power set by the application
+ */
+static int8_t LinkQualityAppTxPower = TX_POWER_0;
+
+/*!
+ * TX power last set by the link quality policy, -1 when none
+ */
+static int8_t LinkQualityTxPower = -1;
+#endif /* LORAMAC_LINK_QUALITY_ENABLED == 1 */
+
 /* Private function prototypes -----------------------------------------------*/
 /*!
  * \brief   MCPS-Confirm event function
@@ -298,6 +317,19 @@ static void DisplayBeaconUpdate(LmHandlerBeaconParams_t *params);
 
 static LmHandlerErrorStatus_t LmHandlerSetSystemMaxRxError( uint32_t maxErrorInMs );
 
+#if ( LORAMAC_LINK_QUALITY_ENABLED == 1 )
+/*!
+ * \brief   Applies the link quality policy to an uplink request
+ *
+ * \param   [IN] mcpsReq Uplink request of the type to send, its datarate is
+ *                  updated and set in the MAC
+ *
+ * \retval  linkCheck Returns true if a LinkCheckReq has been added to the
+ *                    uplink
+ */
+static bool LmHandlerLinkQualityApply( McpsReq_t *mcpsReq );
+#endif /* LORAMAC_LINK_QUALITY_ENABLED == 1 */
+
 /* Exported functions ---------------------------------------------------------*/
 LmHandlerErrorStatus_t LmHandlerInit( LmHandlerCallbacks_t *handlerCallbacks )
 {
@@ -415,6 +447,11 @@ LmHandlerErrorStatus_t LmHandlerConfigure( LmHandlerParams_t *handlerParams )
     mibReq.Param.AdrEnable = LmHandlerParams.AdrEnable;
     LoRaMacMibSetRequestConfirm( &mibReq );
 
+#if ( LORAMAC_LINK_QUALITY_ENABLED == 1 )
+    LoRaMacLinkQualityInit( &LinkQuality );
+    LinkQualityTxPower = -1;
+#endif /* LORAMAC_LINK_QUALITY_ENABLED == 1 */
+
     GetPhyParams_t getPhy;
     PhyParam_t phyParam;
     getPhy.Attribute = PHY_DUTY_CYCLE;
@@ -489,6 +526,22 @@ void LmHandlerJoin( ActivationType_t mode )
         MlmeReq_t mlmeReq;
         JoinParams.Mode = ACTIVATION_TYPE_OTAA;
 
+        if( ( CtxRestoreDone == true ) && ( LmHandlerJoinStatus( ) == LORAMAC_HANDLER_SET ) )
+        {
+            // The session restored from NVM is still valid, resume it instead
+            // of joining again (saves the DevNonce and the join air time)
+            CtxRestoreDone = false;
+            JoinParams.Datarate = LmHandlerParams.TxDatarate;
+            JoinParams.Status = LORAMAC_HANDLER_SUCCESS;
+
+            LoRaMacStart();
+
+            // Notify upper layer
+            LmHandlerCallbacks->OnJoinRequest( &JoinParams );
+            LmHandlerRequestClass(LmHandlerParams.DefaultClass);
+            return;
+        }
+
         LoRaMacStart();
 
         mlmeReq.Type = MLME_JOIN;
@@ -577,6 +630,9 @@ LmHandlerErrorStatus_t LmHandlerSend( LmHandlerAppData_t *appData, LmHandlerMsgT
     LmHandlerErrorStatus_t lmhStatus = LORAMAC_HANDLER_ERROR;
     McpsReq_t mcpsReq;
     LoRaMacTxInfo_t txInfo;
+#if ( LORAMAC_LINK_QUALITY_ENABLED == 1 )
+    bool linkCheck;
+#endif /* LORAMAC_LINK_QUALITY_ENABLED == 1 */
 
     if (LoRaMacIsBusy() == true)
     {
@@ -596,6 +652,12 @@ LmHandlerErrorStatus_t LmHandlerSend( LmHandlerAppData_t *appData, LmHandlerMsgT
     }
 
     mcpsReq.Req.Unconfirmed.Datarate = LmHandlerParams.TxDatarate;
+#if ( LORAMAC_LINK_QUALITY_ENABLED == 1 )
+    // The policy sets the datarate and may queue a LinkCheckReq, the size
+    // query below must see both
+    mcpsReq.Type = ( isTxConfirmed == LORAMAC_HANDLER_UNCONFIRMED_MSG ) ? MCPS_UNCONFIRMED : MCPS_CONFIRMED;
+    linkCheck = LmHandlerLinkQualityApply( &mcpsReq );
+#endif /* LORAMAC_LINK_QUALITY_ENABLED == 1 */
     if( LoRaMacQueryTxPossible( appData->BufferSize, &txInfo ) != LORAMAC_STATUS_OK )
     {
         // Send empty frame in order to flush MAC commands
@@ -622,9 +684,15 @@ LmHandlerErrorStatus_t LmHandlerSend( LmHandlerAppData_t *appData, LmHandlerMsgT
     }
 
     TxParams.AppData = *appData;
-    TxParams.Datarate = LmHandlerParams.TxDatarate;
+    TxParams.Datarate = mcpsReq.Req.Unconfirmed.Datarate;
 
     status = LoRaMacMcpsRequest(&mcpsReq, allowDelayedTx);
+#if ( LORAMAC_LINK_QUALITY_ENABLED == 1 )
+    if( status == LORAMAC_STATUS_OK )
+    {
+        LoRaMacLinkQualityOnUplink( &LinkQuality, linkCheck );
+    }
+#endif /* LORAMAC_LINK_QUALITY_ENABLED == 1 */
     if (nextTxIn != NULL)
     {
         *nextTxIn = mcpsReq.ReqReturn.DutyCycleWaitTime;
@@ -901,6 +969,68 @@ LmHandlerErrorStatus_t LmHandlerGetActiveRegion( LoRaMacRegion_t *region )
     return LORAMAC_HANDLER_SUCCESS;
 }
 
+#if ( LORAMAC_LINK_QUALITY_ENABLED == 1 )
+static bool LmHandlerLinkQualityApply( McpsReq_t *mcpsReq )
+{
+    LoRaMacLinkQualityParams_t params;
+    MibRequestConfirm_t mibReq;
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+    int8_t datarate;
+    int8_t txPower;
+    bool linkCheckReq;
+
+    mibReq.Type = MIB_CHANNELS_TX_POWER;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    if( mibReq.Param.ChannelsTxPower != LinkQualityTxPower )
+    {
+        // Set by the application, or by a LinkADRReq while ADR was on
+        LinkQualityAppTxPower = mibReq.Param.ChannelsTxPower;
+    }
+
+    getPhy.Attribute = PHY_DEF_UPLINK_DWELL_TIME;
+    phyParam = RegionGetPhyParam( LmHandlerParams.ActiveRegion, &getPhy );
+
+    params.Region = LmHandlerParams.ActiveRegion;
+    params.UplinkDwellTime = ( uint8_t )phyParam.Value;
+    params.AdrEnabled = LmHandlerParams.AdrEnable;
+    params.Datarate = mcpsReq->Req.Unconfirmed.Datarate;
+    params.TxPower = LinkQualityAppTxPower;
+    linkCheckReq = LoRaMacLinkQualityCalcNext( &LinkQuality, &params, &datarate, &txPower );
+
+    if( LmHandlerParams.AdrEnable == true )
+    {
+        // The network server owns the datarate and the TX power
+        return false;
+    }
+    if( mcpsReq->Type != MCPS_UNCONFIRMED )
+    {
+        // Confirmed uplinks keep the application settings
+        datarate = params.Datarate;
+        txPower = params.TxPower;
+    }
+    mcpsReq->Req.Unconfirmed.Datarate = datarate;
+
+    // LoRaMacQueryTxPossible sizes the payload at the datarate of the MAC
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    mibReq.Param.ChannelsDatarate = datarate;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_CHANNELS_TX_POWER;
+    mibReq.Param.ChannelsTxPower = txPower;
+    if( LoRaMacMibSetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK )
+    {
+        LinkQualityTxPower = txPower;
+    }
+
+    if( linkCheckReq == true )
+    {
+        return ( LmHandlerLinkCheckReq( ) == LORAMAC_HANDLER_SUCCESS );
+    }
+    return false;
+}
+#endif /* LORAMAC_LINK_QUALITY_ENABLED == 1 */
+
 static LmHandlerErrorStatus_t LmHandlerSetSystemMaxRxError( uint32_t maxErrorInMs )
 {
     MibRequestConfirm_t mibReq;
@@ -953,10 +1083,19 @@ static void McpsIndication( McpsIndication_t *mcpsIndication, LoRaMacRxStatus_t
     RxParams.RxSlot = RxStatus->RxSlot;
     RxParams.DownlinkCounter = mcpsIndication->DownLinkCounter;
 
+#if ( LORAMAC_LINK_QUALITY_ENABLED == 1 )
+    if( ( RxStatus->RxSlot == RX_SLOT_WIN_1 ) || ( RxStatus->RxSlot == RX_SLOT_WIN_2 ) )
+    {
+        LoRaMacLinkQualityAddDownlink( &LinkQuality, LmHandlerParams.ActiveRegion, RxParams.Datarate, RxParams.Rssi,
+                                       RxParams.Snr, ( RxStatus->RxSlot == RX_SLOT_WIN_2 ) );
+    }
+#endif /* LORAMAC_LINK_QUALITY_ENABLED == 1 */
+
     appData.Port = mcpsIndication->Port;
     appData.BufferSize = mcpsIndication->BufferSize;
     appData.Buffer = mcpsIndication->Buffer;
 
+    LORAMAC_PROFILE_END( LORAMAC_PROFILE_INDICATION );
     LmHandlerCallbacks->OnRxData(&appData, &RxParams);
 
     if ((LmHandlerCallbacks->OnSysTimeUpdate != NULL) && (mcpsIndication->DeviceTimeAnsReceived == true))
@@ -1022,6 +1161,14 @@ static void MlmeConfirm( MlmeConfirm_t *mlmeConfirm )
             RxParams.LinkCheck = true;
             RxParams.DemodMargin = mlmeConfirm->DemodMargin;
             RxParams.NbGateways = mlmeConfirm->NbGateways;
+#if ( LORAMAC_LINK_QUALITY_ENABLED == 1 )
+            if( mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK )
+            {
+                // McpsConfirm of the uplink carrying the request comes first
+                LoRaMacLinkQualityAddLinkCheck( &LinkQuality, LmHandlerParams.ActiveRegion, TxParams.Datarate,
+                                                TxParams.TxPower, mlmeConfirm->DemodMargin );
+            }
+#endif /* LORAMAC_LINK_QUALITY_ENABLED == 1 */
         }
         break;
     case MLME_DEVICE_TIME:
@@ -1635,6 +1782,10 @@ LmHandlerErrorStatus_t LmHandlerSetTxPower(int8_t txPower)
     {
         return LORAMAC_HANDLER_ERROR;
     }
+#if ( LORAMAC_LINK_QUALITY_ENABLED == 1 )
+    LinkQualityAppTxPower = txPower;
+    LinkQualityTxPower = -1;
+#endif /* LORAMAC_LINK_QUALITY_ENABLED == 1 */
 
     return LORAMAC_HANDLER_SUCCESS;
 }
@@ -1762,6 +1913,33 @@ LmHandlerErrorStatus_t LmHandlerGetBeaconState(BeaconState_t *beaconState)
 #endif /* LORAMAC_CLASSB_ENABLED */
 }
 
+bool LmHandlerIsBeaconAcquisitionPending(void)
+{
+#if ( LORAMAC_CLASSB_ENABLED == 1 )
+    MibRequestConfirm_t mibReq;
+
+    if (IsClassBSwitchPending == true)
+    {
+        // The acquisition follows the DeviceTimeAns
+        return true;
+    }
+
+    mibReq.Type = MIB_DEVICE_CLASS;
+    if ((LoRaMacMibGetRequestConfirm(&mibReq) != LORAMAC_STATUS_OK) || (mibReq.Param.Class != CLASS_B))
+    {
+        return false;
+    }
+    mibReq.Type = MIB_BEACON_STATE;
+    if (LoRaMacMibGetRequestConfirm(&mibReq) != LORAMAC_STATUS_OK)
+    {
+        return false;
+    }
+    return (mibReq.Param.BeaconState == BEACON_STATE_REACQUISITION);
+#else /* LORAMAC_CLASSB_ENABLED == 0 */
+    return false;
+#endif /* LORAMAC_CLASSB_ENABLED */
+}
+
 LmHandlerErrorStatus_t LmHandlerGetNwkKey( uint8_t *nwkKey )
 {
     Key_t *keyItem;
@@ -652,6 +652,14 @@ LmHandlerErrorStatus_t LmHandlerSetPingPeriodicity(uint8_t pingPeriodicity);
  */
 LmHandlerErrorStatus_t LmHandlerGetBeaconState(BeaconState_t *beaconState);
 
+/*!
+ * \brief Checks if the ClassB beacon is about to be acquired from the system
+ *        time: a ClassB switch is pending or the beacon is being reacquired
+ *
+ * \retval pending Returns true while the system time has to be exact
+ */
+bool LmHandlerIsBeaconAcquisitionPending(void);
+
 /*!
  * \brief Gets the LoRaWAN NwkKey (from the se-identity)
  *
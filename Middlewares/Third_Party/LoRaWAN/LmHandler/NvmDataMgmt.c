@@ -32,6 +32,7 @@
  */
 
 #include <stdio.h>
+#include <stddef.h>
 #include "utilities.h"
 #include "LoRaMac.h"
 #include "NvmDataMgmt.h"
@@ -46,7 +47,222 @@
 #if( CONTEXT_MANAGEMENT_ENABLED == 1 )
 #include "nvmm.h"
 
+/*!
+ * NVM group descriptor
+ */
+typedef struct sNvmGroup
+{
+    /*!
+     * Notification flag of the group
+     */
+    uint16_t NotifyFlag;
+    /*!
+     * Offset of the group in LoRaMacNvmData_t, used as record identifier
+     */
+    uint16_t Offset;
+    /*!
+     * Size of the group, CRC32 included
+     */
+    uint16_t Size;
+}NvmGroup_t;
+
+/*!
+ * Frame counters of the crypto group, from FCntList to LastDownFCnt
+ *
+ * \remark Only the frame counters change on every uplink/downlink. Each 32 bit
+ *         word of them which changed is appended to the crypto record journal
+ *         as an entry instead of rewriting the whole group: the offset of the
+ *         word in the group on 2 bytes, then its value on 4 bytes. The other
+ *         fields are taken from the record and the CRC32 is computed again.
+ *         The words of one store are applied together: all entries but the
+ *         last one have NVM_CRYPTO_JOURNAL_MORE set in their offset.
+ */
+#define NVM_CRYPTO_FCNT_START              offsetof( LoRaMacCryptoNvmData_t, FCntList )
+#define NVM_CRYPTO_FCNT_WORDS              ( ( offsetof( LoRaMacCryptoNvmData_t, Crc32 ) - NVM_CRYPTO_FCNT_START ) / sizeof( uint32_t ) )
+#define NVM_CRYPTO_JOURNAL_MORE            0x8000
+
+/*!
+ * NVM groups, in LoRaMacNvmData_t order
+ */
+static const NvmGroup_t NvmGroups[] =
+{
+    { LORAMAC_NVM_NOTIFY_FLAG_CRYPTO,         offsetof( LoRaMacNvmData_t, Crypto ),        sizeof( LoRaMacCryptoNvmData_t ) },
+    { LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1,     offsetof( LoRaMacNvmData_t, MacGroup1 ),     sizeof( LoRaMacNvmDataGroup1_t ) },
+    { LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2,     offsetof( LoRaMacNvmData_t, MacGroup2 ),     sizeof( LoRaMacNvmDataGroup2_t ) },
+    { LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT, offsetof( LoRaMacNvmData_t, SecureElement ), sizeof( SecureElementNvmData_t ) },
+    { LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1,  offsetof( LoRaMacNvmData_t, RegionGroup1 ),  sizeof( RegionNvmDataGroup1_t ) },
+    { LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2,  offsetof( LoRaMacNvmData_t, RegionGroup2 ),  sizeof( RegionNvmDataGroup2_t ) },
+    { LORAMAC_NVM_NOTIFY_FLAG_CLASS_B,        offsetof( LoRaMacNvmData_t, ClassB ),        sizeof( LoRaMacClassBNvmData_t ) },
+};
+
+#define NVM_GROUPS_NB                      ( sizeof( NvmGroups ) / sizeof( NvmGroups[0] ) )
+
 static uint16_t NvmNotifyFlags = 0;
+
+/*!
+ * Crypto fields held by the current crypto record, a journal entry is only
+ * possible while they do not change
+ */
+static struct
+{
+    bool Valid;
+    Version_t LrWanVersion;
+    uint16_t DevNonce;
+    uint32_t JoinNonce;
+    uint32_t FCnt[NVM_CRYPTO_FCNT_WORDS];
+}CryptoRecord;
+
+/*!
+ * \brief Keeps the crypto fields of the stored crypto group
+ *
+ * \param [IN] crypto           Crypto group, record and journal applied
+ */
+static void SetCryptoRecord( LoRaMacCryptoNvmData_t* crypto )
+{
+    CryptoRecord.Valid = true;
+    CryptoRecord.LrWanVersion = crypto->LrWanVersion;
+    CryptoRecord.DevNonce = crypto->DevNonce;
+    CryptoRecord.JoinNonce = crypto->JoinNonce;
+    memcpy1( ( uint8_t* )CryptoRecord.FCnt, ( uint8_t* )crypto + NVM_CRYPTO_FCNT_START, sizeof( CryptoRecord.FCnt ) );
+}
+
+/*!
+ * \brief Stores the crypto group, as journal entries when only the frame
+ *        counters changed since the last record
+ *
+ * \param [IN] crypto           Crypto group
+ *
+ * \retval                      Number of bytes stored
+ */
+static uint16_t StoreCrypto( LoRaMacCryptoNvmData_t* crypto )
+{
+    uint16_t offset = offsetof( LoRaMacNvmData_t, Crypto );
+
+    if( ( CryptoRecord.Valid == true ) &&
+        ( CryptoRecord.LrWanVersion.Value == crypto->LrWanVersion.Value ) &&
+        ( CryptoRecord.DevNonce == crypto->DevNonce ) &&
+        ( CryptoRecord.JoinNonce == crypto->JoinNonce ) )
+    {
+        uint32_t fCnt[NVM_CRYPTO_FCNT_WORDS];
+        uint8_t entry[NVMM_JOURNAL_ENTRY_SIZE];
+        uint16_t nbChanged = 0;
+        uint16_t dataSize = 0;
+        bool journaled = true;
+
+        memcpy1( ( uint8_t* )fCnt, ( uint8_t* )crypto + NVM_CRYPTO_FCNT_START, sizeof( fCnt ) );
+        for( uint16_t i = 0; i < NVM_CRYPTO_FCNT_WORDS; i++ )
+        {
+            nbChanged += ( fCnt[i] != CryptoRecord.FCnt[i] ) ? 1 : 0;
+        }
+
+        for( uint16_t i = 0; ( i < NVM_CRYPTO_FCNT_WORDS ) && ( journaled == true ); i++ )
+        {
+            if( fCnt[i] != CryptoRecord.FCnt[i] )
+            {
+                uint16_t wordOffset = NVM_CRYPTO_FCNT_START + ( i * sizeof( uint32_t ) );
+
+                nbChanged--;
+                if( nbChanged > 0 )
+                {
+                    wordOffset |= NVM_CRYPTO_JOURNAL_MORE;
+                }
+                memcpy1( entry, ( uint8_t* )&wordOffset, sizeof( wordOffset ) );
+                memcpy1( entry + sizeof( wordOffset ), ( uint8_t* )&fCnt[i], sizeof( uint32_t ) );
+                journaled = ( NvmmAppend( entry, sizeof( entry ), offset ) == sizeof( entry ) );
+                dataSize += sizeof( entry );
+            }
+        }
+        if( journaled == true )
+        {
+            memcpy1( ( uint8_t* )CryptoRecord.FCnt, ( uint8_t* )fCnt, sizeof( fCnt ) );
+            return dataSize;
+        }
+        // Journal full or failed, fold it into a new record
+    }
+
+    CryptoRecord.Valid = false;
+    if( NvmmWrite( ( uint8_t* ) crypto, sizeof( LoRaMacCryptoNvmData_t ), offset ) !=
+        sizeof( LoRaMacCryptoNvmData_t ) )
+    {
+        return 0;
+    }
+    SetCryptoRecord( crypto );
+
+    return sizeof( LoRaMacCryptoNvmData_t );
+}
+
+/*!
+ * Frame counter journal replay
+ */
+typedef struct sNvmCryptoJournalReplay
+{
+    /*!
+     * Frame counters of the last complete store
+     */
+    uint32_t FCnt[NVM_CRYPTO_FCNT_WORDS];
+    /*!
+     * Frame counters of the store being read
+     */
+    uint32_t Pending[NVM_CRYPTO_FCNT_WORDS];
+    /*!
+     * The store being read is not complete
+     */
+    bool Incomplete;
+}NvmCryptoJournalReplay_t;
+
+/*!
+ * \brief Applies a frame counter journal entry to the replay
+ *
+ * \param [IN] entry            Journal entry
+ * \param [IN/OUT] context      Journal replay
+ */
+static void ApplyCryptoJournalEntry( uint8_t* entry, void* context )
+{
+    NvmCryptoJournalReplay_t* replay = ( NvmCryptoJournalReplay_t* )context;
+    uint16_t wordOffset;
+    uint16_t index;
+
+    memcpy1( ( uint8_t* )&wordOffset, entry, sizeof( wordOffset ) );
+    index = ( ( wordOffset & ~NVM_CRYPTO_JOURNAL_MORE ) - NVM_CRYPTO_FCNT_START ) / sizeof( uint32_t );
+    if( ( ( wordOffset & ~NVM_CRYPTO_JOURNAL_MORE ) < NVM_CRYPTO_FCNT_START ) || ( index >= NVM_CRYPTO_FCNT_WORDS ) )
+    {
+        return;
+    }
+
+    memcpy1( ( uint8_t* )&replay->Pending[index], entry + sizeof( wordOffset ), sizeof( uint32_t ) );
+    replay->Incomplete = ( ( wordOffset & NVM_CRYPTO_JOURNAL_MORE ) != 0 );
+    if( replay->Incomplete == false )
+    {
+        memcpy1( ( uint8_t* )replay->FCnt, ( uint8_t* )replay->Pending, sizeof( replay->FCnt ) );
+    }
+}
+
+/*!
+ * \brief Applies the frame counter journal entries to the crypto group
+ *
+ * \param [IN/OUT] crypto       Crypto group read from its record
+ *
+ * \retval                      false when the last store was interrupted
+ */
+static bool RestoreCryptoJournal( LoRaMacCryptoNvmData_t* crypto )
+{
+    NvmCryptoJournalReplay_t replay;
+
+    memcpy1( ( uint8_t* )replay.FCnt, ( uint8_t* )crypto + NVM_CRYPTO_FCNT_START, sizeof( replay.FCnt ) );
+    memcpy1( ( uint8_t* )replay.Pending, ( uint8_t* )replay.FCnt, sizeof( replay.Pending ) );
+    replay.Incomplete = false;
+    if( NvmmReadJournal( NVMM_JOURNAL_ENTRY_SIZE, offsetof( LoRaMacNvmData_t, Crypto ),
+                         ApplyCryptoJournalEntry, &replay ) == 0 )
+    {
+        // No entry since the last record
+        return true;
+    }
+
+    // The entries of an interrupted store are dropped
+    memcpy1( ( uint8_t* )crypto + NVM_CRYPTO_FCNT_START, ( uint8_t* )replay.FCnt, sizeof( replay.FCnt ) );
+    crypto->Crc32 = Crc32( ( uint8_t* )crypto, sizeof( LoRaMacCryptoNvmData_t ) - sizeof( crypto->Crc32 ) );
+    return replay.Incomplete == false;
+}
 #endif /* CONTEXT_MANAGEMENT_ENABLED == 1 */
 
 void NvmDataMgmtEvent( uint16_t notifyFlags )
@@ -59,7 +275,6 @@ void NvmDataMgmtEvent( uint16_t notifyFlags )
 uint16_t NvmDataMgmtStore( void )
 {
 #if( CONTEXT_MANAGEMENT_ENABLED == 1 )
-    uint16_t offset = 0;
     uint16_t dataSize = 0;
     MibRequestConfirm_t mibReq;
     mibReq.Type = MIB_NVM_CTXS;
@@ -81,64 +296,18 @@ uint16_t NvmDataMgmtStore( void )
     if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_CRYPTO ) ==
         LORAMAC_NVM_NOTIFY_FLAG_CRYPTO )
     {
-        dataSize += NvmmWrite( ( uint8_t* ) &nvm->Crypto, sizeof( nvm->Crypto ),
-                               offset );
-    }
-    offset += sizeof( nvm->Crypto );
-
-    // MacGroup1
-    if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 ) ==
-        LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 )
-    {
-        dataSize += NvmmWrite( ( uint8_t* ) &nvm->MacGroup1,
-                               sizeof( nvm->MacGroup1 ), offset );
-    }
-    offset += sizeof( nvm->MacGroup1 );
-
-    // MacGroup2
-    if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 ) ==
-        LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 )
-    {
-        dataSize += NvmmWrite( ( uint8_t* ) &nvm->MacGroup2,
-                               sizeof( nvm->MacGroup2 ), offset );
-    }
-    offset += sizeof( nvm->MacGroup2 );
-
-    // Secure element
-    if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT ) ==
-        LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT )
-    {
-        dataSize += NvmmWrite( ( uint8_t* ) &nvm->SecureElement, sizeof( nvm->SecureElement ),
-                               offset );
-    }
-    offset += sizeof( nvm->SecureElement );
-
-    // Region group 1
-    if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1 ) ==
-        LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1 )
-    {
-        dataSize += NvmmWrite( ( uint8_t* ) &nvm->RegionGroup1,
-                               sizeof( nvm->RegionGroup1 ), offset );
-    }
-    offset += sizeof( nvm->RegionGroup1 );
-
-    // Region group 2
-    if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2 ) ==
-        LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2 )
-    {
-        dataSize += NvmmWrite( ( uint8_t* ) &nvm->RegionGroup2,
-                               sizeof( nvm->RegionGroup2 ), offset );
+        dataSize += StoreCrypto( &nvm->Crypto );
     }
-    offset += sizeof( nvm->RegionGroup2 );
 
-    // Class b
-    if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_CLASS_B ) ==
-        LORAMAC_NVM_NOTIFY_FLAG_CLASS_B )
+    // Other groups, one record each
+    for( uint8_t i = 1; i < NVM_GROUPS_NB; i++ )
     {
-        dataSize += NvmmWrite( ( uint8_t* ) &nvm->ClassB, sizeof( nvm->ClassB ),
-                               offset );
+        if( ( NvmNotifyFlags & NvmGroups[i].NotifyFlag ) == NvmGroups[i].NotifyFlag )
+        {
+            dataSize += NvmmWrite( ( uint8_t* ) nvm + NvmGroups[i].Offset,
+                                   NvmGroups[i].Size, NvmGroups[i].Offset );
+        }
     }
-    offset += sizeof( nvm->ClassB );
 
     // Reset notification flags
     NvmNotifyFlags = LORAMAC_NVM_NOTIFY_FLAG_NONE;
@@ -158,118 +327,53 @@ uint16_t NvmDataMgmtRestore( void )
     mibReq.Type = MIB_NVM_CTXS;
     LoRaMacMibGetRequestConfirm( &mibReq );
     LoRaMacNvmData_t* nvm = mibReq.Param.Contexts;
-    uint16_t offset = 0;
-
-    // Crypto
-    if( NvmmCrc32Check( sizeof( LoRaMacCryptoNvmData_t ), offset ) == false )
-    {
-        return 0;
-    }
-    offset += sizeof( LoRaMacCryptoNvmData_t );
 
-    // Mac Group 1
-    if( NvmmCrc32Check( sizeof( LoRaMacNvmDataGroup1_t ), offset ) == false )
-    {
-        return 0;
-    }
-    offset += sizeof( LoRaMacNvmDataGroup1_t );
+    // Until the crypto record is read, the frame counters are not known
+    // to be stored
+    CryptoRecord.Valid = false;
 
-    // Mac Group 2
-    if( NvmmCrc32Check( sizeof( LoRaMacNvmDataGroup2_t ), offset ) == false )
+    // All records shall be valid before the context is modified
+    for( uint8_t i = 0; i < NVM_GROUPS_NB; i++ )
     {
-        return 0;
+        if( NvmmCrc32Check( NvmGroups[i].Size, NvmGroups[i].Offset ) == false )
+        {
+            return 0;
+        }
     }
-    offset += sizeof( LoRaMacNvmDataGroup2_t );
 
-    // Secure element
-    if( NvmmCrc32Check( sizeof( SecureElementNvmData_t ), offset ) == false )
+    for( uint8_t i = 0; i < NVM_GROUPS_NB; i++ )
     {
-        return 0;
+        if( NvmmRead( ( uint8_t* ) nvm + NvmGroups[i].Offset, NvmGroups[i].Size,
+                      NvmGroups[i].Offset ) != NvmGroups[i].Size )
+        {
+            return 0;
+        }
     }
-    offset += sizeof( SecureElementNvmData_t );
 
-    // Region group 1
-    if( NvmmCrc32Check( sizeof( RegionNvmDataGroup1_t ), offset ) == false )
+    if( RestoreCryptoJournal( &nvm->Crypto ) == true )
     {
-        return 0;
+        SetCryptoRecord( &nvm->Crypto );
     }
-    offset += sizeof( RegionNvmDataGroup1_t );
+    // else the next store writes the crypto record, which erases the
+    // journal and its dropped entries
 
-    // Region group 2
-    if( NvmmCrc32Check( sizeof( RegionNvmDataGroup2_t ), offset ) == false )
-    {
-        return 0;
-    }
-    offset += sizeof( RegionNvmDataGroup2_t );
-
-    // Class b
-    if( NvmmCrc32Check( sizeof( LoRaMacClassBNvmData_t ), offset ) == false )
-    {
-        return 0;
-    }
-    offset += sizeof( LoRaMacClassBNvmData_t );
-
-    if( NvmmRead( ( uint8_t* ) nvm, sizeof( LoRaMacNvmData_t ), 0 ) ==
-                  sizeof( LoRaMacNvmData_t ) )
-    {
-        return sizeof( LoRaMacNvmData_t );
-    }
-#endif
+    return sizeof( LoRaMacNvmData_t );
+#else
     return 0;
+#endif
 }
 
 bool NvmDataMgmtFactoryReset( void )
 {
 #if( CONTEXT_MANAGEMENT_ENABLED == 1 )
-    uint16_t offset = 0;
-    // Crypto
-    if( NvmmReset( sizeof( LoRaMacCryptoNvmData_t ), offset ) == false )
-    {
-        return false;
-    }
-    offset += sizeof( LoRaMacCryptoNvmData_t );
-
-    // Mac Group 1
-    if( NvmmReset( sizeof( LoRaMacNvmDataGroup1_t ), offset ) == false )
-    {
-        return false;
-    }
-    offset += sizeof( LoRaMacNvmDataGroup1_t );
-
-    // Mac Group 2
-    if( NvmmReset( sizeof( LoRaMacNvmDataGroup2_t ), offset ) == false )
-    {
-        return false;
-    }
-    offset += sizeof( LoRaMacNvmDataGroup2_t );
-
-    // Secure element
-    if( NvmmReset( sizeof( SecureElementNvmData_t ), offset ) == false )
-    {
-        return false;
-    }
-    offset += sizeof( SecureElementNvmData_t );
-
-    // Region group 1
-    if( NvmmReset( sizeof( RegionNvmDataGroup1_t ), offset ) == false )
-    {
-        return false;
-    }
-    offset += sizeof( RegionNvmDataGroup1_t );
-
-    // Region group 2
-    if( NvmmReset( sizeof( RegionNvmDataGroup2_t ), offset ) == false )
-    {
-        return false;
-    }
-    offset += sizeof( RegionNvmDataGroup2_t );
-
-    // Class b
-    if( NvmmReset( sizeof( LoRaMacClassBNvmData_t ), offset ) == false )
+    CryptoRecord.Valid = false;
+    for( uint8_t i = 0; i < NVM_GROUPS_NB; i++ )
     {
-        return false;
+        if( NvmmReset( NvmGroups[i].Size, NvmGroups[i].Offset ) == false )
+        {
+            return false;
+        }
     }
-    offset += sizeof( LoRaMacClassBNvmData_t );
 #endif
     return true;
 }
@@ -0,0 +1,359 @@
+/*!
+ * \file      ClockDiscipline.c
+ *
+ * \brief     Local clock discipline driven by the clock synchronization
+ *            corrections
+ */
+#include <stddef.h>
+
+#include "timer.h"
+#include "ClockDiscipline.h"
+
+#define PPB                                         1000000000LL
+
+/*!
+ * Longest AppTimePeriodicityReq period, 128 << 15 s. The stretched period
+ * does not go beyond so that it fits the timer server in ms.
+ */
+#define CLOCK_DISCIPLINE_MAX_PERIOD                 4194304
+
+/*!
+ * Clock discipline context
+ */
+typedef struct ClockDisciplineState_s
+{
+    /*!
+     * RTC frequency compensation, NULL when not supported
+     */
+    ClockDisciplineSetDrift_t SetDriftCompensation;
+    /*!
+     * Checks if the corrections have to be stepped, NULL when never
+     */
+    ClockDisciplineIsStepRequired_t IsStepRequired;
+    /*!
+     * A first correction has been processed
+     */
+    bool Synchronized;
+    /*!
+     * Drift has been measured at least once
+     */
+    bool DriftValid;
+    /*!
+     * RTC drift estimate in ppb
+     */
+    int32_t Drift;
+    /*!
+     * Frequency offset used to slew the last correction in ppb
+     */
+    int32_t Slew;
+    /*!
+     * Compensation currently applied by the RTC in ppb
+     */
+    int32_t Compensation;
+    /*!
+     * Part of the last correction left to the slew in ms
+     */
+    int32_t Phase;
+    /*!
+     * Offset between the system time and the RTC time after the last
+     * correction
+     */
+    SysTime_t Offset;
+    /*!
+     * RTC time of the last compensation change
+     */
+    SysTime_t CompensationTime;
+    /*!
+     * RTC time the drift measurement baseline starts at
+     */
+    SysTime_t BaselineTime;
+    /*!
+     * Phase error accumulated over the baseline without compensation in
+     * ppb x ms
+     */
+    int64_t BaselineError;
+    /*!
+     * Synchronization period stretch, as a power of two
+     */
+    uint8_t Stretch;
+    /*!
+     * Number of successive corrections in a fraction of the bound
+     */
+    uint8_t Good;
+}ClockDisciplineState_t;
+
+static ClockDisciplineState_t ClockDisciplineState;
+
+/*!
+ * Ends the slew of the last correction
+ */
+static TimerEvent_t SlewTimer;
+
+/*!
+ * \brief Converts a time difference to ms
+ */
+static int64_t ToMs( SysTime_t time )
+{
+    return ( int64_t )( int32_t )time.Seconds * 1000 + time.SubSeconds;
+}
+
+/*!
+ * \brief Converts a signed ms value to a system time difference
+ */
+static SysTime_t FromMs( int32_t ms )
+{
+    SysTime_t time = { .Seconds = ( uint32_t )( ms / 1000 ), .SubSeconds = ( int16_t )( ms % 1000 ) };
+
+    if( time.SubSeconds < 0 )
+    {
+        time.Seconds--;
+        time.SubSeconds += 1000;
+    }
+    return time;
+}
+
+static int32_t Abs( int32_t value )
+{
+    return ( value < 0 ) ? -value : value;
+}
+
+static SysTime_t GetOffset( void )
+{
+    return SysTimeSub( SysTimeGet( ), SysTimeGetMcuTime( ) );
+}
+
+/*!
+ * \brief Accounts the compensation applied since its last change to the
+ *        measurement baseline
+ */
+static void AccumulateCompensation( SysTime_t now )
+{
+    ClockDisciplineState.BaselineError += ( int64_t )ClockDisciplineState.Compensation *
+                                          ToMs( SysTimeSub( now, ClockDisciplineState.CompensationTime ) );
+    ClockDisciplineState.CompensationTime = now;
+}
+
+static void ApplyCompensation( void )
+{
+    AccumulateCompensation( SysTimeGetMcuTime( ) );
+
+    if( ClockDisciplineState.SetDriftCompensation != NULL )
+    {
+        ClockDisciplineState.Compensation = ClockDisciplineState.SetDriftCompensation( ClockDisciplineState.Drift +
+                                                                                       ClockDisciplineState.Slew );
+    }
+}
+
+static void OnSlewTimerEvent( void *context )
+{
+    ClockDisciplineState.Slew = 0;
+    ApplyCompensation( );
+}
+
+/*!
+ * \brief Updates the drift estimate and the period stretch from a correction
+ *
+ * \param [IN] now        RTC time of the correction
+ * \param [IN] correction Correction, including the steps applied by other
+ *                        layers since the last one, in ms
+ * \param [IN] resolution Resolution of the correction in ms
+ */
+static void Measure( SysTime_t now, int32_t correction, uint16_t resolution )
+{
+    int32_t residual = correction - ClockDisciplineState.Phase;
+    int32_t bound = ( resolution > CLOCK_DISCIPLINE_MAX_ERROR ) ? resolution : CLOCK_DISCIPLINE_MAX_ERROR;
+    int64_t baseline;
+
+    // The RTC drift is the phase error it accumulated, minus the one the
+    // compensation removed, over the baseline
+    AccumulateCompensation( now );
+    ClockDisciplineState.BaselineError -= ( int64_t )residual * PPB;
+
+    baseline = ToMs( SysTimeSub( now, ClockDisciplineState.BaselineTime ) );
+    if( ( baseline > 0 ) && ( baseline * CLOCK_DISCIPLINE_DRIFT_ACCURACY >= ( int64_t )resolution * PPB ) )
+    {
+        int64_t drift = ClockDisciplineState.BaselineError / baseline;
+
+        if( ( drift > CLOCK_DISCIPLINE_MAX_DRIFT ) || ( drift < -CLOCK_DISCIPLINE_MAX_DRIFT ) )
+        {
+            // Time jump, the measurement is meaningless
+            ClockDisciplineState.Stretch = 0;
+        }
+        else if( ClockDisciplineState.DriftValid == false )
+        {
+            ClockDisciplineState.Drift = ( int32_t )drift;
+            ClockDisciplineState.DriftValid = true;
+        }
+        else
+        {
+            ClockDisciplineState.Drift += ( ( int32_t )drift - ClockDisciplineState.Drift ) / CLOCK_DISCIPLINE_DRIFT_GAIN;
+        }
+        ClockDisciplineState.BaselineTime = now;
+        ClockDisciplineState.BaselineError = 0;
+    }
+
+    // Stretch the period while the error accumulated over it stays in an
+    // eighth of the bound: a drift change makes the error grow with the
+    // square of the period, doubling it keeps the error in half the bound.
+    // Shrink it as soon as the error exceeds half the bound.
+    if( Abs( residual ) > bound )
+    {
+        ClockDisciplineState.Stretch = 0;
+        ClockDisciplineState.Good = 0;
+    }
+    else if( Abs( residual ) * 2 > bound )
+    {
+        if( ClockDisciplineState.Stretch > 0 )
+        {
+            ClockDisciplineState.Stretch--;
+        }
+        ClockDisciplineState.Good = 0;
+    }
+    else if( ( ClockDisciplineState.DriftValid == true ) && ( Abs( residual ) * 8 <= bound ) )
+    {
+        if( ( ++ClockDisciplineState.Good >= CLOCK_DISCIPLINE_STRETCH_HOLD ) &&
+            ( ClockDisciplineState.Stretch < CLOCK_DISCIPLINE_MAX_STRETCH ) )
+        {
+            ClockDisciplineState.Stretch++;
+            ClockDisciplineState.Good = 0;
+        }
+    }
+}
+
+static void Restart( SysTime_t now )
+{
+    ClockDisciplineState.Synchronized = true;
+    ClockDisciplineState.Phase = 0;
+    ClockDisciplineState.Stretch = 0;
+    ClockDisciplineState.Good = 0;
+    ClockDisciplineState.BaselineTime = now;
+    ClockDisciplineState.BaselineError = 0;
+    ClockDisciplineState.CompensationTime = now;
+}
+
+/*!
+ * \brief Slews a correction by biasing the RTC compensation until it is
+ *        absorbed, the RTC runs faster while it is late
+ *
+ * \remark Only corrections in CLOCK_DISCIPLINE_MAX_ERROR are slewed, once the
+ *         drift is known, when the RTC supports a compensation and when no
+ *         layer needs the exact time right away
+ *
+ * \param [IN] correction Correction in ms
+ *
+ * \retval slewed Returns false when the correction has to be stepped
+ */
+static bool StartSlew( int32_t correction )
+{
+    ClockDisciplineState.Phase = 0;
+    if( ( ClockDisciplineState.SetDriftCompensation == NULL ) || ( ClockDisciplineState.DriftValid == false ) ||
+        ( correction == 0 ) || ( Abs( correction ) > CLOCK_DISCIPLINE_MAX_ERROR ) ||
+        ( ( ClockDisciplineState.IsStepRequired != NULL ) && ( ClockDisciplineState.IsStepRequired( ) == true ) ) )
+    {
+        return false;
+    }
+    ClockDisciplineState.Phase = correction;
+    ClockDisciplineState.Slew = ( correction > 0 ) ? -CLOCK_DISCIPLINE_SLEW_RATE : CLOCK_DISCIPLINE_SLEW_RATE;
+    TimerSetValue( &SlewTimer, ( uint32_t )( ( int64_t )Abs( correction ) * PPB / CLOCK_DISCIPLINE_SLEW_RATE ) );
+    TimerStart( &SlewTimer );
+    return true;
+}
+
+void ClockDisciplineInit( ClockDisciplineSetDrift_t setDriftCompensation, ClockDisciplineIsStepRequired_t isStepRequired )
+{
+    ClockDisciplineState.SetDriftCompensation = setDriftCompensation;
+    ClockDisciplineState.IsStepRequired = isStepRequired;
+    TimerInit( &SlewTimer, OnSlewTimerEvent );
+    ClockDisciplineReset( );
+}
+
+void ClockDisciplineReset( void )
+{
+    TimerStop( &SlewTimer );
+
+    ClockDisciplineState.Synchronized = false;
+    ClockDisciplineState.DriftValid = false;
+    ClockDisciplineState.Drift = 0;
+    ClockDisciplineState.Slew = 0;
+    ClockDisciplineState.Phase = 0;
+    ClockDisciplineState.Stretch = 0;
+    ClockDisciplineState.Good = 0;
+    ClockDisciplineState.BaselineError = 0;
+    ClockDisciplineState.CompensationTime = SysTimeGetMcuTime( );
+    ApplyCompensation( );
+}
+
+void ClockDisciplineCorrect( SysTime_t correction, uint16_t resolution )
+{
+    SysTime_t now = SysTimeGetMcuTime( );
+    int32_t correctionMs = ( int32_t )ToMs( correction );
+
+    TimerStop( &SlewTimer );
+    ClockDisciplineState.Slew = 0;
+
+    if( ClockDisciplineState.Synchronized == false )
+    {
+        Restart( now );
+    }
+    else
+    {
+        // Steps applied by other layers since the last correction are part
+        // of the error accumulated by the RTC
+        Measure( now, correctionMs + ( int32_t )ToMs( SysTimeSub( GetOffset( ), ClockDisciplineState.Offset ) ), resolution );
+    }
+
+    if( StartSlew( correctionMs ) == false )
+    {
+        SysTimeSet( SysTimeAdd( SysTimeGet( ), correction ) );
+    }
+    ClockDisciplineState.Offset = GetOffset( );
+    ApplyCompensation( );
+}
+
+void ClockDisciplineSynchronized( uint16_t resolution )
+{
+    SysTime_t now = SysTimeGetMcuTime( );
+    int32_t step = ( int32_t )ToMs( SysTimeSub( GetOffset( ), ClockDisciplineState.Offset ) );
+
+    // The step applied cancels any pending slew
+    TimerStop( &SlewTimer );
+    ClockDisciplineState.Slew = 0;
+
+    if( ClockDisciplineState.Synchronized == false )
+    {
+        Restart( now );
+        step = 0;
+    }
+    else
+    {
+        Measure( now, step, resolution );
+    }
+
+    if( StartSlew( step ) == true )
+    {
+        // Small step, revert it and slew it instead
+        SysTimeSet( SysTimeSub( SysTimeGet( ), FromMs( step ) ) );
+    }
+    ClockDisciplineState.Offset = GetOffset( );
+    ApplyCompensation( );
+}
+
+bool ClockDisciplineGetDrift( int32_t *drift )
+{
+    if( drift != NULL )
+    {
+        *drift = ClockDisciplineState.Drift;
+    }
+    return ClockDisciplineState.DriftValid;
+}
+
+uint32_t ClockDisciplineGetPeriod( uint32_t period )
+{
+    uint8_t stretch = ClockDisciplineState.Stretch;
+
+    while( ( stretch > 0 ) && ( period > ( CLOCK_DISCIPLINE_MAX_PERIOD >> stretch ) ) )
+    {
+        stretch--;
+    }
+    return period << stretch;
+}
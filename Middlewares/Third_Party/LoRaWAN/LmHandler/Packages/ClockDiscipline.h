@@ -0,0 +1,175 @@
+/*!
+ * \file      ClockDiscipline.h
+ *
+ * \brief     Local clock discipline driven by the clock synchronization
+ *            corrections
+ *
+ * \details   Every correction received from the network (AppTimeAns of the
+ *            clock synchronization package or DeviceTimeAns MAC command) is
+ *            a sample of the phase error accumulated by the RTC since the
+ *            previous one. The samples are accumulated over a baseline long
+ *            enough for the resolution of the correction and give an
+ *            estimate of the RTC crystal drift, in ppb.
+ *
+ *            The drift estimate is handed to the RTC layer through the
+ *            SetDriftCompensation callback (RTC smooth calibration on the
+ *            STM32WL). Once the drift is known, corrections smaller than
+ *            CLOCK_DISCIPLINE_MAX_ERROR are slewed by biasing that
+ *            compensation for the time needed to absorb them, so the system
+ *            time does not jump. Larger corrections, or all of them when no
+ *            callback is provided, step the system time. So do the
+ *            corrections received while the IsStepRequired callback reports
+ *            a layer scheduling from the system time right away (Class B
+ *            beacon acquisition): a slewed error lasts up to
+ *            CLOCK_DISCIPLINE_MAX_ERROR / CLOCK_DISCIPLINE_SLEW_RATE, 500 s.
+ *
+ *            Once the drift is known and the residual error of successive
+ *            corrections stays bounded, the synchronization period returned
+ *            by ClockDisciplineGetPeriod is stretched by powers of two.
+ */
+#ifndef __CLOCK_DISCIPLINE_H__
+#define __CLOCK_DISCIPLINE_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "systime.h"
+
+/*!
+ * Resolution of the AppTimeAns correction, whole seconds
+ */
+#define CLOCK_DISCIPLINE_APP_TIME_RESOLUTION        1000
+
+/*!
+ * Resolution of the DeviceTimeAns correction, 1/256 second
+ */
+#define CLOCK_DISCIPLINE_DEVICE_TIME_RESOLUTION     4
+
+/*!
+ * Accuracy, in ppb, the drift is measured with. The measurement baseline
+ * is extended until the correction resolution is below this accuracy.
+ */
+#ifndef CLOCK_DISCIPLINE_DRIFT_ACCURACY
+#define CLOCK_DISCIPLINE_DRIFT_ACCURACY             2000
+#endif
+
+/*!
+ * Drift estimate filter gain, a new measurement accounts for 1/GAIN
+ */
+#ifndef CLOCK_DISCIPLINE_DRIFT_GAIN
+#define CLOCK_DISCIPLINE_DRIFT_GAIN                 4
+#endif
+
+/*!
+ * Largest plausible drift, in ppb. A larger measurement is a time jump
+ * (system time set by another source) and is discarded.
+ */
+#ifndef CLOCK_DISCIPLINE_MAX_DRIFT
+#define CLOCK_DISCIPLINE_MAX_DRIFT                  200000
+#endif
+
+/*!
+ * Frequency offset, in ppb, used to slew the small corrections
+ */
+#ifndef CLOCK_DISCIPLINE_SLEW_RATE
+#define CLOCK_DISCIPLINE_SLEW_RATE                  100000
+#endif
+
+/*!
+ * Error, in ms, the synchronization period is stretched for. Smaller
+ * corrections are slewed.
+ */
+#ifndef CLOCK_DISCIPLINE_MAX_ERROR
+#define CLOCK_DISCIPLINE_MAX_ERROR                  50
+#endif
+
+/*!
+ * Number of successive corrections in an eighth of the error bound before
+ * the synchronization period is doubled
+ */
+#ifndef CLOCK_DISCIPLINE_STRETCH_HOLD
+#define CLOCK_DISCIPLINE_STRETCH_HOLD               2
+#endif
+
+/*!
+ * Largest stretch of the synchronization period, as a power of two
+ */
+#ifndef CLOCK_DISCIPLINE_MAX_STRETCH
+#define CLOCK_DISCIPLINE_MAX_STRETCH                3
+#endif
+
+/*!
+ * \brief Applies a frequency compensation to the RTC
+ *
+ * \param [IN] drift RTC drift to compensate in ppb, positive when the RTC
+ *                   runs fast
+ *
+ * \retval applied Compensation actually applied by the hardware in ppb
+ */
+typedef int32_t ( *ClockDisciplineSetDrift_t )( int32_t drift );
+
+/*!
+ * \brief Checks if the system time has to be exact as soon as corrected
+ *
+ * \retval required Returns true when the corrections have to be stepped
+ */
+typedef bool ( *ClockDisciplineIsStepRequired_t )( void );
+
+/*!
+ * \brief Initializes the clock discipline
+ *
+ * \param [IN] setDriftCompensation RTC frequency compensation, may be NULL
+ * \param [IN] isStepRequired       Step request of the other layers, may be
+ *                                  NULL
+ */
+void ClockDisciplineInit( ClockDisciplineSetDrift_t setDriftCompensation, ClockDisciplineIsStepRequired_t isStepRequired );
+
+/*!
+ * \brief Restarts the drift estimation and clears the RTC compensation
+ */
+void ClockDisciplineReset( void );
+
+/*!
+ * \brief Processes a correction of the system time and applies it
+ *
+ * \param [IN] correction Network time minus system time
+ * \param [IN] resolution Resolution of the correction in ms
+ */
+void ClockDisciplineCorrect( SysTime_t correction, uint16_t resolution );
+
+/*!
+ * \brief Processes a correction already applied to the system time by
+ *        another layer (DeviceTimeAns MAC command)
+ *
+ * \param [IN] resolution Resolution of the correction in ms
+ */
+void ClockDisciplineSynchronized( uint16_t resolution );
+
+/*!
+ * \brief Gets the RTC drift estimate
+ *
+ * \param [OUT] drift RTC drift in ppb, positive when the RTC runs fast
+ *
+ * \retval valid Returns false while the drift is not known yet
+ */
+bool ClockDisciplineGetDrift( int32_t *drift );
+
+/*!
+ * \brief Gets the synchronization period adapted to the clock stability
+ *
+ * \param [IN] period Nominal synchronization period in seconds
+ *
+ * \retval period Stretched synchronization period in seconds
+ */
+uint32_t ClockDisciplineGetPeriod( uint32_t period );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CLOCK_DISCIPLINE_H__
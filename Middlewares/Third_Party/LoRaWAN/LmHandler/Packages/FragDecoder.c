@@ -43,6 +43,29 @@
  *=============================================================================
  */
 
+/*!
+ * Decoding step of the fragment at the head of the queue
+ */
+typedef enum eFragDecoderStep
+{
+    /*!
+     * Uncoded fragment, or parity matrix row of a coded fragment
+     */
+    FRAG_DECODER_STEP_START,
+    /*!
+     * XOR of the received fragments of the parity matrix row
+     */
+    FRAG_DECODER_STEP_REDUCE,
+    /*!
+     * Elimination against the rows already diagonalized
+     */
+    FRAG_DECODER_STEP_ELIMINATE,
+    /*!
+     * Back substitution once all the missing fragments are covered
+     */
+    FRAG_DECODER_STEP_SOLVE,
+}FragDecoderStep_t;
+
 typedef struct
 {
     FragDecoderCallbacks_t *Callbacks;
@@ -56,6 +79,31 @@ typedef struct
     uint8_t S[( FRAG_MAX_REDUNDANCY >> 3 ) + 1];
 
     FragDecoderStatus_t Status;
+
+    /*!
+     * Session status, FRAG_SESSION_ONGOING until the file is rebuilt
+     */
+    int32_t Result;
+
+    /*!
+     * Resumable state of the fragment being decoded
+     */
+    FragDecoderStep_t Step;
+    int32_t Index;                                              // REDUCE: column, SOLVE: row
+    int32_t Col;                                                // SOLVE: column, -1 before the row is read
+    bool First;
+    uint16_t FirstOneInRow;
+    uint8_t MatrixRow[( FRAG_MAX_NB >> 3 ) + 1];
+    uint8_t DataTempVector[( FRAG_MAX_REDUNDANCY >> 3 ) + 1];
+    uint8_t RowData[FRAG_MAX_SIZE];                             // SOLVE: row being solved
+
+    /*!
+     * Fragments received and not decoded yet, the head one is being decoded
+     */
+    uint8_t Queue[FRAG_DECODER_QUEUE_SIZE][FRAG_MAX_SIZE];
+    uint16_t QueueCounter[FRAG_DECODER_QUEUE_SIZE];
+    uint8_t QueueHead;
+    uint8_t QueueCount;
 }FragDecoder_t;
 
 /*!
@@ -197,6 +245,52 @@ static void FragExtractLineFromBinaryMatrix( uint8_t* bitArray, uint16_t rowInde
  */
 static void FragPushLineToBinaryMatrix( uint8_t *bitArray, uint16_t rowIndex, uint16_t bitsInRow );
 
+/*!
+ * \brief Stores an uncoded fragment, or computes the parity matrix row of a
+ *        coded one
+ *
+ * \param [IN] fragCounter Fragment counter
+ * \param [IN] rawData     Fragment
+ *
+ * \retval done            Returns true when the fragment is fully processed
+ */
+static bool FragStepStart( uint16_t fragCounter, uint8_t *rawData );
+
+/*!
+ * \brief XORs the received fragments of the parity matrix row into the coded
+ *        fragment
+ *
+ * \param [IN/OUT] rawData Coded fragment
+ * \param [IN/OUT] ops     Row operations done in the slice
+ * \param [IN]     budget  Slice budget in row operations
+ *
+ * \retval done            Returns true when the fragment is fully processed
+ */
+static bool FragStepReduce( uint8_t *rawData, uint32_t *ops, uint32_t budget );
+
+/*!
+ * \brief Eliminates the coded fragment against the diagonalized rows and
+ *        stores it as a new one
+ *
+ * \param [IN/OUT] rawData Coded fragment
+ * \param [IN/OUT] ops     Row operations done in the slice
+ * \param [IN]     budget  Slice budget in row operations
+ *
+ * \retval done            Returns true when the fragment is fully processed
+ */
+static bool FragStepEliminate( uint8_t *rawData, uint32_t *ops, uint32_t budget );
+
+/*!
+ * \brief Back substitution of the diagonalized rows into the missing
+ *        fragments
+ *
+ * \param [IN/OUT] ops    Row operations done in the slice
+ * \param [IN]     budget Slice budget in row operations
+ *
+ * \retval done           Returns true when the file is rebuilt
+ */
+static bool FragStepSolve( uint32_t *ops, uint32_t budget );
+
 /*
  *=============================================================================
  * Fragmentation decoder algorithm
@@ -210,8 +304,10 @@ void FragDecoderInit( uint16_t fragNb, uint8_t fragSize, FragDecoderCallbacks_t
     FragDecoder.Callbacks = callbacks;
     FragDecoder.FragNb = fragNb;                                // FragNb = FRAG_MAX_SIZE
     FragDecoder.FragSize = fragSize;                            // number of byte on a row
+    FragDecoder.Status.FragNbRx = 0;
     FragDecoder.Status.FragNbLastRx = 0;
     FragDecoder.Status.FragNbLost = 0;
+    FragDecoder.Status.MatrixError = 0;
     FragDecoder.M2BLine = 0;
 
     // Initialize missing fragments index array
@@ -239,6 +335,11 @@ void FragDecoderInit( uint16_t fragNb, uint8_t fragSize, FragDecoderCallbacks_t
 
     FragDecoder.Status.FragNbLost = 0;
     FragDecoder.Status.FragNbLastRx = 0;
+
+    FragDecoder.Result = FRAG_SESSION_ONGOING;
+    FragDecoder.Step = FRAG_DECODER_STEP_START;
+    FragDecoder.QueueHead = 0;
+    FragDecoder.QueueCount = 0;
 }
 
 uint32_t FragDecoderGetMaxFileSize( void )
@@ -248,25 +349,87 @@ uint32_t FragDecoderGetMaxFileSize( void )
 
 int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
 {
-    uint16_t firstOneInRow = 0;
-    int32_t first = 0;
-    int32_t noInfo = 0;
+    while( FragDecoderIsBusy( ) == true )
+    {
+        FragDecoderStep( UINT32_MAX );
+    }
+    if( FragDecoderPush( fragCounter, rawData ) == true )
+    {
+        FragDecoderStep( UINT32_MAX );
+    }
+    return FragDecoder.Result;
+}
 
-    uint8_t matrixRow[(FRAG_MAX_NB >> 3 ) + 1];
-    uint8_t matrixDataTemp[FRAG_MAX_SIZE];
-    uint8_t dataTempVector[( FRAG_MAX_REDUNDANCY >> 3 ) + 1];
-    uint8_t dataTempVector2[( FRAG_MAX_REDUNDANCY >> 3 ) + 1];
+bool FragDecoderPush( uint16_t fragCounter, uint8_t *rawData )
+{
+    uint8_t tail;
 
-    UTIL_MEM_set_8(matrixRow, 0, (FRAG_MAX_NB >> 3) + 1);
-    UTIL_MEM_set_8(matrixDataTemp, 0, FRAG_MAX_SIZE);
-    UTIL_MEM_set_8(dataTempVector, 0, (FRAG_MAX_REDUNDANCY >> 3) + 1);
-    UTIL_MEM_set_8(dataTempVector2, 0, (FRAG_MAX_REDUNDANCY >> 3) + 1);
+    if( ( FragDecoder.Result != FRAG_SESSION_ONGOING ) || ( FragDecoder.QueueCount >= FRAG_DECODER_QUEUE_SIZE ) )
+    {
+        return false;
+    }
+    tail = ( FragDecoder.QueueHead + FragDecoder.QueueCount ) % FRAG_DECODER_QUEUE_SIZE;
+    UTIL_MEM_cpy_8( FragDecoder.Queue[tail], rawData, FragDecoder.FragSize );
+    FragDecoder.QueueCounter[tail] = fragCounter;
+    FragDecoder.QueueCount++;
+    return true;
+}
 
+int32_t FragDecoderStep( uint32_t budget )
+{
+    uint32_t ops = 0;
+
+    while( ( FragDecoderIsBusy( ) == true ) && ( ops < budget ) )
+    {
+        uint8_t *rawData = FragDecoder.Queue[FragDecoder.QueueHead];
+        bool done = false;
+
+        switch( FragDecoder.Step )
+        {
+            case FRAG_DECODER_STEP_START:
+                ops++;
+                done = FragStepStart( FragDecoder.QueueCounter[FragDecoder.QueueHead], rawData );
+                break;
+            case FRAG_DECODER_STEP_REDUCE:
+                done = FragStepReduce( rawData, &ops, budget );
+                break;
+            case FRAG_DECODER_STEP_ELIMINATE:
+                done = FragStepEliminate( rawData, &ops, budget );
+                break;
+            case FRAG_DECODER_STEP_SOLVE:
+                done = FragStepSolve( &ops, budget );
+                break;
+            default:
+                break;
+        }
+
+        if( done == true )
+        {
+            FragDecoder.Step = FRAG_DECODER_STEP_START;
+            FragDecoder.QueueHead = ( FragDecoder.QueueHead + 1 ) % FRAG_DECODER_QUEUE_SIZE;
+            FragDecoder.QueueCount--;
+        }
+        if( FragDecoder.Result != FRAG_SESSION_ONGOING )
+        {
+            // Session finished, the fragments left are not needed
+            FragDecoder.QueueCount = 0;
+        }
+    }
+    return FragDecoder.Result;
+}
+
+bool FragDecoderIsBusy( void )
+{
+    return ( FragDecoder.QueueCount > 0 ) && ( FragDecoder.Result == FRAG_SESSION_ONGOING );
+}
+
+static bool FragStepStart( uint16_t fragCounter, uint8_t *rawData )
+{
     FragDecoder.Status.FragNbRx = fragCounter;
 
     if( fragCounter < FragDecoder.Status.FragNbLastRx )
     {
-        return FRAG_SESSION_ONGOING;  // Drop frame out of order
+        return true;  // Drop frame out of order
     }
 
     // The M (FragNb) first packets aren't encoded or in other words they are
@@ -283,127 +446,174 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
 
         if ((fragCounter == FragDecoder.FragNb) && (FragDecoder.Status.FragNbLost == 0U))
         {
-            return FRAG_SESSION_FINISHED;
+            FragDecoder.Result = FRAG_SESSION_FINISHED;
         }
+        return true;
     }
-    else
+
+    if( FragDecoder.Status.FragNbLost > FRAG_MAX_REDUNDANCY )
     {
-        if( FragDecoder.Status.FragNbLost > FRAG_MAX_REDUNDANCY )
-        {
-           FragDecoder.Status.MatrixError = 1;
-           return FRAG_SESSION_FINISHED;
-        }
-        // At this point we receive encoded frames and the number of loosing frames
-        // is well known: FragDecoder.FragNbLost - 1;
+        FragDecoder.Status.MatrixError = 1;
+        FragDecoder.Result = FRAG_SESSION_FINISHED;
+        return true;
+    }
+    // At this point we receive encoded frames and the number of loosing frames
+    // is well known: FragDecoder.FragNbLost - 1;
 
-        // In case of the end of true data is missing
-        FragFindMissingFrags( fragCounter );
+    // In case of the end of true data is missing
+    FragFindMissingFrags( fragCounter );
 
-        if( FragDecoder.Status.FragNbLost == 0 )
-        { 
-            // the case : all the M(FragNb) first rows have been transmitted with no error
-            return FragDecoder.Status.FragNbLost;
-        }
+    if( FragDecoder.Status.FragNbLost == 0 )
+    {
+        // the case : all the M(FragNb) first rows have been transmitted with no error
+        FragDecoder.Result = FragDecoder.Status.FragNbLost;
+        return true;
+    }
 
-        // fragCounter - FragDecoder.FragNb
-        FragGetParityMatrixRow( fragCounter - FragDecoder.FragNb, FragDecoder.FragNb, matrixRow );
+    // fragCounter - FragDecoder.FragNb
+    FragGetParityMatrixRow( fragCounter - FragDecoder.FragNb, FragDecoder.FragNb, FragDecoder.MatrixRow );
+    UTIL_MEM_set_8( FragDecoder.DataTempVector, 0, ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 );
+    FragDecoder.First = false;
+    FragDecoder.Index = 0;
+    FragDecoder.Step = FRAG_DECODER_STEP_REDUCE;
+    return false;
+}
+
+static bool FragStepReduce( uint8_t *rawData, uint32_t *ops, uint32_t budget )
+{
+    uint8_t matrixDataTemp[FRAG_MAX_SIZE];
+
+    for( ; FragDecoder.Index < FragDecoder.FragNb; FragDecoder.Index++ )
+    {
+        uint16_t i = ( uint16_t )FragDecoder.Index;
 
-        for( int32_t i = 0; i < FragDecoder.FragNb; i++ )
+        if( GetParity( i, FragDecoder.MatrixRow ) == 1 )
         {
-            if( GetParity( i , matrixRow ) == 1 )
+            if( FragDecoder.FragNbMissingIndex[i] == 0 )
             {
-                if( FragDecoder.FragNbMissingIndex[i] == 0 )
+                if( *ops >= budget )
                 {
-                    // XOR with already receive frag
-                    SetParity( i, matrixRow, 0 );
-                    GetRow( matrixDataTemp, i, FragDecoder.FragSize );
-                    XorDataLine( rawData, matrixDataTemp, FragDecoder.FragSize );
-                }
-                else
-                {
-                    // Fill the "little" boolean matrix m2b
-                    SetParity( FragDecoder.FragNbMissingIndex[i] - 1, dataTempVector, 1 );
-                    if( first == 0 )
-                    {
-                        first = 1;
-                    }
+                    return false;
                 }
+                ( *ops )++;
+                // XOR with already receive frag
+                SetParity( i, FragDecoder.MatrixRow, 0 );
+                GetRow( matrixDataTemp, i, FragDecoder.FragSize );
+                XorDataLine( rawData, matrixDataTemp, FragDecoder.FragSize );
+            }
+            else
+            {
+                // Fill the "little" boolean matrix m2b
+                SetParity( FragDecoder.FragNbMissingIndex[i] - 1, FragDecoder.DataTempVector, 1 );
+                FragDecoder.First = true;
             }
         }
+    }
 
-        firstOneInRow = BitArrayFindFirstOne( dataTempVector, FragDecoder.Status.FragNbLost );
+    if( FragDecoder.First == false )
+    {
+        // Only covers received fragments
+        return true;
+    }
+    FragDecoder.FirstOneInRow = BitArrayFindFirstOne( FragDecoder.DataTempVector, FragDecoder.Status.FragNbLost );
+    FragDecoder.Step = FRAG_DECODER_STEP_ELIMINATE;
+    return false;
+}
+
+static bool FragStepEliminate( uint8_t *rawData, uint32_t *ops, uint32_t budget )
+{
+    uint8_t matrixDataTemp[FRAG_MAX_SIZE];
+    uint8_t dataTempVector2[( FRAG_MAX_REDUNDANCY >> 3 ) + 1];
+    uint16_t li;
 
-        if( first > 0 )
+    // Manage a new line in MatrixM2B
+    while( GetParity( FragDecoder.FirstOneInRow, FragDecoder.S ) == 1 )
+    {
+        if( *ops >= budget )
         {
-            int32_t li;
-            int32_t lj;
-
-            // Manage a new line in MatrixM2B
-            while( GetParity( firstOneInRow, FragDecoder.S ) == 1 )
-            { 
-                // Row already diagonalized exist & ( FragDecoder.MatrixM2B[firstOneInRow][0] )
-                FragExtractLineFromBinaryMatrix( dataTempVector2, firstOneInRow, FragDecoder.Status.FragNbLost );
-                XorParityLine( dataTempVector, dataTempVector2, FragDecoder.Status.FragNbLost );
-                // Have to store it in the mi th position of the missing frag
-                li = FragFindMissingIndex( firstOneInRow );
-                GetRow( matrixDataTemp, li, FragDecoder.FragSize );
-                XorDataLine( rawData, matrixDataTemp, FragDecoder.FragSize );
-                if( BitArrayIsAllZeros( dataTempVector, FragDecoder.Status.FragNbLost ) )
-                {
-                    noInfo = 1;
-                    break;
-                }
-                firstOneInRow = BitArrayFindFirstOne( dataTempVector, FragDecoder.Status.FragNbLost );
-            }
+            return false;
+        }
+        ( *ops )++;
+        // Row already diagonalized exist & ( FragDecoder.MatrixM2B[firstOneInRow][0] )
+        FragExtractLineFromBinaryMatrix( dataTempVector2, FragDecoder.FirstOneInRow, FragDecoder.Status.FragNbLost );
+        XorParityLine( FragDecoder.DataTempVector, dataTempVector2, FragDecoder.Status.FragNbLost );
+        // Have to store it in the mi th position of the missing frag
+        li = FragFindMissingIndex( FragDecoder.FirstOneInRow );
+        GetRow( matrixDataTemp, li, FragDecoder.FragSize );
+        XorDataLine( rawData, matrixDataTemp, FragDecoder.FragSize );
+        if( BitArrayIsAllZeros( FragDecoder.DataTempVector, FragDecoder.Status.FragNbLost ) )
+        {
+            // No new information
+            return true;
+        }
+        FragDecoder.FirstOneInRow = BitArrayFindFirstOne( FragDecoder.DataTempVector, FragDecoder.Status.FragNbLost );
+    }
 
-            if( noInfo == 0 )
+    if( *ops >= budget )
+    {
+        return false;
+    }
+    ( *ops )++;
+    FragPushLineToBinaryMatrix( FragDecoder.DataTempVector, FragDecoder.FirstOneInRow, FragDecoder.Status.FragNbLost );
+    li = FragFindMissingIndex( FragDecoder.FirstOneInRow );
+    SetRow( rawData, li, FragDecoder.FragSize );
+    SetParity( FragDecoder.FirstOneInRow, FragDecoder.S, 1 );
+    FragDecoder.M2BLine++;
+
+    if( FragDecoder.M2BLine < FragDecoder.Status.FragNbLost )
+    {
+        return true;
+    }
+    // Then last step diagonalized
+    FragDecoder.Index = ( int32_t )FragDecoder.Status.FragNbLost - 2;
+    FragDecoder.Col = -1;
+    FragDecoder.Step = FRAG_DECODER_STEP_SOLVE;
+    return false;
+}
+
+static bool FragStepSolve( uint32_t *ops, uint32_t budget )
+{
+    uint8_t matrixDataTemp[FRAG_MAX_SIZE];
+
+    // The rows above Index are solved, the row Index only needs them. Its
+    // line of MatrixM2B is read once, the back substitution does not change
+    // the matrix.
+    for( ; FragDecoder.Index >= 0; FragDecoder.Index-- )
+    {
+        if( FragDecoder.Col < 0 )
+        {
+            if( *ops >= budget )
             {
-                FragPushLineToBinaryMatrix( dataTempVector, firstOneInRow, FragDecoder.Status.FragNbLost );
-                li = FragFindMissingIndex( firstOneInRow );
-                SetRow( rawData, li, FragDecoder.FragSize );
-                SetParity( firstOneInRow, FragDecoder.S, 1 );
-                FragDecoder.M2BLine++;
+                return false;
             }
-
-            if( FragDecoder.M2BLine == FragDecoder.Status.FragNbLost )
-            { 
-                // Then last step diagonalized
-                if( FragDecoder.Status.FragNbLost > 1 )
+            ( *ops )++;
+            GetRow( FragDecoder.RowData, FragFindMissingIndex( FragDecoder.Index ), FragDecoder.FragSize );
+            FragExtractLineFromBinaryMatrix( FragDecoder.DataTempVector, FragDecoder.Index, FragDecoder.Status.FragNbLost );
+            FragDecoder.Col = FragDecoder.Status.FragNbLost - 1;
+        }
+        for( ; FragDecoder.Col > FragDecoder.Index; FragDecoder.Col-- )
+        {
+            if( GetParity( FragDecoder.Col, FragDecoder.DataTempVector ) == 1 )
+            {
+                if( *ops >= budget )
                 {
-                    int32_t i;
-                    int32_t j;
-
-                    for( i = ( FragDecoder.Status.FragNbLost - 2 ); i >= 0 ; i-- )
-                    {
-                        li = FragFindMissingIndex( i );
-                        GetRow( matrixDataTemp, li, FragDecoder.FragSize );
-                        for( j = ( FragDecoder.Status.FragNbLost - 1 ); j > i; j--)
-                        {
-                            FragExtractLineFromBinaryMatrix( dataTempVector2, i, FragDecoder.Status.FragNbLost );
-                            FragExtractLineFromBinaryMatrix( dataTempVector, j, FragDecoder.Status.FragNbLost );
-                            if( GetParity( j, dataTempVector2 ) == 1 )
-                            {
-                                XorParityLine( dataTempVector2, dataTempVector, FragDecoder.Status.FragNbLost );
-
-                                lj = FragFindMissingIndex( j );
-
-                                GetRow( rawData, lj, FragDecoder.FragSize );
-                                XorDataLine( matrixDataTemp , rawData , FragDecoder.FragSize );
-                            }
-                        }
-                        SetRow( matrixDataTemp, li, FragDecoder.FragSize );
-                    }
-                    return FragDecoder.Status.FragNbLost;
-                }
-                else
-                { 
-                    //If not ( FragDecoder.FragNbLost > 1 )
-                    return FragDecoder.Status.FragNbLost;
+                    return false;
                 }
+                ( *ops )++;
+                GetRow( matrixDataTemp, FragFindMissingIndex( FragDecoder.Col ), FragDecoder.FragSize );
+                XorDataLine( FragDecoder.RowData, matrixDataTemp, FragDecoder.FragSize );
             }
         }
+        if( *ops >= budget )
+        {
+            return false;
+        }
+        ( *ops )++;
+        SetRow( FragDecoder.RowData, FragFindMissingIndex( FragDecoder.Index ), FragDecoder.FragSize );
+        FragDecoder.Col = -1;
     }
-    return FRAG_SESSION_ONGOING;
+    FragDecoder.Result = FragDecoder.Status.FragNbLost;
+    return true;
 }
 
 FragDecoderStatus_t FragDecoderGetStatus( void )
@@ -34,11 +34,32 @@
 #define __FRAG_DECODER_H__
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "frag_decoder_if.h"
 
 #define FRAG_SESSION_FINISHED                       ( int32_t )0
 #define FRAG_SESSION_NOT_STARTED                    ( int32_t )-2
 #define FRAG_SESSION_ONGOING                        ( int32_t )-1
 
+/*!
+ * Number of fragments queued by FragDecoderPush while the previous ones are
+ * being decoded, including the one being decoded.
+ *
+ * \remark Every entry takes FRAG_MAX_SIZE bytes.
+ */
+#ifndef FRAG_DECODER_QUEUE_SIZE
+#define FRAG_DECODER_QUEUE_SIZE                     4
+#endif
+
+/*!
+ * Budget of a FragDecoderStep slice, in row operations: the read and XOR of
+ * a stored row, or the write of a row. A row operation also scans the
+ * missing fragments index, O(FRAG_MAX_NB).
+ */
+#ifndef FRAG_DECODER_SLICE_BUDGET
+#define FRAG_DECODER_SLICE_BUDGET                   16
+#endif
+
 typedef struct sFragDecoderStatus
 {
     uint16_t FragNbRx;
@@ -95,7 +116,7 @@ uint32_t FragDecoderGetMaxFileSize( void );
 
 /*!
  * \brief Function to decode and reconstruct the binary file
- *        Called for each receive frame
+ *        Called for each receive frame, decodes it at once
  * 
  * \param [IN] fragCounter Fragment counter [1..(FragDecoder.FragNb + FragDecoder.Redundancy)]
  * \param [IN] rawData     Pointer to the fragment to be processed (length = FragDecoder.FragSize)
@@ -106,6 +127,37 @@ uint32_t FragDecoderGetMaxFileSize( void );
  */
 int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData );
 
+/*!
+ * \brief Queues a received fragment, it is decoded by the next
+ *        FragDecoderStep slices
+ *
+ * \param [IN] fragCounter Fragment counter [1..(FragDecoder.FragNb + FragDecoder.Redundancy)]
+ * \param [IN] rawData     Pointer to the fragment, copied (length = FragDecoder.FragSize)
+ *
+ * \retval status          Returns false when the queue is full or the session
+ *                         is finished, the fragment is then counted as lost
+ */
+bool FragDecoderPush( uint16_t fragCounter, uint8_t *rawData );
+
+/*!
+ * \brief Decodes the queued fragments for at most budget row operations
+ *
+ * \param [IN] budget Slice budget in row operations, see
+ *                    FRAG_DECODER_SLICE_BUDGET
+ *
+ * \retval status     Process status. [FRAG_SESSION_ONGOING,
+ *                                     FRAG_SESSION_FINISHED or
+ *                                     FragDecoder.Status.FragNbLost]
+ */
+int32_t FragDecoderStep( uint32_t budget );
+
+/*!
+ * \brief Checks if queued fragments are left to decode
+ *
+ * \retval busy Returns true while FragDecoderStep has work to do
+ */
+bool FragDecoderIsBusy( void );
+
 /*!
  * \brief Gets the current fragmentation status
  * 
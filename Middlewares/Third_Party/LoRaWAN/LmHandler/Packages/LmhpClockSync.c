@@ -32,6 +32,7 @@
 #include "systime.h"
 #include "LmHandler.h"
 #include "LmhpClockSync.h"
+#include "ClockDiscipline.h"
 #include "utilities.h"
 
 /*!
@@ -66,6 +67,7 @@ typedef struct LmhpClockSyncState_s
     uint8_t NbTransPrev;
     uint8_t DataratePrev;
     uint8_t NbTransmissions;
+    uint32_t Periodicity;
 }LmhpClockSyncState_t;
 
 typedef enum LmhpClockSyncMoteCmd_e
@@ -128,6 +130,13 @@ static void LmhpClockSyncOnMcpsConfirm( McpsConfirm_t *mcpsConfirm );
  */
 static void LmhpClockSyncOnMcpsIndication( McpsIndication_t *mcpsIndication );
 
+/*!
+ * Processes the MLME Confirm
+ *
+ * \param [IN] mlmeConfirm MLME confirmation primitive data
+ */
+static void LmhpClockSyncOnMlmeConfirm( MlmeConfirm_t *mlmeConfirm );
+
 static void OnPeriodicTimeStartTimer(void *context);
 
 static LmhpClockSyncState_t LmhpClockSyncState =
@@ -139,6 +148,7 @@ static LmhpClockSyncState_t LmhpClockSyncState =
     .AdrEnabledPrev = false,
     .NbTransPrev = 0,
     .NbTransmissions = 0,
+    .Periodicity = 0,
 };
 
 static LmhPackage_t LmhpClockSyncPackage =
@@ -150,7 +160,7 @@ static LmhPackage_t LmhpClockSyncPackage =
     .Process = LmhpClockSyncProcess,
     .OnMcpsConfirmProcess = LmhpClockSyncOnMcpsConfirm,
     .OnMcpsIndicationProcess = LmhpClockSyncOnMcpsIndication,
-    .OnMlmeConfirmProcess = NULL,                              // Not used in this package
+    .OnMlmeConfirmProcess = LmhpClockSyncOnMlmeConfirm,
     .OnJoinRequest = NULL,                                     // To be initialized by LmHandler
     .OnSendRequest = NULL,                                     // To be initialized by LmHandler
     .OnDeviceTimeRequest = NULL,                               // To be initialized by LmHandler
@@ -172,6 +182,11 @@ static void LmhpClockSyncInit( void * params, uint8_t *dataBuffer, uint8_t dataB
 {
     if( dataBuffer != NULL )
     {
+        // The RTC drift compensation is optional. The beacon acquisition
+        // schedules its window from the system time, a slewed correction
+        // would shift it by up to CLOCK_DISCIPLINE_MAX_ERROR.
+        ClockDisciplineInit( ( params != NULL ) ? ( ( LmhpClockSyncParams_t * )params )->SetDriftCompensation : NULL,
+                             LmHandlerIsBeaconAcquisitionPending );
         LmhpClockSyncState.DataBuffer = dataBuffer;
         LmhpClockSyncState.DataBufferMaxSize = dataBufferMaxSize;
         LmhpClockSyncState.Initialized = true;
@@ -275,10 +290,8 @@ static void LmhpClockSyncOnMcpsIndication( McpsIndication_t *mcpsIndication )
                 timeCorrection += ( mcpsIndication->Buffer[cmdIndex++] << 24 ) & 0xFF000000;
                 if( ( mcpsIndication->Buffer[cmdIndex++] & 0x0F ) == LmhpClockSyncState.TimeReqParam.Fields.TokenReq )
                 {
-                    SysTime_t curTime = { .Seconds = 0, .SubSeconds = 0 };
-                    curTime = SysTimeGet( );
-                    curTime.Seconds += timeCorrection;
-                    SysTimeSet( curTime );
+                    SysTime_t correction = { .Seconds = ( uint32_t )timeCorrection, .SubSeconds = 0 };
+                    ClockDisciplineCorrect( correction, CLOCK_DISCIPLINE_APP_TIME_RESOLUTION );
                     LmhpClockSyncState.TimeReqParam.Fields.TokenReq = ( LmhpClockSyncState.TimeReqParam.Fields.TokenReq + 1 ) & 0x0F;
                     if( LmhpClockSyncPackage.OnSysTimeUpdate != NULL )
                     {
@@ -296,7 +309,7 @@ static void LmhpClockSyncOnMcpsIndication( McpsIndication_t *mcpsIndication )
                 cmdIndex++;
 
                 uint32_t periodTime = mcpsIndication->Buffer[cmdIndex++] & 0x0F;
-                periodTime = (128 << periodTime) + randr(0, 30);
+                LmhpClockSyncState.Periodicity = (128 << periodTime) + randr(0, 30);
 
                 LmhpClockSyncState.DataBuffer[dataBufferIndex++] = CLOCK_SYNC_APP_TIME_PERIOD_ANS;
                 // Answer status supported.
@@ -310,8 +323,8 @@ static void LmhpClockSyncOnMcpsIndication( McpsIndication_t *mcpsIndication )
                 LmhpClockSyncState.DataBuffer[dataBufferIndex++] = ( curTime.Seconds >> 16 ) & 0xFF;
                 LmhpClockSyncState.DataBuffer[dataBufferIndex++] = ( curTime.Seconds >> 24 ) & 0xFF;
 
-                /* Start Periodic timer */
-                TimerSetValue(&PeriodicTimeStartTimer, periodTime * 1000);
+                /* Start Periodic timer, stretched while the clock discipline keeps the error bounded */
+                TimerSetValue(&PeriodicTimeStartTimer, ClockDisciplineGetPeriod(LmhpClockSyncState.Periodicity) * 1000);
                 TimerStart(&PeriodicTimeStartTimer);
 
                 break;
@@ -346,6 +359,16 @@ static void LmhpClockSyncOnMcpsIndication( McpsIndication_t *mcpsIndication )
     }
 }
 
+static void LmhpClockSyncOnMlmeConfirm( MlmeConfirm_t *mlmeConfirm )
+{
+    if( ( mlmeConfirm->MlmeRequest == MLME_DEVICE_TIME ) &&
+        ( mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK ) )
+    {
+        // The MAC layer already applied the DeviceTimeAns correction
+        ClockDisciplineSynchronized( CLOCK_DISCIPLINE_DEVICE_TIME_RESOLUTION );
+    }
+}
+
 LmHandlerErrorStatus_t LmhpClockSyncAppTimeReq( void )
 {
     if( LmHandlerIsBusy( ) == true )
@@ -421,6 +444,7 @@ LmHandlerErrorStatus_t LmhpClockSyncAppTimeReq( void )
 static void OnPeriodicTimeStartTimer(void *context)
 {
   LmhpClockSyncState.NbTransmissions = 1;
+  TimerSetValue(&PeriodicTimeStartTimer, ClockDisciplineGetPeriod(LmhpClockSyncState.Periodicity) * 1000);
   TimerStart(&PeriodicTimeStartTimer);
   LmhpClockSyncPackage.OnPackageProcessEvent();
 }
@@ -35,12 +35,19 @@
 
 /*!
  * Clock sync package parameters
- *
- * This package doesn't require parameters
  */
-//typedef struct LmhpClockSyncParams_s
-//{
-//}LmhpClockSyncParams_t;
+typedef struct LmhpClockSyncParams_s
+{
+    /*!
+     * Applies a frequency compensation to the RTC, may be NULL
+     *
+     * \param [IN] drift RTC drift to compensate in ppb, positive when the
+     *                   RTC runs fast
+     *
+     * \retval applied Compensation actually applied by the hardware in ppb
+     */
+    int32_t ( *SetDriftCompensation )( int32_t drift );
+}LmhpClockSyncParams_t;
 
 LmhPackage_t *LmhpClockSyncPackageFactory( void );
 
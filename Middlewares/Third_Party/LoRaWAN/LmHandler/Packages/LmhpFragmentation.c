@@ -65,6 +65,10 @@ typedef struct LmhpFragmentationState_s
     bool Initialized;
     bool IsRunning;
     LmhpFragmentationTxDelayStates_t TxDelayState;
+    /*!
+     * Session of the fragments queued in FragDecoder
+     */
+    uint8_t DecoderFragIndex;
     uint8_t DataBufferMaxSize;
     uint8_t *DataBuffer;
     uint8_t *file;
@@ -267,10 +271,60 @@ static bool LmhpFragmentationIsRunning( void )
     return LmhpFragmentationState.IsRunning;
 }
 
+/*!
+ * \brief Runs one FragDecoderStep slice of the decoder session and reports
+ *        its progress
+ *
+ * \remark The Gaussian elimination of a coded fragment costs up to
+ *         FRAG_MAX_REDUNDANCY row operations, the final back substitution
+ *         up to FRAG_MAX_REDUNDANCY^2 / 2. Each slice is limited to
+ *         FRAG_DECODER_SLICE_BUDGET of them, the next one is requested
+ *         through OnPackageProcessEvent so the MAC and the other tasks run
+ *         in between.
+ */
+static void LmhpFragmentationDecoderProcess( void )
+{
+    FragSessionData_t *session = &FragSessionData[LmhpFragmentationState.DecoderFragIndex];
+    uint16_t fragNbRx = session->FragDecoderStatus.FragNbRx;
+
+    if( ( session->FragDecoderProcessStatus != FRAG_SESSION_ONGOING ) || ( FragDecoderIsBusy( ) == false ) )
+    {
+        return;
+    }
+
+    session->FragDecoderProcessStatus = FragDecoderStep( FRAG_DECODER_SLICE_BUDGET );
+    session->FragDecoderStatus = FragDecoderGetStatus( );
+    if( ( LmhpFragmentationParams->OnProgress != NULL ) &&
+        ( ( session->FragDecoderStatus.FragNbRx != fragNbRx ) || ( session->FragDecoderProcessStatus >= 0 ) ) )
+    {
+        LmhpFragmentationParams->OnProgress( session->FragDecoderStatus.FragNbRx,
+                                             session->FragGroupData.FragNb,
+                                             session->FragGroupData.FragSize,
+                                             session->FragDecoderStatus.FragNbLost );
+    }
+
+    if( session->FragDecoderProcessStatus >= 0 )
+    {
+        // Fragmentation successfully done
+        if( LmhpFragmentationParams->OnDone != NULL )
+        {
+            LmhpFragmentationParams->OnDone( session->FragDecoderProcessStatus,
+                                             ( session->FragGroupData.FragNb * session->FragGroupData.FragSize ) - session->FragGroupData.Padding );
+        }
+        session->FragDecoderProcessStatus = FRAG_SESSION_NOT_STARTED;
+    }
+    else if( FragDecoderIsBusy( ) == true )
+    {
+        LmhpFragmentationPackage.OnPackageProcessEvent();
+    }
+}
+
 static void LmhpFragmentationProcess( void )
 {
     LmhpFragmentationTxDelayStates_t delayTimerState;
 
+    LmhpFragmentationDecoderProcess( );
+
     CRITICAL_SECTION_BEGIN( );
     delayTimerState = LmhpFragmentationState.TxDelayState;
     CRITICAL_SECTION_END( );
@@ -413,6 +467,7 @@ static void LmhpFragmentationOnMcpsIndication( McpsIndication_t *mcpsIndication
                     fragSessionData.FragGroupData.IsActive = true;
                     fragSessionData.FragDecoderProcessStatus = FRAG_SESSION_ONGOING;
                     FragSessionData[fragSessionData.FragGroupData.FragSession.Fields.FragIndex] = fragSessionData;
+                    LmhpFragmentationState.DecoderFragIndex = fragSessionData.FragGroupData.FragSession.Fields.FragIndex;
                     FragDecoderInit( fragSessionData.FragGroupData.FragNb,
                                      fragSessionData.FragGroupData.FragSize,
                                      &LmhpFragmentationParams->DecoderCallbacks );
@@ -476,27 +531,14 @@ static void LmhpFragmentationOnMcpsIndication( McpsIndication_t *mcpsIndication
                     }
                 }
 
-                if (FragSessionData[fragIndex].FragDecoderProcessStatus == FRAG_SESSION_ONGOING)
+                if( ( FragSessionData[fragIndex].FragDecoderProcessStatus == FRAG_SESSION_ONGOING ) &&
+                    ( fragIndex == LmhpFragmentationState.DecoderFragIndex ) )
                 {
-                    FragSessionData[fragIndex].FragDecoderProcessStatus = FragDecoderProcess( fragCounter, &mcpsIndication->Buffer[cmdIndex] );
-                    FragSessionData[fragIndex].FragDecoderStatus = FragDecoderGetStatus( );
-                    if( LmhpFragmentationParams->OnProgress != NULL )
-                    {
-                        LmhpFragmentationParams->OnProgress( FragSessionData[fragIndex].FragDecoderStatus.FragNbRx,
-                                                             FragSessionData[fragIndex].FragGroupData.FragNb,
-                                                             FragSessionData[fragIndex].FragGroupData.FragSize,
-                                                             FragSessionData[fragIndex].FragDecoderStatus.FragNbLost );
-                    }
-
-                    if( FragSessionData[fragIndex].FragDecoderProcessStatus >= 0 )
+                    // Decoded by LmhpFragmentationProcess, a fragment dropped
+                    // on a full queue is recovered as a lost one
+                    if( FragDecoderPush( fragCounter, &mcpsIndication->Buffer[cmdIndex] ) == true )
                     {
-                        // Fragmentation successfully done
-                        if( LmhpFragmentationParams->OnDone != NULL )
-                        {
-                            LmhpFragmentationParams->OnDone( FragSessionData[fragIndex].FragDecoderProcessStatus,
-                                                            ( FragSessionData[fragIndex].FragGroupData.FragNb * FragSessionData[fragIndex].FragGroupData.FragSize ) - FragSessionData[fragIndex].FragGroupData.Padding );
-                        }
-                        FragSessionData[fragIndex].FragDecoderProcessStatus = FRAG_SESSION_NOT_STARTED;
+                        LmhpFragmentationPackage.OnPackageProcessEvent();
                     }
                 }
                 cmdIndex += FragSessionData[fragIndex].FragGroupData.FragSize;
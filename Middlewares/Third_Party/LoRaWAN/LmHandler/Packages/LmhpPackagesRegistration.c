@@ -25,6 +25,7 @@
 #include "LmhpFirmwareManagement.h"
 #include "LmHandler.h"
 #include "frag_decoder_if.h"
+#include "timer_if.h"
 
 /* Private typedef -----------------------------------------------------------*/
 
@@ -35,11 +36,18 @@
 /* Private function prototypes -----------------------------------------------*/
 
 /* Private variables ---------------------------------------------------------*/
+/**
+  * @brief Clock synchronization compensates the RTC drift with the RTC smooth calibration
+  */
+static LmhpClockSyncParams_t ClockSyncParams =
+{
+  .SetDriftCompensation = TIMER_IF_SetDriftCompensation,
+};
 
 /* Exported functions ---------------------------------------------------------*/
 LmHandlerErrorStatus_t LmhpPackagesRegistrationInit(void)
 {
-  if (LmHandlerPackageRegister(PACKAGE_ID_CLOCK_SYNC, NULL) != LORAMAC_HANDLER_SUCCESS)
+  if (LmHandlerPackageRegister(PACKAGE_ID_CLOCK_SYNC, &ClockSyncParams) != LORAMAC_HANDLER_SUCCESS)
   {
     return LORAMAC_HANDLER_ERROR;
   }
@@ -32,6 +32,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "LmHandler.h"
 #include "LmhpRemoteMcastSetup.h"
+#include "McSessionScheduler.h"
 #include "mw_log_conf.h"  /* needed for MW_LOG */
 
 /*!
@@ -42,12 +43,22 @@
 #define REMOTE_MCAST_SETUP_ID                       2
 #define REMOTE_MCAST_SETUP_VERSION                  1
 
-typedef enum LmhpRemoteMcastSetupSessionStates_e
-{
-    REMOTE_MCAST_SETUP_SESSION_STATE_IDLE,
-    REMOTE_MCAST_SETUP_SESSION_STATE_START,
-    REMOTE_MCAST_SETUP_SESSION_STATE_STOP,
-}LmhpRemoteMcastSetupSessionStates_t;
+/*!
+ * Class B session timeout unit, the beacon period in seconds
+ */
+#define REMOTE_MCAST_SETUP_BEACON_PERIOD            128
+
+/*!
+ * Length of the McClassCSessionReq and McClassBSessionReq payloads
+ */
+#define REMOTE_MCAST_SETUP_SESSION_REQ_LENGTH       10
+
+/*!
+ * Session answer status bits
+ */
+#define REMOTE_MCAST_SETUP_STATUS_ERROR_MASK        0x1C
+#define REMOTE_MCAST_SETUP_STATUS_START_MISSED      0x10
+#define REMOTE_MCAST_SETUP_STATUS_CONFLICT          0x20 // RFU bit in v1.0.0
 
 /*!
  * Package current context
@@ -56,7 +67,24 @@ typedef struct LmhpRemoteMcastSetupState_s
 {
     bool Initialized;
     bool IsRunning;
-    LmhpRemoteMcastSetupSessionStates_t SessionState;
+    /*!
+     * The sessions changed or reached a boundary, the device class has to be
+     * updated
+     */
+    bool SessionUpdate;
+    /*!
+     * Class required by the sessions the device has switched to
+     */
+    DeviceClass_t SessionClass;
+    /*!
+     * Class the device is put back in once the sessions are over
+     */
+    DeviceClass_t AppClass;
+    /*!
+     * RxC channel put back along with the application class
+     */
+    RxChannelParams_t AppRxCChannel;
+    bool IsAppClassSaved;
     uint8_t DataBufferMaxSize;
     uint8_t *DataBuffer;
 }LmhpRemoteMcastSetupState_t;
@@ -118,15 +146,25 @@ static void LmhpRemoteMcastSetupProcess( void );
  */
 static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndication );
 
-static void OnSessionStartTimer( void *context );
+static void OnSessionTimer( void *context );
 
-static void OnSessionStopTimer( void *context );
+/*!
+ * Sets the RxC channel of the MAC layer before a switch to class C, the MAC
+ * reopens the continuous reception when the device is already in class C
+ *
+ * \param [IN] time Current system time in seconds
+ *
+ * \retval applied Returns false when the MAC layer is busy
+ */
+static bool SetRxCChannel( uint32_t time );
 
 static LmhpRemoteMcastSetupState_t LmhpRemoteMcastSetupState =
 {
     .Initialized = false,
     .IsRunning = false,
-    .SessionState = REMOTE_MCAST_SETUP_SESSION_STATE_IDLE,
+    .SessionUpdate = false,
+    .SessionClass = CLASS_A,
+    .IsAppClassSaved = false,
 };
 
 typedef struct McGroupData_s
@@ -160,19 +198,18 @@ typedef struct McSessionData_s
     uint32_t SessionTime;
     uint8_t SessionTimeout;
     McRxParams_t RxParams;
+    /*!
+     * Class the multicast channel is set up for
+     */
+    DeviceClass_t SessionClass;
 }McSessionData_t;
 
 static McSessionData_t McSessionData[LORAMAC_MAX_MC_CTX];
 
 /*!
- * Session start timer
+ * Next session boundary timer
  */
-static TimerEvent_t SessionStartTimer;
-
-/*!
- * Session start timer
- */
-static TimerEvent_t SessionStopTimer;
+static TimerEvent_t SessionTimer;
 
 static LmhPackage_t LmhpRemoteMcastSetupPackage =
 {
@@ -204,8 +241,7 @@ static void LmhpRemoteMcastSetupInit( void * params, uint8_t *dataBuffer, uint8_
         LmhpRemoteMcastSetupState.DataBufferMaxSize = dataBufferMaxSize;
         LmhpRemoteMcastSetupState.Initialized = true;
         LmhpRemoteMcastSetupState.IsRunning = true;
-        TimerInit( &SessionStartTimer, OnSessionStartTimer );
-        TimerInit( &SessionStopTimer, OnSessionStopTimer );
+        TimerInit( &SessionTimer, OnSessionTimer );
     }
     else
     {
@@ -217,6 +253,10 @@ static void LmhpRemoteMcastSetupInit( void * params, uint8_t *dataBuffer, uint8_
     {
         McSessionData[id].McGroupData.McGroupEnabled = false;
     }
+    McSessionSchedulerInit( );
+    LmhpRemoteMcastSetupState.SessionUpdate = false;
+    LmhpRemoteMcastSetupState.SessionClass = CLASS_A;
+    LmhpRemoteMcastSetupState.IsAppClassSaved = false;
 }
 
 static bool LmhpRemoteMcastSetupIsInitialized( void )
@@ -236,47 +276,250 @@ static bool LmhpRemoteMcastSetupIsRunning( void )
 
 static void LmhpRemoteMcastSetupProcess( void )
 {
-    LmhpRemoteMcastSetupSessionStates_t state;
+    DeviceClass_t required;
+    DeviceClass_t target;
+    DeviceClass_t current = CLASS_A;
+    SysTime_t curTime;
+    uint32_t delay = 0;
+    bool intermediate = false;
+    bool update;
 
     CRITICAL_SECTION_BEGIN( );
-    state = LmhpRemoteMcastSetupState.SessionState;
+    update = LmhpRemoteMcastSetupState.SessionUpdate;
+    LmhpRemoteMcastSetupState.SessionUpdate = false;
     CRITICAL_SECTION_END( );
 
-    switch( state )
+    if( update == false )
+    {
+        return;
+    }
+
+    TimerStop( &SessionTimer );
+    curTime = SysTimeGet( );
+    required = McSessionSchedulerGetClass( curTime.Seconds );
+
+    if( required != LmhpRemoteMcastSetupState.SessionClass )
     {
-        case REMOTE_MCAST_SETUP_SESSION_STATE_START:
-            // Switch to Class C
+        if( LmhpRemoteMcastSetupState.IsAppClassSaved == false )
+        {
+            MibRequestConfirm_t mibReq;
 
-            if ( LmHandlerRequestClass( CLASS_C ) == LORAMAC_HANDLER_SUCCESS )
-            {
-                LmhpRemoteMcastSetupState.SessionState = REMOTE_MCAST_SETUP_SESSION_STATE_IDLE;
+            LmHandlerGetCurrentClass( &LmhpRemoteMcastSetupState.AppClass );
+            mibReq.Type = MIB_RXC_CHANNEL;
+            LoRaMacMibGetRequestConfirm( &mibReq );
+            LmhpRemoteMcastSetupState.AppRxCChannel = mibReq.Param.RxCChannel;
+            LmhpRemoteMcastSetupState.IsAppClassSaved = true;
+        }
+        target = ( required == CLASS_A ) ? LmhpRemoteMcastSetupState.AppClass : required;
 
-                TimerSetValue( &SessionStopTimer, ( 1 << McSessionData[0].SessionTimeout ) * 1000 );
-                TimerStart(&SessionStopTimer);
-            }
-            else
-            {
-                TimerSetValue( &SessionStartTimer, 1000 );
-                TimerStart(&SessionStartTimer);
-            }
-            break;
-        case REMOTE_MCAST_SETUP_SESSION_STATE_STOP:
-            // Switch back to Class A
-            if ( LmHandlerRequestClass( CLASS_A ) == LORAMAC_HANDLER_SUCCESS )
-            {
-                LmhpRemoteMcastSetupState.SessionState = REMOTE_MCAST_SETUP_SESSION_STATE_IDLE;
-            }
-            else
+        LmHandlerGetCurrentClass( &current );
+        if( ( current != target ) && ( current != CLASS_A ) && ( target != CLASS_A ) )
+        {
+            // Class B and class C do not switch to each other, go through class A first
+            target = CLASS_A;
+            intermediate = true;
+        }
+
+        if( ( ( target == CLASS_C ) && ( SetRxCChannel( curTime.Seconds ) == false ) ) ||
+            ( LmHandlerRequestClass( target ) != LORAMAC_HANDLER_SUCCESS ) )
+        {
+            // Retry in 1 second
+            TimerSetValue( &SessionTimer, 1000 );
+            TimerStart( &SessionTimer );
+            return;
+        }
+        if( intermediate == true )
+        {
+            // Intermediate class A, switch to the required class right away
+            LmhpRemoteMcastSetupState.SessionUpdate = true;
+            LmhpRemoteMcastSetupPackage.OnPackageProcessEvent( );
+            return;
+        }
+
+        LmhpRemoteMcastSetupState.SessionClass = required;
+        if( required == CLASS_A )
+        {
+            LmhpRemoteMcastSetupState.IsAppClassSaved = false;
+        }
+        MW_LOG( TS_OFF, VLEVEL_M, "McSession class: %c\r\n", "ABC"[required] );
+    }
+
+    if( McSessionSchedulerGetNextEvent( curTime.Seconds, &delay ) == true )
+    {
+        TimerSetValue( &SessionTimer, delay * 1000 - curTime.SubSeconds );
+        TimerStart( &SessionTimer );
+    }
+}
+
+static bool SetRxCChannel( uint32_t time )
+{
+    MibRequestConfirm_t mibReq;
+    RxChannelParams_t channel = LmhpRemoteMcastSetupState.AppRxCChannel;
+    int8_t datarate;
+
+    // The class C session held, else the channel of the application class C
+    if( McSessionSchedulerGetRxCChannel( time, &channel.Frequency, &datarate ) == true )
+    {
+        channel.Datarate = ( uint8_t )datarate;
+    }
+
+    mibReq.Type = MIB_RXC_CHANNEL;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    if( ( mibReq.Param.RxCChannel.Frequency == channel.Frequency ) &&
+        ( mibReq.Param.RxCChannel.Datarate == channel.Datarate ) )
+    {
+        return true;
+    }
+    if( LoRaMacIsBusy( ) == true )
+    {
+        return false;
+    }
+    mibReq.Param.RxCChannel = channel;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    return true;
+}
+
+/*!
+ * Sets up the multicast channel of a group for a session and applies its
+ * reception parameters
+ *
+ * \param [IN]  id       Multicast group identifier
+ * \param [IN]  devClass Session class
+ * \param [IN]  rxParams Session reception parameters
+ * \param [OUT] status   Session answer status
+ *
+ * \retval valid Returns true when the parameters are applied
+ */
+static bool SetupSessionChannel( uint8_t id, DeviceClass_t devClass, McRxParams_t *rxParams, uint8_t *status )
+{
+    // The channel class is set up along with the keys. Class B channels are
+    // set up for each session to compute the ping slot periodicity.
+    if( ( McSessionData[id].McGroupData.McGroupEnabled == true ) &&
+        ( ( devClass == CLASS_B ) || ( McSessionData[id].SessionClass != devClass ) ) )
+    {
+        McChannelParams_t channel =
+        {
+            .IsRemotelySetup = true,
+            .Class = devClass,
+            .IsEnabled = true,
+            .GroupID = ( AddressIdentifier_t )id,
+            .Address = McSessionData[id].McGroupData.McAddr,
+            .McKeys.McKeyE = McSessionData[id].McGroupData.McKeyEncrypted,
+            .FCountMin = McSessionData[id].McGroupData.McFCountMin,
+            .FCountMax = McSessionData[id].McGroupData.McFCountMax,
+            .RxParams.ClassB = // Frequency and datarate are verified and applied below
             {
-                TimerSetValue( &SessionStopTimer, 1000 );
-                TimerStart(&SessionStopTimer);
+                .Frequency = 0,
+                .Datarate = 0,
+                .Periodicity = ( devClass == CLASS_B ) ? rxParams->ClassB.Periodicity : 0
             }
-            break;
-        case REMOTE_MCAST_SETUP_SESSION_STATE_IDLE:
-            break;
-        default:
-            break;
+        };
+        if( LoRaMacMcChannelSetup( &channel ) == LORAMAC_STATUS_OK )
+        {
+            McSessionData[id].SessionClass = devClass;
+        }
     }
+
+    if( LoRaMacMcChannelSetupRxParams( ( AddressIdentifier_t )id, rxParams, status ) != LORAMAC_STATUS_OK )
+    {
+        return false;
+    }
+    return ( ( *status & REMOTE_MCAST_SETUP_STATUS_ERROR_MASK ) == 0x00 );
+}
+
+/*!
+ * Processes a McClassCSessionReq or a McClassBSessionReq and schedules the
+ * session
+ *
+ * \param [IN]  devClass Session class
+ * \param [IN]  payload  Request payload, REMOTE_MCAST_SETUP_SESSION_REQ_LENGTH bytes
+ * \param [OUT] answer   Answer buffer
+ *
+ * \retval size Answer size
+ */
+static uint8_t ProcessSessionReq( DeviceClass_t devClass, uint8_t *payload, uint8_t *answer )
+{
+    McSessionSchedulerStatus_t schedulerStatus;
+    McRxParams_t rxParams = { 0 };
+    SysTime_t curTime = SysTimeGet( );
+    uint8_t id = payload[0] & 0x03;
+    uint8_t status = id;
+    uint8_t size = 0;
+    uint8_t timeOut = payload[5] & 0x0F;
+    uint32_t sessionTime;
+    uint32_t duration;
+    int32_t timeToSessionStart;
+
+    answer[size++] = ( devClass == CLASS_B ) ? REMOTE_MCAST_SETUP_MC_GROUP_CLASS_B_SESSION_ANS :
+                                               REMOTE_MCAST_SETUP_MC_GROUP_CLASS_C_SESSION_ANS;
+    if( id >= LORAMAC_MAX_MC_CTX )
+    {
+        answer[size++] = status | 0x10; // McGroupUndefined bit set
+        return size;
+    }
+
+    sessionTime =  ( payload[1] << 0  ) & 0x000000FF;
+    sessionTime += ( payload[2] << 8  ) & 0x0000FF00;
+    sessionTime += ( payload[3] << 16 ) & 0x00FF0000;
+    sessionTime += ( payload[4] << 24 ) & 0xFF000000;
+
+    // Add Unix to Gps epoch offset. The system time is based on Unix time.
+    sessionTime += UNIX_GPS_EPOCH_OFFSET;
+
+    // Frequency and datarate are at the same place for both classes
+    rxParams.ClassC.Frequency =  ( payload[6] << 0  ) & 0x000000FF;
+    rxParams.ClassC.Frequency |= ( payload[7] << 8  ) & 0x0000FF00;
+    rxParams.ClassC.Frequency |= ( payload[8] << 16 ) & 0x00FF0000;
+    rxParams.ClassC.Frequency *= 100;
+    rxParams.ClassC.Datarate = payload[9];
+
+    if( devClass == CLASS_B )
+    {
+        rxParams.ClassB.Periodicity = ( payload[5] >> 4 ) & 0x07;
+        duration = ( 1 << timeOut ) * REMOTE_MCAST_SETUP_BEACON_PERIOD;
+    }
+    else
+    {
+        duration = 1 << timeOut;
+    }
+
+    schedulerStatus = McSessionSchedulerAdd( id, devClass, sessionTime, duration, rxParams.ClassC.Frequency,
+                                             rxParams.ClassC.Datarate, curTime.Seconds );
+    if( schedulerStatus == MC_SESSION_SCHEDULER_CONFLICT )
+    {
+        status |= REMOTE_MCAST_SETUP_STATUS_CONFLICT;
+        MW_LOG( TS_OFF, VLEVEL_M, "McSession %d conflicts with another group\r\n", id );
+    }
+    else if( schedulerStatus != MC_SESSION_SCHEDULER_OK )
+    {
+        // Session start time before current device time
+        status |= REMOTE_MCAST_SETUP_STATUS_START_MISSED;
+    }
+    else if( SetupSessionChannel( id, devClass, &rxParams, &status ) == false )
+    {
+        McSessionSchedulerRemove( id );
+    }
+    else
+    {
+        McSessionData[id].SessionTime = sessionTime;
+        McSessionData[id].SessionTimeout = timeOut;
+        McSessionData[id].RxParams = rxParams;
+
+        LmhpRemoteMcastSetupState.SessionUpdate = true;
+        LmhpRemoteMcastSetupPackage.OnPackageProcessEvent( );
+    }
+
+    answer[size++] = status;
+    if( ( status & ( REMOTE_MCAST_SETUP_STATUS_ERROR_MASK | REMOTE_MCAST_SETUP_STATUS_CONFLICT ) ) == 0x00 )
+    {
+        timeToSessionStart = sessionTime - curTime.Seconds;
+        MW_LOG( TS_OFF, VLEVEL_M, "Time2SessionStart: %d ms\r\n", timeToSessionStart * 1000 );
+
+        answer[size++] = ( timeToSessionStart >> 0 ) & 0xFF;
+        answer[size++] = ( timeToSessionStart >> 8 ) & 0xFF;
+        answer[size++] = ( timeToSessionStart >> 16 ) & 0xFF;
+    }
+    return size;
 }
 
 static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndication )
@@ -337,6 +580,14 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
             case REMOTE_MCAST_SETUP_MC_GROUP_SETUP_REQ:
             {
                 id = mcpsIndication->Buffer[cmdIndex++] & 0x03;
+                if( id >= LORAMAC_MAX_MC_CTX )
+                {
+                    // Group not supported, skip the McAddr, McKey_encrypted, minMcFCount and maxMcFCount fields
+                    cmdIndex += 28;
+                    LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = REMOTE_MCAST_SETUP_MC_GROUP_SETUP_ANS;
+                    LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = ( 0x01 << 2 ) | id;
+                    break;
+                }
                 McSessionData[id].McGroupData.IdHeader.Value = id;
 
                 McSessionData[id].McGroupData.McAddr =  ( mcpsIndication->Buffer[cmdIndex++] << 0  ) & 0x000000FF;
@@ -380,7 +631,12 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
                 {
                     idError = 0x00;
                     McSessionData[id].McGroupData.McGroupEnabled = true;
+                    McSessionData[id].SessionClass = CLASS_C;
                 }
+                // A new group setup cancels the session of the former one
+                McSessionSchedulerRemove( id );
+                LmhpRemoteMcastSetupState.SessionUpdate = true;
+                LmhpRemoteMcastSetupPackage.OnPackageProcessEvent( );
                 LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = REMOTE_MCAST_SETUP_MC_GROUP_SETUP_ANS;
                 LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = ( idError << 2 ) | McSessionData[id].McGroupData.IdHeader.Fields.McGroupId;
                 break;
@@ -391,13 +647,20 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
                 id = mcpsIndication->Buffer[cmdIndex++] & 0x03;
 
                 status = id;
+                LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = REMOTE_MCAST_SETUP_MC_GROUP_DELETE_ANS;
+                if( id >= LORAMAC_MAX_MC_CTX )
+                {
+                    LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = status | 0x04; // McGroupUndefined bit set
+                    break;
+                }
                 McSessionData[id].McGroupData.IdHeader.Value = 0;
                 McSessionData[id].McGroupData.McAddr = 0;
                 UTIL_MEM_set_8( McSessionData[id].McGroupData.McKeyEncrypted, 0x00, 16 );
                 McSessionData[id].McGroupData.McFCountMin = 0;
                 McSessionData[id].McGroupData.McFCountMax = 0;
-
-                LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = REMOTE_MCAST_SETUP_MC_GROUP_DELETE_ANS;
+                McSessionSchedulerRemove( id );
+                LmhpRemoteMcastSetupState.SessionUpdate = true;
+                LmhpRemoteMcastSetupPackage.OnPackageProcessEvent( );
 
                 if( LoRaMacMcChannelDelete( ( AddressIdentifier_t )id ) != LORAMAC_STATUS_OK )
                 {
@@ -412,60 +675,18 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
             }
             case REMOTE_MCAST_SETUP_MC_GROUP_CLASS_C_SESSION_REQ:
             {
-                uint8_t status = 0x00;
-                int32_t timeToSessionStart = 0;
-                id = mcpsIndication->Buffer[cmdIndex++] & 0x03;
-
-                McSessionData[id].SessionTime =  ( mcpsIndication->Buffer[cmdIndex++] << 0  ) & 0x000000FF;
-                McSessionData[id].SessionTime += ( mcpsIndication->Buffer[cmdIndex++] << 8  ) & 0x0000FF00;
-                McSessionData[id].SessionTime += ( mcpsIndication->Buffer[cmdIndex++] << 16 ) & 0x00FF0000;
-                McSessionData[id].SessionTime += ( mcpsIndication->Buffer[cmdIndex++] << 24 ) & 0xFF000000;
-
-                // Add Unix to Gps epoch offset. The system time is based on Unix time.
-                McSessionData[id].SessionTime += UNIX_GPS_EPOCH_OFFSET;
-
-                McSessionData[id].SessionTimeout =  mcpsIndication->Buffer[cmdIndex++] & 0x0F;
-
-                McSessionData[id].RxParams.ClassC.Frequency =  ( mcpsIndication->Buffer[cmdIndex++] << 0  ) & 0x000000FF;
-                McSessionData[id].RxParams.ClassC.Frequency |= ( mcpsIndication->Buffer[cmdIndex++] << 8  ) & 0x0000FF00;
-                McSessionData[id].RxParams.ClassC.Frequency |= ( mcpsIndication->Buffer[cmdIndex++] << 16 ) & 0x00FF0000;
-                McSessionData[id].RxParams.ClassC.Frequency *= 100;
-
-                McSessionData[id].RxParams.ClassC.Datarate = mcpsIndication->Buffer[cmdIndex++];
-
-                LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = REMOTE_MCAST_SETUP_MC_GROUP_CLASS_C_SESSION_ANS;
-                if( LoRaMacMcChannelSetupRxParams( ( AddressIdentifier_t )id, &McSessionData[id].RxParams, &status ) == LORAMAC_STATUS_OK )
-                {
-                    SysTime_t curTime = { .Seconds = 0, .SubSeconds = 0 };
-                    curTime = SysTimeGet( );
-
-                    timeToSessionStart = McSessionData[id].SessionTime - curTime.Seconds;
-                    if( timeToSessionStart > 0 )
-                    {
-                        // Start session start timer
-                        TimerSetValue( &SessionStartTimer, timeToSessionStart * 1000 );
-                        TimerStart( &SessionStartTimer );
-
-                        MW_LOG(TS_OFF, VLEVEL_M, "Time2SessionStart: %d ms\r\n", timeToSessionStart * 1000);
-                    }
-                    else
-                    {
-                        // Session start time before current device time
-                        status |= 0x10;
-                    }
-                }
-                LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = status;
-                if( status == 0x00 )
-                {
-                    LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = (timeToSessionStart >> 0) & 0xFF;
-                    LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = (timeToSessionStart >> 8) & 0xFF;
-                    LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = (timeToSessionStart >> 16) & 0xFF;
-                }
+                id = mcpsIndication->Buffer[cmdIndex] & 0x03;
+                dataBufferIndex += ProcessSessionReq( CLASS_C, &mcpsIndication->Buffer[cmdIndex],
+                                                      &LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex] );
+                cmdIndex += REMOTE_MCAST_SETUP_SESSION_REQ_LENGTH;
                 break;
             }
             case REMOTE_MCAST_SETUP_MC_GROUP_CLASS_B_SESSION_REQ:
             {
-                // implement command prosessing and handling
+                id = mcpsIndication->Buffer[cmdIndex] & 0x03;
+                dataBufferIndex += ProcessSessionReq( CLASS_B, &mcpsIndication->Buffer[cmdIndex],
+                                                      &LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex] );
+                cmdIndex += REMOTE_MCAST_SETUP_SESSION_REQ_LENGTH;
                 break;
             }
             default:
@@ -515,16 +736,9 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
     }
 }
 
-static void OnSessionStartTimer( void *context )
-{
-    TimerStop( &SessionStartTimer );
-    LmhpRemoteMcastSetupState.SessionState = REMOTE_MCAST_SETUP_SESSION_STATE_START;
-    LmhpRemoteMcastSetupPackage.OnPackageProcessEvent();
-}
-
-static void OnSessionStopTimer( void *context )
+static void OnSessionTimer( void *context )
 {
-    TimerStop( &SessionStopTimer );
-    LmhpRemoteMcastSetupState.SessionState = REMOTE_MCAST_SETUP_SESSION_STATE_STOP;
+    TimerStop( &SessionTimer );
+    LmhpRemoteMcastSetupState.SessionUpdate = true;
     LmhpRemoteMcastSetupPackage.OnPackageProcessEvent();
 }
@@ -0,0 +1,203 @@
+/*!
+ * \file      McSessionScheduler.c
+ *
+ * \brief     Multicast session scheduler of the remote multicast setup
+ *            package
+ */
+#include <stddef.h>
+
+#include "McSessionScheduler.h"
+
+/*!
+ * Scheduled session of a multicast group
+ */
+typedef struct McSession_s
+{
+    bool Scheduled;
+    DeviceClass_t Class;
+    uint32_t Start;
+    uint32_t Stop;
+    uint32_t Frequency;
+    int8_t Datarate;
+}McSession_t;
+
+static McSession_t McSessions[LORAMAC_MAX_MC_CTX];
+
+/*!
+ * \brief Checks if two sessions are closer than the merge gap, the device
+ *        then holds the class from one to the other
+ */
+static bool IsMerged( McSession_t *a, McSession_t *b )
+{
+    return ( ( a->Start <= ( b->Stop + MC_SESSION_SCHEDULER_MERGE_GAP ) ) &&
+             ( b->Start <= ( a->Stop + MC_SESSION_SCHEDULER_MERGE_GAP ) ) );
+}
+
+/*!
+ * \brief Checks if two sessions can be served at the same time, or one
+ *        after the other without a class switch
+ */
+static bool IsCompatible( McSession_t *a, McSession_t *b )
+{
+    if( a->Class != b->Class )
+    {
+        return false;
+    }
+    if( ( a->Class == CLASS_C ) && ( ( a->Frequency != b->Frequency ) || ( a->Datarate != b->Datarate ) ) )
+    {
+        return false;
+    }
+    return true;
+}
+
+void McSessionSchedulerInit( void )
+{
+    for( uint8_t id = 0; id < LORAMAC_MAX_MC_CTX; id++ )
+    {
+        McSessions[id].Scheduled = false;
+    }
+}
+
+McSessionSchedulerStatus_t McSessionSchedulerAdd( uint8_t id, DeviceClass_t devClass, uint32_t start, uint32_t duration,
+                                                  uint32_t frequency, int8_t datarate, uint32_t now )
+{
+    McSession_t session =
+    {
+        .Scheduled = true,
+        .Class = devClass,
+        .Start = start,
+        .Stop = start + duration,
+        .Frequency = frequency,
+        .Datarate = datarate
+    };
+
+    if( ( id >= LORAMAC_MAX_MC_CTX ) || ( ( devClass != CLASS_B ) && ( devClass != CLASS_C ) ) || ( duration == 0 ) )
+    {
+        return MC_SESSION_SCHEDULER_ERROR;
+    }
+    if( start <= now )
+    {
+        return MC_SESSION_SCHEDULER_START_MISSED;
+    }
+
+    for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++ )
+    {
+        if( ( i == id ) || ( McSessions[i].Scheduled == false ) || ( McSessions[i].Stop <= now ) )
+        {
+            continue;
+        }
+        if( IsCompatible( &session, &McSessions[i] ) == true )
+        {
+            continue;
+        }
+        // The RxC channel is applied when the device switches to class C,
+        // class C sessions held together share it
+        if( ( ( session.Start < McSessions[i].Stop ) && ( McSessions[i].Start < session.Stop ) ) ||
+            ( ( session.Class == CLASS_C ) && ( McSessions[i].Class == CLASS_C ) &&
+              ( IsMerged( &session, &McSessions[i] ) == true ) ) )
+        {
+            return MC_SESSION_SCHEDULER_CONFLICT;
+        }
+    }
+
+    McSessions[id] = session;
+    return MC_SESSION_SCHEDULER_OK;
+}
+
+void McSessionSchedulerRemove( uint8_t id )
+{
+    if( id < LORAMAC_MAX_MC_CTX )
+    {
+        McSessions[id].Scheduled = false;
+    }
+}
+
+/*!
+ * \brief Gets the session which holds the device class
+ *
+ * \param [IN] time System time in seconds
+ *
+ * \retval session Session in progress, or session before a short gap to a
+ *                 compatible one, NULL when none
+ */
+static McSession_t* GetHeldSession( uint32_t time )
+{
+    for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++ )
+    {
+        if( ( McSessions[i].Scheduled == true ) && ( McSessions[i].Start <= time ) && ( time < McSessions[i].Stop ) )
+        {
+            return &McSessions[i];
+        }
+    }
+
+    // Hold the class over short gaps between compatible sessions
+    for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++ )
+    {
+        if( ( McSessions[i].Scheduled == false ) || ( McSessions[i].Stop > time ) )
+        {
+            continue;
+        }
+        for( uint8_t j = 0; j < LORAMAC_MAX_MC_CTX; j++ )
+        {
+            if( ( McSessions[j].Scheduled == true ) && ( IsCompatible( &McSessions[j], &McSessions[i] ) == true ) &&
+                ( time < McSessions[j].Start ) && ( ( McSessions[j].Start - McSessions[i].Stop ) <= MC_SESSION_SCHEDULER_MERGE_GAP ) )
+            {
+                return &McSessions[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+DeviceClass_t McSessionSchedulerGetClass( uint32_t time )
+{
+    McSession_t *session = GetHeldSession( time );
+
+    return ( session != NULL ) ? session->Class : CLASS_A;
+}
+
+bool McSessionSchedulerGetRxCChannel( uint32_t time, uint32_t *frequency, int8_t *datarate )
+{
+    McSession_t *session = GetHeldSession( time );
+
+    if( ( session == NULL ) || ( session->Class != CLASS_C ) )
+    {
+        return false;
+    }
+    *frequency = session->Frequency;
+    *datarate = session->Datarate;
+    return true;
+}
+
+bool McSessionSchedulerGetNextEvent( uint32_t now, uint32_t *delay )
+{
+    DeviceClass_t current = McSessionSchedulerGetClass( now );
+    bool pending = false;
+    uint32_t next = 0;
+
+    // The required class only changes at a session boundary
+    for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++ )
+    {
+        uint32_t boundaries[2] = { McSessions[i].Start, McSessions[i].Stop };
+
+        if( McSessions[i].Scheduled == false )
+        {
+            continue;
+        }
+        for( uint8_t k = 0; k < 2; k++ )
+        {
+            if( ( boundaries[k] > now ) && ( ( pending == false ) || ( boundaries[k] < next ) ) &&
+                ( McSessionSchedulerGetClass( boundaries[k] ) != current ) )
+            {
+                next = boundaries[k];
+                pending = true;
+            }
+        }
+    }
+
+    if( ( pending == true ) && ( delay != NULL ) )
+    {
+        *delay = next - now;
+    }
+    return pending;
+}
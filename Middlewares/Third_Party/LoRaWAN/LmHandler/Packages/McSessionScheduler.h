@@ -0,0 +1,129 @@
+/*!
+ * \file      McSessionScheduler.h
+ *
+ * \brief     Multicast session scheduler of the remote multicast setup
+ *            package
+ *
+ * \details   Keeps one Class B or Class C session per multicast group, each
+ *            with its start and stop times in system (Unix) seconds, and
+ *            derives from them the device class required at any time.
+ *
+ *            Sessions of the same class that overlap, or are separated by
+ *            at most MC_SESSION_SCHEDULER_MERGE_GAP seconds, are merged so
+ *            the device class is switched once for the whole sequence.
+ *
+ *            A session overlapping a session of another class cannot be
+ *            served and is rejected as a conflict. Class C sessions also
+ *            conflict when they overlap or would be merged but use
+ *            different frequencies or datarates: the MAC layer has a single
+ *            RxC window, its channel is applied on the switch to class C.
+ */
+#ifndef __MC_SESSION_SCHEDULER_H__
+#define __MC_SESSION_SCHEDULER_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "LoRaMacTypes.h"
+
+/*!
+ * Largest gap, in seconds, between two sessions of the same class for
+ * which the device stays in that class
+ */
+#ifndef MC_SESSION_SCHEDULER_MERGE_GAP
+#define MC_SESSION_SCHEDULER_MERGE_GAP              10
+#endif
+
+/*!
+ * McSessionSchedulerAdd return status
+ */
+typedef enum McSessionSchedulerStatus_e
+{
+    /*!
+     * Session scheduled
+     */
+    MC_SESSION_SCHEDULER_OK,
+    /*!
+     * Session start time is in the past
+     */
+    MC_SESSION_SCHEDULER_START_MISSED,
+    /*!
+     * Session overlaps an incompatible session of another group
+     */
+    MC_SESSION_SCHEDULER_CONFLICT,
+    /*!
+     * Invalid group identifier or class
+     */
+    MC_SESSION_SCHEDULER_ERROR,
+}McSessionSchedulerStatus_t;
+
+/*!
+ * \brief Clears all the sessions
+ */
+void McSessionSchedulerInit( void );
+
+/*!
+ * \brief Schedules a session, it replaces the one of the group if any
+ *
+ * \param [IN] id        Multicast group identifier
+ * \param [IN] devClass  Session class, CLASS_B or CLASS_C
+ * \param [IN] start     Session start time in seconds
+ * \param [IN] duration  Session duration in seconds
+ * \param [IN] frequency Session downlink frequency in Hz
+ * \param [IN] datarate  Session downlink datarate
+ * \param [IN] now       Current system time in seconds
+ *
+ * \retval status Returns MC_SESSION_SCHEDULER_OK when the session is
+ *                scheduled. It is not on any other status.
+ */
+McSessionSchedulerStatus_t McSessionSchedulerAdd( uint8_t id, DeviceClass_t devClass, uint32_t start, uint32_t duration,
+                                                  uint32_t frequency, int8_t datarate, uint32_t now );
+
+/*!
+ * \brief Cancels the session of a group
+ *
+ * \param [IN] id Multicast group identifier
+ */
+void McSessionSchedulerRemove( uint8_t id );
+
+/*!
+ * \brief Gets the device class required by the sessions
+ *
+ * \param [IN] time System time in seconds
+ *
+ * \retval class CLASS_B or CLASS_C while a session is held, CLASS_A
+ *               otherwise
+ */
+DeviceClass_t McSessionSchedulerGetClass( uint32_t time );
+
+/*!
+ * \brief Gets the RxC channel of the class C session held
+ *
+ * \param [IN]  time      System time in seconds
+ * \param [OUT] frequency Session downlink frequency in Hz
+ * \param [OUT] datarate  Session downlink datarate
+ *
+ * \retval held Returns false when no class C session is held
+ */
+bool McSessionSchedulerGetRxCChannel( uint32_t time, uint32_t *frequency, int8_t *datarate );
+
+/*!
+ * \brief Gets the delay to the next change of the required device class
+ *
+ * \param [IN]  now   Current system time in seconds
+ * \param [OUT] delay Delay to the next change in seconds
+ *
+ * \retval pending Returns false when no change is scheduled
+ */
+bool McSessionSchedulerGetNextEvent( uint32_t now, uint32_t *delay );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MC_SESSION_SCHEDULER_H__
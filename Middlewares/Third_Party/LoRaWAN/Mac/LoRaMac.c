@@ -54,6 +54,9 @@
 #include "LoRaMacCommands.h"
 #include "LoRaMacAdr.h"
 #include "LoRaMacSerializer.h"
+#include "LoRaMacProfile.h"
+#include "LoRaMacEnergy.h"
+#include "drbg.h"
 #include "radio.h"
 
 #include "LoRaMac.h"
@@ -76,6 +79,15 @@
  */
 #define LORA_MAC_COMMAND_MAX_FOPTS_LENGTH           15
 
+/*!
+ * Position of the FRMPayload field in PktBuffer for a frame without FOpts.
+ * MAC commands sent on port 0 are serialized there and then encrypted and
+ * serialized in place.
+ */
+#define LORAMAC_FRAME_PAYLOAD_NO_FOPTS_OFFSET       ( LORAMAC_MHDR_FIELD_SIZE + LORAMAC_FHDR_DEV_ADDR_FIELD_SIZE + \
+                                                      LORAMAC_FHDR_F_CTRL_FIELD_SIZE + LORAMAC_FHDR_F_CNT_FIELD_SIZE + \
+                                                      LORAMAC_F_PORT_FIELD_SIZE )
+
 /*!
  * LoRaMac duty cycle for the back-off procedure during the first hour.
  */
@@ -91,6 +103,12 @@
  */
 #define BACKOFF_DC_24_HOURS                         10000
 
+/*!
+ * Number of radio random values mixed into the random generator when it is
+ * seeded or reseeded
+ */
+#define RADIO_ENTROPY_WORDS                         8
+
 /*!
  * LoRaMac internal states
  */
@@ -104,6 +122,7 @@ enum eLoRaMacState
     LORAMAC_TX_DELAYED    = 0x00000020,
     LORAMAC_TX_CONFIG     = 0x00000040,
     LORAMAC_RX_ABORT      = 0x00000080,
+    LORAMAC_TX_LBT        = 0x00000100,
 };
 
 /*
@@ -180,6 +199,12 @@ typedef struct sLoRaMacCtx
     RxConfigParams_t RxWindow1Config;
     RxConfigParams_t RxWindow2Config;
     RxConfigParams_t RxWindowCConfig;
+    /*
+    * Set when the radio already holds the Rx window configuration. The window
+    * timer event then only has to wake up the radio and start the reception.
+    */
+    bool RxWindow1Prepared;
+    bool RxWindow2Prepared;
     /*
      * Limit of uplinks without any donwlink response before the ADRACKReq bit will be set.
      */
@@ -259,9 +284,13 @@ typedef struct sLoRaMacCtx
     */
     TimerTime_t DutyCycleWaitTime;
     /*
-     * Buffer containing the MAC layer commands
-     */
-    uint8_t MacCommandsBuffer[LORA_MAC_COMMAND_MAX_LENGTH];
+    * Listen before talk candidates of the pending uplink
+    */
+    LbtScan_t LbtScan;
+    /*
+    * Listen before talk result, index of the first free candidate or -1
+    */
+    int8_t LbtFreeIndex;
 }LoRaMacCtx_t;
 
 /*
@@ -284,6 +313,7 @@ typedef union uLoRaMacRadioEvents
         uint32_t TxTimeout : 1;
         uint32_t RxDone    : 1;
         uint32_t TxDone    : 1;
+        uint32_t ChannelScanDone : 1;
     }Events;
 }LoRaMacRadioEvents_t;
 
@@ -323,11 +353,23 @@ static void OnRadioRxError( void );
  */
 static void OnRadioRxTimeout( void );
 
+/*!
+ * \brief Function executed on Radio channel scan done event
+ */
+static void OnRadioChannelScanDone( int8_t index );
+
 /*!
  * \brief Function executed on duty cycle delayed Tx  timer event
  */
 static void OnTxDelayedTimerEvent( void* context );
 
+/*!
+ * \brief Seeds the random generator with radio noise
+ *
+ * \remark Reconfigures the radio, only call it while the radio is not in use
+ */
+static void GatherRadioEntropy( void );
+
 /*!
  * \brief Function executed on first Rx window timer event
  */
@@ -519,8 +561,32 @@ static void ResetMacParameters( void );
  *
  * \param [IN] rxTimer  Window timer to be topped.
  * \param [IN] rxConfig Window parameters to be setup
+ * \param [IN] prepared Radio already configured by RxWindowPrepare
+ */
+static void RxWindowSetup( TimerEvent_t* rxTimer, RxConfigParams_t* rxConfig, bool prepared );
+
+/*!
+ * \brief Configures the radio for an upcoming reception window
+ *
+ * \remark The radio keeps its configuration in warm sleep mode. Doing the
+ *         configuration while the radio is still awake leaves only the
+ *         reception start to the window timer event.
+ *
+ * \param [IN] rxConfig Window parameters to be setup
+ *
+ * \retval true if the radio is configured
+ */
+static bool RxWindowPrepare( RxConfigParams_t* rxConfig );
+
+/*!
+ * \brief Updates the Rx1 window parameters from the current MAC context
+ */
+static void UpdateRxWindow1Config( void );
+
+/*!
+ * \brief Updates the Rx2 window parameters from the current MAC context
  */
-static void RxWindowSetup( TimerEvent_t* rxTimer, RxConfigParams_t* rxConfig );
+static void UpdateRxWindow2Config( void );
 
 /*!
  * \brief Opens up a continuous RX C window. This is used for
@@ -692,6 +758,7 @@ static void OnRadioTxDone( void )
 
 static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr )
 {
+    LORAMAC_PROFILE_START( );
     RxDoneParams.LastRxDone = TimerGetCurrentTime( );
     RxDoneParams.Payload = payload;
     RxDoneParams.Size = size;
@@ -739,6 +806,17 @@ static void OnRadioRxTimeout( void )
     MW_LOG(TS_ON, VLEVEL_M, "MAC rxTimeOut\r\n" );
 }
 
+static void OnRadioChannelScanDone( int8_t index )
+{
+    MacCtx.LbtFreeIndex = index;
+    LoRaMacRadioEvents.Events.ChannelScanDone = 1;
+
+    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+    {
+        MacCtx.MacCallbacks->MacProcessNotify( );
+    }
+}
+
 static void UpdateRxSlotIdleState( void )
 {
     if( Nvm.MacGroup2.DeviceClass != CLASS_C )
@@ -756,22 +834,36 @@ static void ProcessRadioTxDone( void )
     GetPhyParams_t getPhy;
     PhyParam_t phyParam;
     SetBandTxDoneParams_t txDone;
+    TimerTime_t offset;
+
+    MacCtx.RxWindow1Prepared = false;
+    MacCtx.RxWindow2Prepared = false;
 
     if( Nvm.MacGroup2.DeviceClass != CLASS_C )
     {
+        if( ( Nvm.MacGroup2.DeviceClass == CLASS_A ) && ( LoRaMacClassBIsAcquisitionInProgress( ) == false ) )
+        {
+            // Configure the Rx1 window while the radio is still awake
+            UpdateRxWindow1Config( );
+            MacCtx.RxWindow1Prepared = RxWindowPrepare( &MacCtx.RxWindow1Config );
+        }
         Radio.Sleep( );
     }
-    // Setup timers
-    TimerSetValue( &MacCtx.RxWindowTimer1, MacCtx.RxWindow1Delay );
+    // Setup timers, the delays count from the TX done interrupt, not from
+    // this deferred processing nor from the window preparation above
+    CRITICAL_SECTION_BEGIN( );
+    offset = MIN( TimerGetElapsedTime( TxDoneParams.CurTime ), MacCtx.RxWindow1Delay );
+    TimerSetValue( &MacCtx.RxWindowTimer1, MacCtx.RxWindow1Delay - offset );
     TimerStart( &MacCtx.RxWindowTimer1 );
-    TimerSetValue( &MacCtx.RxWindowTimer2, MacCtx.RxWindow2Delay );
+    TimerSetValue( &MacCtx.RxWindowTimer2, MacCtx.RxWindow2Delay - offset );
     TimerStart( &MacCtx.RxWindowTimer2 );
+    CRITICAL_SECTION_END( );
 
     if( ( Nvm.MacGroup2.DeviceClass == CLASS_C ) || ( MacCtx.NodeAckRequested == true ) )
     {
         getPhy.Attribute = PHY_ACK_TIMEOUT;
         phyParam = RegionGetPhyParam( Nvm.MacGroup2.Region, &getPhy );
-        TimerSetValue( &MacCtx.AckTimeoutTimer, MacCtx.RxWindow2Delay + phyParam.Value );
+        TimerSetValue( &MacCtx.AckTimeoutTimer, MacCtx.RxWindow2Delay + phyParam.Value - offset );
         TimerStart( &MacCtx.AckTimeoutTimer );
     }
 
@@ -799,6 +891,7 @@ static void ProcessRadioTxDone( void )
 
 static void PrepareRxDoneAbort( void )
 {
+    LORAMAC_PROFILE_ABORT( );
     MacCtx.MacState |= LORAMAC_RX_ABORT;
 
     if( MacCtx.NodeAckRequested == true )
@@ -851,12 +944,15 @@ static void ProcessRadioRxDone( void )
     MacCtx.McpsIndication.DevAddress = 0;
     MacCtx.McpsIndication.DeviceTimeAnsReceived = false;
 
+    LORAMAC_PROFILE_MARK( LORAMAC_PROFILE_DISPATCH );
+
     Radio.Sleep( );
     TimerStop( &MacCtx.RxWindowTimer2 );
 
     // This function must be called even if we are not in class b mode yet.
-    if( LoRaMacClassBRxBeacon( payload, size ) == true )
+    if( LoRaMacClassBRxBeacon( payload, size, RxDoneParams.LastRxDone ) == true )
     {
+        LORAMAC_PROFILE_ABORT( );
         MacCtx.MlmeIndication.BeaconInfo.Rssi = rssi;
         MacCtx.MlmeIndication.BeaconInfo.Snr = snr;
         return;
@@ -883,6 +979,8 @@ static void ProcessRadioRxDone( void )
     switch( macHdr.Bits.MType )
     {
         case FRAME_TYPE_JOIN_ACCEPT:
+            // Only data downlinks are profiled
+            LORAMAC_PROFILE_ABORT( );
             // Check if the received frame size is valid
             if( size < LORAMAC_JOIN_ACCEPT_FRAME_MIN_SIZE )
             {
@@ -1031,6 +1129,8 @@ static void ProcessRadioRxDone( void )
                 return;
             }
 
+            LORAMAC_PROFILE_MARK( LORAMAC_PROFILE_PARSE );
+
             // Get maximum allowed counter difference
             getPhy.Attribute = PHY_MAX_FCNT_GAP;
             phyParam = RegionGetPhyParam( Nvm.MacGroup2.Region, &getPhy );
@@ -1063,6 +1163,8 @@ static void ProcessRadioRxDone( void )
                 return;
             }
 
+            LORAMAC_PROFILE_MARK( LORAMAC_PROFILE_FCNT );
+
             macCryptoStatus = LoRaMacCryptoUnsecureMessage( addrID, address, fCntID, downLinkCounter, &macMsgData );
             if( macCryptoStatus != LORAMAC_CRYPTO_SUCCESS )
             {
@@ -1080,6 +1182,8 @@ static void ProcessRadioRxDone( void )
                 return;
             }
 
+            LORAMAC_PROFILE_MARK( LORAMAC_PROFILE_CRYPTO );
+
             // Frame is valid
             MacCtx.McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_OK;
             MacCtx.McpsIndication.Multicast = multicast;
@@ -1189,12 +1293,15 @@ static void ProcessRadioRxDone( void )
                     break;
             }
 
+            LORAMAC_PROFILE_MARK( LORAMAC_PROFILE_MAC_COMMANDS );
+
             // Provide always an indication, skip the callback to the user application,
             // in case of a confirmed downlink retransmission.
             MacCtx.MacFlags.Bits.McpsInd = 1;
 
             break;
         case FRAME_TYPE_PROPRIETARY:
+            LORAMAC_PROFILE_ABORT( );
             memcpy1( MacCtx.RxPayload, &payload[pktHeaderLen], size - pktHeaderLen );
 
             MacCtx.McpsIndication.McpsIndication = MCPS_PROPRIETARY;
@@ -1247,12 +1354,54 @@ static void ProcessRadioTxTimeout( void )
     MacCtx.MacFlags.Bits.MacDone = 1;
 }
 
+static void ProcessRadioChannelScanDone( void )
+{
+    LoRaMacEventInfoStatus_t eventInfoStatus = LORAMAC_EVENT_INFO_STATUS_NO_FREE_CHANNEL;
+
+    MacCtx.MacState &= ~LORAMAC_TX_LBT;
+
+    if( MacCtx.LbtFreeIndex >= 0 )
+    {
+        // Transmit on the first free candidate
+        MacCtx.Channel = MacCtx.LbtScan.Channels[MacCtx.LbtFreeIndex];
+        if( SendFrameOnChannel( MacCtx.Channel ) == LORAMAC_STATUS_OK )
+        {
+            return;
+        }
+        eventInfoStatus = LORAMAC_EVENT_INFO_STATUS_ERROR;
+    }
+
+    // The frame was neither secured nor sent. Complete the request
+    // without further transmissions, as the blocking carrier sense did
+    // by failing the request
+    MacCtx.McpsConfirm.Status = eventInfoStatus;
+    LoRaMacConfirmQueueSetStatusCmn( eventInfoStatus );
+    if( MacCtx.NodeAckRequested == true )
+    {
+        MacCtx.AckTimeoutRetry = true;
+        MacCtx.AckTimeoutRetriesCounter = MacCtx.AckTimeoutRetries;
+    }
+    else
+    {
+        MacCtx.ChannelsNbTransCounter = Nvm.MacGroup2.MacParams.ChannelsNbTrans;
+    }
+    MacCtx.MacFlags.Bits.MacDone = 1;
+}
+
 static void HandleRadioRxErrorTimeout( LoRaMacEventInfoStatus_t rx1EventInfoStatus, LoRaMacEventInfoStatus_t rx2EventInfoStatus )
 {
     bool classBRx = false;
 
     if( Nvm.MacGroup2.DeviceClass != CLASS_C )
     {
+        if( ( Nvm.MacGroup2.DeviceClass == CLASS_A ) && ( LoRaMacClassBIsAcquisitionInProgress( ) == false ) &&
+            ( MacCtx.RxSlot == RX_SLOT_WIN_1 ) &&
+            ( TimerGetElapsedTime( Nvm.MacGroup1.LastTxDoneTime ) < MacCtx.RxWindow2Delay ) )
+        {
+            // Rx2 window follows, configure it before the radio goes to sleep
+            UpdateRxWindow2Config( );
+            MacCtx.RxWindow2Prepared = RxWindowPrepare( &MacCtx.RxWindow2Config );
+        }
         Radio.Sleep( );
     }
 
@@ -1353,6 +1502,10 @@ static void LoRaMacHandleIrqEvents( void )
         {
             ProcessRadioRxTimeout( );
         }
+        if( events.Events.ChannelScanDone == 1 )
+        {
+            ProcessRadioChannelScanDone( );
+        }
     }
 }
 
@@ -1393,6 +1546,9 @@ static void LoRaMacHandleRequestEvents( void )
         // Allow requests again
         LoRaMacEnableRequests( LORAMAC_REQUEST_HANDLING_ON );
 
+        // Close the energy ledger of the uplink before its confirm
+        LORAMAC_ENERGY_UPLINK_END( );
+
         // Handle callbacks
         if( reqEvents.Bits.McpsReq == 1 )
         {
@@ -1660,15 +1816,37 @@ void LoRaMacProcess( void )
         LoRaMacHandleRequestEvents( );
         LoRaMacHandleScheduleUplinkEvent( );
         LoRaMacHandleNvm( &Nvm );
+        LORAMAC_PROFILE_MARK( LORAMAC_PROFILE_NVM );
         LoRaMacEnableRequests( LORAMAC_REQUEST_HANDLING_ON );
     }
     LoRaMacHandleIndicationEvents( );
+    // The measurement ends with the application indication, a frame not
+    // indicated to the application is not accounted
+    LORAMAC_PROFILE_ABORT( );
+    if( ( MacCtx.MacState == LORAMAC_IDLE ) && ( Nvm.MacGroup2.DeviceClass == CLASS_A ) &&
+        ( LoRaMacClassBIsAcquisitionInProgress( ) == false ) && ( DrbgIsReseedRequired( ) == true ) )
+    {
+        // Fresh radio noise while the radio is not in use
+        GatherRadioEntropy( );
+        Radio.Sleep( );
+    }
     if( MacCtx.RxSlot == RX_SLOT_WIN_CLASS_C )
     {
         OpenContinuousRxCWindow( );
     }
 }
 
+static void GatherRadioEntropy( void )
+{
+    for( uint8_t i = 0; i < RADIO_ENTROPY_WORDS; i++ )
+    {
+        uint32_t rnd = Radio.Random( );
+
+        DrbgAddEntropy( ( uint8_t* )&rnd, sizeof( rnd ) );
+    }
+    DrbgReseed( );
+}
+
 static void OnTxDelayedTimerEvent( void* context )
 {
     TimerStop( &MacCtx.TxDelayedTimer );
@@ -1695,7 +1873,7 @@ static void OnTxDelayedTimerEvent( void* context )
     }
 }
 
-static void OnRxWindow1TimerEvent( void* context )
+static void UpdateRxWindow1Config( void )
 {
     MacCtx.RxWindow1Config.Channel = MacCtx.Channel;
     MacCtx.RxWindow1Config.DrOffset = Nvm.MacGroup2.MacParams.Rx1DrOffset;
@@ -1703,26 +1881,48 @@ static void OnRxWindow1TimerEvent( void* context )
     MacCtx.RxWindow1Config.RepeaterSupport = Nvm.MacGroup2.MacParams.RepeaterSupport; /* ST_WORKAROUND: Keep repeater feature */
     MacCtx.RxWindow1Config.RxContinuous = false;
     MacCtx.RxWindow1Config.RxSlot = RX_SLOT_WIN_1;
+}
 
-    RxWindowSetup( &MacCtx.RxWindowTimer1, &MacCtx.RxWindow1Config );
+static void UpdateRxWindow2Config( void )
+{
+    MacCtx.RxWindow2Config.Channel = MacCtx.Channel;
+    MacCtx.RxWindow2Config.Frequency = Nvm.MacGroup2.MacParams.Rx2Channel.Frequency;
+    MacCtx.RxWindow2Config.DownlinkDwellTime = Nvm.MacGroup2.MacParams.DownlinkDwellTime;
+    MacCtx.RxWindow2Config.RepeaterSupport = Nvm.MacGroup2.MacParams.RepeaterSupport; /* ST_WORKAROUND: Keep repeater feature */
+    MacCtx.RxWindow2Config.RxContinuous = false;
+    MacCtx.RxWindow2Config.RxSlot = RX_SLOT_WIN_2;
+}
+
+static void OnRxWindow1TimerEvent( void* context )
+{
+    bool prepared = MacCtx.RxWindow1Prepared;
+
+    MacCtx.RxWindow1Prepared = false;
+    if( prepared == false )
+    {
+        UpdateRxWindow1Config( );
+    }
+
+    RxWindowSetup( &MacCtx.RxWindowTimer1, &MacCtx.RxWindow1Config, prepared );
 }
 
 static void OnRxWindow2TimerEvent( void* context )
 {
+    bool prepared = MacCtx.RxWindow2Prepared;
+
     // Check if we are processing Rx1 window.
     // If yes, we don't setup the Rx2 window.
     if( MacCtx.RxSlot == RX_SLOT_WIN_1 )
     {
         return;
     }
-    MacCtx.RxWindow2Config.Channel = MacCtx.Channel;
-    MacCtx.RxWindow2Config.Frequency = Nvm.MacGroup2.MacParams.Rx2Channel.Frequency;
-    MacCtx.RxWindow2Config.DownlinkDwellTime = Nvm.MacGroup2.MacParams.DownlinkDwellTime;
-    MacCtx.RxWindow2Config.RepeaterSupport = Nvm.MacGroup2.MacParams.RepeaterSupport; /* ST_WORKAROUND: Keep repeater feature */
-    MacCtx.RxWindow2Config.RxContinuous = false;
-    MacCtx.RxWindow2Config.RxSlot = RX_SLOT_WIN_2;
+    MacCtx.RxWindow2Prepared = false;
+    if( prepared == false )
+    {
+        UpdateRxWindow2Config( );
+    }
 
-    RxWindowSetup( &MacCtx.RxWindowTimer2, &MacCtx.RxWindow2Config );
+    RxWindowSetup( &MacCtx.RxWindowTimer2, &MacCtx.RxWindow2Config, prepared );
 }
 
 static void OnAckTimeoutTimerEvent( void* context )
@@ -1827,27 +2027,14 @@ static LoRaMacStatus_t SwitchClass( DeviceClass_t deviceClass )
             {
                 Nvm.MacGroup2.DeviceClass = deviceClass;
 
+                // RxC channel: the RX2 one, or the one of the multicast
+                // session in progress, set by its owner with MIB_RXC_CHANNEL
                 MacCtx.RxWindowCConfig = MacCtx.RxWindow2Config;
+                MacCtx.RxWindowCConfig.Channel = MacCtx.Channel;
+                MacCtx.RxWindowCConfig.DownlinkDwellTime = Nvm.MacGroup2.MacParams.DownlinkDwellTime;
+                MacCtx.RxWindowCConfig.RepeaterSupport = Nvm.MacGroup2.MacParams.RepeaterSupport; /* ST_WORKAROUND: Keep repeater feature */
                 MacCtx.RxWindowCConfig.RxSlot = RX_SLOT_WIN_CLASS_C;
 
-                for( int8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++ )
-                {
-                    if( Nvm.MacGroup2.MulticastChannelList[i].ChannelParams.IsEnabled == true )
-                    // TODO: Check multicast channel device class.
-                    {
-                        Nvm.MacGroup2.MacParams.RxCChannel.Frequency = Nvm.MacGroup2.MulticastChannelList[i].ChannelParams.RxParams.ClassC.Frequency;
-                        Nvm.MacGroup2.MacParams.RxCChannel.Datarate = Nvm.MacGroup2.MulticastChannelList[i].ChannelParams.RxParams.ClassC.Datarate;
-
-                        MacCtx.RxWindowCConfig.Channel = MacCtx.Channel;
-                        MacCtx.RxWindowCConfig.Frequency = Nvm.MacGroup2.MacParams.RxCChannel.Frequency;
-                        MacCtx.RxWindowCConfig.DownlinkDwellTime = Nvm.MacGroup2.MacParams.DownlinkDwellTime;
-                        MacCtx.RxWindowCConfig.RepeaterSupport = Nvm.MacGroup2.MacParams.RepeaterSupport; /* ST_WORKAROUND: Keep repeater feature */
-                        MacCtx.RxWindowCConfig.RxSlot = RX_SLOT_WIN_CLASS_C_MULTICAST;
-                        MacCtx.RxWindowCConfig.RxContinuous = true;
-                        break;
-                    }
-                }
-
                 // Set the NodeAckRequested indicator to default
                 MacCtx.NodeAckRequested = false;
                 // Set the radio into sleep mode in case we are still in RX mode
@@ -2513,6 +2700,10 @@ static LoRaMacStatus_t ScheduleTx( bool allowDelayedTx )
     nextChan.LastTxIsJoinRequest = false;
     nextChan.Joined = true;
     nextChan.PktLen = MacCtx.PktBufferLen;
+    // Regions which require a carrier sense return their candidates when the
+    // radio can scan them in the background
+    nextChan.LbtScan = ( Radio.StartChannelScan != NULL ) ? &MacCtx.LbtScan : NULL;
+    MacCtx.LbtScan.NbChannels = 0;
 
     // Setup the parameters based on the join status
     if( Nvm.MacGroup2.NetworkActivation == ACTIVATION_TYPE_NONE )
@@ -2555,6 +2746,15 @@ static LoRaMacStatus_t ScheduleTx( bool allowDelayedTx )
         return status;
     }
 
+    if( MacCtx.LbtScan.NbChannels > 0 )
+    {
+        // Listen before talk, the frame is sent by ProcessRadioChannelScanDone
+        MacCtx.MacState |= LORAMAC_TX_LBT;
+        Radio.StartChannelScan( MacCtx.LbtScan.Frequencies, MacCtx.LbtScan.NbChannels, MacCtx.LbtScan.RxBandwidth,
+                                MacCtx.LbtScan.RssiThreshold, MacCtx.LbtScan.CarrierSenseTime );
+        return LORAMAC_STATUS_OK;
+    }
+
     // Try to send now
     return SendFrameOnChannel( MacCtx.Channel );
 }
@@ -2718,23 +2918,36 @@ static void ResetMacParameters( void )
  * \param [IN] rxTimer  Window timer to be topped.
  * \param [IN] rxConfig Window parameters to be setup
  */
-static void RxWindowSetup( TimerEvent_t* rxTimer, RxConfigParams_t* rxConfig )
+static void RxWindowSetup( TimerEvent_t* rxTimer, RxConfigParams_t* rxConfig, bool prepared )
 {
     TimerStop( rxTimer );
 
     // Ensure the radio is Idle
     Radio.Standby( );
 
-    if( RegionRxConfig( Nvm.MacGroup2.Region, rxConfig, ( int8_t* )&MacCtx.McpsIndication.RxDatarate ) == true )
+    if( ( prepared == true ) ||
+        ( RegionRxConfig( Nvm.MacGroup2.Region, rxConfig, ( int8_t* )&MacCtx.McpsIndication.RxDatarate ) == true ) )
     {
         Radio.Rx( Nvm.MacGroup2.MacParams.MaxRxWindow );
         MacCtx.RxSlot = rxConfig->RxSlot;
     }
 }
 
+static bool RxWindowPrepare( RxConfigParams_t* rxConfig )
+{
+    // Ensure the radio is Idle
+    Radio.Standby( );
+
+    return RegionRxConfig( Nvm.MacGroup2.Region, rxConfig, ( int8_t* )&MacCtx.McpsIndication.RxDatarate );
+}
+
 static void OpenContinuousRxCWindow( void )
 {
+    MacCtx.RxWindow1Prepared = false;
+    MacCtx.RxWindow2Prepared = false;
+
     // Compute RxC windows parameters
+    MacCtx.RxWindowCConfig.Frequency = Nvm.MacGroup2.MacParams.RxCChannel.Frequency;
     RegionComputeRxWindowParameters( Nvm.MacGroup2.Region,
                                      Nvm.MacGroup2.MacParams.RxCChannel.Datarate,
                                      Nvm.MacGroup2.MacParams.MinRxSymbols,
@@ -2749,6 +2962,7 @@ static void OpenContinuousRxCWindow( void )
     // Thus, there is no need to set the radio in standby mode.
     if( RegionRxConfig( Nvm.MacGroup2.Region, &MacCtx.RxWindowCConfig, ( int8_t* )&MacCtx.McpsIndication.RxDatarate ) == true )
     {
+        LORAMAC_ENERGY_RADIO_ACTIVITY( LORAMAC_ENERGY_CLASS_C );
         Radio.Rx( 0 ); // Continuous mode
         MacCtx.RxSlot = MacCtx.RxWindowCConfig.RxSlot;
     }
@@ -2823,7 +3037,7 @@ static LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t
                 else if( ( MacCtx.AppDataSize > 0 ) && ( macCmdsSize > LORA_MAC_COMMAND_MAX_FOPTS_LENGTH ) )
                 {
 
-                    if( LoRaMacCommandsSerializeCmds( availableSize, &macCmdsSize, MacCtx.MacCommandsBuffer ) != LORAMAC_COMMANDS_SUCCESS )
+                    if( LoRaMacCommandsSerializeCmds( availableSize, &macCmdsSize, MacCtx.PktBuffer + LORAMAC_FRAME_PAYLOAD_NO_FOPTS_OFFSET ) != LORAMAC_COMMANDS_SUCCESS )
                     {
                         return LORAMAC_STATUS_MAC_COMMAD_ERROR;
                     }
@@ -2832,14 +3046,14 @@ static LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t
                 // No application payload available therefore add all mac commands to the FRMPayload.
                 else
                 {
-                    if( LoRaMacCommandsSerializeCmds( availableSize, &macCmdsSize, MacCtx.MacCommandsBuffer ) != LORAMAC_COMMANDS_SUCCESS )
+                    if( LoRaMacCommandsSerializeCmds( availableSize, &macCmdsSize, MacCtx.PktBuffer + LORAMAC_FRAME_PAYLOAD_NO_FOPTS_OFFSET ) != LORAMAC_COMMANDS_SUCCESS )
                     {
                         return LORAMAC_STATUS_MAC_COMMAD_ERROR;
                     }
                     // Force FPort to be zero
                     MacCtx.TxMsg.Message.Data.FPort = 0;
 
-                    MacCtx.TxMsg.Message.Data.FRMPayload = MacCtx.MacCommandsBuffer;
+                    MacCtx.TxMsg.Message.Data.FRMPayload = MacCtx.PktBuffer + LORAMAC_FRAME_PAYLOAD_NO_FOPTS_OFFSET;
                     MacCtx.TxMsg.Message.Data.FRMPayloadSize = macCmdsSize;
                 }
             }
@@ -2917,6 +3131,7 @@ static LoRaMacStatus_t SendFrameOnChannel( uint8_t channel )
     }
 
     // Send now
+    LORAMAC_ENERGY_UPLINK_START( );
     Radio.Send( MacCtx.PktBuffer, MacCtx.PktBufferLen );
 
     return LORAMAC_STATUS_OK;
@@ -3230,6 +3445,9 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
     // Confirm queue reset
     LoRaMacConfirmQueueInit( primitives );
 
+    LORAMAC_PROFILE_INIT( );
+    LORAMAC_ENERGY_INIT( );
+
     // Initialize the module context with zeros
     memset1( ( uint8_t* ) &Nvm, 0x00, sizeof( LoRaMacNvmData_t ) );
     memset1( ( uint8_t* ) &MacCtx, 0x00, sizeof( LoRaMacCtx_t ) );
@@ -3363,6 +3581,10 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
     MacCtx.RadioEvents.RxError = OnRadioRxError;
     MacCtx.RadioEvents.TxTimeout = OnRadioTxTimeout;
     MacCtx.RadioEvents.RxTimeout = OnRadioRxTimeout;
+    MacCtx.RadioEvents.ChannelScanDone = OnRadioChannelScanDone;
+#if ( LORAMAC_ENERGY_ENABLED == 1 )
+    MacCtx.RadioEvents.PowerStateChanged = LoRaMacEnergyRadioState;
+#endif
     Radio.Init( &MacCtx.RadioEvents );
 
     // Initialize the Secure Element driver
@@ -3389,8 +3611,9 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
         return LORAMAC_STATUS_CRYPTO_ERROR;
     }
 
-    // Random seed initialization
-    srand1( Radio.Random( ) );
+    // Random generator initialization, the radio is only sampled here and
+    // at idle moments, the random numbers are drawn from the DRBG
+    GatherRadioEntropy( );
 
     Radio.SetPublicNetwork( Nvm.MacGroup2.PublicNetwork );
     Radio.Sleep( );
@@ -4565,7 +4788,9 @@ LoRaMacStatus_t LoRaMacMcChannelSetupRxParams( AddressIdentifier_t groupID, McRx
     {
         verify.Frequency = rxParams->ClassC.Frequency;
     }
-    if( RegionVerify( Nvm.MacGroup2.Region, &verify, PHY_FREQUENCY ) == true )
+    // A null class B frequency selects the ping slot channel plan
+    if( ( ( devClass == CLASS_B ) && ( verify.Frequency == 0 ) ) ||
+        ( RegionVerify( Nvm.MacGroup2.Region, &verify, PHY_FREQUENCY ) == true ) )
     {
         *status &= 0xF7; // frequency OK
     }
@@ -92,6 +92,7 @@ extern "C"
 #include "LoRaMacCryptoNvm.h"
 #include "secure-element-nvm.h"
 #include "LoRaMacClassBNvm.h"
+#include "LoRaMacBeaconSearch.h"
 #include "lorawan_conf.h"
 
 /*!
@@ -482,6 +483,10 @@ typedef enum eLoRaMacEventInfoStatus
      * The node has not received a beacon after the CLASSB_BEACON_INTERVAL
      */
     LORAMAC_EVENT_INFO_STATUS_BEACON_NOT_FOUND,
+    /*!
+     * Listen before talk found all the candidate channels busy
+     */
+    LORAMAC_EVENT_INFO_STATUS_NO_FREE_CHANNEL,
 }LoRaMacEventInfoStatus_t;
 
 /*!
@@ -1381,6 +1386,7 @@ typedef struct sMlmeIndication
  * \ref MIB_NVM_CTXS                             | YES | YES
  * \ref MIB_ABP_LORAWAN_VERSION                  | NO  | YES
  * \ref MIB_LORAWAN_VERSION                      | YES | NO
+ * \ref MIB_BEACON_SEARCH_STATS                  | YES | NO
  *
  * The following table provides links to the function implementations of the
  * related MIB primitives:
@@ -1818,6 +1824,10 @@ typedef enum eMib
      * Beacon state
      */
      MIB_BEACON_STATE,
+    /*!
+     * Beacon search statistics
+     */
+     MIB_BEACON_SEARCH_STATS,
 }Mib_t;
 
 /*!
@@ -2259,6 +2269,12 @@ typedef union uMibParam
     * Related MIB type: \ref MIB_BEACON_STATE
     */
     BeaconState_t BeaconState;
+    /*!
+    * Statistics of the beacon search
+    *
+    * Related MIB type: \ref MIB_BEACON_SEARCH_STATS
+    */
+    LoRaMacBeaconSearchStats_t BeaconSearchStats;
 }MibParam_t;
 
 /*!
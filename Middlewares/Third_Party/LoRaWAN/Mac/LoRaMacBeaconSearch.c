@@ -0,0 +1,213 @@
+/*!
+ * \file      LoRaMacBeaconSearch.c
+ *
+ * \brief     Class B beacon search sized on the measured RTC drift
+ */
+#include <stddef.h>
+
+#include "LoRaMacClassBConfig.h"
+#include "LoRaMacBeaconSearch.h"
+
+#if ( LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 )
+
+/*!
+ * Time needed to set up a beacon window in ms
+ */
+#define LORAMAC_BEACON_SEARCH_SETUP_TIME            20
+
+/*!
+ * \brief Gets the RTC time elapsed from the last beacon received
+ */
+static uint32_t GetElapsed( LoRaMacBeaconSearch_t *search, TimerTime_t rxTime )
+{
+    // A window before the last beacon only follows a time jump
+    if( ( search->Locked == false ) || ( ( int32_t )( rxTime - search->LastLock ) <= 0 ) )
+    {
+        return 0;
+    }
+    return rxTime - search->LastLock;
+}
+
+/*!
+ * \brief Gets the uncertainty on the arrival of a beacon, not bounded to
+ *        LORAMAC_BEACON_SEARCH_MAX_ERROR
+ */
+static uint64_t GetError( LoRaMacBeaconSearch_t *search, TimerTime_t rxTime, uint32_t rxError )
+{
+    uint64_t drift = LORAMAC_BEACON_SEARCH_DEFAULT_DRIFT;
+
+    if( search->DriftValid == true )
+    {
+        // The measured drift is corrected, only its error remains
+        drift = LORAMAC_BEACON_SEARCH_DRIFT_MARGIN;
+    }
+    for( uint8_t step = 0; step < search->Step; step++ )
+    {
+        drift *= LORAMAC_BEACON_SEARCH_EXPANSION_FACTOR;
+    }
+    return rxError + ( drift * GetElapsed( search, rxTime ) + 999999999 ) / 1000000000;
+}
+
+/*!
+ * \brief Measures the drift over the baseline ending at the beacon received
+ */
+static void MeasureDrift( LoRaMacBeaconSearch_t *search, TimerTime_t rxTime, uint32_t beaconTime )
+{
+    uint32_t baseline = ( beaconTime - search->ReferenceTime ) * 1000;
+    int64_t measured;
+
+    if( ( search->Locked == false ) || ( ( beaconTime - search->ReferenceTime ) > ( UINT32_MAX / 1000 ) ) )
+    {
+        search->Reference = rxTime;
+        search->ReferenceTime = beaconTime;
+        return;
+    }
+    if( baseline < LORAMAC_BEACON_SEARCH_MIN_BASELINE )
+    {
+        return;
+    }
+
+    measured = ( ( int64_t )( int32_t )( rxTime - search->Reference - baseline ) * 1000000000 ) / baseline;
+    if( ( measured > LORAMAC_BEACON_SEARCH_MAX_DRIFT ) || ( measured < -LORAMAC_BEACON_SEARCH_MAX_DRIFT ) )
+    {
+        // Time jump, restart the baseline
+        search->Reference = rxTime;
+        search->ReferenceTime = beaconTime;
+        return;
+    }
+
+    if( search->DriftValid == false )
+    {
+        search->Drift = ( int32_t )measured;
+        search->DriftValid = true;
+    }
+    else
+    {
+        search->Drift += ( int32_t )( ( measured - search->Drift ) / LORAMAC_BEACON_SEARCH_DRIFT_GAIN );
+    }
+    search->Stats.Drift = search->Drift;
+
+    if( baseline >= LORAMAC_BEACON_SEARCH_MAX_BASELINE )
+    {
+        search->Reference = rxTime;
+        search->ReferenceTime = beaconTime;
+    }
+}
+
+void LoRaMacBeaconSearchInit( LoRaMacBeaconSearch_t *search )
+{
+    search->Locked = false;
+    search->LastLock = 0;
+    search->BeaconTime = 0;
+    search->Reference = 0;
+    search->ReferenceTime = 0;
+    search->DriftValid = false;
+    search->Drift = 0;
+    search->Misses = 0;
+    search->Step = 0;
+    search->Stats = ( LoRaMacBeaconSearchStats_t ){ 0 };
+}
+
+void LoRaMacBeaconSearchOnLock( LoRaMacBeaconSearch_t *search, TimerTime_t rxTime, uint32_t beaconTime )
+{
+    MeasureDrift( search, rxTime, beaconTime );
+
+    search->Stats.Locks++;
+    if( search->Misses > 0 )
+    {
+        search->Stats.Recoveries++;
+        search->Stats.Recovered[search->Step]++;
+        if( search->Misses > search->Stats.LongestOutage )
+        {
+            search->Stats.LongestOutage = search->Misses;
+        }
+    }
+    search->Locked = true;
+    search->LastLock = rxTime;
+    search->BeaconTime = beaconTime;
+    search->Misses = 0;
+    search->Step = 0;
+}
+
+void LoRaMacBeaconSearchOnMiss( LoRaMacBeaconSearch_t *search )
+{
+    search->Stats.Misses++;
+    search->Misses++;
+    // Widened after 1, 3, 7, 15... misses, a long outage does not keep the
+    // receiver on for the widest window on every beacon
+    if( ( search->Step < LORAMAC_BEACON_SEARCH_MAX_STEP ) && ( ( ( search->Misses + 1 ) >> ( search->Step + 1 ) ) != 0 ) )
+    {
+        search->Step++;
+    }
+}
+
+void LoRaMacBeaconSearchOnLost( LoRaMacBeaconSearch_t *search )
+{
+    search->Stats.Losses++;
+    search->Misses = 0;
+    search->Step = 0;
+}
+
+int32_t LoRaMacBeaconSearchGetCorrection( LoRaMacBeaconSearch_t *search, TimerTime_t rxTime )
+{
+    if( search->DriftValid == false )
+    {
+        return 0;
+    }
+    return ( int32_t )( ( ( int64_t )search->Drift * GetElapsed( search, rxTime ) ) / 1000000000 );
+}
+
+uint32_t LoRaMacBeaconSearchGetError( LoRaMacBeaconSearch_t *search, TimerTime_t rxTime, uint32_t rxError )
+{
+    uint64_t error = GetError( search, rxTime, rxError );
+
+    if( error > LORAMAC_BEACON_SEARCH_MAX_ERROR )
+    {
+        return LORAMAC_BEACON_SEARCH_MAX_ERROR;
+    }
+    return ( uint32_t )error;
+}
+
+bool LoRaMacBeaconSearchGetNextBeacon( LoRaMacBeaconSearch_t *search, TimerTime_t now, uint32_t rxError,
+                                       TimerTime_t *rxTime, uint32_t *beaconTime )
+{
+    uint32_t k;
+    TimerTime_t expected;
+    uint64_t error;
+
+    if( ( search->Locked == false ) || ( search->Misses >= LORAMAC_BEACON_SEARCH_ACQUISITION_WINDOWS ) )
+    {
+        return false;
+    }
+
+    // First beacon whose window still opens in the future
+    k = ( now - search->LastLock ) / CLASSB_BEACON_INTERVAL;
+    do
+    {
+        k++;
+        expected = search->LastLock + k * CLASSB_BEACON_INTERVAL;
+        error = GetError( search, expected, rxError );
+        if( error > LORAMAC_BEACON_SEARCH_MAX_ERROR )
+        {
+            return false;
+        }
+    }while( ( int32_t )( expected + LoRaMacBeaconSearchGetCorrection( search, expected ) - error - now ) <
+            LORAMAC_BEACON_SEARCH_SETUP_TIME );
+
+    if( rxTime != NULL )
+    {
+        *rxTime = expected;
+    }
+    if( beaconTime != NULL )
+    {
+        *beaconTime = search->BeaconTime + k * ( CLASSB_BEACON_INTERVAL / 1000 );
+    }
+    return true;
+}
+
+LoRaMacBeaconSearchStats_t LoRaMacBeaconSearchGetStats( LoRaMacBeaconSearch_t *search )
+{
+    return search->Stats;
+}
+
+#endif /* LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 */
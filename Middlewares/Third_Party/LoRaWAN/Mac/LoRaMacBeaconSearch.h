@@ -0,0 +1,303 @@
+/*!
+ * \file      LoRaMacBeaconSearch.h
+ *
+ * \brief     Class B beacon search sized on the measured RTC drift
+ *
+ * \details   The RTC time a beacon starts at is recorded on every beacon
+ *            received. Against the GPS time carried by the beacons it
+ *            gives, over a baseline of at least
+ *            LORAMAC_BEACON_SEARCH_MIN_BASELINE, the drift of the RTC in
+ *            ppb. The drift accumulated since the last beacon received moves
+ *            the window of a later beacon, and the uncertainty left on its
+ *            arrival is the system RX error plus
+ *            LORAMAC_BEACON_SEARCH_DRIFT_MARGIN over the time elapsed. Until
+ *            the drift is measured the window is not moved and
+ *            LORAMAC_BEACON_SEARCH_DEFAULT_DRIFT is used instead of the
+ *            margin.
+ *
+ *            Beacon windows are centered on the expected beacon and sized
+ *            for that uncertainty instead of being moved earlier by a fixed
+ *            doubling amount. The drift uncertainty is multiplied by
+ *            LORAMAC_BEACON_SEARCH_EXPANSION_FACTOR after 1, 3, 7, 15...
+ *            successive beacons missed, up to LORAMAC_BEACON_SEARCH_MAX_STEP
+ *            times.
+ *
+ *            When the beacon is acquired again, after a beacon loss or a
+ *            halt, the next beacon is predicted from the RTC time of the
+ *            last beacon received and the drift. Narrow windows are opened
+ *            at the predicted beacons and the continuous search of a whole
+ *            beacon interval is only started when
+ *            LORAMAC_BEACON_SEARCH_ACQUISITION_WINDOWS of them missed or when
+ *            the uncertainty exceeds LORAMAC_BEACON_SEARCH_MAX_ERROR.
+ *
+ *            The search is compiled in LoRaMacClassB when
+ *            LORAMAC_CLASSB_BEACON_SEARCH_ENABLED is set to 1 in
+ *            lorawan_conf.h. Its statistics are read with the
+ *            MIB_BEACON_SEARCH_STATS MIB request.
+ */
+#ifndef __LORAMAC_BEACON_SEARCH_H__
+#define __LORAMAC_BEACON_SEARCH_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lorawan_conf.h"
+#include "timer.h"
+
+#ifndef LORAMAC_CLASSB_BEACON_SEARCH_ENABLED
+#define LORAMAC_CLASSB_BEACON_SEARCH_ENABLED        0
+#endif
+
+/*!
+ * RTC drift, in ppb, assumed until it is measured: 32.768 kHz crystal
+ * tolerance plus its temperature coefficient
+ */
+#ifndef LORAMAC_BEACON_SEARCH_DEFAULT_DRIFT
+#define LORAMAC_BEACON_SEARCH_DEFAULT_DRIFT         40000
+#endif
+
+/*!
+ * Margin, in ppb, added to the measured drift for the measurement error
+ * and the temperature changes
+ */
+#ifndef LORAMAC_BEACON_SEARCH_DRIFT_MARGIN
+#define LORAMAC_BEACON_SEARCH_DRIFT_MARGIN          4000
+#endif
+
+/*!
+ * Shortest baseline, in ms, the drift is measured on (8 beacons, 1 ms
+ * resolution is 1 ppm)
+ */
+#ifndef LORAMAC_BEACON_SEARCH_MIN_BASELINE
+#define LORAMAC_BEACON_SEARCH_MIN_BASELINE          1024000
+#endif
+
+/*!
+ * Longest baseline in ms. The baseline then restarts so the measurement
+ * follows the temperature.
+ */
+#ifndef LORAMAC_BEACON_SEARCH_MAX_BASELINE
+#define LORAMAC_BEACON_SEARCH_MAX_BASELINE          7680000
+#endif
+
+/*!
+ * Drift filter gain, a new measurement accounts for 1/GAIN
+ */
+#ifndef LORAMAC_BEACON_SEARCH_DRIFT_GAIN
+#define LORAMAC_BEACON_SEARCH_DRIFT_GAIN            4
+#endif
+
+/*!
+ * Largest plausible drift, in ppb. A larger measurement is a time jump
+ * and restarts the baseline.
+ */
+#ifndef LORAMAC_BEACON_SEARCH_MAX_DRIFT
+#define LORAMAC_BEACON_SEARCH_MAX_DRIFT             200000
+#endif
+
+/*!
+ * Factor the drift uncertainty is widened by
+ */
+#ifndef LORAMAC_BEACON_SEARCH_EXPANSION_FACTOR
+#define LORAMAC_BEACON_SEARCH_EXPANSION_FACTOR      2
+#endif
+
+/*!
+ * Number of times the window is widened
+ */
+#ifndef LORAMAC_BEACON_SEARCH_MAX_STEP
+#define LORAMAC_BEACON_SEARCH_MAX_STEP              4
+#endif
+
+/*!
+ * Number of windows opened on predicted beacons by an acquisition before
+ * the continuous search
+ */
+#ifndef LORAMAC_BEACON_SEARCH_ACQUISITION_WINDOWS
+#define LORAMAC_BEACON_SEARCH_ACQUISITION_WINDOWS   4
+#endif
+
+/*!
+ * Largest uncertainty, in ms, covered by a beacon window. It keeps the
+ * window below 255 symbols at the fastest beacon datarate (SF9, 125 kHz).
+ */
+#ifndef LORAMAC_BEACON_SEARCH_MAX_ERROR
+#define LORAMAC_BEACON_SEARCH_MAX_ERROR             500
+#endif
+
+/*!
+ * Beacon search statistics
+ */
+typedef struct sLoRaMacBeaconSearchStats
+{
+    /*!
+     * Number of beacons received
+     */
+    uint32_t Locks;
+    /*!
+     * Number of beacon windows missed
+     */
+    uint32_t Misses;
+    /*!
+     * Number of beacons received after at least one miss
+     */
+    uint32_t Recoveries;
+    /*!
+     * Number of recoveries per widening step of the window that received
+     * the beacon
+     */
+    uint32_t Recovered[LORAMAC_BEACON_SEARCH_MAX_STEP + 1];
+    /*!
+     * Largest number of successive beacons missed before a recovery
+     */
+    uint32_t LongestOutage;
+    /*!
+     * Number of beacon losses
+     */
+    uint32_t Losses;
+    /*!
+     * RTC drift measured on the beacons in ppb, positive when the RTC runs
+     * fast, 0 while unknown
+     */
+    int32_t Drift;
+}LoRaMacBeaconSearchStats_t;
+
+/*!
+ * Beacon search context
+ */
+typedef struct sLoRaMacBeaconSearch
+{
+    /*!
+     * A beacon has been received
+     */
+    bool Locked;
+    /*!
+     * RTC time the last beacon received started at
+     */
+    TimerTime_t LastLock;
+    /*!
+     * GPS time of the last beacon received in seconds
+     */
+    uint32_t BeaconTime;
+    /*!
+     * RTC time of the beacon the drift baseline starts at
+     */
+    TimerTime_t Reference;
+    /*!
+     * GPS time of the beacon the drift baseline starts at in seconds
+     */
+    uint32_t ReferenceTime;
+    /*!
+     * The drift has been measured
+     */
+    bool DriftValid;
+    /*!
+     * RTC drift estimate in ppb, positive when the RTC runs fast
+     */
+    int32_t Drift;
+    /*!
+     * Number of successive beacons missed
+     */
+    uint32_t Misses;
+    /*!
+     * Widening step of the next window
+     */
+    uint8_t Step;
+    /*!
+     * Statistics
+     */
+    LoRaMacBeaconSearchStats_t Stats;
+}LoRaMacBeaconSearch_t;
+
+/*!
+ * \brief Clears the drift estimate, the last beacon and the statistics
+ *
+ * \param [IN] search Beacon search
+ */
+void LoRaMacBeaconSearchInit( LoRaMacBeaconSearch_t *search );
+
+/*!
+ * \brief Records a beacon received and measures the drift
+ *
+ * \param [IN] search     Beacon search
+ * \param [IN] rxTime     RTC time the beacon started at
+ * \param [IN] beaconTime GPS time of the beacon in seconds
+ */
+void LoRaMacBeaconSearchOnLock( LoRaMacBeaconSearch_t *search, TimerTime_t rxTime, uint32_t beaconTime );
+
+/*!
+ * \brief Records a beacon window which missed the beacon and widens the
+ *        next one
+ *
+ * \param [IN] search Beacon search
+ */
+void LoRaMacBeaconSearchOnMiss( LoRaMacBeaconSearch_t *search );
+
+/*!
+ * \brief Records a beacon loss. The last beacon received is kept for the
+ *        next acquisition.
+ *
+ * \param [IN] search Beacon search
+ */
+void LoRaMacBeaconSearchOnLost( LoRaMacBeaconSearch_t *search );
+
+/*!
+ * \brief Gets the drift accumulated since the last beacon received, to be
+ *        added to the offset of a beacon window
+ *
+ * \param [IN] search Beacon search
+ * \param [IN] rxTime RTC time the beacon is expected at, without correction
+ *
+ * \retval correction Drift in ms, 0 while the drift is not measured
+ */
+int32_t LoRaMacBeaconSearchGetCorrection( LoRaMacBeaconSearch_t *search, TimerTime_t rxTime );
+
+/*!
+ * \brief Gets the uncertainty on the arrival of a beacon
+ *
+ * \param [IN] search  Beacon search
+ * \param [IN] rxTime  RTC time the beacon is expected at
+ * \param [IN] rxError System maximum RX error in ms
+ *
+ * \retval error Half width of the beacon window in ms, at most
+ *               LORAMAC_BEACON_SEARCH_MAX_ERROR
+ */
+uint32_t LoRaMacBeaconSearchGetError( LoRaMacBeaconSearch_t *search, TimerTime_t rxTime, uint32_t rxError );
+
+/*!
+ * \brief Predicts the next beacon from the last beacon received
+ *
+ * \param [IN]  search     Beacon search
+ * \param [IN]  now        Current RTC time
+ * \param [IN]  rxError    System maximum RX error in ms
+ * \param [OUT] rxTime     RTC time the beacon is expected at, without the
+ *                         drift correction
+ * \param [OUT] beaconTime GPS time of the beacon in seconds
+ *
+ * \retval found Returns false when no beacon was received, when
+ *               LORAMAC_BEACON_SEARCH_ACQUISITION_WINDOWS windows missed
+ *               since the last beacon loss or when the uncertainty exceeds
+ *               LORAMAC_BEACON_SEARCH_MAX_ERROR
+ */
+bool LoRaMacBeaconSearchGetNextBeacon( LoRaMacBeaconSearch_t *search, TimerTime_t now, uint32_t rxError,
+                                       TimerTime_t *rxTime, uint32_t *beaconTime );
+
+/*!
+ * \brief Gets the statistics
+ *
+ * \param [IN] search Beacon search
+ *
+ * \retval stats Statistics
+ */
+LoRaMacBeaconSearchStats_t LoRaMacBeaconSearchGetStats( LoRaMacBeaconSearch_t *search );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __LORAMAC_BEACON_SEARCH_H__
@@ -45,13 +45,35 @@
 #include "LoRaMacClassB.h"
 #include "LoRaMacClassBNvm.h"
 #include "LoRaMacClassBConfig.h"
+#include "LoRaMacBeaconSearch.h"
 #include "LoRaMacCrypto.h"
 #include "LoRaMacConfirmQueue.h"
+#include "LoRaMacEnergy.h"
 #include "radio.h"
 #include "Region.h"
 
 #if ( LORAMAC_CLASSB_ENABLED == 1 )
 
+#if ( LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 )
+/*!
+ * State of the beacon window opened by the acquisition on a predicted beacon
+ */
+typedef enum eBeaconSearchState
+{
+    /*!
+     * No window
+     */
+    BEACON_SEARCH_STATE_IDLE,
+    /*!
+     * The window is scheduled
+     */
+    BEACON_SEARCH_STATE_WAIT,
+    /*!
+     * The window is open
+     */
+    BEACON_SEARCH_STATE_RX,
+}BeaconSearchState_t;
+#endif /* LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 */
 
 /*
  * LoRaMac Class B Context structure
@@ -99,6 +121,16 @@ typedef struct sLoRaMacClassBCtx
     * in class b operation.
     */
     LoRaMacClassBParams_t LoRaMacClassBParams;
+#if ( LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 )
+    /*!
+    * Beacon search, kept over the beacon losses
+    */
+    LoRaMacBeaconSearch_t BeaconSearch;
+    /*!
+    * State of the acquisition window on a predicted beacon
+    */
+    BeaconSearchState_t BeaconSearchState;
+#endif /* LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 */
 } LoRaMacClassBCtx_t;
 
 /*!
@@ -329,6 +361,42 @@ static void CalculateBeaconRxWindowConfig( RxConfigParams_t* rxConfig, uint16_t
     }
 }
 
+#if ( LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 )
+/*!
+ * \brief Calculates the beacon reception window of the beacon search. The window
+ *        is moved by the RTC drift accumulated since the last beacon received
+ *        and covers the uncertainty left, widened as beacons are missed.
+ *
+ * \param [IN] rxConfig Reception parameters for the beacon window.
+ *
+ * \param [IN] beaconRx Time the beacon is expected at.
+ */
+static void CalculateBeaconSearchRxWindowConfig( RxConfigParams_t* rxConfig, TimerTime_t beaconRx )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+    uint32_t rxError = LoRaMacBeaconSearchGetError( &Ctx.BeaconSearch, beaconRx,
+                                                    Ctx.LoRaMacClassBParams.LoRaMacParams->SystemMaxRxError );
+
+    // Read beacon datarate
+    getPhy.Attribute = PHY_BEACON_CHANNEL_DR;
+    phyParam = RegionGetPhyParam( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &getPhy );
+
+    // Calculate downlink symbols for the search uncertainty
+    RegionComputeRxWindowParameters( *Ctx.LoRaMacClassBParams.LoRaMacRegion,
+                                    ( int8_t )phyParam.Value, // datarate
+                                    Ctx.LoRaMacClassBParams.LoRaMacParams->MinRxSymbols,
+                                    rxError,
+                                    rxConfig );
+    if( rxConfig->WindowTimeout > CLASSB_BEACON_SYMBOL_TO_EXPANSION_MAX )
+    {
+        rxConfig->WindowTimeout = CLASSB_BEACON_SYMBOL_TO_EXPANSION_MAX;
+    }
+    // Center the window on the drift of the RTC
+    rxConfig->WindowOffset += LoRaMacBeaconSearchGetCorrection( &Ctx.BeaconSearch, beaconRx );
+}
+#endif /* LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 */
+
 /*!
  * \brief Calculates the correct frequency and opens up the beacon reception window.
  *
@@ -373,6 +441,7 @@ static void RxBeaconSetup( TimerTime_t rxTime, bool activateDefaultChannel, uint
     rxBeaconSetup.RxTime = rxTime;
     rxBeaconSetup.Frequency = frequency;
 
+    LORAMAC_ENERGY_RADIO_ACTIVITY( LORAMAC_ENERGY_BEACON );
     RegionRxBeaconSetup( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &rxBeaconSetup, &Ctx.LoRaMacClassBParams.McpsIndication->RxDatarate );
 
     Ctx.LoRaMacClassBParams.MlmeIndication->BeaconInfo.Frequency = frequency;
@@ -492,6 +561,9 @@ static void InitClassB( void )
     Ctx.BeaconState = BEACON_STATE_ACQUISITION;
     Ctx.PingSlotState = PINGSLOT_STATE_CALC_PING_OFFSET;
     Ctx.MulticastSlotState = PINGSLOT_STATE_CALC_PING_OFFSET;
+#if ( LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 )
+    Ctx.BeaconSearchState = BEACON_SEARCH_STATE_IDLE;
+#endif /* LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 */
 }
 
 static void InitClassBDefaults( void )
@@ -515,12 +587,17 @@ static void InitClassBDefaults( void )
 
 static void EnlargeWindowTimeout( void )
 {
+#if ( LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 )
+    // The beacon search widens the beacon window around the expected beacon
+    LoRaMacBeaconSearchOnMiss( &Ctx.BeaconSearch );
+#else
     // Update beacon movement
     Ctx.BeaconCtx.BeaconWindowMovement *= CLASSB_WINDOW_MOVE_EXPANSION_FACTOR;
     if( Ctx.BeaconCtx.BeaconWindowMovement > CLASSB_WINDOW_MOVE_EXPANSION_MAX )
     {
         Ctx.BeaconCtx.BeaconWindowMovement = CLASSB_WINDOW_MOVE_EXPANSION_MAX;
     }
+#endif /* LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 */
     // Update symbol timeout
     Ctx.BeaconCtx.SymbolTimeout *= CLASSB_BEACON_SYMBOL_TO_EXPANSION_FACTOR;
     if( Ctx.BeaconCtx.SymbolTimeout > CLASSB_BEACON_SYMBOL_TO_EXPANSION_MAX )
@@ -538,7 +615,12 @@ static void ResetWindowTimeout( void )
 {
     Ctx.BeaconCtx.SymbolTimeout = CLASSB_BEACON_SYMBOL_TO_DEFAULT;
     Ctx.PingSlotCtx.SymbolTimeout = CLASSB_BEACON_SYMBOL_TO_DEFAULT;
+#if ( LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 )
+    // The beacon search centers the beacon window on the expected beacon
+    Ctx.BeaconCtx.BeaconWindowMovement  = 0;
+#else
     Ctx.BeaconCtx.BeaconWindowMovement  = CLASSB_WINDOW_MOVE_DEFAULT;
+#endif /* LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 */
 }
 
 static TimerTime_t CalcDelayForNextBeacon( TimerTime_t currentTime, TimerTime_t lastBeaconRx )
@@ -613,6 +695,86 @@ static uint16_t CalcPingPeriod( uint8_t pingNb )
 {
     return CLASSB_BEACON_WINDOW_SLOTS / pingNb;
 }
+
+#if ( LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 )
+/*!
+ * \brief Acquires the beacon with windows opened on the beacons predicted from
+ *        the last beacon received, before the continuous acquisition. Runs in
+ *        the state BEACON_STATE_ACQUISITION.
+ *
+ * \param [IN]  currentTime     Current time
+ * \param [OUT] beaconEventTime Delay of the next beacon event
+ *
+ * \retval [true: event handled, false: the continuous acquisition shall be used]
+ */
+static bool AcquireBeaconOnTime( TimerTime_t currentTime, TimerTime_t *beaconEventTime )
+{
+    RxConfigParams_t beaconRxConfig;
+    TimerTime_t beaconRx = 0;
+    uint32_t beaconTime = 0;
+
+    switch( Ctx.BeaconSearchState )
+    {
+        case BEACON_SEARCH_STATE_WAIT:
+        {
+            CalculateBeaconSearchRxWindowConfig( &beaconRxConfig, Ctx.BeaconCtx.NextBeaconRxAdjusted );
+
+            // A beacon received in the window locks the state machine
+            Ctx.BeaconCtx.Ctrl.AcquisitionPending = 1;
+            Ctx.BeaconSearchState = BEACON_SEARCH_STATE_RX;
+            RxBeaconSetup( CLASSB_BEACON_RESERVED, false, beaconRxConfig.WindowTimeout );
+
+            // Close the window if the radio does not report a timeout
+            *beaconEventTime = CLASSB_BEACON_RESERVED;
+            return true;
+        }
+        case BEACON_SEARCH_STATE_RX:
+        {
+            // The window missed the beacon
+            Radio.Sleep( );
+            Ctx.BeaconCtx.Ctrl.AcquisitionPending = 0;
+            Ctx.BeaconSearchState = BEACON_SEARCH_STATE_IDLE;
+            LoRaMacBeaconSearchOnMiss( &Ctx.BeaconSearch );
+            break;
+        }
+        default:
+        {
+            if( Ctx.BeaconCtx.Ctrl.AcquisitionPending == 1 )
+            {
+                // The continuous acquisition is running
+                return false;
+            }
+            break;
+        }
+    }
+
+    if( LoRaMacBeaconSearchGetNextBeacon( &Ctx.BeaconSearch, currentTime,
+                                          Ctx.LoRaMacClassBParams.LoRaMacParams->SystemMaxRxError,
+                                          &beaconRx, &beaconTime ) == false )
+    {
+        return false;
+    }
+
+    // RxBeaconSetup selects the channel of the beacon following BeaconTime
+    Ctx.BeaconCtx.BeaconTime.Seconds = beaconTime - ( CLASSB_BEACON_INTERVAL / 1000 );
+    Ctx.BeaconCtx.BeaconTime.SubSeconds = 0;
+    Ctx.BeaconCtx.NextBeaconRxAdjusted = beaconRx;
+
+    CalculateBeaconSearchRxWindowConfig( &beaconRxConfig, beaconRx );
+    *beaconEventTime = beaconRx - currentTime;
+    if( ( int32_t )*beaconEventTime > -beaconRxConfig.WindowOffset )
+    {
+        // Apply the offset of the search uncertainty
+        *beaconEventTime += beaconRxConfig.WindowOffset;
+    }
+    else
+    {
+        *beaconEventTime = 1;
+    }
+    Ctx.BeaconSearchState = BEACON_SEARCH_STATE_WAIT;
+    return true;
+}
+#endif /* LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 */
 #endif /* LORAMAC_CLASSB_ENABLED */
 
 void LoRaMacClassBInit( LoRaMacClassBParams_t *classBParams, LoRaMacClassBCallback_t *callbacks,
@@ -637,6 +799,9 @@ void LoRaMacClassBInit( LoRaMacClassBParams_t *classBParams, LoRaMacClassBCallba
     TimerInit( &Ctx.PingSlotTimer, LoRaMacClassBPingSlotTimerEvent );
     TimerInit( &Ctx.MulticastSlotTimer, LoRaMacClassBMulticastSlotTimerEvent );
 
+#if ( LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 )
+    LoRaMacBeaconSearchInit( &Ctx.BeaconSearch );
+#endif /* LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 */
     InitClassB( );
 #endif /* LORAMAC_CLASSB_ENABLED */
 }
@@ -698,6 +863,14 @@ bool LoRaMacClassBIsAcquisitionInProgress( void )
         // searches for a beacon.
         return true;
     }
+#if ( LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 )
+    if( Ctx.BeaconSearchState != BEACON_SEARCH_STATE_IDLE )
+    {
+        // In this case the acquisition is in progress, as the MAC
+        // waits for a predicted beacon.
+        return true;
+    }
+#endif /* LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 */
     return false;
 #else
     return false;
@@ -723,7 +896,8 @@ static void LoRaMacClassBProcessBeacon( void )
 {
     bool activateTimer = false;
     TimerTime_t beaconEventTime = 1;
-    RxConfigParams_t beaconRxConfig;
+    // Kept from the state BEACON_STATE_IDLE for the state BEACON_STATE_GUARD
+    static RxConfigParams_t beaconRxConfig;
     TimerTime_t currentTime = Ctx.BeaconCtx.TimeStamp;
 
     // Beacon state machine
@@ -799,6 +973,12 @@ static void LoRaMacClassBProcessBeacon( void )
         {
             activateTimer = true;
 
+#if ( LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 )
+            if( AcquireBeaconOnTime( currentTime, &beaconEventTime ) == true )
+            {
+                break;
+            }
+#endif /* LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 */
             if( Ctx.BeaconCtx.Ctrl.AcquisitionPending == 1 )
             {
                 Radio.Sleep();
@@ -894,6 +1074,9 @@ static void LoRaMacClassBProcessBeacon( void )
 
             // The goal is to calculate beaconRxConfig.WindowTimeout and beaconRxConfig.WindowOffset
             CalculateBeaconRxWindowConfig( &beaconRxConfig, Ctx.BeaconCtx.SymbolTimeout );
+#if ( LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 )
+            CalculateBeaconSearchRxWindowConfig( &beaconRxConfig, Ctx.BeaconCtx.NextBeaconRxAdjusted );
+#endif /* LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 */
 
             if( beaconEventTime > currentTime )
             {
@@ -946,6 +1129,9 @@ static void LoRaMacClassBProcessBeacon( void )
             // Stop slot timers
             LoRaMacClassBStopRxSlots( );
 
+#if ( LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 )
+            LoRaMacBeaconSearchOnLost( &Ctx.BeaconSearch );
+#endif /* LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 */
             // Initialize default state for class b
             InitClassBDefaults( );
 
@@ -1052,6 +1238,7 @@ static void LoRaMacClassBProcessPingSlot( void )
 
                 RegionRxConfig( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &pingSlotRxConfig, ( int8_t* )&Ctx.LoRaMacClassBParams.McpsIndication->RxDatarate );
 
+                LORAMAC_ENERGY_RADIO_ACTIVITY( LORAMAC_ENERGY_PING_SLOT );
                 if( pingSlotRxConfig.RxContinuous == false )
                 {
                     Radio.Rx( Ctx.LoRaMacClassBParams.LoRaMacParams->MaxRxWindow );
@@ -1216,6 +1403,7 @@ static void LoRaMacClassBProcessMulticastSlot( void )
                 TimerStart( &Ctx.PingSlotTimer );
             }
 
+            LORAMAC_ENERGY_RADIO_ACTIVITY( LORAMAC_ENERGY_PING_SLOT );
             if( multicastSlotRxConfig.RxContinuous == false )
             {
                 Radio.Rx( Ctx.LoRaMacClassBParams.LoRaMacParams->MaxRxWindow );
@@ -1235,7 +1423,7 @@ static void LoRaMacClassBProcessMulticastSlot( void )
 }
 #endif /* LORAMAC_CLASSB_ENABLED */
 
-bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size )
+bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size, TimerTime_t lastRxDone )
 {
 #if ( LORAMAC_CLASSB_ENABLED == 1 )
     GetPhyParams_t getPhy;
@@ -1312,9 +1500,12 @@ bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size )
                 bandwidth = phyParam.Value;
 
                 TimerTime_t time = Radio.TimeOnAir( MODEM_LORA, bandwidth, spreadingFactor, 1, 10, true, size, false );
+                // The beacon ended at the RX done interrupt, this processing
+                // is deferred from it
+                TimerTime_t elapsed = time + TimerGetElapsedTime( lastRxDone );
                 SysTime_t timeOnAir;
-                timeOnAir.Seconds = time / 1000;
-                timeOnAir.SubSeconds = time - timeOnAir.Seconds * 1000;
+                timeOnAir.Seconds = elapsed / 1000;
+                timeOnAir.SubSeconds = elapsed - timeOnAir.Seconds * 1000;
 
                 Ctx.BeaconCtx.LastBeaconRx = Ctx.BeaconCtx.BeaconTime;
                 Ctx.BeaconCtx.LastBeaconRx.Seconds += UNIX_GPS_EPOCH_OFFSET;
@@ -1322,6 +1513,11 @@ bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size )
                 // Update system time.
                 SysTimeSet( SysTimeAdd( Ctx.BeaconCtx.LastBeaconRx, timeOnAir ) );
 
+#if ( LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 )
+                // The beacon started one time on air before the RX done
+                LoRaMacBeaconSearchOnLock( &Ctx.BeaconSearch, lastRxDone - time, Ctx.BeaconCtx.BeaconTime.Seconds );
+                Ctx.BeaconSearchState = BEACON_SEARCH_STATE_IDLE;
+#endif /* LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 */
                 Ctx.BeaconCtx.Ctrl.BeaconAcquired = 1;
                 Ctx.BeaconCtx.Ctrl.BeaconMode = 1;
                 ResetWindowTimeout( );
@@ -1517,6 +1713,13 @@ LoRaMacStatus_t LoRaMacClassBMibGetRequestConfirm( MibRequestConfirm_t *mibGet )
             mibGet->Param.BeaconState = Ctx.BeaconState;
             break;
         }
+#if ( LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 )
+        case MIB_BEACON_SEARCH_STATS:
+        {
+            mibGet->Param.BeaconSearchStats = LoRaMacBeaconSearchGetStats( &Ctx.BeaconSearch );
+            break;
+        }
+#endif /* LORAMAC_CLASSB_BEACON_SEARCH_ENABLED == 1 */
         default:
         {
             status = LORAMAC_STATUS_SERVICE_UNKNOWN;
@@ -304,9 +304,10 @@ void LoRaMacClassBMulticastSlotTimerEvent( void* context );
  *
  * \param [IN] payload Pointer to the payload
  * \param [IN] size Size of the payload
+ * \param [IN] lastRxDone The time of the frame reception
  * \retval [true, if the node has received a beacon; false, if not]
  */
-bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size );
+bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size, TimerTime_t lastRxDone );
 
 /*!
  * \brief The function validates, if the node expects a beacon
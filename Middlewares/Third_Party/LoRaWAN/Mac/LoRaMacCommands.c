@@ -35,7 +35,7 @@
 #include "LoRaMacConfirmQueue.h"
 
 /*!
- * Number of MAC Command slots
+ * Number of MAC Command slots (at most 16, one bit each in SlotsInUse)
  */
 #define NUM_OF_MAC_COMMANDS 15
 
@@ -72,6 +72,18 @@ typedef struct sLoRaMacCommandsCtx
      * Buffer to store MAC command elements
      */
     MacCommand_t MacCommandSlots[NUM_OF_MAC_COMMANDS];
+    /*
+     * Bitmap of the slots in use, bit n set when MacCommandSlots[n] is allocated
+     */
+    uint16_t SlotsInUse;
+    /*
+     * First free slot. Free slots are chained through their Next pointer.
+     */
+    MacCommand_t* FreeSlots;
+    /*
+     * Number of sticky MAC commands in the list
+     */
+    uint8_t StickyCmdsCount;
     /*
      * Size of all MAC commands serialized as buffer
      */
@@ -86,23 +98,34 @@ static LoRaMacCommandsCtx_t CommandsCtx;
 /* Memory management functions */
 
 /*!
- * \brief Determines if a MAC command slot is free
+ * \brief Returns the bitmap mask of a MAC command slot
  *
- * \param[IN]     slot           - Slot to check
- * \retval                       - Status of the operation
+ * \param[IN]     slot           - Slot
+ * \retval                       - Slot mask, 0 if the pointer is not a slot
  */
-static bool IsSlotFree( const MacCommand_t* slot )
+static uint16_t GetSlotMask( const MacCommand_t* slot )
 {
-    uint8_t* mem = ( uint8_t* )slot;
+    if( ( slot < &CommandsCtx.MacCommandSlots[0] ) ||
+        ( slot >= &CommandsCtx.MacCommandSlots[NUM_OF_MAC_COMMANDS] ) )
+    {
+        return 0;
+    }
+    return ( uint16_t )( 1U << ( slot - &CommandsCtx.MacCommandSlots[0] ) );
+}
 
-    for( uint16_t size = 0; size < sizeof( MacCommand_t ); size++ )
+/*!
+ * \brief Builds the free slots chain with all slots
+ */
+static void InitMacCommandSlots( void )
+{
+    for( uint8_t itr = 0; itr < ( NUM_OF_MAC_COMMANDS - 1 ); itr++ )
     {
-        if( mem[size] != 0x00 )
-        {
-            return false;
-        }
+        CommandsCtx.MacCommandSlots[itr].Next = &CommandsCtx.MacCommandSlots[itr + 1];
     }
-    return true;
+    CommandsCtx.MacCommandSlots[NUM_OF_MAC_COMMANDS - 1].Next = NULL;
+
+    CommandsCtx.FreeSlots = &CommandsCtx.MacCommandSlots[0];
+    CommandsCtx.SlotsInUse = 0;
 }
 
 /*!
@@ -112,18 +135,20 @@ static bool IsSlotFree( const MacCommand_t* slot )
  */
 static MacCommand_t* MallocNewMacCommandSlot( void )
 {
-    uint8_t itr = 0;
+    MacCommand_t* slot = CommandsCtx.FreeSlots;
 
-    while( IsSlotFree( ( const MacCommand_t* )&CommandsCtx.MacCommandSlots[itr] ) == false )
+    if( slot == NULL )
     {
-        itr++;
-        if( itr == NUM_OF_MAC_COMMANDS )
-        {
-            return NULL;
-        }
+        return NULL;
     }
 
-    return &CommandsCtx.MacCommandSlots[itr];
+    CommandsCtx.FreeSlots = slot->Next;
+    CommandsCtx.SlotsInUse |= GetSlotMask( slot );
+
+    slot->Next = NULL;
+    slot->Prev = NULL;
+
+    return slot;
 }
 
 /*!
@@ -135,12 +160,17 @@ static MacCommand_t* MallocNewMacCommandSlot( void )
  */
 static bool FreeMacCommandSlot( MacCommand_t* slot )
 {
-    if( slot == NULL )
+    uint16_t mask = GetSlotMask( slot );
+
+    if( ( mask & CommandsCtx.SlotsInUse ) == 0 )
     {
         return false;
     }
 
-    memset1( ( uint8_t* )slot, 0x00, sizeof( MacCommand_t ) );
+    CommandsCtx.SlotsInUse &= ~mask;
+    slot->Prev = NULL;
+    slot->Next = CommandsCtx.FreeSlots;
+    CommandsCtx.FreeSlots = slot;
 
     return true;
 }
@@ -192,7 +222,8 @@ static bool LinkedListAdd( MacCommandsList_t* list, MacCommand_t* element )
         list->Last->Next = element;
     }
 
-    // Update the next point of this entry.
+    // Update the links of this entry.
+    element->Prev = list->Last;
     element->Next = NULL;
 
     // Update the last entry of the list.
@@ -201,42 +232,6 @@ static bool LinkedListAdd( MacCommandsList_t* list, MacCommand_t* element )
     return true;
 }
 
-/*!
- * \brief Return the previous element in the list.
- *
- * \param[IN]     list           - List
- * \param[IN]     element        - Element where the previous element shall be searched
- * \retval                       - Status of the operation
- */
-static MacCommand_t* LinkedListGetPrevious( MacCommandsList_t* list, MacCommand_t* element )
-{
-    if( ( list == NULL ) || ( element == NULL ) )
-    {
-        return NULL;
-    }
-
-    MacCommand_t* curElement;
-
-    // Start at the head of the list
-    curElement = list->First;
-
-    // When current element is the first of the list, there's no previous element so we can return NULL immediately.
-    if( element != curElement )
-    {
-        // Loop through all elements until the end is reached or the next of current is the current element.
-        while( ( curElement != NULL ) && ( curElement->Next != element ) )
-        {
-            curElement = curElement->Next;
-        }
-    }
-    else
-    {
-        curElement = NULL;
-    }
-
-    return curElement;
-}
-
 /*!
  * \brief Remove an element from the list
  *
@@ -251,24 +246,32 @@ static bool LinkedListRemove( MacCommandsList_t* list, MacCommand_t* element )
         return false;
     }
 
-    MacCommand_t* PrevElement = LinkedListGetPrevious( list, element );
+    // Only allocated slots are part of the list
+    if( ( GetSlotMask( element ) & CommandsCtx.SlotsInUse ) == 0 )
+    {
+        return false;
+    }
 
-    if( list->First == element )
+    if( element->Prev != NULL )
+    {
+        element->Prev->Next = element->Next;
+    }
+    else
     {
         list->First = element->Next;
     }
 
-    if( list->Last == element )
+    if( element->Next != NULL )
     {
-        list->Last = PrevElement;
+        element->Next->Prev = element->Prev;
     }
-
-    if( PrevElement != NULL )
+    else
     {
-        PrevElement->Next = element->Next;
+        list->Last = element->Prev;
     }
 
     element->Next = NULL;
+    element->Prev = NULL;
 
     return true;
 }
@@ -299,6 +302,7 @@ LoRaMacCommandStatus_t LoRaMacCommandsInit( void )
     // Initialize with default
     memset1( ( uint8_t* )&CommandsCtx, 0, sizeof( CommandsCtx ) );
 
+    InitMacCommandSlots( );
     LinkedListInit( &CommandsCtx.MacCommandList );
 
     return LORAMAC_COMMANDS_SUCCESS;
@@ -332,6 +336,10 @@ LoRaMacCommandStatus_t LoRaMacCommandsAddCmd( uint8_t cid, uint8_t* payload, siz
     memcpy1( ( uint8_t* )newCmd->Payload, payload, payloadSize );
     newCmd->IsSticky = IsSticky( cid );
 
+    if( newCmd->IsSticky == true )
+    {
+        CommandsCtx.StickyCmdsCount++;
+    }
     CommandsCtx.SerializedCmdsSize += ( CID_FIELD_SIZE + payloadSize );
 
     return LORAMAC_COMMANDS_SUCCESS;
@@ -350,6 +358,10 @@ LoRaMacCommandStatus_t LoRaMacCommandsRemoveCmd( MacCommand_t* macCmd )
         return LORAMAC_COMMANDS_ERROR_CMD_NOT_FOUND;
     }
 
+    if( macCmd->IsSticky == true )
+    {
+        CommandsCtx.StickyCmdsCount--;
+    }
     CommandsCtx.SerializedCmdsSize -= ( CID_FIELD_SIZE + macCmd->PayloadSize );
 
     // Free the MacCommand Slot
@@ -492,22 +504,8 @@ LoRaMacCommandStatus_t LoRaMacCommandsStickyCmdsPending( bool* cmdsPending )
     {
         return LORAMAC_COMMANDS_ERROR_NPE;
     }
-    MacCommand_t* curElement;
-    curElement = CommandsCtx.MacCommandList.First;
-
-    *cmdsPending = false;
 
-    // Loop through all elements
-    while( curElement != NULL )
-    {
-        if( curElement->IsSticky == true )
-        {
-            // Found one sticky MAC command
-            *cmdsPending = true;
-            return LORAMAC_COMMANDS_SUCCESS;
-        }
-        curElement = curElement->Next;
-    }
+    *cmdsPending = ( CommandsCtx.StickyCmdsCount > 0 );
 
     return LORAMAC_COMMANDS_SUCCESS;
 }
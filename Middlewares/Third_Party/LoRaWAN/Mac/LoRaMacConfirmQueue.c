@@ -37,6 +37,15 @@
 #include "LoRaMac.h"
 #include "LoRaMacConfirmQueue.h"
 
+/*!
+ * Number of Mlme_t request types, one bit each in the pending mask
+ */
+#define LORA_MAC_MLME_CONFIRM_QUEUE_TYPES           ( MLME_BEACON_LOST + 1 )
+
+/*!
+ * Slot of a request type which is not in the queue
+ */
+#define LORA_MAC_MLME_CONFIRM_QUEUE_NO_SLOT         0xFF
 
 /*
  * LoRaMac Confirm Queue Context NVM structure
@@ -52,6 +61,22 @@ typedef struct sLoRaMacConfirmQueueNvmData
     */
     uint8_t MlmeConfirmQueueCnt;
     /*!
+    * Index of the first element of the ring buffer
+    */
+    uint8_t First;
+    /*!
+    * Bit n is set while a request of type n is in the queue
+    */
+    uint32_t PendingMask;
+    /*!
+    * Number of elements per request type
+    */
+    uint8_t TypeCnt[LORA_MAC_MLME_CONFIRM_QUEUE_TYPES];
+    /*!
+    * Index of the oldest element per request type
+    */
+    uint8_t TypeSlot[LORA_MAC_MLME_CONFIRM_QUEUE_TYPES];
+    /*!
     * Variable which holds a common status
     */
     LoRaMacEventInfoStatus_t CommonStatus;
@@ -67,14 +92,6 @@ typedef struct sLoRaMacConfirmQueueCtx
     */
     LoRaMacPrimitives_t* Primitives;
     /*!
-    * Pointer to the first element of the ring buffer
-    */
-    MlmeConfirmQueue_t* BufferStart;
-    /*!
-    * Pointer to the last element of the ring buffer
-    */
-    MlmeConfirmQueue_t* BufferEnd;
-    /*!
     * Non-volatile module context.
     */
     LoRaMacConfirmQueueNvmData_t Nvm;
@@ -85,33 +102,15 @@ typedef struct sLoRaMacConfirmQueueCtx
  */
 static LoRaMacConfirmQueueCtx_t ConfirmQueueCtx;
 
-static MlmeConfirmQueue_t* IncreaseBufferPointer( MlmeConfirmQueue_t* bufferPointer )
+static uint8_t GetIndex( uint8_t position )
 {
-    if( bufferPointer == &ConfirmQueueCtx.Nvm.MlmeConfirmQueue[LORA_MAC_MLME_CONFIRM_QUEUE_LEN - 1] )
-    {
-        // Reset to the first element
-        bufferPointer = ConfirmQueueCtx.Nvm.MlmeConfirmQueue;
-    }
-    else
-    {
-        // Increase
-        bufferPointer++;
-    }
-    return bufferPointer;
-}
+    uint8_t index = ConfirmQueueCtx.Nvm.First + position;
 
-static MlmeConfirmQueue_t* DecreaseBufferPointer( MlmeConfirmQueue_t* bufferPointer )
-{
-    if( bufferPointer == ConfirmQueueCtx.Nvm.MlmeConfirmQueue )
+    if( index >= LORA_MAC_MLME_CONFIRM_QUEUE_LEN )
     {
-        // Reset to the last element
-        bufferPointer = &ConfirmQueueCtx.Nvm.MlmeConfirmQueue[LORA_MAC_MLME_CONFIRM_QUEUE_LEN - 1];
+        index -= LORA_MAC_MLME_CONFIRM_QUEUE_LEN;
     }
-    else
-    {
-        bufferPointer--;
-    }
-    return bufferPointer;
+    return index;
 }
 
 static bool IsListEmpty( uint8_t count )
@@ -132,26 +131,69 @@ static bool IsListFull( uint8_t count )
     return false;
 }
 
-static MlmeConfirmQueue_t* GetElement( Mlme_t request, MlmeConfirmQueue_t* bufferStart, MlmeConfirmQueue_t* bufferEnd )
+static bool IsTypeValid( Mlme_t request )
 {
-    MlmeConfirmQueue_t* element = bufferStart;
+    return ( uint32_t )request < LORA_MAC_MLME_CONFIRM_QUEUE_TYPES;
+}
 
-    if( IsListEmpty( ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt ) == true )
+static MlmeConfirmQueue_t* GetElement( Mlme_t request )
+{
+    if( ( IsTypeValid( request ) == false ) || ( ( ConfirmQueueCtx.Nvm.PendingMask & ( 1UL << request ) ) == 0 ) )
     {
         return NULL;
     }
+    return &ConfirmQueueCtx.Nvm.MlmeConfirmQueue[ConfirmQueueCtx.Nvm.TypeSlot[request]];
+}
 
-    for( uint8_t elementCnt = 0; elementCnt < ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt; elementCnt++ )
+/*!
+ * \brief Registers the element at the given index in the pending mask
+ */
+static void AddType( uint8_t index )
+{
+    Mlme_t request = ConfirmQueueCtx.Nvm.MlmeConfirmQueue[index].Request;
+
+    if( IsTypeValid( request ) == false )
+    {
+        return;
+    }
+    if( ConfirmQueueCtx.Nvm.TypeCnt[request]++ == 0 )
     {
-        if( element->Request == request )
+        ConfirmQueueCtx.Nvm.PendingMask |= 1UL << request;
+        ConfirmQueueCtx.Nvm.TypeSlot[request] = index;
+    }
+}
+
+/*!
+ * \brief Unregisters the element at the given index, already removed from
+ *        the ring buffer
+ */
+static void RemoveType( uint8_t index )
+{
+    Mlme_t request = ConfirmQueueCtx.Nvm.MlmeConfirmQueue[index].Request;
+
+    if( ( IsTypeValid( request ) == false ) || ( ConfirmQueueCtx.Nvm.TypeCnt[request] == 0 ) )
+    {
+        return;
+    }
+    if( --ConfirmQueueCtx.Nvm.TypeCnt[request] == 0 )
+    {
+        ConfirmQueueCtx.Nvm.PendingMask &= ~( 1UL << request );
+        ConfirmQueueCtx.Nvm.TypeSlot[request] = LORA_MAC_MLME_CONFIRM_QUEUE_NO_SLOT;
+        return;
+    }
+    if( ConfirmQueueCtx.Nvm.TypeSlot[request] != index )
+    {
+        return;
+    }
+    // Several requests of the same type, the oldest one left takes over
+    for( uint8_t i = 0; i < ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt; i++ )
+    {
+        if( ConfirmQueueCtx.Nvm.MlmeConfirmQueue[GetIndex( i )].Request == request )
         {
-            // We have found the element
-            return element;
+            ConfirmQueueCtx.Nvm.TypeSlot[request] = GetIndex( i );
+            return;
         }
-        element = IncreaseBufferPointer( element );
     }
-
-    return NULL;
 }
 
 void LoRaMacConfirmQueueInit( LoRaMacPrimitives_t* primitives )
@@ -162,17 +204,23 @@ void LoRaMacConfirmQueueInit( LoRaMacPrimitives_t* primitives )
     ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt = 0;
 
     // Init buffer
-    ConfirmQueueCtx.BufferStart = ConfirmQueueCtx.Nvm.MlmeConfirmQueue;
-    ConfirmQueueCtx.BufferEnd = ConfirmQueueCtx.Nvm.MlmeConfirmQueue;
+    ConfirmQueueCtx.Nvm.First = 0;
 
     memset1( ( uint8_t* )ConfirmQueueCtx.Nvm.MlmeConfirmQueue, 0xFF, sizeof( ConfirmQueueCtx.Nvm.MlmeConfirmQueue ) );
 
+    // Init request types
+    ConfirmQueueCtx.Nvm.PendingMask = 0;
+    memset1( ConfirmQueueCtx.Nvm.TypeCnt, 0, sizeof( ConfirmQueueCtx.Nvm.TypeCnt ) );
+    memset1( ConfirmQueueCtx.Nvm.TypeSlot, LORA_MAC_MLME_CONFIRM_QUEUE_NO_SLOT, sizeof( ConfirmQueueCtx.Nvm.TypeSlot ) );
+
     // Common status
     ConfirmQueueCtx.Nvm.CommonStatus = LORAMAC_EVENT_INFO_STATUS_ERROR;
 }
 
 bool LoRaMacConfirmQueueAdd( MlmeConfirmQueue_t* mlmeConfirm )
 {
+    uint8_t index;
+
     if( IsListFull( ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt ) == true )
     {
         // Protect the buffer against overwrites
@@ -180,14 +228,14 @@ bool LoRaMacConfirmQueueAdd( MlmeConfirmQueue_t* mlmeConfirm )
     }
 
     // Add the element to the ring buffer
-    ConfirmQueueCtx.BufferEnd->Request = mlmeConfirm->Request;
-    ConfirmQueueCtx.BufferEnd->Status = mlmeConfirm->Status;
-    ConfirmQueueCtx.BufferEnd->RestrictCommonReadyToHandle = mlmeConfirm->RestrictCommonReadyToHandle;
-    ConfirmQueueCtx.BufferEnd->ReadyToHandle = false;
+    index = GetIndex( ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt );
+    ConfirmQueueCtx.Nvm.MlmeConfirmQueue[index].Request = mlmeConfirm->Request;
+    ConfirmQueueCtx.Nvm.MlmeConfirmQueue[index].Status = mlmeConfirm->Status;
+    ConfirmQueueCtx.Nvm.MlmeConfirmQueue[index].RestrictCommonReadyToHandle = mlmeConfirm->RestrictCommonReadyToHandle;
+    ConfirmQueueCtx.Nvm.MlmeConfirmQueue[index].ReadyToHandle = false;
     // Increase counter
     ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt++;
-    // Update end pointer
-    ConfirmQueueCtx.BufferEnd = IncreaseBufferPointer( ConfirmQueueCtx.BufferEnd );
+    AddType( index );
 
     return true;
 }
@@ -199,78 +247,68 @@ bool LoRaMacConfirmQueueRemoveLast( void )
         return false;
     }
 
-    // Increase counter
+    // Decrease counter
     ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt--;
-    // Update start pointer
-    ConfirmQueueCtx.BufferEnd = DecreaseBufferPointer( ConfirmQueueCtx.BufferEnd );
+    RemoveType( GetIndex( ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt ) );
 
     return true;
 }
 
 bool LoRaMacConfirmQueueRemoveFirst( void )
 {
+    uint8_t index = ConfirmQueueCtx.Nvm.First;
+
     if( IsListEmpty( ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt ) == true )
     {
         return false;
     }
 
-    // Increase counter
+    // Decrease counter
     ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt--;
-    // Update start pointer
-    ConfirmQueueCtx.BufferStart = IncreaseBufferPointer( ConfirmQueueCtx.BufferStart );
+    // Update first index
+    ConfirmQueueCtx.Nvm.First = GetIndex( 1 );
+    RemoveType( index );
 
     return true;
 }
 
 void LoRaMacConfirmQueueSetStatus( LoRaMacEventInfoStatus_t status, Mlme_t request )
 {
-    MlmeConfirmQueue_t* element = NULL;
+    MlmeConfirmQueue_t* element = GetElement( request );
 
-    if( IsListEmpty( ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt ) == false )
+    if( element != NULL )
     {
-        element = GetElement( request, ConfirmQueueCtx.BufferStart, ConfirmQueueCtx.BufferEnd );
-        if( element != NULL )
-        {
-            element->Status = status;
-            element->ReadyToHandle = true;
-        }
+        element->Status = status;
+        element->ReadyToHandle = true;
     }
 }
 
 LoRaMacEventInfoStatus_t LoRaMacConfirmQueueGetStatus( Mlme_t request )
 {
-    MlmeConfirmQueue_t* element = NULL;
+    MlmeConfirmQueue_t* element = GetElement( request );
 
-    if( IsListEmpty( ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt ) == false )
+    if( element != NULL )
     {
-        element = GetElement( request, ConfirmQueueCtx.BufferStart, ConfirmQueueCtx.BufferEnd );
-        if( element != NULL )
-        {
-            return element->Status;
-        }
+        return element->Status;
     }
     return LORAMAC_EVENT_INFO_STATUS_ERROR;
 }
 
 void LoRaMacConfirmQueueSetStatusCmn( LoRaMacEventInfoStatus_t status )
 {
-    MlmeConfirmQueue_t* element = ConfirmQueueCtx.BufferStart;
-
     ConfirmQueueCtx.Nvm.CommonStatus = status;
 
-    if( IsListEmpty( ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt ) == false )
+    for( uint8_t i = 0; i < ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt; i++ )
     {
-        do
+        MlmeConfirmQueue_t* element = &ConfirmQueueCtx.Nvm.MlmeConfirmQueue[GetIndex( i )];
+
+        element->Status = status;
+        // Set the status if it is allowed to set it with a call to
+        // LoRaMacConfirmQueueSetStatusCmn.
+        if( element->RestrictCommonReadyToHandle == false )
         {
-            element->Status = status;
-            // Set the status if it is allowed to set it with a call to
-            // LoRaMacConfirmQueueSetStatusCmn.
-            if( element->RestrictCommonReadyToHandle == false )
-            {
-                element->ReadyToHandle = true;
-            }
-            element = IncreaseBufferPointer( element );
-        }while( element != ConfirmQueueCtx.BufferEnd );
+            element->ReadyToHandle = true;
+        }
     }
 }
 
@@ -281,7 +319,7 @@ LoRaMacEventInfoStatus_t LoRaMacConfirmQueueGetStatusCmn( void )
 
 bool LoRaMacConfirmQueueIsCmdActive( Mlme_t request )
 {
-    if( GetElement( request, ConfirmQueueCtx.BufferStart, ConfirmQueueCtx.BufferEnd ) != NULL )
+    if( GetElement( request ) != NULL )
     {
         return true;
     }
@@ -290,36 +328,41 @@ bool LoRaMacConfirmQueueIsCmdActive( Mlme_t request )
 
 void LoRaMacConfirmQueueHandleCb( MlmeConfirm_t* mlmeConfirm )
 {
+    MlmeConfirmQueue_t ready[LORA_MAC_MLME_CONFIRM_QUEUE_LEN];
     uint8_t nbElements = ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt;
-    bool readyToHandle = false;
-    MlmeConfirmQueue_t mlmeConfirmToStore;
+    uint8_t nbReady = 0;
+    uint8_t nbKept = 0;
 
+    // Take the handled requests out of the queue and pack the pending ones
+    // from the first index, in order, before any callback can add a request
     for( uint8_t i = 0; i < nbElements; i++ )
     {
-        mlmeConfirm->MlmeRequest = ConfirmQueueCtx.BufferStart->Request;
-        mlmeConfirm->Status = ConfirmQueueCtx.BufferStart->Status;
-        readyToHandle = ConfirmQueueCtx.BufferStart->ReadyToHandle;
+        MlmeConfirmQueue_t* element = &ConfirmQueueCtx.Nvm.MlmeConfirmQueue[GetIndex( i )];
 
-        if( readyToHandle == true )
+        if( element->ReadyToHandle == true )
         {
-            ConfirmQueueCtx.Primitives->MacMlmeConfirm( mlmeConfirm );
+            ready[nbReady++] = *element;
         }
         else
         {
-            // The request is not processed yet. Store the state.
-            mlmeConfirmToStore.Request = ConfirmQueueCtx.BufferStart->Request;
-            mlmeConfirmToStore.Status = ConfirmQueueCtx.BufferStart->Status;
-            mlmeConfirmToStore.RestrictCommonReadyToHandle = ConfirmQueueCtx.BufferStart->RestrictCommonReadyToHandle;
+            ConfirmQueueCtx.Nvm.MlmeConfirmQueue[GetIndex( nbKept++ )] = *element;
         }
+    }
 
-        // Increase the pointer afterwards to prevent overwrites
-        LoRaMacConfirmQueueRemoveFirst( );
+    ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt = 0;
+    ConfirmQueueCtx.Nvm.PendingMask = 0;
+    memset1( ConfirmQueueCtx.Nvm.TypeCnt, 0, sizeof( ConfirmQueueCtx.Nvm.TypeCnt ) );
+    for( uint8_t i = 0; i < nbKept; i++ )
+    {
+        ConfirmQueueCtx.Nvm.MlmeConfirmQueueCnt++;
+        AddType( GetIndex( i ) );
+    }
 
-        if( readyToHandle == false )
-        {
-            // Add a request which has not been finished again to the queue
-            LoRaMacConfirmQueueAdd( &mlmeConfirmToStore );
-        }
+    for( uint8_t i = 0; i < nbReady; i++ )
+    {
+        mlmeConfirm->MlmeRequest = ready[i].Request;
+        mlmeConfirm->Status = ready[i].Status;
+        ConfirmQueueCtx.Primitives->MacMlmeConfirm( mlmeConfirm );
     }
 }
 
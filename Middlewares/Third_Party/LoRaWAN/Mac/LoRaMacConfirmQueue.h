@@ -31,9 +31,11 @@
  * \defgroup  LORAMACCONFIRMQUEUE LoRa MAC confirm queue implementation
  *            This module specifies the API implementation of the LoRaMAC confirm queue.
  *            The confirm queue is implemented with as a ring buffer. The number of
- *            elements can be defined with \ref LORA_MAC_MLME_CONFIRM_QUEUE_LEN. The
- *            current implementation does not support multiple elements of the same
- *            Mlme_t type.
+ *            elements can be defined with \ref LORA_MAC_MLME_CONFIRM_QUEUE_LEN. A
+ *            mask of the pending Mlme_t types and the index of their oldest element
+ *            make the status and activity lookups constant time. When several
+ *            elements of the same Mlme_t type are queued, the lookups address the
+ *            oldest one.
  * \{
  */
 #ifndef __LORAMAC_CONFIRMQUEUE_H__
@@ -152,6 +154,9 @@ bool LoRaMacConfirmQueueIsCmdActive( Mlme_t request );
 /*!
  * \brief   Handles all callbacks of active requests
  *
+ *          The handled requests leave the queue before their callbacks, in the
+ *          order they were added. The callbacks may add new requests.
+ *
  * \param   [IN] mlmeConfirm - Pointer to the generic mlmeConfirm structure.
  */
 void LoRaMacConfirmQueueHandleCb( MlmeConfirm_t* mlmeConfirm );
@@ -0,0 +1,354 @@
+/*!
+ * \file      LoRaMacEnergy.c
+ *
+ * \brief     Energy ledger of the end-device
+ */
+#include <stddef.h>
+
+#include "LoRaMacEnergy.h"
+
+#if ( LORAMAC_ENERGY_ENABLED == 1 )
+
+#include "timer.h"
+
+/*!
+ * Time base of the ledger [ms]
+ */
+#ifndef LORAMAC_ENERGY_GET_TIME
+#define LORAMAC_ENERGY_GET_TIME( )                  TimerGetCurrentTime( )
+#endif
+
+/*!
+ * Charge unit of the accumulators, uA.ms, per nAh
+ */
+#define ENERGY_UAMS_PER_NAH                         3600
+
+/*!
+ * No tag on the radio operation
+ */
+#define ENERGY_NO_TAG                               LORAMAC_ENERGY_ACTIVITIES
+
+/*!
+ * Typical STM32WL currents at 3.3 V with the SMPS, high power PA. To be
+ * replaced by the measurements of the board with LoRaMacEnergySetTable.
+ */
+static const LoRaMacEnergyTable_t DefaultTable =
+{
+    .RadioSleep = 1,
+    .RadioStandby = 600,
+    .RadioRx = 4800,
+    .RadioTx =
+    {
+        20000, 21000, 22000, 23000, 24000, 25500, 27000, 28500,     //  0 ..  7 dBm
+        30000, 31500, 33000, 35000, 37000, 39500, 42000, 45000,     //  8 .. 15 dBm
+        48000, 58000, 65000, 72000, 85000, 100000, 118000           // 16 .. 22 dBm
+    },
+    .Mcu =
+    {
+        3400,   // Run, 48 MHz
+        1000,   // Sleep
+        2,      // Stop 2
+        1       // Standby
+    },
+};
+
+static const char *ActivityNames[LORAMAC_ENERGY_ACTIVITIES] =
+{
+    "idle",
+    "uplink",
+    "beacon",
+    "ping-slot",
+    "class-c",
+    "application",
+};
+
+static LoRaMacEnergyTable_t Table;
+
+/*!
+ * Accounting state, everything before LastTime is accounted
+ */
+static TimerTime_t LastTime;
+static RadioPowerState_t RadioState;
+static int8_t TxPower;
+static LoRaMacEnergyMcuMode_t McuMode;
+static LoRaMacEnergyActivity_t Background;
+static LoRaMacEnergyActivity_t RadioTag;
+static bool RadioTagStarted;
+
+/*!
+ * Cumulative ledger, charges in uA.ms
+ */
+static uint64_t Charge[LORAMAC_ENERGY_ACTIVITIES];
+static LoRaMacEnergyTotals_t Totals;
+
+/*!
+ * Open uplink and last closed one
+ */
+static bool UplinkOpen;
+static TimerTime_t UplinkStart;
+static uint64_t UplinkCharge;
+static LoRaMacEnergyUplink_t Uplink;
+static LoRaMacEnergyUplink_t LastUplink;
+static bool LastUplinkValid;
+
+static uint32_t GetRadioCurrent( void )
+{
+    int8_t power = TxPower;
+
+    switch( RadioState )
+    {
+        case RADIO_POWER_TX:
+            if( power < LORAMAC_ENERGY_TX_POWER_MIN )
+            {
+                power = LORAMAC_ENERGY_TX_POWER_MIN;
+            }
+            if( power > LORAMAC_ENERGY_TX_POWER_MAX )
+            {
+                power = LORAMAC_ENERGY_TX_POWER_MAX;
+            }
+            return Table.RadioTx[power - LORAMAC_ENERGY_TX_POWER_MIN];
+        case RADIO_POWER_RX:
+            return Table.RadioRx;
+        case RADIO_POWER_STANDBY:
+            return Table.RadioStandby;
+        default:
+            return Table.RadioSleep;
+    }
+}
+
+/*!
+ * \brief Accounts the time elapsed since the previous update in the current
+ *        states, must be called before any state change
+ */
+static void Update( void )
+{
+    TimerTime_t now = LORAMAC_ENERGY_GET_TIME( );
+    uint32_t elapsed = ( uint32_t )( now - LastTime );
+    LoRaMacEnergyActivity_t radioActivity = Background;
+    LoRaMacEnergyActivity_t mcuActivity = Background;
+    uint64_t radioCharge;
+    uint64_t mcuCharge;
+
+    LastTime = now;
+    if( elapsed == 0 )
+    {
+        return;
+    }
+
+    if( UplinkOpen == true )
+    {
+        radioActivity = LORAMAC_ENERGY_UPLINK;
+        mcuActivity = LORAMAC_ENERGY_UPLINK;
+    }
+    if( ( RadioTag != ENERGY_NO_TAG ) && ( ( RadioState == RADIO_POWER_RX ) || ( RadioState == RADIO_POWER_TX ) ) )
+    {
+        radioActivity = RadioTag;
+    }
+
+    radioCharge = ( uint64_t )GetRadioCurrent( ) * elapsed;
+    mcuCharge = ( uint64_t )Table.Mcu[McuMode] * elapsed;
+    Charge[radioActivity] += radioCharge;
+    Charge[mcuActivity] += mcuCharge;
+
+    Totals.Time += elapsed;
+    Totals.RadioTime[RadioState] += elapsed;
+    Totals.McuTime[McuMode] += elapsed;
+
+    if( UplinkOpen == true )
+    {
+        if( radioActivity == LORAMAC_ENERGY_UPLINK )
+        {
+            UplinkCharge += radioCharge;
+            if( RadioState == RADIO_POWER_TX )
+            {
+                Uplink.TxTime += elapsed;
+            }
+            else if( RadioState == RADIO_POWER_RX )
+            {
+                Uplink.RxTime += elapsed;
+            }
+        }
+        UplinkCharge += mcuCharge;
+    }
+}
+
+void LoRaMacEnergyInit( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+    Table = DefaultTable;
+    LastTime = LORAMAC_ENERGY_GET_TIME( );
+    RadioState = RADIO_POWER_SLEEP;
+    TxPower = 0;
+    McuMode = LORAMAC_ENERGY_MCU_RUN;
+    Background = LORAMAC_ENERGY_IDLE;
+    RadioTag = ENERGY_NO_TAG;
+    RadioTagStarted = false;
+    for( uint8_t i = 0; i < LORAMAC_ENERGY_ACTIVITIES; i++ )
+    {
+        Charge[i] = 0;
+    }
+    Totals = ( LoRaMacEnergyTotals_t ){ 0 };
+    UplinkOpen = false;
+    LastUplinkValid = false;
+    CRITICAL_SECTION_END( );
+}
+
+void LoRaMacEnergySetTable( const LoRaMacEnergyTable_t *table )
+{
+    if( table == NULL )
+    {
+        return;
+    }
+    CRITICAL_SECTION_BEGIN( );
+    Update( );
+    Table = *table;
+    CRITICAL_SECTION_END( );
+}
+
+void LoRaMacEnergyGetTable( LoRaMacEnergyTable_t *table )
+{
+    if( table != NULL )
+    {
+        *table = Table;
+    }
+}
+
+void LoRaMacEnergyRadioState( RadioPowerState_t state, int8_t power )
+{
+    if( state >= LORAMAC_ENERGY_RADIO_STATES )
+    {
+        return;
+    }
+    CRITICAL_SECTION_BEGIN( );
+    Update( );
+    if( ( state == RADIO_POWER_RX ) || ( state == RADIO_POWER_TX ) )
+    {
+        RadioTagStarted = ( RadioTag != ENERGY_NO_TAG );
+    }
+    else if( RadioTagStarted == true )
+    {
+        // The tagged operation is over, the sleep and standby transitions of
+        // its setup do not end it
+        RadioTag = ENERGY_NO_TAG;
+        RadioTagStarted = false;
+    }
+    RadioState = state;
+    TxPower = power;
+    CRITICAL_SECTION_END( );
+}
+
+void LoRaMacEnergyMcuMode( LoRaMacEnergyMcuMode_t mode )
+{
+    if( mode >= LORAMAC_ENERGY_MCU_MODES )
+    {
+        return;
+    }
+    CRITICAL_SECTION_BEGIN( );
+    Update( );
+    McuMode = mode;
+    CRITICAL_SECTION_END( );
+}
+
+void LoRaMacEnergyRadioActivity( LoRaMacEnergyActivity_t activity )
+{
+    if( activity >= LORAMAC_ENERGY_ACTIVITIES )
+    {
+        return;
+    }
+    CRITICAL_SECTION_BEGIN( );
+    Update( );
+    RadioTag = activity;
+    RadioTagStarted = false;
+    CRITICAL_SECTION_END( );
+}
+
+LoRaMacEnergyActivity_t LoRaMacEnergySetActivity( LoRaMacEnergyActivity_t activity )
+{
+    LoRaMacEnergyActivity_t previous = Background;
+
+    if( activity >= LORAMAC_ENERGY_ACTIVITIES )
+    {
+        return previous;
+    }
+    CRITICAL_SECTION_BEGIN( );
+    Update( );
+    Background = activity;
+    CRITICAL_SECTION_END( );
+    return previous;
+}
+
+void LoRaMacEnergyUplinkStart( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+    Update( );
+    // A tag left by a window which did not open does not take the uplink
+    RadioTag = ENERGY_NO_TAG;
+    RadioTagStarted = false;
+    if( UplinkOpen == false )
+    {
+        UplinkOpen = true;
+        UplinkStart = LastTime;
+        UplinkCharge = 0;
+        Uplink = ( LoRaMacEnergyUplink_t ){ 0 };
+    }
+    if( Uplink.Transmissions < UINT8_MAX )
+    {
+        Uplink.Transmissions++;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+void LoRaMacEnergyUplinkEnd( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+    Update( );
+    if( UplinkOpen == true )
+    {
+        UplinkOpen = false;
+        Uplink.Duration = ( uint32_t )( LastTime - UplinkStart );
+        Uplink.Charge = ( uint32_t )( UplinkCharge / ENERGY_UAMS_PER_NAH );
+        LastUplink = Uplink;
+        LastUplinkValid = true;
+        Totals.Uplinks++;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+bool LoRaMacEnergyGetLastUplink( LoRaMacEnergyUplink_t *uplink )
+{
+    if( ( uplink == NULL ) || ( LastUplinkValid == false ) )
+    {
+        return false;
+    }
+    CRITICAL_SECTION_BEGIN( );
+    *uplink = LastUplink;
+    CRITICAL_SECTION_END( );
+    return true;
+}
+
+void LoRaMacEnergyGetTotals( LoRaMacEnergyTotals_t *totals )
+{
+    if( totals == NULL )
+    {
+        return;
+    }
+    CRITICAL_SECTION_BEGIN( );
+    Update( );
+    *totals = Totals;
+    for( uint8_t i = 0; i < LORAMAC_ENERGY_ACTIVITIES; i++ )
+    {
+        totals->Charge[i] = Charge[i] / ENERGY_UAMS_PER_NAH;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+const char *LoRaMacEnergyGetActivityName( LoRaMacEnergyActivity_t activity )
+{
+    if( activity >= LORAMAC_ENERGY_ACTIVITIES )
+    {
+        return "unknown";
+    }
+    return ActivityNames[activity];
+}
+
+#endif /* LORAMAC_ENERGY_ENABLED == 1 */
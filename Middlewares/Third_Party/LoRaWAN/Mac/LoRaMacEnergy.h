@@ -0,0 +1,290 @@
+/*!
+ * \file      LoRaMacEnergy.h
+ *
+ * \brief     Energy ledger of the end-device
+ *
+ * \details   Integrates the time spent by the radio in each power state
+ *            (TX at the power of the last TX configuration, RX, standby,
+ *            sleep) and by the MCU in each low power mode, and turns it into
+ *            charge with a table of supply currents.
+ *
+ *            The charge is attributed to the activity which caused it. An
+ *            uplink is opened by its first transmission and closed when its
+ *            confirm is handed to the application, it takes its
+ *            retransmissions, its RX windows and the MCU time in between. A
+ *            radio operation tagged by the MAC (beacon, ping slot, class C
+ *            window) goes to its tag from the start of its reception until
+ *            the radio is back to standby or sleep. Everything else goes to the background activity set by
+ *            the application.
+ *
+ *            The radio states are reported by the PowerStateChanged radio
+ *            event, the MCU modes by the low power driver of the
+ *            application with LORAMAC_ENERGY_MCU_MODE.
+ *
+ *            The ledger is compiled in when LORAMAC_ENERGY_ENABLED is set to
+ *            1 in lorawan_conf.h, otherwise the hooks expand to nothing.
+ */
+#ifndef __LORAMAC_ENERGY_H__
+#define __LORAMAC_ENERGY_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lorawan_conf.h"
+#include "radio.h"
+
+#ifndef LORAMAC_ENERGY_ENABLED
+#define LORAMAC_ENERGY_ENABLED                      0
+#endif
+
+/*!
+ * Range of the TX current table [dBm], TX powers outside are clamped
+ */
+#define LORAMAC_ENERGY_TX_POWER_MIN                 0
+#define LORAMAC_ENERGY_TX_POWER_MAX                 22
+#define LORAMAC_ENERGY_TX_POWERS                    ( LORAMAC_ENERGY_TX_POWER_MAX - LORAMAC_ENERGY_TX_POWER_MIN + 1 )
+
+/*!
+ * Number of radio power states, see RadioPowerState_t
+ */
+#define LORAMAC_ENERGY_RADIO_STATES                 ( RADIO_POWER_TX + 1 )
+
+/*!
+ * MCU modes
+ */
+typedef enum eLoRaMacEnergyMcuMode
+{
+    /*!
+     * Running
+     */
+    LORAMAC_ENERGY_MCU_RUN,
+    /*!
+     * Sleep mode, the core is stopped
+     */
+    LORAMAC_ENERGY_MCU_SLEEP,
+    /*!
+     * Stop mode
+     */
+    LORAMAC_ENERGY_MCU_STOP,
+    /*!
+     * Standby or shutdown mode
+     */
+    LORAMAC_ENERGY_MCU_OFF,
+    LORAMAC_ENERGY_MCU_MODES
+}LoRaMacEnergyMcuMode_t;
+
+/*!
+ * Activities the charge is attributed to
+ */
+typedef enum eLoRaMacEnergyActivity
+{
+    /*!
+     * Nothing in particular, sleep between the activities
+     */
+    LORAMAC_ENERGY_IDLE,
+    /*!
+     * Uplink, from its first transmission to its confirm
+     */
+    LORAMAC_ENERGY_UPLINK,
+    /*!
+     * Class B beacon reception
+     */
+    LORAMAC_ENERGY_BEACON,
+    /*!
+     * Class B unicast and multicast ping slots
+     */
+    LORAMAC_ENERGY_PING_SLOT,
+    /*!
+     * Class C continuous reception
+     */
+    LORAMAC_ENERGY_CLASS_C,
+    /*!
+     * Application processing, sensor polls, ...
+     */
+    LORAMAC_ENERGY_APPLICATION,
+    LORAMAC_ENERGY_ACTIVITIES
+}LoRaMacEnergyActivity_t;
+
+/*!
+ * Supply currents [uA]. The radio currents come on top of the MCU current.
+ */
+typedef struct sLoRaMacEnergyTable
+{
+    /*!
+     * Radio in sleep, standby and RX
+     */
+    uint32_t RadioSleep;
+    uint32_t RadioStandby;
+    uint32_t RadioRx;
+    /*!
+     * Radio in TX, from LORAMAC_ENERGY_TX_POWER_MIN to
+     * LORAMAC_ENERGY_TX_POWER_MAX by 1 dBm
+     */
+    uint32_t RadioTx[LORAMAC_ENERGY_TX_POWERS];
+    /*!
+     * MCU in each mode
+     */
+    uint32_t Mcu[LORAMAC_ENERGY_MCU_MODES];
+}LoRaMacEnergyTable_t;
+
+/*!
+ * Ledger of an uplink
+ */
+typedef struct sLoRaMacEnergyUplink
+{
+    /*!
+     * First transmission to confirm [ms]
+     */
+    uint32_t Duration;
+    /*!
+     * Radio time in TX and in RX [ms]
+     */
+    uint32_t TxTime;
+    uint32_t RxTime;
+    /*!
+     * Number of transmissions, retransmissions included
+     */
+    uint8_t Transmissions;
+    /*!
+     * Charge [nAh]
+     */
+    uint32_t Charge;
+}LoRaMacEnergyUplink_t;
+
+/*!
+ * Cumulative ledger
+ */
+typedef struct sLoRaMacEnergyTotals
+{
+    /*!
+     * Time accounted [ms]
+     */
+    uint32_t Time;
+    /*!
+     * Charge of each activity [nAh]
+     */
+    uint64_t Charge[LORAMAC_ENERGY_ACTIVITIES];
+    /*!
+     * Time spent in each radio power state and in each MCU mode [ms]
+     */
+    uint32_t RadioTime[LORAMAC_ENERGY_RADIO_STATES];
+    uint32_t McuTime[LORAMAC_ENERGY_MCU_MODES];
+    /*!
+     * Number of uplinks closed
+     */
+    uint32_t Uplinks;
+}LoRaMacEnergyTotals_t;
+
+#if ( LORAMAC_ENERGY_ENABLED == 1 )
+#define LORAMAC_ENERGY_INIT( )                      LoRaMacEnergyInit( )
+#define LORAMAC_ENERGY_UPLINK_START( )              LoRaMacEnergyUplinkStart( )
+#define LORAMAC_ENERGY_UPLINK_END( )                LoRaMacEnergyUplinkEnd( )
+#define LORAMAC_ENERGY_RADIO_ACTIVITY( activity )   LoRaMacEnergyRadioActivity( activity )
+#define LORAMAC_ENERGY_MCU_MODE( mode )             LoRaMacEnergyMcuMode( mode )
+#else
+#define LORAMAC_ENERGY_INIT( )
+#define LORAMAC_ENERGY_UPLINK_START( )
+#define LORAMAC_ENERGY_UPLINK_END( )
+#define LORAMAC_ENERGY_RADIO_ACTIVITY( activity )
+#define LORAMAC_ENERGY_MCU_MODE( mode )
+#endif
+
+/*!
+ * \brief Clears the ledger and starts the accounting with the radio asleep,
+ *        the MCU running and the default current table
+ */
+void LoRaMacEnergyInit( void );
+
+/*!
+ * \brief Sets the current table
+ *
+ * \param [IN] table Supply currents, copied
+ */
+void LoRaMacEnergySetTable( const LoRaMacEnergyTable_t *table );
+
+/*!
+ * \brief Gets the current table
+ *
+ * \param [OUT] table Supply currents
+ */
+void LoRaMacEnergyGetTable( LoRaMacEnergyTable_t *table );
+
+/*!
+ * \brief Reports a radio power state change, PowerStateChanged radio event
+ *
+ * \param [IN] state New power state
+ * \param [IN] power TX power [dBm], used in RADIO_POWER_TX
+ */
+void LoRaMacEnergyRadioState( RadioPowerState_t state, int8_t power );
+
+/*!
+ * \brief Reports an MCU mode change
+ *
+ * \param [IN] mode New mode
+ */
+void LoRaMacEnergyMcuMode( LoRaMacEnergyMcuMode_t mode );
+
+/*!
+ * \brief Tags the next radio operation, from its RX or TX start up to the
+ *        return of the radio to standby or sleep
+ *
+ * \param [IN] activity Activity of the operation
+ */
+void LoRaMacEnergyRadioActivity( LoRaMacEnergyActivity_t activity );
+
+/*!
+ * \brief Sets the background activity
+ *
+ * \param [IN] activity Activity taking the charge outside the uplinks and
+ *                      the tagged radio operations
+ *
+ * \retval previous Previous background activity
+ */
+LoRaMacEnergyActivity_t LoRaMacEnergySetActivity( LoRaMacEnergyActivity_t activity );
+
+/*!
+ * \brief Opens an uplink on its first transmission, counts a retransmission
+ *        of the open one
+ */
+void LoRaMacEnergyUplinkStart( void );
+
+/*!
+ * \brief Closes the open uplink, nothing when none is open
+ */
+void LoRaMacEnergyUplinkEnd( void );
+
+/*!
+ * \brief Gets the ledger of the last closed uplink
+ *
+ * \param [OUT] uplink Ledger of the uplink
+ *
+ * \retval status Returns false when no uplink was closed yet
+ */
+bool LoRaMacEnergyGetLastUplink( LoRaMacEnergyUplink_t *uplink );
+
+/*!
+ * \brief Gets the cumulative ledger, accounted up to now
+ *
+ * \param [OUT] totals Cumulative ledger
+ */
+void LoRaMacEnergyGetTotals( LoRaMacEnergyTotals_t *totals );
+
+/*!
+ * \brief Gets the printable name of an activity
+ *
+ * \param [IN] activity Activity
+ *
+ * \retval name Activity name
+ */
+const char *LoRaMacEnergyGetActivityName( LoRaMacEnergyActivity_t activity );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __LORAMAC_ENERGY_H__
@@ -0,0 +1,271 @@
+/*!
+ * \file      LoRaMacLinkQuality.c
+ *
+ * \brief     Device side link quality tracker and datarate / TX power policy
+ */
+#include <stddef.h>
+
+#include "Region.h"
+#include "LoRaMacLinkQuality.h"
+
+#if ( LORAMAC_LINK_QUALITY_ENABLED == 1 )
+
+/*!
+ * Noise floor over 125 kHz, -174 dBm/Hz + 51 dB + 6 dB noise figure
+ */
+#define LORAMAC_LINK_QUALITY_NOISE_FLOOR            -117
+
+/*!
+ * TX power step between two TX power indexes in dB
+ */
+#define LORAMAC_LINK_QUALITY_TX_POWER_STEP          2
+
+/*!
+ * \brief Gets the spreading factor of a datarate, 0 for a non LoRa datarate
+ */
+static uint8_t GetSpreadingFactor( LoRaMacRegion_t region, int8_t datarate )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+
+    getPhy.Attribute = PHY_SF_FROM_DR;
+    getPhy.Datarate = datarate;
+    phyParam = RegionGetPhyParam( region, &getPhy );
+    if( ( phyParam.Value < 5 ) || ( phyParam.Value > 12 ) )
+    {
+        return 0;
+    }
+    return ( uint8_t )phyParam.Value;
+}
+
+/*!
+ * \brief Gets the SNR gain, in dB, of a 125 kHz channel over the channel of
+ *        a datarate
+ */
+static int16_t GetBandwidthGain( LoRaMacRegion_t region, int8_t datarate )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+
+    getPhy.Attribute = PHY_BW_FROM_DR;
+    getPhy.Datarate = datarate;
+    phyParam = RegionGetPhyParam( region, &getPhy );
+    // 0: 125 kHz, 1: 250 kHz, 2: 500 kHz
+    return ( int16_t )( 3 * phyParam.Value );
+}
+
+/*!
+ * \brief Gets the demodulation floor of a spreading factor in dB, -20 dB at
+ *        SF12 and 2.5 dB more per SF, rounded up
+ */
+static int16_t GetDemodFloor( uint8_t sf )
+{
+    return -20 + ( 5 * ( 12 - ( int16_t )sf ) + 1 ) / 2;
+}
+
+static void AddSample( LoRaMacLinkQuality_t *lq, int16_t budget, int16_t rssi, int8_t snr, bool linkCheck )
+{
+    LoRaMacLinkQualitySample_t *sample = &lq->Samples[lq->Index];
+
+    sample->Budget = budget;
+    sample->Rssi = rssi;
+    sample->Snr = snr;
+    sample->LinkCheck = linkCheck;
+    sample->Uplink = lq->Uplinks;
+
+    lq->Index = ( lq->Index + 1 ) % LORAMAC_LINK_QUALITY_WINDOW;
+    if( lq->Count < LORAMAC_LINK_QUALITY_WINDOW )
+    {
+        lq->Count++;
+    }
+}
+
+/*!
+ * \brief Gets the worst budget of the fresh samples
+ *
+ * \retval count Number of fresh samples
+ */
+static uint8_t GetEstimate( LoRaMacLinkQuality_t *lq, int16_t *budget, uint32_t *age )
+{
+    uint8_t count = 0;
+
+    *age = UINT32_MAX;
+    for( uint8_t i = 0; i < lq->Count; i++ )
+    {
+        uint32_t sampleAge = lq->Uplinks - lq->Samples[i].Uplink;
+
+        if( sampleAge >= LORAMAC_LINK_QUALITY_MAX_AGE )
+        {
+            continue;
+        }
+        if( ( count == 0 ) || ( lq->Samples[i].Budget < *budget ) )
+        {
+            *budget = lq->Samples[i].Budget;
+        }
+        if( sampleAge < *age )
+        {
+            *age = sampleAge;
+        }
+        count++;
+    }
+    return count;
+}
+
+void LoRaMacLinkQualityInit( LoRaMacLinkQuality_t *lq )
+{
+    lq->Count = 0;
+    lq->Index = 0;
+    lq->Uplinks = 0;
+    lq->LinkCheckUplink = 0;
+    lq->LinkCheckSent = false;
+    lq->Datarate = DR_0;
+    lq->TxPower = TX_POWER_0;
+}
+
+void LoRaMacLinkQualityAddDownlink( LoRaMacLinkQuality_t *lq, LoRaMacRegion_t region, int8_t datarate, int16_t rssi,
+                                    int8_t snr, bool rx2 )
+{
+    int16_t gain = GetBandwidthGain( region, datarate );
+    int16_t level = snr;
+
+    if( GetSpreadingFactor( region, datarate ) == 0 )
+    {
+        return;
+    }
+    // Above saturation the SNR no longer follows the signal, the RSSI does
+    if( snr >= LORAMAC_LINK_QUALITY_SNR_SATURATION )
+    {
+        int16_t rssiSnr = rssi - ( LORAMAC_LINK_QUALITY_NOISE_FLOOR + gain );
+
+        if( rssiSnr > level )
+        {
+            level = rssiSnr;
+        }
+    }
+    AddSample( lq, level + gain + ( ( rx2 == true ) ? LORAMAC_LINK_QUALITY_RX2_OFFSET : LORAMAC_LINK_QUALITY_RX1_OFFSET ),
+               rssi, snr, false );
+}
+
+void LoRaMacLinkQualityAddLinkCheck( LoRaMacLinkQuality_t *lq, LoRaMacRegion_t region, int8_t txDatarate,
+                                     int8_t txPower, uint8_t demodMargin )
+{
+    uint8_t sf = GetSpreadingFactor( region, txDatarate );
+
+    lq->LinkCheckSent = false;
+    if( sf == 0 )
+    {
+        return;
+    }
+    // The margin is the one of the uplink over the floor of its datarate
+    AddSample( lq, ( int16_t )demodMargin + GetDemodFloor( sf ) + GetBandwidthGain( region, txDatarate ) +
+                   LORAMAC_LINK_QUALITY_TX_POWER_STEP * txPower, 0, ( int8_t )demodMargin, true );
+}
+
+void LoRaMacLinkQualityOnUplink( LoRaMacLinkQuality_t *lq, bool linkCheck )
+{
+    lq->Uplinks++;
+    if( linkCheck == true )
+    {
+        lq->LinkCheckUplink = lq->Uplinks;
+        lq->LinkCheckSent = true;
+    }
+}
+
+bool LoRaMacLinkQualityGetBudget( LoRaMacLinkQuality_t *lq, int16_t *budget )
+{
+    int16_t estimate = 0;
+    uint32_t age;
+
+    if( GetEstimate( lq, &estimate, &age ) < LORAMAC_LINK_QUALITY_MIN_SAMPLES )
+    {
+        return false;
+    }
+    if( budget != NULL )
+    {
+        *budget = estimate;
+    }
+    return true;
+}
+
+bool LoRaMacLinkQualityCalcNext( LoRaMacLinkQuality_t *lq, LoRaMacLinkQualityParams_t *params, int8_t *drOut,
+                                 int8_t *txPowOut )
+{
+    VerifyParams_t verify;
+    int16_t budget = 0;
+    uint32_t age;
+    uint8_t count = GetEstimate( lq, &budget, &age );
+    bool linkCheckReq = false;
+    int8_t datarate = params->Datarate;
+    int8_t txPower = params->TxPower;
+
+    // A LinkCheckReq is due while samples are missing or when the newest
+    // one gets old, a lost answer is retried after the same period
+    if( ( ( count < LORAMAC_LINK_QUALITY_MIN_SAMPLES ) || ( age >= LORAMAC_LINK_QUALITY_LINK_CHECK_PERIOD ) ) &&
+        ( ( lq->LinkCheckSent == false ) ||
+          ( ( lq->Uplinks - lq->LinkCheckUplink ) >= LORAMAC_LINK_QUALITY_LINK_CHECK_PERIOD ) ) )
+    {
+        linkCheckReq = true;
+    }
+
+    if( params->AdrEnabled == true )
+    {
+        // The network server owns the datarate and the TX power
+        *drOut = params->Datarate;
+        *txPowOut = params->TxPower;
+        return false;
+    }
+
+    if( count >= LORAMAC_LINK_QUALITY_MIN_SAMPLES )
+    {
+        bool found = false;
+
+        for( int8_t dr = LORAMAC_LINK_QUALITY_MAX_DATARATE; ( dr >= params->Datarate ) && ( found == false ); dr-- )
+        {
+            uint8_t sf = GetSpreadingFactor( params->Region, dr );
+            int8_t power;
+
+            verify.DatarateParams.Datarate = dr;
+            verify.DatarateParams.UplinkDwellTime = params->UplinkDwellTime;
+            if( ( sf == 0 ) || ( RegionVerify( params->Region, &verify, PHY_TX_DR ) == false ) )
+            {
+                continue;
+            }
+            // Lowest TX power first, the TX power index grows as the power
+            // decreases
+            power = params->TxPower;
+            verify.TxPower = power + 1;
+            while( RegionVerify( params->Region, &verify, PHY_TX_POWER ) == true )
+            {
+                power++;
+                verify.TxPower = power + 1;
+            }
+            for( ; power >= params->TxPower; power-- )
+            {
+                int16_t margin = budget - GetBandwidthGain( params->Region, dr ) -
+                                 LORAMAC_LINK_QUALITY_TX_POWER_STEP * power - GetDemodFloor( sf );
+                int16_t required = LORAMAC_LINK_QUALITY_MARGIN;
+
+                // Hold the last proposal unless the margin clearly allows more
+                if( ( dr > lq->Datarate ) || ( ( dr == lq->Datarate ) && ( power > lq->TxPower ) ) )
+                {
+                    required += LORAMAC_LINK_QUALITY_HYSTERESIS;
+                }
+                if( margin >= required )
+                {
+                    datarate = dr;
+                    txPower = power;
+                    found = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    lq->Datarate = datarate;
+    lq->TxPower = txPower;
+    *drOut = datarate;
+    *txPowOut = txPower;
+    return linkCheckReq;
+}
+
+#endif /* LORAMAC_LINK_QUALITY_ENABLED == 1 */
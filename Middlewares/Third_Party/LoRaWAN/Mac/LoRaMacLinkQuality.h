@@ -0,0 +1,297 @@
+/*!
+ * \file      LoRaMacLinkQuality.h
+ *
+ * \brief     Device side link quality tracker and datarate / TX power policy
+ *
+ * \details   Keeps a sliding window of the link quality samples the device
+ *            gets for free or almost: the SNR / RSSI of every downlink it
+ *            receives in RX1 / RX2 and the demodulation margin of the
+ *            LinkCheckAns MAC command.
+ *
+ *            Every sample is normalised to a link budget: the SNR, in dB
+ *            over 125 kHz, an uplink sent at the maximum TX power would be
+ *            received with. LinkCheckAns samples measure the uplink itself,
+ *            downlink samples are corrected by LORAMAC_LINK_QUALITY_RX1_OFFSET
+ *            or LORAMAC_LINK_QUALITY_RX2_OFFSET for the gateway transmit
+ *            power. The estimate is the worst budget of the samples received
+ *            in the last LORAMAC_LINK_QUALITY_MAX_AGE uplinks.
+ *
+ *            LoRaMacLinkQualityCalcNext proposes the highest datarate, then
+ *            the lowest TX power, that keeps LORAMAC_LINK_QUALITY_MARGIN dB
+ *            above the demodulation floor. The application datarate and TX
+ *            power are the safe defaults: the proposal is never below the
+ *            application datarate, so the payload always fits, nor above
+ *            the application TX power. Without enough fresh samples the
+ *            application settings are used and a LinkCheckReq is requested,
+ *            so a degrading link falls back to them within
+ *            LORAMAC_LINK_QUALITY_MAX_AGE uplinks.
+ *
+ *            When ADR is enabled the datarate and TX power belong to the
+ *            network server (LinkADRReq) and to the ADR back-off of
+ *            LoRaMacAdr.c: the samples are still collected but the policy
+ *            returns the current settings unchanged. An application served
+ *            by a slow network server can disable ADR to let the policy
+ *            drive its unconfirmed traffic.
+ *
+ *            The tracker is compiled in LmHandler when
+ *            LORAMAC_LINK_QUALITY_ENABLED is set to 1 in lorawan_conf.h.
+ */
+#ifndef __LORAMAC_LINK_QUALITY_H__
+#define __LORAMAC_LINK_QUALITY_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lorawan_conf.h"
+#include "LoRaMac.h"
+
+#ifndef LORAMAC_LINK_QUALITY_ENABLED
+#define LORAMAC_LINK_QUALITY_ENABLED                0
+#endif
+
+/*!
+ * Number of samples kept in the window
+ */
+#ifndef LORAMAC_LINK_QUALITY_WINDOW
+#define LORAMAC_LINK_QUALITY_WINDOW                 8
+#endif
+
+/*!
+ * Number of fresh samples needed before the policy departs from the
+ * application settings
+ */
+#ifndef LORAMAC_LINK_QUALITY_MIN_SAMPLES
+#define LORAMAC_LINK_QUALITY_MIN_SAMPLES            2
+#endif
+
+/*!
+ * Number of uplinks after which a sample is discarded
+ */
+#ifndef LORAMAC_LINK_QUALITY_MAX_AGE
+#define LORAMAC_LINK_QUALITY_MAX_AGE                32
+#endif
+
+/*!
+ * Number of uplinks without a new sample after which a LinkCheckReq is
+ * requested, and minimum number of uplinks between two requests
+ */
+#ifndef LORAMAC_LINK_QUALITY_LINK_CHECK_PERIOD
+#define LORAMAC_LINK_QUALITY_LINK_CHECK_PERIOD      8
+#endif
+
+/*!
+ * Margin, in dB, kept above the demodulation floor
+ */
+#ifndef LORAMAC_LINK_QUALITY_MARGIN
+#define LORAMAC_LINK_QUALITY_MARGIN                 8
+#endif
+
+/*!
+ * Additional margin, in dB, needed to raise the datarate or lower the TX
+ * power
+ */
+#ifndef LORAMAC_LINK_QUALITY_HYSTERESIS
+#define LORAMAC_LINK_QUALITY_HYSTERESIS             2
+#endif
+
+/*!
+ * Correction, in dB, from the SNR of an RX1 downlink to the uplink budget:
+ * device maximum EIRP minus gateway RX1 power. 0 on EU868 (16 dBm versus
+ * 14 dBm) errs on the safe side.
+ */
+#ifndef LORAMAC_LINK_QUALITY_RX1_OFFSET
+#define LORAMAC_LINK_QUALITY_RX1_OFFSET             0
+#endif
+
+/*!
+ * Correction, in dB, from the SNR of an RX2 downlink to the uplink budget.
+ * RX2 is usually sent at a higher power (27 dBm on EU868 869.525 MHz).
+ */
+#ifndef LORAMAC_LINK_QUALITY_RX2_OFFSET
+#define LORAMAC_LINK_QUALITY_RX2_OFFSET             -11
+#endif
+
+/*!
+ * Downlink SNR, in dB, from which the radio SNR is saturated and the RSSI
+ * above the noise floor is used instead
+ */
+#ifndef LORAMAC_LINK_QUALITY_SNR_SATURATION
+#define LORAMAC_LINK_QUALITY_SNR_SATURATION         10
+#endif
+
+/*!
+ * Highest datarate proposed
+ */
+#ifndef LORAMAC_LINK_QUALITY_MAX_DATARATE
+#define LORAMAC_LINK_QUALITY_MAX_DATARATE           DR_5
+#endif
+
+/*!
+ * Link quality sample
+ */
+typedef struct sLoRaMacLinkQualitySample
+{
+    /*!
+     * Uplink SNR at maximum TX power over 125 kHz in dB
+     */
+    int16_t Budget;
+    /*!
+     * Measured RSSI in dBm, 0 for a LinkCheckAns
+     */
+    int16_t Rssi;
+    /*!
+     * Measured SNR in dB, or demodulation margin for a LinkCheckAns
+     */
+    int8_t Snr;
+    /*!
+     * Sample is a LinkCheckAns
+     */
+    bool LinkCheck;
+    /*!
+     * Uplink counter of the tracker when the sample was received
+     */
+    uint32_t Uplink;
+}LoRaMacLinkQualitySample_t;
+
+/*!
+ * Link quality tracker
+ */
+typedef struct sLoRaMacLinkQuality
+{
+    /*!
+     * Samples window
+     */
+    LoRaMacLinkQualitySample_t Samples[LORAMAC_LINK_QUALITY_WINDOW];
+    /*!
+     * Number of samples in the window
+     */
+    uint8_t Count;
+    /*!
+     * Index of the next sample
+     */
+    uint8_t Index;
+    /*!
+     * Number of uplinks sent
+     */
+    uint32_t Uplinks;
+    /*!
+     * Uplink counter of the last LinkCheckReq
+     */
+    uint32_t LinkCheckUplink;
+    /*!
+     * A LinkCheckReq has been requested
+     */
+    bool LinkCheckSent;
+    /*!
+     * Last proposed datarate
+     */
+    int8_t Datarate;
+    /*!
+     * Last proposed TX power
+     */
+    int8_t TxPower;
+}LoRaMacLinkQuality_t;
+
+/*!
+ * Parameter structure for the function LoRaMacLinkQualityCalcNext
+ */
+typedef struct sLoRaMacLinkQualityParams
+{
+    /*!
+     * Region
+     */
+    LoRaMacRegion_t Region;
+    /*!
+     * Uplink dwell time
+     */
+    uint8_t UplinkDwellTime;
+    /*!
+     * Set to true if ADR is enabled
+     */
+    bool AdrEnabled;
+    /*!
+     * Application datarate, current datarate when ADR is enabled
+     */
+    int8_t Datarate;
+    /*!
+     * Application TX power, current TX power when ADR is enabled
+     */
+    int8_t TxPower;
+}LoRaMacLinkQualityParams_t;
+
+/*!
+ * \brief Clears the samples and the proposal
+ *
+ * \param [IN] lq Tracker
+ */
+void LoRaMacLinkQualityInit( LoRaMacLinkQuality_t *lq );
+
+/*!
+ * \brief Adds the sample of a downlink received in RX1 or RX2
+ *
+ * \param [IN] lq       Tracker
+ * \param [IN] region   Region
+ * \param [IN] datarate Downlink datarate
+ * \param [IN] rssi     Downlink RSSI in dBm
+ * \param [IN] snr      Downlink SNR in dB
+ * \param [IN] rx2      Set to true if received in RX2
+ */
+void LoRaMacLinkQualityAddDownlink( LoRaMacLinkQuality_t *lq, LoRaMacRegion_t region, int8_t datarate, int16_t rssi,
+                                    int8_t snr, bool rx2 );
+
+/*!
+ * \brief Adds the sample of a LinkCheckAns
+ *
+ * \param [IN] lq          Tracker
+ * \param [IN] region      Region
+ * \param [IN] txDatarate  Datarate of the LinkCheckReq uplink
+ * \param [IN] txPower     TX power of the LinkCheckReq uplink
+ * \param [IN] demodMargin Demodulation margin in dB
+ */
+void LoRaMacLinkQualityAddLinkCheck( LoRaMacLinkQuality_t *lq, LoRaMacRegion_t region, int8_t txDatarate,
+                                     int8_t txPower, uint8_t demodMargin );
+
+/*!
+ * \brief Ages the samples, to be called once per uplink
+ *
+ * \param [IN] lq         Tracker
+ * \param [IN] linkCheck  Set to true if the uplink carries a LinkCheckReq
+ */
+void LoRaMacLinkQualityOnUplink( LoRaMacLinkQuality_t *lq, bool linkCheck );
+
+/*!
+ * \brief Gets the link budget estimate
+ *
+ * \param [IN]  lq     Tracker
+ * \param [OUT] budget Worst uplink SNR at maximum TX power over 125 kHz in dB
+ *
+ * \retval valid Returns false without LORAMAC_LINK_QUALITY_MIN_SAMPLES
+ *               fresh samples
+ */
+bool LoRaMacLinkQualityGetBudget( LoRaMacLinkQuality_t *lq, int16_t *budget );
+
+/*!
+ * \brief Proposes the datarate and the TX power of the next unconfirmed
+ *        uplink
+ *
+ * \param [IN]  lq       Tracker
+ * \param [IN]  params   Current settings
+ * \param [OUT] drOut    Datarate of the next uplink
+ * \param [OUT] txPowOut TX power of the next uplink
+ *
+ * \retval linkCheckReq Returns true if the next uplink should carry a
+ *                      LinkCheckReq
+ */
+bool LoRaMacLinkQualityCalcNext( LoRaMacLinkQuality_t *lq, LoRaMacLinkQualityParams_t *params, int8_t *drOut,
+                                 int8_t *txPowOut );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __LORAMAC_LINK_QUALITY_H__
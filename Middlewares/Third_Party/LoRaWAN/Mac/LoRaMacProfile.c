@@ -0,0 +1,193 @@
+/*!
+ * \file      LoRaMacProfile.c
+ *
+ * \brief     Downlink processing time instrumentation
+ */
+#include <stddef.h>
+
+#include "LoRaMacProfile.h"
+
+#if ( LORAMAC_PROFILE_ENABLED == 1 )
+
+#if defined( __arm__ )
+/*
+ * Cortex-M debug registers, the middleware does not include the device
+ * header so the data watchpoint and trace unit is addressed directly
+ */
+#define PROFILE_DEMCR                               ( *( volatile uint32_t * )0xE000EDFCUL )
+#define PROFILE_DEMCR_TRCENA                        ( 1UL << 24 )
+#define PROFILE_DWT_CTRL                            ( *( volatile uint32_t * )0xE0001000UL )
+#define PROFILE_DWT_CTRL_CYCCNTENA                  ( 1UL << 0 )
+#define PROFILE_DWT_CYCCNT                          ( *( volatile uint32_t * )0xE0001004UL )
+#else
+#include <time.h>
+#endif
+
+static const char *StageNames[LORAMAC_PROFILE_STAGE_MAX] =
+{
+    "dispatch",
+    "parse",
+    "fcnt",
+    "crypto",
+    "mac-commands",
+    "nvm",
+    "indication",
+    "total",
+};
+
+static LoRaMacProfileStats_t Stats[LORAMAC_PROFILE_STAGE_MAX];
+
+/*!
+ * Tick of the RX done event and of the previous mark of the armed
+ * measurement
+ */
+static uint32_t StartTick;
+static uint32_t MarkTick;
+static bool Armed = false;
+
+static void Account( LoRaMacProfileStage_t stage, uint32_t ticks )
+{
+    LoRaMacProfileStats_t *stats = &Stats[stage];
+
+    if( ( stats->Count == 0 ) || ( ticks < stats->Min ) )
+    {
+        stats->Min = ticks;
+    }
+    if( ticks > stats->Max )
+    {
+        stats->Max = ticks;
+    }
+    stats->Last = ticks;
+    stats->Sum += ticks;
+    stats->Count++;
+}
+
+void LoRaMacProfileInit( void )
+{
+#if defined( __arm__ )
+    PROFILE_DEMCR |= PROFILE_DEMCR_TRCENA;
+    PROFILE_DWT_CYCCNT = 0;
+    PROFILE_DWT_CTRL |= PROFILE_DWT_CTRL_CYCCNTENA;
+#endif
+    LoRaMacProfileReset( );
+}
+
+void LoRaMacProfileReset( void )
+{
+    for( uint8_t i = 0; i < LORAMAC_PROFILE_STAGE_MAX; i++ )
+    {
+        Stats[i] = ( LoRaMacProfileStats_t ){ 0 };
+    }
+    Armed = false;
+}
+
+uint32_t LoRaMacProfileGetTicks( void )
+{
+#if defined( __arm__ )
+    return PROFILE_DWT_CYCCNT;
+#else
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( uint32_t )( ( uint64_t )now.tv_sec * 1000000000ULL + ( uint64_t )now.tv_nsec );
+#endif
+}
+
+void LoRaMacProfileStart( void )
+{
+    StartTick = LoRaMacProfileGetTicks( );
+    MarkTick = StartTick;
+    Armed = true;
+}
+
+void LoRaMacProfileMark( LoRaMacProfileStage_t stage )
+{
+    uint32_t now = LoRaMacProfileGetTicks( );
+
+    if( Armed == false )
+    {
+        return;
+    }
+    Account( stage, now - MarkTick );
+    MarkTick = now;
+}
+
+void LoRaMacProfileEnd( LoRaMacProfileStage_t stage )
+{
+    uint32_t now = LoRaMacProfileGetTicks( );
+
+    if( Armed == false )
+    {
+        return;
+    }
+    Account( stage, now - MarkTick );
+    Account( LORAMAC_PROFILE_TOTAL, now - StartTick );
+    Armed = false;
+}
+
+void LoRaMacProfileAbort( void )
+{
+    Armed = false;
+}
+
+bool LoRaMacProfileGetStats( LoRaMacProfileStage_t stage, LoRaMacProfileStats_t *stats )
+{
+    if( ( stage >= LORAMAC_PROFILE_STAGE_MAX ) || ( stats == NULL ) )
+    {
+        return false;
+    }
+    *stats = Stats[stage];
+    return true;
+}
+
+const char *LoRaMacProfileGetStageName( LoRaMacProfileStage_t stage )
+{
+    if( stage >= LORAMAC_PROFILE_STAGE_MAX )
+    {
+        return "unknown";
+    }
+    return StageNames[stage];
+}
+
+#else /* LORAMAC_PROFILE_ENABLED */
+
+void LoRaMacProfileInit( void )
+{
+}
+
+void LoRaMacProfileReset( void )
+{
+}
+
+uint32_t LoRaMacProfileGetTicks( void )
+{
+    return 0;
+}
+
+void LoRaMacProfileStart( void )
+{
+}
+
+void LoRaMacProfileMark( LoRaMacProfileStage_t stage )
+{
+}
+
+void LoRaMacProfileEnd( LoRaMacProfileStage_t stage )
+{
+}
+
+void LoRaMacProfileAbort( void )
+{
+}
+
+bool LoRaMacProfileGetStats( LoRaMacProfileStage_t stage, LoRaMacProfileStats_t *stats )
+{
+    return false;
+}
+
+const char *LoRaMacProfileGetStageName( LoRaMacProfileStage_t stage )
+{
+    return "unknown";
+}
+
+#endif /* LORAMAC_PROFILE_ENABLED */
@@ -0,0 +1,196 @@
+/*!
+ * \file      LoRaMacProfile.h
+ *
+ * \brief     Downlink processing time instrumentation
+ *
+ * \details   Measures each stage of a downlink, from the radio RX done
+ *            interrupt to the application indication, with the DWT cycle
+ *            counter on target and CLOCK_MONOTONIC on a host build.
+ *
+ *            The instrumentation is compiled in when LORAMAC_PROFILE_ENABLED
+ *            is set to 1 in lorawan_conf.h, otherwise the marks expand to
+ *            nothing.
+ *
+ *            A measurement is armed by LORAMAC_PROFILE_START on RX done,
+ *            every LORAMAC_PROFILE_MARK accounts the time elapsed since the
+ *            previous mark to its stage, and LORAMAC_PROFILE_END closes the
+ *            measurement and accounts the whole chain to
+ *            LORAMAC_PROFILE_TOTAL. A frame dropped on the way (wrong
+ *            address, MIC failure, ...) is closed with LORAMAC_PROFILE_ABORT
+ *            and does not update the total.
+ */
+#ifndef __LORAMAC_PROFILE_H__
+#define __LORAMAC_PROFILE_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lorawan_conf.h"
+
+#ifndef LORAMAC_PROFILE_ENABLED
+#define LORAMAC_PROFILE_ENABLED                     0
+#endif
+
+/*!
+ * Number of profile ticks per microsecond: core cycles on target (the
+ * STM32WL runs the LoRaWAN stack at 48 MHz), nanoseconds on a host build
+ */
+#ifndef LORAMAC_PROFILE_TICKS_PER_US
+#if defined( __arm__ )
+#define LORAMAC_PROFILE_TICKS_PER_US                48
+#else
+#define LORAMAC_PROFILE_TICKS_PER_US                1000
+#endif
+#endif
+
+/*!
+ * Downlink processing stages, in processing order
+ */
+typedef enum eLoRaMacProfileStage
+{
+    /*!
+     * RX done interrupt up to the start of ProcessRadioRxDone
+     */
+    LORAMAC_PROFILE_DISPATCH,
+    /*!
+     * Frame parsing, frame type and address matching
+     */
+    LORAMAC_PROFILE_PARSE,
+    /*!
+     * Downlink frame counter resolution
+     */
+    LORAMAC_PROFILE_FCNT,
+    /*!
+     * MIC verification and payload decryption
+     */
+    LORAMAC_PROFILE_CRYPTO,
+    /*!
+     * MAC commands processing
+     */
+    LORAMAC_PROFILE_MAC_COMMANDS,
+    /*!
+     * End of the frame processing, MAC state machine and NVM bookkeeping
+     */
+    LORAMAC_PROFILE_NVM,
+    /*!
+     * Indication up to the application RX data callback
+     */
+    LORAMAC_PROFILE_INDICATION,
+    /*!
+     * Whole chain, RX done interrupt to the application callback
+     */
+    LORAMAC_PROFILE_TOTAL,
+    LORAMAC_PROFILE_STAGE_MAX
+}LoRaMacProfileStage_t;
+
+/*!
+ * Statistics of a stage, in profile ticks
+ */
+typedef struct sLoRaMacProfileStats
+{
+    /*!
+     * Number of measurements
+     */
+    uint32_t Count;
+    /*!
+     * Last measurement
+     */
+    uint32_t Last;
+    /*!
+     * Shortest measurement
+     */
+    uint32_t Min;
+    /*!
+     * Longest measurement
+     */
+    uint32_t Max;
+    /*!
+     * Sum of the measurements
+     */
+    uint64_t Sum;
+}LoRaMacProfileStats_t;
+
+#if ( LORAMAC_PROFILE_ENABLED == 1 )
+#define LORAMAC_PROFILE_INIT( )                     LoRaMacProfileInit( )
+#define LORAMAC_PROFILE_START( )                    LoRaMacProfileStart( )
+#define LORAMAC_PROFILE_MARK( stage )               LoRaMacProfileMark( stage )
+#define LORAMAC_PROFILE_END( stage )                LoRaMacProfileEnd( stage )
+#define LORAMAC_PROFILE_ABORT( )                    LoRaMacProfileAbort( )
+#else
+#define LORAMAC_PROFILE_INIT( )
+#define LORAMAC_PROFILE_START( )
+#define LORAMAC_PROFILE_MARK( stage )
+#define LORAMAC_PROFILE_END( stage )
+#define LORAMAC_PROFILE_ABORT( )
+#endif
+
+/*!
+ * \brief Starts the tick counter and clears the statistics
+ */
+void LoRaMacProfileInit( void );
+
+/*!
+ * \brief Clears the statistics
+ */
+void LoRaMacProfileReset( void );
+
+/*!
+ * \brief Reads the tick counter
+ *
+ * \retval ticks Current value of the free running tick counter
+ */
+uint32_t LoRaMacProfileGetTicks( void );
+
+/*!
+ * \brief Arms a measurement, called on the radio RX done event
+ */
+void LoRaMacProfileStart( void );
+
+/*!
+ * \brief Accounts the time elapsed since the previous mark to a stage
+ *
+ * \param [IN] stage Stage which just completed
+ */
+void LoRaMacProfileMark( LoRaMacProfileStage_t stage );
+
+/*!
+ * \brief Accounts the last stage and the whole chain, disarms the measurement
+ *
+ * \param [IN] stage Stage which just completed
+ */
+void LoRaMacProfileEnd( LoRaMacProfileStage_t stage );
+
+/*!
+ * \brief Disarms the measurement of a dropped frame
+ */
+void LoRaMacProfileAbort( void );
+
+/*!
+ * \brief Gets the statistics of a stage
+ *
+ * \param [IN]  stage Stage to report
+ * \param [OUT] stats Statistics of the stage
+ *
+ * \retval status Returns false for an unknown stage
+ */
+bool LoRaMacProfileGetStats( LoRaMacProfileStage_t stage, LoRaMacProfileStats_t *stats );
+
+/*!
+ * \brief Gets the printable name of a stage
+ *
+ * \param [IN] stage Stage
+ *
+ * \retval name Stage name
+ */
+const char *LoRaMacProfileGetStageName( LoRaMacProfileStage_t stage );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __LORAMAC_PROFILE_H__
@@ -68,7 +68,9 @@ extern "C"
 /*!
  * Maximum number of multicast context
  */
+#ifndef LORAMAC_MAX_MC_CTX
 #define LORAMAC_MAX_MC_CTX                          1 /* ST_WORKAROUND: reduced LORAMAC_MAX_MC_CTX */
+#endif
 
 /*!
  * Region       | SF
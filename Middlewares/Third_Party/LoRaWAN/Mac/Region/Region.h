@@ -768,6 +768,38 @@ typedef enum eAlternateDrType
     ALTERNATE_DR_RESTORE
 }AlternateDrType_t;
 
+/*!
+ * Listen before talk scan, filled by RegionNextChannel in regions which
+ * require a carrier sense before the uplink.
+ */
+typedef struct sLbtScan
+{
+    /*!
+     * Candidate channels, in scan order
+     */
+    uint8_t Channels[REGION_NVM_MAX_NB_CHANNELS];
+    /*!
+     * Frequencies of the candidate channels
+     */
+    uint32_t Frequencies[REGION_NVM_MAX_NB_CHANNELS];
+    /*!
+     * Number of candidate channels, 0 when the region does not require LBT
+     */
+    uint8_t NbChannels;
+    /*!
+     * Receiver bandwidth of the carrier sense
+     */
+    uint32_t RxBandwidth;
+    /*!
+     * RSSI threshold above which a channel is busy
+     */
+    int16_t RssiThreshold;
+    /*!
+     * Carrier sense time per channel [ms]
+     */
+    uint32_t CarrierSenseTime;
+}LbtScan_t;
+
 /*!
  * Parameter structure for the function RegionNextChannel.
  */
@@ -805,6 +837,11 @@ typedef struct sNextChanParams
      * Payload length of the next frame
      */
     uint16_t PktLen;
+    /*!
+     * When not NULL, a region which requires listen before talk returns its
+     * candidate channels here instead of performing a blocking carrier sense
+     */
+    LbtScan_t* LbtScan;
 }NextChanParams_t;
 
 /*!
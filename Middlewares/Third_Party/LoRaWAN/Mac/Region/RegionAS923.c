@@ -1004,6 +1004,26 @@ LoRaMacStatus_t RegionAS923NextChannel( NextChanParams_t* nextChanParams, uint8_
         // Executes the LBT algorithm when operating in Japan
         uint8_t channelNext = 0;
 
+        if( nextChanParams->LbtScan != NULL )
+        {
+            // The MAC performs the carrier sense in the background and
+            // transmits on the first free candidate
+            LbtScan_t* lbtScan = nextChanParams->LbtScan;
+
+            for( uint8_t i = 0, j = randr( 0, nbEnabledChannels - 1 ); i < nbEnabledChannels; i++ )
+            {
+                lbtScan->Channels[i] = enabledChannels[j];
+                lbtScan->Frequencies[i] = RegionNvmGroup2->Channels[enabledChannels[j]].Frequency;
+                j = ( j + 1 ) % nbEnabledChannels;
+            }
+            lbtScan->NbChannels = nbEnabledChannels;
+            lbtScan->RxBandwidth = AS923_LBT_RX_BANDWIDTH;
+            lbtScan->RssiThreshold = AS923_RSSI_FREE_TH;
+            lbtScan->CarrierSenseTime = AS923_CARRIER_SENSE_TIME;
+            *channel = lbtScan->Channels[0];
+            return LORAMAC_STATUS_OK;
+        }
+
         for( uint8_t  i = 0, j = randr( 0, nbEnabledChannels - 1 ); i < AS923_MAX_NB_CHANNELS; i++ )
         {
             channelNext = enabledChannels[j];
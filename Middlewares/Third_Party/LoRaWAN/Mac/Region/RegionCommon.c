@@ -346,8 +346,10 @@ TimerTime_t RegionCommonUpdateBandTimeOff( bool joined, Band_t* bands,
 
         // Check if the band is ready for transmission. Its ready,
         // when the duty cycle is off, or the TimeCredits of the band
-        // is higher than the credit costs for the transmission.
-        if( ( bands[i].TimeCredits > creditCosts ) ||
+        // cover the credit costs for the transmission. A band short of
+        // credits always has a time to wait above 0, else the delayed
+        // transmission is never scheduled.
+        if( ( bands[i].TimeCredits >= creditCosts ) ||
             ( ( dutyCycleEnabled == false ) && ( joined == true ) ) )
         {
             bands[i].ReadyForTransmission = true;
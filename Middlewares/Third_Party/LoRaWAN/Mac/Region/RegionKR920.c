@@ -886,6 +886,26 @@ LoRaMacStatus_t RegionKR920NextChannel( NextChanParams_t* nextChanParams, uint8_
 
     if( status == LORAMAC_STATUS_OK )
     {
+        if( nextChanParams->LbtScan != NULL )
+        {
+            // The MAC performs the carrier sense in the background and
+            // transmits on the first free candidate
+            LbtScan_t* lbtScan = nextChanParams->LbtScan;
+
+            for( uint8_t i = 0, j = randr( 0, nbEnabledChannels - 1 ); i < nbEnabledChannels; i++ )
+            {
+                lbtScan->Channels[i] = enabledChannels[j];
+                lbtScan->Frequencies[i] = RegionNvmGroup2->Channels[enabledChannels[j]].Frequency;
+                j = ( j + 1 ) % nbEnabledChannels;
+            }
+            lbtScan->NbChannels = nbEnabledChannels;
+            lbtScan->RxBandwidth = KR920_LBT_RX_BANDWIDTH;
+            lbtScan->RssiThreshold = KR920_RSSI_FREE_TH;
+            lbtScan->CarrierSenseTime = KR920_CARRIER_SENSE_TIME;
+            *channel = lbtScan->Channels[0];
+            return LORAMAC_STATUS_OK;
+        }
+
         for( uint8_t  i = 0, j = randr( 0, nbEnabledChannels - 1 ); i < KR920_MAX_NB_CHANNELS; i++ )
         {
             channelNext = enabledChannels[j];
@@ -0,0 +1,328 @@
+/*!
+ * \file      adctest.c
+ *
+ * \brief     Host test of the ADC sampling service of the end node
+ *
+ * \details   Runs adc_service.c on the host against a simulated ADC. The
+ *            simulated scan returns the programmed conversion values of
+ *            VREFINT, the temperature sensor and VBAT, and only completes
+ *            when the test delivers its DMA interrupt, or when the service
+ *            waits for it.
+ *
+ *            Each case checks the conversions with calibrated and typical
+ *            temperature sensor parameters, that cached reads leave the ADC
+ *            alone, that a stale measurement is served while it is refreshed
+ *            in the background and that failed scans keep the cache.
+ *
+ *            Usage: adctest
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adc_service.h"
+
+/* Factory calibration of the simulated device */
+#define ADCTEST_VREFINT_CAL                         1652
+#define ADCTEST_TS_CAL1                             1040
+#define ADCTEST_TS_CAL2                             1380
+
+#define CHECK( cond )                                                         \
+    do                                                                        \
+    {                                                                         \
+        if( !( cond ) )                                                       \
+        {                                                                     \
+            printf( "FAIL %s line %d: %s\n", __func__, __LINE__, #cond );     \
+            return false;                                                     \
+        }                                                                     \
+    }while( 0 )
+
+typedef struct AdcTestCase_s
+{
+    const char *Name;
+    bool ( *Run )( void );
+}AdcTestCase_t;
+
+/* Simulated ADC */
+static uint16_t Programmed[ADC_SERVICE_CHANNELS];
+static uint16_t *ScanDestination;
+static bool ScanRunning;
+static bool StartFails;
+static bool ScanHangs;
+static uint32_t Aborts;
+static uint32_t Starts;
+static uint32_t Now;
+
+static bool SimStartScan( uint16_t *samples )
+{
+    if( StartFails == true )
+    {
+        return false;
+    }
+    ScanDestination = samples;
+    ScanRunning = true;
+    Starts++;
+    return true;
+}
+
+/*!
+ * Delivers the DMA interrupt of the running scan
+ */
+static void SimCompleteScan( void )
+{
+    if( ScanRunning == true )
+    {
+        memcpy( ScanDestination, Programmed, sizeof( Programmed ) );
+        ScanRunning = false;
+        AdcService_OnScanComplete( );
+    }
+}
+
+static void SimWaitScan( void )
+{
+    if( ScanHangs == true )
+    {
+        // The interrupt does not come, the time goes on
+        Now++;
+        return;
+    }
+    SimCompleteScan( );
+}
+
+static void SimAbortScan( void )
+{
+    ScanRunning = false;
+    Aborts++;
+}
+
+static uint32_t SimGetTime( void )
+{
+    return Now;
+}
+
+static const AdcService_Driver_t SimDriver =
+{
+    SimStartScan,
+    SimWaitScan,
+    SimAbortScan,
+    SimGetTime
+};
+
+static void Program( uint16_t vrefint, uint16_t tempsensor, uint16_t vbat )
+{
+    Programmed[ADC_SERVICE_VREFINT] = vrefint;
+    Programmed[ADC_SERVICE_TEMPSENSOR] = tempsensor;
+    Programmed[ADC_SERVICE_VBAT] = vbat;
+}
+
+static void Reset( bool calibrated )
+{
+    AdcService_Calib_t calib =
+    {
+        .vrefintCal = ADCTEST_VREFINT_CAL,
+        .vrefintCalVref = 3300,
+        .tsCal1 = ADCTEST_TS_CAL1,
+        .tsCal2 = ( calibrated == true ) ? ADCTEST_TS_CAL2 : ADCTEST_TS_CAL1,
+        .tsCal1Temp = 30,
+        .tsCal2Temp = 130,
+        .tsCalVref = 3300
+    };
+
+    ScanRunning = false;
+    StartFails = false;
+    ScanHangs = false;
+    Starts = 0;
+    Aborts = 0;
+    Now = 1000;
+    // 3000 mV supply, 25 degrees C, 3000 mV on VBAT
+    Program( 1817, 1126, 1365 );
+    AdcService_Init( &SimDriver, &calib );
+}
+
+static bool FirstRead( void )
+{
+    AdcService_Levels_t levels;
+    AdcService_Stats_t stats;
+
+    Reset( true );
+    // Init starts the scan, the first read waits for it
+    CHECK( ScanRunning == true );
+    CHECK( AdcService_Get( &levels ) == true );
+    CHECK( levels.vddaMv == 3000 );
+    CHECK( levels.temperature == 25 );
+    CHECK( levels.vbatMv == 3000 );
+    CHECK( levels.time == 1000 );
+    CHECK( Starts == 1 );
+    AdcService_GetStats( &stats );
+    CHECK( ( stats.scans == 1 ) && ( stats.waits == 1 ) && ( stats.reads == 1 ) );
+    return true;
+}
+
+static bool CachedRead( void )
+{
+    AdcService_Levels_t levels;
+    AdcService_Stats_t stats;
+
+    Reset( true );
+    SimCompleteScan( );
+
+    // Reads within the age limit do not start the ADC, whatever it would now measure
+    Program( 1652, 1200, 1200 );
+    for( uint32_t i = 0; i < 10; i++ )
+    {
+        Now += ( ADC_SERVICE_MAX_AGE - 1 ) / 10;
+        CHECK( AdcService_Get( &levels ) == true );
+        CHECK( ( levels.vddaMv == 3000 ) && ( levels.temperature == 25 ) && ( levels.vbatMv == 3000 ) );
+    }
+    CHECK( Starts == 1 );
+    CHECK( ScanRunning == false );
+    AdcService_GetStats( &stats );
+    CHECK( ( stats.scans == 1 ) && ( stats.waits == 0 ) && ( stats.reads == 10 ) );
+    return true;
+}
+
+static bool StaleRead( void )
+{
+    AdcService_Levels_t levels;
+
+    Reset( true );
+    SimCompleteScan( );
+
+    // The stale measurement is served at once and one refresh is started
+    Now += ADC_SERVICE_MAX_AGE;
+    Program( 1652, 1047, 1638 );
+    CHECK( AdcService_Get( &levels ) == true );
+    CHECK( ( levels.vddaMv == 3000 ) && ( levels.time == 1000 ) );
+    CHECK( ScanRunning == true );
+    CHECK( AdcService_Get( &levels ) == true );
+    CHECK( levels.vddaMv == 3000 );
+    AdcService_Request( );
+    CHECK( Starts == 2 );
+
+    // The interrupt refreshes the cache
+    Now += 1;
+    SimCompleteScan( );
+    CHECK( AdcService_Get( &levels ) == true );
+    CHECK( levels.vddaMv == 3300 );
+    CHECK( levels.temperature == 32 );
+    CHECK( levels.vbatMv == 3960 );
+    CHECK( levels.time == 1000 + ADC_SERVICE_MAX_AGE + 1 );
+    CHECK( ( Starts == 2 ) && ( ScanRunning == false ) );
+    return true;
+}
+
+static bool TypicalParameters( void )
+{
+    AdcService_Levels_t levels;
+
+    // V30 of 760 mV and 2.5 mV per degree C at 3000 mV
+    Reset( false );
+    Program( 1817, 1038, 1365 );
+    CHECK( AdcService_Get( &levels ) == true );
+    CHECK( levels.temperature == 30 );
+
+    Now += ADC_SERVICE_MAX_AGE;
+    Program( 1817, 1072, 1365 );
+    AdcService_Request( );
+    SimCompleteScan( );
+    CHECK( AdcService_Get( &levels ) == true );
+    CHECK( levels.temperature == 40 );
+    return true;
+}
+
+static bool ScanErrors( void )
+{
+    AdcService_Levels_t levels;
+    AdcService_Stats_t stats;
+
+    // No measurement when the first scan fails and the ADC cannot be started again
+    Reset( true );
+    ScanRunning = false;
+    AdcService_OnScanError( );
+    StartFails = true;
+    CHECK( AdcService_Get( &levels ) == false );
+    AdcService_GetStats( &stats );
+    CHECK( ( stats.errors == 2 ) && ( stats.scans == 0 ) );
+
+    // The next read starts it again
+    StartFails = false;
+    CHECK( AdcService_Get( &levels ) == true );
+    CHECK( levels.vddaMv == 3000 );
+
+    // A scan ending with an error keeps the cache and is retried
+    Now += ADC_SERVICE_MAX_AGE;
+    CHECK( AdcService_Get( &levels ) == true );
+    CHECK( ScanRunning == true );
+    ScanRunning = false;
+    AdcService_OnScanError( );
+    Program( 1652, 1047, 1638 );
+    CHECK( AdcService_Get( &levels ) == true );
+    CHECK( ( levels.vddaMv == 3000 ) && ( levels.time == 1000 ) );
+    SimCompleteScan( );
+    CHECK( AdcService_Get( &levels ) == true );
+    CHECK( levels.vddaMv == 3300 );
+    AdcService_GetStats( &stats );
+    CHECK( ( stats.errors == 3 ) && ( stats.scans == 2 ) );
+    return true;
+}
+
+static bool LostInterrupt( void )
+{
+    AdcService_Levels_t levels;
+    AdcService_Stats_t stats;
+
+    // The first read gives up after the timeout and stops the ADC
+    Reset( true );
+    ScanHangs = true;
+    CHECK( AdcService_Get( &levels ) == false );
+    CHECK( Now == 1000 + ADC_SERVICE_SCAN_TIMEOUT );
+    CHECK( ( Aborts == 1 ) && ( ScanRunning == false ) );
+    AdcService_GetStats( &stats );
+    CHECK( ( stats.errors == 1 ) && ( stats.scans == 0 ) );
+
+    // The next read starts a new scan
+    ScanHangs = false;
+    CHECK( AdcService_Get( &levels ) == true );
+    CHECK( ( levels.vddaMv == 3000 ) && ( Starts == 2 ) && ( Aborts == 1 ) );
+    return true;
+}
+
+static bool NoReference( void )
+{
+    AdcService_Levels_t levels;
+
+    // A zero VREFINT conversion does not divide by zero
+    Reset( true );
+    Program( 0, 1126, 1365 );
+    CHECK( AdcService_Get( &levels ) == true );
+    CHECK( ( levels.vddaMv == 0 ) && ( levels.vbatMv == 0 ) );
+    return true;
+}
+
+static const AdcTestCase_t Cases[] =
+{
+    { "first read", FirstRead },
+    { "cached reads", CachedRead },
+    { "stale read", StaleRead },
+    { "typical temperature parameters", TypicalParameters },
+    { "scan errors", ScanErrors },
+    { "lost interrupt", LostInterrupt },
+    { "no reference", NoReference },
+};
+
+int main( int argc, char **argv )
+{
+    int status = 0;
+
+    for( uint32_t i = 0; i < sizeof( Cases ) / sizeof( Cases[0] ); i++ )
+    {
+        bool passed = Cases[i].Run( );
+
+        printf( "%-40s %s\n", Cases[i].Name, ( passed == true ) ? "ok" : "FAILED" );
+        if( passed == false )
+        {
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,323 @@
+/*!
+ * \file      at_host.c
+ *
+ * \brief     Host stand-ins of the services used by the AT application
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "at_host.h"
+#include "main.h"
+#include "stm32_adv_trace.h"
+#include "stm32_seq.h"
+#include "stm32_timer.h"
+#include "stm32_systime.h"
+#include "radio.h"
+#include "adc_if.h"
+#include "lora_info.h"
+#include "test_rf.h"
+
+#define AT_HOST_OUTPUT_SIZE                         8192
+#define AT_HOST_TIMERS                              4
+#define AT_HOST_UPLINKS                             16
+
+static char Output[AT_HOST_OUTPUT_SIZE];
+static size_t OutputSize;
+static void ( *RxCallback )( uint8_t *data, uint16_t size, uint8_t error );
+static UTIL_TIMER_Object_t *Timers[AT_HOST_TIMERS];
+static AtHostUplink_t Uplinks[AT_HOST_UPLINKS];
+static uint8_t UplinkFirst;
+static uint8_t UplinkCount;
+static LoraInfo_t LoraInfo;
+
+const struct Radio_s Radio;
+
+void AtHostReset( void )
+{
+    OutputSize = 0;
+    Output[0] = '\0';
+    UplinkCount = 0;
+}
+
+const char *AtHostOutput( void )
+{
+    return Output;
+}
+
+void AtHostRx( uint8_t *data, uint16_t size, uint8_t error )
+{
+    if( RxCallback != NULL )
+    {
+        RxCallback( data, size, error );
+    }
+}
+
+void AtHostTimersExpire( void )
+{
+    for( uint8_t i = 0; i < AT_HOST_TIMERS; i++ )
+    {
+        if( ( Timers[i] != NULL ) && ( Timers[i]->IsRunning != 0 ) )
+        {
+            Timers[i]->IsRunning = 0;
+            Timers[i]->Callback( Timers[i]->argument );
+        }
+    }
+}
+
+bool AtHostTimerRunning( void )
+{
+    for( uint8_t i = 0; i < AT_HOST_TIMERS; i++ )
+    {
+        if( ( Timers[i] != NULL ) && ( Timers[i]->IsRunning != 0 ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AtHostGetUplink( AtHostUplink_t *uplink )
+{
+    if( UplinkCount == 0 )
+    {
+        return false;
+    }
+    *uplink = Uplinks[UplinkFirst];
+    UplinkFirst = ( UplinkFirst + 1 ) % AT_HOST_UPLINKS;
+    UplinkCount--;
+    return true;
+}
+
+/* Trace */
+UTIL_ADV_TRACE_Status_t UTIL_ADV_TRACE_COND_FSend( uint32_t VerboseLevel, uint32_t Region, uint32_t TimeStampState,
+                                                   const char *strFormat, ... )
+{
+    va_list args;
+    int size;
+
+    va_start( args, strFormat );
+    size = vsnprintf( &Output[OutputSize], sizeof( Output ) - OutputSize, strFormat, args );
+    va_end( args );
+    if( size > 0 )
+    {
+        OutputSize += ( ( size_t )size < sizeof( Output ) - OutputSize ) ? ( size_t )size : sizeof( Output ) - OutputSize - 1;
+    }
+    return UTIL_ADV_TRACE_OK;
+}
+
+UTIL_ADV_TRACE_Status_t UTIL_ADV_TRACE_StartRxProcess( void ( *UserCallback )( uint8_t *PData, uint16_t Size, uint8_t Error ) )
+{
+    RxCallback = UserCallback;
+    return UTIL_ADV_TRACE_OK;
+}
+
+uint8_t UTIL_ADV_TRACE_IsBufferEmpty( void )
+{
+    return 1;
+}
+
+void UTIL_ADV_TRACE_SetVerboseLevel( uint8_t Level )
+{
+}
+
+uint8_t UTIL_ADV_TRACE_GetVerboseLevel( void )
+{
+    return VLEVEL_M;
+}
+
+/* Timer server */
+UTIL_TIMER_Status_t UTIL_TIMER_Create( UTIL_TIMER_Object_t *TimerObject, uint32_t PeriodValue, UTIL_TIMER_Mode_t Mode,
+                                       void ( *Callback )( void * ), void *Argument )
+{
+    for( uint8_t i = 0; i < AT_HOST_TIMERS; i++ )
+    {
+        if( ( Timers[i] == NULL ) || ( Timers[i] == TimerObject ) )
+        {
+            Timers[i] = TimerObject;
+            break;
+        }
+    }
+    memset( TimerObject, 0, sizeof( *TimerObject ) );
+    TimerObject->ReloadValue = PeriodValue;
+    TimerObject->Mode = Mode;
+    TimerObject->Callback = Callback;
+    TimerObject->argument = Argument;
+    return UTIL_TIMER_OK;
+}
+
+UTIL_TIMER_Status_t UTIL_TIMER_Start( UTIL_TIMER_Object_t *TimerObject )
+{
+    TimerObject->IsRunning = 1;
+    return UTIL_TIMER_OK;
+}
+
+UTIL_TIMER_Status_t UTIL_TIMER_Stop( UTIL_TIMER_Object_t *TimerObject )
+{
+    TimerObject->IsRunning = 0;
+    return UTIL_TIMER_OK;
+}
+
+UTIL_TIMER_Status_t UTIL_TIMER_SetPeriod( UTIL_TIMER_Object_t *TimerObject, uint32_t NewPeriodValue )
+{
+    TimerObject->ReloadValue = NewPeriodValue;
+    return UTIL_TIMER_OK;
+}
+
+/* System services */
+void UTIL_SEQ_RegTask( UTIL_SEQ_bm_t TaskId_bm, uint32_t Flags, void ( *Task )( void ) )
+{
+}
+
+void UTIL_SEQ_SetTask( UTIL_SEQ_bm_t TaskId_bm, uint32_t Task_Prio )
+{
+}
+
+SysTime_t SysTimeGet( void )
+{
+    SysTime_t sysTime = { 0 };
+
+    return sysTime;
+}
+
+void SysTimeLocalTime( const uint32_t timestamp, struct tm *localtime )
+{
+    memset( localtime, 0, sizeof( *localtime ) );
+}
+
+uint16_t SYS_GetBatteryLevel( void )
+{
+    return 3300;
+}
+
+LoraInfo_t *LoraInfo_GetPtr( void )
+{
+    return &LoraInfo;
+}
+
+void NVIC_SystemReset( void )
+{
+    printf( "NVIC_SystemReset\n" );
+    exit( 1 );
+}
+
+/* Radio test */
+int32_t TST_TxTone( void )
+{
+    return -1;
+}
+
+int32_t TST_RxRssi( void )
+{
+    return -1;
+}
+
+int32_t TST_TX_Start( int32_t nb_packet )
+{
+    return -1;
+}
+
+int32_t TST_RX_Start( int32_t nb_packet )
+{
+    return -1;
+}
+
+int32_t TST_set_config( testParameter_t *Param )
+{
+    return -1;
+}
+
+int32_t TST_get_config( testParameter_t *Param )
+{
+    return -1;
+}
+
+int32_t TST_stop( void )
+{
+    return -1;
+}
+
+/* LoRaWAN handler, only the uplink requests are recorded */
+LmHandlerErrorStatus_t LmHandlerSend( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed,
+                                      TimerTime_t *nextTxIn, bool allowDelayedTx )
+{
+    AtHostUplink_t *uplink = &Uplinks[( UplinkFirst + UplinkCount ) % AT_HOST_UPLINKS];
+
+    if( UplinkCount == AT_HOST_UPLINKS )
+    {
+        return LORAMAC_HANDLER_BUSY_ERROR;
+    }
+    uplink->Port = appData->Port;
+    uplink->Type = isTxConfirmed;
+    uplink->Size = appData->BufferSize;
+    memcpy( uplink->Buffer, appData->Buffer, appData->BufferSize );
+    UplinkCount++;
+    if( nextTxIn != NULL )
+    {
+        *nextTxIn = 0;
+    }
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+LmHandlerFlagStatus_t LmHandlerJoinStatus( void )
+{
+    return LORAMAC_HANDLER_SET;
+}
+
+void LmHandlerJoin( ActivationType_t mode )
+{
+}
+
+#define AT_HOST_LMHANDLER( NAME, PARAM )                                      \
+    LmHandlerErrorStatus_t NAME( PARAM param )                                \
+    {                                                                         \
+        return LORAMAC_HANDLER_ERROR;                                         \
+    }
+
+AT_HOST_LMHANDLER( LmHandlerRequestClass, DeviceClass_t )
+AT_HOST_LMHANDLER( LmHandlerGetCurrentClass, DeviceClass_t * )
+AT_HOST_LMHANDLER( LmHandlerGetDevEUI, uint8_t * )
+AT_HOST_LMHANDLER( LmHandlerSetDevEUI, uint8_t * )
+AT_HOST_LMHANDLER( LmHandlerGetAppEUI, uint8_t * )
+AT_HOST_LMHANDLER( LmHandlerSetAppEUI, uint8_t * )
+AT_HOST_LMHANDLER( LmHandlerGetNetworkID, uint32_t * )
+AT_HOST_LMHANDLER( LmHandlerSetNetworkID, uint32_t )
+AT_HOST_LMHANDLER( LmHandlerGetDevAddr, uint32_t * )
+AT_HOST_LMHANDLER( LmHandlerSetDevAddr, uint32_t )
+AT_HOST_LMHANDLER( LmHandlerGetActiveRegion, LoRaMacRegion_t * )
+AT_HOST_LMHANDLER( LmHandlerSetActiveRegion, LoRaMacRegion_t )
+AT_HOST_LMHANDLER( LmHandlerGetAdrEnable, bool * )
+AT_HOST_LMHANDLER( LmHandlerSetAdrEnable, bool )
+AT_HOST_LMHANDLER( LmHandlerGetTxDatarate, int8_t * )
+AT_HOST_LMHANDLER( LmHandlerSetTxDatarate, int8_t )
+AT_HOST_LMHANDLER( LmHandlerGetDutyCycleEnable, bool * )
+AT_HOST_LMHANDLER( LmHandlerSetDutyCycleEnable, bool )
+AT_HOST_LMHANDLER( LmHandlerGetRX2Params, RxChannelParams_t * )
+AT_HOST_LMHANDLER( LmHandlerSetRX2Params, RxChannelParams_t * )
+AT_HOST_LMHANDLER( LmHandlerGetTxPower, int8_t * )
+AT_HOST_LMHANDLER( LmHandlerSetTxPower, int8_t )
+AT_HOST_LMHANDLER( LmHandlerGetRx1Delay, uint32_t * )
+AT_HOST_LMHANDLER( LmHandlerSetRx1Delay, uint32_t )
+AT_HOST_LMHANDLER( LmHandlerGetRx2Delay, uint32_t * )
+AT_HOST_LMHANDLER( LmHandlerSetRx2Delay, uint32_t )
+AT_HOST_LMHANDLER( LmHandlerGetJoinRx1Delay, uint32_t * )
+AT_HOST_LMHANDLER( LmHandlerSetJoinRx1Delay, uint32_t )
+AT_HOST_LMHANDLER( LmHandlerGetJoinRx2Delay, uint32_t * )
+AT_HOST_LMHANDLER( LmHandlerSetJoinRx2Delay, uint32_t )
+AT_HOST_LMHANDLER( LmHandlerGetPingPeriodicity, uint8_t * )
+AT_HOST_LMHANDLER( LmHandlerSetPingPeriodicity, uint8_t )
+AT_HOST_LMHANDLER( LmHandlerGetBeaconState, BeaconState_t * )
+AT_HOST_LMHANDLER( LmHandlerGetNwkKey, uint8_t * )
+AT_HOST_LMHANDLER( LmHandlerSetNwkKey, uint8_t * )
+AT_HOST_LMHANDLER( LmHandlerGetAppKey, uint8_t * )
+AT_HOST_LMHANDLER( LmHandlerSetAppKey, uint8_t * )
+AT_HOST_LMHANDLER( LmHandlerGetNwkSKey, uint8_t * )
+AT_HOST_LMHANDLER( LmHandlerSetNwkSKey, uint8_t * )
+AT_HOST_LMHANDLER( LmHandlerGetAppSKey, uint8_t * )
+AT_HOST_LMHANDLER( LmHandlerSetAppSKey, uint8_t * )
+
+LmHandlerErrorStatus_t LmHandlerLinkCheckReq( void )
+{
+    return LORAMAC_HANDLER_ERROR;
+}
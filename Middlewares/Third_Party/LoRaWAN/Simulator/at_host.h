@@ -0,0 +1,66 @@
+/*!
+ * \file      at_host.h
+ *
+ * \brief     Host stand-ins of the services used by the AT application
+ *
+ * \details   lora_at.c and lora_command.c run unchanged on the host. The
+ *            LoRaWAN handler only records the uplinks it is asked to send,
+ *            the trace output is kept in a buffer and the received bytes are
+ *            given to the parser by the test, as the UART driver does.
+ */
+#ifndef __AT_HOST_H__
+#define __AT_HOST_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "LmHandler.h"
+
+/*!
+ * Uplink requested by the AT application
+ */
+typedef struct AtHostUplink_s
+{
+    uint8_t Port;
+    LmHandlerMsgTypes_t Type;
+    uint8_t Size;
+    uint8_t Buffer[256];
+}AtHostUplink_t;
+
+/*!
+ * \brief Forgets the trace output and the uplink requests
+ */
+void AtHostReset( void );
+
+/*!
+ * \brief Trace output since the last AtHostReset
+ */
+const char *AtHostOutput( void );
+
+/*!
+ * \brief Gives received bytes to the receive callback of the AT parser
+ *
+ * \param [IN] data  Received bytes, NULL with an error
+ * \param [IN] size  Number of bytes
+ * \param [IN] error Receive error
+ */
+void AtHostRx( uint8_t *data, uint16_t size, uint8_t error );
+
+/*!
+ * \brief Expires the running timers of the AT application
+ */
+void AtHostTimersExpire( void );
+
+/*!
+ * \brief Returns true when a timer of the AT application runs
+ */
+bool AtHostTimerRunning( void );
+
+/*!
+ * \brief Gets the oldest uplink request not read yet, up to 16 are kept
+ *
+ * \retval true when an uplink was requested
+ */
+bool AtHostGetUplink( AtHostUplink_t *uplink );
+
+#endif // __AT_HOST_H__
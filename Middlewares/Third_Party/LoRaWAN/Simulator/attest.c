@@ -0,0 +1,395 @@
+/*!
+ * \file      attest.c
+ *
+ * \brief     Host test of the AT application parser with malformed input
+ *
+ * \details   Runs lora_command.c and lora_at.c of the FreeRTOS AT application
+ *            on the host. The received bytes are given to the parser in the
+ *            reads of the UART driver, the test decides when the command
+ *            task runs.
+ *
+ *            The cases check the hexadecimal payload of AT+SEND for every
+ *            byte value and length, and the binary payload framing of
+ *            AT+SENDB: CR LF and LF only line endings, a CR LF terminator
+ *            split across reads, payloads split across reads, bad lengths,
+ *            timeout and receive errors.
+ *
+ *            Usage: attest
+ */
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "at_host.h"
+#include "lora_at.h"
+#include "lora_command.h"
+
+#define CHECK( cond )                                                         \
+    do                                                                        \
+    {                                                                         \
+        if( !( cond ) )                                                       \
+        {                                                                     \
+            printf( "FAIL %s line %d: %s\n", __func__, __LINE__, #cond );     \
+            return false;                                                     \
+        }                                                                     \
+    }while( 0 )
+
+typedef struct AtTestCase_s
+{
+    const char *Name;
+    bool ( *Run )( void );
+}AtTestCase_t;
+
+/*!
+ * Largest payload of an uplink [bytes]
+ */
+#define ATTEST_PAYLOAD_MAX                          242
+
+#define ATTEST_OK                                   "\r\nOK\r\n"
+#define ATTEST_PARAM_ERROR                          "\r\nAT_PARAM_ERROR\r\n"
+#define ATTEST_RX_ERROR                             "\r\nAT_RX_ERROR\r\n"
+
+static void Reset( void )
+{
+    AtHostReset( );
+    CMD_Init( NULL );
+}
+
+/*!
+ * Receives one read of the UART driver, the command task does not run
+ */
+static void Receive( const void *data, uint16_t size )
+{
+    AtHostRx( ( uint8_t * )data, size, 0 );
+}
+
+/*!
+ * Receives one read of the UART driver and runs the command task
+ */
+static void Read( const void *data, uint16_t size )
+{
+    Receive( data, size );
+    CMD_Process( );
+}
+
+/*!
+ * Receives a string in reads of at most 64 bytes, the command task runs
+ * after each of them
+ */
+static void ReadString( const char *str )
+{
+    size_t size = strlen( str );
+
+    for( size_t n = 0; n < size; n += 64 )
+    {
+        Read( str + n, ( uint16_t )( ( ( size - n ) < 64 ) ? ( size - n ) : 64 ) );
+    }
+}
+
+/*!
+ * Returns true when the status was printed, the output and the uplink
+ * requests are then forgotten
+ */
+static bool Printed( const char *status )
+{
+    bool found = strstr( AtHostOutput( ), status ) != NULL;
+
+    AtHostReset( );
+    return found;
+}
+
+/*!
+ * Returns true when exactly the given uplink was requested since the last call
+ */
+static bool Sent( uint8_t port, LmHandlerMsgTypes_t type, const void *payload, uint8_t size )
+{
+    AtHostUplink_t uplink;
+
+    if( AtHostGetUplink( &uplink ) == false )
+    {
+        return false;
+    }
+    return ( uplink.Port == port ) && ( uplink.Type == type ) && ( uplink.Size == size ) &&
+           ( memcmp( uplink.Buffer, payload, size ) == 0 ) && ( AtHostGetUplink( &uplink ) == false );
+}
+
+static bool NothingSent( void )
+{
+    AtHostUplink_t uplink;
+
+    return AtHostGetUplink( &uplink ) == false;
+}
+
+/*!
+ * Every byte value in the high and in the low nibble of a hexadecimal byte
+ */
+static bool HexDigits( void )
+{
+    char line[32];
+    int length;
+
+    Reset( );
+    for( uint32_t c = 0; c < 256; c++ )
+    {
+        uint8_t value = ( uint8_t )( isdigit( c ) ? ( c - '0' ) : ( tolower( c ) - 'a' + 10 ) );
+        uint8_t high = ( uint8_t )( value << 4 );
+
+        // Line terminators, the receive error marker and backspace are not
+        // payload, a NUL ends the command
+        if( ( c == '\0' ) || ( c == '\r' ) || ( c == '\n' ) || ( c == AT_ERROR_RX_CHAR ) || ( c == '\b' ) )
+        {
+            continue;
+        }
+
+        length = snprintf( line, sizeof( line ), "AT+SEND=2:0:0%c\r", ( char )c );
+        Read( line, ( uint16_t )length );
+        if( isxdigit( c ) )
+        {
+            CHECK( Sent( 2, LORAMAC_HANDLER_UNCONFIRMED_MSG, &value, 1 ) );
+            CHECK( Printed( ATTEST_OK ) );
+        }
+        else
+        {
+            CHECK( NothingSent( ) );
+            CHECK( Printed( ATTEST_PARAM_ERROR ) );
+        }
+
+        length = snprintf( line, sizeof( line ), "AT+SEND=2:1:%c0\r", ( char )c );
+        Read( line, ( uint16_t )length );
+        if( isxdigit( c ) )
+        {
+            CHECK( Sent( 2, LORAMAC_HANDLER_CONFIRMED_MSG, &high, 1 ) );
+            CHECK( Printed( ATTEST_OK ) );
+        }
+        else
+        {
+            CHECK( NothingSent( ) );
+            CHECK( Printed( ATTEST_PARAM_ERROR ) );
+        }
+    }
+    return true;
+}
+
+/*!
+ * Lengths and headers of AT+SEND
+ */
+static bool HexFraming( void )
+{
+    static const char *Malformed[] =
+    {
+        "AT+SEND=2:0:abc\r",            // odd number of digits
+        "AT+SEND=2:0:0\r",
+        "AT+SEND=2:0:00 1\r",
+        "AT+SEND=2:0:0g\r",
+        "AT+SEND=2:0:@`\r",             // next to the digit and letter ranges
+        "AT+SEND=2:0:/:\r",
+        "AT+SEND=2:0:\xe0\xb0\r",       // negative as char
+        "AT+SEND=:0:00\r",              // no port
+        "AT+SEND=2:00\r",               // no acknowledge flag
+        "AT+SEND=2:2:00\r",
+        "AT+SEND=2;0:00\r",
+        "AT+SEND=2:0\r",
+    };
+    static const uint8_t Mixed[] = { 0x00, 0xff, 0xa5, 0xc3 };
+    char line[2 * ATTEST_PAYLOAD_MAX + 32];
+    uint8_t payload[ATTEST_PAYLOAD_MAX];
+    size_t length;
+
+    Reset( );
+    for( uint32_t i = 0; i < sizeof( Malformed ) / sizeof( Malformed[0] ); i++ )
+    {
+        ReadString( Malformed[i] );
+        CHECK( NothingSent( ) );
+        CHECK( Printed( ATTEST_PARAM_ERROR ) );
+    }
+
+    ReadString( "AT+SEND=2:0:00ffA5c3\r" );
+    CHECK( Sent( 2, LORAMAC_HANDLER_UNCONFIRMED_MSG, Mixed, sizeof( Mixed ) ) );
+    CHECK( Printed( ATTEST_OK ) );
+
+    ReadString( "AT+SEND=3:1:\r" );
+    CHECK( Sent( 3, LORAMAC_HANDLER_CONFIRMED_MSG, Mixed, 0 ) );
+    CHECK( Printed( ATTEST_OK ) );
+
+    // The largest payload, then one byte more
+    length = snprintf( line, sizeof( line ), "AT+SEND=9:1:" );
+    for( uint32_t i = 0; i < ATTEST_PAYLOAD_MAX; i++ )
+    {
+        payload[i] = ( uint8_t )( i * 7 );
+        length += snprintf( line + length, sizeof( line ) - length, "%02X", payload[i] );
+    }
+    snprintf( line + length, sizeof( line ) - length, "\r" );
+    ReadString( line );
+    CHECK( Sent( 9, LORAMAC_HANDLER_CONFIRMED_MSG, payload, ATTEST_PAYLOAD_MAX ) );
+    CHECK( Printed( ATTEST_OK ) );
+
+    snprintf( line + length, sizeof( line ) - length, "00\r" );
+    ReadString( line );
+    CHECK( NothingSent( ) );
+    CHECK( Printed( ATTEST_PARAM_ERROR ) );
+    return true;
+}
+
+/*!
+ * Binary payload with every line ending and control character
+ */
+static bool BinaryPayload( void )
+{
+    static const uint8_t Control[] = { '\r', '\n', AT_ERROR_RX_CHAR, 0x00, '\n' };
+
+    Reset( );
+    ReadString( "AT+SENDB=3:1:5\r" );
+    CHECK( AtHostTimerRunning( ) == true );
+    CHECK( NothingSent( ) );
+    Read( Control, sizeof( Control ) );
+    CHECK( Sent( 3, LORAMAC_HANDLER_CONFIRMED_MSG, Control, sizeof( Control ) ) );
+    CHECK( Printed( ATTEST_OK ) );
+    CHECK( AtHostTimerRunning( ) == false );
+
+    // CR LF terminator in the read of the command
+    ReadString( "AT+SENDB=4:0:2\r\nxy" );
+    CHECK( Sent( 4, LORAMAC_HANDLER_UNCONFIRMED_MSG, "xy", 2 ) );
+    CHECK( Printed( ATTEST_OK ) );
+
+    // LF only terminator
+    ReadString( "AT+SENDB=4:0:2\n\nz" );
+    CHECK( Sent( 4, LORAMAC_HANDLER_UNCONFIRMED_MSG, "\nz", 2 ) );
+    CHECK( Printed( ATTEST_OK ) );
+
+    // Split across reads, a command follows in the read of the end
+    ReadString( "AT+SENDB=4:0:3\rab" );
+    CHECK( NothingSent( ) );
+    ReadString( "cAT\r" );
+    CHECK( Sent( 4, LORAMAC_HANDLER_UNCONFIRMED_MSG, "abc", 3 ) );
+    CHECK( strstr( strstr( AtHostOutput( ), ATTEST_OK ) + 1, ATTEST_OK ) != NULL );
+    AtHostReset( );
+    return true;
+}
+
+/*!
+ * CR LF terminator split across reads of the UART driver
+ */
+static bool BinaryCrLfSplit( void )
+{
+    Reset( );
+    // The LF comes in the read of the payload
+    ReadString( "AT+SENDB=5:0:2\r" );
+    ReadString( "\nxy" );
+    CHECK( Sent( 5, LORAMAC_HANDLER_UNCONFIRMED_MSG, "xy", 2 ) );
+    CHECK( Printed( ATTEST_OK ) );
+
+    // The LF comes alone, the payload starts with 0x0A
+    ReadString( "AT+SENDB=5:0:2\r" );
+    ReadString( "\n" );
+    CHECK( NothingSent( ) );
+    ReadString( "\nz" );
+    CHECK( Sent( 5, LORAMAC_HANDLER_UNCONFIRMED_MSG, "\nz", 2 ) );
+    CHECK( Printed( ATTEST_OK ) );
+
+    // All reads are waiting when the command task runs
+    Receive( "AT+SENDB=5:1:3\r", 15 );
+    Receive( "\n", 1 );
+    Receive( "\nab", 3 );
+    CMD_Process( );
+    CHECK( Sent( 5, LORAMAC_HANDLER_CONFIRMED_MSG, "\nab", 3 ) );
+    CHECK( Printed( ATTEST_OK ) );
+
+    // A LF only line ending keeps a payload starting with 0x0A
+    ReadString( "AT+SENDB=5:0:1\n" );
+    ReadString( "\n" );
+    CHECK( Sent( 5, LORAMAC_HANDLER_UNCONFIRMED_MSG, "\n", 1 ) );
+    CHECK( Printed( ATTEST_OK ) );
+    return true;
+}
+
+/*!
+ * Lengths of AT+SENDB
+ */
+static bool BinaryLength( void )
+{
+    static const char *Malformed[] =
+    {
+        "AT+SENDB=4:0:0\r",
+        "AT+SENDB=4:0:243\r",
+        "AT+SENDB=4:0:99999999999\r",
+        "AT+SENDB=4:0:1x\r",
+        "AT+SENDB=4:0:-1\r",
+        "AT+SENDB=4:0:\r",
+        "AT+SENDB=4:0\r",
+    };
+
+    Reset( );
+    for( uint32_t i = 0; i < sizeof( Malformed ) / sizeof( Malformed[0] ); i++ )
+    {
+        ReadString( Malformed[i] );
+        CHECK( Printed( ATTEST_PARAM_ERROR ) );
+        CHECK( AtHostTimerRunning( ) == false );
+    }
+    // No capture is left armed
+    ReadString( "AT+SEND=1:0:01\r" );
+    CHECK( Sent( 1, LORAMAC_HANDLER_UNCONFIRMED_MSG, "\x01", 1 ) );
+    CHECK( Printed( ATTEST_OK ) );
+    return true;
+}
+
+/*!
+ * Payload not complete in time, receive errors
+ */
+static bool BinaryErrors( void )
+{
+    Reset( );
+    ReadString( "AT+SENDB=4:0:4\rab" );
+    AtHostTimersExpire( );
+    CMD_Process( );
+    CHECK( NothingSent( ) );
+    CHECK( Printed( ATTEST_RX_ERROR ) );
+    ReadString( "AT+SEND=1:0:02\r" );
+    CHECK( Sent( 1, LORAMAC_HANDLER_UNCONFIRMED_MSG, "\x02", 1 ) );
+    CHECK( Printed( ATTEST_OK ) );
+
+    // 0x01 is payload while the capture runs, the error is flagged apart
+    ReadString( "AT+SENDB=4:0:4\r\x01\x01" );
+    AtHostRx( NULL, 0, 1 );
+    CMD_Process( );
+    CHECK( NothingSent( ) );
+    CHECK( Printed( ATTEST_RX_ERROR ) );
+    CHECK( AtHostTimerRunning( ) == false );
+
+    // The error is reported in sequence with the text commands
+    ReadString( "AT+SE" );
+    AtHostRx( NULL, 0, 1 );
+    CMD_Process( );
+    ReadString( "AT+SEND=1:0:03\r" );
+    CHECK( strstr( AtHostOutput( ), ATTEST_RX_ERROR ) != NULL );
+    CHECK( Sent( 1, LORAMAC_HANDLER_UNCONFIRMED_MSG, "\x03", 1 ) );
+    CHECK( Printed( ATTEST_OK ) );
+    return true;
+}
+
+static const AtTestCase_t Cases[] =
+{
+    { "hex digits", HexDigits },
+    { "hex framing", HexFraming },
+    { "binary payload", BinaryPayload },
+    { "binary payload, CR LF split", BinaryCrLfSplit },
+    { "binary length", BinaryLength },
+    { "binary timeout and receive errors", BinaryErrors },
+};
+
+int main( int argc, char **argv )
+{
+    int status = 0;
+
+    for( uint32_t i = 0; i < sizeof( Cases ) / sizeof( Cases[0] ); i++ )
+    {
+        bool passed = Cases[i].Run( );
+
+        printf( "%-40s %s\n", Cases[i].Name, ( passed == true ) ? "ok" : "FAILED" );
+        if( passed == false )
+        {
+            status = 1;
+        }
+    }
+    return status;
+}
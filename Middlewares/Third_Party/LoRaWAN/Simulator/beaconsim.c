@@ -0,0 +1,477 @@
+/*!
+ * \file      beaconsim.c
+ *
+ * \brief     Host simulation of the Class B beacon tracking through outages
+ *
+ * \details   Replays the beacon windows of LoRaMacClassB.c beacon by beacon
+ *            against an RTC which drifts from the GPS time of the beacons.
+ *            The beacons are sent on EU868 (SF9, 125 kHz), a window receives
+ *            a beacon when it opens at most 6 preamble symbols after the
+ *            beacon start and stays open at least 4 symbols after it. The
+ *            RTC time a beacon is received at is known within
+ *            BEACONSIM_DEFAULT_JITTER ms and a fraction of the beacons fade.
+ *            The MAC processes a beacon up to BEACONSIM_DEFAULT_LATENCY ms
+ *            after its RX done interrupt, LoRaMacClassBRxBeacon derives the
+ *            beacon start from the interrupt timestamp.
+ *
+ *            Each scenario locks the beacon, tracks it for
+ *            BEACONSIM_WARM_UP beacons and then removes a number of
+ *            successive beacons. It is run twice:
+ *              - legacy: 9 symbol windows moved earlier by 4, 8... 256 ms as
+ *                beacons are missed, a beacon loss after 2 hours and a
+ *                continuous acquisition of a beacon interval requested again
+ *                by the application until a beacon is found
+ *              - search: LoRaMacBeaconSearch.c, windows moved by the drift
+ *                measured on the beacons and sized for its uncertainty, and
+ *                windows on the predicted beacons before a continuous
+ *                acquisition
+ *
+ *            The receiver energy is counted from the first beacon missing
+ *            and the time to lock from the first beacon back. The
+ *            simulation fails when the search takes longer to lock in a
+ *            scenario, when it costs more energy over all the scenarios or
+ *            when the drift it measured is off.
+ *
+ *            Usage: beaconsim [-d drift ppb] [-j jitter ms] [-l latency ms]
+ *                             [-f fading %] [-s seed] [outage beacons...]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "LoRaMacClassBConfig.h"
+#include "LoRaMacBeaconSearch.h"
+
+#define BEACONSIM_GPS_START                         1300000000
+#define BEACONSIM_RTC_START                         1000
+#define BEACONSIM_SYMBOL_US                         4096
+#define BEACONSIM_PREAMBLE_SYMBOLS                  10
+#define BEACONSIM_LOCK_SYMBOLS                      4
+#define BEACONSIM_TIME_ON_AIR                       152.6
+#define BEACONSIM_MIN_RX_SYMBOLS                    6
+#define BEACONSIM_RX_ERROR                          10
+#define BEACONSIM_WAKEUP_TIME                       2
+#define BEACONSIM_RX_CURRENT                        4.8
+#define BEACONSIM_SUPPLY                            3.3
+#define BEACONSIM_DEFAULT_DRIFT                     20000
+#define BEACONSIM_DEFAULT_JITTER                    1
+#define BEACONSIM_DEFAULT_LATENCY                   20
+#define BEACONSIM_DEFAULT_FADING                    2
+#define BEACONSIM_WARM_UP                           112
+#define BEACONSIM_LIMIT                             675
+#define BEACONSIM_MAX_SCENARIOS                     16
+
+typedef struct BeaconSimResult_s
+{
+    double RxTime;
+    double TimeToLock;
+    double LockError;
+    uint32_t Windows;
+    uint32_t Acquisitions;
+    uint32_t Losses;
+    bool Locked;
+    LoRaMacBeaconSearchStats_t Stats;
+}BeaconSimResult_t;
+
+/*!
+ * Simulated device
+ */
+typedef struct BeaconSimDevice_s
+{
+    bool Search;
+    LoRaMacBeaconSearch_t BeaconSearch;
+    TimerTime_t LastLock;
+    uint32_t LastBeacon;
+    uint32_t Movement;
+}BeaconSimDevice_t;
+
+static int32_t Drift = BEACONSIM_DEFAULT_DRIFT;
+static uint32_t Jitter = BEACONSIM_DEFAULT_JITTER;
+static uint32_t Latency = BEACONSIM_DEFAULT_LATENCY;
+static uint32_t Fading = BEACONSIM_DEFAULT_FADING;
+static uint32_t Seed = 1;
+static uint32_t OutageStart;
+static uint32_t OutageEnd;
+
+static uint32_t Hash( uint32_t x )
+{
+    x ^= Seed * 0x9E3779B9;
+    x ^= x >> 16;
+    x *= 0x7FEB352D;
+    x ^= x >> 15;
+    x *= 0x846CA68B;
+    x ^= x >> 16;
+    return x;
+}
+
+/*!
+ * \brief True time, in ms, beacon k starts at
+ */
+static double BeaconStart( uint32_t k )
+{
+    return ( double )k * CLASSB_BEACON_INTERVAL;
+}
+
+static double Rtc( double trueTime )
+{
+    return BEACONSIM_RTC_START + trueTime * ( 1.0 + Drift * 1e-9 );
+}
+
+/*!
+ * \brief Beacon k is sent and not faded. Both policies see the same beacons.
+ */
+static bool Present( uint32_t k )
+{
+    if( ( k >= OutageStart ) && ( k < OutageEnd ) )
+    {
+        return false;
+    }
+    return ( Hash( 2 * k ) % 100 ) >= Fading;
+}
+
+/*!
+ * \brief Window timeout and offset of RegionCommonComputeRxWindowParameters
+ */
+static void ComputeWindow( uint32_t rxError, uint32_t *symbols, int32_t *offset )
+{
+    int32_t half;
+
+    *symbols = ( ( 2 * BEACONSIM_MIN_RX_SYMBOLS - 8 ) * BEACONSIM_SYMBOL_US + 2 * ( rxError * 1000 ) +
+                 BEACONSIM_SYMBOL_US - 1 ) / BEACONSIM_SYMBOL_US;
+    if( *symbols < BEACONSIM_MIN_RX_SYMBOLS )
+    {
+        *symbols = BEACONSIM_MIN_RX_SYMBOLS;
+    }
+    if( *symbols > CLASSB_BEACON_SYMBOL_TO_EXPANSION_MAX )
+    {
+        *symbols = CLASSB_BEACON_SYMBOL_TO_EXPANSION_MAX;
+    }
+    half = ( int32_t )( ( *symbols * BEACONSIM_SYMBOL_US + 1 ) / 2 );
+    *offset = ( int32_t )ceil( ( 4 * BEACONSIM_SYMBOL_US - half - BEACONSIM_WAKEUP_TIME * 1000 ) / 1000.0 );
+}
+
+static void Lock( BeaconSimDevice_t *device, BeaconSimResult_t *result, uint32_t k )
+{
+    // RTC time of the RX done interrupt
+    double jitter = ( ( double )( Hash( 2 * k + 1 ) % 2001 ) / 1000.0 - 1.0 ) * Jitter;
+    TimerTime_t lastRxDone = ( TimerTime_t )llround( Rtc( BeaconStart( k ) ) + BEACONSIM_TIME_ON_AIR + jitter );
+    // The MAC process runs LoRaMacClassBRxBeacon later, which counts the
+    // time since the beacon start from the interrupt timestamp
+    TimerTime_t now = lastRxDone + Hash( Hash( 2 * k + 1 ) ) % ( Latency + 1 );
+    TimerTime_t elapsed = ( TimerTime_t )lround( BEACONSIM_TIME_ON_AIR ) + ( now - lastRxDone );
+    TimerTime_t rxTime = now - elapsed;
+
+    if( fabs( rxTime - Rtc( BeaconStart( k ) ) ) > result->LockError )
+    {
+        result->LockError = fabs( rxTime - Rtc( BeaconStart( k ) ) );
+    }
+
+    if( device->Search == true )
+    {
+        LoRaMacBeaconSearchOnLock( &device->BeaconSearch, rxTime, BEACONSIM_GPS_START + k * ( CLASSB_BEACON_INTERVAL / 1000 ) );
+    }
+    device->LastLock = rxTime;
+    device->LastBeacon = k;
+    device->Movement = CLASSB_WINDOW_MOVE_DEFAULT;
+}
+
+/*!
+ * \brief Opens a window of the given symbols at RTC time open for beacon k
+ *
+ * \retval received The beacon was received
+ */
+static bool Window( BeaconSimResult_t *result, uint32_t k, double open, uint32_t symbols, bool counting )
+{
+    double tSym = BEACONSIM_SYMBOL_US / 1000.0;
+    double start = Rtc( BeaconStart( k ) );
+    bool received = Present( k ) &&
+                    ( start >= open - ( BEACONSIM_PREAMBLE_SYMBOLS - BEACONSIM_LOCK_SYMBOLS ) * tSym ) &&
+                    ( start <= open + ( ( double )symbols - BEACONSIM_LOCK_SYMBOLS ) * tSym );
+
+    if( counting == true )
+    {
+        result->Windows++;
+        result->RxTime += ( received == true ) ? ( start + BEACONSIM_TIME_ON_AIR - open ) : symbols * tSym;
+    }
+    return received;
+}
+
+/*!
+ * \brief Opens the window of beacon k while tracking
+ */
+static bool Track( BeaconSimDevice_t *device, BeaconSimResult_t *result, uint32_t k, bool counting )
+{
+    TimerTime_t expected = device->LastLock + ( k - device->LastBeacon ) * CLASSB_BEACON_INTERVAL;
+    uint32_t rxError = BEACONSIM_RX_ERROR;
+    uint32_t symbols;
+    int32_t offset;
+
+    if( device->Search == true )
+    {
+        rxError = LoRaMacBeaconSearchGetError( &device->BeaconSearch, expected, BEACONSIM_RX_ERROR );
+    }
+    ComputeWindow( rxError, &symbols, &offset );
+    if( device->Search == true )
+    {
+        offset += LoRaMacBeaconSearchGetCorrection( &device->BeaconSearch, expected );
+    }
+    else if( k > device->LastBeacon + 1 )
+    {
+        offset -= ( int32_t )device->Movement;
+    }
+    return Window( result, k, ( double )expected + offset, symbols, counting );
+}
+
+/*!
+ * \brief Acquires the beacon from the true time now after a beacon loss
+ *
+ * \retval k Beacon received, 0 when the limit was reached
+ */
+static uint32_t Acquire( BeaconSimDevice_t *device, BeaconSimResult_t *result, double now, uint32_t limit,
+                         bool *counting )
+{
+    TimerTime_t expected;
+    uint32_t beaconTime;
+    uint32_t symbols;
+    int32_t offset;
+    uint32_t k;
+
+    while( true )
+    {
+        if( ( device->Search == true ) &&
+            ( LoRaMacBeaconSearchGetNextBeacon( &device->BeaconSearch, ( TimerTime_t )Rtc( now ), BEACONSIM_RX_ERROR,
+                                                &expected, &beaconTime ) == true ) )
+        {
+            k = ( beaconTime - BEACONSIM_GPS_START ) / ( CLASSB_BEACON_INTERVAL / 1000 );
+            if( k >= limit )
+            {
+                return 0;
+            }
+            *counting |= ( k >= OutageStart );
+            ComputeWindow( LoRaMacBeaconSearchGetError( &device->BeaconSearch, expected, BEACONSIM_RX_ERROR ),
+                           &symbols, &offset );
+            offset += LoRaMacBeaconSearchGetCorrection( &device->BeaconSearch, expected );
+            if( Window( result, k, ( double )expected + offset, symbols, *counting ) == true )
+            {
+                return k;
+            }
+            LoRaMacBeaconSearchOnMiss( &device->BeaconSearch );
+            now = BeaconStart( k ) + CLASSB_BEACON_RESERVED;
+            continue;
+        }
+
+        // Continuous acquisition of a beacon interval
+        k = ( uint32_t )ceil( now / CLASSB_BEACON_INTERVAL );
+        if( k >= limit )
+        {
+            return 0;
+        }
+        *counting |= ( k >= OutageStart );
+        if( *counting == true )
+        {
+            result->Acquisitions++;
+        }
+        if( Present( k ) == true )
+        {
+            if( *counting == true )
+            {
+                result->RxTime += BeaconStart( k ) + BEACONSIM_TIME_ON_AIR - now;
+            }
+            return k;
+        }
+        if( *counting == true )
+        {
+            result->RxTime += CLASSB_BEACON_INTERVAL;
+        }
+        // Not found, the application requests the acquisition again
+        now += CLASSB_BEACON_INTERVAL;
+        if( device->Search == true )
+        {
+            LoRaMacBeaconSearchOnLost( &device->BeaconSearch );
+        }
+    }
+}
+
+/*!
+ * \brief Tracks the beacons following beacon k
+ *
+ * \retval k Next beacon received, 0 when the limit was reached
+ */
+static uint32_t Follow( BeaconSimDevice_t *device, BeaconSimResult_t *result, uint32_t k, uint32_t limit,
+                        bool *counting )
+{
+    for( k++; k < limit; k++ )
+    {
+        *counting |= ( k >= OutageStart );
+        if( Track( device, result, k, *counting ) == true )
+        {
+            return k;
+        }
+
+        if( device->Search == true )
+        {
+            LoRaMacBeaconSearchOnMiss( &device->BeaconSearch );
+        }
+        else
+        {
+            device->Movement *= CLASSB_WINDOW_MOVE_EXPANSION_FACTOR;
+            if( device->Movement > CLASSB_WINDOW_MOVE_EXPANSION_MAX )
+            {
+                device->Movement = CLASSB_WINDOW_MOVE_EXPANSION_MAX;
+            }
+        }
+        if( ( Rtc( BeaconStart( k ) ) - device->LastLock ) > CLASSB_MAX_BEACON_LESS_PERIOD )
+        {
+            if( *counting == true )
+            {
+                result->Losses++;
+            }
+            if( device->Search == true )
+            {
+                LoRaMacBeaconSearchOnLost( &device->BeaconSearch );
+            }
+            return Acquire( device, result, BeaconStart( k ) + CLASSB_BEACON_RESERVED, limit, counting );
+        }
+    }
+    return 0;
+}
+
+static void Run( BeaconSimResult_t *result, bool search, uint32_t outage )
+{
+    BeaconSimDevice_t device = { .Search = search };
+    uint32_t limit;
+    bool counting = false;
+    uint32_t k;
+
+    memset( result, 0, sizeof( BeaconSimResult_t ) );
+    LoRaMacBeaconSearchInit( &device.BeaconSearch );
+    OutageStart = BEACONSIM_WARM_UP + 1;
+    OutageEnd = OutageStart + outage;
+    limit = OutageEnd + BEACONSIM_LIMIT;
+
+    k = Acquire( &device, result, CLASSB_BEACON_INTERVAL / 2, limit, &counting );
+    while( k != 0 )
+    {
+        Lock( &device, result, k );
+        if( ( counting == true ) && ( k >= OutageEnd ) )
+        {
+            result->Locked = true;
+            result->TimeToLock = ( BeaconStart( k ) - BeaconStart( OutageEnd ) ) / 1000.0;
+            break;
+        }
+        k = Follow( &device, result, k, limit, &counting );
+    }
+    if( search == true )
+    {
+        result->Stats = LoRaMacBeaconSearchGetStats( &device.BeaconSearch );
+    }
+}
+
+static double Energy( const BeaconSimResult_t *result )
+{
+    return result->RxTime * BEACONSIM_RX_CURRENT * BEACONSIM_SUPPLY / 1000.0;
+}
+
+static void Print( const char *name, const BeaconSimResult_t *result )
+{
+    printf( "  %-7s rx %9.1f ms  energy %8.2f mJ  windows %4u  acquisitions %3u  losses %u  ", name, result->RxTime,
+            Energy( result ), result->Windows, result->Acquisitions, result->Losses );
+    if( result->Locked == true )
+    {
+        printf( "lock after %6.0f s\n", result->TimeToLock );
+    }
+    else
+    {
+        printf( "not locked\n" );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t outages[BEACONSIM_MAX_SCENARIOS] = { 1, 4, 16, 32, 56, 64, 120 };
+    uint32_t nbOutages = 7;
+    BeaconSimResult_t legacy;
+    BeaconSimResult_t search;
+    double legacyEnergy = 0;
+    double searchEnergy = 0;
+    int status = 0;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "d:j:l:f:s:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+            case 'd': Drift = atoi( optarg ); break;
+            case 'j': Jitter = ( uint32_t )atoi( optarg ); break;
+            case 'l': Latency = ( uint32_t )atoi( optarg ); break;
+            case 'f': Fading = ( uint32_t )atoi( optarg ); break;
+            case 's': Seed = ( uint32_t )atoi( optarg ); break;
+            default:
+                fprintf( stderr, "usage: beaconsim [-d drift ppb] [-j jitter ms] [-l latency ms] [-f fading %%] [-s seed] [outage beacons...]\n" );
+                return 2;
+        }
+    }
+    if( optind < argc )
+    {
+        nbOutages = 0;
+        for( ; ( optind < argc ) && ( nbOutages < BEACONSIM_MAX_SCENARIOS ); optind++ )
+        {
+            outages[nbOutages++] = ( uint32_t )atoi( optarg = argv[optind] );
+        }
+    }
+    if( Fading >= 50 )
+    {
+        fprintf( stderr, "beaconsim: fading must stay below 50 %%\n" );
+        return 2;
+    }
+
+    printf( "RTC drift %+.3f ppm, jitter %u ms, latency %u ms, fading %u %%, %u beacons tracked before the outage\n",
+            Drift / 1000.0, Jitter, Latency, Fading, BEACONSIM_WARM_UP );
+
+    for( uint32_t i = 0; i < nbOutages; i++ )
+    {
+        Run( &legacy, false, outages[i] );
+        Run( &search, true, outages[i] );
+
+        printf( "outage of %u beacons (%.1f min)\n", outages[i], outages[i] * CLASSB_BEACON_INTERVAL / 60000.0 );
+        Print( "legacy", &legacy );
+        Print( "search", &search );
+        printf( "  drift %+.3f ppm, recovered at step", search.Stats.Drift / 1000.0 );
+        for( uint32_t step = 0; step <= LORAMAC_BEACON_SEARCH_MAX_STEP; step++ )
+        {
+            printf( " %u", search.Stats.Recovered[step] );
+        }
+        printf( ", longest outage %u\n", search.Stats.LongestOutage );
+
+        legacyEnergy += Energy( &legacy );
+        searchEnergy += Energy( &search );
+        if( ( search.Locked == false ) ||
+            ( ( legacy.Locked == true ) && ( search.TimeToLock > legacy.TimeToLock ) ) )
+        {
+            printf( "FAIL search locks later\n" );
+            status = 1;
+        }
+        if( abs( search.Stats.Drift - Drift ) > LORAMAC_BEACON_SEARCH_DRIFT_MARGIN )
+        {
+            printf( "FAIL drift estimate\n" );
+            status = 1;
+        }
+        // The beacon start is known within the interrupt jitter, whatever
+        // the processing latency
+        if( search.LockError > Jitter + 1 )
+        {
+            printf( "FAIL beacon start off by %.1f ms\n", search.LockError );
+            status = 1;
+        }
+    }
+
+    printf( "energy over the outages: legacy %.1f mJ, search %.1f mJ\n", legacyEnergy, searchEnergy );
+    if( searchEnergy >= legacyEnergy )
+    {
+        printf( "FAIL search costs more energy\n" );
+        status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,471 @@
+/*!
+ * \file      clocksim.c
+ *
+ * \brief     Host simulation of the clock discipline with a drifting RTC
+ *
+ * \details   Runs ClockDiscipline.c on the host against a simulated RTC
+ *            whose crystal drifts by a constant offset plus a daily
+ *            temperature swing. The RTC frequency compensation mimics the
+ *            STM32WL smooth calibration (0.954 ppm steps, TIMER_IF
+ *            rounding) and the timer server runs on the compensated RTC.
+ *
+ *            The network answers the synchronization requests either with
+ *            a DeviceTimeAns (1/256 s, applied by the MAC layer) or with an
+ *            AppTimeAns (whole seconds), at the period returned by
+ *            ClockDisciplineGetPeriod. The same scenario is then replayed
+ *            with the former behaviour: the correction is stepped at the
+ *            nominal period.
+ *
+ *            The system time error is sampled every second once the first
+ *            day is over. The simulation fails when the drift estimate is
+ *            off, when the error leaves twice CLOCK_DISCIPLINE_MAX_ERROR
+ *            above the correction resolution or when the discipline does
+ *            not save synchronization uplinks.
+ *
+ *            With DeviceTimeAns, a Class B switch is then run on the
+ *            disciplined clock: the RTC is set off by an error small enough
+ *            to be slewed, and the DeviceTimeAns is followed by the beacon
+ *            acquisition, which opens its window from the system time. The
+ *            error must stay in the system max RX error set by LmHandler
+ *            until the first beacon.
+ *
+ *            Usage: clocksim [-m device|app] [-d drift ppb] [-a swing ppb]
+ *                            [-t days] [-p period s] [-n]
+ *              -n  no RTC compensation, the corrections are stepped
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "timer.h"
+#include "systime.h"
+#include "ClockDiscipline.h"
+
+#define CLOCKSIM_START_TIME                         1600000000
+#define CLOCKSIM_DEFAULT_DRIFT                      23500
+#define CLOCKSIM_DEFAULT_SWING                      2000
+#define CLOCKSIM_DEFAULT_DAYS                       30
+#define CLOCKSIM_DEFAULT_PERIOD                     2048
+#define CLOCKSIM_SETTLE_TIME                        86400
+#define CLOCKSIM_BEACON_INTERVAL                    128
+/*!
+ * Error of the RTC when the Class B switch starts, in ms
+ */
+#define CLOCKSIM_CLASS_B_ERROR                      40
+/*!
+ * System max RX error set by LmHandler, in ms
+ */
+#define CLOCKSIM_MAX_RX_ERROR                       20
+
+typedef struct ClockSimResult_s
+{
+    uint32_t Syncs;
+    double MaxError;
+    double SumSquareError;
+    uint32_t Samples;
+    int32_t Drift;
+    bool DriftValid;
+}ClockSimResult_t;
+
+/*!
+ * Simulated RTC, in ms since power up
+ */
+static double RtcMs;
+static int32_t RtcCompensation;
+static uint32_t BackupSeconds;
+static uint32_t BackupSubSeconds;
+
+/*!
+ * Simulated timer server alarm
+ */
+static uint32_t TimerContext;
+static uint32_t TimerAlarm;
+static bool TimerArmed;
+
+/*!
+ * Class B switch pending, the corrections are stepped
+ */
+static bool ClassBSwitchPending;
+
+/*
+ *=============================================================================
+ * Host timer and systime drivers on the simulated RTC
+ *=============================================================================
+ */
+
+static uint32_t HostRtcTicks( void )
+{
+    return ( uint32_t )( uint64_t )RtcMs;
+}
+
+static UTIL_TIMER_Status_t HostTimerStatusOk( void )
+{
+    return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t HostTimerStart( uint32_t timeout )
+{
+    TimerAlarm = TimerContext + timeout;
+    TimerArmed = true;
+    return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t HostTimerStop( void )
+{
+    TimerArmed = false;
+    return UTIL_TIMER_OK;
+}
+
+static uint32_t HostTimerSetContext( void )
+{
+    TimerContext = HostRtcTicks( );
+    return TimerContext;
+}
+
+static uint32_t HostTimerGetContext( void )
+{
+    return TimerContext;
+}
+
+static uint32_t HostTimerElapsed( void )
+{
+    return HostRtcTicks( ) - TimerContext;
+}
+
+static uint32_t HostTimerMinimumTimeout( void )
+{
+    return 1;
+}
+
+static uint32_t HostTimerIdentity( uint32_t value )
+{
+    return value;
+}
+
+const UTIL_TIMER_Driver_s UTIL_TimerDriver =
+{
+    HostTimerStatusOk,
+    HostTimerStatusOk,
+    HostTimerStart,
+    HostTimerStop,
+    HostTimerSetContext,
+    HostTimerGetContext,
+    HostTimerElapsed,
+    HostRtcTicks,
+    HostTimerMinimumTimeout,
+    HostTimerIdentity,
+    HostTimerIdentity,
+};
+
+static uint32_t HostSysTimeGetCalendarTime( uint16_t *subSeconds )
+{
+    uint64_t now = ( uint64_t )RtcMs;
+
+    *subSeconds = ( uint16_t )( now % 1000 );
+    return ( uint32_t )( now / 1000 );
+}
+
+static void HostWriteSeconds( uint32_t seconds )
+{
+    BackupSeconds = seconds;
+}
+
+static uint32_t HostReadSeconds( void )
+{
+    return BackupSeconds;
+}
+
+static void HostWriteSubSeconds( uint32_t subSeconds )
+{
+    BackupSubSeconds = subSeconds;
+}
+
+static uint32_t HostReadSubSeconds( void )
+{
+    return BackupSubSeconds;
+}
+
+const UTIL_SYSTIM_Driver_s UTIL_SYSTIMDriver =
+{
+    HostWriteSeconds,
+    HostReadSeconds,
+    HostWriteSubSeconds,
+    HostReadSubSeconds,
+    HostSysTimeGetCalendarTime,
+};
+
+/*!
+ * \brief Smooth calibration model, same rounding and range as
+ *        TIMER_IF_SetDriftCompensation
+ */
+static int32_t HostSetDriftCompensation( int32_t drift )
+{
+    int32_t pulses = ( int32_t )( ( ( int64_t )drift * 1048576 + ( ( drift < 0 ) ? -500000000 : 500000000 ) ) / 1000000000 );
+
+    if( pulses < -512 )
+    {
+        pulses = -512;
+    }
+    else if( pulses > 511 )
+    {
+        pulses = 511;
+    }
+    RtcCompensation = ( int32_t )( ( ( int64_t )pulses * 1000000000 ) / 1048576 );
+    return RtcCompensation;
+}
+
+static bool HostIsStepRequired( void )
+{
+    return ClassBSwitchPending;
+}
+
+/*
+ *=============================================================================
+ * Scenario
+ *=============================================================================
+ */
+
+static double CrystalDrift( double trueTime, int32_t drift, int32_t swing )
+{
+    return drift + swing * sin( 2.0 * M_PI * trueTime / 86400.0 );
+}
+
+/*!
+ * \brief Network time in ms minus system time in ms
+ */
+static double TimeError( double trueTime )
+{
+    SysTime_t sysTime = SysTimeGet( );
+
+    return ( ( double )sysTime.Seconds - CLOCKSIM_START_TIME ) * 1000.0 + sysTime.SubSeconds - trueTime * 1000.0;
+}
+
+static void Synchronize( double trueTime, bool appTime, bool discipline )
+{
+    double networkMs = ( CLOCKSIM_START_TIME + trueTime ) * 1000.0;
+
+    if( appTime == true )
+    {
+        // AppTimeAns, whole seconds correction
+        SysTime_t correction = { 0 };
+
+        correction.Seconds = ( uint32_t )( int32_t )lround( -TimeError( trueTime ) / 1000.0 );
+        if( discipline == true )
+        {
+            ClockDisciplineCorrect( correction, CLOCK_DISCIPLINE_APP_TIME_RESOLUTION );
+        }
+        else
+        {
+            SysTimeSet( SysTimeAdd( SysTimeGet( ), correction ) );
+        }
+    }
+    else
+    {
+        // DeviceTimeAns, 1/256 s, applied by the MAC layer
+        uint64_t fraction = ( uint64_t )floor( networkMs * 256.0 / 1000.0 );
+        SysTime_t sysTime = { 0 };
+
+        sysTime.Seconds = ( uint32_t )( fraction / 256 );
+        sysTime.SubSeconds = ( int16_t )( ( ( fraction % 256 ) * 1000 ) >> 8 );
+        SysTimeSet( sysTime );
+        if( discipline == true )
+        {
+            ClockDisciplineSynchronized( CLOCK_DISCIPLINE_DEVICE_TIME_RESOLUTION );
+        }
+    }
+}
+
+/*!
+ * \brief Runs one second of the crystal, as seen through the compensation
+ */
+static void Tick( double *trueTime, int32_t drift, int32_t swing )
+{
+    RtcMs += 1000.0 * ( 1.0 + ( CrystalDrift( *trueTime, drift, swing ) - RtcCompensation ) * 1e-9 );
+    *trueTime += 1;
+
+    if( ( TimerArmed == true ) && ( ( int32_t )( HostRtcTicks( ) - TimerAlarm ) >= 0 ) )
+    {
+        TimerArmed = false;
+        UTIL_TIMER_IRQ_Handler( );
+    }
+}
+
+static void Run( ClockSimResult_t *result, bool appTime, bool discipline, bool compensation,
+                 int32_t drift, int32_t swing, uint32_t days, uint32_t period )
+{
+    double trueTime = 0;
+    double nextSync = 10;
+
+    memset( result, 0, sizeof( ClockSimResult_t ) );
+    RtcMs = 0;
+    RtcCompensation = 0;
+    BackupSeconds = 0;
+    BackupSubSeconds = 0;
+    TimerArmed = false;
+    ClassBSwitchPending = false;
+    UTIL_TIMER_Init( );
+
+    if( discipline == true )
+    {
+        ClockDisciplineInit( ( compensation == true ) ? HostSetDriftCompensation : NULL, HostIsStepRequired );
+    }
+
+    while( trueTime < days * 86400.0 )
+    {
+        if( trueTime >= nextSync )
+        {
+            Synchronize( trueTime, appTime, discipline );
+            result->Syncs++;
+            nextSync = trueTime + ( ( discipline == true ) ? ClockDisciplineGetPeriod( period ) : period );
+        }
+
+        Tick( &trueTime, drift, swing );
+
+        if( trueTime >= CLOCKSIM_SETTLE_TIME )
+        {
+            double error = TimeError( trueTime );
+
+            if( fabs( error ) > result->MaxError )
+            {
+                result->MaxError = fabs( error );
+            }
+            result->SumSquareError += error * error;
+            result->Samples++;
+        }
+    }
+    if( discipline == true )
+    {
+        result->DriftValid = ClockDisciplineGetDrift( &result->Drift );
+    }
+}
+
+/*!
+ * \brief Switches to Class B on the clock left by Run: DeviceTimeAns, then
+ *        beacon acquisition from the system time
+ *
+ * \retval error Largest system time error until the first beacon in ms
+ */
+static double RunClassBSwitch( double trueTime, int32_t drift, int32_t swing )
+{
+    double maxError = 0;
+    double end = trueTime + CLOCKSIM_BEACON_INTERVAL;
+
+    // Synchronized clock, then off by an error the discipline would slew
+    Synchronize( trueTime, false, true );
+    RtcMs += CLOCKSIM_CLASS_B_ERROR;
+
+    ClassBSwitchPending = true;
+    Synchronize( trueTime, false, true );
+
+    // The acquisition waits for the next beacon by the system time
+    while( trueTime < end )
+    {
+        double error = TimeError( trueTime );
+
+        if( fabs( error ) > maxError )
+        {
+            maxError = fabs( error );
+        }
+        Tick( &trueTime, drift, swing );
+    }
+    ClassBSwitchPending = false;
+    return maxError;
+}
+
+static void Print( const char *name, const ClockSimResult_t *result )
+{
+    printf( "%-12s syncs %6u  max error %9.1f ms  rms error %9.1f ms", name, result->Syncs, result->MaxError,
+            sqrt( result->SumSquareError / ( result->Samples ? result->Samples : 1 ) ) );
+    if( result->DriftValid == true )
+    {
+        printf( "  drift %+9.3f ppm", result->Drift / 1000.0 );
+    }
+    printf( "\n" );
+}
+
+int main( int argc, char **argv )
+{
+    ClockSimResult_t disciplined;
+    ClockSimResult_t stepped;
+    bool appTime = false;
+    bool compensation = true;
+    int32_t drift = CLOCKSIM_DEFAULT_DRIFT;
+    int32_t swing = CLOCKSIM_DEFAULT_SWING;
+    uint32_t days = CLOCKSIM_DEFAULT_DAYS;
+    uint32_t period = CLOCKSIM_DEFAULT_PERIOD;
+    double bound;
+    int status = 0;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "m:d:a:t:p:n" ) ) != -1 )
+    {
+        switch( opt )
+        {
+            case 'm': appTime = ( strcmp( optarg, "app" ) == 0 ); break;
+            case 'd': drift = atoi( optarg ); break;
+            case 'a': swing = atoi( optarg ); break;
+            case 't': days = ( uint32_t )atoi( optarg ); break;
+            case 'p': period = ( uint32_t )atoi( optarg ); break;
+            case 'n': compensation = false; break;
+            default:
+                fprintf( stderr, "usage: clocksim [-m device|app] [-d drift ppb] [-a swing ppb] [-t days] [-p period s] [-n]\n" );
+                return 2;
+        }
+    }
+    if( ( days < 2 ) || ( period == 0 ) )
+    {
+        fprintf( stderr, "clocksim: at least 2 days and a non zero period are required\n" );
+        return 2;
+    }
+
+    printf( "%s, crystal %+.3f ppm, swing %.3f ppm, %u days, period %u s\n", ( appTime == true ) ? "AppTimeAns" : "DeviceTimeAns",
+            drift / 1000.0, swing / 1000.0, days, period );
+
+    Run( &stepped, appTime, false, false, drift, swing, days, period );
+    Run( &disciplined, appTime, true, compensation, drift, swing, days, period );
+    Print( "disciplined", &disciplined );
+    Print( "stepped", &stepped );
+
+    if( compensation == false )
+    {
+        return 0;
+    }
+
+    // The error of a disciplined clock stays within the correction
+    // resolution plus the error bound the period is stretched for. A fast
+    // drift change may exceed the bound for one stretched period before it
+    // is shrunk.
+    bound = ( ( appTime == true ) ? CLOCK_DISCIPLINE_APP_TIME_RESOLUTION : CLOCK_DISCIPLINE_DEVICE_TIME_RESOLUTION ) +
+            2 * CLOCK_DISCIPLINE_MAX_ERROR;
+    if( ( disciplined.DriftValid == false ) || ( abs( disciplined.Drift - drift ) > swing + CLOCK_DISCIPLINE_DRIFT_ACCURACY ) )
+    {
+        printf( "FAIL drift estimate\n" );
+        status = 1;
+    }
+    if( disciplined.MaxError > bound )
+    {
+        printf( "FAIL error above %.0f ms\n", bound );
+        status = 1;
+    }
+    if( disciplined.Syncs >= stepped.Syncs )
+    {
+        printf( "FAIL no synchronization saved\n" );
+        status = 1;
+    }
+
+    if( appTime == false )
+    {
+        // Continues the disciplined run
+        double error = RunClassBSwitch( days * 86400.0, drift, swing );
+
+        printf( "class B switch, max error %.1f ms until the first beacon\n", error );
+        if( error > CLOCKSIM_MAX_RX_ERROR )
+        {
+            printf( "FAIL error above the %u ms system max RX error\n", CLOCKSIM_MAX_RX_ERROR );
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,366 @@
+/*!
+ * \file      cmdtest.c
+ *
+ * \brief     Host test and benchmark of the AT command lookup
+ *
+ * \details   lora_command.c of the FreeRTOS AT application is included to
+ *            reach its command table and the hash index of CMD_Find. The
+ *            index is checked against an exact name linear scan of the
+ *            table for every command with every suffix, for truncated,
+ *            extended, lowercase and random names. It is compared with the
+ *            strncmp scan it replaced, which stopped at the first entry
+ *            whose name is a prefix of the line: the names it shadowed, as
+ *            +SENDB behind +SEND, are reported.
+ *
+ *            With -b the lookup time of the index and of the previous scan
+ *            is measured over the lines of the cases.
+ *
+ *            Usage: cmdtest [-b repeat]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "at_host.h"
+
+#include "lora_command.c"
+
+#define CHECK( cond )                                                         \
+    do                                                                        \
+    {                                                                         \
+        if( !( cond ) )                                                       \
+        {                                                                     \
+            printf( "FAIL %s line %d: %s\n", __func__, __LINE__, #cond );     \
+            return false;                                                     \
+        }                                                                     \
+    }while( 0 )
+
+typedef struct CmdTestCase_s
+{
+    const char *Name;
+    bool ( *Run )( void );
+}CmdTestCase_t;
+
+#define CMDTEST_COMMANDS                            ( sizeof( ATCommand ) / sizeof( ATCommand[0] ) )
+
+/*!
+ * Longest line of the cases
+ */
+#define CMDTEST_LINE_MAX                            32
+
+/*!
+ * Random lines of the random case
+ */
+#define CMDTEST_RANDOM_LINES                        200000
+
+/*!
+ * Suffixes of a command name: run, set, get, help, set with a value
+ */
+static const char *Suffixes[] = { "", "=", "=?", "?", "=x", "=1:0:0A" };
+
+static uint32_t Rng = 1;
+
+static uint32_t Random( void )
+{
+    Rng ^= Rng << 13;
+    Rng ^= Rng >> 17;
+    Rng ^= Rng << 5;
+    return Rng;
+}
+
+/*!
+ * \brief Reference lookup: the first entry whose name is the name of the line
+ */
+static const struct ATCommand_s *LinearFind( const char *cmd )
+{
+    size_t size = strcspn( cmd, "=?" );
+
+    for( uint32_t n = 0; n < CMDTEST_COMMANDS; n++ )
+    {
+        if( ( ( size_t )ATCommand[n].size_string == size ) && ( memcmp( ATCommand[n].string, cmd, size ) == 0 ) )
+        {
+            return &ATCommand[n];
+        }
+    }
+    return NULL;
+}
+
+/*!
+ * \brief Lookup of parse_cmd before the index: the first entry whose name
+ *        starts the line, a command is only dispatched when the name is
+ *        followed by '=', '?' or the end of the line
+ */
+static const struct ATCommand_s *PrefixFind( const char *cmd )
+{
+    for( uint32_t n = 0; n < CMDTEST_COMMANDS; n++ )
+    {
+        if( strncmp( cmd, ATCommand[n].string, ATCommand[n].size_string ) == 0 )
+        {
+            char next = cmd[ATCommand[n].size_string];
+
+            return ( ( next == '\0' ) || ( next == '=' ) || ( next == '?' ) ) ? &ATCommand[n] : NULL;
+        }
+    }
+    return NULL;
+}
+
+/*!
+ * \brief Returns true when an entry before the command has a name which is a
+ *        strict prefix of its name
+ */
+static bool Shadowed( const struct ATCommand_s *command )
+{
+    for( const struct ATCommand_s *entry = ATCommand; entry < command; entry++ )
+    {
+        if( ( entry->size_string < command->size_string ) &&
+            ( strncmp( command->string, entry->string, entry->size_string ) == 0 ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief Checks the index on one line, against the reference and against the
+ *        previous lookup
+ */
+static bool CheckLine( const char *line )
+{
+    const struct ATCommand_s *found = CMD_Find( line );
+    const struct ATCommand_s *previous = PrefixFind( line );
+
+    CHECK( found == LinearFind( line ) );
+    if( previous != found )
+    {
+        // The previous scan stopped early on a shorter name
+        CHECK( ( found != NULL ) && ( previous == NULL ) && ( Shadowed( found ) == true ) );
+    }
+    return true;
+}
+
+static void Reset( void )
+{
+    Rng = 1;
+    AtHostReset( );
+    CMD_Init( NULL );
+}
+
+/*!
+ * Every entry of the table with every suffix
+ */
+static bool EveryCommand( void )
+{
+    char line[CMDTEST_LINE_MAX];
+    uint32_t shadowed = 0;
+
+    Reset( );
+    for( uint32_t n = 0; n < CMDTEST_COMMANDS; n++ )
+    {
+        const struct ATCommand_s *first = LinearFind( ATCommand[n].string );
+
+        CHECK( ATCommand[n].size_string == ( int32_t )strlen( ATCommand[n].string ) );
+        CHECK( ATCommand[n].size_string < ( CMDTEST_LINE_MAX - 8 ) );
+        for( uint32_t s = 0; s < sizeof( Suffixes ) / sizeof( Suffixes[0] ); s++ )
+        {
+            snprintf( line, sizeof( line ), "%s%s", ATCommand[n].string, Suffixes[s] );
+            // A duplicated name resolves to its first entry
+            CHECK( CMD_Find( line ) == first );
+            CHECK( CheckLine( line ) == true );
+        }
+        if( ( first == &ATCommand[n] ) && ( Shadowed( first ) == true ) )
+        {
+            printf( "    %-36s shadowed in the previous scan\n", ATCommand[n].string );
+            shadowed++;
+        }
+    }
+    // +SENDB is behind +SEND in the table
+    CHECK( shadowed != 0 );
+    return true;
+}
+
+/*!
+ * Names which start or continue a command name
+ */
+static bool Prefixes( void )
+{
+    static const struct
+    {
+        const char *Line;
+        const char *Name;
+    }Lines[] =
+    {
+        { "+SEND=1:0:00", AT_SEND },
+        { "+SENDB=1:0:3", AT_SENDB },
+        { "+SENDB", AT_SENDB },
+        { "+SENDB?", AT_SENDB },
+        { "+SEN", NULL },
+        { "+SENDBX=1", NULL },
+        { "+SENDX", NULL },
+        { "+send=1:0:00", NULL },
+        { "+", NULL },
+        { "", NULL },
+        { "=?", NULL },
+        { "?", NULL },
+    };
+    char line[CMDTEST_LINE_MAX];
+
+    Reset( );
+    for( uint32_t n = 0; n < sizeof( Lines ) / sizeof( Lines[0] ); n++ )
+    {
+        const struct ATCommand_s *found = CMD_Find( Lines[n].Line );
+
+        if( Lines[n].Name == NULL )
+        {
+            CHECK( found == NULL );
+        }
+        else
+        {
+            CHECK( ( found != NULL ) && ( strcmp( found->string, Lines[n].Name ) == 0 ) );
+        }
+        CHECK( CheckLine( Lines[n].Line ) == true );
+    }
+
+    for( uint32_t n = 0; n < CMDTEST_COMMANDS; n++ )
+    {
+        size_t size = ( size_t )ATCommand[n].size_string;
+
+        for( uint32_t s = 0; s < sizeof( Suffixes ) / sizeof( Suffixes[0] ); s++ )
+        {
+            // Truncated, which may be another command
+            snprintf( line, sizeof( line ), "%.*s%s", ( int )size - 1, ATCommand[n].string, Suffixes[s] );
+            CHECK( CheckLine( line ) == true );
+            // Extended
+            snprintf( line, sizeof( line ), "%sZ%s", ATCommand[n].string, Suffixes[s] );
+            CHECK( CheckLine( line ) == true );
+            // Lowercase
+            snprintf( line, sizeof( line ), "%s%s", ATCommand[n].string, Suffixes[s] );
+            for( size_t k = 0; k < size; k++ )
+            {
+                line[k] = ( char )( ( ( line[k] >= 'A' ) && ( line[k] <= 'Z' ) ) ? ( line[k] + 'a' - 'A' ) : line[k] );
+            }
+            CHECK( CheckLine( line ) == true );
+        }
+    }
+    return true;
+}
+
+/*!
+ * Random lines made of the characters of the names
+ */
+static bool RandomLines( void )
+{
+    static const char Alphabet[] = "+ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_=?";
+    char line[CMDTEST_LINE_MAX];
+
+    Reset( );
+    for( uint32_t n = 0; n < CMDTEST_RANDOM_LINES; n++ )
+    {
+        const struct ATCommand_s *command = &ATCommand[Random( ) % CMDTEST_COMMANDS];
+        uint32_t size = Random( ) % 12;
+        uint32_t k = 0;
+
+        // Half of the lines start with a command name
+        if( ( Random( ) & 1 ) != 0 )
+        {
+            k = ( uint32_t )snprintf( line, sizeof( line ), "%s", command->string );
+        }
+        while( ( size-- > 0 ) && ( k < ( CMDTEST_LINE_MAX - 1 ) ) )
+        {
+            line[k++] = Alphabet[Random( ) % ( sizeof( Alphabet ) - 1 )];
+        }
+        line[k] = '\0';
+        CHECK( CheckLine( line ) == true );
+    }
+    return true;
+}
+
+static const CmdTestCase_t Cases[] =
+{
+    { "every command and suffix", EveryCommand },
+    { "prefixes", Prefixes },
+    { "random lines", RandomLines },
+};
+
+static uint64_t HostTimeNs( void )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( uint64_t )now.tv_sec * 1000000000 + ( uint64_t )now.tv_nsec;
+}
+
+/*!
+ * \brief Measures the lookup of every command with every suffix, and of as
+ *        many unknown names
+ */
+static void Bench( uint32_t repeat )
+{
+    static char lines[2 * CMDTEST_COMMANDS * ( sizeof( Suffixes ) / sizeof( Suffixes[0] ) )][CMDTEST_LINE_MAX];
+    const struct ATCommand_s *( *lookups[] )( const char *cmd ) = { CMD_Find, PrefixFind };
+    const char *names[] = { "hash index", "previous scan" };
+    volatile uintptr_t sink = 0;
+    uint32_t count = 0;
+
+    Reset( );
+    for( uint32_t n = 0; n < CMDTEST_COMMANDS; n++ )
+    {
+        for( uint32_t s = 0; s < sizeof( Suffixes ) / sizeof( Suffixes[0] ); s++ )
+        {
+            snprintf( lines[count++], CMDTEST_LINE_MAX, "%s%s", ATCommand[n].string, Suffixes[s] );
+            snprintf( lines[count++], CMDTEST_LINE_MAX, "%sZ%s", ATCommand[n].string, Suffixes[s] );
+        }
+    }
+
+    for( uint32_t l = 0; l < sizeof( lookups ) / sizeof( lookups[0] ); l++ )
+    {
+        uint64_t start = HostTimeNs( );
+
+        for( uint32_t r = 0; r < repeat; r++ )
+        {
+            for( uint32_t n = 0; n < count; n++ )
+            {
+                sink += ( uintptr_t )lookups[l]( lines[n] );
+            }
+        }
+        printf( "%-16s : %6.1f ns per line, %u commands, %u lines\n", names[l],
+                ( double )( HostTimeNs( ) - start ) / ( ( double )repeat * count ), ( unsigned )CMDTEST_COMMANDS,
+                ( unsigned )count );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t repeat = 0;
+    int status = 0;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "b:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+            case 'b': repeat = ( uint32_t )strtoul( optarg, NULL, 0 ); break;
+            default:
+                fprintf( stderr, "usage: cmdtest [-b repeat]\n" );
+                return 2;
+        }
+    }
+
+    for( uint32_t n = 0; n < sizeof( Cases ) / sizeof( Cases[0] ); n++ )
+    {
+        bool passed = Cases[n].Run( );
+
+        printf( "%-40s %s\n", Cases[n].Name, ( passed == true ) ? "ok" : "FAILED" );
+        if( passed == false )
+        {
+            status = 1;
+        }
+    }
+    if( repeat != 0 )
+    {
+        Bench( repeat );
+    }
+    return status;
+}
@@ -0,0 +1,332 @@
+/*!
+ * \file      confirmqtest.c
+ *
+ * \brief     Host test of the MLME confirm queue
+ *
+ * \details   Runs LoRaMacConfirmQueue.c on the host. The MAC confirm
+ *            primitive is replaced by a model recording the confirms it is
+ *            called with, and optionally adding a new request the way an
+ *            application retries a beacon acquisition.
+ *
+ *            Each case checks the queue when empty, when full, after the
+ *            ring buffer wrapped around, the in order delivery of the
+ *            confirms, the common status, requests added from a confirm
+ *            and several requests of the same type.
+ *
+ *            Usage: confirmqtest
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LoRaMac.h"
+#include "LoRaMacConfirmQueue.h"
+
+#define CONFIRMQTEST_MAX_CONFIRMS                   32
+
+#define CHECK( cond )                                                         \
+    do                                                                        \
+    {                                                                         \
+        if( !( cond ) )                                                       \
+        {                                                                     \
+            printf( "FAIL %s line %d: %s\n", __func__, __LINE__, #cond );     \
+            return false;                                                     \
+        }                                                                     \
+    }while( 0 )
+
+typedef struct ConfirmQTestCase_s
+{
+    const char *Name;
+    bool ( *Run )( void );
+}ConfirmQTestCase_t;
+
+static LoRaMacPrimitives_t Primitives;
+static MlmeConfirm_t MlmeConfirm;
+static Mlme_t Confirms[CONFIRMQTEST_MAX_CONFIRMS];
+static LoRaMacEventInfoStatus_t ConfirmStatus[CONFIRMQTEST_MAX_CONFIRMS];
+static uint8_t NbConfirms;
+static bool RetryAcquisition;
+
+static void HostMlmeConfirm( MlmeConfirm_t *mlmeConfirm )
+{
+    if( NbConfirms < CONFIRMQTEST_MAX_CONFIRMS )
+    {
+        Confirms[NbConfirms] = mlmeConfirm->MlmeRequest;
+        ConfirmStatus[NbConfirms] = mlmeConfirm->Status;
+        NbConfirms++;
+    }
+    if( ( RetryAcquisition == true ) && ( mlmeConfirm->MlmeRequest == MLME_BEACON_ACQUISITION ) &&
+        ( mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_BEACON_NOT_FOUND ) )
+    {
+        MlmeConfirmQueue_t element = { .Request = MLME_BEACON_ACQUISITION,
+                                       .Status = LORAMAC_EVENT_INFO_STATUS_ERROR,
+                                       .RestrictCommonReadyToHandle = true };
+
+        RetryAcquisition = false;
+        LoRaMacConfirmQueueAdd( &element );
+    }
+}
+
+static void Reset( void )
+{
+    Primitives.MacMlmeConfirm = HostMlmeConfirm;
+    LoRaMacConfirmQueueInit( &Primitives );
+    memset( &MlmeConfirm, 0, sizeof( MlmeConfirm ) );
+    NbConfirms = 0;
+    RetryAcquisition = false;
+}
+
+static bool Add( Mlme_t request, bool restrictCommon )
+{
+    MlmeConfirmQueue_t element = { .Request = request,
+                                   .Status = LORAMAC_EVENT_INFO_STATUS_ERROR,
+                                   .RestrictCommonReadyToHandle = restrictCommon };
+
+    return LoRaMacConfirmQueueAdd( &element );
+}
+
+static bool Empty( void )
+{
+    Reset( );
+    CHECK( LoRaMacConfirmQueueGetCnt( ) == 0 );
+    CHECK( LoRaMacConfirmQueueIsFull( ) == false );
+    for( Mlme_t request = MLME_UNKNOWN; request <= MLME_BEACON_LOST; request++ )
+    {
+        CHECK( LoRaMacConfirmQueueIsCmdActive( request ) == false );
+        CHECK( LoRaMacConfirmQueueGetStatus( request ) == LORAMAC_EVENT_INFO_STATUS_ERROR );
+    }
+    CHECK( LoRaMacConfirmQueueRemoveFirst( ) == false );
+    CHECK( LoRaMacConfirmQueueRemoveLast( ) == false );
+
+    // A status without request is dropped
+    LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_JOIN );
+    LoRaMacConfirmQueueHandleCb( &MlmeConfirm );
+    CHECK( NbConfirms == 0 );
+    CHECK( LoRaMacConfirmQueueIsCmdActive( MLME_JOIN ) == false );
+    return true;
+}
+
+static bool Full( void )
+{
+    const Mlme_t requests[LORA_MAC_MLME_CONFIRM_QUEUE_LEN] =
+    {
+        MLME_JOIN, MLME_LINK_CHECK, MLME_DEVICE_TIME, MLME_PING_SLOT_INFO, MLME_BEACON_TIMING
+    };
+
+    Reset( );
+    for( uint8_t i = 0; i < LORA_MAC_MLME_CONFIRM_QUEUE_LEN; i++ )
+    {
+        CHECK( LoRaMacConfirmQueueIsFull( ) == false );
+        CHECK( Add( requests[i], false ) == true );
+    }
+    CHECK( LoRaMacConfirmQueueIsFull( ) == true );
+    CHECK( LoRaMacConfirmQueueGetCnt( ) == LORA_MAC_MLME_CONFIRM_QUEUE_LEN );
+    CHECK( Add( MLME_TXCW, false ) == false );
+    CHECK( LoRaMacConfirmQueueIsCmdActive( MLME_TXCW ) == false );
+    for( uint8_t i = 0; i < LORA_MAC_MLME_CONFIRM_QUEUE_LEN; i++ )
+    {
+        CHECK( LoRaMacConfirmQueueIsCmdActive( requests[i] ) == true );
+    }
+
+    // The last request is withdrawn, a new one takes its place
+    CHECK( LoRaMacConfirmQueueRemoveLast( ) == true );
+    CHECK( LoRaMacConfirmQueueIsCmdActive( MLME_BEACON_TIMING ) == false );
+    CHECK( Add( MLME_TXCW, false ) == true );
+    CHECK( LoRaMacConfirmQueueIsCmdActive( MLME_TXCW ) == true );
+
+    // Every request confirmed, in order
+    LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_TXCW );
+    LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_JOIN_FAIL, MLME_JOIN );
+    LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_PING_SLOT_INFO );
+    LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_DEVICE_TIME );
+    LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_LINK_CHECK );
+    LoRaMacConfirmQueueHandleCb( &MlmeConfirm );
+    CHECK( NbConfirms == LORA_MAC_MLME_CONFIRM_QUEUE_LEN );
+    CHECK( ( Confirms[0] == MLME_JOIN ) && ( ConfirmStatus[0] == LORAMAC_EVENT_INFO_STATUS_JOIN_FAIL ) );
+    CHECK( Confirms[1] == MLME_LINK_CHECK );
+    CHECK( Confirms[2] == MLME_DEVICE_TIME );
+    CHECK( Confirms[3] == MLME_PING_SLOT_INFO );
+    CHECK( Confirms[4] == MLME_TXCW );
+    CHECK( LoRaMacConfirmQueueGetCnt( ) == 0 );
+    return true;
+}
+
+static bool WrapAround( void )
+{
+    const Mlme_t requests[] = { MLME_JOIN, MLME_LINK_CHECK, MLME_DEVICE_TIME };
+
+    Reset( );
+    // Two requests in flight move the first index all around the buffer
+    CHECK( Add( MLME_TXCW, false ) == true );
+    for( uint8_t i = 0; i < 3 * LORA_MAC_MLME_CONFIRM_QUEUE_LEN; i++ )
+    {
+        Mlme_t request = requests[i % 3];
+
+        CHECK( Add( request, false ) == true );
+        CHECK( LoRaMacConfirmQueueGetCnt( ) == 2 );
+        CHECK( LoRaMacConfirmQueueIsCmdActive( request ) == true );
+        LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_RX1_TIMEOUT, request );
+        CHECK( LoRaMacConfirmQueueGetStatus( request ) == LORAMAC_EVENT_INFO_STATUS_RX1_TIMEOUT );
+
+        // The older request is removed first
+        CHECK( LoRaMacConfirmQueueRemoveFirst( ) == true );
+        CHECK( LoRaMacConfirmQueueIsCmdActive( request ) == true );
+        if( i == 0 )
+        {
+            CHECK( LoRaMacConfirmQueueIsCmdActive( MLME_TXCW ) == false );
+        }
+        else
+        {
+            CHECK( LoRaMacConfirmQueueIsCmdActive( requests[( i - 1 ) % 3] ) == false );
+        }
+        // Keep two in flight
+        CHECK( Add( MLME_BEACON_TIMING, false ) == true );
+        CHECK( LoRaMacConfirmQueueRemoveFirst( ) == true );
+        CHECK( LoRaMacConfirmQueueIsCmdActive( request ) == false );
+        CHECK( LoRaMacConfirmQueueIsCmdActive( MLME_BEACON_TIMING ) == true );
+        CHECK( LoRaMacConfirmQueueRemoveLast( ) == true );
+        CHECK( Add( requests[i % 3], false ) == true );
+        CHECK( Add( requests[( i + 1 ) % 3], false ) == true );
+        CHECK( LoRaMacConfirmQueueRemoveFirst( ) == true );
+        CHECK( LoRaMacConfirmQueueGetCnt( ) == 1 );
+    }
+
+    // The confirms still come in order after the wrap around
+    CHECK( Add( MLME_PING_SLOT_INFO, false ) == true );
+    CHECK( Add( MLME_BEACON_TIMING, false ) == true );
+    LoRaMacConfirmQueueSetStatusCmn( LORAMAC_EVENT_INFO_STATUS_OK );
+    LoRaMacConfirmQueueHandleCb( &MlmeConfirm );
+    CHECK( NbConfirms == 3 );
+    CHECK( Confirms[0] == requests[( 3 * LORA_MAC_MLME_CONFIRM_QUEUE_LEN ) % 3] );
+    CHECK( Confirms[1] == MLME_PING_SLOT_INFO );
+    CHECK( Confirms[2] == MLME_BEACON_TIMING );
+    CHECK( LoRaMacConfirmQueueGetCnt( ) == 0 );
+    return true;
+}
+
+static bool InOrder( void )
+{
+    Reset( );
+    CHECK( Add( MLME_BEACON_ACQUISITION, true ) == true );
+    CHECK( Add( MLME_LINK_CHECK, false ) == true );
+    CHECK( Add( MLME_DEVICE_TIME, false ) == true );
+
+    // The pending acquisition stays first, the later requests are confirmed
+    LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_DEVICE_TIME );
+    LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_LINK_CHECK );
+    LoRaMacConfirmQueueHandleCb( &MlmeConfirm );
+    CHECK( NbConfirms == 2 );
+    CHECK( ( Confirms[0] == MLME_LINK_CHECK ) && ( Confirms[1] == MLME_DEVICE_TIME ) );
+    CHECK( LoRaMacConfirmQueueGetCnt( ) == 1 );
+    CHECK( LoRaMacConfirmQueueIsCmdActive( MLME_BEACON_ACQUISITION ) == true );
+    CHECK( LoRaMacConfirmQueueIsCmdActive( MLME_LINK_CHECK ) == false );
+
+    // A request added behind it is confirmed after it
+    CHECK( Add( MLME_PING_SLOT_INFO, false ) == true );
+    LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_PING_SLOT_INFO );
+    LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_BEACON_ACQUISITION );
+    LoRaMacConfirmQueueHandleCb( &MlmeConfirm );
+    CHECK( NbConfirms == 4 );
+    CHECK( ( Confirms[2] == MLME_BEACON_ACQUISITION ) && ( Confirms[3] == MLME_PING_SLOT_INFO ) );
+    CHECK( LoRaMacConfirmQueueGetCnt( ) == 0 );
+    return true;
+}
+
+static bool CommonStatus( void )
+{
+    Reset( );
+    CHECK( LoRaMacConfirmQueueGetStatusCmn( ) == LORAMAC_EVENT_INFO_STATUS_ERROR );
+    CHECK( Add( MLME_BEACON_ACQUISITION, true ) == true );
+    CHECK( Add( MLME_JOIN, false ) == true );
+
+    // The restricted request takes the status but is not confirmed
+    LoRaMacConfirmQueueSetStatusCmn( LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT );
+    CHECK( LoRaMacConfirmQueueGetStatusCmn( ) == LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT );
+    CHECK( LoRaMacConfirmQueueGetStatus( MLME_BEACON_ACQUISITION ) == LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT );
+    LoRaMacConfirmQueueHandleCb( &MlmeConfirm );
+    CHECK( NbConfirms == 1 );
+    CHECK( ( Confirms[0] == MLME_JOIN ) && ( ConfirmStatus[0] == LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT ) );
+    CHECK( LoRaMacConfirmQueueIsCmdActive( MLME_BEACON_ACQUISITION ) == true );
+    return true;
+}
+
+static bool AddFromConfirm( void )
+{
+    Reset( );
+    for( uint8_t i = 0; i < LORA_MAC_MLME_CONFIRM_QUEUE_LEN; i++ )
+    {
+        CHECK( Add( ( i == 0 ) ? MLME_BEACON_ACQUISITION : MLME_TXCW, false ) == true );
+    }
+
+    // The full queue still takes the retry of the acquisition confirmed
+    RetryAcquisition = true;
+    LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_BEACON_NOT_FOUND, MLME_BEACON_ACQUISITION );
+    LoRaMacConfirmQueueHandleCb( &MlmeConfirm );
+    CHECK( NbConfirms == 1 );
+    CHECK( RetryAcquisition == false );
+    CHECK( LoRaMacConfirmQueueGetCnt( ) == LORA_MAC_MLME_CONFIRM_QUEUE_LEN );
+    CHECK( LoRaMacConfirmQueueIsCmdActive( MLME_BEACON_ACQUISITION ) == true );
+    CHECK( LoRaMacConfirmQueueGetStatus( MLME_BEACON_ACQUISITION ) == LORAMAC_EVENT_INFO_STATUS_ERROR );
+    return true;
+}
+
+static bool SameType( void )
+{
+    Reset( );
+    CHECK( Add( MLME_LINK_CHECK, false ) == true );
+    CHECK( Add( MLME_JOIN, false ) == true );
+    CHECK( Add( MLME_LINK_CHECK, false ) == true );
+
+    // The oldest request of the type is addressed
+    LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_LINK_CHECK );
+    LoRaMacConfirmQueueHandleCb( &MlmeConfirm );
+    CHECK( NbConfirms == 1 );
+    CHECK( LoRaMacConfirmQueueGetCnt( ) == 2 );
+    CHECK( LoRaMacConfirmQueueIsCmdActive( MLME_LINK_CHECK ) == true );
+
+    // Then the next one
+    LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_RX2_TIMEOUT, MLME_LINK_CHECK );
+    CHECK( LoRaMacConfirmQueueGetStatus( MLME_LINK_CHECK ) == LORAMAC_EVENT_INFO_STATUS_RX2_TIMEOUT );
+    LoRaMacConfirmQueueHandleCb( &MlmeConfirm );
+    CHECK( NbConfirms == 2 );
+    CHECK( ( Confirms[1] == MLME_LINK_CHECK ) && ( ConfirmStatus[1] == LORAMAC_EVENT_INFO_STATUS_RX2_TIMEOUT ) );
+    CHECK( LoRaMacConfirmQueueIsCmdActive( MLME_LINK_CHECK ) == false );
+    CHECK( LoRaMacConfirmQueueIsCmdActive( MLME_JOIN ) == true );
+
+    // Removing the newest of two keeps the oldest addressed
+    CHECK( Add( MLME_JOIN, false ) == true );
+    CHECK( LoRaMacConfirmQueueRemoveLast( ) == true );
+    CHECK( LoRaMacConfirmQueueIsCmdActive( MLME_JOIN ) == true );
+    CHECK( LoRaMacConfirmQueueRemoveFirst( ) == true );
+    CHECK( LoRaMacConfirmQueueIsCmdActive( MLME_JOIN ) == false );
+    CHECK( LoRaMacConfirmQueueGetCnt( ) == 0 );
+    return true;
+}
+
+static const ConfirmQTestCase_t Cases[] =
+{
+    { "empty queue", Empty },
+    { "full queue", Full },
+    { "wrap around", WrapAround },
+    { "in order confirms", InOrder },
+    { "common status", CommonStatus },
+    { "request added from a confirm", AddFromConfirm },
+    { "several requests of a type", SameType },
+};
+
+int main( int argc, char **argv )
+{
+    int status = 0;
+
+    for( uint32_t i = 0; i < sizeof( Cases ) / sizeof( Cases[0] ); i++ )
+    {
+        bool passed = Cases[i].Run( );
+
+        printf( "%-40s %s\n", Cases[i].Name, ( passed == true ) ? "ok" : "FAILED" );
+        if( passed == false )
+        {
+            status = 1;
+        }
+    }
+    return status;
+}
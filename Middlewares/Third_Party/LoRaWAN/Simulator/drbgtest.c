@@ -0,0 +1,453 @@
+/*!
+ * \file      drbgtest.c
+ *
+ * \brief     Host test of the AES-CTR DRBG and of randr
+ *
+ * \details   Runs drbg.c, lorawan_aes.c and the random functions of
+ *            utilities.c on the host.
+ *
+ *            The generator is checked against the SP 800-90A CTR_DRBG with
+ *            AES-128 and no derivation function: the first vector of the
+ *            NIST CAVP no reseed set, then a reseed and the sequence of
+ *            srand1( 42 ), computed with the SP 800-90A update function over
+ *            OpenSSL AES. The reseed cases check the entropy pool folding,
+ *            the reseed interval and that a reseed drops the cached output.
+ *
+ *            The output of DrbgRandom32 passes the SP 800-22 frequency and
+ *            runs tests, randr stays in its range and passes a chi-square
+ *            test, the tests rejecting biased sources.
+ *
+ *            Usage: drbgtest
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "utilities.h"
+#include "drbg.h"
+
+#define CHECK( cond )                                                         \
+    do                                                                        \
+    {                                                                         \
+        if( !( cond ) )                                                       \
+        {                                                                     \
+            printf( "FAIL %s line %d: %s\n", __func__, __LINE__, #cond );     \
+            return false;                                                     \
+        }                                                                     \
+    }while( 0 )
+
+typedef struct DrbgTestCase_s
+{
+    const char *Name;
+    bool ( *Run )( void );
+}DrbgTestCase_t;
+
+/*!
+ * Significance level of the statistical tests
+ */
+#define DRBGTEST_ALPHA                              0.001
+
+/*!
+ * 32 bits words of the frequency and runs tests
+ */
+#define DRBGTEST_WORDS                              ( 1 << 16 )
+
+/*!
+ * Draws of the chi-square tests
+ */
+#define DRBGTEST_DRAWS                              ( 1 << 20 )
+
+/*!
+ * NIST CAVP CTR_DRBG, AES-128 no df, no reseed, no personalization or
+ * additional input, COUNT = 0: the bits returned by the second generate
+ */
+static const uint8_t CavpEntropy[DRBG_SEED_SIZE] =
+{
+    0xCE, 0x50, 0xF3, 0x3D, 0xA5, 0xD4, 0xC1, 0xD3, 0xD4, 0x00, 0x4E, 0xB3, 0x52, 0x44, 0xB7, 0xF2,
+    0xCD, 0x7F, 0x2E, 0x50, 0x76, 0xFB, 0xF6, 0x78, 0x0A, 0x7F, 0xF6, 0x34, 0xB2, 0x49, 0xA5, 0xFC,
+};
+
+static const uint8_t CavpReturnedBits[64] =
+{
+    0x65, 0x45, 0xC0, 0x52, 0x9D, 0x37, 0x24, 0x43, 0xB3, 0x92, 0xCE, 0xB3, 0xAE, 0x3A, 0x99, 0xA3,
+    0x0F, 0x96, 0x3E, 0xAF, 0x31, 0x32, 0x80, 0xF1, 0xD1, 0xA1, 0xE8, 0x7F, 0x9D, 0xB3, 0x73, 0xD3,
+    0x61, 0xE7, 0x5D, 0x18, 0x01, 0x82, 0x66, 0x49, 0x9C, 0xCC, 0xD6, 0x4D, 0x9B, 0xBB, 0x8D, 0xE0,
+    0x18, 0x5F, 0x21, 0x33, 0x83, 0x08, 0x0F, 0xAD, 0xDE, 0xC4, 0x6B, 0xAE, 0x1F, 0x78, 0x4E, 0x5A,
+};
+
+/*!
+ * Seed 00..1F, 64 bytes generated, reseed with 80..9F, 64 bytes generated
+ */
+static const uint8_t ReseedBefore[64] =
+{
+    0x16, 0x86, 0xFF, 0xCF, 0x9F, 0x35, 0x8B, 0xE7, 0x44, 0x52, 0xE6, 0x47, 0xBA, 0x15, 0x6A, 0xAB,
+    0x05, 0x13, 0x57, 0x97, 0x11, 0x7F, 0xD1, 0xAB, 0x31, 0x7D, 0x31, 0x8C, 0x66, 0x0E, 0x3D, 0x18,
+    0x14, 0x81, 0x0C, 0x15, 0xD8, 0x5D, 0xA5, 0x66, 0x5C, 0x25, 0x18, 0xB4, 0x55, 0x3F, 0xB1, 0x55,
+    0xB8, 0x54, 0x42, 0xC7, 0x90, 0x0E, 0x7D, 0x82, 0x7A, 0x11, 0xC6, 0x0D, 0x18, 0xF4, 0x24, 0xE5,
+};
+
+static const uint8_t ReseedAfter[64] =
+{
+    0xF8, 0x08, 0x62, 0x4F, 0x17, 0x7C, 0x40, 0xCD, 0x8A, 0x44, 0xDD, 0xFA, 0x94, 0xE3, 0xB9, 0xA3,
+    0x2D, 0xC1, 0x39, 0xC2, 0xA1, 0xD2, 0xF5, 0xC9, 0xBB, 0x69, 0xBC, 0xB7, 0x8A, 0xF5, 0x1B, 0x99,
+    0x6E, 0x07, 0x0C, 0x08, 0xD5, 0x67, 0xD8, 0x1C, 0x58, 0x7E, 0xB3, 0xBD, 0x84, 0x5F, 0x6D, 0x47,
+    0x2A, 0x0B, 0xEC, 0xE2, 0x18, 0x57, 0xE8, 0x80, 0xDD, 0x64, 0x19, 0x84, 0xDA, 0xD3, 0x41, 0x69,
+};
+
+/*!
+ * First words of DrbgRandom32 after srand1( 42 ), two generated blocks
+ */
+static const uint32_t Srand42[8] =
+{
+    0x0381AC9E, 0x215E974A, 0x4C397915, 0x3E6C67D5, 0xFC8ECE35, 0x9E24D032, 0xCFDA000A, 0xCC44E8CA,
+};
+
+static uint32_t Rng = 1;
+
+static uint32_t Random( void )
+{
+    Rng ^= Rng << 13;
+    Rng ^= Rng >> 17;
+    Rng ^= Rng << 5;
+    return Rng;
+}
+
+/*!
+ * Biased sources the statistical tests shall reject
+ */
+static uint32_t StuckBit( void )
+{
+    return Random( ) | 0x00000001;
+}
+
+static uint32_t Alternating( void )
+{
+    return 0x55555555;
+}
+
+static int32_t NeverMax( int32_t min, int32_t max )
+{
+    return min + ( int32_t )( Random( ) % ( uint32_t )( max - min ) );
+}
+
+/*!
+ * \brief SP 800-22 frequency (monobit) test
+ *
+ * \retval                      P-value
+ */
+static double Monobit( uint32_t ( *source )( void ), uint32_t words )
+{
+    int64_t sum = 0;
+    double n = 32.0 * words;
+
+    for( uint32_t i = 0; i < words; i++ )
+    {
+        sum += 2 * __builtin_popcount( source( ) ) - 32;
+    }
+    return erfc( fabs( ( double )sum ) / sqrt( n ) / sqrt( 2.0 ) );
+}
+
+/*!
+ * \brief SP 800-22 runs test, the bits of each word are taken from bit 0
+ *
+ * \retval                      P-value, 0 when the frequency prerequisite
+ *                              fails
+ */
+static double Runs( uint32_t ( *source )( void ), uint32_t words )
+{
+    double n = 32.0 * words;
+    uint64_t ones = 0;
+    uint64_t runs = 1;
+    int last = -1;
+    double pi;
+
+    for( uint32_t i = 0; i < words; i++ )
+    {
+        uint32_t word = source( );
+
+        ones += __builtin_popcount( word );
+        for( uint8_t b = 0; b < 32; b++ )
+        {
+            int bit = ( word >> b ) & 1;
+
+            if( ( last >= 0 ) && ( bit != last ) )
+            {
+                runs++;
+            }
+            last = bit;
+        }
+    }
+    pi = ones / n;
+    if( fabs( pi - 0.5 ) >= ( 2.0 / sqrt( n ) ) )
+    {
+        return 0.0;
+    }
+    return erfc( fabs( runs - 2.0 * n * pi * ( 1.0 - pi ) ) / ( 2.0 * sqrt( 2.0 * n ) * pi * ( 1.0 - pi ) ) );
+}
+
+/*!
+ * \brief Chi-square statistic of draws in min..max, which shall all be in
+ *        the range
+ *
+ * \retval                      Statistic, -1 when a draw is out of range
+ */
+static double ChiSquare( int32_t ( *draw )( int32_t min, int32_t max ), int32_t min, int32_t max, uint32_t draws )
+{
+    static uint32_t bins[256];
+    uint32_t count = ( uint32_t )( max - min + 1 );
+    double expected = ( double )draws / count;
+    double chi = 0.0;
+
+    memset( bins, 0, sizeof( bins ) );
+    for( uint32_t i = 0; i < draws; i++ )
+    {
+        int32_t value = draw( min, max );
+
+        if( ( value < min ) || ( value > max ) )
+        {
+            return -1.0;
+        }
+        bins[value - min]++;
+    }
+    for( uint32_t i = 0; i < count; i++ )
+    {
+        chi += ( bins[i] - expected ) * ( bins[i] - expected ) / expected;
+    }
+    return chi;
+}
+
+/*!
+ * The NIST CAVP vector
+ */
+static bool Cavp( void )
+{
+    uint8_t returned[sizeof( CavpReturnedBits )];
+
+    DrbgSeed( CavpEntropy, sizeof( CavpEntropy ) );
+    DrbgGenerate( returned, sizeof( returned ) );
+    DrbgGenerate( returned, sizeof( returned ) );
+    CHECK( memcmp( returned, CavpReturnedBits, sizeof( returned ) ) == 0 );
+
+    // The state is updated once per request, whatever its size
+    DrbgSeed( CavpEntropy, sizeof( CavpEntropy ) );
+    DrbgGenerate( returned, sizeof( returned ) );
+    DrbgGenerate( returned, 16 );
+    CHECK( memcmp( returned, CavpReturnedBits, 16 ) == 0 );
+    DrbgGenerate( returned, 16 );
+    CHECK( memcmp( returned, CavpReturnedBits + 16, 16 ) != 0 );
+    return true;
+}
+
+/*!
+ * srand1 sequence, DrbgRandom32 takes four words from each block
+ */
+static bool Srand( void )
+{
+    srand1( 42 );
+    for( uint8_t i = 0; i < 8; i++ )
+    {
+        CHECK( DrbgRandom32( ) == Srand42[i] );
+    }
+    srand1( 42 );
+    CHECK( DrbgRandom32( ) == Srand42[0] );
+    // randr reduces the same words
+    srand1( 42 );
+    CHECK( randr( 0, 999 ) == ( int32_t )( Srand42[0] % 1000 ) );
+    CHECK( randr( -8, 7 ) == ( int32_t )( Srand42[1] % 16 ) - 8 );
+    srand1( 43 );
+    CHECK( DrbgRandom32( ) != Srand42[0] );
+    return true;
+}
+
+/*!
+ * Reseed from the entropy pool
+ */
+static bool Reseed( void )
+{
+    uint8_t seed[DRBG_SEED_SIZE];
+    uint8_t entropy[DRBG_SEED_SIZE];
+    uint8_t output[64];
+    uint32_t words[4];
+
+    for( uint8_t i = 0; i < DRBG_SEED_SIZE; i++ )
+    {
+        seed[i] = i;
+        entropy[i] = 0x80 + i;
+    }
+
+    DrbgSeed( seed, sizeof( seed ) );
+    DrbgGenerate( output, sizeof( output ) );
+    CHECK( memcmp( output, ReseedBefore, sizeof( output ) ) == 0 );
+    DrbgAddEntropy( entropy, sizeof( entropy ) );
+    DrbgReseed( );
+    DrbgGenerate( output, sizeof( output ) );
+    CHECK( memcmp( output, ReseedAfter, sizeof( output ) ) == 0 );
+
+    // Entropy beyond the pool size is folded into it
+    DrbgSeed( seed, sizeof( seed ) );
+    DrbgGenerate( output, sizeof( output ) );
+    DrbgAddEntropy( entropy, 8 );
+    DrbgAddEntropy( NULL, 8 );
+    DrbgAddEntropy( entropy + 8, sizeof( entropy ) - 8 );
+    DrbgAddEntropy( seed, sizeof( seed ) );
+    DrbgAddEntropy( seed, sizeof( seed ) );
+    DrbgReseed( );
+    DrbgGenerate( output, sizeof( output ) );
+    CHECK( memcmp( output, ReseedAfter, sizeof( output ) ) == 0 );
+
+    // Seeding empties the pool, a reseed then only mixes zeros
+    DrbgAddEntropy( entropy, sizeof( entropy ) );
+    DrbgSeed( seed, sizeof( seed ) );
+    DrbgGenerate( output, sizeof( output ) );
+    DrbgReseed( );
+    DrbgGenerate( output, sizeof( output ) );
+    CHECK( memcmp( output, ReseedAfter, sizeof( output ) ) != 0 );
+
+    // A reseed drops the words left in the cache
+    srand1( 42 );
+    CHECK( DrbgRandom32( ) == Srand42[0] );
+    DrbgReseed( );
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        words[i] = DrbgRandom32( );
+        CHECK( words[i] != Srand42[1 + i] );
+    }
+
+    // Seeds longer than the seed size are folded
+    memcpy( output, seed, sizeof( seed ) );
+    memset( output + sizeof( seed ), 0, sizeof( seed ) );
+    DrbgSeed( output, sizeof( output ) );
+    DrbgGenerate( output, sizeof( output ) );
+    CHECK( memcmp( output, ReseedBefore, sizeof( output ) ) == 0 );
+    return true;
+}
+
+/*!
+ * A reseed is required once DRBG_RESEED_INTERVAL requests were served
+ */
+static bool ReseedInterval( void )
+{
+    uint8_t block[16];
+
+    srand1( 1 );
+    CHECK( DrbgIsReseedRequired( ) == false );
+    for( uint32_t i = 0; i < DRBG_RESEED_INTERVAL - 1; i++ )
+    {
+        DrbgGenerate( block, sizeof( block ) );
+    }
+    CHECK( DrbgIsReseedRequired( ) == false );
+    DrbgGenerate( block, sizeof( block ) );
+    CHECK( DrbgIsReseedRequired( ) == true );
+    // Saturated, the generator keeps serving
+    DrbgGenerate( block, sizeof( block ) );
+    CHECK( DrbgIsReseedRequired( ) == true );
+    DrbgReseed( );
+    CHECK( DrbgIsReseedRequired( ) == false );
+
+    // DrbgRandom32 requests a block every four words
+    srand1( 1 );
+    for( uint32_t i = 0; i < 4 * DRBG_RESEED_INTERVAL; i++ )
+    {
+        DrbgRandom32( );
+    }
+    CHECK( DrbgIsReseedRequired( ) == true );
+    srand1( 1 );
+    CHECK( DrbgIsReseedRequired( ) == false );
+    return true;
+}
+
+/*!
+ * SP 800-22 frequency and runs tests over several seeds
+ */
+static bool BitStatistics( void )
+{
+    for( uint32_t seed = 1; seed <= 4; seed++ )
+    {
+        double monobit;
+        double runs;
+
+        srand1( seed );
+        monobit = Monobit( DrbgRandom32, DRBGTEST_WORDS );
+        runs = Runs( DrbgRandom32, DRBGTEST_WORDS );
+        printf( "    seed %u: monobit p %.3f, runs p %.3f\n", ( unsigned )seed, monobit, runs );
+        CHECK( monobit >= DRBGTEST_ALPHA );
+        CHECK( runs >= DRBGTEST_ALPHA );
+    }
+
+    // The tests reject biased sources
+    Rng = 1;
+    CHECK( Monobit( StuckBit, DRBGTEST_WORDS ) < DRBGTEST_ALPHA );
+    CHECK( Monobit( Alternating, DRBGTEST_WORDS ) >= DRBGTEST_ALPHA );
+    CHECK( Runs( Alternating, DRBGTEST_WORDS ) < DRBGTEST_ALPHA );
+    return true;
+}
+
+/*!
+ * randr range and chi-square tests, against the critical values at
+ * DRBGTEST_ALPHA
+ */
+static bool RandrStatistics( void )
+{
+    static const struct
+    {
+        int32_t Min;
+        int32_t Max;
+        double Critical;
+    }Ranges[] =
+    {
+        { 0, 1, 10.828 },
+        { -3, 3, 22.458 },
+        { 0, 15, 37.697 },
+        { 1, 100, 148.230 },
+        { 0, 255, 330.520 },
+    };
+
+    srand1( 7 );
+    for( uint8_t i = 0; i < 8; i++ )
+    {
+        CHECK( randr( 5, 5 ) == 5 );
+        CHECK( randr( -1, -1 ) == -1 );
+    }
+    for( uint8_t r = 0; r < sizeof( Ranges ) / sizeof( Ranges[0] ); r++ )
+    {
+        double chi = ChiSquare( randr, Ranges[r].Min, Ranges[r].Max, DRBGTEST_DRAWS );
+
+        printf( "    randr( %d, %d ): chi-square %.1f, critical %.1f\n", ( int )Ranges[r].Min,
+                ( int )Ranges[r].Max, chi, Ranges[r].Critical );
+        CHECK( chi >= 0.0 );
+        CHECK( chi < Ranges[r].Critical );
+    }
+
+    // The test rejects a draw missing a value
+    Rng = 1;
+    CHECK( ChiSquare( NeverMax, 0, 15, DRBGTEST_DRAWS ) >= 37.697 );
+    return true;
+}
+
+static const DrbgTestCase_t Cases[] =
+{
+    { "NIST CAVP vector", Cavp },
+    { "srand1 sequence", Srand },
+    { "reseed", Reseed },
+    { "reseed interval", ReseedInterval },
+    { "frequency and runs", BitStatistics },
+    { "randr chi-square", RandrStatistics },
+};
+
+int main( void )
+{
+    int status = 0;
+
+    for( uint32_t n = 0; n < sizeof( Cases ) / sizeof( Cases[0] ); n++ )
+    {
+        bool passed = Cases[n].Run( );
+
+        printf( "%-40s %s\n", Cases[n].Name, ( passed == true ) ? "ok" : "FAILED" );
+        if( passed == false )
+        {
+            status = 1;
+        }
+    }
+    return status;
+}
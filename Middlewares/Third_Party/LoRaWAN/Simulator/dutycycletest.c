@@ -0,0 +1,201 @@
+/*!
+ * \file      dutycycletest.c
+ *
+ * \brief     Host test of the band duty cycle credits
+ *
+ * \details   Runs the band time credits of RegionCommon.c on the host with a
+ *            simulated clock. Each case plays the part of ScheduleTx: a band
+ *            which is ready is used for an uplink, else the clock advances
+ *            by the time to wait returned, as the TxDelayedTimer does. A band
+ *            which is not ready with a time to wait of 0 never gets its
+ *            delayed uplink and the case fails.
+ *
+ *            Usage: dutycycletest
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "radio.h"
+#include "RegionCommon.h"
+#include "systime.h"
+#include "timer.h"
+
+/*!
+ * Number of uplinks of each case, more than the band credits cover at once
+ */
+#define DUTYCYCLETEST_NB_UPLINKS                    1000
+
+#define CHECK( cond )                                                         \
+    do                                                                        \
+    {                                                                         \
+        if( !( cond ) )                                                       \
+        {                                                                     \
+            printf( "FAIL %s line %d: %s\n", __func__, __LINE__, #cond );     \
+            return false;                                                     \
+        }                                                                     \
+    }while( 0 )
+
+typedef struct DutyCycleTestCase_s
+{
+    const char *Name;
+    bool ( *Run )( void );
+}DutyCycleTestCase_t;
+
+/*!
+ * Simulated clock [ms]
+ */
+static TimerTime_t Now;
+
+const struct Radio_s Radio;
+
+static void HostSysTimeBackup( uint32_t value )
+{
+}
+
+static uint32_t HostSysTimeRestore( void )
+{
+    return 0;
+}
+
+static uint32_t HostSysTimeGetCalendarTime( uint16_t *subSeconds )
+{
+    *subSeconds = ( uint16_t )( Now % 1000 );
+    return Now / 1000;
+}
+
+const UTIL_SYSTIM_Driver_s UTIL_SYSTIMDriver =
+{
+    HostSysTimeBackup,
+    HostSysTimeRestore,
+    HostSysTimeBackup,
+    HostSysTimeRestore,
+    HostSysTimeGetCalendarTime,
+};
+
+UTIL_TIMER_Time_t UTIL_TIMER_GetCurrentTime( void )
+{
+    return Now;
+}
+
+UTIL_TIMER_Time_t UTIL_TIMER_GetElapsedTime( UTIL_TIMER_Time_t past )
+{
+    return Now - past;
+}
+
+static void Reset( Band_t *band, uint16_t dCycle )
+{
+    memset( band, 0, sizeof( Band_t ) );
+    band->DCycle = dCycle;
+    // The region assigns the maximum credits on the first update
+    Now = 1000;
+}
+
+/*!
+ * Sends DUTYCYCLETEST_NB_UPLINKS uplinks of timeOnAir on a single band,
+ * waiting for the credits in between, and checks they take the time the duty
+ * cycle allows
+ */
+static bool SendUplinks( uint16_t dCycle, TimerTime_t timeOnAir, TimerTime_t spacing )
+{
+    Band_t band;
+    uint32_t nbUplinks = 0;
+    uint32_t nbWaits = 0;
+    TimerTime_t start;
+
+    Reset( &band, dCycle );
+    start = Now;
+    while( nbUplinks < DUTYCYCLETEST_NB_UPLINKS )
+    {
+        SysTime_t sinceStartup = SysTimeFromMs( Now );
+        TimerTime_t timeToWait = RegionCommonUpdateBandTimeOff( true, &band, 1, true, false,
+                                                                sinceStartup, timeOnAir );
+
+        if( band.ReadyForTransmission == true )
+        {
+            RegionCommonSetBandTxDone( &band, timeOnAir, true, sinceStartup );
+            nbUplinks++;
+            Now += timeOnAir + spacing;
+        }
+        else
+        {
+            // ScheduleTx arms no TxDelayedTimer for a time to wait of 0
+            CHECK( timeToWait != 0 );
+            CHECK( timeToWait != TIMERTIME_T_MAX );
+            Now += timeToWait;
+            nbWaits++;
+        }
+        CHECK( nbWaits <= DUTYCYCLETEST_NB_UPLINKS );
+    }
+
+    // Once the initial credits are spent, each uplink waits for its own costs
+    CHECK( nbWaits > 0 );
+    CHECK( ( Now - start ) >= ( ( DUTYCYCLETEST_NB_UPLINKS * timeOnAir * dCycle ) - band.MaxTimeCredits ) );
+    return true;
+}
+
+static bool BackToBack( void )
+{
+    // 1 % band, SF12 uplinks sent as soon as the band allows
+    return SendUplinks( 100, 1483, 0 );
+}
+
+static bool ShortUplinks( void )
+{
+    // 0.1 % band, SF7 uplinks
+    return SendUplinks( 1000, 62, 0 );
+}
+
+static bool SpacedUplinks( void )
+{
+    // 1 % band, uplinks spaced by less than their costs
+    return SendUplinks( 100, 400, 10000 );
+}
+
+static bool ExactCredits( void )
+{
+    Band_t band;
+    TimerTime_t timeOnAir = 100;
+    TimerTime_t costs = timeOnAir * 100;
+    TimerTime_t timeToWait;
+
+    // The band is ready exactly when its credits cover the costs
+    for( TimerTime_t credits = costs - 2; credits <= costs + 2; credits++ )
+    {
+        Reset( &band, 100 );
+        RegionCommonUpdateBandTimeOff( true, &band, 1, true, false, SysTimeFromMs( Now ), timeOnAir );
+        band.TimeCredits = credits;
+        timeToWait = RegionCommonUpdateBandTimeOff( true, &band, 1, true, false, SysTimeFromMs( Now ), timeOnAir );
+        CHECK( band.ReadyForTransmission == ( credits >= costs ) );
+        if( band.ReadyForTransmission == false )
+        {
+            CHECK( timeToWait == ( costs - credits ) );
+        }
+    }
+    return true;
+}
+
+static const DutyCycleTestCase_t Cases[] =
+{
+    { "credits equal to the costs", ExactCredits },
+    { "back to back uplinks", BackToBack },
+    { "short uplinks", ShortUplinks },
+    { "spaced uplinks", SpacedUplinks },
+};
+
+int main( int argc, char **argv )
+{
+    int status = 0;
+
+    for( uint32_t i = 0; i < sizeof( Cases ) / sizeof( Cases[0] ); i++ )
+    {
+        bool passed = Cases[i].Run( );
+
+        printf( "%-40s %s\n", Cases[i].Name, ( passed == true ) ? "ok" : "FAILED" );
+        if( passed == false )
+        {
+            status = 1;
+        }
+    }
+    return status;
+}
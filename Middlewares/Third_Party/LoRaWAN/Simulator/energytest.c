@@ -0,0 +1,438 @@
+/*!
+ * \file      energytest.c
+ *
+ * \brief     Host test of the energy ledger
+ *
+ * \details   Runs LoRaMacEnergy.c on the host against a simulated radio and
+ *            MCU. The simulated radio reports its power state changes through
+ *            the PowerStateChanged radio event, as the radio driver does, and
+ *            the simulated MCU its low power modes, as the low power driver
+ *            of the end node does. The test scripts Class A uplinks, Class B
+ *            and Class C receptions and application processing, integrates
+ *            the expected charge of each activity on its side and compares it
+ *            with the ledger.
+ *
+ *            Usage: energytest
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LoRaMacEnergy.h"
+#include "timer.h"
+
+#define CHECK( cond )                                                         \
+    do                                                                        \
+    {                                                                         \
+        if( !( cond ) )                                                       \
+        {                                                                     \
+            printf( "FAIL %s line %d: %s\n", __func__, __LINE__, #cond );     \
+            return false;                                                     \
+        }                                                                     \
+    }while( 0 )
+
+typedef struct EnergyTestCase_s
+{
+    const char *Name;
+    bool ( *Run )( void );
+}EnergyTestCase_t;
+
+/* Currents of the simulated device [uA] */
+#define ENERGYTEST_RADIO_STANDBY                    1000
+#define ENERGYTEST_RADIO_RX                         6000
+#define ENERGYTEST_TX( power )                      ( 20000 + 1000 * ( power ) )
+#define ENERGYTEST_MCU_RUN                          3600
+#define ENERGYTEST_MCU_SLEEP                        1800
+#define ENERGYTEST_MCU_STOP                         36
+
+/* Simulated clock, read by the ledger through TimerGetCurrentTime */
+static UTIL_TIMER_Time_t Now;
+
+UTIL_TIMER_Time_t UTIL_TIMER_GetCurrentTime( void )
+{
+    return Now;
+}
+
+/* Simulated radio, registered as the MAC does */
+static RadioEvents_t SimRadioEvents;
+static RadioPowerState_t SimRadioState;
+static int8_t SimTxPower;
+static LoRaMacEnergyMcuMode_t SimMcuMode;
+
+/* Expected charges [uA.ms] and the activities they go to */
+static LoRaMacEnergyActivity_t RadioActivity;
+static LoRaMacEnergyActivity_t McuActivity;
+static uint64_t Expected[LORAMAC_ENERGY_ACTIVITIES];
+static uint64_t ExpectedUplink;
+static bool UplinkOpen;
+
+static uint32_t SimRadioCurrent( void )
+{
+    switch( SimRadioState )
+    {
+        case RADIO_POWER_TX:
+            return ENERGYTEST_TX( SimTxPower < 0 ? 0 : ( SimTxPower > 22 ? 22 : SimTxPower ) );
+        case RADIO_POWER_RX:
+            return ENERGYTEST_RADIO_RX;
+        case RADIO_POWER_STANDBY:
+            return ENERGYTEST_RADIO_STANDBY;
+        default:
+            return 0;
+    }
+}
+
+static uint32_t SimMcuCurrent( void )
+{
+    static const uint32_t currents[LORAMAC_ENERGY_MCU_MODES] =
+    {
+        ENERGYTEST_MCU_RUN, ENERGYTEST_MCU_SLEEP, ENERGYTEST_MCU_STOP, 0
+    };
+
+    return currents[SimMcuMode];
+}
+
+/*!
+ * Lets the time run in the current states
+ */
+static void Advance( uint32_t ms )
+{
+    uint64_t radio = ( uint64_t )SimRadioCurrent( ) * ms;
+    uint64_t mcu = ( uint64_t )SimMcuCurrent( ) * ms;
+
+    Expected[RadioActivity] += radio;
+    Expected[McuActivity] += mcu;
+    if( UplinkOpen == true )
+    {
+        ExpectedUplink += ( RadioActivity == LORAMAC_ENERGY_UPLINK ) ? radio : 0;
+        ExpectedUplink += ( McuActivity == LORAMAC_ENERGY_UPLINK ) ? mcu : 0;
+    }
+    Now += ms;
+}
+
+static void SimRadioSetState( RadioPowerState_t state, int8_t power )
+{
+    if( ( state != SimRadioState ) && ( SimRadioEvents.PowerStateChanged != NULL ) )
+    {
+        SimRadioEvents.PowerStateChanged( state, power );
+    }
+    SimRadioState = state;
+    SimTxPower = power;
+}
+
+static void SimMcuSetMode( LoRaMacEnergyMcuMode_t mode )
+{
+    LoRaMacEnergyMcuMode( mode );
+    SimMcuMode = mode;
+}
+
+/*!
+ * Wakes up for an RX window or a transmission, 1 ms in standby, then sleeps
+ */
+static void SimRadioOperation( RadioPowerState_t state, int8_t power, uint32_t duration )
+{
+    SimRadioSetState( RADIO_POWER_STANDBY, power );
+    Advance( 1 );
+    SimRadioSetState( state, power );
+    Advance( duration );
+    SimRadioSetState( RADIO_POWER_SLEEP, power );
+}
+
+/*!
+ * Stays in stop mode
+ */
+static void SimStop( uint32_t ms )
+{
+    SimMcuSetMode( LORAMAC_ENERGY_MCU_STOP );
+    Advance( ms );
+    SimMcuSetMode( LORAMAC_ENERGY_MCU_RUN );
+}
+
+/*!
+ * Class A transmission and its two RX windows, the uplink is opened or
+ * retransmitted as SendFrameOnChannel does
+ */
+static void SimClassATransmission( int8_t power, uint32_t timeOnAir, uint32_t rxWindow )
+{
+    LoRaMacEnergyUplinkStart( );
+    if( UplinkOpen == false )
+    {
+        ExpectedUplink = 0;
+        UplinkOpen = true;
+    }
+    RadioActivity = LORAMAC_ENERGY_UPLINK;
+    McuActivity = LORAMAC_ENERGY_UPLINK;
+
+    SimRadioOperation( RADIO_POWER_TX, power, timeOnAir );
+    SimStop( 1000 - 1 );
+    SimRadioOperation( RADIO_POWER_RX, power, rxWindow );
+    SimStop( 1000 - 1 - rxWindow );
+    SimRadioOperation( RADIO_POWER_RX, power, rxWindow );
+}
+
+static void SimUplinkEnd( void )
+{
+    LoRaMacEnergyUplinkEnd( );
+    UplinkOpen = false;
+    RadioActivity = LORAMAC_ENERGY_IDLE;
+    McuActivity = LORAMAC_ENERGY_IDLE;
+}
+
+static void Reset( void )
+{
+    LoRaMacEnergyTable_t table = { 0 };
+
+    Now = 1000;
+    memset( Expected, 0, sizeof( Expected ) );
+    ExpectedUplink = 0;
+    UplinkOpen = false;
+    RadioActivity = LORAMAC_ENERGY_IDLE;
+    McuActivity = LORAMAC_ENERGY_IDLE;
+    SimRadioState = RADIO_POWER_SLEEP;
+    SimTxPower = 0;
+    SimMcuMode = LORAMAC_ENERGY_MCU_RUN;
+
+    memset( &SimRadioEvents, 0, sizeof( SimRadioEvents ) );
+    SimRadioEvents.PowerStateChanged = LoRaMacEnergyRadioState;
+
+    LoRaMacEnergyInit( );
+    table.RadioStandby = ENERGYTEST_RADIO_STANDBY;
+    table.RadioRx = ENERGYTEST_RADIO_RX;
+    for( int8_t power = LORAMAC_ENERGY_TX_POWER_MIN; power <= LORAMAC_ENERGY_TX_POWER_MAX; power++ )
+    {
+        table.RadioTx[power - LORAMAC_ENERGY_TX_POWER_MIN] = ENERGYTEST_TX( power );
+    }
+    table.Mcu[LORAMAC_ENERGY_MCU_RUN] = ENERGYTEST_MCU_RUN;
+    table.Mcu[LORAMAC_ENERGY_MCU_SLEEP] = ENERGYTEST_MCU_SLEEP;
+    table.Mcu[LORAMAC_ENERGY_MCU_STOP] = ENERGYTEST_MCU_STOP;
+    LoRaMacEnergySetTable( &table );
+}
+
+/*!
+ * Compares the ledger with the charges integrated by the test
+ */
+static bool CheckTotals( void )
+{
+    LoRaMacEnergyTotals_t totals;
+    uint32_t radioTime = 0;
+    uint32_t mcuTime = 0;
+
+    LoRaMacEnergyGetTotals( &totals );
+    for( uint8_t i = 0; i < LORAMAC_ENERGY_ACTIVITIES; i++ )
+    {
+        if( totals.Charge[i] != Expected[i] / 3600 )
+        {
+            printf( "%s: %llu nAh, expected %llu nAh\n", LoRaMacEnergyGetActivityName( i ),
+                    ( unsigned long long )totals.Charge[i], ( unsigned long long )( Expected[i] / 3600 ) );
+            return false;
+        }
+    }
+    for( uint8_t i = 0; i < LORAMAC_ENERGY_RADIO_STATES; i++ )
+    {
+        radioTime += totals.RadioTime[i];
+    }
+    for( uint8_t i = 0; i < LORAMAC_ENERGY_MCU_MODES; i++ )
+    {
+        mcuTime += totals.McuTime[i];
+    }
+    CHECK( ( radioTime == totals.Time ) && ( mcuTime == totals.Time ) );
+    CHECK( totals.Time == Now - 1000 );
+    return true;
+}
+
+static bool ClassAUplink( void )
+{
+    LoRaMacEnergyUplink_t uplink;
+    uint32_t start;
+
+    Reset( );
+    CHECK( LoRaMacEnergyGetLastUplink( &uplink ) == false );
+
+    // Sleep between the uplinks goes to idle
+    SimStop( 100000 );
+
+    start = Now;
+    SimClassATransmission( 14, 100, 20 );
+    SimUplinkEnd( );
+    CHECK( LoRaMacEnergyGetLastUplink( &uplink ) == true );
+    CHECK( uplink.Duration == Now - start );
+    CHECK( ( uplink.TxTime == 100 ) && ( uplink.RxTime == 40 ) );
+    CHECK( uplink.Transmissions == 1 );
+    CHECK( uplink.Charge == ExpectedUplink / 3600 );
+    // TX at 34 mA for 100 ms dominates
+    CHECK( uplink.Charge > ( ENERGYTEST_TX( 14 ) / 36 ) );
+
+    SimStop( 100000 );
+    CHECK( CheckTotals( ) == true );
+    return true;
+}
+
+static bool Retransmissions( void )
+{
+    LoRaMacEnergyUplink_t uplink;
+    LoRaMacEnergyTotals_t totals;
+
+    Reset( );
+    // A confirmed uplink sent three times is one uplink
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        SimClassATransmission( 14, 100, 20 );
+        SimStop( 2000 );
+    }
+    SimUplinkEnd( );
+    CHECK( LoRaMacEnergyGetLastUplink( &uplink ) == true );
+    CHECK( uplink.Transmissions == 3 );
+    CHECK( ( uplink.TxTime == 300 ) && ( uplink.RxTime == 120 ) );
+    CHECK( uplink.Charge == ExpectedUplink / 3600 );
+
+    // Closing again changes nothing
+    LoRaMacEnergyUplinkEnd( );
+    LoRaMacEnergyGetTotals( &totals );
+    CHECK( totals.Uplinks == 1 );
+    CHECK( CheckTotals( ) == true );
+    return true;
+}
+
+static bool ClassBWindows( void )
+{
+    LoRaMacEnergyUplink_t uplink;
+
+    Reset( );
+    SimStop( 5000 );
+
+    // The beacon setup puts the radio to sleep then configures it in standby,
+    // only the reception goes to the beacon, the MCU to idle
+    LoRaMacEnergyRadioActivity( LORAMAC_ENERGY_BEACON );
+    SimRadioSetState( RADIO_POWER_SLEEP, 0 );
+    SimRadioSetState( RADIO_POWER_STANDBY, 0 );
+    Advance( 2 );
+    SimRadioSetState( RADIO_POWER_RX, 0 );
+    RadioActivity = LORAMAC_ENERGY_BEACON;
+    Advance( 150 );
+    SimRadioSetState( RADIO_POWER_SLEEP, 0 );
+    RadioActivity = LORAMAC_ENERGY_IDLE;
+    SimStop( 5000 );
+
+    // A ping slot inside an uplink takes the radio, the uplink the MCU
+    LoRaMacEnergyUplinkStart( );
+    UplinkOpen = true;
+    RadioActivity = LORAMAC_ENERGY_UPLINK;
+    McuActivity = LORAMAC_ENERGY_UPLINK;
+    SimRadioOperation( RADIO_POWER_TX, 14, 100 );
+    SimStop( 500 );
+    LoRaMacEnergyRadioActivity( LORAMAC_ENERGY_PING_SLOT );
+    SimRadioSetState( RADIO_POWER_RX, 0 );
+    RadioActivity = LORAMAC_ENERGY_PING_SLOT;
+    Advance( 30 );
+    SimRadioSetState( RADIO_POWER_SLEEP, 0 );
+    RadioActivity = LORAMAC_ENERGY_UPLINK;
+    SimStop( 469 );
+    SimRadioOperation( RADIO_POWER_RX, 14, 20 );
+    SimUplinkEnd( );
+
+    CHECK( LoRaMacEnergyGetLastUplink( &uplink ) == true );
+    CHECK( ( uplink.TxTime == 100 ) && ( uplink.RxTime == 20 ) );
+    CHECK( uplink.Charge == ExpectedUplink / 3600 );
+    CHECK( CheckTotals( ) == true );
+    return true;
+}
+
+static bool ClassCReception( void )
+{
+    LoRaMacEnergyTotals_t totals;
+
+    Reset( );
+
+    // Continuous reception, then an uplink which stops it for its windows
+    LoRaMacEnergyRadioActivity( LORAMAC_ENERGY_CLASS_C );
+    SimRadioSetState( RADIO_POWER_RX, 0 );
+    RadioActivity = LORAMAC_ENERGY_CLASS_C;
+    SimMcuSetMode( LORAMAC_ENERGY_MCU_SLEEP );
+    Advance( 60000 );
+    SimMcuSetMode( LORAMAC_ENERGY_MCU_RUN );
+
+    SimClassATransmission( 14, 100, 20 );
+    SimUplinkEnd( );
+
+    // RXC is opened again after the uplink
+    LoRaMacEnergyRadioActivity( LORAMAC_ENERGY_CLASS_C );
+    SimRadioSetState( RADIO_POWER_RX, 0 );
+    RadioActivity = LORAMAC_ENERGY_CLASS_C;
+    Advance( 60000 );
+
+    LoRaMacEnergyGetTotals( &totals );
+    CHECK( totals.RadioTime[RADIO_POWER_RX] == 120040 );
+    CHECK( totals.Charge[LORAMAC_ENERGY_CLASS_C] == ( uint64_t )ENERGYTEST_RADIO_RX * 120000 / 3600 );
+    CHECK( CheckTotals( ) == true );
+    return true;
+}
+
+static bool ApplicationActivity( void )
+{
+    Reset( );
+    SimStop( 1000 );
+
+    // A sensor poll, as ModbusPoll_Process does
+    CHECK( LoRaMacEnergySetActivity( LORAMAC_ENERGY_APPLICATION ) == LORAMAC_ENERGY_IDLE );
+    RadioActivity = LORAMAC_ENERGY_APPLICATION;
+    McuActivity = LORAMAC_ENERGY_APPLICATION;
+    Advance( 250 );
+    CHECK( LoRaMacEnergySetActivity( LORAMAC_ENERGY_IDLE ) == LORAMAC_ENERGY_APPLICATION );
+    RadioActivity = LORAMAC_ENERGY_IDLE;
+    McuActivity = LORAMAC_ENERGY_IDLE;
+    SimStop( 1000 );
+
+    CHECK( Expected[LORAMAC_ENERGY_APPLICATION] == ( uint64_t )ENERGYTEST_MCU_RUN * 250 );
+    CHECK( CheckTotals( ) == true );
+    return true;
+}
+
+static bool TxPowerRange( void )
+{
+    LoRaMacEnergyUplink_t uplink;
+
+    Reset( );
+
+    // Powers outside the table are charged at its ends
+    SimClassATransmission( 30, 100, 20 );
+    SimUplinkEnd( );
+    SimClassATransmission( -9, 100, 20 );
+    SimUplinkEnd( );
+    CHECK( LoRaMacEnergyGetLastUplink( &uplink ) == true );
+    CHECK( uplink.Charge == ExpectedUplink / 3600 );
+    CHECK( CheckTotals( ) == true );
+
+    // Unknown states and modes are ignored
+    LoRaMacEnergyRadioState( ( RadioPowerState_t )LORAMAC_ENERGY_RADIO_STATES, 0 );
+    LoRaMacEnergyMcuMode( LORAMAC_ENERGY_MCU_MODES );
+    LoRaMacEnergyRadioActivity( LORAMAC_ENERGY_ACTIVITIES );
+    Advance( 1000 );
+    CHECK( CheckTotals( ) == true );
+    return true;
+}
+
+static const EnergyTestCase_t Cases[] =
+{
+    { "class A uplink", ClassAUplink },
+    { "retransmissions", Retransmissions },
+    { "class B beacon and ping slot", ClassBWindows },
+    { "class C reception", ClassCReception },
+    { "application activity", ApplicationActivity },
+    { "tx power range", TxPowerRange },
+};
+
+int main( int argc, char **argv )
+{
+    int status = 0;
+
+    for( uint32_t i = 0; i < sizeof( Cases ) / sizeof( Cases[0] ); i++ )
+    {
+        bool passed = Cases[i].Run( );
+
+        printf( "%-40s %s\n", Cases[i].Name, ( passed == true ) ? "ok" : "FAILED" );
+        if( passed == false )
+        {
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,454 @@
+/*!
+ * \file      fragbench.c
+ *
+ * \brief     Host measurement of the FragDecoder processing slices
+ *
+ * \details   Runs FragDecoder.c on the host with the largest configuration
+ *            of frag_decoder_if_template.h: 716 fragments of 120 bytes and
+ *            72 redundancy fragments. Every session loses the given number
+ *            of uncoded fragments at random and receives coded fragments
+ *            until the file is rebuilt, the worst case being as many lost
+ *            fragments as FRAG_MAX_REDUNDANCY.
+ *
+ *            Each session is decoded twice: one FragDecoderProcess call per
+ *            fragment, as before the slicing, then FragDecoderPush bursts
+ *            of FRAG_DECODER_QUEUE_SIZE fragments drained by FragDecoderStep
+ *            slices. Every decoding is repeated and each call keeps its
+ *            fastest time, the host preemptions are not counted. The worst
+ *            call and the worst slice are reported in us.
+ *
+ *            A session losing more fragments than FRAG_MAX_REDUNDANCY runs
+ *            first: it shall fail, and leave nothing to the next sessions.
+ *
+ *            The benchmark fails when a session is not rebuilt, when both
+ *            decodings disagree or when a slice does more row reads and
+ *            writes than its budget.
+ *
+ *            Usage: fragbench [-n sessions] [-l lost] [-b budget] [-r repeat]
+ *                             [-s seed]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "FragDecoder.h"
+
+#define FRAGBENCH_FRAG_NB                           FRAG_MAX_NB
+#define FRAGBENCH_FRAG_SIZE                         FRAG_MAX_SIZE
+#define FRAGBENCH_DEFAULT_SESSIONS                  5
+#define FRAGBENCH_DEFAULT_REPEAT                    5
+#define FRAGBENCH_MAX_CODED                         ( 4 * FRAG_MAX_REDUNDANCY )
+
+typedef struct FragBenchResult_s
+{
+    int32_t Status;
+    uint16_t Sent;
+    /*!
+     * Fastest time of every call over the repetitions
+     */
+    uint64_t *Ns;
+    uint32_t NsSize;
+    uint32_t Calls;
+    uint32_t WorstRows;
+}FragBenchResult_t;
+
+static uint8_t File[FRAGBENCH_FRAG_NB * FRAGBENCH_FRAG_SIZE];
+static uint8_t Image[FRAGBENCH_FRAG_NB * FRAGBENCH_FRAG_SIZE];
+static bool Lost[FRAGBENCH_FRAG_NB];
+static uint32_t Rows;
+static uint32_t Rng;
+
+uint8_t LmhpFragmentationGetPackageVersion( void )
+{
+    return 2;
+}
+
+static uint32_t RngNext( void )
+{
+    Rng ^= Rng << 13;
+    Rng ^= Rng >> 17;
+    Rng ^= Rng << 5;
+    return Rng;
+}
+
+static uint64_t NowNs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( uint64_t )ts.tv_sec * 1000000000ULL + ( uint64_t )ts.tv_nsec;
+}
+
+/*
+ *=============================================================================
+ * File storage, every access is one row operation of the decoder
+ *=============================================================================
+ */
+
+static int32_t BenchErase( void )
+{
+    memset( Image, 0xFF, sizeof( Image ) );
+    return 0;
+}
+
+static int32_t BenchWrite( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    Rows++;
+    memcpy( &Image[addr], data, size );
+    return 0;
+}
+
+static int32_t BenchRead( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    Rows++;
+    memcpy( data, &Image[addr], size );
+    return 0;
+}
+
+static FragDecoderCallbacks_t BenchCallbacks =
+{
+    .FragDecoderErase = BenchErase,
+    .FragDecoderWrite = BenchWrite,
+    .FragDecoderRead = BenchRead,
+};
+
+/*
+ *=============================================================================
+ * Encoder
+ *=============================================================================
+ */
+
+static bool IsPowerOfTwo( uint32_t x )
+{
+    return ( x != 0 ) && ( ( x & ( x - 1 ) ) == 0 );
+}
+
+/*!
+ * Encoder side of the parity matrix of FragDecoder.c (LoRa Alliance
+ * fragmented data block transport, PRBS23 driven rows)
+ */
+static void ParityRow( int32_t n, int32_t m, uint8_t *matrixRow )
+{
+    int32_t mTemp = ( IsPowerOfTwo( ( uint32_t )m ) == true ) ? 1 : 0;
+    int32_t x = 1 + ( 1001 * n );
+    int32_t nbCoeff = 0;
+    int32_t r;
+
+    memset( matrixRow, 0, ( size_t )( m >> 3 ) + 1 );
+    while( nbCoeff < ( m >> 1 ) )
+    {
+        r = 1 << 16;
+        while( r >= m )
+        {
+            x = ( x >> 1 ) + ( ( ( x & 0x01 ) ^ ( ( x & 0x20 ) >> 5 ) ) << 22 );
+            r = x % ( m + mTemp );
+        }
+        if( ( matrixRow[r >> 3] & ( 0x80 >> ( r % 8 ) ) ) == 0 )
+        {
+            matrixRow[r >> 3] |= ( uint8_t )( 0x80 >> ( r % 8 ) );
+            nbCoeff++;
+        }
+    }
+}
+
+static void Encode( uint16_t counter, uint8_t *fragment )
+{
+    uint8_t matrixRow[( FRAGBENCH_FRAG_NB >> 3 ) + 1];
+
+    if( counter <= FRAGBENCH_FRAG_NB )
+    {
+        memcpy( fragment, &File[( counter - 1 ) * FRAGBENCH_FRAG_SIZE], FRAGBENCH_FRAG_SIZE );
+        return;
+    }
+    memset( fragment, 0, FRAGBENCH_FRAG_SIZE );
+    ParityRow( counter - FRAGBENCH_FRAG_NB, FRAGBENCH_FRAG_NB, matrixRow );
+    for( uint16_t i = 0; i < FRAGBENCH_FRAG_NB; i++ )
+    {
+        if( ( matrixRow[i >> 3] & ( 0x80 >> ( i % 8 ) ) ) != 0 )
+        {
+            for( uint16_t j = 0; j < FRAGBENCH_FRAG_SIZE; j++ )
+            {
+                fragment[j] ^= File[i * FRAGBENCH_FRAG_SIZE + j];
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Gets the next fragment of the session that is not lost
+ *
+ * \retval counter Fragment counter, 0 at the end of the session
+ */
+static uint16_t NextCounter( uint16_t counter )
+{
+    do
+    {
+        counter++;
+    } while( ( counter <= FRAGBENCH_FRAG_NB ) && ( Lost[counter - 1] == true ) );
+    return ( counter <= ( FRAGBENCH_FRAG_NB + FRAGBENCH_MAX_CODED ) ) ? counter : 0;
+}
+
+/*
+ *=============================================================================
+ * Decodings
+ *=============================================================================
+ */
+
+static void Start( FragBenchResult_t *result )
+{
+    result->Status = FRAG_SESSION_ONGOING;
+    result->Calls = 0;
+    result->WorstRows = 0;
+}
+
+static void Measure( FragBenchResult_t *result, uint64_t start, uint32_t repeat )
+{
+    uint64_t ns = NowNs( ) - start;
+
+    if( result->Calls >= result->NsSize )
+    {
+        result->NsSize = ( result->NsSize == 0 ) ? 1024 : ( 2 * result->NsSize );
+        result->Ns = realloc( result->Ns, result->NsSize * sizeof( uint64_t ) );
+    }
+    if( ( repeat == 0 ) || ( ns < result->Ns[result->Calls] ) )
+    {
+        result->Ns[result->Calls] = ns;
+    }
+    if( Rows > result->WorstRows )
+    {
+        result->WorstRows = Rows;
+    }
+    result->Calls++;
+}
+
+static void RunProcess( FragBenchResult_t *result, uint32_t repeat )
+{
+    uint8_t fragment[FRAGBENCH_FRAG_SIZE];
+    uint16_t counter = 0;
+
+    Start( result );
+    FragDecoderInit( FRAGBENCH_FRAG_NB, FRAGBENCH_FRAG_SIZE, &BenchCallbacks );
+    while( ( result->Status == FRAG_SESSION_ONGOING ) && ( ( counter = NextCounter( counter ) ) != 0 ) )
+    {
+        uint64_t start;
+
+        Encode( counter, fragment );
+        Rows = 0;
+        start = NowNs( );
+        result->Status = FragDecoderProcess( counter, fragment );
+        Measure( result, start, repeat );
+    }
+    result->Sent = FragDecoderGetStatus( ).FragNbRx;
+}
+
+static void RunSliced( FragBenchResult_t *result, uint32_t budget, uint32_t repeat )
+{
+    uint8_t fragment[FRAGBENCH_FRAG_SIZE];
+    uint16_t counter = 0;
+
+    Start( result );
+    FragDecoderInit( FRAGBENCH_FRAG_NB, FRAGBENCH_FRAG_SIZE, &BenchCallbacks );
+    while( result->Status == FRAG_SESSION_ONGOING )
+    {
+        // A burst fills the queue, as if the slices were delayed
+        for( uint8_t i = 0; i < FRAG_DECODER_QUEUE_SIZE; i++ )
+        {
+            if( ( counter = NextCounter( counter ) ) == 0 )
+            {
+                break;
+            }
+            Encode( counter, fragment );
+            if( FragDecoderPush( counter, fragment ) == false )
+            {
+                printf( "FAIL fragment %u not queued\n", counter );
+                result->Status = FRAG_SESSION_NOT_STARTED;
+                return;
+            }
+        }
+        if( FragDecoderIsBusy( ) == false )
+        {
+            break;
+        }
+        while( FragDecoderIsBusy( ) == true )
+        {
+            uint64_t start;
+
+            Rows = 0;
+            start = NowNs( );
+            result->Status = FragDecoderStep( budget );
+            Measure( result, start, repeat );
+        }
+    }
+    // The fragments queued after the last useful one are discarded
+    result->Sent = FragDecoderGetStatus( ).FragNbRx;
+}
+
+static void Accumulate( FragBenchResult_t *result, uint64_t *worst, uint64_t *total, uint32_t *calls )
+{
+    for( uint32_t i = 0; i < result->Calls; i++ )
+    {
+        *worst = ( result->Ns[i] > *worst ) ? result->Ns[i] : *worst;
+        *total += result->Ns[i];
+    }
+    *calls += result->Calls;
+}
+
+/*!
+ * \brief Draws a new file and the uncoded fragments lost in the session
+ */
+static void NewSession( uint32_t lost )
+{
+    for( uint32_t i = 0; i < sizeof( File ); i++ )
+    {
+        File[i] = ( uint8_t )RngNext( );
+    }
+    memset( Lost, 0, sizeof( Lost ) );
+    for( uint32_t i = 0; i < lost; )
+    {
+        uint32_t index = RngNext( ) % FRAGBENCH_FRAG_NB;
+
+        if( Lost[index] == false )
+        {
+            Lost[index] = true;
+            i++;
+        }
+    }
+}
+
+/*!
+ * \brief Runs a session losing one fragment more than the redundancy, the
+ *        decoder shall report the matrix error
+ */
+static bool RunFailed( void )
+{
+    FragBenchResult_t result = { 0 };
+    FragDecoderStatus_t status;
+
+    NewSession( FRAG_MAX_REDUNDANCY + 1 );
+    RunProcess( &result, 0 );
+    free( result.Ns );
+    status = FragDecoderGetStatus( );
+    if( ( result.Status != FRAG_SESSION_FINISHED ) || ( status.MatrixError == 0 ) )
+    {
+        printf( "FAIL failed session: status %d, matrix error %u\n", result.Status, status.MatrixError );
+        return false;
+    }
+    return true;
+}
+
+static bool Check( const char *name, FragBenchResult_t *result )
+{
+    if( ( result->Status < FRAG_SESSION_FINISHED ) || ( FragDecoderGetStatus( ).MatrixError != 0 ) )
+    {
+        printf( "FAIL %s: session not finished, status %d\n", name, result->Status );
+        return false;
+    }
+    if( memcmp( Image, File, sizeof( File ) ) != 0 )
+    {
+        printf( "FAIL %s: file not rebuilt\n", name );
+        return false;
+    }
+    return true;
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t sessions = FRAGBENCH_DEFAULT_SESSIONS;
+    uint32_t lost = FRAG_MAX_REDUNDANCY;
+    uint32_t budget = FRAG_DECODER_SLICE_BUDGET;
+    uint32_t repeat = FRAGBENCH_DEFAULT_REPEAT;
+    uint32_t failed = 0;
+    bool reset;
+    FragBenchResult_t process = { 0 };
+    FragBenchResult_t sliced = { 0 };
+    uint64_t processWorst = 0;
+    uint64_t processTotal = 0;
+    uint32_t processCalls = 0;
+    uint64_t slicedWorst = 0;
+    uint64_t slicedTotal = 0;
+    uint32_t slices = 0;
+    uint32_t worstRows = 0;
+    int opt;
+
+    Rng = 1;
+    while( ( opt = getopt( argc, argv, "n:l:b:r:s:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+            case 'n': sessions = ( uint32_t )strtoul( optarg, NULL, 0 ); break;
+            case 'l': lost = ( uint32_t )strtoul( optarg, NULL, 0 ); break;
+            case 'b': budget = ( uint32_t )strtoul( optarg, NULL, 0 ); break;
+            case 'r': repeat = ( uint32_t )strtoul( optarg, NULL, 0 ); break;
+            case 's': Rng = ( uint32_t )strtoul( optarg, NULL, 0 ); break;
+            default:
+                fprintf( stderr, "usage: fragbench [-n sessions] [-l lost] [-b budget] [-r repeat] [-s seed]\n" );
+                return 2;
+        }
+    }
+    if( ( lost > FRAG_MAX_REDUNDANCY ) || ( budget == 0 ) || ( repeat == 0 ) || ( Rng == 0 ) )
+    {
+        fprintf( stderr, "fragbench: lost <= %u, budget, repeat and seed > 0 expected\n", FRAG_MAX_REDUNDANCY );
+        return 2;
+    }
+
+    reset = RunFailed( );
+    for( uint32_t session = 0; session < sessions; session++ )
+    {
+        bool passed = true;
+
+        NewSession( lost );
+
+        for( uint32_t r = 0; ( r < repeat ) && ( passed == true ); r++ )
+        {
+            RunProcess( &process, r );
+            passed = Check( "process", &process );
+        }
+        for( uint32_t r = 0; ( r < repeat ) && ( passed == true ); r++ )
+        {
+            RunSliced( &sliced, budget, r );
+            passed = Check( "sliced", &sliced );
+        }
+        if( passed == false )
+        {
+            failed++;
+            continue;
+        }
+        if( ( sliced.Status != process.Status ) || ( sliced.Sent != process.Sent ) )
+        {
+            printf( "FAIL session %u: sliced status %d after %u fragments, expected %d after %u\n", session,
+                    sliced.Status, sliced.Sent, process.Status, process.Sent );
+            failed++;
+            continue;
+        }
+        if( sliced.WorstRows > budget )
+        {
+            printf( "FAIL session %u: %u row operations in a slice, budget %u\n", session, sliced.WorstRows, budget );
+            failed++;
+        }
+
+        Accumulate( &process, &processWorst, &processTotal, &processCalls );
+        Accumulate( &sliced, &slicedWorst, &slicedTotal, &slices );
+        worstRows = ( sliced.WorstRows > worstRows ) ? sliced.WorstRows : worstRows;
+    }
+    free( process.Ns );
+    free( sliced.Ns );
+
+    printf( "configuration    : %u fragments of %u bytes, %u lost, redundancy up to %u, queue %u\n",
+            FRAGBENCH_FRAG_NB, FRAGBENCH_FRAG_SIZE, lost, FRAG_MAX_REDUNDANCY, FRAG_DECODER_QUEUE_SIZE );
+    if( processCalls > 0 )
+    {
+        printf( "process          : worst %.1f us per fragment, %.1f ms per session\n", ( double )processWorst / 1000.0,
+                ( double )processTotal / 1e6 / sessions );
+    }
+    if( slices > 0 )
+    {
+        printf( "sliced           : worst %.1f us per slice of %u row operations (%u used), %.1f ms per session, %u slices\n",
+                ( double )slicedWorst / 1000.0, budget, worstRows, ( double )slicedTotal / 1e6 / sessions,
+                slices / sessions );
+    }
+    printf( "%u/%u sessions passed\n", sessions - failed, sessions );
+    return ( ( failed == 0 ) && ( reset == true ) ) ? 0 : 1;
+}
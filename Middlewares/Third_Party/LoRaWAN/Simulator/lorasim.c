@@ -0,0 +1,1991 @@
+/*!
+ * \file      lorasim.c
+ *
+ * \brief     Discrete-event multi-node LoRaWAN network simulator
+ *
+ * \details   Runs a population of class A end-devices around a single
+ *            gateway / network server on the host, faster than real time.
+ *
+ *            Every device runs the real MAC layer: LoRaMac.c with its
+ *            commands, confirm queue, crypto, secure element, ADR and
+ *            region modules. Uplink / RX1 / RX2 / retransmission
+ *            sequencing, duty-cycle scheduling, ADR back-off and MAC
+ *            command handling are the ones the firmware executes, the
+ *            frames on air are real encrypted LoRaWAN frames.
+ *
+ *            The MAC modules keep their state in static variables. The
+ *            Makefile moves the .data and .bss sections of their objects to
+ *            the lorasim_mac section: every device owns a copy of that
+ *            section, which is swapped in before its stack runs.
+ *
+ *            The timer server and the radio driver are simulated: a timer
+ *            started by the MAC is an event of the queue, Radio.Send puts
+ *            the frame on the channel model, Radio.Rx receives the downlink
+ *            the network server scheduled when its preamble starts within
+ *            the window. Above the MAC, the application plays the role of
+ *            LmHandlerSend, link quality policy included.
+ *
+ *            Channel model:
+ *            - log-distance path loss, per device shadowing and per packet
+ *              fading
+ *            - per SF demodulation floors, same-SF capture above 6 dB when
+ *              the strongest frame starts within the preamble lock window
+ *              of the other one, 16 dB inter-SF rejection
+ *            - 8 gateway demodulators, half-duplex gateway, gateway duty
+ *              cycle on downlinks
+ *
+ *            The network server parses the uplinks, runs the Semtech ADR
+ *            algorithm and answers with LinkADRReq, LinkCheckAns and ACKs
+ *            in RX1, or in RX2 as a fall-back.
+ *
+ *            The MAC task processes the TX done event after a random
+ *            latency of up to -j ms, as LoRaMacProcess does on the device
+ *            once the interrupt notified it. The simulation fails when the
+ *            RX1 window of a datarate does not always open at the same time
+ *            after the end of the uplink.
+ *
+ *            Usage: lorasim [-n nodes] [-t hours] [-r radius m] [-p period s]
+ *                           [-l payload] [-s seed] [-a adr 0|1]
+ *                           [-c confirmed 0|1] [-d initial datarate]
+ *                           [-q link quality policy 0|1]
+ *                           [-x path loss exponent]
+ *                           [-g shadowing dB] [-f fuota fragments]
+ *                           [-k fuota redundancy] [-j process latency ms] [-v]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "utilities.h"
+#include "systime.h"
+#include "radio.h"
+#include "LoRaMac.h"
+#include "Region.h"
+#include "RegionEU868.h"
+#include "LoRaMacLinkQuality.h"
+#include "FragDecoder.h"
+#include "frag_decoder_if.h"
+#include "lorawan_aes.h"
+#include "cmac.h"
+
+/*!
+ * Simulation limits
+ */
+#define SIM_MAX_NODES                               2000
+#define SIM_MAX_EVENTS                              ( 16 * SIM_MAX_NODES + 64 )
+#define SIM_MAX_HOURS                               1000
+
+/*!
+ * LoRaWAN parameters of the devices and of the network server (LoRaWAN 1.0.3)
+ */
+#define SIM_LORAMAC_VERSION                         0x01000300
+#define SIM_DEV_ADDR                                0x01000000
+#define SIM_FPORT                                   2
+#define SIM_RECEIVE_DELAY1                          1000
+#define SIM_RECEIVE_DELAY2                          2000
+#define SIM_CONFIRMED_NB_TRIALS                     8
+#define SIM_DL_FRAME_SIZE                           12
+#define SIM_LINK_ADR_REQ_SIZE                       5
+#define SIM_LINK_CHECK_ANS_SIZE                     3
+#define SIM_MAX_FRAME_SIZE                          255
+
+/*!
+ * Radio and channel model
+ */
+#define SIM_PREAMBLE_LEN                            8
+#define SIM_CAPTURE_THRESHOLD                       6.0
+#define SIM_INTER_SF_REJECTION                      16.0
+#define SIM_NOISE_FIGURE                            6.0
+#define SIM_PL_REF_DISTANCE                         1000.0
+#define SIM_PL_REF_LOSS                             128.95
+#define SIM_FADING_SIGMA                            2.0
+#define SIM_GW_DEMODULATORS                         8
+#define SIM_GW_RX1_POWER                            14
+#define SIM_GW_RX2_POWER                            27
+
+/*!
+ * Network server ADR, Semtech recommended algorithm
+ */
+#define SIM_NS_ADR_HISTORY                          20
+#define SIM_NS_ADR_MARGIN                           10.0
+#define SIM_NS_ADR_STEP                             3.0
+
+/*!
+ * FUOTA session, multicast on the RX2 channel
+ */
+#define SIM_FUOTA_DR                                DR_3
+#define SIM_FUOTA_FRAG_SIZE                         50
+
+/*!
+ * Energy model, STM32WL at 3.3 V
+ */
+#define SIM_SUPPLY_VOLTAGE                          3.3
+#define SIM_RX_CURRENT_MA                           5.5
+#define SIM_SLEEP_CURRENT_MA                        0.0021
+
+typedef enum eSimEventType
+{
+    SIM_EV_APP,
+    SIM_EV_TIMER,
+    SIM_EV_TX_END,
+    SIM_EV_RX_DONE,
+    SIM_EV_RX_TIMEOUT,
+    SIM_EV_PROCESS,
+    SIM_EV_GW_TX_START,
+    SIM_EV_GW_TX_END,
+}SimEventType_t;
+
+typedef struct sSimEvent
+{
+    uint64_t Time;
+    uint32_t Seq;
+    SimEventType_t Type;
+    uint16_t Node;
+    UTIL_TIMER_Object_t *Timer;
+}SimEvent_t;
+
+typedef enum eSimLoss
+{
+    SIM_LOSS_NONE,
+    SIM_LOSS_SENSITIVITY,
+    SIM_LOSS_COLLISION,
+    SIM_LOSS_NO_DEMODULATOR,
+    SIM_LOSS_GW_TX,
+    SIM_LOSS_MAX,
+}SimLoss_t;
+
+/*!
+ * Frame on air, uplink or downlink
+ */
+typedef struct sSimFrame
+{
+    uint64_t Start;
+    uint64_t End;
+    uint32_t Frequency;
+    int8_t Datarate;
+    int8_t Power;
+    double Rssi;
+    uint16_t Node;
+    bool Active;
+    SimLoss_t Loss;
+}SimFrame_t;
+
+/*!
+ * Simulated radio of a device, filled by the MAC through the Radio driver
+ */
+typedef struct sSimRadio
+{
+    RadioState_t State;
+    uint32_t Frequency;
+    int8_t Power;
+    uint32_t Bandwidth;
+    uint32_t SpreadingFactor;
+    uint16_t SymbTimeout;
+}SimRadio_t;
+
+typedef struct sSimDownlink
+{
+    bool Pending;
+    bool Rx2;
+    bool Ack;
+    bool LinkAdrReq;
+    bool LinkCheckAns;
+    uint8_t Margin;
+    int8_t Datarate;
+    uint32_t Frequency;
+    uint64_t Start;
+    uint64_t End;
+    double Rssi;
+    double Snr;
+    uint8_t Size;
+    uint8_t Buffer[SIM_DL_FRAME_SIZE + SIM_LINK_ADR_REQ_SIZE + SIM_LINK_CHECK_ANS_SIZE];
+}SimDownlink_t;
+
+typedef struct sSimNode
+{
+    double Distance;
+    double Shadowing;
+
+    /* copy of the lorasim_mac section while another device runs */
+    uint8_t *MacContext;
+
+    SimRadio_t Radio;
+    uint32_t RadioEvent;
+    uint64_t RxStart;
+    uint64_t TxEnd;
+    bool Rx1Pending;
+    uint8_t Uplink[SIM_MAX_FRAME_SIZE];
+    uint8_t UplinkSize;
+    SimFrame_t Frame;
+    SimDownlink_t Downlink;
+
+    /* application */
+    bool AppPending;
+    bool RequestSent;
+    uint64_t RequestTime;
+    uint8_t Payload[SIM_MAX_FRAME_SIZE];
+    int8_t Datarate;
+    int8_t TxPower;
+    LoRaMacLinkQuality_t LinkQuality;
+    int8_t LinkQualityAppTxPower;
+    int8_t LinkQualityTxPower;
+
+    /* network server side */
+    uint16_t NsLastFCnt;
+    bool NsFCntValid;
+    uint32_t NsFCntDown;
+    double NsSnr[SIM_NS_ADR_HISTORY];
+    uint8_t NsSnrCount;
+    uint8_t NsSnrIndex;
+    int8_t NsDatarate;
+    int8_t NsTxPower;
+
+    /* statistics */
+    uint32_t Generated;
+    uint32_t Delivered;
+    uint32_t Transmissions;
+    uint32_t Acked;
+    uint32_t Superseded;
+    uint32_t Downlinks;
+    uint32_t DownlinksLost;
+    uint32_t LinkChecks;
+    uint32_t LinkCheckAnswers;
+    uint32_t Loss[SIM_LOSS_MAX];
+    uint64_t DutyCycleWait;
+    double EnergyTx;
+    double EnergyRx;
+    uint64_t TxTime;
+    uint64_t RxTime;
+    uint32_t DrCount[DR_5 + 1];
+}SimNode_t;
+
+typedef struct sSimConfig
+{
+    uint32_t Nodes;
+    double Hours;
+    double Radius;
+    double Period;
+    uint8_t Payload;
+    uint32_t Seed;
+    bool Adr;
+    bool Confirmed;
+    int8_t Datarate;
+    bool LinkQuality;
+    double PathLossExponent;
+    double ShadowingSigma;
+    uint16_t FuotaFragments;
+    uint16_t FuotaRedundancy;
+    uint32_t ProcessLatency;
+    bool Verbose;
+}SimConfig_t;
+
+static SimConfig_t Config =
+{
+    .Nodes = 100,
+    .Hours = 24.0,
+    .Radius = 3000.0,
+    .Period = 600.0,
+    .Payload = 20,
+    .Seed = 1,
+    .Adr = true,
+    .Confirmed = false,
+    .Datarate = DR_0,
+    .LinkQuality = false,
+    .PathLossExponent = 3.52,
+    .ShadowingSigma = 6.0,
+    .FuotaFragments = 0,
+    .FuotaRedundancy = 0,
+    .ProcessLatency = 20,
+    .Verbose = false,
+};
+
+static SimNode_t *Nodes;
+
+/*!
+ * Device whose MAC context is in the lorasim_mac section
+ */
+static SimNode_t *ActiveNode;
+
+static SimEvent_t Events[SIM_MAX_EVENTS];
+static uint32_t EventCount;
+static uint32_t EventSeq = 1;
+static uint64_t SimTime;
+
+static SimFrame_t *OnAir[SIM_MAX_NODES];
+static uint32_t OnAirCount;
+
+static uint8_t GatewayDemodulators;
+static bool GatewayTxActive;
+static uint64_t GatewayBandFree[2];
+static uint32_t GatewayDownlinks;
+static uint32_t GatewayDownlinksBlocked;
+
+/*!
+ * Earliest and latest opening of the RX1 window after the end of the
+ * uplink, per datarate of the uplink [ms]
+ */
+static uint64_t Rx1OpenMin[DR_5 + 1];
+static uint64_t Rx1OpenMax[DR_5 + 1];
+static uint32_t Rx1OpenCount[DR_5 + 1];
+
+/*!
+ * Radio events of LoRaMac.c, the structure is in the lorasim_mac section
+ * so the pointer is the same for every device
+ */
+static RadioEvents_t *RadioEvents;
+
+/*!
+ * Static state of the MAC modules, gathered in the lorasim_mac section by
+ * the Makefile, and its value before the first device starts
+ */
+extern uint8_t __start_lorasim_mac[];
+extern uint8_t __stop_lorasim_mac[];
+static uint8_t *MacContextDefaults;
+static size_t MacContextSize;
+
+/*!
+ * Session keys of se-identity.h, used by the network server side
+ */
+static const uint8_t SessionKey[16] =
+{
+    0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C
+};
+
+static const uint8_t DatarateToSf[] = { 12, 11, 10, 9, 8, 7 };
+static const double SnrFloor[] = { -20.0, -17.5, -15.0, -12.5, -10.0, -7.5 };
+
+/*!
+ * Size of the uplink MAC commands after their CID, LoRaWAN 1.0.3,
+ * -1 for the ones a class A device does not send
+ */
+static const int8_t UplinkCommandSize[] = { -1, -1, 0, 1, 0, 1, 2, 1, 0, 0, 1, -1, -1, 0 };
+
+/*!
+ * xorshift64* generator, the simulator does not use the host libc random
+ * so that a seed reproduces a run on every platform
+ */
+static uint64_t RngState;
+
+static void RngSeed( uint32_t seed )
+{
+    RngState = ( ( uint64_t )seed << 32 ) ^ 0x9E3779B97F4A7C15ULL;
+    if( RngState == 0 )
+    {
+        RngState = 1;
+    }
+}
+
+static uint64_t RngNext( void )
+{
+    RngState ^= RngState >> 12;
+    RngState ^= RngState << 25;
+    RngState ^= RngState >> 27;
+    return RngState * 0x2545F4914F6CDD1DULL;
+}
+
+static double RngUniform( void )
+{
+    return ( double )( RngNext( ) >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+static double RngGaussian( double sigma )
+{
+    double u1 = RngUniform( );
+    double u2 = RngUniform( );
+
+    if( u1 < 1e-300 )
+    {
+        u1 = 1e-300;
+    }
+    return sigma * sqrt( -2.0 * log( u1 ) ) * cos( 2.0 * M_PI * u2 );
+}
+
+static uint16_t NodeId( const SimNode_t *node )
+{
+    return ( uint16_t )( node - Nodes );
+}
+
+/*
+ *=============================================================================
+ * Event queue, binary heap ordered by time then insertion order
+ *=============================================================================
+ */
+
+static bool EventBefore( const SimEvent_t *a, const SimEvent_t *b )
+{
+    return ( a->Time < b->Time ) || ( ( a->Time == b->Time ) && ( a->Seq < b->Seq ) );
+}
+
+/*!
+ * \brief Queues an event, returns its sequence number
+ */
+static uint32_t EventPush( uint64_t time, SimEventType_t type, uint16_t node, UTIL_TIMER_Object_t *timer )
+{
+    uint32_t i = EventCount++;
+    uint32_t seq = EventSeq++;
+
+    if( EventCount > SIM_MAX_EVENTS )
+    {
+        fprintf( stderr, "lorasim: event queue overflow\n" );
+        exit( EXIT_FAILURE );
+    }
+    Events[i] = ( SimEvent_t ){ .Time = time, .Seq = seq, .Type = type, .Node = node, .Timer = timer };
+    while( i > 0 )
+    {
+        uint32_t parent = ( i - 1 ) / 2;
+        if( EventBefore( &Events[parent], &Events[i] ) == true )
+        {
+            break;
+        }
+        SimEvent_t tmp = Events[parent];
+        Events[parent] = Events[i];
+        Events[i] = tmp;
+        i = parent;
+    }
+    return seq;
+}
+
+static SimEvent_t EventPop( void )
+{
+    SimEvent_t top = Events[0];
+    uint32_t i = 0;
+
+    Events[0] = Events[--EventCount];
+    for( ;; )
+    {
+        uint32_t left = 2 * i + 1;
+        uint32_t smallest = i;
+
+        if( ( left < EventCount ) && ( EventBefore( &Events[left], &Events[smallest] ) == true ) )
+        {
+            smallest = left;
+        }
+        if( ( ( left + 1 ) < EventCount ) && ( EventBefore( &Events[left + 1], &Events[smallest] ) == true ) )
+        {
+            smallest = left + 1;
+        }
+        if( smallest == i )
+        {
+            break;
+        }
+        SimEvent_t tmp = Events[smallest];
+        Events[smallest] = Events[i];
+        Events[i] = tmp;
+        i = smallest;
+    }
+    return top;
+}
+
+/*
+ *=============================================================================
+ * MAC context of the active device
+ *=============================================================================
+ */
+
+/*!
+ * \brief Swaps the MAC context of the device in the lorasim_mac section, the
+ *        context of the previous device is saved when another one runs
+ */
+static void NodeEnter( SimNode_t *node )
+{
+    if( ActiveNode == node )
+    {
+        return;
+    }
+    if( ActiveNode != NULL )
+    {
+        memcpy( ActiveNode->MacContext, __start_lorasim_mac, MacContextSize );
+    }
+    memcpy( __start_lorasim_mac, node->MacContext, MacContextSize );
+    ActiveNode = node;
+}
+
+/*
+ *=============================================================================
+ * Middleware platform services
+ *=============================================================================
+ */
+
+/*!
+ * Timer server of the simulation: a started timer is an event of the
+ * queue for the active device, its timestamp holds the sequence number of
+ * the event so that a timer stopped or restarted ignores the previous one
+ */
+UTIL_TIMER_Status_t UTIL_TIMER_Create( UTIL_TIMER_Object_t *TimerObject, uint32_t PeriodValue, UTIL_TIMER_Mode_t Mode,
+                                       void ( *Callback )( void * ), void *Argument )
+{
+    if( ( TimerObject == NULL ) || ( Callback == NULL ) )
+    {
+        return UTIL_TIMER_INVALID_PARAM;
+    }
+    memset( TimerObject, 0, sizeof( UTIL_TIMER_Object_t ) );
+    TimerObject->ReloadValue = PeriodValue;
+    TimerObject->Mode = Mode;
+    TimerObject->Callback = Callback;
+    TimerObject->argument = Argument;
+    return UTIL_TIMER_OK;
+}
+
+UTIL_TIMER_Status_t UTIL_TIMER_Start( UTIL_TIMER_Object_t *TimerObject )
+{
+    if( ( TimerObject == NULL ) || ( TimerObject->IsRunning != 0 ) || ( ActiveNode == NULL ) )
+    {
+        return UTIL_TIMER_INVALID_PARAM;
+    }
+    TimerObject->IsRunning = 1;
+    TimerObject->IsReloadStopped = 0;
+    TimerObject->Timestamp = EventPush( SimTime + MAX( TimerObject->ReloadValue, 1 ), SIM_EV_TIMER,
+                                        NodeId( ActiveNode ), TimerObject );
+    return UTIL_TIMER_OK;
+}
+
+UTIL_TIMER_Status_t UTIL_TIMER_Stop( UTIL_TIMER_Object_t *TimerObject )
+{
+    if( TimerObject == NULL )
+    {
+        return UTIL_TIMER_INVALID_PARAM;
+    }
+    TimerObject->IsRunning = 0;
+    TimerObject->IsReloadStopped = 1;
+    return UTIL_TIMER_OK;
+}
+
+UTIL_TIMER_Status_t UTIL_TIMER_SetPeriod( UTIL_TIMER_Object_t *TimerObject, uint32_t NewPeriodValue )
+{
+    if( TimerObject == NULL )
+    {
+        return UTIL_TIMER_INVALID_PARAM;
+    }
+    TimerObject->ReloadValue = NewPeriodValue;
+    if( TimerObject->IsRunning != 0 )
+    {
+        UTIL_TIMER_Stop( TimerObject );
+        return UTIL_TIMER_Start( TimerObject );
+    }
+    return UTIL_TIMER_OK;
+}
+
+UTIL_TIMER_Time_t UTIL_TIMER_GetCurrentTime( void )
+{
+    return ( UTIL_TIMER_Time_t )SimTime;
+}
+
+UTIL_TIMER_Time_t UTIL_TIMER_GetElapsedTime( UTIL_TIMER_Time_t past )
+{
+    return ( UTIL_TIMER_Time_t )SimTime - past;
+}
+
+static uint32_t SimSysTimeGetCalendarTime( uint16_t *subSeconds )
+{
+    *subSeconds = ( uint16_t )( SimTime % 1000 );
+    return ( uint32_t )( SimTime / 1000 );
+}
+
+static void SimSysTimeBackup( uint32_t value )
+{
+}
+
+static uint32_t SimSysTimeRestore( void )
+{
+    return 0;
+}
+
+const UTIL_SYSTIM_Driver_s UTIL_SYSTIMDriver =
+{
+    SimSysTimeBackup,
+    SimSysTimeRestore,
+    SimSysTimeBackup,
+    SimSysTimeRestore,
+    SimSysTimeGetCalendarTime,
+};
+
+uint8_t LmhpFragmentationGetPackageVersion( void )
+{
+    return 2;
+}
+
+/*
+ *=============================================================================
+ * Channel model
+ *=============================================================================
+ */
+
+static double PathLoss( const SimNode_t *node )
+{
+    return SIM_PL_REF_LOSS + 10.0 * Config.PathLossExponent * log10( node->Distance / SIM_PL_REF_DISTANCE ) +
+           node->Shadowing;
+}
+
+static double NoiseFloor( void )
+{
+    return -174.0 + 10.0 * log10( 125000.0 ) + SIM_NOISE_FIGURE;
+}
+
+static double LinkRssi( const SimNode_t *node, int8_t power )
+{
+    return ( double )power - PathLoss( node ) + RngGaussian( SIM_FADING_SIGMA );
+}
+
+static uint32_t SymbolTime( int8_t datarate )
+{
+    return ( 1U << DatarateToSf[datarate] ) * 1000U / 125U;
+}
+
+/*!
+ * \brief Returns the end of the preamble part a demodulator needs to lock
+ *        on a frame
+ */
+static uint64_t PreambleLock( uint64_t start, int8_t datarate )
+{
+    return start + ( ( uint64_t )( SIM_PREAMBLE_LEN - 5 ) * SymbolTime( datarate ) ) / 1000;
+}
+
+/*!
+ * \brief Returns true if the frame survives the interferer
+ *
+ * Same SF: the frame needs the capture threshold and must have started
+ * before the interferer preamble got locked by the demodulator.
+ * Different SF: quasi-orthogonal, only a much stronger interferer hurts.
+ */
+static bool Survives( const SimFrame_t *frame, const SimFrame_t *interferer )
+{
+    double margin = frame->Rssi - interferer->Rssi;
+
+    if( frame->Datarate != interferer->Datarate )
+    {
+        return margin >= -SIM_INTER_SF_REJECTION;
+    }
+    if( margin < SIM_CAPTURE_THRESHOLD )
+    {
+        return false;
+    }
+    return frame->Start <= PreambleLock( interferer->Start, interferer->Datarate );
+}
+
+static uint8_t GatewayBand( uint32_t frequency )
+{
+    return ( ( frequency >= 869400000 ) && ( frequency <= 869650000 ) ) ? 1 : 0;
+}
+
+static void FrameStart( SimFrame_t *frame )
+{
+    frame->Active = false;
+    frame->Loss = SIM_LOSS_NONE;
+
+    for( uint32_t i = 0; i < OnAirCount; i++ )
+    {
+        SimFrame_t *other = OnAir[i];
+
+        if( other->Frequency != frame->Frequency )
+        {
+            continue;
+        }
+        if( ( other->Loss == SIM_LOSS_NONE ) && ( Survives( other, frame ) == false ) )
+        {
+            other->Loss = SIM_LOSS_COLLISION;
+        }
+        if( ( frame->Loss == SIM_LOSS_NONE ) && ( Survives( frame, other ) == false ) )
+        {
+            frame->Loss = SIM_LOSS_COLLISION;
+        }
+    }
+    OnAir[OnAirCount++] = frame;
+
+    /* gateway demodulator path, a frame below the floor never locks one */
+    if( ( frame->Rssi - NoiseFloor( ) ) < SnrFloor[frame->Datarate] )
+    {
+        frame->Loss = SIM_LOSS_SENSITIVITY;
+    }
+    else if( GatewayTxActive == true )
+    {
+        frame->Loss = SIM_LOSS_GW_TX;
+    }
+    else if( GatewayDemodulators >= SIM_GW_DEMODULATORS )
+    {
+        frame->Loss = SIM_LOSS_NO_DEMODULATOR;
+    }
+    else
+    {
+        GatewayDemodulators++;
+        frame->Active = true;
+    }
+}
+
+static void FrameEnd( SimFrame_t *frame )
+{
+    for( uint32_t i = 0; i < OnAirCount; i++ )
+    {
+        if( OnAir[i] == frame )
+        {
+            OnAir[i] = OnAir[--OnAirCount];
+            break;
+        }
+    }
+    if( frame->Active == true )
+    {
+        GatewayDemodulators--;
+        frame->Active = false;
+    }
+}
+
+/*!
+ * \brief Starts the transmission of a downlink, the half-duplex gateway
+ *        loses the frames it is receiving
+ */
+static void GatewayTxStart( void )
+{
+    GatewayTxActive = true;
+    for( uint32_t i = 0; i < OnAirCount; i++ )
+    {
+        if( OnAir[i]->Active == true )
+        {
+            GatewayDemodulators--;
+            OnAir[i]->Active = false;
+            OnAir[i]->Loss = SIM_LOSS_GW_TX;
+        }
+    }
+}
+
+/*
+ *=============================================================================
+ * Simulated radio driver
+ *=============================================================================
+ */
+
+static void NodeEnergy( SimNode_t *node, bool tx, uint64_t duration )
+{
+    double mA;
+
+    if( tx == true )
+    {
+        mA = 20.0 + 1.8 * ( double )node->Frame.Power;
+        node->EnergyTx += mA * SIM_SUPPLY_VOLTAGE * ( double )duration / 1000.0;
+        node->TxTime += duration;
+    }
+    else
+    {
+        mA = SIM_RX_CURRENT_MA;
+        node->EnergyRx += mA * SIM_SUPPLY_VOLTAGE * ( double )duration / 1000.0;
+        node->RxTime += duration;
+    }
+}
+
+/*!
+ * \brief Datarate of the radio configuration, the devices only use the
+ *        125 kHz LoRa datarates
+ */
+static int8_t SimRadioDatarate( const SimRadio_t *radio )
+{
+    return ( int8_t )( 12 - radio->SpreadingFactor );
+}
+
+static void SimRadioInit( RadioEvents_t *events )
+{
+    RadioEvents = events;
+}
+
+static RadioState_t SimRadioGetStatus( void )
+{
+    return ActiveNode->Radio.State;
+}
+
+static void SimRadioSetChannel( uint32_t freq )
+{
+    ActiveNode->Radio.Frequency = freq;
+}
+
+static uint32_t SimRadioRandom( void )
+{
+    return ( uint32_t )RngNext( );
+}
+
+static void SimRadioSetRxConfig( RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                 uint32_t bandwidthAfc, uint16_t preambleLen, uint16_t symbTimeout, bool fixLen,
+                                 uint8_t payloadLen, bool crcOn, bool freqHopOn, uint8_t hopPeriod,
+                                 bool iqInverted, bool rxContinuous )
+{
+    ActiveNode->Radio.Bandwidth = bandwidth;
+    ActiveNode->Radio.SpreadingFactor = datarate;
+    ActiveNode->Radio.SymbTimeout = symbTimeout;
+}
+
+static void SimRadioSetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev, uint32_t bandwidth,
+                                 uint32_t datarate, uint8_t coderate, uint16_t preambleLen, bool fixLen,
+                                 bool crcOn, bool freqHopOn, uint8_t hopPeriod, bool iqInverted, uint32_t timeout )
+{
+    ActiveNode->Radio.Power = power;
+    ActiveNode->Radio.Bandwidth = bandwidth;
+    ActiveNode->Radio.SpreadingFactor = datarate;
+}
+
+static bool SimRadioCheckRfFrequency( uint32_t frequency )
+{
+    return true;
+}
+
+/*!
+ * Same computation as the SubGHz_Phy driver, LoRa only since the simulated
+ * devices never use the FSK datarate
+ */
+static uint32_t SimRadioTimeOnAir( RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                   uint16_t preambleLen, bool fixLen, uint8_t payloadLen, bool crcOn )
+{
+    int32_t crDenom = coderate + 4;
+    bool lowDatareOptimize = false;
+    int32_t ceilDenominator;
+    int32_t ceilNumerator;
+    int32_t intermediate;
+    uint32_t bandwidthHz = 125000U << bandwidth;
+
+    if( ( ( bandwidth == 0 ) && ( ( datarate == 11 ) || ( datarate == 12 ) ) ) ||
+        ( ( bandwidth == 1 ) && ( datarate == 12 ) ) )
+    {
+        lowDatareOptimize = true;
+    }
+
+    ceilNumerator = ( payloadLen << 3 ) + ( crcOn ? 16 : 0 ) - ( 4 * datarate ) + ( fixLen ? 0 : 20 ) + 8;
+    ceilDenominator = 4 * ( lowDatareOptimize ? ( datarate - 2 ) : datarate );
+    if( ceilNumerator < 0 )
+    {
+        ceilNumerator = 0;
+    }
+    intermediate = ( ( ceilNumerator + ceilDenominator - 1 ) / ceilDenominator ) * crDenom + preambleLen + 12;
+
+    return DIVC( 1000U * ( uint32_t )( ( 4 * intermediate + 1 ) * ( 1 << ( datarate - 2 ) ) ), bandwidthHz );
+}
+
+/*!
+ * \brief Puts the uplink on air, the first transmission of a request ends
+ *        the duty-cycle wait of the application
+ */
+static void SimRadioSend( uint8_t *buffer, uint8_t size )
+{
+    SimNode_t *node = ActiveNode;
+    int8_t datarate = SimRadioDatarate( &node->Radio );
+    uint32_t toa = SimRadioTimeOnAir( MODEM_LORA, node->Radio.Bandwidth, node->Radio.SpreadingFactor, 1,
+                                      SIM_PREAMBLE_LEN, false, size, true );
+
+    memcpy( node->Uplink, buffer, size );
+    node->UplinkSize = size;
+    node->Frame.Start = SimTime;
+    node->Frame.End = SimTime + toa;
+    node->Frame.Frequency = node->Radio.Frequency;
+    node->Frame.Datarate = datarate;
+    node->Frame.Power = node->Radio.Power;
+    node->Frame.Rssi = LinkRssi( node, node->Radio.Power );
+    node->Frame.Node = NodeId( node );
+    node->Transmissions++;
+    node->DrCount[datarate]++;
+    if( node->RequestSent == false )
+    {
+        node->RequestSent = true;
+        node->DutyCycleWait += SimTime - node->RequestTime;
+    }
+
+    FrameStart( &node->Frame );
+    NodeEnergy( node, true, toa );
+    node->Radio.State = RF_TX_RUNNING;
+    node->RadioEvent = EventPush( node->Frame.End, SIM_EV_TX_END, NodeId( node ), NULL );
+}
+
+/*!
+ * \brief Leaves the reception, the pending RX event of the window is
+ *        dropped
+ */
+static void SimRadioIdle( void )
+{
+    SimNode_t *node = ActiveNode;
+
+    if( node->Radio.State == RF_RX_RUNNING )
+    {
+        NodeEnergy( node, false, SimTime - node->RxStart );
+        node->RadioEvent = 0;
+        node->Radio.State = RF_IDLE;
+    }
+}
+
+/*!
+ * \brief Opens a window of the symbol timeout set by the region, the
+ *        downlink of the device is received when the window opens before
+ *        the demodulator needs its preamble and closes after it started
+ */
+static void SimRadioRx( uint32_t timeout )
+{
+    SimNode_t *node = ActiveNode;
+    SimDownlink_t *dl = &node->Downlink;
+    int8_t datarate = SimRadioDatarate( &node->Radio );
+    uint64_t window = ( ( uint64_t )node->Radio.SymbTimeout * SymbolTime( datarate ) + 999 ) / 1000;
+
+    node->Radio.State = RF_RX_RUNNING;
+    node->RxStart = SimTime;
+    if( node->Rx1Pending == true )
+    {
+        uint64_t open = SimTime - node->TxEnd;
+        int8_t txDatarate = node->Frame.Datarate;
+
+        node->Rx1Pending = false;
+        if( ( Rx1OpenCount[txDatarate] == 0 ) || ( open < Rx1OpenMin[txDatarate] ) )
+        {
+            Rx1OpenMin[txDatarate] = open;
+        }
+        if( ( Rx1OpenCount[txDatarate] == 0 ) || ( open > Rx1OpenMax[txDatarate] ) )
+        {
+            Rx1OpenMax[txDatarate] = open;
+        }
+        Rx1OpenCount[txDatarate]++;
+    }
+    if( ( dl->Pending == true ) && ( dl->Frequency == node->Radio.Frequency ) && ( dl->Datarate == datarate ) &&
+        ( PreambleLock( dl->Start, datarate ) >= SimTime ) && ( dl->Start <= ( SimTime + window ) ) )
+    {
+        int8_t power = ( dl->Rx2 == false ) ? SIM_GW_RX1_POWER : SIM_GW_RX2_POWER;
+
+        dl->Rssi = LinkRssi( node, power );
+        dl->Snr = dl->Rssi - NoiseFloor( );
+        if( dl->Snr >= SnrFloor[datarate] )
+        {
+            node->RadioEvent = EventPush( dl->End, SIM_EV_RX_DONE, NodeId( node ), NULL );
+            return;
+        }
+        node->DownlinksLost++;
+    }
+    node->RadioEvent = EventPush( SimTime + window, SIM_EV_RX_TIMEOUT, NodeId( node ), NULL );
+}
+
+static void SimRadioSetMaxPayloadLength( RadioModems_t modem, uint8_t max )
+{
+}
+
+static void SimRadioSetPublicNetwork( bool enable )
+{
+}
+
+static uint32_t SimRadioGetWakeupTime( void )
+{
+    return 3;
+}
+
+const struct Radio_s Radio =
+{
+    .Init = SimRadioInit,
+    .GetStatus = SimRadioGetStatus,
+    .SetChannel = SimRadioSetChannel,
+    .Random = SimRadioRandom,
+    .SetRxConfig = SimRadioSetRxConfig,
+    .SetTxConfig = SimRadioSetTxConfig,
+    .CheckRfFrequency = SimRadioCheckRfFrequency,
+    .TimeOnAir = SimRadioTimeOnAir,
+    .Send = SimRadioSend,
+    .Sleep = SimRadioIdle,
+    .Standby = SimRadioIdle,
+    .Rx = SimRadioRx,
+    .SetMaxPayloadLength = SimRadioSetMaxPayloadLength,
+    .SetPublicNetwork = SimRadioSetPublicNetwork,
+    .GetWakeupTime = SimRadioGetWakeupTime,
+};
+
+/*
+ *=============================================================================
+ * Network server
+ *=============================================================================
+ */
+
+static void NsAdr( SimNode_t *node, double snr )
+{
+    double maxSnr = -100.0;
+    int8_t datarate;
+    int8_t txPower;
+    int32_t nStep;
+
+    node->NsSnr[node->NsSnrIndex] = snr;
+    node->NsSnrIndex = ( node->NsSnrIndex + 1 ) % SIM_NS_ADR_HISTORY;
+    if( node->NsSnrCount < SIM_NS_ADR_HISTORY )
+    {
+        node->NsSnrCount++;
+        return;
+    }
+    for( uint8_t i = 0; i < SIM_NS_ADR_HISTORY; i++ )
+    {
+        maxSnr = MAX( maxSnr, node->NsSnr[i] );
+    }
+
+    datarate = node->Frame.Datarate;
+    txPower = node->NsTxPower;
+    nStep = ( int32_t )floor( ( maxSnr - SnrFloor[datarate] - SIM_NS_ADR_MARGIN ) / SIM_NS_ADR_STEP );
+    while( ( nStep > 0 ) && ( datarate < DR_5 ) )
+    {
+        datarate++;
+        nStep--;
+    }
+    while( ( nStep > 0 ) && ( txPower < TX_POWER_7 ) )
+    {
+        txPower++;
+        nStep--;
+    }
+    while( ( nStep < 0 ) && ( txPower > TX_POWER_0 ) )
+    {
+        txPower--;
+        nStep++;
+    }
+    if( ( datarate != node->Frame.Datarate ) || ( txPower != node->NsTxPower ) )
+    {
+        node->NsDatarate = datarate;
+        node->NsTxPower = txPower;
+        node->NsSnrCount = 0;
+        node->Downlink.LinkAdrReq = true;
+    }
+}
+
+static void NsBuildBlock( uint8_t *block, uint32_t devAddr, uint32_t fCnt, uint8_t last )
+{
+    memset( block, 0, 16 );
+    block[0] = 0x49;
+    block[5] = 0x01; /* downlink */
+    block[6] = ( uint8_t )devAddr;
+    block[7] = ( uint8_t )( devAddr >> 8 );
+    block[8] = ( uint8_t )( devAddr >> 16 );
+    block[9] = ( uint8_t )( devAddr >> 24 );
+    block[10] = ( uint8_t )fCnt;
+    block[11] = ( uint8_t )( fCnt >> 8 );
+    block[12] = ( uint8_t )( fCnt >> 16 );
+    block[13] = ( uint8_t )( fCnt >> 24 );
+    block[15] = last;
+}
+
+/*!
+ * \brief Builds the unconfirmed downlink of the device, the MAC commands
+ *        are in FOpts and there is no application payload
+ */
+static void NsBuildDownlink( SimNode_t *node )
+{
+    SimDownlink_t *dl = &node->Downlink;
+    uint32_t devAddr = SIM_DEV_ADDR + NodeId( node );
+    uint32_t fCnt = ++node->NsFCntDown;
+    uint8_t fOptsLen = ( ( dl->LinkAdrReq == true ) ? SIM_LINK_ADR_REQ_SIZE : 0 ) +
+                       ( ( dl->LinkCheckAns == true ) ? SIM_LINK_CHECK_ANS_SIZE : 0 );
+    uint16_t chMask = LC( 1 ) + LC( 2 ) + LC( 3 );
+    uint8_t *frame = dl->Buffer;
+    AES_CMAC_CTX cmac;
+    uint8_t block[16];
+    uint8_t mic[16];
+    uint8_t i = 0;
+
+    frame[i++] = 0x60;
+    frame[i++] = ( uint8_t )devAddr;
+    frame[i++] = ( uint8_t )( devAddr >> 8 );
+    frame[i++] = ( uint8_t )( devAddr >> 16 );
+    frame[i++] = ( uint8_t )( devAddr >> 24 );
+    frame[i++] = ( uint8_t )( ( ( Config.Adr == true ) ? 0x80 : 0x00 ) | ( ( dl->Ack == true ) ? 0x20 : 0x00 ) | fOptsLen );
+    frame[i++] = ( uint8_t )fCnt;
+    frame[i++] = ( uint8_t )( fCnt >> 8 );
+    if( dl->LinkAdrReq == true )
+    {
+        frame[i++] = 0x03;
+        frame[i++] = ( uint8_t )( ( node->NsDatarate << 4 ) | ( node->NsTxPower & 0x0F ) );
+        frame[i++] = ( uint8_t )chMask;
+        frame[i++] = ( uint8_t )( chMask >> 8 );
+        frame[i++] = 0x01; /* ChMaskCntl 0, NbTrans 1 */
+    }
+    if( dl->LinkCheckAns == true )
+    {
+        frame[i++] = 0x02;
+        frame[i++] = dl->Margin;
+        frame[i++] = 1; /* GwCnt */
+    }
+
+    NsBuildBlock( block, devAddr, fCnt, i );
+    AES_CMAC_Init( &cmac );
+    AES_CMAC_SetKey( &cmac, SessionKey );
+    AES_CMAC_Update( &cmac, block, 16 );
+    AES_CMAC_Update( &cmac, frame, i );
+    AES_CMAC_Final( mic, &cmac );
+    memcpy( &frame[i], mic, 4 );
+    dl->Size = i + 4;
+}
+
+static bool GatewayRadioBusy( uint64_t start, uint64_t end )
+{
+    for( uint32_t i = 0; i < Config.Nodes; i++ )
+    {
+        const SimDownlink_t *dl = &Nodes[i].Downlink;
+
+        if( ( dl->Pending == true ) && ( dl->Start < end ) && ( start < dl->End ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief Schedules the downlink of the gateway in RX1, RX2 as a fall-back
+ *        when the gateway duty cycle or its radio is not available
+ */
+static void NsScheduleDownlink( SimNode_t *node, uint64_t uplinkEnd )
+{
+    SimDownlink_t *dl = &node->Downlink;
+    uint8_t size = SIM_DL_FRAME_SIZE + ( ( dl->LinkAdrReq == true ) ? SIM_LINK_ADR_REQ_SIZE : 0 ) +
+                   ( ( dl->LinkCheckAns == true ) ? SIM_LINK_CHECK_ANS_SIZE : 0 );
+
+    for( uint8_t rx2 = 0; rx2 < 2; rx2++ )
+    {
+        int8_t datarate = ( rx2 == 0 ) ? node->Frame.Datarate : EU868_RX_WND_2_DR;
+        uint32_t frequency = ( rx2 == 0 ) ? node->Frame.Frequency : EU868_RX_WND_2_FREQ;
+        uint64_t start = uplinkEnd + ( ( rx2 == 0 ) ? SIM_RECEIVE_DELAY1 : SIM_RECEIVE_DELAY2 );
+        uint32_t toa = SimRadioTimeOnAir( MODEM_LORA, 0, DatarateToSf[datarate], 1, SIM_PREAMBLE_LEN, false, size, false );
+        uint8_t band = GatewayBand( frequency );
+
+        if( ( GatewayBandFree[band] > start ) || ( GatewayRadioBusy( start, start + toa ) == true ) )
+        {
+            continue;
+        }
+        dl->Pending = true;
+        dl->Rx2 = ( rx2 != 0 );
+        dl->Datarate = datarate;
+        dl->Frequency = frequency;
+        dl->Start = start;
+        dl->End = start + toa;
+        NsBuildDownlink( node );
+        /* 1 % on the uplink sub-bands, 10 % on the RX2 sub-band */
+        GatewayBandFree[band] = dl->End + ( uint64_t )toa * ( ( band == 0 ) ? 99 : 9 );
+        GatewayDownlinks++;
+        EventPush( dl->Start, SIM_EV_GW_TX_START, NodeId( node ), NULL );
+        EventPush( dl->End, SIM_EV_GW_TX_END, NodeId( node ), NULL );
+        return;
+    }
+    GatewayDownlinksBlocked++;
+}
+
+/*!
+ * \brief Handles an uplink received by the gateway: delivery of a new
+ *        application payload, MAC commands of FOpts, ADR and answer
+ */
+static void NsOnUplink( SimNode_t *node )
+{
+    const uint8_t *frame = node->Uplink;
+    SimDownlink_t *dl = &node->Downlink;
+    double snr = node->Frame.Rssi - NoiseFloor( );
+    bool confirmed = ( ( frame[0] & 0xE0 ) == 0x80 );
+    uint8_t fCtrl = frame[5];
+    uint8_t fOptsLen = fCtrl & 0x0F;
+    uint16_t fCnt = ( uint16_t )( frame[6] | ( frame[7] << 8 ) );
+    bool payload = ( node->UplinkSize > ( 8 + fOptsLen + 4 ) );
+    bool duplicate = ( node->NsFCntValid == true ) && ( node->NsLastFCnt == fCnt );
+    bool linkCheckReq = false;
+
+    if( duplicate == false )
+    {
+        node->NsLastFCnt = fCnt;
+        node->NsFCntValid = true;
+        if( payload == true )
+        {
+            node->Delivered++;
+        }
+    }
+    for( uint8_t i = 0; i < fOptsLen; )
+    {
+        uint8_t cid = frame[8 + i];
+
+        if( ( cid >= sizeof( UplinkCommandSize ) ) || ( UplinkCommandSize[cid] < 0 ) )
+        {
+            break;
+        }
+        if( cid == 0x02 )
+        {
+            linkCheckReq = true;
+        }
+        else if( cid == 0x03 )
+        {
+            /* LinkADRAns, the request was received */
+            dl->LinkAdrReq = false;
+        }
+        i += 1 + UplinkCommandSize[cid];
+    }
+    if( ( fCtrl & 0x80 ) != 0 )
+    {
+        NsAdr( node, snr );
+    }
+    /* LinkCheckAns margin over the demodulation floor of the uplink */
+    dl->Ack = confirmed;
+    dl->LinkCheckAns = linkCheckReq;
+    dl->Margin = ( uint8_t )MIN( 254.0, MAX( 0.0, floor( snr - SnrFloor[node->Frame.Datarate] ) ) );
+    if( ( confirmed == true ) || ( ( fCtrl & 0x40 ) != 0 ) || ( dl->LinkAdrReq == true ) ||
+        ( dl->LinkCheckAns == true ) )
+    {
+        NsScheduleDownlink( node, node->Frame.End );
+    }
+}
+
+/*
+ *=============================================================================
+ * End-device application, LmHandler
+ *=============================================================================
+ */
+
+static void McpsConfirm( McpsConfirm_t *mcpsConfirm )
+{
+    SimNode_t *node = ActiveNode;
+
+    node->Datarate = ( int8_t )mcpsConfirm->Datarate;
+    node->TxPower = mcpsConfirm->TxPower;
+    if( ( mcpsConfirm->McpsRequest == MCPS_CONFIRMED ) && ( mcpsConfirm->AckReceived == true ) )
+    {
+        node->Acked++;
+    }
+}
+
+static void McpsIndication( McpsIndication_t *mcpsIndication, LoRaMacRxStatus_t *rxStatus )
+{
+    SimNode_t *node = ActiveNode;
+
+    if( ( mcpsIndication->Status != LORAMAC_EVENT_INFO_STATUS_OK ) ||
+        ( ( rxStatus->RxSlot != RX_SLOT_WIN_1 ) && ( rxStatus->RxSlot != RX_SLOT_WIN_2 ) ) )
+    {
+        return;
+    }
+    node->Downlinks++;
+    if( Config.LinkQuality == true )
+    {
+        LoRaMacLinkQualityAddDownlink( &node->LinkQuality, LORAMAC_REGION_EU868, mcpsIndication->RxDatarate,
+                                       rxStatus->Rssi, rxStatus->Snr, ( rxStatus->RxSlot == RX_SLOT_WIN_2 ) );
+    }
+}
+
+static void MlmeConfirm( MlmeConfirm_t *mlmeConfirm )
+{
+    SimNode_t *node = ActiveNode;
+
+    if( ( mlmeConfirm->MlmeRequest == MLME_LINK_CHECK ) && ( mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK ) )
+    {
+        node->LinkCheckAnswers++;
+        if( Config.LinkQuality == true )
+        {
+            // McpsConfirm of the uplink carrying the request comes first
+            LoRaMacLinkQualityAddLinkCheck( &node->LinkQuality, LORAMAC_REGION_EU868, node->Datarate,
+                                            node->TxPower, mlmeConfirm->DemodMargin );
+        }
+    }
+}
+
+static void MlmeIndication( MlmeIndication_t *mlmeIndication, LoRaMacRxStatus_t *rxStatus )
+{
+}
+
+static uint8_t GetBatteryLevel( void )
+{
+    return 254;
+}
+
+static uint16_t GetTemperatureLevel( void )
+{
+    return 25;
+}
+
+static void GetUniqueId( uint8_t *id )
+{
+    memset( id, 0x5A, 8 );
+}
+
+static void NvmDataChange( uint16_t notifyFlags )
+{
+}
+
+static void MacProcessNotify( void )
+{
+}
+
+static LoRaMacPrimitives_t MacPrimitives =
+{
+    .MacMcpsConfirm = McpsConfirm,
+    .MacMcpsIndication = McpsIndication,
+    .MacMlmeConfirm = MlmeConfirm,
+    .MacMlmeIndication = MlmeIndication,
+};
+
+static LoRaMacCallback_t MacCallbacks =
+{
+    .GetBatteryLevel = GetBatteryLevel,
+    .GetTemperatureLevel = GetTemperatureLevel,
+    .GetUniqueId = GetUniqueId,
+    .NvmDataChange = NvmDataChange,
+    .MacProcessNotify = MacProcessNotify,
+};
+
+static void NodeScheduleApp( SimNode_t *node, bool first )
+{
+    double period = Config.Period * 1000.0;
+    double delay = ( first == true ) ? ( period * RngUniform( ) ) : ( period * ( 0.9 + 0.2 * RngUniform( ) ) );
+
+    EventPush( SimTime + ( uint64_t )delay, SIM_EV_APP, NodeId( node ), NULL );
+}
+
+/*!
+ * \brief Runs the link quality policy for a new uplink as
+ *        LmHandlerLinkQualityApply does: unconfirmed uplinks sent with ADR
+ *        off take the proposed datarate and TX power, the other ones the
+ *        application settings
+ */
+static bool NodeLinkQuality( SimNode_t *node, McpsReq_t *mcpsReq )
+{
+    LoRaMacLinkQualityParams_t params;
+    MibRequestConfirm_t mibReq;
+    MlmeReq_t mlmeReq;
+    int8_t datarate;
+    int8_t txPower;
+    bool linkCheckReq;
+
+    mibReq.Type = MIB_CHANNELS_TX_POWER;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    if( mibReq.Param.ChannelsTxPower != node->LinkQualityTxPower )
+    {
+        node->LinkQualityAppTxPower = mibReq.Param.ChannelsTxPower;
+    }
+
+    params.Region = LORAMAC_REGION_EU868;
+    params.UplinkDwellTime = 0;
+    params.AdrEnabled = Config.Adr;
+    params.Datarate = mcpsReq->Req.Unconfirmed.Datarate;
+    params.TxPower = node->LinkQualityAppTxPower;
+    linkCheckReq = LoRaMacLinkQualityCalcNext( &node->LinkQuality, &params, &datarate, &txPower );
+
+    if( Config.Adr == true )
+    {
+        return false;
+    }
+    if( mcpsReq->Type != MCPS_UNCONFIRMED )
+    {
+        datarate = params.Datarate;
+        txPower = params.TxPower;
+    }
+    mcpsReq->Req.Unconfirmed.Datarate = datarate;
+
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    mibReq.Param.ChannelsDatarate = datarate;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    mibReq.Type = MIB_CHANNELS_TX_POWER;
+    mibReq.Param.ChannelsTxPower = txPower;
+    if( LoRaMacMibSetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK )
+    {
+        node->LinkQualityTxPower = txPower;
+    }
+
+    if( linkCheckReq == true )
+    {
+        mlmeReq.Type = MLME_LINK_CHECK;
+        if( LoRaMacMlmeRequest( &mlmeReq ) == LORAMAC_STATUS_OK )
+        {
+            node->LinkChecks++;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief Sends the application payload as LmHandlerSend does, an empty
+ *        frame flushes the MAC commands when the payload does not fit
+ */
+static void NodeSend( SimNode_t *node )
+{
+    McpsReq_t mcpsReq;
+    LoRaMacTxInfo_t txInfo;
+    bool linkCheck = false;
+
+    mcpsReq.Type = ( Config.Confirmed == true ) ? MCPS_CONFIRMED : MCPS_UNCONFIRMED;
+    mcpsReq.Req.Unconfirmed.Datarate = Config.Datarate;
+    if( Config.LinkQuality == true )
+    {
+        linkCheck = NodeLinkQuality( node, &mcpsReq );
+    }
+    if( LoRaMacQueryTxPossible( Config.Payload, &txInfo ) != LORAMAC_STATUS_OK )
+    {
+        mcpsReq.Type = MCPS_UNCONFIRMED;
+        mcpsReq.Req.Unconfirmed.fBuffer = NULL;
+        mcpsReq.Req.Unconfirmed.fBufferSize = 0;
+    }
+    else
+    {
+        mcpsReq.Req.Unconfirmed.fPort = SIM_FPORT;
+        mcpsReq.Req.Unconfirmed.fBuffer = node->Payload;
+        mcpsReq.Req.Unconfirmed.fBufferSize = Config.Payload;
+        if( mcpsReq.Type == MCPS_CONFIRMED )
+        {
+            mcpsReq.Req.Confirmed.NbTrials = SIM_CONFIRMED_NB_TRIALS;
+        }
+    }
+
+    /* the frame is sent by the request when the duty cycle allows it */
+    node->RequestTime = SimTime;
+    node->RequestSent = false;
+    if( LoRaMacMcpsRequest( &mcpsReq, true ) != LORAMAC_STATUS_OK )
+    {
+        node->RequestSent = true;
+        return;
+    }
+    if( Config.LinkQuality == true )
+    {
+        LoRaMacLinkQualityOnUplink( &node->LinkQuality, linkCheck );
+    }
+}
+
+/*!
+ * \brief Runs the MAC of the device after one of its events, then the
+ *        application payload waiting for the end of the previous uplink
+ */
+static void NodeProcess( SimNode_t *node )
+{
+    LoRaMacProcess( );
+    if( ( node->AppPending == true ) && ( LoRaMacIsBusy( ) == false ) )
+    {
+        node->AppPending = false;
+        NodeSend( node );
+    }
+}
+
+static void NodeOnApp( SimNode_t *node )
+{
+    NodeScheduleApp( node, false );
+    node->Generated++;
+    NodeEnter( node );
+    if( LoRaMacIsBusy( ) == true )
+    {
+        if( node->AppPending == true )
+        {
+            node->Superseded++;
+        }
+        node->AppPending = true;
+        return;
+    }
+    NodeSend( node );
+}
+
+static void NodeOnTimer( SimNode_t *node, const SimEvent_t *ev )
+{
+    UTIL_TIMER_Object_t *timer = ev->Timer;
+
+    NodeEnter( node );
+    if( ( timer->IsRunning == 0 ) || ( timer->Timestamp != ev->Seq ) )
+    {
+        return;
+    }
+    timer->IsRunning = 0;
+    timer->Callback( timer->argument );
+    if( ( timer->Mode == UTIL_TIMER_PERIODIC ) && ( timer->IsReloadStopped == 0 ) )
+    {
+        UTIL_TIMER_Start( timer );
+    }
+}
+
+/*!
+ * \brief Ends the uplink: the gateway gets it when it survived, the MAC its
+ *        TX done event, processed after the latency of the MAC task
+ */
+static void NodeOnTxEnd( SimNode_t *node )
+{
+    FrameEnd( &node->Frame );
+    node->Loss[node->Frame.Loss]++;
+    if( node->Frame.Loss == SIM_LOSS_NONE )
+    {
+        NsOnUplink( node );
+    }
+
+    NodeEnter( node );
+    node->Radio.State = RF_IDLE;
+    node->RadioEvent = 0;
+    node->TxEnd = SimTime;
+    node->Rx1Pending = true;
+    RadioEvents->TxDone( );
+    EventPush( SimTime + ( RngNext( ) % ( Config.ProcessLatency + 1 ) ), SIM_EV_PROCESS, NodeId( node ), NULL );
+}
+
+static void NodeOnRxEnd( SimNode_t *node, bool done )
+{
+    SimDownlink_t *dl = &node->Downlink;
+
+    NodeEnter( node );
+    NodeEnergy( node, false, SimTime - node->RxStart );
+    node->Radio.State = RF_IDLE;
+    node->RadioEvent = 0;
+    if( done == true )
+    {
+        /* the radio reports the SNR in dB, saturated around +12 dB */
+        RadioEvents->RxDone( dl->Buffer, dl->Size, ( int16_t )lround( dl->Rssi ),
+                             ( int8_t )lround( MIN( 12.0, dl->Snr ) ) );
+    }
+    else
+    {
+        RadioEvents->RxTimeout( );
+    }
+}
+
+/*!
+ * \brief Starts the MAC of the device, ABP activated with its own device
+ *        address and the keys of se-identity.h
+ */
+static void NodeMacStart( SimNode_t *node )
+{
+    MibRequestConfirm_t mibReq;
+
+    if( LoRaMacInitialization( &MacPrimitives, &MacCallbacks, LORAMAC_REGION_EU868 ) != LORAMAC_STATUS_OK )
+    {
+        fprintf( stderr, "lorasim: LoRaMacInitialization failed\n" );
+        exit( EXIT_FAILURE );
+    }
+    mibReq.Type = MIB_DEV_ADDR;
+    mibReq.Param.DevAddr = SIM_DEV_ADDR + NodeId( node );
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    mibReq.Type = MIB_ABP_LORAWAN_VERSION;
+    mibReq.Param.AbpLrWanVersion.Value = SIM_LORAMAC_VERSION;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    LoRaMacStart( );
+    mibReq.Type = MIB_NETWORK_ACTIVATION;
+    mibReq.Param.NetworkActivation = ACTIVATION_TYPE_ABP;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    mibReq.Type = MIB_ADR;
+    mibReq.Param.AdrEnable = Config.Adr;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    mibReq.Param.ChannelsDatarate = Config.Datarate;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+}
+
+static void NodeInit( SimNode_t *node )
+{
+    memset( node, 0, sizeof( SimNode_t ) );
+    /* uniform distribution over the disc, at least 20 m from the gateway */
+    node->Distance = MAX( 20.0, Config.Radius * sqrt( RngUniform( ) ) );
+    node->Shadowing = RngGaussian( Config.ShadowingSigma );
+    node->Datarate = Config.Datarate;
+    node->TxPower = TX_POWER_0;
+    node->NsTxPower = TX_POWER_0;
+    node->Radio.State = RF_IDLE;
+    node->LinkQualityAppTxPower = TX_POWER_0;
+    node->LinkQualityTxPower = -1;
+    LoRaMacLinkQualityInit( &node->LinkQuality );
+
+    node->MacContext = malloc( MacContextSize );
+    if( node->MacContext == NULL )
+    {
+        fprintf( stderr, "lorasim: out of memory\n" );
+        exit( EXIT_FAILURE );
+    }
+    memcpy( node->MacContext, MacContextDefaults, MacContextSize );
+    NodeEnter( node );
+    NodeMacStart( node );
+
+    NodeScheduleApp( node, true );
+}
+
+/*
+ *=============================================================================
+ * FUOTA session
+ *=============================================================================
+ */
+
+static uint8_t *FuotaFile;
+static uint8_t *FuotaImage;
+
+static int32_t FuotaErase( void )
+{
+    memset( FuotaImage, 0xFF, ( size_t )Config.FuotaFragments * SIM_FUOTA_FRAG_SIZE );
+    return 0;
+}
+
+static int32_t FuotaWrite( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    memcpy( &FuotaImage[addr], data, size );
+    return 0;
+}
+
+static int32_t FuotaRead( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    memcpy( data, &FuotaImage[addr], size );
+    return 0;
+}
+
+static FragDecoderCallbacks_t FuotaCallbacks =
+{
+    .FragDecoderErase = FuotaErase,
+    .FragDecoderWrite = FuotaWrite,
+    .FragDecoderRead = FuotaRead,
+};
+
+static bool IsPowerOfTwo( uint32_t x )
+{
+    return ( x != 0 ) && ( ( x & ( x - 1 ) ) == 0 );
+}
+
+/*!
+ * Encoder side of the parity matrix of FragDecoder.c (LoRa Alliance
+ * fragmented data block transport, PRBS23 driven rows)
+ */
+static void FuotaParityRow( int32_t n, int32_t m, uint8_t *matrixRow )
+{
+    int32_t mTemp = ( IsPowerOfTwo( ( uint32_t )m ) == true ) ? 1 : 0;
+    int32_t x = 1 + ( 1001 * n );
+    int32_t nbCoeff = 0;
+    int32_t r;
+
+    memset( matrixRow, 0, ( size_t )( m >> 3 ) + 1 );
+    while( nbCoeff < ( m >> 1 ) )
+    {
+        r = 1 << 16;
+        while( r >= m )
+        {
+            x = ( x >> 1 ) + ( ( ( x & 0x01 ) ^ ( ( x & 0x20 ) >> 5 ) ) << 22 );
+            r = x % ( m + mTemp );
+        }
+        if( ( matrixRow[r >> 3] & ( 0x80 >> ( r % 8 ) ) ) == 0 )
+        {
+            matrixRow[r >> 3] |= ( uint8_t )( 0x80 >> ( r % 8 ) );
+            nbCoeff++;
+        }
+    }
+}
+
+static void FuotaEncode( uint16_t counter, uint8_t *fragment )
+{
+    uint16_t fragNb = Config.FuotaFragments;
+    uint8_t matrixRow[( FRAG_MAX_NB >> 3 ) + 1];
+
+    if( counter <= fragNb )
+    {
+        memcpy( fragment, &FuotaFile[( counter - 1 ) * SIM_FUOTA_FRAG_SIZE], SIM_FUOTA_FRAG_SIZE );
+        return;
+    }
+    memset( fragment, 0, SIM_FUOTA_FRAG_SIZE );
+    FuotaParityRow( counter - fragNb, fragNb, matrixRow );
+    for( uint16_t i = 0; i < fragNb; i++ )
+    {
+        if( ( matrixRow[i >> 3] & ( 0x80 >> ( i % 8 ) ) ) != 0 )
+        {
+            for( uint8_t j = 0; j < SIM_FUOTA_FRAG_SIZE; j++ )
+            {
+                fragment[j] ^= FuotaFile[i * SIM_FUOTA_FRAG_SIZE + j];
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Multicasts the file on the RX2 channel at the end of the run and
+ *        lets every device rebuild it with FragDecoder
+ */
+static void FuotaRun( void )
+{
+    uint16_t fragNb = Config.FuotaFragments;
+    uint16_t total = fragNb + Config.FuotaRedundancy;
+    uint32_t toa = SimRadioTimeOnAir( MODEM_LORA, 0, DatarateToSf[SIM_FUOTA_DR], 1, SIM_PREAMBLE_LEN, false,
+                                      SIM_FUOTA_FRAG_SIZE + 3 + SIM_DL_FRAME_SIZE, false );
+    uint8_t fragment[SIM_FUOTA_FRAG_SIZE];
+    uint32_t completed = 0;
+    uint64_t received = 0;
+    uint64_t needed = 0;
+
+    FuotaFile = malloc( ( size_t )fragNb * SIM_FUOTA_FRAG_SIZE );
+    FuotaImage = malloc( ( size_t )fragNb * SIM_FUOTA_FRAG_SIZE );
+    for( uint32_t i = 0; i < ( uint32_t )fragNb * SIM_FUOTA_FRAG_SIZE; i++ )
+    {
+        FuotaFile[i] = ( uint8_t )RngNext( );
+    }
+
+    for( uint32_t id = 0; id < Config.Nodes; id++ )
+    {
+        SimNode_t *node = &Nodes[id];
+        int32_t status = FRAG_SESSION_ONGOING;
+        uint16_t counter;
+
+        FragDecoderInit( fragNb, SIM_FUOTA_FRAG_SIZE, &FuotaCallbacks );
+        FuotaErase( );
+        for( counter = 1; ( counter <= total ) && ( status == FRAG_SESSION_ONGOING ); counter++ )
+        {
+            if( ( LinkRssi( node, SIM_GW_RX2_POWER ) - NoiseFloor( ) ) < SnrFloor[SIM_FUOTA_DR] )
+            {
+                continue;
+            }
+            received++;
+            FuotaEncode( counter, fragment );
+            status = FragDecoderProcess( counter, fragment );
+        }
+        /* a finished session reports the number of recovered fragments */
+        if( ( status >= FRAG_SESSION_FINISHED ) && ( FragDecoderGetStatus( ).MatrixError == 0 ) &&
+            ( memcmp( FuotaImage, FuotaFile, ( size_t )fragNb * SIM_FUOTA_FRAG_SIZE ) == 0 ) )
+        {
+            completed++;
+            needed += counter - 1;
+        }
+    }
+
+    printf( "FUOTA            : %u fragments of %u bytes + %u redundancy at DR%d, %.1f s on air\n",
+            fragNb, SIM_FUOTA_FRAG_SIZE, Config.FuotaRedundancy, SIM_FUOTA_DR, ( double )toa * total / 1000.0 );
+    printf( "FUOTA completion : %u / %u devices (%.1f %%), %.1f fragments received per device",
+            completed, Config.Nodes, 100.0 * completed / Config.Nodes, ( double )received / Config.Nodes );
+    if( completed > 0 )
+    {
+        printf( ", %.1f fragments sent until completion", ( double )needed / completed );
+    }
+    printf( "\n" );
+
+    free( FuotaFile );
+    free( FuotaImage );
+}
+
+/*
+ *=============================================================================
+ * Reports
+ *=============================================================================
+ */
+
+static void Report( double wallSeconds )
+{
+    static const char *lossNames[SIM_LOSS_MAX] = { "received", "sensitivity", "collision", "no demodulator", "gateway tx" };
+    double simSeconds = ( double )SimTime / 1000.0;
+    uint64_t generated = 0;
+    uint64_t delivered = 0;
+    uint64_t transmissions = 0;
+    uint64_t superseded = 0;
+    uint64_t downlinks = 0;
+    uint64_t downlinksLost = 0;
+    uint64_t linkChecks = 0;
+    uint64_t linkCheckAnswers = 0;
+    uint64_t loss[SIM_LOSS_MAX] = { 0 };
+    uint64_t drCount[DR_5 + 1] = { 0 };
+    uint64_t dutyCycleWait = 0;
+    uint64_t txTime = 0;
+    double energy = 0.0;
+
+    for( uint32_t id = 0; id < Config.Nodes; id++ )
+    {
+        SimNode_t *node = &Nodes[id];
+        double sleep = ( simSeconds - ( double )( node->TxTime + node->RxTime ) / 1000.0 ) * SIM_SLEEP_CURRENT_MA *
+                       SIM_SUPPLY_VOLTAGE;
+        double nodeEnergy = node->EnergyTx + node->EnergyRx + sleep;
+
+        generated += node->Generated;
+        delivered += node->Delivered;
+        transmissions += node->Transmissions;
+        superseded += node->Superseded;
+        downlinks += node->Downlinks;
+        downlinksLost += node->DownlinksLost;
+        linkChecks += node->LinkChecks;
+        linkCheckAnswers += node->LinkCheckAnswers;
+        dutyCycleWait += node->DutyCycleWait;
+        txTime += node->TxTime;
+        energy += nodeEnergy;
+        for( uint8_t i = 0; i < SIM_LOSS_MAX; i++ )
+        {
+            loss[i] += node->Loss[i];
+        }
+        for( uint8_t i = 0; i <= DR_5; i++ )
+        {
+            drCount[i] += node->DrCount[i];
+        }
+        if( Config.Verbose == true )
+        {
+            printf( "node %4u %6.0f m  DR%d  tx %2d dBm  PDR %5.1f %%  tx %5u  dl %4u  %8.1f mJ\n", id,
+                    node->Distance, node->Datarate, RegionCommonComputeTxPower( node->TxPower, EU868_DEFAULT_MAX_EIRP,
+                    EU868_DEFAULT_ANTENNA_GAIN ), ( node->Generated != 0 ) ? 100.0 * node->Delivered / node->Generated : 0.0,
+                    node->Transmissions, node->Downlinks, nodeEnergy );
+        }
+    }
+
+    printf( "scenario         : %u nodes, %.1f h, radius %.0f m, period %.0f s, %u bytes, ADR %s, %s, seed %u\n",
+            Config.Nodes, Config.Hours, Config.Radius, Config.Period, Config.Payload, Config.Adr ? "on" : "off",
+            Config.Confirmed ? "confirmed" : "unconfirmed", Config.Seed );
+    if( Config.LinkQuality == true )
+    {
+        printf( "link quality     : %llu LinkCheckReq, %llu LinkCheckAns received\n",
+                ( unsigned long long )linkChecks, ( unsigned long long )linkCheckAnswers );
+    }
+    printf( "packets          : %llu generated, %llu delivered, %llu superseded in the application queue\n",
+            ( unsigned long long )generated, ( unsigned long long )delivered, ( unsigned long long )superseded );
+    printf( "PDR              : %.2f %%\n", ( generated != 0 ) ? 100.0 * delivered / generated : 0.0 );
+    printf( "throughput       : %.1f bit/s delivered, channel load %.3f Erlang per channel\n",
+            ( double )delivered * Config.Payload * 8.0 / simSeconds, ( double )txTime / 1000.0 / simSeconds / 3.0 );
+    printf( "transmissions    : %llu", ( unsigned long long )transmissions );
+    for( uint8_t i = 0; i < SIM_LOSS_MAX; i++ )
+    {
+        printf( ", %s %llu", lossNames[i], ( unsigned long long )loss[i] );
+    }
+    printf( "\n" );
+    printf( "datarates        :" );
+    for( uint8_t i = 0; i <= DR_5; i++ )
+    {
+        printf( " DR%u %.1f %%", i, ( transmissions != 0 ) ? 100.0 * drCount[i] / transmissions : 0.0 );
+    }
+    printf( "\n" );
+    printf( "downlinks        : %u sent, %u not scheduled (gateway duty cycle or radio busy), %llu received, %llu lost\n",
+            GatewayDownlinks, GatewayDownlinksBlocked, ( unsigned long long )downlinks, ( unsigned long long )downlinksLost );
+    printf( "duty-cycle wait  : %.1f s per node\n", ( double )dutyCycleWait / 1000.0 / Config.Nodes );
+    printf( "energy           : %.2f J per node, %.3f mJ per delivered packet\n", energy / 1000.0 / Config.Nodes,
+            ( delivered != 0 ) ? energy / delivered : 0.0 );
+    printf( "speed            : %.1f s simulated in %.3f s, %.0fx real time\n", simSeconds, wallSeconds,
+            ( wallSeconds > 0.0 ) ? simSeconds / wallSeconds : 0.0 );
+}
+
+/*!
+ * \brief Prints when the RX1 window opens after the end of the uplink
+ *
+ * \retval true when it does not depend on the latency of the MAC task
+ */
+static bool ReportRx1Open( void )
+{
+    bool steady = true;
+
+    printf( "RX1 opening      :" );
+    for( uint8_t i = 0; i <= DR_5; i++ )
+    {
+        if( Rx1OpenCount[i] == 0 )
+        {
+            continue;
+        }
+        printf( " DR%u %llu", i, ( unsigned long long )Rx1OpenMin[i] );
+        if( Rx1OpenMax[i] != Rx1OpenMin[i] )
+        {
+            printf( "..%llu", ( unsigned long long )Rx1OpenMax[i] );
+            steady = false;
+        }
+        printf( " ms" );
+    }
+    printf( " after TX done, MAC task latency up to %u ms%s\n", Config.ProcessLatency,
+            ( steady == true ) ? "" : ", FAILED" );
+    return steady;
+}
+
+/*
+ *=============================================================================
+ * Main
+ *=============================================================================
+ */
+
+static void Usage( void )
+{
+    fprintf( stderr, "usage: lorasim [-n nodes] [-t hours] [-r radius m] [-p period s] [-l payload] [-s seed]\n"
+                     "               [-a adr 0|1] [-c confirmed 0|1] [-d initial datarate]\n"
+                     "               [-q link quality policy 0|1]\n"
+                     "               [-x path loss exponent] [-g shadowing dB] [-f fuota fragments]\n"
+                     "               [-k fuota redundancy] [-j process latency ms] [-v]\n" );
+    exit( EXIT_FAILURE );
+}
+
+static void ParseArgs( int argc, char **argv )
+{
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "n:t:r:p:l:s:a:c:d:q:x:g:f:k:j:v" ) ) != -1 )
+    {
+        switch( opt )
+        {
+            case 'n': Config.Nodes = ( uint32_t )strtoul( optarg, NULL, 0 ); break;
+            case 't': Config.Hours = strtod( optarg, NULL ); break;
+            case 'r': Config.Radius = strtod( optarg, NULL ); break;
+            case 'p': Config.Period = strtod( optarg, NULL ); break;
+            case 'l': Config.Payload = ( uint8_t )strtoul( optarg, NULL, 0 ); break;
+            case 's': Config.Seed = ( uint32_t )strtoul( optarg, NULL, 0 ); break;
+            case 'a': Config.Adr = ( atoi( optarg ) != 0 ); break;
+            case 'c': Config.Confirmed = ( atoi( optarg ) != 0 ); break;
+            case 'd': Config.Datarate = ( int8_t )atoi( optarg ); break;
+            case 'q': Config.LinkQuality = ( atoi( optarg ) != 0 ); break;
+            case 'x': Config.PathLossExponent = strtod( optarg, NULL ); break;
+            case 'g': Config.ShadowingSigma = strtod( optarg, NULL ); break;
+            case 'f': Config.FuotaFragments = ( uint16_t )strtoul( optarg, NULL, 0 ); break;
+            case 'k': Config.FuotaRedundancy = ( uint16_t )strtoul( optarg, NULL, 0 ); break;
+            case 'j': Config.ProcessLatency = ( uint32_t )strtoul( optarg, NULL, 0 ); break;
+            case 'v': Config.Verbose = true; break;
+            default: Usage( ); break;
+        }
+    }
+    if( ( Config.Nodes == 0 ) || ( Config.Nodes > SIM_MAX_NODES ) || ( Config.Hours <= 0.0 ) ||
+        ( Config.Hours > SIM_MAX_HOURS ) || ( Config.Radius <= 0.0 ) || ( Config.Period <= 0.0 ) ||
+        ( Config.Payload > 222 ) || ( Config.Datarate < DR_0 ) || ( Config.Datarate > DR_5 ) ||
+        ( Config.FuotaFragments > FRAG_MAX_NB ) || ( Config.FuotaRedundancy > FRAG_MAX_REDUNDANCY ) ||
+        ( Config.ProcessLatency >= SIM_RECEIVE_DELAY1 ) )
+    {
+        Usage( );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    struct timespec begin;
+    struct timespec end;
+    uint64_t endTime;
+    bool rx1Steady;
+
+    ParseArgs( argc, argv );
+    RngSeed( Config.Seed );
+    srand1( Config.Seed );
+
+    MacContextSize = ( size_t )( __stop_lorasim_mac - __start_lorasim_mac );
+    MacContextDefaults = malloc( MacContextSize );
+    Nodes = calloc( Config.Nodes, sizeof( SimNode_t ) );
+    if( ( MacContextSize == 0 ) || ( MacContextDefaults == NULL ) || ( Nodes == NULL ) )
+    {
+        return EXIT_FAILURE;
+    }
+    memcpy( MacContextDefaults, __start_lorasim_mac, MacContextSize );
+    for( uint16_t id = 0; id < Config.Nodes; id++ )
+    {
+        NodeInit( &Nodes[id] );
+    }
+
+    endTime = ( uint64_t )( Config.Hours * 3600.0 * 1000.0 );
+    clock_gettime( CLOCK_MONOTONIC, &begin );
+    while( ( EventCount > 0 ) && ( Events[0].Time <= endTime ) )
+    {
+        SimEvent_t ev = EventPop( );
+        SimNode_t *node = &Nodes[ev.Node];
+
+        SimTime = ev.Time;
+        switch( ev.Type )
+        {
+            case SIM_EV_APP:
+                NodeOnApp( node );
+                break;
+            case SIM_EV_TIMER:
+                NodeOnTimer( node, &ev );
+                break;
+            case SIM_EV_TX_END:
+                NodeOnTxEnd( node );
+                continue;
+            case SIM_EV_PROCESS:
+                NodeEnter( node );
+                break;
+            case SIM_EV_RX_DONE:
+            case SIM_EV_RX_TIMEOUT:
+                if( ev.Seq != node->RadioEvent )
+                {
+                    /* the MAC left the window before it ended */
+                    continue;
+                }
+                NodeOnRxEnd( node, ( ev.Type == SIM_EV_RX_DONE ) );
+                break;
+            case SIM_EV_GW_TX_START:
+                GatewayTxStart( );
+                continue;
+            case SIM_EV_GW_TX_END:
+                GatewayTxActive = false;
+                node->Downlink.Pending = false;
+                continue;
+        }
+        NodeProcess( node );
+    }
+    SimTime = endTime;
+    clock_gettime( CLOCK_MONOTONIC, &end );
+
+    Report( ( double )( end.tv_sec - begin.tv_sec ) + ( double )( end.tv_nsec - begin.tv_nsec ) / 1e9 );
+    rx1Steady = ReportRx1Open( );
+    if( Config.FuotaFragments > 0 )
+    {
+        FuotaRun( );
+    }
+    for( uint32_t id = 0; id < Config.Nodes; id++ )
+    {
+        free( Nodes[id].MacContext );
+    }
+    free( MacContextDefaults );
+    free( Nodes );
+    return ( rx1Steady == true ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,806 @@
+/*!
+ * \file      mcastsim.c
+ *
+ * \brief     Host test of the remote multicast setup session scheduling
+ *
+ * \details   Runs LmhpRemoteMcastSetup.c and McSessionScheduler.c on the
+ *            host with four multicast groups, over the real LoRaMac.c with
+ *            its multicast channels, class switches and RxC window. The
+ *            LmHandler class services are replaced by a model recording the
+ *            device class switches, the timer server runs on a simulated
+ *            RTC and the radio records the continuous receptions.
+ *
+ *            Each scenario delivers a sequence of McGroupSetupReq,
+ *            McClassCSessionReq and McClassBSessionReq downlinks, then
+ *            checks the answers of the package, the class switches
+ *            ("time:class", in seconds from the scenario start) and the
+ *            class C receptions opened by the MAC ("time:frequency/SF").
+ *            The class B switch is modelled as instantaneous, as if the
+ *            beacon was acquired at once, the MAC stays in class A.
+ *
+ *            Usage: mcastsim [-v]
+ *              -v  prints the answers and the class switches of every
+ *                  scenario
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "timer.h"
+#include "systime.h"
+#include "radio.h"
+#include "LmHandler.h"
+#include "LmhpRemoteMcastSetup.h"
+
+#define MCASTSIM_START_TIME                         1600000000
+#define MCASTSIM_DURATION                           1000
+#define MCASTSIM_STEP                               10
+#define MCASTSIM_MAX_STEPS                          4
+#define MCASTSIM_LOG_SIZE                           128
+#define MCASTSIM_DEV_ADDR                           0x0100000A
+
+#define REMOTE_MCAST_SETUP_PORT                     200
+
+/*!
+ * Request fields, little endian
+ */
+#define U24( v )                                    ( uint8_t )( v ), ( uint8_t )( ( v ) >> 8 ), ( uint8_t )( ( v ) >> 16 )
+#define U32( v )                                    U24( v ), ( uint8_t )( ( v ) >> 24 )
+#define SESSION_TIME( t )                           U32( MCASTSIM_START_TIME - UNIX_GPS_EPOCH_OFFSET + ( t ) )
+
+#define GROUP_SETUP_REQ( id )                       0x02, ( id ), U32( 0x01FF0000 + ( id ) ), \
+                                                    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, \
+                                                    0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, \
+                                                    U32( 0 ), U32( 0xFFFF )
+#define GROUP_DELETE_REQ( id )                      0x03, ( id )
+#define CLASS_C_SESSION_REQ( id, t, timeOut, frequency, dr ) \
+                                                    0x04, ( id ), SESSION_TIME( t ), ( timeOut ), U24( ( frequency ) / 100 ), ( dr )
+#define CLASS_B_SESSION_REQ( id, t, timeOut, periodicity, frequency, dr ) \
+                                                    0x05, ( id ), SESSION_TIME( t ), ( ( periodicity ) << 4 ) | ( timeOut ), \
+                                                    U24( ( frequency ) / 100 ), ( dr )
+
+#define REQ( ... )                                  .Request = { __VA_ARGS__ }, .RequestSize = sizeof( ( uint8_t[] ){ __VA_ARGS__ } )
+
+#define MC_FREQUENCY                                869525000
+#define MC_OTHER_FREQUENCY                          868100000
+
+typedef struct McastSimStep_s
+{
+    /*!
+     * Downlink time in seconds from the scenario start
+     */
+    uint32_t Time;
+    uint8_t Request[64];
+    uint8_t RequestSize;
+    /*!
+     * Expected answer, hexadecimal bytes separated by spaces
+     */
+    const char *Answer;
+}McastSimStep_t;
+
+typedef struct McastSimScenario_s
+{
+    const char *Name;
+    /*!
+     * Class of the device before the sessions
+     */
+    DeviceClass_t InitialClass;
+    /*!
+     * The class switch requests fail until this time, in seconds
+     */
+    uint32_t BusyUntil;
+    McastSimStep_t Steps[MCASTSIM_MAX_STEPS];
+    /*!
+     * Expected class switches
+     */
+    const char *Switches;
+    /*!
+     * Expected class C receptions
+     */
+    const char *Receptions;
+}McastSimScenario_t;
+
+static const McastSimScenario_t Scenarios[] =
+{
+    {
+        .Name = "single class C session",
+        .Steps =
+        {
+            { 0, REQ( GROUP_SETUP_REQ( 0 ), CLASS_C_SESSION_REQ( 0, 60, 6, MC_FREQUENCY, 0 ) ), "02 00 04 00 3C 00 00" },
+        },
+        .Switches = "60:C 124:A",
+        .Receptions = "60:869525000/SF12",
+    },
+    {
+        .Name = "adjacent class C sessions",
+        .Steps =
+        {
+            { 0, REQ( GROUP_SETUP_REQ( 0 ), GROUP_SETUP_REQ( 1 ) ), "02 00 02 01" },
+            { 10, REQ( CLASS_C_SESSION_REQ( 0, 60, 5, MC_FREQUENCY, 0 ) ), "04 00 32 00 00" },
+            { 20, REQ( CLASS_C_SESSION_REQ( 1, 100, 5, MC_FREQUENCY, 0 ) ), "04 01 50 00 00" },
+        },
+        .Switches = "60:C 132:A",
+        .Receptions = "60:869525000/SF12",
+    },
+    {
+        .Name = "overlapping class C sessions",
+        .Steps =
+        {
+            { 0, REQ( GROUP_SETUP_REQ( 0 ), GROUP_SETUP_REQ( 1 ) ), "02 00 02 01" },
+            { 10, REQ( CLASS_C_SESSION_REQ( 0, 60, 6, MC_FREQUENCY, 0 ) ), "04 00 32 00 00" },
+            { 20, REQ( CLASS_C_SESSION_REQ( 1, 100, 6, MC_FREQUENCY, 0 ) ), "04 01 50 00 00" },
+        },
+        .Switches = "60:C 164:A",
+        .Receptions = "60:869525000/SF12",
+    },
+    {
+        .Name = "class C frequency conflict",
+        .Steps =
+        {
+            { 0, REQ( GROUP_SETUP_REQ( 0 ), GROUP_SETUP_REQ( 1 ) ), "02 00 02 01" },
+            { 10, REQ( CLASS_C_SESSION_REQ( 0, 60, 6, MC_FREQUENCY, 0 ) ), "04 00 32 00 00" },
+            { 20, REQ( CLASS_C_SESSION_REQ( 1, 100, 6, MC_OTHER_FREQUENCY, 0 ) ), "04 21" },
+        },
+        .Switches = "60:C 124:A",
+        .Receptions = "60:869525000/SF12",
+    },
+    {
+        .Name = "class C sessions on two channels",
+        .Steps =
+        {
+            { 0, REQ( GROUP_SETUP_REQ( 0 ), GROUP_SETUP_REQ( 1 ) ), "02 00 02 01" },
+            { 10, REQ( CLASS_C_SESSION_REQ( 0, 60, 6, MC_FREQUENCY, 0 ) ), "04 00 32 00 00" },
+            { 20, REQ( CLASS_C_SESSION_REQ( 1, 300, 5, MC_OTHER_FREQUENCY, 3 ) ), "04 01 18 01 00" },
+        },
+        .Switches = "60:C 124:A 300:C 332:A",
+        .Receptions = "60:869525000/SF12 300:868100000/SF9",
+    },
+    {
+        .Name = "class C channel conflict in the merge gap",
+        .Steps =
+        {
+            { 0, REQ( GROUP_SETUP_REQ( 0 ), GROUP_SETUP_REQ( 1 ) ), "02 00 02 01" },
+            { 10, REQ( CLASS_C_SESSION_REQ( 0, 60, 6, MC_FREQUENCY, 0 ) ), "04 00 32 00 00" },
+            { 20, REQ( CLASS_C_SESSION_REQ( 1, 124, 5, MC_OTHER_FREQUENCY, 3 ) ), "04 21" },
+        },
+        .Switches = "60:C 124:A",
+        .Receptions = "60:869525000/SF12",
+    },
+    {
+        .Name = "class C application, session channel",
+        .InitialClass = CLASS_C,
+        .Steps =
+        {
+            { 0, REQ( GROUP_SETUP_REQ( 0 ), CLASS_C_SESSION_REQ( 0, 60, 6, MC_OTHER_FREQUENCY, 3 ) ),
+              "02 00 04 00 3C 00 00" },
+        },
+        .Switches = "",
+        .Receptions = "0:869525000/SF12 60:868100000/SF9 124:869525000/SF12",
+    },
+    {
+        .Name = "class B session overlapping class C",
+        .Steps =
+        {
+            { 0, REQ( GROUP_SETUP_REQ( 0 ), GROUP_SETUP_REQ( 1 ) ), "02 00 02 01" },
+            { 10, REQ( CLASS_C_SESSION_REQ( 0, 60, 6, MC_FREQUENCY, 0 ) ), "04 00 32 00 00" },
+            { 20, REQ( CLASS_B_SESSION_REQ( 1, 100, 0, 7, 0, 3 ) ), "05 21" },
+        },
+        .Switches = "60:C 124:A",
+        .Receptions = "60:869525000/SF12",
+    },
+    {
+        .Name = "class B session after class C",
+        .Steps =
+        {
+            { 0, REQ( GROUP_SETUP_REQ( 0 ), GROUP_SETUP_REQ( 1 ) ), "02 00 02 01" },
+            { 10, REQ( CLASS_C_SESSION_REQ( 0, 60, 6, MC_FREQUENCY, 0 ) ), "04 00 32 00 00" },
+            { 20, REQ( CLASS_B_SESSION_REQ( 1, 124, 0, 7, 0, 3 ) ), "05 01 68 00 00" },
+        },
+        .Switches = "60:C 124:A 124:B 252:A",
+        .Receptions = "60:869525000/SF12",
+    },
+    {
+        .Name = "class C application",
+        .InitialClass = CLASS_C,
+        .Steps =
+        {
+            { 0, REQ( GROUP_SETUP_REQ( 0 ), GROUP_SETUP_REQ( 1 ) ), "02 00 02 01" },
+            { 0, REQ( CLASS_B_SESSION_REQ( 0, 60, 0, 7, MC_FREQUENCY, 3 ) ), "05 00 3C 00 00" },
+            { 200, REQ( CLASS_C_SESSION_REQ( 1, 300, 4, MC_FREQUENCY, 0 ) ), "04 01 64 00 00" },
+        },
+        .Switches = "60:A 60:B 188:A 188:C",
+        .Receptions = "0:869525000/SF12 188:869525000/SF12",
+    },
+    {
+        .Name = "start missed",
+        .Steps =
+        {
+            { 100, REQ( GROUP_SETUP_REQ( 0 ), CLASS_C_SESSION_REQ( 0, 50, 6, MC_FREQUENCY, 0 ) ), "02 00 04 10" },
+        },
+        .Switches = "",
+        .Receptions = "",
+    },
+    {
+        .Name = "undefined group",
+        .Steps =
+        {
+            { 0, REQ( CLASS_C_SESSION_REQ( 2, 60, 6, MC_FREQUENCY, 0 ) ), "04 1E" },
+        },
+        .Switches = "",
+        .Receptions = "",
+    },
+    {
+        .Name = "invalid datarate",
+        .Steps =
+        {
+            { 0, REQ( GROUP_SETUP_REQ( 3 ), CLASS_C_SESSION_REQ( 3, 60, 6, MC_FREQUENCY, 12 ) ), "02 03 04 07" },
+        },
+        .Switches = "",
+        .Receptions = "",
+    },
+    {
+        .Name = "class switch retried while busy",
+        .BusyUntil = 63,
+        .Steps =
+        {
+            { 0, REQ( GROUP_SETUP_REQ( 0 ), CLASS_C_SESSION_REQ( 0, 60, 6, MC_FREQUENCY, 0 ) ), "02 00 04 00 3C 00 00" },
+        },
+        .Switches = "63:C 124:A",
+        .Receptions = "63:869525000/SF12",
+    },
+    {
+        .Name = "group deleted during its session",
+        .Steps =
+        {
+            { 0, REQ( GROUP_SETUP_REQ( 0 ), CLASS_C_SESSION_REQ( 0, 60, 6, MC_FREQUENCY, 0 ) ), "02 00 04 00 3C 00 00" },
+            { 90, REQ( GROUP_DELETE_REQ( 0 ) ), "03 00" },
+        },
+        .Switches = "60:C 90:A",
+        .Receptions = "60:869525000/SF12",
+    },
+    {
+        .Name = "session rescheduled",
+        .Steps =
+        {
+            { 0, REQ( GROUP_SETUP_REQ( 0 ), CLASS_C_SESSION_REQ( 0, 60, 6, MC_FREQUENCY, 0 ) ), "02 00 04 00 3C 00 00" },
+            { 30, REQ( CLASS_C_SESSION_REQ( 0, 300, 6, MC_FREQUENCY, 0 ) ), "04 00 0E 01 00" },
+        },
+        .Switches = "300:C 364:A",
+        .Receptions = "300:869525000/SF12",
+    },
+};
+
+/*!
+ * Simulated RTC, in ms since the scenario start
+ */
+static uint32_t RtcMs;
+static uint32_t BackupSeconds;
+static uint32_t BackupSubSeconds;
+
+/*!
+ * Simulated timer server alarm
+ */
+static uint32_t TimerContext;
+static uint32_t TimerAlarm;
+static bool TimerArmed;
+
+/*!
+ * LmHandler model
+ */
+static DeviceClass_t CurrentClass;
+static uint32_t BusyUntil;
+static bool DutyCycle;
+static bool ProcessPending;
+
+/*!
+ * Radio settings of the next reception
+ */
+static uint32_t RadioFrequency;
+static uint32_t RadioSpreadingFactor;
+
+static char SwitchLog[MCASTSIM_LOG_SIZE];
+static char AnswerLog[MCASTSIM_LOG_SIZE];
+static char ReceptionLog[MCASTSIM_LOG_SIZE];
+
+/*
+ *=============================================================================
+ * Host timer and systime drivers on the simulated RTC
+ *=============================================================================
+ */
+
+static uint32_t HostRtcTicks( void )
+{
+    return RtcMs;
+}
+
+static UTIL_TIMER_Status_t HostTimerStatusOk( void )
+{
+    return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t HostTimerStart( uint32_t timeout )
+{
+    TimerAlarm = TimerContext + timeout;
+    TimerArmed = true;
+    return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t HostTimerStop( void )
+{
+    TimerArmed = false;
+    return UTIL_TIMER_OK;
+}
+
+static uint32_t HostTimerSetContext( void )
+{
+    TimerContext = HostRtcTicks( );
+    return TimerContext;
+}
+
+static uint32_t HostTimerGetContext( void )
+{
+    return TimerContext;
+}
+
+static uint32_t HostTimerElapsed( void )
+{
+    return HostRtcTicks( ) - TimerContext;
+}
+
+static uint32_t HostTimerMinimumTimeout( void )
+{
+    return 1;
+}
+
+static uint32_t HostTimerIdentity( uint32_t value )
+{
+    return value;
+}
+
+const UTIL_TIMER_Driver_s UTIL_TimerDriver =
+{
+    HostTimerStatusOk,
+    HostTimerStatusOk,
+    HostTimerStart,
+    HostTimerStop,
+    HostTimerSetContext,
+    HostTimerGetContext,
+    HostTimerElapsed,
+    HostRtcTicks,
+    HostTimerMinimumTimeout,
+    HostTimerIdentity,
+    HostTimerIdentity,
+};
+
+static uint32_t HostSysTimeGetCalendarTime( uint16_t *subSeconds )
+{
+    *subSeconds = ( uint16_t )( RtcMs % 1000 );
+    return RtcMs / 1000;
+}
+
+static void HostWriteSeconds( uint32_t seconds )
+{
+    BackupSeconds = seconds;
+}
+
+static uint32_t HostReadSeconds( void )
+{
+    return BackupSeconds;
+}
+
+static void HostWriteSubSeconds( uint32_t subSeconds )
+{
+    BackupSubSeconds = subSeconds;
+}
+
+static uint32_t HostReadSubSeconds( void )
+{
+    return BackupSubSeconds;
+}
+
+const UTIL_SYSTIM_Driver_s UTIL_SYSTIMDriver =
+{
+    HostWriteSeconds,
+    HostReadSeconds,
+    HostWriteSubSeconds,
+    HostReadSubSeconds,
+    HostSysTimeGetCalendarTime,
+};
+
+/*
+ *=============================================================================
+ * LmHandler model
+ *=============================================================================
+ */
+
+LmHandlerErrorStatus_t LmHandlerRequestClass( DeviceClass_t newClass )
+{
+    size_t len = strlen( SwitchLog );
+
+    if( RtcMs < BusyUntil * 1000 )
+    {
+        return LORAMAC_HANDLER_BUSY_ERROR;
+    }
+    if( newClass == CurrentClass )
+    {
+        return LORAMAC_HANDLER_SUCCESS;
+    }
+    if( ( newClass != CLASS_A ) && ( CurrentClass != CLASS_A ) )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+    if( newClass != CLASS_B )
+    {
+        MibRequestConfirm_t mibReq;
+
+        // The MAC stays in class A for a class B session
+        mibReq.Type = MIB_DEVICE_CLASS;
+        LoRaMacMibGetRequestConfirm( &mibReq );
+        if( mibReq.Param.Class != newClass )
+        {
+            mibReq.Param.Class = newClass;
+            if( LoRaMacMibSetRequestConfirm( &mibReq ) != LORAMAC_STATUS_OK )
+            {
+                return LORAMAC_HANDLER_ERROR;
+            }
+        }
+    }
+    CurrentClass = newClass;
+    snprintf( SwitchLog + len, sizeof( SwitchLog ) - len, "%s%u:%c", ( len > 0 ) ? " " : "", RtcMs / 1000,
+              "ABC"[newClass] );
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+LmHandlerErrorStatus_t LmHandlerGetCurrentClass( DeviceClass_t *deviceClass )
+{
+    *deviceClass = CurrentClass;
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+LmHandlerErrorStatus_t LmHandlerGetDutyCycleEnable( bool *dutyCycleEnable )
+{
+    *dutyCycleEnable = DutyCycle;
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+LmHandlerErrorStatus_t LmHandlerSetDutyCycleEnable( bool dutyCycleEnable )
+{
+    DutyCycle = dutyCycleEnable;
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+static LmHandlerErrorStatus_t HostSendRequest( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed,
+                                               TimerTime_t *nextTxIn, bool allowDelayedTx )
+{
+    for( uint8_t i = 0; i < appData->BufferSize; i++ )
+    {
+        size_t len = strlen( AnswerLog );
+
+        snprintf( AnswerLog + len, sizeof( AnswerLog ) - len, "%s%02X", ( len > 0 ) ? " " : "", appData->Buffer[i] );
+    }
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+static void HostProcessEvent( void )
+{
+    ProcessPending = true;
+}
+
+/*
+ *=============================================================================
+ * Radio recording the continuous receptions, MAC primitives
+ *=============================================================================
+ */
+
+static void HostRadioInit( RadioEvents_t *events )
+{
+}
+
+static RadioState_t HostRadioGetStatus( void )
+{
+    return RF_IDLE;
+}
+
+static void HostRadioSetChannel( uint32_t freq )
+{
+    RadioFrequency = freq;
+}
+
+static uint32_t HostRadioRandom( void )
+{
+    return 0x12345678;
+}
+
+static void HostRadioSetRxConfig( RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                  uint32_t bandwidthAfc, uint16_t preambleLen, uint16_t symbTimeout, bool fixLen,
+                                  uint8_t payloadLen, bool crcOn, bool freqHopOn, uint8_t hopPeriod,
+                                  bool iqInverted, bool rxContinuous )
+{
+    RadioSpreadingFactor = datarate;
+}
+
+static void HostRadioSetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev, uint32_t bandwidth,
+                                  uint32_t datarate, uint8_t coderate, uint16_t preambleLen, bool fixLen,
+                                  bool crcOn, bool freqHopOn, uint8_t hopPeriod, bool iqInverted, uint32_t timeout )
+{
+}
+
+static bool HostRadioCheckRfFrequency( uint32_t frequency )
+{
+    return true;
+}
+
+static uint32_t HostRadioTimeOnAir( RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                    uint16_t preambleLen, bool fixLen, uint8_t payloadLen, bool crcOn )
+{
+    return 100;
+}
+
+static void HostRadioSend( uint8_t *buffer, uint8_t size )
+{
+}
+
+static void HostRadioNop( void )
+{
+}
+
+static void HostRadioRx( uint32_t timeout )
+{
+    size_t len = strlen( ReceptionLog );
+
+    if( timeout == 0 )
+    {
+        snprintf( ReceptionLog + len, sizeof( ReceptionLog ) - len, "%s%u:%u/SF%u", ( len > 0 ) ? " " : "",
+                  RtcMs / 1000, RadioFrequency, RadioSpreadingFactor );
+    }
+}
+
+static void HostRadioSetMaxPayloadLength( RadioModems_t modem, uint8_t max )
+{
+}
+
+static void HostRadioSetPublicNetwork( bool enable )
+{
+}
+
+static uint32_t HostRadioGetWakeupTime( void )
+{
+    return 3;
+}
+
+const struct Radio_s Radio =
+{
+    .Init = HostRadioInit,
+    .GetStatus = HostRadioGetStatus,
+    .SetChannel = HostRadioSetChannel,
+    .Random = HostRadioRandom,
+    .SetRxConfig = HostRadioSetRxConfig,
+    .SetTxConfig = HostRadioSetTxConfig,
+    .CheckRfFrequency = HostRadioCheckRfFrequency,
+    .TimeOnAir = HostRadioTimeOnAir,
+    .Send = HostRadioSend,
+    .Sleep = HostRadioNop,
+    .Standby = HostRadioNop,
+    .Rx = HostRadioRx,
+    .SetMaxPayloadLength = HostRadioSetMaxPayloadLength,
+    .SetPublicNetwork = HostRadioSetPublicNetwork,
+    .GetWakeupTime = HostRadioGetWakeupTime,
+};
+
+static void McpsConfirm( McpsConfirm_t *mcpsConfirm )
+{
+}
+
+static void McpsIndication( McpsIndication_t *mcpsIndication, LoRaMacRxStatus_t *rxStatus )
+{
+}
+
+static void MlmeConfirm( MlmeConfirm_t *mlmeConfirm )
+{
+}
+
+static void MlmeIndication( MlmeIndication_t *mlmeIndication, LoRaMacRxStatus_t *rxStatus )
+{
+}
+
+static uint8_t GetBatteryLevel( void )
+{
+    return 254;
+}
+
+static uint16_t GetTemperatureLevel( void )
+{
+    return 25;
+}
+
+static void GetUniqueId( uint8_t *id )
+{
+    memset( id, 0x5A, 8 );
+}
+
+static void NvmDataChange( uint16_t notifyFlags )
+{
+}
+
+static void MacProcessNotify( void )
+{
+}
+
+static LoRaMacPrimitives_t MacPrimitives =
+{
+    .MacMcpsConfirm = McpsConfirm,
+    .MacMcpsIndication = McpsIndication,
+    .MacMlmeConfirm = MlmeConfirm,
+    .MacMlmeIndication = MlmeIndication,
+};
+
+static LoRaMacCallback_t MacCallbacks =
+{
+    .GetBatteryLevel = GetBatteryLevel,
+    .GetTemperatureLevel = GetTemperatureLevel,
+    .GetUniqueId = GetUniqueId,
+    .NvmDataChange = NvmDataChange,
+    .MacProcessNotify = MacProcessNotify,
+};
+
+/*!
+ * \brief Starts the MAC, ABP activated, in the initial class of the scenario
+ */
+static void MacStart( DeviceClass_t initialClass )
+{
+    MibRequestConfirm_t mibReq;
+
+    if( LoRaMacInitialization( &MacPrimitives, &MacCallbacks, LORAMAC_REGION_EU868 ) != LORAMAC_STATUS_OK )
+    {
+        fprintf( stderr, "mcastsim: LoRaMacInitialization failed\n" );
+        exit( EXIT_FAILURE );
+    }
+    mibReq.Type = MIB_DEV_ADDR;
+    mibReq.Param.DevAddr = MCASTSIM_DEV_ADDR;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    mibReq.Type = MIB_ABP_LORAWAN_VERSION;
+    mibReq.Param.AbpLrWanVersion.Value = 0x01000300;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    LoRaMacStart( );
+    mibReq.Type = MIB_NETWORK_ACTIVATION;
+    mibReq.Param.NetworkActivation = ACTIVATION_TYPE_ABP;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    if( initialClass == CLASS_C )
+    {
+        mibReq.Type = MIB_DEVICE_CLASS;
+        mibReq.Param.Class = CLASS_C;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+    }
+}
+
+/*
+ *=============================================================================
+ * Scenarios
+ *=============================================================================
+ */
+
+static void Deliver( LmhPackage_t *package, const McastSimStep_t *step )
+{
+    McpsIndication_t indication;
+    uint8_t buffer[sizeof( step->Request )];
+
+    memcpy( buffer, step->Request, step->RequestSize );
+    memset( &indication, 0, sizeof( indication ) );
+    indication.Port = REMOTE_MCAST_SETUP_PORT;
+    indication.Buffer = buffer;
+    indication.BufferSize = step->RequestSize;
+    package->OnMcpsIndicationProcess( &indication );
+}
+
+static bool Run( const McastSimScenario_t *scenario, bool verbose )
+{
+    static uint8_t dataBuffer[242];
+    LmhPackage_t *package = LmhpRemoteMcastSetupPackageFactory( );
+    SysTime_t start = { .Seconds = MCASTSIM_START_TIME, .SubSeconds = 0 };
+    bool passed = true;
+    uint8_t step = 0;
+
+    RtcMs = 0;
+    BackupSeconds = 0;
+    BackupSubSeconds = 0;
+    TimerArmed = false;
+    CurrentClass = scenario->InitialClass;
+    BusyUntil = scenario->BusyUntil;
+    ProcessPending = false;
+    SwitchLog[0] = '\0';
+    ReceptionLog[0] = '\0';
+
+    UTIL_TIMER_Init( );
+    SysTimeSet( start );
+    MacStart( scenario->InitialClass );
+    package->OnSendRequest = HostSendRequest;
+    package->OnPackageProcessEvent = HostProcessEvent;
+    package->Init( NULL, dataBuffer, sizeof( dataBuffer ) );
+
+    for( ; RtcMs <= MCASTSIM_DURATION * 1000; RtcMs += MCASTSIM_STEP )
+    {
+        if( ( TimerArmed == true ) && ( ( int32_t )( RtcMs - TimerAlarm ) >= 0 ) )
+        {
+            TimerArmed = false;
+            UTIL_TIMER_IRQ_Handler( );
+        }
+        while( ( step < MCASTSIM_MAX_STEPS ) && ( scenario->Steps[step].RequestSize > 0 ) &&
+               ( scenario->Steps[step].Time * 1000 == RtcMs ) )
+        {
+            AnswerLog[0] = '\0';
+            Deliver( package, &scenario->Steps[step] );
+            if( verbose == true )
+            {
+                printf( "  %4u s answer   %s\n", scenario->Steps[step].Time, AnswerLog );
+            }
+            if( strcmp( AnswerLog, scenario->Steps[step].Answer ) != 0 )
+            {
+                printf( "FAIL %s: answer at %u s \"%s\", expected \"%s\"\n", scenario->Name, scenario->Steps[step].Time,
+                        AnswerLog, scenario->Steps[step].Answer );
+                passed = false;
+            }
+            step++;
+        }
+        while( ProcessPending == true )
+        {
+            ProcessPending = false;
+            package->Process( );
+        }
+    }
+
+    if( verbose == true )
+    {
+        printf( "  switches        %s\n", SwitchLog );
+        printf( "  receptions      %s\n", ReceptionLog );
+    }
+    if( strcmp( SwitchLog, scenario->Switches ) != 0 )
+    {
+        printf( "FAIL %s: switches \"%s\", expected \"%s\"\n", scenario->Name, SwitchLog, scenario->Switches );
+        passed = false;
+    }
+    if( strcmp( ReceptionLog, scenario->Receptions ) != 0 )
+    {
+        printf( "FAIL %s: receptions \"%s\", expected \"%s\"\n", scenario->Name, ReceptionLog,
+                scenario->Receptions );
+        passed = false;
+    }
+    return passed;
+}
+
+int main( int argc, char **argv )
+{
+    bool verbose = false;
+    uint32_t failed = 0;
+    uint32_t count = sizeof( Scenarios ) / sizeof( Scenarios[0] );
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "v" ) ) != -1 )
+    {
+        switch( opt )
+        {
+            case 'v': verbose = true; break;
+            default:
+                fprintf( stderr, "usage: mcastsim [-v]\n" );
+                return 2;
+        }
+    }
+
+    for( uint32_t i = 0; i < count; i++ )
+    {
+        bool passed;
+
+        if( verbose == true )
+        {
+            printf( "%s\n", Scenarios[i].Name );
+        }
+        passed = Run( &Scenarios[i], verbose );
+        printf( "%-40s %s\n", Scenarios[i].Name, ( passed == true ) ? "ok" : "FAILED" );
+        if( passed == false )
+        {
+            failed++;
+        }
+    }
+    printf( "%u/%u scenarios passed\n", count - failed, count );
+    return ( failed == 0 ) ? 0 : 1;
+}
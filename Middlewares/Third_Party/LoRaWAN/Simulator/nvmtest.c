@@ -0,0 +1,715 @@
+/*!
+ * \file      nvmtest.c
+ *
+ * \brief     Host power loss test of the NVM context management
+ *
+ * \details   Runs NvmDataMgmt.c and nvmm.c with context management enabled
+ *            on a littlefs file system in RAM, behind the littlefs testing
+ *            block device, with the frame counter journal in a raw flash
+ *            page next to it. The MAC is replaced by the context it would
+ *            hand over with MIB_NVM_CTXS.
+ *
+ *            A sequence of contexts is stored the way the MAC notifies
+ *            them: the frame counters on every step, as crypto journal
+ *            entries until the journal is full, the other groups every few
+ *            steps, the crypto record when its nonces change, then a
+ *            factory reset. The sequence is run once per program and erase
+ *            operation of the flash, in a child process which loses the
+ *            power at that operation, a journal slot being torn. Each group
+ *            restored on the next boot shall be the one of the last stored
+ *            context or of the context being stored, and the recovered file
+ *            system shall take a new context.
+ *
+ *            The wear case bumps the uplink frame counter on a full size
+ *            journal page and bounds the erased pages and programmed bytes
+ *            per bump.
+ *
+ *            Usage: nvmtest
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "lfs.h"
+#include "bd/lfs_testbd.h"
+#include "utilities.h"
+#include "LoRaMac.h"
+#include "NvmDataMgmt.h"
+#include "nvmm.h"
+
+#define CHECK( cond )                                                         \
+    do                                                                        \
+    {                                                                         \
+        if( !( cond ) )                                                       \
+        {                                                                     \
+            printf( "FAIL %s line %d: %s\n", __func__, __LINE__, #cond );     \
+            return false;                                                     \
+        }                                                                     \
+    }while( 0 )
+
+typedef struct NvmTestCase_s
+{
+    const char *Name;
+    bool ( *Run )( void );
+}NvmTestCase_t;
+
+/*!
+ * Flash geometry, the file cache is the nvmm.c file buffer
+ */
+#define NVMTEST_BLOCK_SIZE                          2048
+#define NVMTEST_BLOCK_COUNT                         8
+
+/*!
+ * Journal page of the sequence, small enough to be folded several times,
+ * and of the wear case, a flash page
+ */
+#define NVMTEST_JOURNAL_PAGE_SIZE                   128
+#define NVMTEST_WEAR_PAGE_SIZE                      NVMTEST_BLOCK_SIZE
+
+/*!
+ * Uplink frame counter bumps of the wear case
+ */
+#define NVMTEST_WEAR_BUMPS                          2000
+
+/*!
+ * Erased flash pages and programmed bytes allowed per frame counter bump,
+ * appending the entries to a littlefs file took 0.86 erases and 290 bytes
+ */
+#define NVMTEST_WEAR_MAX_ERASES_PER_BUMP            0.01
+#define NVMTEST_WEAR_MAX_BYTES_PER_BUMP             16
+
+/*!
+ * Stored contexts of the sequence
+ */
+#define NVMTEST_STEPS                               48
+
+/*!
+ * Steps between two changes of the crypto record nonces, longer than a full
+ * crypto journal
+ */
+#define NVMTEST_CRYPTO_PERIOD                       24
+
+/*!
+ * Exit status of a child when the testing block device cuts the power
+ */
+#define NVMTEST_POWER_LOSS                          33
+
+#define NVMTEST_NOTIFY_FLAG_ALL                     0x7F
+
+/*!
+ * NVM groups, in LoRaMacNvmData_t order as in NvmDataMgmt.c
+ */
+static const struct
+{
+    const char *Name;
+    uint16_t NotifyFlag;
+    uint16_t Offset;
+    uint16_t Size;
+}Groups[] =
+{
+    { "crypto",         LORAMAC_NVM_NOTIFY_FLAG_CRYPTO,         offsetof( LoRaMacNvmData_t, Crypto ),        sizeof( LoRaMacCryptoNvmData_t ) },
+    { "MAC group 1",    LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1,     offsetof( LoRaMacNvmData_t, MacGroup1 ),     sizeof( LoRaMacNvmDataGroup1_t ) },
+    { "MAC group 2",    LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2,     offsetof( LoRaMacNvmData_t, MacGroup2 ),     sizeof( LoRaMacNvmDataGroup2_t ) },
+    { "secure element", LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT, offsetof( LoRaMacNvmData_t, SecureElement ), sizeof( SecureElementNvmData_t ) },
+    { "region group 1", LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1,  offsetof( LoRaMacNvmData_t, RegionGroup1 ),  sizeof( RegionNvmDataGroup1_t ) },
+    { "region group 2", LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2,  offsetof( LoRaMacNvmData_t, RegionGroup2 ),  sizeof( RegionNvmDataGroup2_t ) },
+    { "class B",        LORAMAC_NVM_NOTIFY_FLAG_CLASS_B,        offsetof( LoRaMacNvmData_t, ClassB ),        sizeof( LoRaMacClassBNvmData_t ) },
+};
+
+#define NVMTEST_GROUPS                              ( sizeof( Groups ) / sizeof( Groups[0] ) )
+
+/*!
+ * Flash shared with the child processes, with the last step they stored
+ */
+typedef struct NvmTestFlash_s
+{
+    volatile int32_t Committed;
+    uint8_t Blocks[NVMTEST_BLOCK_SIZE * NVMTEST_BLOCK_COUNT];
+    uint8_t Journal[NVMTEST_WEAR_PAGE_SIZE];
+}NvmTestFlash_t;
+
+static NvmTestFlash_t *Flash;
+
+static lfs_testbd_t Bd;
+
+static struct lfs_testbd_config BdConfig;
+
+/*!
+ * Erased pages and programmed bytes of the file system and of the journal
+ */
+static uint32_t NbErases;
+static uint32_t NbProgBytes;
+
+static int CountProg( const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size )
+{
+    NbProgBytes += size;
+    return lfs_testbd_prog( c, block, off, buffer, size );
+}
+
+static int CountErase( const struct lfs_config *c, lfs_block_t block )
+{
+    NbErases++;
+    return lfs_testbd_erase( c, block );
+}
+
+static const struct lfs_config LfsConfig =
+{
+    .context = &Bd,
+    .read = lfs_testbd_read,
+    .prog = CountProg,
+    .erase = CountErase,
+    .sync = lfs_testbd_sync,
+    .read_size = 1,
+    .prog_size = 8,
+    .block_size = NVMTEST_BLOCK_SIZE,
+    .block_count = NVMTEST_BLOCK_COUNT,
+    .block_cycles = 500,
+    .cache_size = NVMM_FILE_BUFFER_SIZE,
+    .lookahead_size = 8,
+};
+
+static lfs_t Lfs;
+
+/*!
+ * \brief Counts a journal page operation against the power cycles of the
+ *        testing block device
+ *
+ * \retval                      true when the power is lost at the operation
+ */
+static bool JournalPowerLoss( void )
+{
+    if( Bd.power_cycles > 0 )
+    {
+        Bd.power_cycles--;
+        return Bd.power_cycles == 0;
+    }
+    return false;
+}
+
+static bool JournalRead( uint32_t offset, uint8_t *buffer, uint32_t size )
+{
+    memcpy( buffer, Flash->Journal + offset, size );
+    return true;
+}
+
+static bool JournalProg( uint32_t offset, const uint8_t *buffer, uint32_t size )
+{
+    for( uint32_t i = 0; i < size; i++ )
+    {
+        if( Flash->Journal[offset + i] != 0xFF )
+        {
+            printf( "    journal programmed twice at %u\n", ( unsigned )( offset + i ) );
+            exit( 1 );
+        }
+    }
+    NbProgBytes += size;
+    if( JournalPowerLoss( ) == true )
+    {
+        // The double word is torn
+        memcpy( Flash->Journal + offset, buffer, size / 2 );
+        exit( NVMTEST_POWER_LOSS );
+    }
+    memcpy( Flash->Journal + offset, buffer, size );
+    return true;
+}
+
+static bool JournalErase( void )
+{
+    NbErases++;
+    if( JournalPowerLoss( ) == true )
+    {
+        // The page is partly erased
+        memset( Flash->Journal, 0xFF, NVMTEST_JOURNAL_PAGE_SIZE / 2 );
+        exit( NVMTEST_POWER_LOSS );
+    }
+    memset( Flash->Journal, 0xFF, sizeof( Flash->Journal ) );
+    return true;
+}
+
+static const NvmmJournalPage_t JournalPage =
+{
+    .Size = NVMTEST_JOURNAL_PAGE_SIZE,
+    .Read = JournalRead,
+    .Prog = JournalProg,
+    .Erase = JournalErase,
+};
+
+static const NvmmJournalPage_t WearPage =
+{
+    .Size = NVMTEST_WEAR_PAGE_SIZE,
+    .Read = JournalRead,
+    .Prog = JournalProg,
+    .Erase = JournalErase,
+};
+
+/*!
+ * Context of the MAC
+ */
+static LoRaMacNvmData_t Nvm;
+
+static uint32_t Rng = 1;
+
+static uint32_t Random( void )
+{
+    Rng ^= Rng << 13;
+    Rng ^= Rng >> 17;
+    Rng ^= Rng << 5;
+    return Rng;
+}
+
+LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t* mibGet )
+{
+    if( mibGet->Type != MIB_NVM_CTXS )
+    {
+        return LORAMAC_STATUS_SERVICE_UNKNOWN;
+    }
+    mibGet->Param.Contexts = &Nvm;
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacStop( void )
+{
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacStart( void )
+{
+    return LORAMAC_STATUS_OK;
+}
+
+/*!
+ * \brief Erases the shared flash
+ */
+static void EraseFlash( void )
+{
+    memset( Flash->Blocks, 0, sizeof( Flash->Blocks ) );
+    memset( Flash->Journal, 0xFF, sizeof( Flash->Journal ) );
+}
+
+/*!
+ * \brief Mounts the file system on the shared flash
+ *
+ * \param [IN] powerCycles      Program and erase operations before the power
+ *                              loss, 0 for none
+ * \param [IN] format           Formats the flash first
+ * \param [IN] journal          Journal page
+ */
+static bool MountJournal( uint32_t powerCycles, bool format, const NvmmJournalPage_t *journal )
+{
+    BdConfig = ( struct lfs_testbd_config ){ .erase_value = -1, .power_cycles = powerCycles, .buffer = Flash->Blocks };
+
+    if( lfs_testbd_createcfg( &LfsConfig, NULL, &BdConfig ) != 0 )
+    {
+        return false;
+    }
+    if( ( format == true ) && ( lfs_format( &Lfs, &LfsConfig ) != LFS_ERR_OK ) )
+    {
+        return false;
+    }
+    return ( lfs_mount( &Lfs, &LfsConfig ) == LFS_ERR_OK ) && ( NvmmInit( &Lfs, journal ) == true );
+}
+
+static bool Mount( uint32_t powerCycles, bool format )
+{
+    return MountJournal( powerCycles, format, &JournalPage );
+}
+
+static void Unmount( void )
+{
+    lfs_unmount( &Lfs );
+    lfs_testbd_destroy( &LfsConfig );
+}
+
+/*!
+ * \brief Returns true when the group changes at the step
+ */
+static bool Changes( uint8_t group, int32_t step )
+{
+    return ( step == 0 ) || ( group == 0 ) || ( ( step % ( group + 1 ) ) == 0 );
+}
+
+/*!
+ * \brief Builds a group as stored at a step, the bytes of a group only
+ *        change with its version, the frame counters with every step
+ */
+static void BuildGroup( uint8_t group, int32_t step, uint8_t *dest )
+{
+    uint32_t version = ( group == 0 ) ? ( uint32_t )( step / NVMTEST_CRYPTO_PERIOD ) : ( uint32_t )( step / ( group + 1 ) );
+    uint16_t size = Groups[group].Size - sizeof( uint32_t );
+    uint32_t crc;
+
+    Rng = ( ( group + 1 ) << 16 ) ^ ( version + 1 );
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        dest[i] = ( uint8_t )Random( );
+    }
+    if( group == 0 )
+    {
+        LoRaMacCryptoNvmData_t *crypto = ( LoRaMacCryptoNvmData_t* )dest;
+
+        crypto->FCntList.FCntUp = ( uint32_t )step;
+        crypto->FCntList.NFCntDown = ( uint32_t )step / 2;
+        crypto->LastDownFCnt = ( uint32_t )step / 2;
+    }
+    crc = Crc32( dest, size );
+    memcpy( dest + size, &crc, sizeof( crc ) );
+}
+
+static void BuildContext( LoRaMacNvmData_t *nvm, int32_t step )
+{
+    memset( nvm, 0, sizeof( LoRaMacNvmData_t ) );
+    for( uint8_t g = 0; g < NVMTEST_GROUPS; g++ )
+    {
+        BuildGroup( g, step, ( uint8_t* )nvm + Groups[g].Offset );
+    }
+}
+
+/*!
+ * \brief Returns true when the group of the MAC context is the one of the
+ *        step, no group exists before the first step or after the factory
+ *        reset
+ */
+static bool GroupIs( uint8_t group, int32_t step )
+{
+    static LoRaMacNvmData_t expected;
+
+    if( ( step < 0 ) || ( step >= NVMTEST_STEPS ) )
+    {
+        return false;
+    }
+    BuildContext( &expected, step );
+    return memcmp( ( uint8_t* )&Nvm + Groups[group].Offset, ( uint8_t* )&expected + Groups[group].Offset,
+                   Groups[group].Size ) == 0;
+}
+
+/*!
+ * \brief Stores the context of a step with the flags of its changed groups
+ *
+ * \retval                      Bytes stored
+ */
+static uint16_t Store( int32_t step )
+{
+    uint16_t flags = LORAMAC_NVM_NOTIFY_FLAG_NONE;
+
+    for( uint8_t g = 0; g < NVMTEST_GROUPS; g++ )
+    {
+        if( Changes( g, step ) == true )
+        {
+            flags |= Groups[g].NotifyFlag;
+        }
+    }
+    BuildContext( &Nvm, step );
+    NvmDataMgmtEvent( flags );
+    return NvmDataMgmtStore( );
+}
+
+/*!
+ * \brief Restores the context on the next boot, over a garbage context
+ */
+static uint16_t Restore( void )
+{
+    memset( &Nvm, 0xA5, sizeof( Nvm ) );
+    return NvmDataMgmtRestore( );
+}
+
+/*!
+ * The last four bytes of each group are its CRC32
+ */
+static bool GroupLayout( void )
+{
+    uint16_t end = 0;
+
+    for( uint8_t g = 0; g < NVMTEST_GROUPS; g++ )
+    {
+        CHECK( Groups[g].Offset >= end );
+        end = Groups[g].Offset + Groups[g].Size;
+    }
+    CHECK( end <= sizeof( LoRaMacNvmData_t ) );
+    CHECK( offsetof( LoRaMacNvmData_t, Crypto ) + offsetof( LoRaMacCryptoNvmData_t, Crc32 ) ==
+           Groups[0].Offset + Groups[0].Size - sizeof( uint32_t ) );
+    CHECK( offsetof( LoRaMacNvmData_t, MacGroup1 ) + offsetof( LoRaMacNvmDataGroup1_t, Crc32 ) ==
+           Groups[1].Offset + Groups[1].Size - sizeof( uint32_t ) );
+    CHECK( offsetof( LoRaMacNvmData_t, MacGroup2 ) + offsetof( LoRaMacNvmDataGroup2_t, Crc32 ) ==
+           Groups[2].Offset + Groups[2].Size - sizeof( uint32_t ) );
+    CHECK( offsetof( LoRaMacCryptoNvmData_t, LastDownFCnt ) + sizeof( uint32_t ) ==
+           offsetof( LoRaMacCryptoNvmData_t, Crc32 ) );
+    return true;
+}
+
+/*!
+ * Every step restored exactly, with crypto journal entries and folds
+ */
+static bool StoreRestore( void )
+{
+    uint32_t journaled = 0;
+    uint32_t folded = 0;
+
+    EraseFlash( );
+    CHECK( Mount( 0, true ) == true );
+    CHECK( NvmDataMgmtFactoryReset( ) == true );
+    CHECK( Restore( ) == 0 );
+
+    for( int32_t s = 0; s < NVMTEST_STEPS; s++ )
+    {
+        uint16_t others = 0;
+        uint16_t stored = Store( s );
+
+        for( uint8_t g = 1; g < NVMTEST_GROUPS; g++ )
+        {
+            others += Changes( g, s ) ? Groups[g].Size : 0;
+        }
+        CHECK( stored > others );
+        if( ( stored - others ) < sizeof( LoRaMacCryptoNvmData_t ) )
+        {
+            // One entry per changed frame counter
+            CHECK( ( ( stored - others ) % NVMM_JOURNAL_ENTRY_SIZE ) == 0 );
+            journaled++;
+        }
+        else
+        {
+            CHECK( ( stored - others ) == sizeof( LoRaMacCryptoNvmData_t ) );
+            if( ( s % NVMTEST_CRYPTO_PERIOD ) != 0 )
+            {
+                // Journal full
+                folded++;
+            }
+        }
+
+        CHECK( Restore( ) == sizeof( LoRaMacNvmData_t ) );
+        for( uint8_t g = 0; g < NVMTEST_GROUPS; g++ )
+        {
+            CHECK( GroupIs( g, s ) == true );
+        }
+    }
+    Unmount( );
+
+    // A remount restores the last step
+    CHECK( Mount( 0, false ) == true );
+    CHECK( Restore( ) == sizeof( LoRaMacNvmData_t ) );
+    for( uint8_t g = 0; g < NVMTEST_GROUPS; g++ )
+    {
+        CHECK( GroupIs( g, NVMTEST_STEPS - 1 ) == true );
+    }
+    Unmount( );
+
+    CHECK( ( journaled != 0 ) && ( folded != 0 ) );
+    return true;
+}
+
+/*!
+ * Nothing is restored after a factory reset, a new context is stored
+ */
+static bool FactoryReset( void )
+{
+    EraseFlash( );
+    CHECK( Mount( 0, true ) == true );
+    for( int32_t s = 0; s < 3; s++ )
+    {
+        CHECK( Store( s ) != 0 );
+    }
+    CHECK( NvmDataMgmtFactoryReset( ) == true );
+    CHECK( Restore( ) == 0 );
+    // Only the crypto group changes, the others are missing
+    Store( 1 );
+    CHECK( Restore( ) == 0 );
+    CHECK( Store( 0 ) != 0 );
+    CHECK( Restore( ) == sizeof( LoRaMacNvmData_t ) );
+    for( uint8_t g = 0; g < NVMTEST_GROUPS; g++ )
+    {
+        CHECK( GroupIs( g, 0 ) == true );
+    }
+    Unmount( );
+    return true;
+}
+
+/*!
+ * \brief Child process: stores the sequence and the factory reset, until the
+ *        power loss
+ */
+static int RunSequence( uint32_t powerCycles )
+{
+    if( Mount( powerCycles, false ) == false )
+    {
+        return 1;
+    }
+    // Clears the crypto record state inherited from the parent
+    NvmDataMgmtFactoryReset( );
+    for( int32_t s = 0; s < NVMTEST_STEPS; s++ )
+    {
+        if( Store( s ) == 0 )
+        {
+            return 1;
+        }
+        Flash->Committed = s;
+    }
+    if( NvmDataMgmtFactoryReset( ) == false )
+    {
+        return 1;
+    }
+    Flash->Committed = NVMTEST_STEPS;
+    Unmount( );
+    return 0;
+}
+
+/*!
+ * \brief Boots after the power loss and checks the restored context
+ *
+ * \param [IN] committed        Last step stored before the power loss, -1
+ *                              for none, NVMTEST_STEPS after the reset
+ */
+static bool Recover( int32_t committed )
+{
+    uint16_t restored;
+    int32_t next = ( committed + 2 ) % NVMTEST_STEPS;
+
+    CHECK( Mount( 0, false ) == true );
+    restored = Restore( );
+    if( restored == 0 )
+    {
+        // A group is only missing while the first step or the factory
+        // reset is interrupted
+        CHECK( ( committed < 0 ) || ( committed >= ( NVMTEST_STEPS - 1 ) ) );
+    }
+    else
+    {
+        CHECK( restored == sizeof( LoRaMacNvmData_t ) );
+        for( uint8_t g = 0; g < NVMTEST_GROUPS; g++ )
+        {
+            if( ( GroupIs( g, committed ) == false ) && ( GroupIs( g, committed + 1 ) == false ) )
+            {
+                printf( "    %s lost after step %d\n", Groups[g].Name, ( int )committed );
+                return false;
+            }
+        }
+    }
+
+    // The recovered file system takes a new context
+    BuildContext( &Nvm, next );
+    NvmDataMgmtEvent( NVMTEST_NOTIFY_FLAG_ALL );
+    CHECK( NvmDataMgmtStore( ) != 0 );
+    CHECK( Restore( ) == sizeof( LoRaMacNvmData_t ) );
+    for( uint8_t g = 0; g < NVMTEST_GROUPS; g++ )
+    {
+        CHECK( GroupIs( g, next ) == true );
+    }
+    Unmount( );
+    return true;
+}
+
+/*!
+ * Power loss at every program and erase operation of the sequence
+ */
+static bool PowerLoss( void )
+{
+    uint32_t losses = 0;
+
+    for( uint32_t cycles = 1; ; cycles++ )
+    {
+        pid_t pid;
+        int status;
+
+        EraseFlash( );
+        CHECK( Mount( 0, true ) == true );
+        Unmount( );
+        Flash->Committed = -1;
+
+        fflush( stdout );
+        pid = fork( );
+        CHECK( pid >= 0 );
+        if( pid == 0 )
+        {
+            _exit( RunSequence( cycles ) );
+        }
+        CHECK( waitpid( pid, &status, 0 ) == pid );
+        CHECK( WIFEXITED( status ) );
+        if( WEXITSTATUS( status ) == 0 )
+        {
+            // The sequence needs fewer operations
+            break;
+        }
+        CHECK( WEXITSTATUS( status ) == NVMTEST_POWER_LOSS );
+        losses++;
+
+        if( Recover( Flash->Committed ) == false )
+        {
+            printf( "    power loss at operation %u\n", ( unsigned )cycles );
+            return false;
+        }
+    }
+    printf( "    %u power losses\n", ( unsigned )losses );
+    CHECK( losses > NVMTEST_STEPS );
+    return true;
+}
+
+/*!
+ * Erased pages and programmed bytes per uplink frame counter bump
+ */
+static bool Wear( void )
+{
+    LoRaMacCryptoNvmData_t *crypto = &Nvm.Crypto;
+    uint32_t fCntUp;
+
+    EraseFlash( );
+    CHECK( MountJournal( 0, true, &WearPage ) == true );
+    BuildContext( &Nvm, 0 );
+    NvmDataMgmtEvent( NVMTEST_NOTIFY_FLAG_ALL );
+    CHECK( NvmDataMgmtStore( ) != 0 );
+
+    NbErases = 0;
+    NbProgBytes = 0;
+    fCntUp = crypto->FCntList.FCntUp;
+    for( uint32_t i = 0; i < NVMTEST_WEAR_BUMPS; i++ )
+    {
+        crypto->FCntList.FCntUp = ++fCntUp;
+        crypto->Crc32 = Crc32( ( uint8_t* )crypto, sizeof( LoRaMacCryptoNvmData_t ) - sizeof( uint32_t ) );
+        NvmDataMgmtEvent( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO );
+        CHECK( NvmDataMgmtStore( ) != 0 );
+    }
+    printf( "    %.4f erases and %.1f bytes per frame counter bump\n",
+            ( double )NbErases / NVMTEST_WEAR_BUMPS, ( double )NbProgBytes / NVMTEST_WEAR_BUMPS );
+    CHECK( ( double )NbErases <= ( NVMTEST_WEAR_MAX_ERASES_PER_BUMP * NVMTEST_WEAR_BUMPS ) );
+    CHECK( NbProgBytes <= ( NVMTEST_WEAR_MAX_BYTES_PER_BUMP * NVMTEST_WEAR_BUMPS ) );
+
+    CHECK( Restore( ) == sizeof( LoRaMacNvmData_t ) );
+    CHECK( crypto->FCntList.FCntUp == fCntUp );
+    CHECK( crypto->Crc32 == Crc32( ( uint8_t* )crypto, sizeof( LoRaMacCryptoNvmData_t ) - sizeof( uint32_t ) ) );
+    Unmount( );
+    return true;
+}
+
+static const NvmTestCase_t Cases[] =
+{
+    { "group layout", GroupLayout },
+    { "store and restore", StoreRestore },
+    { "factory reset", FactoryReset },
+    { "power loss at every program and erase", PowerLoss },
+    { "erases per frame counter bump", Wear },
+};
+
+int main( void )
+{
+    int status = 0;
+
+    Flash = mmap( NULL, sizeof( NvmTestFlash_t ), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+    if( Flash == MAP_FAILED )
+    {
+        perror( "mmap" );
+        return 2;
+    }
+
+    for( uint32_t n = 0; n < sizeof( Cases ) / sizeof( Cases[0] ); n++ )
+    {
+        bool passed = Cases[n].Run( );
+
+        printf( "%-40s %s\n", Cases[n].Name, ( passed == true ) ? "ok" : "FAILED" );
+        if( passed == false )
+        {
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,16 @@
+/*!
+ * \file      adc_if.h
+ *
+ * \brief     ADC interface of the AT application host build
+ */
+#ifndef __ADC_IF_H__
+#define __ADC_IF_H__
+
+#include <stdint.h>
+
+void SYS_InitMeasurement( void );
+void SYS_DeInitMeasurement( void );
+int16_t SYS_GetTemperatureLevel( void );
+uint16_t SYS_GetBatteryLevel( void );
+
+#endif // __ADC_IF_H__
@@ -0,0 +1,106 @@
+/*!
+ * \file      main.h
+ *
+ * \brief     HAL subset of the AT application host build
+ *
+ * \details   The UART and its DMA channels are plain registers and handles,
+ *            the test providing the HAL functions drives them.
+ */
+#ifndef __MAIN_H__
+#define __MAIN_H__
+
+#include <stdint.h>
+
+typedef enum
+{
+    RESET = 0,
+    SET = !RESET
+}FlagStatus;
+
+typedef enum
+{
+    HAL_OK = 0,
+    HAL_ERROR,
+    HAL_BUSY,
+    HAL_TIMEOUT
+}HAL_StatusTypeDef;
+
+typedef enum
+{
+    HAL_UART_STATE_RESET = 0x00,
+    HAL_UART_STATE_READY = 0x20,
+    HAL_UART_STATE_BUSY_RX = 0x22
+}HAL_UART_StateTypeDef;
+
+typedef struct
+{
+    volatile uint32_t CR1;
+    volatile uint32_t CR3;
+    volatile uint32_t ISR;
+}USART_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t CCR;
+    volatile uint32_t CNDTR;
+}DMA_Channel_TypeDef;
+
+typedef struct
+{
+    DMA_Channel_TypeDef *Instance;
+}DMA_HandleTypeDef;
+
+typedef struct
+{
+    USART_TypeDef *Instance;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+    volatile HAL_UART_StateTypeDef RxState;
+}UART_HandleTypeDef;
+
+typedef struct
+{
+    uint32_t WakeUpEvent;
+}UART_WakeUpTypeDef;
+
+#define USART_CR1_UE                                ( 1U << 0 )
+#define USART_CR3_DMAR                              ( 1U << 6 )
+#define USART_ISR_BUSY                              ( 1U << 16 )
+#define USART_ISR_REACK                             ( 1U << 22 )
+#define DMA_CCR_EN                                  ( 1U << 0 )
+
+#define UART_IT_WUF                                 0
+#define UART_WAKEUP_ON_STARTBIT                     2
+#define LL_EXTI_LINE_27                             ( 1U << 27 )
+#define DMA1_Channel5_IRQn                          0
+
+#define READ_BIT( REG, BIT )                        ( ( REG ) & ( BIT ) )
+#define __HAL_UART_GET_FLAG( HANDLE, FLAG )         ( ( ( ( HANDLE )->Instance->ISR & ( FLAG ) ) == ( FLAG ) ) ? SET : RESET )
+#define __HAL_UART_ENABLE_IT( HANDLE, IT )
+#define __HAL_DMA_GET_COUNTER( HANDLE )             ( ( HANDLE )->Instance->CNDTR )
+#define __HAL_RCC_USART1_FORCE_RESET( )
+#define __HAL_RCC_USART1_RELEASE_RESET( )
+#define __HAL_RCC_USART2_FORCE_RESET( )
+#define __HAL_RCC_USART2_RELEASE_RESET( )
+#define LL_EXTI_EnableIT_0_31( LINES )
+#define HAL_NVIC_DisableIRQ( IRQN )
+
+HAL_StatusTypeDef HAL_UART_Init( UART_HandleTypeDef *huart );
+void HAL_UART_MspDeInit( UART_HandleTypeDef *huart );
+HAL_StatusTypeDef HAL_UART_Transmit( UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout );
+HAL_StatusTypeDef HAL_UART_Transmit_DMA( UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size );
+HAL_StatusTypeDef HAL_UART_AbortReceive( UART_HandleTypeDef *huart );
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA( UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size );
+HAL_StatusTypeDef HAL_UARTEx_StopModeWakeUpSourceConfig( UART_HandleTypeDef *huart, UART_WakeUpTypeDef WakeUpSelection );
+HAL_StatusTypeDef HAL_UARTEx_EnableStopMode( UART_HandleTypeDef *huart );
+HAL_StatusTypeDef HAL_DMA_Init( DMA_HandleTypeDef *hdma );
+void HAL_UARTEx_RxEventCallback( UART_HandleTypeDef *huart, uint16_t Size );
+void HAL_UART_ErrorCallback( UART_HandleTypeDef *huart );
+
+void MX_DMA_Init( void );
+void MX_USART1_UART_Init( void );
+void MX_USART2_UART_Init( void );
+void Error_Handler( void );
+void NVIC_SystemReset( void ) __attribute__( ( noreturn ) );
+
+#endif // __MAIN_H__
@@ -0,0 +1,12 @@
+/*!
+ * \file      platform.h
+ *
+ * \brief     Platform header of the AT application host build
+ */
+#ifndef __PLATFORM_H__
+#define __PLATFORM_H__
+
+#include <stdbool.h>
+#include "main.h"
+
+#endif // __PLATFORM_H__
@@ -0,0 +1,21 @@
+/*!
+ * \file      usart_if.h
+ *
+ * \brief     UART interface of the AT application host build
+ */
+#ifndef __USART_IF_H__
+#define __USART_IF_H__
+
+#include "stm32_adv_trace.h"
+#include "main.h"
+
+#define USE_USB_SERIAL
+
+UTIL_ADV_TRACE_Status_t vcom_Init( void ( *cb )( void * ) );
+UTIL_ADV_TRACE_Status_t vcom_ReceiveInit( void ( *RxCb )( uint8_t *rxChar, uint16_t size, uint8_t error ) );
+UTIL_ADV_TRACE_Status_t vcom_DeInit( void );
+void vcom_Trace( uint8_t *p_data, uint16_t size );
+UTIL_ADV_TRACE_Status_t vcom_Trace_DMA( uint8_t *p_data, uint16_t size );
+void vcom_Resume( void );
+
+#endif // __USART_IF_H__
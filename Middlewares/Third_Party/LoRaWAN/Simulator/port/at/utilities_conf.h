@@ -0,0 +1,56 @@
+/*!
+ * \file      utilities_conf.h
+ *
+ * \brief     Utilities configuration of the AT application host build
+ */
+#ifndef __UTILITIES_CONF_H__
+#define __UTILITIES_CONF_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#define VLEVEL_OFF                                  0
+#define VLEVEL_ALWAYS                               0
+#define VLEVEL_L                                    1
+#define VLEVEL_M                                    2
+#define VLEVEL_H                                    3
+
+#define TS_OFF                                      0
+#define TS_ON                                       1
+
+#define T_REG_OFF                                   0
+
+#define UTIL_PLACE_IN_SECTION( __x__ )
+#undef ALIGN
+#define ALIGN( n )                                  __attribute__( ( aligned( n ) ) )
+
+#define UTILS_INIT_CRITICAL_SECTION( )
+#define UTILS_ENTER_CRITICAL_SECTION( )
+#define UTILS_EXIT_CRITICAL_SECTION( )
+
+#define UTIL_MEM_set_8( dest, value, size )         memset( ( dest ), ( value ), ( size ) )
+#define UTIL_MEM_cpy_8( dest, src, size )           memcpy( ( dest ), ( src ), ( size ) )
+
+#define UTIL_SEQ_INIT_CRITICAL_SECTION( )
+#define UTIL_SEQ_ENTER_CRITICAL_SECTION( )
+#define UTIL_SEQ_EXIT_CRITICAL_SECTION( )
+#define UTIL_SEQ_MEMSET8( dest, value, size )       memset( ( dest ), ( value ), ( size ) )
+
+#define UTIL_TIMER_INIT_CRITICAL_SECTION( )
+#define UTIL_TIMER_ENTER_CRITICAL_SECTION( )
+#define UTIL_TIMER_EXIT_CRITICAL_SECTION( )
+
+#define UTIL_ADV_TRACE_CONDITIONNAL
+#define UTIL_ADV_TRACE_UNCHUNK_MODE
+#define UTIL_ADV_TRACE_DEBUG( ... )
+#define UTIL_ADV_TRACE_INIT_CRITICAL_SECTION( )
+#define UTIL_ADV_TRACE_ENTER_CRITICAL_SECTION( )
+#define UTIL_ADV_TRACE_EXIT_CRITICAL_SECTION( )
+#define UTIL_ADV_TRACE_TMP_BUF_SIZE                 ( 512U )
+#define UTIL_ADV_TRACE_TMP_MAX_TIMESTMAP_SIZE       ( 15U )
+#define UTIL_ADV_TRACE_FIFO_SIZE                    ( 1024U )
+#define UTIL_ADV_TRACE_MEMSET8( dest, value, size ) memset( ( dest ), ( value ), ( size ) )
+#define UTIL_ADV_TRACE_VSNPRINTF( ... )             vsnprintf( __VA_ARGS__ )
+
+#endif // __UTILITIES_CONF_H__
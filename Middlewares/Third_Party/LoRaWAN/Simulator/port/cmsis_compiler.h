@@ -0,0 +1,11 @@
+/*!
+ * \file      cmsis_compiler.h
+ *
+ * \brief     Host replacement of the CMSIS compiler header for the host builds
+ */
+#ifndef __CMSIS_COMPILER_H
+#define __CMSIS_COMPILER_H
+
+#define __STATIC_INLINE                             static inline
+
+#endif // __CMSIS_COMPILER_H
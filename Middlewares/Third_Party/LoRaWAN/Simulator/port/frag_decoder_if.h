@@ -0,0 +1,22 @@
+/*!
+ * \file      frag_decoder_if.h
+ *
+ * \brief     Fragmentation decoder sizes of the host network simulator
+ *
+ * \details   fragbench overrides them with the largest configuration of
+ *            frag_decoder_if_template.h
+ */
+#ifndef __FRAG_DECODER_IF_H__
+#define __FRAG_DECODER_IF_H__
+
+#ifndef FRAG_MAX_NB
+#define FRAG_MAX_NB                                 160
+#endif
+#ifndef FRAG_MAX_SIZE
+#define FRAG_MAX_SIZE                               200
+#endif
+#ifndef FRAG_MAX_REDUNDANCY
+#define FRAG_MAX_REDUNDANCY                         80
+#endif
+
+#endif // __FRAG_DECODER_IF_H__
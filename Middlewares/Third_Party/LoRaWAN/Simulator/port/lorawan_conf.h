@@ -0,0 +1,27 @@
+/*!
+ * \file      lorawan_conf.h
+ *
+ * \brief     LoRaWAN middleware configuration of the host builds
+ */
+#ifndef __LORAWAN_CONF_H__
+#define __LORAWAN_CONF_H__
+
+#define REGION_EU868
+
+#define HYBRID_ENABLED                              0
+#define KEY_EXTRACTABLE                             1
+/* nvmtest builds the context management with 1 */
+#ifndef CONTEXT_MANAGEMENT_ENABLED
+#define CONTEXT_MANAGEMENT_ENABLED                  0
+#endif
+#define LORAMAC_CLASSB_ENABLED                      0
+#define LORAMAC_PROFILE_ENABLED                     1
+#define LORAMAC_LINK_QUALITY_ENABLED                1
+#define LORAMAC_ENERGY_ENABLED                      1
+#define LORAMAC_CLASSB_BEACON_SEARCH_ENABLED        1
+
+/* the host builds are single threaded */
+#define CRITICAL_SECTION_BEGIN( )
+#define CRITICAL_SECTION_END( )
+
+#endif // __LORAWAN_CONF_H__
@@ -0,0 +1,11 @@
+/*!
+ * \file      mw_log_conf.h
+ *
+ * \brief     Middleware traces are not printed by the host builds
+ */
+#ifndef __MW_LOG_CONF_H__
+#define __MW_LOG_CONF_H__
+
+#define MW_LOG( TS, VL, ... )
+
+#endif // __MW_LOG_CONF_H__
@@ -0,0 +1,33 @@
+/*!
+ * \file      radio_conf.h
+ *
+ * \brief     Radio configuration of the host tests of the radio driver and
+ *            of its firmware helpers, the SUBGHZ peripheral is not simulated
+ */
+#ifndef __RADIO_CONF_H__
+#define __RADIO_CONF_H__
+
+#include <string.h>
+
+#include "mw_log_conf.h"
+
+#define XTAL_FREQ                                   ( 32000000UL )
+
+#define RF_WAKEUP_TIME                              ( 1UL )
+
+#define RADIO_DELAY_MS( ms )
+
+#define RADIO_MEMSET8( dest, value, size )          memset( dest, value, size )
+
+#define RADIO_MEMCPY8( dest, src, size )            memcpy( dest, src, size )
+
+#define DBG_GPIO_RADIO_RX( set_rst )
+
+#define DBG_GPIO_RADIO_TX( set_rst )
+
+/*!
+ * Device revision read by the long packet mode, first supported one
+ */
+#define LL_DBGMCU_GetRevisionID( )                  ( 0x1003U )
+
+#endif // __RADIO_CONF_H__
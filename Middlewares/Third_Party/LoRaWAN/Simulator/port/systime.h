@@ -0,0 +1,11 @@
+/*!
+ * \file      systime.h
+ *
+ * \brief     System time wrapper of the host builds
+ */
+#ifndef __SYSTIME_H__
+#define __SYSTIME_H__
+
+#include "stm32_systime.h"
+
+#endif // __SYSTIME_H__
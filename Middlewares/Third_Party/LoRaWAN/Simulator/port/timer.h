@@ -0,0 +1,26 @@
+/*!
+ * \file      timer.h
+ *
+ * \brief     Timer wrapper of the host builds
+ *
+ * \details   lorasim provides the timer server itself on its event queue,
+ *            rxbench links the timer server with a host timer driver.
+ */
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#include "stm32_timer.h"
+
+#define TIMERTIME_T_MAX                             ( ( uint32_t )~0 )
+
+#define TimerTime_t                                 UTIL_TIMER_Time_t
+#define TimerEvent_t                                UTIL_TIMER_Object_t
+
+#define TimerInit( HANDLE, CB )                     UTIL_TIMER_Create( HANDLE, TIMERTIME_T_MAX, UTIL_TIMER_ONESHOT, CB, NULL )
+#define TimerSetValue( HANDLE, TIMEOUT )            UTIL_TIMER_SetPeriod( HANDLE, TIMEOUT )
+#define TimerStart( HANDLE )                        UTIL_TIMER_Start( HANDLE )
+#define TimerStop( HANDLE )                         UTIL_TIMER_Stop( HANDLE )
+#define TimerGetCurrentTime                         UTIL_TIMER_GetCurrentTime
+#define TimerGetElapsedTime                         UTIL_TIMER_GetElapsedTime
+
+#endif // __TIMER_H__
@@ -0,0 +1,23 @@
+/*!
+ * \file      utilities_conf.h
+ *
+ * \brief     Utilities configuration of the host builds
+ */
+#ifndef __UTILITIES_CONF_H__
+#define __UTILITIES_CONF_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#define UTILS_INIT_CRITICAL_SECTION( )
+#define UTILS_ENTER_CRITICAL_SECTION( )
+#define UTILS_EXIT_CRITICAL_SECTION( )
+
+#define UTIL_MEM_set_8( dest, value, size )         memset( ( dest ), ( value ), ( size ) )
+#define UTIL_MEM_cpy_8( dest, src, size )           memcpy( ( dest ), ( src ), ( size ) )
+
+#define UTIL_TIMER_INIT_CRITICAL_SECTION( )
+#define UTIL_TIMER_ENTER_CRITICAL_SECTION( )
+#define UTIL_TIMER_EXIT_CRITICAL_SECTION( )
+
+#endif // __UTILITIES_CONF_H__
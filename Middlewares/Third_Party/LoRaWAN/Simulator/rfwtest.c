@@ -0,0 +1,413 @@
+/*!
+ * \file      rfwtest.c
+ *
+ * \brief     Host test of the radio firmware whitening and CRC
+ *
+ * \details   radio_fw.c of the SubGHz_Phy middleware is included to reach
+ *            RFW_WhiteRun, RFW_CrcRun and the byte CRC tables. They are
+ *            checked against the bit per bit LFSRs they replaced, for random
+ *            buffers, whitening seeds, CRC seeds and polynomials, cut in
+ *            random chunks as the long packet Tx and Rx processes do.
+ *
+ *            With -b the processing time of a 128 bytes chunk, the one of
+ *            the long packet timer interrupt, is measured for both.
+ *
+ *            Usage: rfwtest [-b repeat]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "radio_fw.c"
+
+#define CHECK( cond )                                                         \
+    do                                                                        \
+    {                                                                         \
+        if( !( cond ) )                                                       \
+        {                                                                     \
+            printf( "FAIL %s line %d: %s\n", __func__, __LINE__, #cond );     \
+            return false;                                                     \
+        }                                                                     \
+    }while( 0 )
+
+typedef struct RfwTestCase_s
+{
+    const char *Name;
+    bool ( *Run )( void );
+}RfwTestCase_t;
+
+/*!
+ * Longest packet of the cases, several periods of the whitening keystream
+ */
+#define RFWTEST_PACKET_MAX                          3000
+
+/*!
+ * Random packets of each case
+ */
+#define RFWTEST_PACKETS                             2000
+
+/*!
+ * Chunk of the long packet timer interrupt [bytes]
+ */
+#define RFWTEST_CHUNK                               LONGPACKET_CHUNK_LENGTH_BYTES
+
+/*!
+ * Polynomials: the two with a table and one computed bit per bit
+ */
+static const uint16_t Polynomials[] = { CRC_POLYNOMIAL_IBM, CRC_POLYNOMIAL_CCITT, 0x3D65 };
+
+/*!
+ * Whitening seeds: the default one, the 9 bits limits, and wider ones
+ */
+static const uint16_t WhiteSeeds[] = { 0x01FF, 0x0000, 0x0001, 0x0100, 0x0155, 0x0200, 0x8000, 0xFFFF };
+
+static uint32_t Rng = 1;
+
+static uint32_t Random( void )
+{
+    Rng ^= Rng << 13;
+    Rng ^= Rng >> 17;
+    Rng ^= Rng << 5;
+    return Rng;
+}
+
+/*
+ *=============================================================================
+ * The radio and the timers are not used by the whitening and the CRC
+ *=============================================================================
+ */
+
+void SUBGRF_GetCFO( uint32_t BitRate, int32_t *Cfo )
+{
+    *Cfo = 0;
+}
+
+void SUBGRF_ReadBuffer( uint8_t offset, uint8_t *buffer, uint8_t size )
+{
+}
+
+uint8_t SUBGRF_ReadRegister( uint16_t address )
+{
+    return 0;
+}
+
+void SUBGRF_SendPayload( uint8_t *payload, uint8_t size, uint32_t timeout )
+{
+}
+
+void SUBGRF_SetDioIrqParams( uint16_t irqMask, uint16_t dio1Mask, uint16_t dio2Mask, uint16_t dio3Mask )
+{
+}
+
+void SUBGRF_SetRx( uint32_t timeout )
+{
+}
+
+void SUBGRF_SetRxBoosted( uint32_t timeout )
+{
+}
+
+void SUBGRF_SetStandby( RadioStandbyModes_t mode )
+{
+}
+
+void SUBGRF_SetSwitch( uint8_t paSelect, RFState_t rxtx )
+{
+}
+
+void SUBGRF_WriteBuffer( uint8_t offset, uint8_t *buffer, uint8_t size )
+{
+}
+
+void SUBGRF_WriteRegister( uint16_t address, uint8_t data )
+{
+}
+
+UTIL_TIMER_Status_t UTIL_TIMER_Create( UTIL_TIMER_Object_t *TimerObject, uint32_t PeriodValue, UTIL_TIMER_Mode_t Mode,
+                                       void ( *Callback )( void * ), void *Argument )
+{
+    return UTIL_TIMER_OK;
+}
+
+UTIL_TIMER_Time_t UTIL_TIMER_GetCurrentTime( void )
+{
+    return 0;
+}
+
+UTIL_TIMER_Time_t UTIL_TIMER_GetElapsedTime( UTIL_TIMER_Time_t past )
+{
+    return 0;
+}
+
+UTIL_TIMER_Status_t UTIL_TIMER_SetPeriod( UTIL_TIMER_Object_t *TimerObject, uint32_t NewPeriodValue )
+{
+    return UTIL_TIMER_OK;
+}
+
+UTIL_TIMER_Status_t UTIL_TIMER_Start( UTIL_TIMER_Object_t *TimerObject )
+{
+    return UTIL_TIMER_OK;
+}
+
+UTIL_TIMER_Status_t UTIL_TIMER_Stop( UTIL_TIMER_Object_t *TimerObject )
+{
+    return UTIL_TIMER_OK;
+}
+
+/*
+ *=============================================================================
+ * Bit per bit references
+ *=============================================================================
+ */
+
+/*!
+ * \brief 9 bits whitening LFSR, stepped 8 times per byte
+ */
+static void RefWhiteRun( uint16_t *state, uint8_t *payload, uint32_t size )
+{
+    uint16_t lfsr = *state;
+
+    for( uint32_t n = 0; n < size; n++ )
+    {
+        payload[n] ^= lfsr & 0xFF;
+        for( uint8_t bit = 0; bit < 8; bit++ )
+        {
+            uint8_t msb = ( ( lfsr >> 5 ) & 0x1 ) ^ ( lfsr & 0x1 );
+
+            lfsr = ( msb << 8 ) | ( lfsr >> 1 );
+        }
+    }
+    *state = lfsr;
+}
+
+/*!
+ * \brief CRC shifted one bit at a time, msb first
+ */
+static uint16_t RefCrcRun( uint16_t crc, const uint8_t *payload, uint32_t size, uint16_t polynomial )
+{
+    for( uint32_t n = 0; n < size; n++ )
+    {
+        uint8_t data = payload[n];
+
+        for( uint8_t bit = 0; bit < 8; bit++ )
+        {
+            if( ( ( ( crc & 0x8000 ) >> 8 ) ^ ( data & 0x80 ) ) != 0 )
+            {
+                crc = ( crc << 1 ) ^ polynomial;
+            }
+            else
+            {
+                crc <<= 1;
+            }
+            data <<= 1;
+        }
+    }
+    return crc;
+}
+
+static void RandomBuffer( uint8_t *buffer, uint32_t size )
+{
+    for( uint32_t n = 0; n < size; n++ )
+    {
+        buffer[n] = ( uint8_t )Random( );
+    }
+}
+
+/*!
+ * Every entry of the byte tables
+ */
+static bool Tables( void )
+{
+    for( uint32_t n = 0; n < 256; n++ )
+    {
+        uint8_t data = ( uint8_t )n;
+
+        CHECK( CrcTableIbm[n] == RefCrcRun( 0, &data, 1, CRC_POLYNOMIAL_IBM ) );
+        CHECK( CrcTableCcitt[n] == RefCrcRun( 0, &data, 1, CRC_POLYNOMIAL_CCITT ) );
+        CHECK( RFW_CrcRun1Byte( 0, data, CRC_POLYNOMIAL_IBM ) == CrcTableIbm[n] );
+    }
+    return true;
+}
+
+/*!
+ * Whitening of random packets in random chunks
+ */
+static bool Whitening( void )
+{
+    static uint8_t packet[RFWTEST_PACKET_MAX];
+    static uint8_t reference[RFWTEST_PACKET_MAX];
+    static uint8_t original[RFWTEST_PACKET_MAX];
+
+    Rng = 1;
+    for( uint32_t p = 0; p < RFWTEST_PACKETS; p++ )
+    {
+        uint16_t seed = ( p < ( sizeof( WhiteSeeds ) / sizeof( WhiteSeeds[0] ) ) ) ? WhiteSeeds[p] : ( uint16_t )Random( );
+        uint32_t size = 1 + Random( ) % RFWTEST_PACKET_MAX;
+        uint16_t state = seed;
+
+        RandomBuffer( original, size );
+        memcpy( packet, original, size );
+        memcpy( reference, original, size );
+
+        RFW_WhiteInitState( &RFWPacket.Init, seed );
+        RFW_WhiteSetState( &RFWPacket );
+        for( uint32_t offset = 0; offset < size; )
+        {
+            uint32_t chunk = ( ( Random( ) & 3 ) == 0 ) ? RFWTEST_CHUNK : ( Random( ) % 300 );
+
+            if( chunk > ( size - offset ) )
+            {
+                chunk = size - offset;
+            }
+            RFW_WhiteRun( &RFWPacket, &packet[offset], chunk );
+            RefWhiteRun( &state, &reference[offset], chunk );
+            offset += chunk;
+        }
+        CHECK( memcmp( packet, reference, size ) == 0 );
+
+        // De-whitening from the seed restores the packet
+        RFW_WhiteSetState( &RFWPacket );
+        RFW_WhiteRun( &RFWPacket, packet, size );
+        CHECK( memcmp( packet, original, size ) == 0 );
+    }
+    return true;
+}
+
+/*!
+ * CRC of random packets in random chunks
+ */
+static bool Crc( void )
+{
+    static uint8_t packet[RFWTEST_PACKET_MAX];
+
+    Rng = 2;
+    for( uint32_t p = 0; p < RFWTEST_PACKETS; p++ )
+    {
+        uint16_t polynomial = Polynomials[p % ( sizeof( Polynomials ) / sizeof( Polynomials[0] ) )];
+        uint16_t seed = ( p < 6 ) ? ( ( p < 3 ) ? 0x0000 : 0xFFFF ) : ( uint16_t )Random( );
+        RADIO_FSK_CrcTypes_t type = ( ( Random( ) & 1 ) != 0 ) ? RADIO_FSK_CRC_2_BYTES_IBM : RADIO_FSK_CRC_2_BYTES_CCIT;
+        uint32_t size = 1 + Random( ) % RFWTEST_PACKET_MAX;
+        uint16_t crc = seed;
+        uint8_t result[2];
+
+        RandomBuffer( packet, size );
+        RFW_CrcInitState( &RFWPacket.Init, polynomial, seed, type );
+        CHECK( ( RFWPacket.Init.CrcTable != NULL ) == ( polynomial != 0x3D65 ) );
+        RFW_CrcSetState( &RFWPacket );
+        for( uint32_t offset = 0; offset < size; )
+        {
+            uint32_t chunk = ( ( Random( ) & 3 ) == 0 ) ? RFWTEST_CHUNK : ( Random( ) % 300 );
+
+            if( chunk > ( size - offset ) )
+            {
+                chunk = size - offset;
+            }
+            RFW_CrcRun( &RFWPacket, &packet[offset], chunk, result );
+            crc = RefCrcRun( crc, &packet[offset], chunk, polynomial );
+            CHECK( RFWPacket.CrcLfsrState == crc );
+            offset += chunk;
+        }
+        if( type == RADIO_FSK_CRC_2_BYTES_CCIT )
+        {
+            crc = ~crc;
+        }
+        CHECK( ( result[0] == ( crc >> 8 ) ) && ( result[1] == ( crc & 0xFF ) ) );
+    }
+    return true;
+}
+
+static const RfwTestCase_t Cases[] =
+{
+    { "crc tables", Tables },
+    { "whitening, random chunks", Whitening },
+    { "crc, random chunks", Crc },
+};
+
+static uint64_t HostTimeNs( void )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( uint64_t )now.tv_sec * 1000000000 + ( uint64_t )now.tv_nsec;
+}
+
+/*!
+ * \brief Measures the whitening and the CRC of a chunk of the long packet
+ *        interrupt
+ */
+static void Bench( uint32_t repeat )
+{
+    static uint8_t chunk[RFWTEST_CHUNK];
+    volatile uint16_t sink;
+    uint16_t state = 0x01FF;
+    uint16_t crc = 0x1D0F;
+    uint8_t result[2];
+    uint64_t start;
+    double bitwise;
+    double table;
+
+    Rng = 3;
+    RandomBuffer( chunk, sizeof( chunk ) );
+    RFW_WhiteInitState( &RFWPacket.Init, 0x01FF );
+    RFW_WhiteSetState( &RFWPacket );
+    RFW_CrcInitState( &RFWPacket.Init, CRC_POLYNOMIAL_CCITT, 0x1D0F, RADIO_FSK_CRC_2_BYTES_CCIT );
+    RFW_CrcSetState( &RFWPacket );
+
+    start = HostTimeNs( );
+    for( uint32_t r = 0; r < repeat; r++ )
+    {
+        crc = RefCrcRun( crc, chunk, sizeof( chunk ), CRC_POLYNOMIAL_CCITT );
+        RefWhiteRun( &state, chunk, sizeof( chunk ) );
+    }
+    bitwise = ( double )( HostTimeNs( ) - start ) / repeat;
+    sink = crc ^ state;
+
+    start = HostTimeNs( );
+    for( uint32_t r = 0; r < repeat; r++ )
+    {
+        RFW_CrcRun( &RFWPacket, chunk, sizeof( chunk ), result );
+        RFW_WhiteRun( &RFWPacket, chunk, sizeof( chunk ) );
+    }
+    table = ( double )( HostTimeNs( ) - start ) / repeat;
+    sink = RFWPacket.CrcLfsrState;
+    ( void )sink;
+
+    printf( "%u bytes chunk     : bit per bit %.0f ns, keystream and table %.0f ns\n", ( unsigned )RFWTEST_CHUNK,
+            bitwise, table );
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t repeat = 0;
+    int status = 0;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "b:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+            case 'b': repeat = ( uint32_t )strtoul( optarg, NULL, 0 ); break;
+            default:
+                fprintf( stderr, "usage: rfwtest [-b repeat]\n" );
+                return 2;
+        }
+    }
+
+    for( uint32_t n = 0; n < sizeof( Cases ) / sizeof( Cases[0] ); n++ )
+    {
+        bool passed = Cases[n].Run( );
+
+        printf( "%-40s %s\n", Cases[n].Name, ( passed == true ) ? "ok" : "FAILED" );
+        if( passed == false )
+        {
+            status = 1;
+        }
+    }
+    if( repeat != 0 )
+    {
+        Bench( repeat );
+    }
+    return status;
+}
@@ -0,0 +1,568 @@
+/*!
+ * \file      rxbench.c
+ *
+ * \brief     Host regression benchmark of the downlink processing stages
+ *
+ * \details   Runs the real LoRaMac.c, LoRaMacCrypto.c and soft secure
+ *            element on the host with the LoRaMacProfile instrumentation
+ *            enabled. Every iteration injects a valid ABP data downlink
+ *            (FOpts MAC command and encrypted application payload) through
+ *            the radio RX done event and processes it with LoRaMacProcess,
+ *            the MCPS indication plays the role of LmHandler.
+ *
+ *            The median of every stage is compared with its budget, the
+ *            benchmark fails when one stage exceeds it.
+ *
+ *            Usage: rxbench [-n iterations] [-b budget file] [-w budget file]
+ *              -b  checks the medians against the budget file
+ *              -w  records a new budget file from the current medians
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "utilities.h"
+#include "systime.h"
+#include "radio.h"
+#include "LoRaMac.h"
+#include "LoRaMacProfile.h"
+#include "lorawan_aes.h"
+#include "cmac.h"
+
+#define RXBENCH_DEFAULT_ITERATIONS                  2000
+#define RXBENCH_WARMUP_ITERATIONS                   100
+#define RXBENCH_DEV_ADDR                            0x0100000A
+#define RXBENCH_FPORT                               2
+#define RXBENCH_PAYLOAD_SIZE                        48
+
+/*!
+ * Recorded budget: 4 times the median with at least 2 us of headroom, the
+ * host timing of a shared machine is noisy
+ */
+#define RXBENCH_BUDGET_FACTOR                       4
+#define RXBENCH_BUDGET_MIN_HEADROOM                 2000
+
+/*!
+ * Session keys of se-identity.h, used by the network server side
+ */
+static const uint8_t SessionKey[16] =
+{
+    0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C
+};
+
+static RadioEvents_t *RadioEvents;
+static uint8_t Frame[64];
+static uint8_t FrameSize;
+static uint8_t Payload[RXBENCH_PAYLOAD_SIZE];
+static uint32_t Indications;
+static uint32_t PayloadErrors;
+
+/*
+ *=============================================================================
+ * Host timer driver and radio
+ *=============================================================================
+ */
+
+static uint32_t HostTimeMs( void )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( uint32_t )( ( uint64_t )now.tv_sec * 1000 + ( uint64_t )now.tv_nsec / 1000000 );
+}
+
+static UTIL_TIMER_Status_t HostTimerStatusOk( void )
+{
+    return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t HostTimerStart( uint32_t timeout )
+{
+    return UTIL_TIMER_OK;
+}
+
+static uint32_t HostTimerContext;
+
+static uint32_t HostTimerSetContext( void )
+{
+    HostTimerContext = HostTimeMs( );
+    return HostTimerContext;
+}
+
+static uint32_t HostTimerGetContext( void )
+{
+    return HostTimerContext;
+}
+
+static uint32_t HostTimerElapsed( void )
+{
+    return HostTimeMs( ) - HostTimerContext;
+}
+
+static uint32_t HostTimerMinimumTimeout( void )
+{
+    return 1;
+}
+
+static uint32_t HostTimerIdentity( uint32_t value )
+{
+    return value;
+}
+
+const UTIL_TIMER_Driver_s UTIL_TimerDriver =
+{
+    HostTimerStatusOk,
+    HostTimerStatusOk,
+    HostTimerStart,
+    HostTimerStatusOk,
+    HostTimerSetContext,
+    HostTimerGetContext,
+    HostTimerElapsed,
+    HostTimeMs,
+    HostTimerMinimumTimeout,
+    HostTimerIdentity,
+    HostTimerIdentity,
+};
+
+static uint32_t HostSysTimeGetCalendarTime( uint16_t *subSeconds )
+{
+    uint32_t now = HostTimeMs( );
+
+    *subSeconds = ( uint16_t )( now % 1000 );
+    return now / 1000;
+}
+
+static void HostSysTimeBackup( uint32_t value )
+{
+}
+
+static uint32_t HostSysTimeRestore( void )
+{
+    return 0;
+}
+
+const UTIL_SYSTIM_Driver_s UTIL_SYSTIMDriver =
+{
+    HostSysTimeBackup,
+    HostSysTimeRestore,
+    HostSysTimeBackup,
+    HostSysTimeRestore,
+    HostSysTimeGetCalendarTime,
+};
+
+static void HostRadioInit( RadioEvents_t *events )
+{
+    RadioEvents = events;
+}
+
+static RadioState_t HostRadioGetStatus( void )
+{
+    return RF_IDLE;
+}
+
+static void HostRadioSetChannel( uint32_t freq )
+{
+}
+
+static uint32_t HostRadioRandom( void )
+{
+    return 0x12345678;
+}
+
+static void HostRadioSetRxConfig( RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                  uint32_t bandwidthAfc, uint16_t preambleLen, uint16_t symbTimeout, bool fixLen,
+                                  uint8_t payloadLen, bool crcOn, bool freqHopOn, uint8_t hopPeriod,
+                                  bool iqInverted, bool rxContinuous )
+{
+}
+
+static void HostRadioSetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev, uint32_t bandwidth,
+                                  uint32_t datarate, uint8_t coderate, uint16_t preambleLen, bool fixLen,
+                                  bool crcOn, bool freqHopOn, uint8_t hopPeriod, bool iqInverted, uint32_t timeout )
+{
+}
+
+static bool HostRadioCheckRfFrequency( uint32_t frequency )
+{
+    return true;
+}
+
+static uint32_t HostRadioTimeOnAir( RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                    uint16_t preambleLen, bool fixLen, uint8_t payloadLen, bool crcOn )
+{
+    return 100;
+}
+
+static void HostRadioSend( uint8_t *buffer, uint8_t size )
+{
+}
+
+static void HostRadioNop( void )
+{
+}
+
+static void HostRadioRx( uint32_t timeout )
+{
+}
+
+static void HostRadioSetMaxPayloadLength( RadioModems_t modem, uint8_t max )
+{
+}
+
+static void HostRadioSetPublicNetwork( bool enable )
+{
+}
+
+static uint32_t HostRadioGetWakeupTime( void )
+{
+    return 3;
+}
+
+const struct Radio_s Radio =
+{
+    .Init = HostRadioInit,
+    .GetStatus = HostRadioGetStatus,
+    .SetChannel = HostRadioSetChannel,
+    .Random = HostRadioRandom,
+    .SetRxConfig = HostRadioSetRxConfig,
+    .SetTxConfig = HostRadioSetTxConfig,
+    .CheckRfFrequency = HostRadioCheckRfFrequency,
+    .TimeOnAir = HostRadioTimeOnAir,
+    .Send = HostRadioSend,
+    .Sleep = HostRadioNop,
+    .Standby = HostRadioNop,
+    .Rx = HostRadioRx,
+    .SetMaxPayloadLength = HostRadioSetMaxPayloadLength,
+    .SetPublicNetwork = HostRadioSetPublicNetwork,
+    .GetWakeupTime = HostRadioGetWakeupTime,
+};
+
+/*
+ *=============================================================================
+ * MAC primitives and callbacks
+ *=============================================================================
+ */
+
+static void McpsConfirm( McpsConfirm_t *mcpsConfirm )
+{
+}
+
+static void McpsIndication( McpsIndication_t *mcpsIndication, LoRaMacRxStatus_t *rxStatus )
+{
+    if( mcpsIndication->Status != LORAMAC_EVENT_INFO_STATUS_OK )
+    {
+        return;
+    }
+    LORAMAC_PROFILE_END( LORAMAC_PROFILE_INDICATION );
+    Indications++;
+    if( ( mcpsIndication->Port != RXBENCH_FPORT ) || ( mcpsIndication->BufferSize != RXBENCH_PAYLOAD_SIZE ) ||
+        ( memcmp( mcpsIndication->Buffer, Payload, RXBENCH_PAYLOAD_SIZE ) != 0 ) )
+    {
+        PayloadErrors++;
+    }
+}
+
+static void MlmeConfirm( MlmeConfirm_t *mlmeConfirm )
+{
+}
+
+static void MlmeIndication( MlmeIndication_t *mlmeIndication, LoRaMacRxStatus_t *rxStatus )
+{
+}
+
+static uint8_t GetBatteryLevel( void )
+{
+    return 254;
+}
+
+static uint16_t GetTemperatureLevel( void )
+{
+    return 25;
+}
+
+static void GetUniqueId( uint8_t *id )
+{
+    memset( id, 0x5A, 8 );
+}
+
+static void NvmDataChange( uint16_t notifyFlags )
+{
+}
+
+static void MacProcessNotify( void )
+{
+}
+
+static LoRaMacPrimitives_t MacPrimitives =
+{
+    .MacMcpsConfirm = McpsConfirm,
+    .MacMcpsIndication = McpsIndication,
+    .MacMlmeConfirm = MlmeConfirm,
+    .MacMlmeIndication = MlmeIndication,
+};
+
+static LoRaMacCallback_t MacCallbacks =
+{
+    .GetBatteryLevel = GetBatteryLevel,
+    .GetTemperatureLevel = GetTemperatureLevel,
+    .GetUniqueId = GetUniqueId,
+    .NvmDataChange = NvmDataChange,
+    .MacProcessNotify = MacProcessNotify,
+};
+
+/*
+ *=============================================================================
+ * Network server side frame builder, LoRaWAN 1.0.x
+ *=============================================================================
+ */
+
+static void BuildBlock( uint8_t *block, uint8_t type, uint32_t fCnt, uint8_t last )
+{
+    memset( block, 0, 16 );
+    block[0] = type;
+    block[5] = 0x01; /* downlink */
+    block[6] = ( uint8_t )RXBENCH_DEV_ADDR;
+    block[7] = ( uint8_t )( RXBENCH_DEV_ADDR >> 8 );
+    block[8] = ( uint8_t )( RXBENCH_DEV_ADDR >> 16 );
+    block[9] = ( uint8_t )( RXBENCH_DEV_ADDR >> 24 );
+    block[10] = ( uint8_t )fCnt;
+    block[11] = ( uint8_t )( fCnt >> 8 );
+    block[12] = ( uint8_t )( fCnt >> 16 );
+    block[13] = ( uint8_t )( fCnt >> 24 );
+    block[15] = last;
+}
+
+/*!
+ * \brief Builds an unconfirmed downlink carrying a DevStatusReq in FOpts and
+ *        the encrypted application payload
+ */
+static void BuildDownlink( uint32_t fCnt )
+{
+    lorawan_aes_context aes;
+    AES_CMAC_CTX cmac;
+    uint8_t block[16];
+    uint8_t stream[16];
+    uint8_t mic[16];
+    uint8_t i = 0;
+
+    for( uint8_t j = 0; j < RXBENCH_PAYLOAD_SIZE; j++ )
+    {
+        Payload[j] = ( uint8_t )( fCnt + j );
+    }
+
+    Frame[i++] = 0x60;
+    Frame[i++] = ( uint8_t )RXBENCH_DEV_ADDR;
+    Frame[i++] = ( uint8_t )( RXBENCH_DEV_ADDR >> 8 );
+    Frame[i++] = ( uint8_t )( RXBENCH_DEV_ADDR >> 16 );
+    Frame[i++] = ( uint8_t )( RXBENCH_DEV_ADDR >> 24 );
+    Frame[i++] = 0x01; /* FOptsLen */
+    Frame[i++] = ( uint8_t )fCnt;
+    Frame[i++] = ( uint8_t )( fCnt >> 8 );
+    Frame[i++] = 0x06; /* DevStatusReq */
+    Frame[i++] = RXBENCH_FPORT;
+
+    lorawan_aes_set_key( SessionKey, 16, &aes );
+    for( uint8_t j = 0; j < RXBENCH_PAYLOAD_SIZE; j++ )
+    {
+        if( ( j % 16 ) == 0 )
+        {
+            BuildBlock( block, 0x01, fCnt, ( j / 16 ) + 1 );
+            lorawan_aes_encrypt( block, stream, &aes );
+        }
+        Frame[i++] = Payload[j] ^ stream[j % 16];
+    }
+
+    BuildBlock( block, 0x49, fCnt, i );
+    AES_CMAC_Init( &cmac );
+    AES_CMAC_SetKey( &cmac, SessionKey );
+    AES_CMAC_Update( &cmac, block, 16 );
+    AES_CMAC_Update( &cmac, Frame, i );
+    AES_CMAC_Final( mic, &cmac );
+    memcpy( &Frame[i], mic, 4 );
+    FrameSize = i + 4;
+}
+
+static void MacStart( void )
+{
+    MibRequestConfirm_t mibReq;
+
+    if( LoRaMacInitialization( &MacPrimitives, &MacCallbacks, LORAMAC_REGION_EU868 ) != LORAMAC_STATUS_OK )
+    {
+        fprintf( stderr, "rxbench: LoRaMacInitialization failed\n" );
+        exit( EXIT_FAILURE );
+    }
+    mibReq.Type = MIB_DEV_ADDR;
+    mibReq.Param.DevAddr = RXBENCH_DEV_ADDR;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    mibReq.Type = MIB_ABP_LORAWAN_VERSION;
+    mibReq.Param.AbpLrWanVersion.Value = 0x01000300;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    LoRaMacStart( );
+    mibReq.Type = MIB_NETWORK_ACTIVATION;
+    mibReq.Param.NetworkActivation = ACTIVATION_TYPE_ABP;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+}
+
+/*
+ *=============================================================================
+ * Budgets
+ *=============================================================================
+ */
+
+static int CompareTicks( const void *a, const void *b )
+{
+    uint32_t x = *( const uint32_t * )a;
+    uint32_t y = *( const uint32_t * )b;
+
+    return ( x > y ) - ( x < y );
+}
+
+static bool ReadBudgets( const char *path, uint32_t *budgets )
+{
+    FILE *file = fopen( path, "r" );
+    char line[64];
+    char name[32];
+    unsigned long value;
+
+    if( file == NULL )
+    {
+        return false;
+    }
+    for( uint8_t i = 0; i < LORAMAC_PROFILE_STAGE_MAX; i++ )
+    {
+        budgets[i] = UINT32_MAX;
+    }
+    while( fgets( line, sizeof( line ), file ) != NULL )
+    {
+        if( ( line[0] == '#' ) || ( sscanf( line, "%31s %lu", name, &value ) != 2 ) )
+        {
+            continue;
+        }
+        for( uint8_t i = 0; i < LORAMAC_PROFILE_STAGE_MAX; i++ )
+        {
+            if( strcmp( name, LoRaMacProfileGetStageName( ( LoRaMacProfileStage_t )i ) ) == 0 )
+            {
+                budgets[i] = ( uint32_t )value;
+            }
+        }
+    }
+    fclose( file );
+    return true;
+}
+
+static bool WriteBudgets( const char *path, const uint32_t *medians )
+{
+    FILE *file = fopen( path, "w" );
+
+    if( file == NULL )
+    {
+        return false;
+    }
+    fprintf( file, "# rxbench stage budgets in ns, recorded by rxbench -w\n" );
+    for( uint8_t i = 0; i < LORAMAC_PROFILE_STAGE_MAX; i++ )
+    {
+        uint32_t budget = MAX( medians[i] * RXBENCH_BUDGET_FACTOR, medians[i] + RXBENCH_BUDGET_MIN_HEADROOM );
+
+        fprintf( file, "%s %u\n", LoRaMacProfileGetStageName( ( LoRaMacProfileStage_t )i ), budget );
+    }
+    fclose( file );
+    return true;
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t iterations = RXBENCH_DEFAULT_ITERATIONS;
+    const char *checkPath = NULL;
+    const char *recordPath = NULL;
+    uint32_t *samples[LORAMAC_PROFILE_STAGE_MAX];
+    uint32_t medians[LORAMAC_PROFILE_STAGE_MAX];
+    uint32_t budgets[LORAMAC_PROFILE_STAGE_MAX];
+    uint32_t fCnt = 0;
+    bool failed = false;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "n:b:w:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+            case 'n': iterations = ( uint32_t )strtoul( optarg, NULL, 0 ); break;
+            case 'b': checkPath = optarg; break;
+            case 'w': recordPath = optarg; break;
+            default:
+                fprintf( stderr, "usage: rxbench [-n iterations] [-b budget file] [-w budget file]\n" );
+                return EXIT_FAILURE;
+        }
+    }
+    if( iterations == 0 )
+    {
+        return EXIT_FAILURE;
+    }
+
+    UTIL_TIMER_Init( );
+    MacStart( );
+    for( uint8_t i = 0; i < LORAMAC_PROFILE_STAGE_MAX; i++ )
+    {
+        samples[i] = calloc( iterations, sizeof( uint32_t ) );
+    }
+
+    for( uint32_t n = 0; n < ( RXBENCH_WARMUP_ITERATIONS + iterations ); n++ )
+    {
+        BuildDownlink( ++fCnt );
+        RadioEvents->RxDone( Frame, FrameSize, -80, 8 );
+        LoRaMacProcess( );
+        if( n < RXBENCH_WARMUP_ITERATIONS )
+        {
+            continue;
+        }
+        for( uint8_t i = 0; i < LORAMAC_PROFILE_STAGE_MAX; i++ )
+        {
+            LoRaMacProfileStats_t stats;
+
+            LoRaMacProfileGetStats( ( LoRaMacProfileStage_t )i, &stats );
+            samples[i][n - RXBENCH_WARMUP_ITERATIONS] = stats.Last;
+        }
+    }
+
+    if( ( Indications != ( RXBENCH_WARMUP_ITERATIONS + iterations ) ) || ( PayloadErrors != 0 ) )
+    {
+        fprintf( stderr, "rxbench: %u of %u downlinks indicated, %u payload errors\n", Indications,
+                 RXBENCH_WARMUP_ITERATIONS + iterations, PayloadErrors );
+        return EXIT_FAILURE;
+    }
+
+    if( ( checkPath != NULL ) && ( ReadBudgets( checkPath, budgets ) == false ) )
+    {
+        fprintf( stderr, "rxbench: cannot read %s\n", checkPath );
+        return EXIT_FAILURE;
+    }
+
+    printf( "%-14s %10s %10s %10s %10s\n", "stage", "min ns", "median ns", "max ns", "budget ns" );
+    for( uint8_t i = 0; i < LORAMAC_PROFILE_STAGE_MAX; i++ )
+    {
+        LoRaMacProfileStats_t stats;
+
+        LoRaMacProfileGetStats( ( LoRaMacProfileStage_t )i, &stats );
+        qsort( samples[i], iterations, sizeof( uint32_t ), CompareTicks );
+        medians[i] = samples[i][iterations / 2];
+        printf( "%-14s %10u %10u %10u", LoRaMacProfileGetStageName( ( LoRaMacProfileStage_t )i ), stats.Min,
+                medians[i], stats.Max );
+        if( checkPath != NULL )
+        {
+            bool over = ( medians[i] > budgets[i] );
+
+            printf( " %10u%s", budgets[i], ( over == true ) ? "  OVER BUDGET" : "" );
+            failed |= over;
+        }
+        printf( "\n" );
+        free( samples[i] );
+    }
+
+    if( ( recordPath != NULL ) && ( WriteBudgets( recordPath, medians ) == false ) )
+    {
+        fprintf( stderr, "rxbench: cannot write %s\n", recordPath );
+        return EXIT_FAILURE;
+    }
+    return ( failed == true ) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,585 @@
+/*!
+ * \file      scantest.c
+ *
+ * \brief     Host test of the radio driver channel scan state machine
+ *
+ * \details   radio.c and radio_fw.c of the SubGHz_Phy middleware are
+ *            included, the SUBGHZ peripheral is replaced by a model which
+ *            reports a strong RSSI while a carrier is on the channel it is
+ *            tuned to. The timer server runs on a host driver stepped by 1
+ *            ms.
+ *
+ *            RADIO_IRQ_PROCESS is deferred as a port with a radio task
+ *            does: the interrupts only flag the processing, which the test
+ *            loop then runs through Radio.IrqProcess. Every access to the
+ *            radio and every ChannelScanDone event from the timer interrupt
+ *            is counted as a failure.
+ *
+ *            Usage: scantest
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+/*!
+ * Radio processing requested by the interrupts
+ */
+static bool IrqPending;
+
+#define RADIO_IRQ_PROCESS( )                        ( IrqPending = true )
+
+#include "radio.c"
+#include "radio_fw.c"
+
+#define CHECK( cond )                                                         \
+    do                                                                        \
+    {                                                                         \
+        if( !( cond ) )                                                       \
+        {                                                                     \
+            printf( "FAIL %s line %d: %s\n", __func__, __LINE__, #cond );     \
+            return false;                                                     \
+        }                                                                     \
+    }while( 0 )
+
+typedef struct ScanTestCase_s
+{
+    const char *Name;
+    bool ( *Run )( void );
+}ScanTestCase_t;
+
+#define SCANTEST_BANDWIDTH                          200000
+#define SCANTEST_RSSI_THRESH                        -80
+#define SCANTEST_RSSI_CARRIER                       -50
+#define SCANTEST_RSSI_NOISE                         -120
+#define SCANTEST_SENSE_TIME                         5
+#define SCANTEST_MAX_CARRIERS                       4
+
+/*!
+ * Longest scan of the cases [ms]
+ */
+#define SCANTEST_TIMEOUT                            1000
+
+/*!
+ * Carrier on a channel, times relative to the scan start [ms]
+ */
+typedef struct ScanTestCarrier_s
+{
+    uint32_t Frequency;
+    uint32_t Start;
+    uint32_t Stop;
+}ScanTestCarrier_t;
+
+static const uint32_t Channels[] = { 868100000, 868300000, 868500000 };
+
+static ScanTestCarrier_t Carriers[SCANTEST_MAX_CARRIERS];
+static uint8_t NbCarriers;
+
+static uint32_t NowMs;
+static uint32_t ScanStart;
+static uint32_t Frequency;
+static bool InIrq;
+static uint32_t IrqAccesses;
+static DioIrqHandler DioIrq;
+
+static bool ScanDone;
+static int8_t ScanIndex;
+static uint32_t ScanDoneTime;
+static uint32_t TxDoneCount;
+
+/*!
+ * Simulated timer server alarm
+ */
+static uint32_t TimerContext;
+static uint32_t TimerAlarm;
+static bool TimerArmed;
+
+/*
+ *=============================================================================
+ * Host timer driver on the simulated time
+ *=============================================================================
+ */
+
+static uint32_t HostTicks( void )
+{
+    return NowMs;
+}
+
+static UTIL_TIMER_Status_t HostTimerStatusOk( void )
+{
+    return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t HostTimerStart( uint32_t timeout )
+{
+    TimerAlarm = TimerContext + timeout;
+    TimerArmed = true;
+    return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t HostTimerStop( void )
+{
+    TimerArmed = false;
+    return UTIL_TIMER_OK;
+}
+
+static uint32_t HostTimerSetContext( void )
+{
+    TimerContext = HostTicks( );
+    return TimerContext;
+}
+
+static uint32_t HostTimerGetContext( void )
+{
+    return TimerContext;
+}
+
+static uint32_t HostTimerElapsed( void )
+{
+    return HostTicks( ) - TimerContext;
+}
+
+static uint32_t HostTimerMinimumTimeout( void )
+{
+    return 1;
+}
+
+static uint32_t HostTimerIdentity( uint32_t value )
+{
+    return value;
+}
+
+const UTIL_TIMER_Driver_s UTIL_TimerDriver =
+{
+    HostTimerStatusOk,
+    HostTimerStatusOk,
+    HostTimerStart,
+    HostTimerStop,
+    HostTimerSetContext,
+    HostTimerGetContext,
+    HostTimerElapsed,
+    HostTicks,
+    HostTimerMinimumTimeout,
+    HostTimerIdentity,
+    HostTimerIdentity,
+};
+
+/*
+ *=============================================================================
+ * SUBGHZ model, the radio is only accessed from the process context
+ *=============================================================================
+ */
+
+static void Access( void )
+{
+    if( InIrq == true )
+    {
+        IrqAccesses++;
+    }
+}
+
+void SUBGRF_Init( DioIrqHandler dioIrq )
+{
+    DioIrq = dioIrq;
+}
+
+void SUBGRF_SetRfFrequency( uint32_t frequency )
+{
+    Access( );
+    Frequency = frequency;
+}
+
+int8_t SUBGRF_GetRssiInst( void )
+{
+    Access( );
+    for( uint8_t i = 0; i < NbCarriers; i++ )
+    {
+        if( ( Carriers[i].Frequency == Frequency ) && ( ( NowMs - ScanStart ) >= Carriers[i].Start ) &&
+            ( ( NowMs - ScanStart ) < Carriers[i].Stop ) )
+        {
+            return SCANTEST_RSSI_CARRIER;
+        }
+    }
+    return SCANTEST_RSSI_NOISE;
+}
+
+void SUBGRF_SetRx( uint32_t timeout )
+{
+    Access( );
+}
+
+void SUBGRF_SetStandby( RadioStandbyModes_t mode )
+{
+    Access( );
+}
+
+void SUBGRF_SetPacketType( RadioPacketTypes_t packetType )
+{
+    Access( );
+}
+
+void SUBGRF_SetModulationParams( ModulationParams_t *modParams )
+{
+    Access( );
+}
+
+void SUBGRF_SetPacketParams( PacketParams_t *packetParams )
+{
+    Access( );
+}
+
+RadioOperatingModes_t SUBGRF_GetOperatingMode( void )
+{
+    return MODE_STDBY_RC;
+}
+
+uint32_t SUBGRF_GetRadioWakeUpTime( void )
+{
+    return 0;
+}
+
+void SUBGRF_GetCFO( uint32_t BitRate, int32_t *Cfo )
+{
+    *Cfo = 0;
+}
+
+uint8_t SUBGRF_GetFskBandwidthRegValue( uint32_t bandwidth )
+{
+    return 0;
+}
+
+void SUBGRF_GetPacketStatus( PacketStatus_t *pktStatus )
+{
+    memset( pktStatus, 0, sizeof( PacketStatus_t ) );
+}
+
+uint8_t SUBGRF_GetPayload( uint8_t *payload, uint8_t *size, uint8_t maxSize )
+{
+    *size = 0;
+    return 0;
+}
+
+uint32_t SUBGRF_GetRandom( void )
+{
+    return 0;
+}
+
+void SUBGRF_ReadBuffer( uint8_t offset, uint8_t *buffer, uint8_t size )
+{
+}
+
+uint8_t SUBGRF_ReadRegister( uint16_t address )
+{
+    return 0;
+}
+
+void SUBGRF_ReadRegisters( uint16_t address, uint8_t *buffer, uint16_t size )
+{
+}
+
+void SUBGRF_SendPayload( uint8_t *payload, uint8_t size, uint32_t timeout )
+{
+}
+
+void SUBGRF_SetBufferBaseAddress( uint8_t txBaseAddress, uint8_t rxBaseAddress )
+{
+}
+
+void SUBGRF_SetCad( void )
+{
+}
+
+void SUBGRF_SetCrcPolynomial( uint16_t polynomial )
+{
+}
+
+void SUBGRF_SetDioIrqParams( uint16_t irqMask, uint16_t dio1Mask, uint16_t dio2Mask, uint16_t dio3Mask )
+{
+}
+
+void SUBGRF_SetLoRaSymbNumTimeout( uint8_t symbNum )
+{
+}
+
+void SUBGRF_SetOperatingModeHandler( OperatingModeHandler handler )
+{
+}
+
+void SUBGRF_SetRegulatorMode( void )
+{
+}
+
+uint8_t SUBGRF_SetRfTxPower( int8_t power )
+{
+    return RFO_LP;
+}
+
+void SUBGRF_SetRxBoosted( uint32_t timeout )
+{
+}
+
+void SUBGRF_SetRxDutyCycle( uint32_t rxTime, uint32_t sleepTime )
+{
+}
+
+void SUBGRF_SetSleep( SleepParams_t sleepConfig )
+{
+}
+
+void SUBGRF_SetStopRxTimerOnPreambleDetect( bool enable )
+{
+}
+
+void SUBGRF_SetSwitch( uint8_t paSelect, RFState_t rxtx )
+{
+}
+
+uint8_t SUBGRF_SetSyncWord( uint8_t *syncWord )
+{
+    return 0;
+}
+
+void SUBGRF_SetTx( uint32_t timeout )
+{
+}
+
+void SUBGRF_SetTxContinuousWave( void )
+{
+}
+
+void SUBGRF_SetTxInfinitePreamble( void )
+{
+}
+
+void SUBGRF_SetTxParams( uint8_t paSelect, int8_t power, RadioRampTimes_t rampTime )
+{
+}
+
+void SUBGRF_SetWhiteningSeed( uint16_t seed )
+{
+}
+
+void SUBGRF_WriteBuffer( uint8_t offset, uint8_t *buffer, uint8_t size )
+{
+}
+
+void SUBGRF_WriteRegister( uint16_t address, uint8_t data )
+{
+}
+
+void SUBGRF_WriteRegisters( uint16_t address, uint8_t *buffer, uint16_t size )
+{
+}
+
+/*
+ *=============================================================================
+ * Radio events and scan runner
+ *=============================================================================
+ */
+
+static void OnTxDone( void )
+{
+    TxDoneCount++;
+}
+
+static void OnChannelScanDone( int8_t index )
+{
+    Access( );
+    ScanDone = true;
+    ScanIndex = index;
+    ScanDoneTime = NowMs - ScanStart;
+}
+
+static RadioEvents_t Events =
+{
+    .TxDone = OnTxDone,
+    .ChannelScanDone = OnChannelScanDone,
+};
+
+/*!
+ * \brief Runs the deferred radio processing the interrupts requested
+ */
+static void Process( void )
+{
+    if( IrqPending == true )
+    {
+        IrqPending = false;
+        Radio.IrqProcess( );
+    }
+}
+
+static void Reset( void )
+{
+    NbCarriers = 0;
+    IrqAccesses = 0;
+    ScanDone = false;
+    ScanIndex = 0;
+    ScanDoneTime = 0;
+    TxDoneCount = 0;
+}
+
+static void AddCarrier( uint8_t channel, uint32_t start, uint32_t stop )
+{
+    Carriers[NbCarriers].Frequency = Channels[channel];
+    Carriers[NbCarriers].Start = start;
+    Carriers[NbCarriers].Stop = stop;
+    NbCarriers++;
+}
+
+/*!
+ * \brief Scans the channels and runs the timer interrupts and the radio
+ *        processing until the scan is done
+ */
+static void Scan( uint8_t nbChannels )
+{
+    ScanStart = NowMs;
+    Radio.StartChannelScan( Channels, nbChannels, SCANTEST_BANDWIDTH, SCANTEST_RSSI_THRESH, SCANTEST_SENSE_TIME );
+    Process( );
+
+    while( ( ScanDone == false ) && ( ( NowMs - ScanStart ) < SCANTEST_TIMEOUT ) )
+    {
+        NowMs++;
+        if( ( TimerArmed == true ) && ( ( int32_t )( NowMs - TimerAlarm ) >= 0 ) )
+        {
+            TimerArmed = false;
+            InIrq = true;
+            UTIL_TIMER_IRQ_Handler( );
+            InIrq = false;
+        }
+        Process( );
+    }
+}
+
+/*
+ *=============================================================================
+ * Cases
+ *=============================================================================
+ */
+
+static bool FreeChannel( void )
+{
+    Reset( );
+    Scan( 3 );
+    CHECK( ScanDone == true );
+    CHECK( ScanIndex == 0 );
+    // Settling, then the whole sense time
+    CHECK( ScanDoneTime >= RadioGetWakeupTime( ) + SCANTEST_SENSE_TIME );
+    CHECK( IrqAccesses == 0 );
+    return true;
+}
+
+static bool BusyChannelSkipped( void )
+{
+    Reset( );
+    AddCarrier( 0, 0, SCANTEST_TIMEOUT );
+    Scan( 3 );
+    CHECK( ScanDone == true );
+    CHECK( ScanIndex == 1 );
+    CHECK( IrqAccesses == 0 );
+    return true;
+}
+
+static bool AllChannelsBusy( void )
+{
+    Reset( );
+    AddCarrier( 0, 0, SCANTEST_TIMEOUT );
+    AddCarrier( 1, 0, SCANTEST_TIMEOUT );
+    AddCarrier( 2, 0, SCANTEST_TIMEOUT );
+    Scan( 3 );
+    CHECK( ScanDone == true );
+    CHECK( ScanIndex == -1 );
+    CHECK( IrqAccesses == 0 );
+    return true;
+}
+
+static bool OnePeriodCarrier( void )
+{
+    uint32_t sense = RadioGetWakeupTime( );
+
+    // A carrier of one sample period in the middle of the sense time
+    Reset( );
+    AddCarrier( 0, sense + 2, sense + 2 + RADIO_CHANNEL_SCAN_SAMPLE_PERIOD );
+    Scan( 3 );
+    CHECK( ScanDone == true );
+    CHECK( ScanIndex == 1 );
+    CHECK( IrqAccesses == 0 );
+    return true;
+}
+
+static bool NoChannel( void )
+{
+    Reset( );
+    Scan( 0 );
+    CHECK( ScanDone == true );
+    CHECK( ScanIndex == -1 );
+    return true;
+}
+
+static bool RadioIrqNotReplayed( void )
+{
+    Reset( );
+    InIrq = true;
+    DioIrq( IRQ_TX_DONE );
+    InIrq = false;
+    Process( );
+    CHECK( TxDoneCount == 1 );
+
+    // The samples go through the same processing, the TX done is consumed
+    Scan( 3 );
+    CHECK( ScanDone == true );
+    CHECK( ScanIndex == 0 );
+    CHECK( TxDoneCount == 1 );
+    CHECK( IrqAccesses == 0 );
+    return true;
+}
+
+static bool SleepAbortsScan( void )
+{
+    Reset( );
+    ScanStart = NowMs;
+    Radio.StartChannelScan( Channels, 3, SCANTEST_BANDWIDTH, SCANTEST_RSSI_THRESH, SCANTEST_SENSE_TIME );
+    NowMs += RadioGetWakeupTime( );
+    TimerArmed = false;
+    InIrq = true;
+    UTIL_TIMER_IRQ_Handler( );
+    InIrq = false;
+
+    // Sample requested, the radio is put to sleep before it is processed
+    Radio.Sleep( );
+    Process( );
+    CHECK( ScanDone == false );
+    CHECK( TimerArmed == false );
+    CHECK( IrqAccesses == 0 );
+    return true;
+}
+
+static const ScanTestCase_t Cases[] =
+{
+    { "free channel", FreeChannel },
+    { "busy channel skipped", BusyChannelSkipped },
+    { "all channels busy", AllChannelsBusy },
+    { "carrier of one sample period", OnePeriodCarrier },
+    { "no channel", NoChannel },
+    { "radio interrupt not replayed", RadioIrqNotReplayed },
+    { "sleep aborts the scan", SleepAbortsScan },
+};
+
+int main( int argc, char **argv )
+{
+    int status = 0;
+
+    UTIL_TIMER_Init( );
+    Radio.Init( &Events );
+
+    for( uint32_t n = 0; n < sizeof( Cases ) / sizeof( Cases[0] ); n++ )
+    {
+        bool passed = Cases[n].Run( );
+
+        printf( "%-40s %s\n", Cases[n].Name, ( passed == true ) ? "ok" : "FAILED" );
+        if( passed == false )
+        {
+            status = 1;
+        }
+    }
+    return status;
+}
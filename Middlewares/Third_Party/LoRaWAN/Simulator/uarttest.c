@@ -0,0 +1,457 @@
+/*!
+ * \file      uarttest.c
+ *
+ * \brief     Host test of the AT application UART reception
+ *
+ * \details   Runs usart_if.c, lora_command.c and lora_at.c of the FreeRTOS AT
+ *            application on the host. The UART and its circular RX DMA are
+ *            simulated at byte level: the DMA writes the received bytes and
+ *            raises the half transfer, transfer complete and idle line events
+ *            as the HAL does, the test decides when the command task runs.
+ *
+ *            The cases send AT+SEND lines with random payloads and check that
+ *            every payload reaches the LoRaWAN handler intact: at line rate,
+ *            with a consumer too slow for the buffers, across a stop mode
+ *            which keeps or loses the UART settings, after late events and
+ *            after a receive error.
+ *
+ *            Usage: uarttest
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "at_host.h"
+#include "lora_at.h"
+#include "lora_command.h"
+#include "usart_if.h"
+
+#define CHECK( cond )                                                         \
+    do                                                                        \
+    {                                                                         \
+        if( !( cond ) )                                                       \
+        {                                                                     \
+            printf( "FAIL %s line %d: %s\n", __func__, __LINE__, #cond );     \
+            return false;                                                     \
+        }                                                                     \
+    }while( 0 )
+
+typedef struct UartTestCase_s
+{
+    const char *Name;
+    bool ( *Run )( void );
+}UartTestCase_t;
+
+/*!
+ * Longest random payload of a line [bytes]
+ */
+#define UARTTEST_PAYLOAD_MAX                        60
+
+/*!
+ * Lines sent by the line rate cases
+ */
+#define UARTTEST_LINES                              3000
+
+/* Simulated USART1 and its DMA channels */
+static USART_TypeDef SimUsart;
+static DMA_Channel_TypeDef SimDmaRx;
+static DMA_Channel_TypeDef SimDmaTx;
+
+DMA_HandleTypeDef hdma_usart1_rx = { .Instance = &SimDmaRx };
+DMA_HandleTypeDef hdma_usart1_tx = { .Instance = &SimDmaTx };
+UART_HandleTypeDef huart1 = { .Instance = &SimUsart, .hdmatx = &hdma_usart1_tx, .hdmarx = &hdma_usart1_rx };
+
+static uint8_t *RxBuffer;
+static uint16_t RxSize;
+static uint16_t RxPos;
+static bool PendingHalf;
+static bool PendingComplete;
+static uint32_t RxStarts;
+static uint32_t LostBytes;
+static uint32_t Errors;
+
+HAL_StatusTypeDef HAL_UART_Init( UART_HandleTypeDef *huart )
+{
+    huart->Instance->CR1 = USART_CR1_UE;
+    huart->Instance->CR3 = 0;
+    huart->Instance->ISR = USART_ISR_REACK;
+    huart->RxState = HAL_UART_STATE_READY;
+    return HAL_OK;
+}
+
+void HAL_UART_MspDeInit( UART_HandleTypeDef *huart )
+{
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit( UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout )
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA( UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size )
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive( UART_HandleTypeDef *huart )
+{
+    huart->Instance->CR3 &= ~USART_CR3_DMAR;
+    huart->hdmarx->Instance->CCR = 0;
+    huart->RxState = HAL_UART_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA( UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size )
+{
+    RxBuffer = pData;
+    RxSize = Size;
+    RxPos = 0;
+    PendingHalf = false;
+    PendingComplete = false;
+    huart->hdmarx->Instance->CNDTR = Size;
+    huart->hdmarx->Instance->CCR = DMA_CCR_EN;
+    huart->Instance->CR3 |= USART_CR3_DMAR;
+    huart->RxState = HAL_UART_STATE_BUSY_RX;
+    RxStarts++;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_StopModeWakeUpSourceConfig( UART_HandleTypeDef *huart, UART_WakeUpTypeDef WakeUpSelection )
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_EnableStopMode( UART_HandleTypeDef *huart )
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Init( DMA_HandleTypeDef *hdma )
+{
+    hdma->Instance->CCR = 0;
+    hdma->Instance->CNDTR = 0;
+    return HAL_OK;
+}
+
+void MX_DMA_Init( void )
+{
+}
+
+void MX_USART1_UART_Init( void )
+{
+    HAL_UART_Init( &huart1 );
+}
+
+void MX_USART2_UART_Init( void )
+{
+}
+
+void Error_Handler( void )
+{
+    Errors++;
+}
+
+/*!
+ * Delivers the DMA interrupts raised and not handled yet
+ */
+static void SimDmaIrq( void )
+{
+    if( PendingHalf == true )
+    {
+        PendingHalf = false;
+        HAL_UARTEx_RxEventCallback( &huart1, RxSize / 2 );
+    }
+    if( PendingComplete == true )
+    {
+        PendingComplete = false;
+        HAL_UARTEx_RxEventCallback( &huart1, RxSize );
+    }
+}
+
+/*!
+ * Receives a byte, the DMA interrupts are handled at once unless masked
+ */
+static void SimRxByte( uint8_t byte, bool masked )
+{
+    if( ( SimDmaRx.CCR & DMA_CCR_EN ) == 0 )
+    {
+        LostBytes++;
+        return;
+    }
+    RxBuffer[RxPos++] = byte;
+    SimDmaRx.CNDTR--;
+    if( RxPos == RxSize / 2 )
+    {
+        PendingHalf = true;
+    }
+    if( RxPos == RxSize )
+    {
+        RxPos = 0;
+        SimDmaRx.CNDTR = RxSize;
+        PendingComplete = true;
+    }
+    if( masked == false )
+    {
+        SimDmaIrq( );
+    }
+}
+
+/*!
+ * Idle line event, raised one character after the last byte
+ */
+static void SimRxIdle( void )
+{
+    SimDmaIrq( );
+    if( ( SimDmaRx.CCR & DMA_CCR_EN ) != 0 )
+    {
+        HAL_UARTEx_RxEventCallback( &huart1, RxSize - ( uint16_t )SimDmaRx.CNDTR );
+    }
+}
+
+static void SimRxString( const char *str, bool masked )
+{
+    while( *str != '\0' )
+    {
+        SimRxByte( ( uint8_t )*str++, masked );
+    }
+}
+
+/*!
+ * Stop mode, the peripherals keep their settings or lose them
+ */
+static void SimStopMode( bool retained )
+{
+    if( retained == false )
+    {
+        SimUsart.CR1 = 0;
+        SimUsart.CR3 = 0;
+        SimDmaRx.CCR = 0;
+        SimDmaRx.CNDTR = 0;
+    }
+}
+
+static void Reset( void )
+{
+    srand( 1 );
+    memset( &SimUsart, 0, sizeof( SimUsart ) );
+    memset( &SimDmaRx, 0, sizeof( SimDmaRx ) );
+    RxStarts = 0;
+    LostBytes = 0;
+    Errors = 0;
+    AtHostReset( );
+    vcom_Init( NULL );
+    CMD_Init( NULL );
+    vcom_ReceiveInit( AtHostRx );
+}
+
+/*!
+ * Builds an AT+SEND line with a random payload
+ */
+static void BuildLine( char *line, uint8_t *payload, uint8_t *size )
+{
+    *size = 1 + rand( ) % UARTTEST_PAYLOAD_MAX;
+    line += sprintf( line, "AT+SEND=%u:%u:", 1 + rand( ) % 223, rand( ) % 2 );
+    for( uint8_t i = 0; i < *size; i++ )
+    {
+        payload[i] = ( uint8_t )rand( );
+        line += sprintf( line, ( ( rand( ) % 2 ) == 0 ) ? "%02x" : "%02X", payload[i] );
+    }
+    strcpy( line, ( ( rand( ) % 3 ) == 0 ) ? "\r\n" : "\r" );
+}
+
+/*!
+ * Payloads of the lines sent and not checked yet
+ */
+#define UARTTEST_PENDING                            32
+
+static uint8_t Payloads[UARTTEST_PENDING][UARTTEST_PAYLOAD_MAX];
+static uint8_t Sizes[UARTTEST_PENDING];
+
+/*!
+ * Runs the command task and compares the uplinks it requests with the lines
+ * sent, in order
+ */
+static void ProcessLines( uint32_t *checked, uint32_t *intact )
+{
+    AtHostUplink_t uplink;
+
+    CMD_Process( );
+    while( AtHostGetUplink( &uplink ) == true )
+    {
+        uint8_t slot = *checked % UARTTEST_PENDING;
+
+        if( ( uplink.Size == Sizes[slot] ) && ( memcmp( uplink.Buffer, Payloads[slot], uplink.Size ) == 0 ) )
+        {
+            ( *intact )++;
+        }
+        ( *checked )++;
+    }
+}
+
+/*!
+ * Sends the lines at line rate with random gaps, the command task runs after
+ * a random latency of at most maxLatency byte times
+ *
+ * \retval number of lines whose payload reached the handler intact
+ */
+static uint32_t SendLines( uint32_t lines, uint32_t maxLatency )
+{
+    char line[2 * UARTTEST_PAYLOAD_MAX + 32];
+    uint32_t checked = 0;
+    uint32_t intact = 0;
+    uint32_t nextTask = 1 + rand( ) % maxLatency;
+
+    for( uint32_t sent = 0; sent < lines; sent++ )
+    {
+        uint8_t slot = sent % UARTTEST_PENDING;
+
+        BuildLine( line, Payloads[slot], &Sizes[slot] );
+        for( char *c = line; *c != '\0'; c++ )
+        {
+            SimRxByte( ( uint8_t )*c, false );
+            if( --nextTask == 0 )
+            {
+                ProcessLines( &checked, &intact );
+                nextTask = 1 + rand( ) % maxLatency;
+            }
+        }
+        if( ( rand( ) % 4 ) == 0 )
+        {
+            SimRxIdle( );
+        }
+    }
+    SimRxIdle( );
+    ProcessLines( &checked, &intact );
+    return intact;
+}
+
+static bool LineRate( void )
+{
+    // The command task keeps up, every line is parsed
+    Reset( );
+    CHECK( SendLines( UARTTEST_LINES, 40 ) == UARTTEST_LINES );
+    CHECK( CMD_GetRxDropped( ) == 0 );
+    CHECK( strstr( AtHostOutput( ), "ERROR" ) == NULL );
+    CHECK( ( RxStarts == 1 ) && ( Errors == 0 ) );
+    return true;
+}
+
+static bool SlowConsumer( void )
+{
+    // The overflow is reported and counted instead of mixing lines
+    Reset( );
+    CHECK( SendLines( 200, 600 ) < 200 );
+    CHECK( CMD_GetRxDropped( ) > 0 );
+    CHECK( strstr( AtHostOutput( ), "AT_TEST_PARAM_OVERFLOW" ) != NULL );
+
+    // Lines sent once the task keeps up again are parsed
+    AtHostReset( );
+    CHECK( SendLines( 100, 40 ) == 100 );
+    return true;
+}
+
+static bool StopRetained( void )
+{
+    AtHostUplink_t uplink;
+    uint32_t dropped;
+
+    // The line is completed while the MCU wakes up, its DMA interrupts masked
+    Reset( );
+    CHECK( SendLines( 3, 40 ) == 3 );
+    dropped = CMD_GetRxDropped( );
+    SimRxString( "AT+SEND=2:0:0102", false );
+    SimStopMode( true );
+    SimRxString( "0304\r", true );
+    vcom_Resume( );
+    CMD_Process( );
+    CHECK( AtHostGetUplink( &uplink ) == true );
+    CHECK( ( uplink.Size == 4 ) && ( memcmp( uplink.Buffer, "\x01\x02\x03\x04", 4 ) == 0 ) );
+
+    // The reception is not restarted and the late events deliver nothing twice
+    CHECK( RxStarts == 1 );
+    SimRxIdle( );
+    CMD_Process( );
+    CHECK( AtHostGetUplink( &uplink ) == false );
+    CHECK( strstr( AtHostOutput( ), "ERROR" ) == NULL );
+
+    // Across the half transfer and transfer complete positions
+    for( uint32_t i = 0; i < 40; i++ )
+    {
+        SimRxString( "AT+SEND=3:1:", false );
+        SimStopMode( true );
+        SimRxString( "A5A5A5A5A5A5A5A5A5A5\r", true );
+        vcom_Resume( );
+        SimDmaIrq( );
+        CMD_Process( );
+        CHECK( AtHostGetUplink( &uplink ) == true );
+        CHECK( ( uplink.Size == 10 ) && ( uplink.Buffer[9] == 0xA5 ) );
+    }
+    CHECK( AtHostGetUplink( &uplink ) == false );
+    CHECK( ( RxStarts == 1 ) && ( CMD_GetRxDropped( ) == dropped ) && ( Errors == 0 ) );
+    return true;
+}
+
+static bool StopLost( void )
+{
+    AtHostUplink_t uplink;
+
+    // The settings are restored and the reception restarted
+    Reset( );
+    CHECK( SendLines( 3, 40 ) == 3 );
+    SimStopMode( false );
+    SimRxString( "AT\r", true );
+    CHECK( LostBytes == 3 );
+    vcom_Resume( );
+    CHECK( ( RxStarts == 2 ) && ( Errors == 0 ) );
+    CHECK( ( SimUsart.CR1 & USART_CR1_UE ) != 0 );
+    CHECK( SendLines( 20, 40 ) == 20 );
+    CHECK( AtHostGetUplink( &uplink ) == false );
+    return true;
+}
+
+static bool ReceiveError( void )
+{
+    AtHostUplink_t uplink;
+
+    // The bytes received before the error are kept, the error is reported
+    // in sequence and the reception restarted by the HAL abort is restarted
+    Reset( );
+    SimRxString( "AT+SEND=4:0:11\rAT+SEND=4:0:22", false );
+    HAL_UART_AbortReceive( &huart1 );
+    HAL_UART_ErrorCallback( &huart1 );
+    CHECK( RxStarts == 2 );
+    SimRxString( "\rAT+SEND=4:0:33\r", false );
+    SimRxIdle( );
+    CMD_Process( );
+    CHECK( ( AtHostGetUplink( &uplink ) == true ) && ( uplink.Buffer[0] == 0x11 ) );
+    CHECK( ( AtHostGetUplink( &uplink ) == true ) && ( uplink.Buffer[0] == 0x33 ) );
+    CHECK( AtHostGetUplink( &uplink ) == false );
+    CHECK( strstr( AtHostOutput( ), "AT_RX_ERROR" ) != NULL );
+    return true;
+}
+
+static const UartTestCase_t Cases[] =
+{
+    { "line rate", LineRate },
+    { "slow consumer", SlowConsumer },
+    { "stop mode, settings retained", StopRetained },
+    { "stop mode, settings lost", StopLost },
+    { "receive error", ReceiveError },
+};
+
+int main( int argc, char **argv )
+{
+    int status = 0;
+
+    for( uint32_t i = 0; i < sizeof( Cases ) / sizeof( Cases[0] ); i++ )
+    {
+        bool passed = Cases[i].Run( );
+
+        printf( "%-40s %s\n", Cases[i].Name, ( passed == true ) ? "ok" : "FAILED" );
+        if( passed == false )
+        {
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,516 @@
+/*!
+ * \file      nvmm.c
+ *
+ * \brief     Non-volatile memory management on a littlefs file system
+ */
+#include "lorawan_conf.h"  /* CONTEXT_MANAGEMENT_ENABLED */
+
+#if ( CONTEXT_MANAGEMENT_ENABLED == 1 )
+#include "utilities.h"
+#include "lfs.h"
+#include "nvmm.h"
+
+/*!
+ * Size of the generation header starting records
+ */
+#define NVMM_HEADER_SIZE                            sizeof( uint32_t )
+
+/*!
+ * File name size: prefix, 4 hexadecimal digits of the offset and terminator
+ */
+#define NVMM_NAME_SIZE                              6
+
+/*!
+ * Record file name prefix
+ */
+#define NVMM_RECORD_PREFIX                          'r'
+
+/*!
+ * Number of slots of the journal page
+ */
+#define NVMM_JOURNAL_SLOTS                          ( Journal.Page->Size / NVMM_JOURNAL_SLOT_SIZE )
+
+/*!
+ * Erased flash byte
+ */
+#define NVMM_ERASED_BYTE                            0xFF
+
+/*!
+ * Mounted file system
+ */
+static lfs_t* Lfs = NULL;
+
+/*!
+ * File buffer, only one file is open at a time
+ */
+static uint8_t FileBuffer[NVMM_FILE_BUFFER_SIZE];
+
+/*!
+ * File configuration providing the static buffer
+ */
+static const struct lfs_file_config FileConfig = { .buffer = FileBuffer };
+
+/*!
+ * Journal page header, the first slot of the page
+ */
+typedef struct sNvmmJournalHeader
+{
+    /*!
+     * Generation of the record the entries belong to
+     */
+    uint32_t Generation;
+    /*!
+     * Record identifier
+     */
+    uint16_t Offset;
+    /*!
+     * Check of the fields above
+     */
+    uint16_t Check;
+}NvmmJournalHeader_t;
+
+/*!
+ * Journal page state, scanned once and then maintained by the appends
+ */
+static struct
+{
+    /*!
+     * Journal page, NULL when records are stored without journal
+     */
+    const NvmmJournalPage_t* Page;
+    /*!
+     * The fields below describe the page content
+     */
+    bool Scanned;
+    /*!
+     * The header was compared with the generation of its record
+     */
+    bool Current;
+    /*!
+     * Record identifier of the header
+     */
+    uint16_t Offset;
+    /*!
+     * Generation of the header, 0 when the header is not valid
+     */
+    uint32_t Generation;
+    /*!
+     * Slot following the last programmed one, 0 when the page is erased
+     */
+    uint16_t End;
+}Journal;
+
+/*!
+ * \brief Builds the file name of a record
+ *
+ * \param [OUT] name            File name, NVMM_NAME_SIZE bytes
+ * \param [IN] offset           Record identifier
+ */
+static void GetFileName( char* name, uint16_t offset )
+{
+    name[0] = NVMM_RECORD_PREFIX;
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        name[1 + i] = ( char )Nibble2HexChar( ( offset >> ( 12 - ( 4 * i ) ) ) & 0x0F );
+    }
+    name[NVMM_NAME_SIZE - 1] = '\0';
+}
+
+/*!
+ * \brief Opens a record
+ *
+ * \param [OUT] file            File object
+ * \param [IN] offset           Record identifier
+ * \param [IN] flags            littlefs open flags
+ *
+ * \retval                      true if the file is open
+ */
+static bool OpenFile( lfs_file_t* file, uint16_t offset, int flags )
+{
+    char name[NVMM_NAME_SIZE];
+
+    if( Lfs == NULL )
+    {
+        return false;
+    }
+    GetFileName( name, offset );
+    return lfs_file_opencfg( Lfs, file, name, flags, &FileConfig ) == LFS_ERR_OK;
+}
+
+/*!
+ * \brief Reads the generation header of a record
+ *
+ * \param [IN] offset           Record identifier
+ * \param [OUT] generation      Generation of the record
+ *
+ * \retval                      true if the record exists and has a header
+ */
+static bool ReadGeneration( uint16_t offset, uint32_t* generation )
+{
+    lfs_file_t file;
+    lfs_ssize_t read;
+
+    if( OpenFile( &file, offset, LFS_O_RDONLY ) == false )
+    {
+        return false;
+    }
+    read = lfs_file_read( Lfs, &file, generation, NVMM_HEADER_SIZE );
+    lfs_file_close( Lfs, &file );
+
+    return read == ( lfs_ssize_t )NVMM_HEADER_SIZE;
+}
+
+/*!
+ * \brief Computes the check stored in the last 2 bytes of a journal slot
+ *
+ * \param [IN] slot             Journal slot
+ *
+ * \retval                      Check of the first NVMM_JOURNAL_ENTRY_SIZE bytes
+ */
+static uint16_t JournalCheck( uint8_t* slot )
+{
+    return ( uint16_t )Crc32( slot, NVMM_JOURNAL_ENTRY_SIZE );
+}
+
+/*!
+ * \brief Reads a journal slot
+ *
+ * \param [IN] index            Slot index
+ * \param [OUT] slot            NVMM_JOURNAL_SLOT_SIZE bytes
+ *
+ * \retval                      true if the slot holds a valid check, false
+ *                              when it is erased, torn or cannot be read
+ */
+static bool ReadSlot( uint16_t index, uint8_t* slot )
+{
+    uint16_t check;
+
+    if( Journal.Page->Read( ( uint32_t )index * NVMM_JOURNAL_SLOT_SIZE, slot, NVMM_JOURNAL_SLOT_SIZE ) == false )
+    {
+        return false;
+    }
+    memcpy1( ( uint8_t* )&check, slot + NVMM_JOURNAL_ENTRY_SIZE, sizeof( check ) );
+    return check == JournalCheck( slot );
+}
+
+/*!
+ * \brief Returns true when a slot reads erased
+ */
+static bool IsErased( uint8_t* slot )
+{
+    for( uint8_t i = 0; i < NVMM_JOURNAL_SLOT_SIZE; i++ )
+    {
+        if( slot[i] != NVMM_ERASED_BYTE )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Finds the header and the first erased slot of the journal page
+ */
+static void ScanJournal( void )
+{
+    uint8_t slot[NVMM_JOURNAL_SLOT_SIZE];
+    NvmmJournalHeader_t header;
+
+    Journal.Scanned = true;
+    Journal.Current = false;
+    Journal.Generation = 0;
+    Journal.Offset = 0;
+
+    // Slots are programmed in order, a power loss may leave a torn slot
+    // which is not erased but fails its check. The page is scanned from
+    // its end, an interrupted erase may leave programmed slots after
+    // erased ones.
+    for( Journal.End = NVMM_JOURNAL_SLOTS; Journal.End > 0; Journal.End-- )
+    {
+        if( ( Journal.Page->Read( ( uint32_t )( Journal.End - 1 ) * NVMM_JOURNAL_SLOT_SIZE, slot, sizeof( slot ) ) == false ) ||
+            ( IsErased( slot ) == false ) )
+        {
+            break;
+        }
+    }
+
+    if( ( Journal.End > 0 ) && ( ReadSlot( 0, ( uint8_t* )&header ) == true ) && ( header.Generation != 0 ) )
+    {
+        Journal.Generation = header.Generation;
+        Journal.Offset = header.Offset;
+    }
+}
+
+/*!
+ * \brief Erases the journal page when it holds the journal of a record, or
+ *        a header which is not valid
+ *
+ * \param [IN] offset           Record identifier
+ *
+ * \retval                      true if the page holds no journal of the record
+ */
+static bool EraseJournal( uint16_t offset )
+{
+    if( Journal.Page == NULL )
+    {
+        return true;
+    }
+    if( Journal.Scanned == false )
+    {
+        ScanJournal( );
+    }
+    if( ( Journal.End == 0 ) || ( ( Journal.Generation != 0 ) && ( Journal.Offset != offset ) ) )
+    {
+        return true;
+    }
+
+    Journal.Scanned = false;
+    if( Journal.Page->Erase( ) == false )
+    {
+        return false;
+    }
+    Journal.Scanned = true;
+    Journal.Current = false;
+    Journal.Generation = 0;
+    Journal.End = 0;
+    return true;
+}
+
+bool NvmmInit( struct lfs* lfs, const NvmmJournalPage_t* journal )
+{
+    Journal.Page = NULL;
+    Journal.Scanned = false;
+    if( ( lfs == NULL ) || ( lfs->cfg == NULL ) || ( lfs->cfg->cache_size > NVMM_FILE_BUFFER_SIZE ) )
+    {
+        Lfs = NULL;
+        return false;
+    }
+    Lfs = lfs;
+    if( ( journal != NULL ) && ( journal->Size >= ( 2 * NVMM_JOURNAL_SLOT_SIZE ) ) &&
+        ( ( journal->Size % NVMM_JOURNAL_SLOT_SIZE ) == 0 ) )
+    {
+        Journal.Page = journal;
+    }
+    return true;
+}
+
+uint16_t NvmmWrite( uint8_t* src, uint16_t size, uint16_t offset )
+{
+    lfs_file_t file;
+    uint32_t generation = 0;
+    bool done;
+
+    // A missing record restarts at generation 1, a journal left by an
+    // interrupted reset may have that generation
+    if( ReadGeneration( offset, &generation ) == false )
+    {
+        generation = 0;
+        if( EraseJournal( offset ) == false )
+        {
+            return 0;
+        }
+    }
+    generation++;
+
+    if( OpenFile( &file, offset, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC ) == false )
+    {
+        return 0;
+    }
+    done = ( lfs_file_write( Lfs, &file, &generation, NVMM_HEADER_SIZE ) == ( lfs_ssize_t )NVMM_HEADER_SIZE ) &&
+           ( lfs_file_write( Lfs, &file, src, size ) == ( lfs_ssize_t )size );
+
+    // littlefs does not commit a file after a failed write, the previous
+    // record then stays in place
+    if( ( lfs_file_close( Lfs, &file ) != LFS_ERR_OK ) || ( done == false ) )
+    {
+        return 0;
+    }
+
+    // Entries of the previous generation are now obsolete. A power loss
+    // before the erase is harmless as the generations do not match.
+    EraseJournal( offset );
+
+    return size;
+}
+
+uint16_t NvmmRead( uint8_t* dest, uint16_t size, uint16_t offset )
+{
+    lfs_file_t file;
+    lfs_ssize_t read = 0;
+
+    if( OpenFile( &file, offset, LFS_O_RDONLY ) == false )
+    {
+        return 0;
+    }
+    if( ( lfs_file_size( Lfs, &file ) == ( lfs_soff_t )( NVMM_HEADER_SIZE + size ) ) &&
+        ( lfs_file_seek( Lfs, &file, NVMM_HEADER_SIZE, LFS_SEEK_SET ) >= 0 ) )
+    {
+        read = lfs_file_read( Lfs, &file, dest, size );
+    }
+    lfs_file_close( Lfs, &file );
+
+    return ( read == ( lfs_ssize_t )size ) ? size : 0;
+}
+
+bool NvmmCrc32Check( uint16_t size, uint16_t offset )
+{
+    lfs_file_t file;
+    uint8_t data[16];
+    uint32_t crc = Crc32Init( );
+    uint32_t storedCrc = 0;
+    uint16_t remaining = size - sizeof( uint32_t );
+    bool valid = false;
+
+    if( size <= sizeof( uint32_t ) )
+    {
+        return false;
+    }
+    if( OpenFile( &file, offset, LFS_O_RDONLY ) == false )
+    {
+        return false;
+    }
+
+    if( ( lfs_file_size( Lfs, &file ) == ( lfs_soff_t )( NVMM_HEADER_SIZE + size ) ) &&
+        ( lfs_file_seek( Lfs, &file, NVMM_HEADER_SIZE, LFS_SEEK_SET ) >= 0 ) )
+    {
+        valid = true;
+        while( ( remaining > 0 ) && ( valid == true ) )
+        {
+            uint16_t chunk = ( remaining < sizeof( data ) ) ? remaining : sizeof( data );
+
+            valid = ( lfs_file_read( Lfs, &file, data, chunk ) == ( lfs_ssize_t )chunk );
+            crc = Crc32Update( crc, data, chunk );
+            remaining -= chunk;
+        }
+        valid = valid &&
+                ( lfs_file_read( Lfs, &file, &storedCrc, sizeof( storedCrc ) ) == ( lfs_ssize_t )sizeof( storedCrc ) ) &&
+                ( Crc32Finalize( crc ) == storedCrc );
+    }
+    lfs_file_close( Lfs, &file );
+
+    return valid;
+}
+
+bool NvmmReset( uint16_t size, uint16_t offset )
+{
+    char name[NVMM_NAME_SIZE];
+    int err;
+
+    if( Lfs == NULL )
+    {
+        return false;
+    }
+
+    // The record goes first: without it the journal is never applied, while
+    // a record left alone would be restored with older frame counters
+    GetFileName( name, offset );
+    err = lfs_remove( Lfs, name );
+
+    return ( ( err == LFS_ERR_OK ) || ( err == LFS_ERR_NOENT ) ) && ( EraseJournal( offset ) == true );
+}
+
+uint16_t NvmmAppend( uint8_t* src, uint16_t size, uint16_t offset )
+{
+    uint8_t slot[NVMM_JOURNAL_SLOT_SIZE];
+    uint16_t check;
+    uint32_t generation;
+
+    if( ( Journal.Page == NULL ) || ( size != NVMM_JOURNAL_ENTRY_SIZE ) )
+    {
+        return 0;
+    }
+    if( Journal.Scanned == false )
+    {
+        ScanJournal( );
+    }
+
+    if( ( Journal.Current == false ) || ( Journal.Offset != offset ) || ( Journal.Generation == 0 ) )
+    {
+        NvmmJournalHeader_t header;
+
+        if( ReadGeneration( offset, &generation ) == false )
+        {
+            return 0;
+        }
+        if( ( Journal.Generation != generation ) || ( Journal.Offset != offset ) )
+        {
+            // Stale journal or journal of another record: start the
+            // current generation on an erased page
+            if( Journal.End != 0 )
+            {
+                Journal.Scanned = false;
+                if( Journal.Page->Erase( ) == false )
+                {
+                    return 0;
+                }
+                Journal.Scanned = true;
+                Journal.End = 0;
+            }
+            header.Generation = generation;
+            header.Offset = offset;
+            header.Check = JournalCheck( ( uint8_t* )&header );
+            Journal.End = 1;
+            if( Journal.Page->Prog( 0, ( uint8_t* )&header, sizeof( header ) ) == false )
+            {
+                Journal.Generation = 0;
+                return 0;
+            }
+            Journal.Generation = generation;
+            Journal.Offset = offset;
+        }
+        Journal.Current = true;
+    }
+
+    if( Journal.End >= NVMM_JOURNAL_SLOTS )
+    {
+        // Full, the caller folds the journal into the record
+        return 0;
+    }
+
+    memcpy1( slot, src, NVMM_JOURNAL_ENTRY_SIZE );
+    check = JournalCheck( slot );
+    memcpy1( slot + NVMM_JOURNAL_ENTRY_SIZE, ( uint8_t* )&check, sizeof( check ) );
+
+    // The slot is used even when its programming fails
+    Journal.End++;
+    if( Journal.Page->Prog( ( uint32_t )( Journal.End - 1 ) * NVMM_JOURNAL_SLOT_SIZE, slot, sizeof( slot ) ) == false )
+    {
+        return 0;
+    }
+    return size;
+}
+
+uint16_t NvmmReadJournal( uint16_t size, uint16_t offset,
+                          void ( *apply )( uint8_t* entry, void* context ), void* context )
+{
+    uint8_t slot[NVMM_JOURNAL_SLOT_SIZE];
+    uint32_t generation;
+    uint16_t nbEntries = 0;
+
+    if( ( Journal.Page == NULL ) || ( size != NVMM_JOURNAL_ENTRY_SIZE ) ||
+        ( ReadGeneration( offset, &generation ) == false ) )
+    {
+        return 0;
+    }
+    if( Journal.Scanned == false )
+    {
+        ScanJournal( );
+    }
+    if( ( Journal.Generation != generation ) || ( Journal.Offset != offset ) )
+    {
+        // No entry since the last record
+        return 0;
+    }
+    Journal.Current = true;
+
+    for( uint16_t i = 1; i < Journal.End; i++ )
+    {
+        if( ReadSlot( i, slot ) == true )
+        {
+            apply( slot, context );
+            nbEntries++;
+        }
+    }
+    return nbEntries;
+}
+#endif /* CONTEXT_MANAGEMENT_ENABLED == 1 */
@@ -0,0 +1,158 @@
+/*!
+ * \file      nvmm.h
+ *
+ * \brief     Non-volatile memory management on a littlefs file system
+ *
+ * \details   Every NVM group is addressed by its offset in LoRaMacNvmData_t
+ *            and stored as one record file, so a group update never rewrites
+ *            the other groups. littlefs commits a file atomically on close,
+ *            hence a power loss leaves either the previous or the new record.
+ *
+ *            A record can be followed by an append-only journal of small
+ *            fixed size entries (e.g. frame counters). The journal is kept
+ *            out of the file system in a raw pre-erased flash page, one
+ *            double word per entry, so an entry costs a single program
+ *            operation. The journal belongs to one generation of the record:
+ *            writing the record starts a new generation, and the page is only
+ *            erased then.
+ */
+#ifndef __NVMM_H__
+#define __NVMM_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * Size of the file buffer, shall be equal to the littlefs cache_size
+ */
+#ifndef NVMM_FILE_BUFFER_SIZE
+#define NVMM_FILE_BUFFER_SIZE                       64
+#endif
+
+/*!
+ * Size of a journal slot, the flash programming unit
+ */
+#define NVMM_JOURNAL_SLOT_SIZE                      8
+
+/*!
+ * Size of a journal entry, the rest of its slot is a check
+ */
+#define NVMM_JOURNAL_ENTRY_SIZE                     6
+
+struct lfs;
+
+/*!
+ * Raw flash page holding the record journal
+ */
+typedef struct sNvmmJournalPage
+{
+    /*!
+     * Page size, a multiple of NVMM_JOURNAL_SLOT_SIZE
+     */
+    uint32_t Size;
+    /*!
+     * Reads from the page
+     */
+    bool ( *Read )( uint32_t offset, uint8_t* buffer, uint32_t size );
+    /*!
+     * Programs one erased slot of the page
+     */
+    bool ( *Prog )( uint32_t offset, const uint8_t* buffer, uint32_t size );
+    /*!
+     * Erases the page, erased bytes read 0xFF
+     */
+    bool ( *Erase )( void );
+}NvmmJournalPage_t;
+
+/*!
+ * \brief Selects the mounted file system holding the records and the flash
+ *        page holding the journal
+ *
+ * \param [IN] lfs              Mounted littlefs instance
+ * \param [IN] journal          Journal page, NULL to store records only
+ *
+ * \retval                      true if the file system can be used
+ */
+bool NvmmInit( struct lfs* lfs, const NvmmJournalPage_t* journal );
+
+/*!
+ * \brief Writes a record and starts a new journal generation
+ *
+ * \param [IN] src              Pointer to the source data
+ * \param [IN] size             Number of bytes to write
+ * \param [IN] offset           Record identifier (offset of the group)
+ *
+ * \retval                      Number of bytes written
+ */
+uint16_t NvmmWrite( uint8_t* src, uint16_t size, uint16_t offset );
+
+/*!
+ * \brief Reads a record
+ *
+ * \param [OUT] dest            Pointer to the destination buffer
+ * \param [IN] size             Number of bytes to read
+ * \param [IN] offset           Record identifier (offset of the group)
+ *
+ * \retval                      Number of bytes read
+ */
+uint16_t NvmmRead( uint8_t* dest, uint16_t size, uint16_t offset );
+
+/*!
+ * \brief Checks the CRC32 stored in the last 4 bytes of a record
+ *
+ * \param [IN] size             Record size, CRC included
+ * \param [IN] offset           Record identifier (offset of the group)
+ *
+ * \retval                      true if the record exists and its CRC matches
+ */
+bool NvmmCrc32Check( uint16_t size, uint16_t offset );
+
+/*!
+ * \brief Removes a record and its journal
+ *
+ * \param [IN] size             Record size
+ * \param [IN] offset           Record identifier (offset of the group)
+ *
+ * \retval                      true if nothing remains stored
+ */
+bool NvmmReset( uint16_t size, uint16_t offset );
+
+/*!
+ * \brief Appends an entry to the journal of a record
+ *
+ * \remark The record must exist. One record has a journal at a time, the
+ *         journal page is erased when another record starts one.
+ *
+ * \param [IN] src              Pointer to the entry
+ * \param [IN] size             Entry size, NVMM_JOURNAL_ENTRY_SIZE
+ * \param [IN] offset           Record identifier (offset of the group)
+ *
+ * \retval                      Number of bytes written, 0 when the journal is
+ *                              full and the record shall be written instead
+ */
+uint16_t NvmmAppend( uint8_t* src, uint16_t size, uint16_t offset );
+
+/*!
+ * \brief Reads the journal entries of the current record generation, the
+ *        oldest first. Entries failing their check are skipped.
+ *
+ * \param [IN] size             Entry size, NVMM_JOURNAL_ENTRY_SIZE
+ * \param [IN] offset           Record identifier (offset of the group)
+ * \param [IN] apply            Called with each entry
+ * \param [IN] context          Passed to apply
+ *
+ * \retval                      Number of entries read
+ */
+uint16_t NvmmReadJournal( uint16_t size, uint16_t offset,
+                          void ( *apply )( uint8_t* entry, void* context ), void* context );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __NVMM_H__
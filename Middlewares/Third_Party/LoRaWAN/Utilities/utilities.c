@@ -32,33 +32,30 @@
   */
 
 #include "utilities.h"
+#include "drbg.h"
 
 /*!
  * Redefinition of rand() and srand() standard C functions.
  * These functions are redefined in order to get the same behavior across
- * different compiler toolchains implementations.
+ * different compiler toolchains implementations, they draw from the AES-CTR
+ * DRBG.
  */
 // Standard random functions redefinition start
-#define RAND_LOCAL_MAX 2147483647L
-
-static uint32_t next = 1;
-
-static int32_t rand1( void );
-
-static int32_t rand1( void )
-{
-    return ( ( next = next * 1103515245L + 12345L ) % RAND_LOCAL_MAX );
-}
-
 void srand1( uint32_t seed )
 {
-    next = seed;
+    uint8_t material[4];
+
+    material[0] = ( uint8_t )seed;
+    material[1] = ( uint8_t )( seed >> 8 );
+    material[2] = ( uint8_t )( seed >> 16 );
+    material[3] = ( uint8_t )( seed >> 24 );
+    DrbgSeed( material, sizeof( material ) );
 }
 // Standard random functions redefinition end
 
 int32_t randr( int32_t min, int32_t max )
 {
-    return ( int32_t )rand1( ) % ( max - min + 1 ) + min;
+    return ( int32_t )( DrbgRandom32( ) % ( uint32_t )( max - min + 1 ) ) + min;
 }
 
 void memcpy1( uint8_t *dst, const uint8_t *src, uint16_t size )
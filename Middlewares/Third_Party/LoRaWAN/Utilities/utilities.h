@@ -119,6 +119,9 @@ typedef union Version_u
 /*!
  * \brief Initializes the pseudo random generator initial value
  *
+ * \remark Instantiates the DRBG from the seed, the sequence drawn by randr
+ *         is reproducible for a given seed
+ *
  * \param [IN] seed Pseudo random generator initial value
  */
 void srand1( uint32_t seed );
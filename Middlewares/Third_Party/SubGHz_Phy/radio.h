@@ -70,6 +70,17 @@ typedef enum
     RF_CAD,        //!< The radio is doing channel activity detection
 }RadioState_t;
 
+/*!
+ * Radio power states, as seen by the supply
+ */
+typedef enum
+{
+    RADIO_POWER_SLEEP = 0,  //!< Sleep, configuration retained
+    RADIO_POWER_STANDBY,    //!< Standby or frequency synthesis
+    RADIO_POWER_RX,         //!< Reception, duty cycled reception or CAD
+    RADIO_POWER_TX,         //!< Transmission, including the continuous wave
+}RadioPowerState_t;
+
 /*!
  * \brief Radio driver callback functions
  */
@@ -115,6 +126,23 @@ typedef struct
      * \param [IN] channelDetected    Channel Activity detected during the CAD
      */
     void ( *CadDone ) ( bool channelActivityDetected );
+
+    /*!
+     * \brief Channel scan done callback prototype.
+     *
+     * \param [IN] index Index of the first free channel of the scan,
+     *                   -1 when all the channels are busy
+     */
+    void ( *ChannelScanDone )( int8_t index );
+
+    /*!
+     * \brief Power state changed callback prototype.
+     *
+     * \param [IN] state New power state of the radio
+     * \param [IN] power TX power requested by the last TX configuration [dBm],
+     *                   meaningful in RADIO_POWER_TX
+     */
+    void ( *PowerStateChanged )( RadioPowerState_t state, int8_t power );
 }RadioEvents_t;
 
 #include "radio_ex.h" /* ST_WORKAROUND: extended radio functions */
@@ -473,6 +501,21 @@ struct Radio_s
    */
   int32_t (*ReceiveLongPacket)( uint8_t boosted_mode, uint32_t timeout, void (*RxLongStorePacketChunkCb) (uint8_t* buffer, uint8_t chunk_size) );
   /* ST_WORKAROUND_END */
+    /*!
+     * \brief Starts a non blocking carrier sense of a list of channels
+     *
+     * \remark The channels are sensed in order until one is free, the RSSI
+     *         is sampled on a timer so the MCU can sleep between samples.
+     *         The result is signaled by the ChannelScanDone event.
+     *
+     * \param [IN] freqs               Channel RF frequencies, must remain valid
+     *                                 until the ChannelScanDone event
+     * \param [IN] nbFreqs             Number of channels
+     * \param [IN] rxBandwidth         Rx bandwidth to be used
+     * \param [IN] rssiThresh          RSSI threshold above which a channel is busy
+     * \param [IN] maxCarrierSenseTime Max time the RSSI is sensed on each channel [ms]
+     */
+    void    ( *StartChannelScan )( const uint32_t *freqs, uint8_t nbFreqs, uint32_t rxBandwidth, int16_t rssiThresh, uint32_t maxCarrierSenseTime );
 };
 
 /*!
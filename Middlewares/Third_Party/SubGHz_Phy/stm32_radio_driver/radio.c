@@ -124,6 +124,16 @@ typedef struct SubgRf_s
 #define RADIO_BUF_SIZE 255
 /* ST_WORKAROUND_END */
 
+/*can be overridden in radio_conf.h*/
+#ifndef RADIO_CHANNEL_SCAN_SAMPLE_PERIOD
+/*!
+ * Period of the RSSI samples of a channel scan [ms], the resolution of the
+ * timer server. A carrier present for one period while a channel is sensed
+ * is detected, one symbol of SF7 at 125 kHz lasts 1.024 ms.
+ */
+#define RADIO_CHANNEL_SCAN_SAMPLE_PERIOD            1
+#endif
+
 /* Private function prototypes -----------------------------------------------*/
 /*!
  * \brief Initializes the radio
@@ -167,6 +177,23 @@ static void RadioSetChannel( uint32_t freq );
  */
 static bool RadioIsChannelFree( uint32_t freq, uint32_t rxBandwidth, int16_t rssiThresh, uint32_t maxCarrierSenseTime );
 
+/*!
+ * \brief Starts a non blocking carrier sense of a list of channels
+ *
+ * \remark Unlike RadioIsChannelFree, the RSSI is sampled every
+ *         RADIO_CHANNEL_SCAN_SAMPLE_PERIOD from a timer and the MCU can sleep
+ *         in between. The samples are taken by RadioIrqProcess, through
+ *         RADIO_IRQ_PROCESS, as the radio interrupts. The first free channel,
+ *         or -1, is signaled by the ChannelScanDone event.
+ *
+ * \param [IN] freqs               Channel RF frequencies in Hertz
+ * \param [IN] nbFreqs             Number of channels
+ * \param [IN] rxBandwidth         Rx bandwidth in Hertz
+ * \param [IN] rssiThresh          RSSI threshold in dBm
+ * \param [IN] maxCarrierSenseTime Max time in milliseconds while the RSSI is measured on each channel
+ */
+static void RadioStartChannelScan( const uint32_t *freqs, uint8_t nbFreqs, uint32_t rxBandwidth, int16_t rssiThresh, uint32_t maxCarrierSenseTime );
+
 /*!
  * \brief Generates a 32 bits random value based on the RSSI readings
  *
@@ -453,11 +480,37 @@ static void RadioOnRxTimeoutIrq( void * context );
  */
 static void RadioOnRxTimeoutProcess( void );
 
+/*!
+ * \brief Channel scan timer callback, requests one RSSI sample
+ */
+static void RadioOnChannelScanTimerIrq( void * context );
+
+/*!
+ * \brief Takes one RSSI sample of the channel scan, moves to the next
+ *        channel or ends the scan
+ */
+static void RadioChannelScanSample( void );
+
 /*!
  * \brief Tx timeout timer process
  */
 static void RadioOnTxTimeoutProcess( void );
 
+/*!
+ * \brief Operating mode change callback, reports the power state changes
+ *
+ * \param [IN] mode New operating mode of the driver
+ */
+static void RadioOnOperatingMode( RadioOperatingModes_t mode );
+
+/*!
+ * \brief Sets the TX power and keeps it for the power state reports
+ *
+ * \param [IN] power TX power [dBm]
+ * \retval paSelect PA selected for the power
+ */
+static uint8_t RadioSetRfTxPower( int8_t power );
+
 /* ST_WORKAROUND_BEGIN: extended radio functions */
 /*!
  * @brief D-BPSK to BPSK
@@ -609,8 +662,9 @@ const struct Radio_s Radio =
     RadioSetRxGenericConfig,
     RadioSetTxGenericConfig,
     RFW_TransmitLongPacket,
-    RFW_ReceiveLongPacket
+    RFW_ReceiveLongPacket,
     /* ST_WORKAROUND_END */
+    RadioStartChannelScan
 };
 
 const RadioLoRaBandwidths_t Bandwidths[] = { LORA_BW_125, LORA_BW_250, LORA_BW_500 };
@@ -624,6 +678,12 @@ static uint8_t RadioBuffer[RADIO_BUF_SIZE];
  */
 static RadioEvents_t* RadioEvents;
 
+/*!
+ * Power state last reported and TX power of the last TX configuration
+ */
+static RadioPowerState_t RadioPowerState = RADIO_POWER_SLEEP;
+static int8_t RadioTxPower;
+
 /*!
  * Radio hardware and global parameters
  */
@@ -635,6 +695,23 @@ SubgRf_t SubgRf;
 TimerEvent_t TxTimeoutTimer;
 TimerEvent_t RxTimeoutTimer;
 
+/*!
+ * Channel scan state and sample timer
+ */
+static struct
+{
+    const uint32_t *Freqs;
+    uint8_t NbFreqs;
+    uint8_t Index;
+    uint32_t RxBandwidth;
+    int16_t RssiThresh;
+    uint32_t SenseTime;
+    TimerTime_t SenseStart;
+    bool Settling;
+    bool SamplePending;
+}ChannelScan;
+TimerEvent_t ChannelScanTimer;
+
 /* Private  functions ---------------------------------------------------------*/
 
 static void RadioInit( RadioEvents_t *events )
@@ -645,6 +722,8 @@ static void RadioInit( RadioEvents_t *events )
     SubgRf.TxTimeout = 0;
     SubgRf.RxTimeout = 0;
 
+    RadioPowerState = RADIO_POWER_SLEEP;
+    SUBGRF_SetOperatingModeHandler( RadioOnOperatingMode );
     SUBGRF_Init( RadioOnDioIrq );
     /*SubgRf.publicNetwork set to false*/
     RadioSetPublicNetwork( false );
@@ -663,8 +742,10 @@ static void RadioInit( RadioEvents_t *events )
     // Initialize driver timeout timers
     TimerInit( &TxTimeoutTimer, RadioOnTxTimeoutIrq );
     TimerInit( &RxTimeoutTimer, RadioOnRxTimeoutIrq );
+    TimerInit( &ChannelScanTimer, RadioOnChannelScanTimerIrq );
     TimerStop( &TxTimeoutTimer );
     TimerStop( &RxTimeoutTimer );
+    TimerStop( &ChannelScanTimer );
 }
 
 static RadioState_t RadioGetStatus( void )
@@ -770,6 +851,97 @@ static bool RadioIsChannelFree( uint32_t freq, uint32_t rxBandwidth, int16_t rss
     return status;
 }
 
+static void RadioChannelScanNext( void )
+{
+    /* ST_WORKAROUND_BEGIN: Prevent multiple sleeps with TXCO delay */
+    RadioStandby( );
+    /* ST_WORKAROUND_END */
+
+    RadioSetModem( MODEM_FSK );
+
+    RadioSetChannel( ChannelScan.Freqs[ChannelScan.Index] );
+
+    // Set Rx bandwidth. Other parameters are not used.
+    RadioSetRxConfig( MODEM_FSK, ChannelScan.RxBandwidth, 600, 0, ChannelScan.RxBandwidth, 3, 0, false,
+                      0, false, 0, 0, false, true );
+    RadioRx( 0 );
+
+    // First sample once the receiver has settled, the MCU may sleep meanwhile
+    ChannelScan.Settling = true;
+    TimerSetValue( &ChannelScanTimer, RadioGetWakeupTime( ) );
+    TimerStart( &ChannelScanTimer );
+}
+
+static void RadioChannelScanDone( int8_t index )
+{
+    TimerStop( &ChannelScanTimer );
+    /* ST_WORKAROUND_BEGIN: Prevent multiple sleeps with TXCO delay */
+    RadioStandby( );
+    /* ST_WORKAROUND_END */
+
+    if( ( RadioEvents != NULL ) && ( RadioEvents->ChannelScanDone != NULL ) )
+    {
+        RadioEvents->ChannelScanDone( index );
+    }
+}
+
+static void RadioStartChannelScan( const uint32_t *freqs, uint8_t nbFreqs, uint32_t rxBandwidth, int16_t rssiThresh, uint32_t maxCarrierSenseTime )
+{
+    ChannelScan.Freqs = freqs;
+    ChannelScan.NbFreqs = nbFreqs;
+    ChannelScan.Index = 0;
+    ChannelScan.RxBandwidth = rxBandwidth;
+    ChannelScan.RssiThresh = rssiThresh;
+    ChannelScan.SenseTime = maxCarrierSenseTime;
+
+    if( nbFreqs == 0 )
+    {
+        RadioChannelScanDone( -1 );
+        return;
+    }
+    RadioChannelScanNext( );
+}
+
+static void RadioOnChannelScanTimerIrq( void* context )
+{
+    // The sample reconfigures the radio and may end the scan, it is run
+    // with the radio interrupts
+    ChannelScan.SamplePending = true;
+    RADIO_IRQ_PROCESS();
+}
+
+static void RadioChannelScanSample( void )
+{
+    if( ChannelScan.Settling == true )
+    {
+        ChannelScan.Settling = false;
+        ChannelScan.SenseStart = TimerGetCurrentTime( );
+    }
+
+    if( RadioRssi( MODEM_FSK ) > ChannelScan.RssiThresh )
+    {
+        // Channel busy, sense the next candidate
+        ChannelScan.Index++;
+        if( ChannelScan.Index < ChannelScan.NbFreqs )
+        {
+            RadioChannelScanNext( );
+        }
+        else
+        {
+            RadioChannelScanDone( -1 );
+        }
+        return;
+    }
+
+    if( TimerGetElapsedTime( ChannelScan.SenseStart ) >= ChannelScan.SenseTime )
+    {
+        RadioChannelScanDone( ( int8_t )ChannelScan.Index );
+        return;
+    }
+    TimerSetValue( &ChannelScanTimer, RADIO_CHANNEL_SCAN_SAMPLE_PERIOD );
+    TimerStart( &ChannelScanTimer );
+}
+
 static uint32_t RadioRandom( void )
 {
     uint32_t rnd = 0;
@@ -1072,7 +1244,7 @@ static void RadioSetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
 
 
 
-    SubgRf.AntSwitchPaSelect = SUBGRF_SetRfTxPower( power );
+    SubgRf.AntSwitchPaSelect = RadioSetRfTxPower( power );
     RFW_SetAntSwitch( SubgRf.AntSwitchPaSelect ); /* ST_WORKAROUND: ?????? */
     SubgRf.TxTimeout = timeout;
 }
@@ -1341,6 +1513,9 @@ static void RadioSleep( void )
 {
     SleepParams_t params = { 0 };
 
+    TimerStop( &ChannelScanTimer );
+    ChannelScan.SamplePending = false;
+
     params.Fields.WarmStart = 1;
     SUBGRF_SetSleep( params );
 
@@ -1449,7 +1624,7 @@ static void RadioSetTxContinuousWave( uint32_t freq, int8_t power, uint16_t time
 
     SUBGRF_SetRfFrequency( freq );
 
-    antswitchpow = SUBGRF_SetRfTxPower( power );
+    antswitchpow = RadioSetRfTxPower( power );
 
     /* Set RF switch */
     SUBGRF_SetSwitch(antswitchpow, RFSWITCH_TX);
@@ -1571,8 +1746,19 @@ static void RadioIrqProcess( void )
 {
     uint8_t size = 0;
     int32_t cfo = 0;
+    RadioIrqMasks_t radioIrq = SubgRf.RadioIrq;
+
+    // Consumed, a channel scan sample runs this processing as well and must
+    // not replay the last radio interrupt
+    SubgRf.RadioIrq = IRQ_RADIO_NONE;
 
-    switch ( SubgRf.RadioIrq )
+    if( ChannelScan.SamplePending == true )
+    {
+        ChannelScan.SamplePending = false;
+        RadioChannelScanSample( );
+    }
+
+    switch ( radioIrq )
     {
     case IRQ_TX_DONE:
         /* ST_WORKAROUND_BEGIN: Reset DBG pin */
@@ -1737,11 +1923,49 @@ static void RadioTxPrbs( void )
 
 static void RadioTxCw( int8_t power )
 {
-    uint8_t paselect = SUBGRF_SetRfTxPower( power );
+    uint8_t paselect = RadioSetRfTxPower( power );
     SUBGRF_SetSwitch( paselect, RFSWITCH_TX );
     SUBGRF_SetTxContinuousWave( );
 }
 
+static void RadioOnOperatingMode( RadioOperatingModes_t mode )
+{
+    RadioPowerState_t state;
+
+    switch( mode )
+    {
+        case MODE_SLEEP:
+            state = RADIO_POWER_SLEEP;
+            break;
+        case MODE_TX:
+            state = RADIO_POWER_TX;
+            break;
+        case MODE_RX:
+        case MODE_RX_DC:
+        case MODE_CAD:
+            state = RADIO_POWER_RX;
+            break;
+        default:
+            state = RADIO_POWER_STANDBY;
+            break;
+    }
+
+    if( state != RadioPowerState )
+    {
+        RadioPowerState = state;
+        if( ( RadioEvents != NULL ) && ( RadioEvents->PowerStateChanged != NULL ) )
+        {
+            RadioEvents->PowerStateChanged( state, RadioTxPower );
+        }
+    }
+}
+
+static uint8_t RadioSetRfTxPower( int8_t power )
+{
+    RadioTxPower = power;
+    return SUBGRF_SetRfTxPower( power );
+}
+
 static void payload_integration( uint8_t *outBuffer, uint8_t *inBuffer, uint8_t size )
 {
     uint8_t prevInt = 0;
@@ -2090,7 +2314,7 @@ static int32_t RadioSetTxGenericConfig( GenericModems_t modem, TxConfigGeneric_t
         break;
     }
 
-    SubgRf.AntSwitchPaSelect = SUBGRF_SetRfTxPower( power );
+    SubgRf.AntSwitchPaSelect = RadioSetRfTxPower( power );
     RFW_SetAntSwitch( SubgRf.AntSwitchPaSelect );
     SubgRf.TxTimeout = timeout;
     return 0;
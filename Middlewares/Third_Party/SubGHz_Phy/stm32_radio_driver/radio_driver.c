@@ -50,6 +50,31 @@ typedef struct FskBandwidth_s
     uint32_t bandwidth;
     uint8_t  RegValue;
 } FskBandwidth_t;
+
+/*!
+ * Parameters of the last set command sent to the radio
+ */
+typedef struct RadioShadowCmd_s
+{
+    bool     Valid;
+    uint8_t  Size;
+    uint8_t  Value[9];
+} RadioShadowCmd_t;
+
+/*!
+ * Shadow of the radio configuration programmed over the SUBGHZ SPI
+ */
+typedef struct RadioShadow_s
+{
+    RadioShadowCmd_t PacketType;
+    RadioShadowCmd_t RfFrequency;
+    RadioShadowCmd_t ModulationParams;
+    RadioShadowCmd_t PacketParams;
+    RadioShadowCmd_t PaConfig;
+    RadioShadowCmd_t TxParams;
+    RadioShadowCmd_t Ocp;            /*!< REG_OCP, reset by the radio on each SetPaConfig */
+    bool             TxClampSet;     /*!< REG_TX_CLAMP workaround already applied */
+} RadioShadow_t;
 /* Private define ------------------------------------------------------------*/
 /**
   * @brief drive value used anytime radio is NOT in TX low power mode
@@ -111,6 +136,14 @@ typedef struct FskBandwidth_s
 #define DCDC_ENABLE                 ( 1UL )
 #endif /* DCDC_ENABLE */
 
+/**
+  * @brief Skip set commands whose parameters are already programmed in the radio
+  * @note SUBGRF_SHADOW_ENABLE can be redefined in radio_conf.h
+  */
+#ifndef SUBGRF_SHADOW_ENABLE
+#define SUBGRF_SHADOW_ENABLE        ( 1UL )
+#endif /* SUBGRF_SHADOW_ENABLE */
+
 /* Private macro -------------------------------------------------------------*/
 
 #define SX_FREQ_TO_CHANNEL( channel, freq )                                  \
@@ -145,6 +178,16 @@ volatile uint32_t FrequencyError = 0;
  */
 static bool ImageCalibrated = false;
 
+/*!
+ * \brief Shadow of the radio configuration
+ */
+static RadioShadow_t Shadow;
+
+/*!
+ * \brief SUBGHZ SPI traffic counters
+ */
+static SubgRfSpiStats_t SpiStats;
+
 /*!
  * Precomputed FSK bandwidth registers values
  */
@@ -181,11 +224,23 @@ static const FskBandwidth_t FskBandwidths[] =
  */
 static void Radio_SMPS_Set( uint8_t level );
 
+/*!
+ * \brief Records the operating mode and reports its changes
+ *
+ * \param [IN] mode New operating mode
+ */
+static void SUBGRF_SetOperatingMode( RadioOperatingModes_t mode );
+
 /*!
  * \brief IRQ Callback radio function
  */
 static DioIrqHandler RadioOnDioIrqCb;
 
+/*!
+ * \brief Operating mode change callback
+ */
+static OperatingModeHandler RadioOnOperatingModeCb = NULL;
+
 /*!
  * \brief Write command to the radio
  *
@@ -205,6 +260,30 @@ static void SUBGRF_WriteCommand( SUBGHZ_RadioSetCmd_t Command, uint8_t *pBuffer,
 static void SUBGRF_ReadCommand( SUBGHZ_RadioGetCmd_t Command, uint8_t *pBuffer,
                                         uint16_t Size );
 
+/*!
+ * \brief Compares a set command with the shadow and updates the shadow
+ *
+ * \param [in]  shadow        Shadow of the command
+ * \param [in]  buffer        Command parameters about to be sent
+ * \param [in]  size          Size in byte of the command parameters
+ * \param [in]  wireSize      Bytes saved on the SPI if the command is skipped
+ *
+ * \retval skip               [true: radio already holds these parameters]
+ */
+static bool SUBGRF_ShadowMatch( RadioShadowCmd_t *shadow, uint8_t *buffer, uint8_t size, uint8_t wireSize );
+
+/*!
+ * \brief Latches the SPI bytes spent since the previous Tx/Rx start
+ *
+ * \param [out] setupBytes    Counter receiving the setup cost
+ */
+static void SUBGRF_LatchSetupBytes( uint16_t *setupBytes );
+
+/*!
+ * \brief Drops the shadow of the registers that are not retained in sleep
+ */
+static void SUBGRF_InvalidateRegisterShadow( void );
+
 /* Exported functions ---------------------------------------------------------*/
 void SUBGRF_Init( DioIrqHandler dioIrq )
 {
@@ -215,6 +294,8 @@ void SUBGRF_Init( DioIrqHandler dioIrq )
 
     RADIO_INIT();
 
+    SUBGRF_InvalidateShadow( );
+
     /* set default SMPS current drive to default*/
     Radio_SMPS_Set(SMPS_DRIVE_SETTING_DEFAULT);
 
@@ -241,7 +322,7 @@ void SUBGRF_Init( DioIrqHandler dioIrq )
     /* Init RF Switch */
     RBI_Init();
 
-    OperatingMode = MODE_STDBY_RC;
+    SUBGRF_SetOperatingMode( MODE_STDBY_RC );
 }
 
 RadioOperatingModes_t SUBGRF_GetOperatingMode( void )
@@ -249,6 +330,11 @@ RadioOperatingModes_t SUBGRF_GetOperatingMode( void )
     return OperatingMode;
 }
 
+void SUBGRF_SetOperatingModeHandler( OperatingModeHandler handler )
+{
+    RadioOnOperatingModeCb = handler;
+}
+
 void SUBGRF_SetPayload( uint8_t *payload, uint8_t size )
 {
     SUBGRF_WriteBuffer( 0x00, payload, size );
@@ -370,7 +456,17 @@ void SUBGRF_SetSleep( SleepParams_t sleepConfig )
                       ( ( uint8_t )sleepConfig.Fields.Reset << 1 ) |
                       ( ( uint8_t )sleepConfig.Fields.WakeUpRTC ) );
     SUBGRF_WriteCommand( RADIO_SET_SLEEP, &value, 1 );
-    OperatingMode = MODE_SLEEP;
+    SUBGRF_SetOperatingMode( MODE_SLEEP );
+
+    if( sleepConfig.Fields.WarmStart == 0 )
+    {
+        // Cold start: the whole configuration is lost
+        SUBGRF_InvalidateShadow( );
+    }
+    else
+    {
+        SUBGRF_InvalidateRegisterShadow( );
+    }
 }
 
 void SUBGRF_SetStandby( RadioStandbyModes_t standbyConfig )
@@ -378,49 +474,51 @@ void SUBGRF_SetStandby( RadioStandbyModes_t standbyConfig )
     SUBGRF_WriteCommand( RADIO_SET_STANDBY, ( uint8_t* )&standbyConfig, 1 );
     if( standbyConfig == STDBY_RC )
     {
-        OperatingMode = MODE_STDBY_RC;
+        SUBGRF_SetOperatingMode( MODE_STDBY_RC );
     }
     else
     {
-        OperatingMode = MODE_STDBY_XOSC;
+        SUBGRF_SetOperatingMode( MODE_STDBY_XOSC );
     }
 }
 
 void SUBGRF_SetFs( void )
 {
     SUBGRF_WriteCommand( RADIO_SET_FS, 0, 0 );
-    OperatingMode = MODE_FS;
+    SUBGRF_SetOperatingMode( MODE_FS );
 }
 
 void SUBGRF_SetTx( uint32_t timeout )
 {
     uint8_t buf[3];
 
-    OperatingMode = MODE_TX;
+    SUBGRF_SetOperatingMode( MODE_TX );
 
     buf[0] = ( uint8_t )( ( timeout >> 16 ) & 0xFF );
     buf[1] = ( uint8_t )( ( timeout >> 8 ) & 0xFF );
     buf[2] = ( uint8_t )( timeout & 0xFF );
     SUBGRF_WriteCommand( RADIO_SET_TX, buf, 3 );
+    SUBGRF_LatchSetupBytes( &SpiStats.LastTxSetupBytes );
 }
 
 void SUBGRF_SetRx( uint32_t timeout )
 {
     uint8_t buf[3];
 
-    OperatingMode = MODE_RX;
+    SUBGRF_SetOperatingMode( MODE_RX );
 
     buf[0] = ( uint8_t )( ( timeout >> 16 ) & 0xFF );
     buf[1] = ( uint8_t )( ( timeout >> 8 ) & 0xFF );
     buf[2] = ( uint8_t )( timeout & 0xFF );
     SUBGRF_WriteCommand( RADIO_SET_RX, buf, 3 );
+    SUBGRF_LatchSetupBytes( &SpiStats.LastRxSetupBytes );
 }
 
 void SUBGRF_SetRxBoosted( uint32_t timeout )
 {
     uint8_t buf[3];
 
-    OperatingMode = MODE_RX;
+    SUBGRF_SetOperatingMode( MODE_RX );
 
     /* ST_WORKAROUND_BEGIN: Sigfox patch > 0x96 replaced by 0x97 */
     SUBGRF_WriteRegister( REG_RX_GAIN, 0x97 ); // max LNA gain, increase current by ~2mA for around ~3dB in sensitivity
@@ -430,6 +528,7 @@ void SUBGRF_SetRxBoosted( uint32_t timeout )
     buf[1] = ( uint8_t )( ( timeout >> 8 ) & 0xFF );
     buf[2] = ( uint8_t )( timeout & 0xFF );
     SUBGRF_WriteCommand( RADIO_SET_RX, buf, 3 );
+    SUBGRF_LatchSetupBytes( &SpiStats.LastRxSetupBytes );
 }
 
 void SUBGRF_SetRxDutyCycle( uint32_t rxTime, uint32_t sleepTime )
@@ -443,23 +542,26 @@ void SUBGRF_SetRxDutyCycle( uint32_t rxTime, uint32_t sleepTime )
     buf[4] = ( uint8_t )( ( sleepTime >> 8 ) & 0xFF );
     buf[5] = ( uint8_t )( sleepTime & 0xFF );
     SUBGRF_WriteCommand( RADIO_SET_RXDUTYCYCLE, buf, 6 );
-    OperatingMode = MODE_RX_DC;
+    SUBGRF_LatchSetupBytes( &SpiStats.LastRxSetupBytes );
+    SUBGRF_SetOperatingMode( MODE_RX_DC );
 }
 
 void SUBGRF_SetCad( void )
 {
     SUBGRF_WriteCommand( RADIO_SET_CAD, 0, 0 );
-    OperatingMode = MODE_CAD;
+    SUBGRF_SetOperatingMode( MODE_CAD );
 }
 
 void SUBGRF_SetTxContinuousWave( void )
 {
     SUBGRF_WriteCommand( RADIO_SET_TXCONTINUOUSWAVE, 0, 0 );
+    SUBGRF_SetOperatingMode( MODE_TX );
 }
 
 void SUBGRF_SetTxInfinitePreamble( void )
 {
     SUBGRF_WriteCommand( RADIO_SET_TXCONTINUOUSPREAMBLE, 0, 0 );
+    SUBGRF_SetOperatingMode( MODE_TX );
 }
 
 void SUBGRF_SetStopRxTimerOnPreambleDetect( bool enable )
@@ -558,7 +660,13 @@ void SUBGRF_SetPaConfig( uint8_t paDutyCycle, uint8_t hpMax, uint8_t deviceSel,
     buf[1] = hpMax;
     buf[2] = deviceSel;
     buf[3] = paLut;
+    if( SUBGRF_ShadowMatch( &Shadow.PaConfig, buf, 4, 5 ) == true )
+    {
+        return;
+    }
     SUBGRF_WriteCommand( RADIO_SET_PACONFIG, buf, 4 );
+    // The radio restores the default over current protection on each SetPaConfig
+    Shadow.Ocp.Valid = false;
 }
 
 void SUBGRF_SetRxTxFallbackMode( uint8_t fallbackMode )
@@ -618,19 +726,32 @@ void SUBGRF_SetRfFrequency( uint32_t frequency )
     buf[1] = ( uint8_t )( ( chan >> 16 ) & 0xFF );
     buf[2] = ( uint8_t )( ( chan >> 8 ) & 0xFF );
     buf[3] = ( uint8_t )( chan & 0xFF );
+    if( SUBGRF_ShadowMatch( &Shadow.RfFrequency, buf, 4, 5 ) == true )
+    {
+        return;
+    }
     SUBGRF_WriteCommand( RADIO_SET_RFFREQUENCY, buf, 4 );
 }
 
 void SUBGRF_SetPacketType( RadioPacketTypes_t packetType )
 {
+    uint8_t type = ( uint8_t )packetType;
+
     // Save packet type internally to avoid questioning the radio
     PacketType = packetType;
 
+    if( SUBGRF_ShadowMatch( &Shadow.PacketType, &type, 1, ( packetType == PACKET_TYPE_GFSK ) ? 6 : 2 ) == true )
+    {
+        return;
+    }
     if( packetType == PACKET_TYPE_GFSK )
     {
         SUBGRF_WriteRegister( REG_BIT_SYNC, 0x00 );
     }
-    SUBGRF_WriteCommand( RADIO_SET_PACKETTYPE, ( uint8_t* )&packetType, 1 );
+    SUBGRF_WriteCommand( RADIO_SET_PACKETTYPE, &type, 1 );
+    // Modulation and packet parameters have to be programmed again for the new packet type
+    Shadow.ModulationParams.Valid = false;
+    Shadow.PacketParams.Valid = false;
 }
 
 RadioPacketTypes_t SUBGRF_GetPacketType( void )
@@ -641,6 +762,7 @@ RadioPacketTypes_t SUBGRF_GetPacketType( void )
 void SUBGRF_SetTxParams( uint8_t paSelect, int8_t power, RadioRampTimes_t rampTime ) 
 {
     uint8_t buf[2];
+    uint8_t ocp;
 
     if( paSelect == RFO_LP )
     {
@@ -660,13 +782,23 @@ void SUBGRF_SetTxParams( uint8_t paSelect, int8_t power, RadioRampTimes_t rampTi
         {
             power = -17;
         }
-        SUBGRF_WriteRegister( REG_OCP, 0x18 ); // current max is 80 mA for the whole device
+        ocp = 0x18; // current max is 80 mA for the whole device
     }
     else // rfo_hp
     {
         // WORKAROUND - Better Resistance of the SX1262 Tx to Antenna Mismatch, see DS_SX1261-2_V1.2 datasheet chapter 15.2
         // RegTxClampConfig = @address 0x08D8
-        SUBGRF_WriteRegister( REG_TX_CLAMP, SUBGRF_ReadRegister( REG_TX_CLAMP ) | ( 0x0F << 1 ) );
+        if( ( SUBGRF_SHADOW_ENABLE == 0 ) || ( Shadow.TxClampSet == false ) )
+        {
+            SUBGRF_WriteRegister( REG_TX_CLAMP, SUBGRF_ReadRegister( REG_TX_CLAMP ) | ( 0x0F << 1 ) );
+            Shadow.TxClampSet = true;
+        }
+        else
+        {
+            // Read (5 bytes) and write (4 bytes) skipped
+            SpiStats.ElidedBytes += 9;
+            SpiStats.ElidedCommands += 2;
+        }
         // WORKAROUND END
 
         SUBGRF_SetPaConfig( 0x04, 0x07, 0x00, 0x01 );
@@ -678,10 +810,18 @@ void SUBGRF_SetTxParams( uint8_t paSelect, int8_t power, RadioRampTimes_t rampTi
         {
             power = -9;
         }
-        SUBGRF_WriteRegister( REG_OCP, 0x38 ); // current max 160mA for the whole device
+        ocp = 0x38; // current max 160mA for the whole device
+    }
+    if( SUBGRF_ShadowMatch( &Shadow.Ocp, &ocp, 1, 4 ) == false )
+    {
+        SUBGRF_WriteRegister( REG_OCP, ocp );
     }
     buf[0] = power;
     buf[1] = ( uint8_t )rampTime;
+    if( SUBGRF_ShadowMatch( &Shadow.TxParams, buf, 2, 3 ) == true )
+    {
+        return;
+    }
     SUBGRF_WriteCommand( RADIO_SET_TXPARAMS, buf, 2 );
 }
 
@@ -714,7 +854,6 @@ void SUBGRF_SetModulationParams( ModulationParams_t *modulationParams )
         buf[5] = ( tempVal >> 16 ) & 0xFF;
         buf[6] = ( tempVal >> 8 ) & 0xFF;
         buf[7] = ( tempVal& 0xFF );
-        SUBGRF_WriteCommand( RADIO_SET_MODULATIONPARAMS, buf, n );
         break;
     case PACKET_TYPE_BPSK:
         n = 4;
@@ -723,7 +862,6 @@ void SUBGRF_SetModulationParams( ModulationParams_t *modulationParams )
         buf[1] = ( tempVal >> 8 ) & 0xFF;
         buf[2] = tempVal & 0xFF;
         buf[3] = modulationParams->Params.Bpsk.ModulationShaping;
-        SUBGRF_WriteCommand( RADIO_SET_MODULATIONPARAMS, buf, n );
         break;
     case PACKET_TYPE_LORA:
         n = 4;
@@ -732,8 +870,6 @@ void SUBGRF_SetModulationParams( ModulationParams_t *modulationParams )
         buf[2] = modulationParams->Params.LoRa.CodingRate;
         buf[3] = modulationParams->Params.LoRa.LowDatarateOptimize;
 
-        SUBGRF_WriteCommand( RADIO_SET_MODULATIONPARAMS, buf, n );
-
         break;
     case PACKET_TYPE_GMSK:
         n = 5;
@@ -743,12 +879,16 @@ void SUBGRF_SetModulationParams( ModulationParams_t *modulationParams )
         buf[2] = tempVal & 0xFF;
         buf[3] = modulationParams->Params.Gfsk.ModulationShaping;
         buf[4] = modulationParams->Params.Gfsk.Bandwidth;
-        SUBGRF_WriteCommand( RADIO_SET_MODULATIONPARAMS, buf, n );
         break;
     default:
     case PACKET_TYPE_NONE:
-      break;
+      return;
+    }
+    if( SUBGRF_ShadowMatch( &Shadow.ModulationParams, buf, n, n + 1 ) == true )
+    {
+        return;
     }
+    SUBGRF_WriteCommand( RADIO_SET_MODULATIONPARAMS, buf, n );
 }
 
 void SUBGRF_SetPacketParams( PacketParams_t *packetParams )
@@ -812,6 +952,10 @@ void SUBGRF_SetPacketParams( PacketParams_t *packetParams )
     case PACKET_TYPE_NONE:
         return;
     }
+    if( SUBGRF_ShadowMatch( &Shadow.PacketParams, buf, n, n + 1 ) == true )
+    {
+        return;
+    }
     SUBGRF_WriteCommand( RADIO_SET_PACKETPARAMS, buf, n );
 }
 
@@ -827,7 +971,7 @@ void SUBGRF_SetCadParams( RadioLoRaCadSymbols_t cadSymbolNum, uint8_t cadDetPeak
     buf[5] = ( uint8_t )( ( cadTimeout >> 8 ) & 0xFF );
     buf[6] = ( uint8_t )( cadTimeout & 0xFF );
     SUBGRF_WriteCommand( RADIO_SET_CADPARAMS, buf, 7 );
-    OperatingMode = MODE_CAD;
+    SUBGRF_SetOperatingMode( MODE_CAD );
 }
 
 void SUBGRF_SetBufferBaseAddress( uint8_t txBaseAddress, uint8_t rxBaseAddress )
@@ -949,12 +1093,16 @@ void SUBGRF_ClearIrqStatus( uint16_t irq )
 
 void SUBGRF_WriteRegister( uint16_t addr, uint8_t data )
 {
+    SpiStats.TotalBytes += 4;
+    SpiStats.SetupBytes += 4;
     HAL_SUBGHZ_WriteRegisters( &hsubghz, addr, (uint8_t*)&data, 1 );
 }
 
 uint8_t SUBGRF_ReadRegister( uint16_t addr )
 {
     uint8_t data;
+    SpiStats.TotalBytes += 5;
+    SpiStats.SetupBytes += 5;
     HAL_SUBGHZ_ReadRegisters( &hsubghz, addr, &data, 1 );
     return data;
 }
@@ -962,6 +1110,8 @@ uint8_t SUBGRF_ReadRegister( uint16_t addr )
 void SUBGRF_WriteRegisters( uint16_t address, uint8_t *buffer, uint16_t size )
 {
     CRITICAL_SECTION_BEGIN();
+    SpiStats.TotalBytes += 3 + size;
+    SpiStats.SetupBytes += 3 + size;
     HAL_SUBGHZ_WriteRegisters( &hsubghz, address, buffer, size );
     CRITICAL_SECTION_END();
 }
@@ -969,6 +1119,8 @@ void SUBGRF_WriteRegisters( uint16_t address, uint8_t *buffer, uint16_t size )
 void SUBGRF_ReadRegisters( uint16_t address, uint8_t *buffer, uint16_t size )
 {
     CRITICAL_SECTION_BEGIN();
+    SpiStats.TotalBytes += 4 + size;
+    SpiStats.SetupBytes += 4 + size;
     HAL_SUBGHZ_ReadRegisters( &hsubghz, address, buffer, size );
     CRITICAL_SECTION_END();
 }
@@ -976,6 +1128,8 @@ void SUBGRF_ReadRegisters( uint16_t address, uint8_t *buffer, uint16_t size )
 void SUBGRF_WriteBuffer( uint8_t offset, uint8_t *buffer, uint8_t size )
 {
     CRITICAL_SECTION_BEGIN();
+    SpiStats.TotalBytes += 2 + size;
+    SpiStats.SetupBytes += 2 + size;
     HAL_SUBGHZ_WriteBuffer( &hsubghz, offset, buffer, size );
     CRITICAL_SECTION_END();
 }
@@ -983,6 +1137,8 @@ void SUBGRF_WriteBuffer( uint8_t offset, uint8_t *buffer, uint8_t size )
 void SUBGRF_ReadBuffer( uint8_t offset, uint8_t *buffer, uint8_t size )
 {
     CRITICAL_SECTION_BEGIN();
+    SpiStats.TotalBytes += 3 + size;
+    SpiStats.SetupBytes += 3 + size;
     HAL_SUBGHZ_ReadBuffer( &hsubghz, offset, buffer, size );
     CRITICAL_SECTION_END();
 }
@@ -991,6 +1147,8 @@ void SUBGRF_WriteCommand( SUBGHZ_RadioSetCmd_t Command, uint8_t *pBuffer,
                                         uint16_t Size )
 {
     CRITICAL_SECTION_BEGIN();
+    SpiStats.TotalBytes += 1 + Size;
+    SpiStats.SetupBytes += 1 + Size;
     HAL_SUBGHZ_ExecSetCmd( &hsubghz, Command, pBuffer, Size );
     CRITICAL_SECTION_END();
 }
@@ -999,6 +1157,8 @@ void SUBGRF_ReadCommand( SUBGHZ_RadioGetCmd_t Command, uint8_t *pBuffer,
                                         uint16_t Size )
 {
     CRITICAL_SECTION_BEGIN();
+    SpiStats.TotalBytes += 2 + Size;
+    SpiStats.SetupBytes += 2 + Size;
     HAL_SUBGHZ_ExecGetCmd( &hsubghz, Command, pBuffer, Size );
     CRITICAL_SECTION_END();
 }
@@ -1073,6 +1233,25 @@ uint32_t SUBGRF_GetRadioWakeUpTime( void )
     return RF_WAKEUP_TIME;
 }
 
+void SUBGRF_InvalidateShadow( void )
+{
+    RADIO_MEMSET8( &Shadow, 0, sizeof( RadioShadow_t ) );
+}
+
+void SUBGRF_GetSpiStats( SubgRfSpiStats_t *stats )
+{
+    CRITICAL_SECTION_BEGIN();
+    *stats = SpiStats;
+    CRITICAL_SECTION_END();
+}
+
+void SUBGRF_ResetSpiStats( void )
+{
+    CRITICAL_SECTION_BEGIN();
+    RADIO_MEMSET8( &SpiStats, 0, sizeof( SubgRfSpiStats_t ) );
+    CRITICAL_SECTION_END();
+}
+
 /* HAL_SUBGHz Callbacks definitions */ 
 void HAL_SUBGHZ_TxCpltCallback(SUBGHZ_HandleTypeDef *hsubghz)
 {
@@ -1140,6 +1319,55 @@ static void Radio_SMPS_Set(uint8_t level)
   }
 }
 
+static bool SUBGRF_ShadowMatch( RadioShadowCmd_t *shadow, uint8_t *buffer, uint8_t size, uint8_t wireSize )
+{
+    uint8_t i;
+    bool match = ( SUBGRF_SHADOW_ENABLE != 0 ) && ( shadow->Valid == true ) && ( shadow->Size == size );
+
+    for( i = 0; ( match == true ) && ( i < size ); i++ )
+    {
+        match = ( shadow->Value[i] == buffer[i] );
+    }
+
+    if( match == true )
+    {
+        SpiStats.ElidedBytes += wireSize;
+        SpiStats.ElidedCommands++;
+        return true;
+    }
+
+    for( i = 0; i < size; i++ )
+    {
+        shadow->Value[i] = buffer[i];
+    }
+    shadow->Size = size;
+    shadow->Valid = true;
+    return false;
+}
+
+static void SUBGRF_LatchSetupBytes( uint16_t *setupBytes )
+{
+    *setupBytes = SpiStats.SetupBytes;
+    SpiStats.SetupBytes = 0;
+}
+
+static void SUBGRF_InvalidateRegisterShadow( void )
+{
+    Shadow.Ocp.Valid = false;
+    Shadow.TxClampSet = false;
+}
+
+static void SUBGRF_SetOperatingMode( RadioOperatingModes_t mode )
+{
+    bool changed = ( mode != OperatingMode );
+
+    OperatingMode = mode;
+    if( ( changed == true ) && ( RadioOnOperatingModeCb != NULL ) )
+    {
+        RadioOnOperatingModeCb( mode );
+    }
+}
+
 uint8_t SUBGRF_GetFskBandwidthRegValue( uint32_t bandwidth )
 {
     uint8_t i;
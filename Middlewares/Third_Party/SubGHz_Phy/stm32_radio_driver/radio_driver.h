@@ -773,6 +773,28 @@ typedef enum
  */
 typedef void ( *DioIrqHandler )( RadioIrqMasks_t radioIrq );
 
+/*!
+ * Operating mode change callback function definition
+ */
+typedef void ( *OperatingModeHandler )( RadioOperatingModes_t mode );
+
+/*!
+ * \brief SUBGHZ SPI traffic counters
+ *
+ * Bytes are counted on the wire (opcode, address and status bytes included).
+ * The setup counters hold the bytes sent since the previous Tx/Rx start up to
+ * and including the last SUBGRF_SetTx/SUBGRF_SetRx* call.
+ */
+typedef struct
+{
+    uint32_t TotalBytes;                            //!< All bytes exchanged since reset of the counters
+    uint32_t ElidedBytes;                           //!< Bytes not sent because the shadow matched
+    uint32_t ElidedCommands;                        //!< Set commands/register writes skipped
+    uint16_t SetupBytes;                            //!< Bytes since the last Tx/Rx start
+    uint16_t LastTxSetupBytes;                      //!< Bytes needed to configure and start the last Tx
+    uint16_t LastRxSetupBytes;                      //!< Bytes needed to configure and start the last Rx
+}SubgRfSpiStats_t;
+
 
 
 #define RX_BUFFER_SIZE                              256
@@ -799,6 +821,13 @@ void SUBGRF_Init( DioIrqHandler dioIrq );
  */
 RadioOperatingModes_t SUBGRF_GetOperatingMode( void );
 
+/*!
+ * \brief  Sets the callback called on every change of the operating mode
+ *
+ * \param [IN] handler Callback, NULL to disable it
+ */
+void SUBGRF_SetOperatingModeHandler( OperatingModeHandler handler );
+
 /*!
  * \brief Saves the payload to be send in the radio buffer
  *
@@ -1230,6 +1259,26 @@ uint8_t SUBGRF_GetFskBandwidthRegValue( uint32_t bandwidth );
  */
 void SUBGRF_GetCFO( uint32_t BitRate, int32_t * Cfo);
 
+/*!
+ * \brief Drops the shadow of the radio configuration
+ *
+ * \remark Must be called if the radio configuration may have been lost
+ *         outside of this driver (e.g. radio reset by another core)
+ */
+void SUBGRF_InvalidateShadow( void );
+
+/*!
+ * \brief Gets the SUBGHZ SPI traffic counters
+ *
+ * \param [out] stats          Counters snapshot
+ */
+void SUBGRF_GetSpiStats( SubgRfSpiStats_t *stats );
+
+/*!
+ * \brief Resets the SUBGHZ SPI traffic counters
+ */
+void SUBGRF_ResetSpiStats( void );
+
 #ifdef __cplusplus
 }
 #endif
@@ -42,6 +42,7 @@ typedef struct
     uint16_t CrcPolynomial;            /* Init Crc polynomial, to set before running RFW_CrcRun*/
     uint16_t CrcSeed;                  /* Init Crc seed to set before running RFW_CrcRun*/
     RADIO_FSK_CrcTypes_t CrcType;      /* Init Crc types to set before running RFW_CrcRun*/
+    const uint16_t* CrcTable;          /* Byte Crc table of CrcPolynomial, NULL when computed bit per bit*/
     uint16_t WhiteSeed;                /* Init whitening seed, to set before running Radio_FwWhiteRun*/
     uint16_t LongPacketMaxRxLength;    /* Maximum expected amount of bytes in payload*/
     RadioModems_t Modem;
@@ -52,8 +53,8 @@ typedef struct
 {
     RFwInit_t Init;                    /*Init structure, set at Rx or Tx config*/
     uint16_t CrcLfsrState;             /*State of LFSR crc, set from CrcSeed at beginning of each payload*/
-    uint16_t WhiteLfsrState;           /*State of LFSR whitening, set from WhiteSeed at beginning of each payload
-                                         use to save LFSR state after rx payload length de-withening*/
+    uint16_t WhiteKeystreamIndex;      /*Position in WhiteKeystream, set to 0 at beginning of each payload
+                                         use to save whitening state after rx payload length de-withening*/
     uint16_t PayloadLength;            /*In Rx, Payload length is first byte(s) of the payload excluding CrcFieldSize and PayloadLengthFieldSize*/
     uint8_t LongPacketModeEnable;      /* set to one when RFW_TransmitLongPacket or RFW_ReceiveLongPacket. 0 otherwise*/
     TimerEvent_t Timer;                /*Timer to get/Set Rx(Tx)Bytes*/
@@ -66,6 +67,7 @@ typedef struct
     uint32_t BitRate;
     TimerEvent_t* RxTimeoutTimer;
     TimerEvent_t* TxTimeoutTimer;
+    uint32_t ChunkCyclesMax;           /* Longest chunk processing in RFW_GET_CYCLES unit, see RFW_GetChunkCyclesMax*/
 } RadioFw_t;
 
 /* Private define ------------------------------------------------------------*/
@@ -74,6 +76,10 @@ typedef struct
 
 #define LONGPACKET_CHUNK_LENGTH_BYTES ((int32_t) 128) //bytes (half Radio fifo)
 
+/* whitening keystream: first byte, then the 511 bytes period of the 9 bits LFSR*/
+#define WHITE_KEYSTREAM_SIZE 512 //bytes
+#define WHITE_KEYSTREAM_LOOP 1   //index where the period restarts
+
 /* Private macro -------------------------------------------------------------*/
 /**
   * @brief Calculates ceiling division of ( X / N )
@@ -109,6 +115,10 @@ typedef struct
 #ifndef RFW_TRANSMIT_LONGPACKET_TX_CHUNK_PROCESS
 #define RFW_TRANSMIT_LONGPACKET_TX_CHUNK_PROCESS() RFW_TransmitLongPacket_TxChunkProcess()
 #endif
+/*can be overridden in radio_conf.h, e.g. with DWT->CYCCNT, to measure the chunk processing time*/
+#ifndef RFW_GET_CYCLES
+#define RFW_GET_CYCLES() 0U
+#endif
 
 #ifndef RFW_MW_LOG_ENABLE
 #define RFW_MW_LOG(...)
@@ -143,11 +153,85 @@ static RadioFw_t RFWPacket={0};
 static uint8_t ChunkBuffer[RADIO_BUF_SIZE];
 /*Radio buffer chunk for packet <=RADIO_BUF_SIZE and */
 static uint8_t RxBuffer[RADIO_BUF_SIZE];
+/*(De-)whitening bytes, computed from the seed at init so that chunks only xor them*/
+static uint8_t WhiteKeystream[WHITE_KEYSTREAM_SIZE];
+/*Crc of one byte with CRC_POLYNOMIAL_IBM, msb first*/
+static const uint16_t CrcTableIbm[256]=
+{
+  0x0000, 0x8005, 0x800F, 0x000A, 0x801B, 0x001E, 0x0014, 0x8011,
+  0x8033, 0x0036, 0x003C, 0x8039, 0x0028, 0x802D, 0x8027, 0x0022,
+  0x8063, 0x0066, 0x006C, 0x8069, 0x0078, 0x807D, 0x8077, 0x0072,
+  0x0050, 0x8055, 0x805F, 0x005A, 0x804B, 0x004E, 0x0044, 0x8041,
+  0x80C3, 0x00C6, 0x00CC, 0x80C9, 0x00D8, 0x80DD, 0x80D7, 0x00D2,
+  0x00F0, 0x80F5, 0x80FF, 0x00FA, 0x80EB, 0x00EE, 0x00E4, 0x80E1,
+  0x00A0, 0x80A5, 0x80AF, 0x00AA, 0x80BB, 0x00BE, 0x00B4, 0x80B1,
+  0x8093, 0x0096, 0x009C, 0x8099, 0x0088, 0x808D, 0x8087, 0x0082,
+  0x8183, 0x0186, 0x018C, 0x8189, 0x0198, 0x819D, 0x8197, 0x0192,
+  0x01B0, 0x81B5, 0x81BF, 0x01BA, 0x81AB, 0x01AE, 0x01A4, 0x81A1,
+  0x01E0, 0x81E5, 0x81EF, 0x01EA, 0x81FB, 0x01FE, 0x01F4, 0x81F1,
+  0x81D3, 0x01D6, 0x01DC, 0x81D9, 0x01C8, 0x81CD, 0x81C7, 0x01C2,
+  0x0140, 0x8145, 0x814F, 0x014A, 0x815B, 0x015E, 0x0154, 0x8151,
+  0x8173, 0x0176, 0x017C, 0x8179, 0x0168, 0x816D, 0x8167, 0x0162,
+  0x8123, 0x0126, 0x012C, 0x8129, 0x0138, 0x813D, 0x8137, 0x0132,
+  0x0110, 0x8115, 0x811F, 0x011A, 0x810B, 0x010E, 0x0104, 0x8101,
+  0x8303, 0x0306, 0x030C, 0x8309, 0x0318, 0x831D, 0x8317, 0x0312,
+  0x0330, 0x8335, 0x833F, 0x033A, 0x832B, 0x032E, 0x0324, 0x8321,
+  0x0360, 0x8365, 0x836F, 0x036A, 0x837B, 0x037E, 0x0374, 0x8371,
+  0x8353, 0x0356, 0x035C, 0x8359, 0x0348, 0x834D, 0x8347, 0x0342,
+  0x03C0, 0x83C5, 0x83CF, 0x03CA, 0x83DB, 0x03DE, 0x03D4, 0x83D1,
+  0x83F3, 0x03F6, 0x03FC, 0x83F9, 0x03E8, 0x83ED, 0x83E7, 0x03E2,
+  0x83A3, 0x03A6, 0x03AC, 0x83A9, 0x03B8, 0x83BD, 0x83B7, 0x03B2,
+  0x0390, 0x8395, 0x839F, 0x039A, 0x838B, 0x038E, 0x0384, 0x8381,
+  0x0280, 0x8285, 0x828F, 0x028A, 0x829B, 0x029E, 0x0294, 0x8291,
+  0x82B3, 0x02B6, 0x02BC, 0x82B9, 0x02A8, 0x82AD, 0x82A7, 0x02A2,
+  0x82E3, 0x02E6, 0x02EC, 0x82E9, 0x02F8, 0x82FD, 0x82F7, 0x02F2,
+  0x02D0, 0x82D5, 0x82DF, 0x02DA, 0x82CB, 0x02CE, 0x02C4, 0x82C1,
+  0x8243, 0x0246, 0x024C, 0x8249, 0x0258, 0x825D, 0x8257, 0x0252,
+  0x0270, 0x8275, 0x827F, 0x027A, 0x826B, 0x026E, 0x0264, 0x8261,
+  0x0220, 0x8225, 0x822F, 0x022A, 0x823B, 0x023E, 0x0234, 0x8231,
+  0x8213, 0x0216, 0x021C, 0x8219, 0x0208, 0x820D, 0x8207, 0x0202
+};
+/*Crc of one byte with CRC_POLYNOMIAL_CCITT, msb first*/
+static const uint16_t CrcTableCcitt[256]=
+{
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+  0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+  0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+  0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+  0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+  0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+  0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+  0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+  0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+  0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+  0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+  0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+  0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+  0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+  0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+  0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+  0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+  0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+  0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+  0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+  0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+  0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+  0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+  0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+  0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+  0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+  0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+  0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+  0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+  0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+  0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
 #endif
 /* Private function prototypes -----------------------------------------------*/
 #if (RFW_ENABLE ==1 )
 /**
- * @brief Record the seed of the (de-)Whitening algorithm
+ * @brief Record the seed of the (de-)Whitening algorithm and compute its keystream
  *
  * @param [IN] RFwInit_t      the whitening Init structure
  * @param [IN] WhiteSeed        the Initial seed of the Whitening algorithm
@@ -197,6 +281,13 @@ static void RFW_WhiteRun(RadioFw_t* RFWPacket, uint8_t* Payload, uint32_t Size);
  */
 static int32_t RFW_CrcRun(RadioFw_t* const RFWPacket, const uint8_t* Payload, const uint32_t Size, uint8_t CrcResult[2]);
 
+/**
+ * @brief Record the processing time of a chunk
+ *
+ * @param [IN] StartCycles    RFW_GET_CYCLES value at the beginning of the chunk processing
+ */
+static void RFW_ChunkProfile(uint32_t StartCycles);
+
 /**
  * @brief Compute Crc Byte
  *
@@ -725,6 +816,17 @@ void RFW_SetRadioModem(RadioModems_t Modem)
 #endif
 }
 
+uint32_t RFW_GetChunkCyclesMax(void)
+{
+#if (RFW_ENABLE ==1 )
+  uint32_t cycles= RFWPacket.ChunkCyclesMax;
+  RFWPacket.ChunkCyclesMax= 0;
+  return cycles;
+#else
+  return 0;
+#endif
+}
+
 /* Private Functions Definition -----------------------------------------------*/
 #if (RFW_LONGPACKET_ENABLE ==1 )
 static void RFW_TransmitLongPacket_NewTxChunkTimerEvent( void * param )
@@ -734,6 +836,7 @@ static void RFW_TransmitLongPacket_NewTxChunkTimerEvent( void * param )
 
 static void RFW_TransmitLongPacket_TxChunkProcess( void )
 {
+  uint32_t start_cycles= RFW_GET_CYCLES();
   uint8_t* app_chunk_buffer_ptr=NULL;
   uint8_t chunk_size=0;
   uint8_t crc_result[2]={0};
@@ -811,18 +914,30 @@ static void RFW_TransmitLongPacket_TxChunkProcess( void )
   SUBGRF_WriteRegister(SUBGHZ_RTXPLDLEN, (uint8_t)(chunk_size + write_ptr));
   
   RFW_MW_LOG( TS_ON, VLEVEL_M,  "next chunk size=%d, new write ptr=%d\n\r",chunk_size+ crc_size,  (uint8_t)(chunk_size+ crc_size + write_ptr));
+  RFW_ChunkProfile(start_cycles);
 }
 #endif
 
 #if (RFW_ENABLE ==1 )
 static void RFW_WhiteInitState(RFwInit_t* Init, uint16_t WhiteSeed)
 {
+  /*run the LFSR bit per bit once, out of the chunk processing*/
+  uint16_t ibmwhite_state= WhiteSeed;
   Init->WhiteSeed= WhiteSeed;
+  for(int i=0;i<WHITE_KEYSTREAM_SIZE;i++)
+  {
+    WhiteKeystream[i]= ibmwhite_state&0xFF;
+    for (int j=0; j<8; j++)
+    {
+      uint8_t msb =  ((ibmwhite_state>>5)&0x1)^((ibmwhite_state>>0)&0x1);
+      ibmwhite_state= ((msb<<8) | (ibmwhite_state>>1) );
+    }
+  }
 }
 
 static void RFW_WhiteSetState(RadioFw_t* RFWPacket)
 {
-  RFWPacket->WhiteLfsrState= RFWPacket->Init.WhiteSeed;
+  RFWPacket->WhiteKeystreamIndex= 0;
 }
 
 static void RFW_CrcInitState(RFwInit_t* Init, const uint16_t CrcPolynomial, const uint16_t CrcSeed, const RADIO_FSK_CrcTypes_t CrcType)
@@ -830,6 +945,18 @@ static void RFW_CrcInitState(RFwInit_t* Init, const uint16_t CrcPolynomial, cons
   Init->CrcPolynomial= CrcPolynomial;
   Init->CrcSeed= CrcSeed;
   Init->CrcType= CrcType;
+  if (CrcPolynomial== CRC_POLYNOMIAL_IBM)
+  {
+    Init->CrcTable= CrcTableIbm;
+  }
+  else if (CrcPolynomial== CRC_POLYNOMIAL_CCITT)
+  {
+    Init->CrcTable= CrcTableCcitt;
+  }
+  else
+  {
+    Init->CrcTable= NULL;
+  }
 }
 
 static void RFW_CrcSetState(RadioFw_t* RFWPacket)
@@ -839,18 +966,17 @@ static void RFW_CrcSetState(RadioFw_t* RFWPacket)
 
 static void RFW_WhiteRun(RadioFw_t* RFWPacket, uint8_t* Payload, uint32_t Size)
 {
-  /*run the whitening algo on Size bytes*/
-  uint16_t ibmwhite_state= RFWPacket->WhiteLfsrState;
-  for(int i=0;i<Size;i++)
+  /*run the whitening algo on Size bytes, from where the previous chunk stopped*/
+  uint16_t index= RFWPacket->WhiteKeystreamIndex;
+  for(uint32_t i=0;i<Size;i++)
   {
-    Payload[i]^= ibmwhite_state&0xFF;
-    for (int j=0; j<8; j++)
+    Payload[i]^= WhiteKeystream[index];
+    if (++index== WHITE_KEYSTREAM_SIZE)
     {
-      uint8_t msb =  ((ibmwhite_state>>5)&0x1)^((ibmwhite_state>>0)&0x1);
-      ibmwhite_state= ((msb<<8) | (ibmwhite_state>>1) );
+      index= WHITE_KEYSTREAM_LOOP;
     }
   }
-  RFWPacket->WhiteLfsrState=ibmwhite_state;
+  RFWPacket->WhiteKeystreamIndex=index;
 }
 
 static int32_t RFW_CrcRun(RadioFw_t* const RFWPacket, const uint8_t* Payload, const uint32_t Size, uint8_t CrcResult[2])
@@ -858,11 +984,22 @@ static int32_t RFW_CrcRun(RadioFw_t* const RFWPacket, const uint8_t* Payload, co
   int32_t status=0;
   int32_t i = 0;
   uint16_t polynomial = RFWPacket->Init.CrcPolynomial;
+  const uint16_t* table = RFWPacket->Init.CrcTable;
   /* Restore state from previous chunk*/
   uint16_t crc = RFWPacket->CrcLfsrState;
-  for( i = 0; i < Size; i++ )
+  if( table != NULL )
+  {
+    for( i = 0; i < Size; i++ )
+    {
+      crc = ( crc << 8 ) ^ table[( ( crc >> 8 ) ^ Payload[i] ) & 0xFF];
+    }
+  }
+  else
   {
-    crc = RFW_CrcRun1Byte( crc, Payload[i], polynomial );
+    for( i = 0; i < Size; i++ )
+    {
+      crc = RFW_CrcRun1Byte( crc, Payload[i], polynomial );
+    }
   }
   /*Save state for next chunk*/
   RFWPacket->CrcLfsrState=crc;
@@ -881,6 +1018,15 @@ static int32_t RFW_CrcRun(RadioFw_t* const RFWPacket, const uint8_t* Payload, co
   return status;
 }
 
+static void RFW_ChunkProfile(uint32_t StartCycles)
+{
+  uint32_t cycles= RFW_GET_CYCLES()- StartCycles;
+  if (cycles> RFWPacket.ChunkCyclesMax)
+  {
+    RFWPacket.ChunkCyclesMax= cycles;
+  }
+}
+
 uint16_t RFW_CrcRun1Byte( uint16_t Crc, uint8_t DataByte, uint16_t Polynomial)
 {
   uint8_t i;
@@ -960,6 +1106,7 @@ static void RFW_GetPayloadTimerEvent( void * context)
 
 static void RFW_GetPayloadProcess( void )
 {
+    uint32_t start_cycles= RFW_GET_CYCLES();
     /*long packet mode*/
     uint8_t read_ptr= SUBGRF_ReadRegister(SUBGHZ_RX_ADR_PTR);
     uint8_t size=read_ptr-RFWPacket.RadioBufferOffset;
@@ -1027,6 +1174,7 @@ static void RFW_GetPayloadProcess( void )
       }
       TimerSetValue( &RFWPacket.Timer, Timeout );
       TimerStart( &RFWPacket.Timer);
+      RFW_ChunkProfile(start_cycles);
     }
     else
     {
@@ -1042,6 +1190,7 @@ static void RFW_GetPayloadProcess( void )
       RFWPacket.LongPacketRemainingBytes=0;
       /*Process last chunk*/
       RFW_GetPayload(RFWPacket.RadioBufferOffset, size);
+      RFW_ChunkProfile(start_cycles);
     }
 }
 
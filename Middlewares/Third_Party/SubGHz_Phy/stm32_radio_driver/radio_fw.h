@@ -75,6 +75,14 @@ uint8_t RFW_Is_LongPacketModeEnabled( void);
  */
 void RFW_SetRadioModem(RadioModems_t Modem);
 
+/*!
+ * @brief Return the longest chunk processing time since the previous call
+ *
+ * @note RFW_GET_CYCLES shall be defined in radio_conf.h (e.g. DWT->CYCCNT), 0 is returned otherwise
+ * @return chunk processing time in RFW_GET_CYCLES unit
+ */
+uint32_t RFW_GetChunkCyclesMax(void);
+
 /*!
  * @brief DeInitialise the RFW module and enable custom  whithing and optionally long packet feature
  *
@@ -0,0 +1,159 @@
+/*
+ * Read-ahead layer on top of another block device
+ *
+ * Copyright (c) 2017, Arm Limited. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include "bd/lfs_prefetchbd.h"
+
+int lfs_prefetchbd_createcfg(const struct lfs_config *cfg,
+        const struct lfs_prefetchbd_config *bdcfg) {
+    LFS_PREFETCHBD_TRACE("lfs_prefetchbd_createcfg(%p {.context=%p, "
+                ".read=%p, .prog=%p, .erase=%p, .sync=%p, "
+                ".read_size=%"PRIu32", .prog_size=%"PRIu32", "
+                ".block_size=%"PRIu32", .block_count=%"PRIu32"}, "
+                "%p {.bd=%p, .prefetch_size=%"PRIu32", .buffer=%p})",
+            (void*)cfg, cfg->context,
+            (void*)(uintptr_t)cfg->read, (void*)(uintptr_t)cfg->prog,
+            (void*)(uintptr_t)cfg->erase, (void*)(uintptr_t)cfg->sync,
+            cfg->read_size, cfg->prog_size, cfg->block_size, cfg->block_count,
+            (void*)bdcfg, (void*)bdcfg->bd, bdcfg->prefetch_size,
+            bdcfg->buffer);
+    lfs_prefetchbd_t *bd = cfg->context;
+    bd->cfg = bdcfg;
+
+    // check that the window fits the geometry
+    LFS_ASSERT(bd->cfg->bd->block_size == cfg->block_size);
+    LFS_ASSERT(bd->cfg->bd->block_count == cfg->block_count);
+    LFS_ASSERT(bd->cfg->prefetch_size > 0);
+    LFS_ASSERT(bd->cfg->prefetch_size % bd->cfg->bd->read_size == 0);
+    LFS_ASSERT(cfg->block_size % bd->cfg->prefetch_size == 0);
+
+    // allocate buffer?
+    if (bd->cfg->buffer) {
+        bd->buffer = bd->cfg->buffer;
+    } else {
+        bd->buffer = lfs_malloc(bd->cfg->prefetch_size);
+        if (!bd->buffer) {
+            LFS_PREFETCHBD_TRACE("lfs_prefetchbd_createcfg -> %d",
+                    LFS_ERR_NOMEM);
+            return LFS_ERR_NOMEM;
+        }
+    }
+
+    // window starts empty
+    bd->block = 0;
+    bd->off = 0;
+    bd->size = 0;
+
+    LFS_PREFETCHBD_TRACE("lfs_prefetchbd_createcfg -> %d", 0);
+    return 0;
+}
+
+int lfs_prefetchbd_destroy(const struct lfs_config *cfg) {
+    LFS_PREFETCHBD_TRACE("lfs_prefetchbd_destroy(%p)", (void*)cfg);
+    // clean up memory
+    lfs_prefetchbd_t *bd = cfg->context;
+    if (!bd->cfg->buffer) {
+        lfs_free(bd->buffer);
+    }
+    LFS_PREFETCHBD_TRACE("lfs_prefetchbd_destroy -> %d", 0);
+    return 0;
+}
+
+int lfs_prefetchbd_read(const struct lfs_config *cfg, lfs_block_t block,
+        lfs_off_t off, void *buffer, lfs_size_t size) {
+    LFS_PREFETCHBD_TRACE("lfs_prefetchbd_read(%p, "
+                "0x%"PRIx32", %"PRIu32", %p, %"PRIu32")",
+            (void*)cfg, block, off, buffer, size);
+    lfs_prefetchbd_t *bd = cfg->context;
+    const struct lfs_config *inner = bd->cfg->bd;
+    uint8_t *data = buffer;
+
+    // check if read is valid
+    LFS_ASSERT(off  % cfg->read_size == 0);
+    LFS_ASSERT(size % cfg->read_size == 0);
+    LFS_ASSERT(block < cfg->block_count);
+
+    while (size > 0) {
+        // in the window?
+        if (block == bd->block &&
+                off >= bd->off && off < bd->off + bd->size) {
+            lfs_size_t diff = lfs_min(size, bd->size - (off - bd->off));
+            memcpy(data, &bd->buffer[off - bd->off], diff);
+
+            data += diff;
+            off += diff;
+            size -= diff;
+            continue;
+        }
+
+        // large reads gain nothing from the window
+        if (size >= bd->cfg->prefetch_size) {
+            int err = inner->read(inner, block, off, data, size);
+            LFS_PREFETCHBD_TRACE("lfs_prefetchbd_read -> %d", err);
+            return err;
+        }
+
+        // refill the window, aligned so consecutive windows do not overlap
+        bd->size = 0;
+        lfs_off_t start = lfs_aligndown(off, bd->cfg->prefetch_size);
+        int err = inner->read(inner, block, start,
+                bd->buffer, bd->cfg->prefetch_size);
+        if (err) {
+            LFS_PREFETCHBD_TRACE("lfs_prefetchbd_read -> %d", err);
+            return err;
+        }
+
+        bd->block = block;
+        bd->off = start;
+        bd->size = bd->cfg->prefetch_size;
+    }
+
+    LFS_PREFETCHBD_TRACE("lfs_prefetchbd_read -> %d", 0);
+    return 0;
+}
+
+int lfs_prefetchbd_prog(const struct lfs_config *cfg, lfs_block_t block,
+        lfs_off_t off, const void *buffer, lfs_size_t size) {
+    LFS_PREFETCHBD_TRACE("lfs_prefetchbd_prog(%p, "
+                "0x%"PRIx32", %"PRIu32", %p, %"PRIu32")",
+            (void*)cfg, block, off, buffer, size);
+    lfs_prefetchbd_t *bd = cfg->context;
+    const struct lfs_config *inner = bd->cfg->bd;
+
+    // keep the window coherent with the programmed data
+    if (block == bd->block &&
+            off < bd->off + bd->size && off + size > bd->off) {
+        bd->size = 0;
+    }
+
+    int err = inner->prog(inner, block, off, buffer, size);
+    LFS_PREFETCHBD_TRACE("lfs_prefetchbd_prog -> %d", err);
+    return err;
+}
+
+int lfs_prefetchbd_erase(const struct lfs_config *cfg, lfs_block_t block) {
+    LFS_PREFETCHBD_TRACE("lfs_prefetchbd_erase(%p, 0x%"PRIx32")",
+            (void*)cfg, block);
+    lfs_prefetchbd_t *bd = cfg->context;
+    const struct lfs_config *inner = bd->cfg->bd;
+
+    if (block == bd->block) {
+        bd->size = 0;
+    }
+
+    int err = inner->erase(inner, block);
+    LFS_PREFETCHBD_TRACE("lfs_prefetchbd_erase -> %d", err);
+    return err;
+}
+
+int lfs_prefetchbd_sync(const struct lfs_config *cfg) {
+    LFS_PREFETCHBD_TRACE("lfs_prefetchbd_sync(%p)", (void*)cfg);
+    lfs_prefetchbd_t *bd = cfg->context;
+    const struct lfs_config *inner = bd->cfg->bd;
+
+    int err = inner->sync(inner);
+    LFS_PREFETCHBD_TRACE("lfs_prefetchbd_sync -> %d", err);
+    return err;
+}
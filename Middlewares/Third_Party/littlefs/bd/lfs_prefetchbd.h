@@ -0,0 +1,82 @@
+/*
+ * Read-ahead layer on top of another block device
+ *
+ * Copyright (c) 2017, Arm Limited. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef LFS_PREFETCHBD_H
+#define LFS_PREFETCHBD_H
+
+#include "lfs.h"
+#include "lfs_util.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+// Block device specific tracing
+#ifdef LFS_PREFETCHBD_YES_TRACE
+#define LFS_PREFETCHBD_TRACE(...) LFS_TRACE(__VA_ARGS__)
+#else
+#define LFS_PREFETCHBD_TRACE(...)
+#endif
+
+// prefetchbd config
+struct lfs_prefetchbd_config {
+    // Wrapped block device, with its own context. Its geometry must match
+    // the geometry of the lfs_config using the prefetchbd.
+    const struct lfs_config *bd;
+
+    // Size of the read-ahead window. Small reads are extended to a whole
+    // window of the same block, reads of at least one window bypass it.
+    // Must be a multiple of the read size.
+    lfs_size_t prefetch_size;
+
+    // Optional statically allocated window of prefetch_size bytes.
+    void *buffer;
+};
+
+// prefetchbd state
+typedef struct lfs_prefetchbd {
+    uint8_t *buffer;
+    lfs_block_t block;
+    lfs_off_t off;
+    lfs_size_t size;        // 0 when the window is empty
+    const struct lfs_prefetchbd_config *cfg;
+} lfs_prefetchbd_t;
+
+
+// Create a read-ahead layer using the geometry in lfs_config
+int lfs_prefetchbd_createcfg(const struct lfs_config *cfg,
+        const struct lfs_prefetchbd_config *bdcfg);
+
+// Clean up memory associated with block device
+int lfs_prefetchbd_destroy(const struct lfs_config *cfg);
+
+// Read a block
+int lfs_prefetchbd_read(const struct lfs_config *cfg, lfs_block_t block,
+        lfs_off_t off, void *buffer, lfs_size_t size);
+
+// Program a block
+//
+// The block must have previously been erased.
+int lfs_prefetchbd_prog(const struct lfs_config *cfg, lfs_block_t block,
+        lfs_off_t off, const void *buffer, lfs_size_t size);
+
+// Erase a block
+//
+// A block must be erased before being programmed. The
+// state of an erased block is undefined.
+int lfs_prefetchbd_erase(const struct lfs_config *cfg, lfs_block_t block);
+
+// Sync the block device
+int lfs_prefetchbd_sync(const struct lfs_config *cfg);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif
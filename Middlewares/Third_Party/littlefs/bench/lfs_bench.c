@@ -0,0 +1,229 @@
+/*
+ * Host benchmark for littlefs throughput and mount time
+ *
+ * Usage: lfs_bench [filebd path]
+ *
+ * Runs the same workload on lfs_rambd and lfs_filebd, with and without
+ * lfs_prefetchbd on top, and prints one line per measurement so the output
+ * of two builds can be diffed.
+ *
+ * Copyright (c) 2017, Arm Limited. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#define _POSIX_C_SOURCE 199309L
+#include "lfs.h"
+#include "bd/lfs_rambd.h"
+#include "bd/lfs_filebd.h"
+#include "bd/lfs_prefetchbd.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+// Geometry and workload
+#define BENCH_READ_SIZE     16
+#define BENCH_PROG_SIZE     16
+#define BENCH_BLOCK_SIZE    4096
+#define BENCH_BLOCK_COUNT   256
+#define BENCH_CACHE_SIZE    64
+#define BENCH_PREFETCH_SIZE 512
+#define BENCH_FILE_SIZE     (256*1024)
+#define BENCH_CHUNK_SIZE    32
+#define BENCH_FILES         64
+#define BENCH_CRC_SIZE      (1024*1024)
+#define BENCH_CRC_ROUNDS    32
+
+// Wrapped block device
+enum bench_bd {
+    BENCH_RAMBD,
+    BENCH_FILEBD,
+};
+
+static const char *bench_path = "lfs_bench.bin";
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static void bench_fail(const char *what, int err) {
+    fprintf(stderr, "lfs_bench: %s failed (%d)\n", what, err);
+    exit(1);
+}
+
+static void bench_crc(void) {
+    uint8_t *buffer = malloc(BENCH_CRC_SIZE);
+    if (!buffer) {
+        bench_fail("malloc", LFS_ERR_NOMEM);
+    }
+    for (size_t i = 0; i < BENCH_CRC_SIZE; i++) {
+        buffer[i] = (uint8_t)(i * 2654435761u >> 24);
+    }
+
+    uint32_t crc = 0xffffffff;
+    double start = bench_now();
+    for (int i = 0; i < BENCH_CRC_ROUNDS; i++) {
+        crc = lfs_crc(crc, buffer, BENCH_CRC_SIZE);
+    }
+    double elapsed = bench_now() - start;
+
+    printf("%-16s %-12s %10.1f MiB/s (%08"PRIx32")\n", "lfs_crc", "throughput",
+            BENCH_CRC_ROUNDS * (BENCH_CRC_SIZE / 1048576.0) / elapsed, crc);
+    free(buffer);
+}
+
+static void bench_run(enum bench_bd type, bool prefetch) {
+    lfs_rambd_t rambd;
+    lfs_filebd_t filebd;
+    lfs_prefetchbd_t prefetchbd;
+    struct lfs_config bdcfg = {
+        .read_size      = BENCH_READ_SIZE,
+        .prog_size      = BENCH_PROG_SIZE,
+        .block_size     = BENCH_BLOCK_SIZE,
+        .block_count    = BENCH_BLOCK_COUNT,
+    };
+    if (type == BENCH_RAMBD) {
+        bdcfg.context = &rambd;
+        bdcfg.read    = lfs_rambd_read;
+        bdcfg.prog    = lfs_rambd_prog;
+        bdcfg.erase   = lfs_rambd_erase;
+        bdcfg.sync    = lfs_rambd_sync;
+    } else {
+        bdcfg.context = &filebd;
+        bdcfg.read    = lfs_filebd_read;
+        bdcfg.prog    = lfs_filebd_prog;
+        bdcfg.erase   = lfs_filebd_erase;
+        bdcfg.sync    = lfs_filebd_sync;
+    }
+
+    struct lfs_config cfg = bdcfg;
+    cfg.block_cycles   = 500;
+    cfg.cache_size     = BENCH_CACHE_SIZE;
+    cfg.lookahead_size = 16;
+    const struct lfs_prefetchbd_config prefetchcfg = {
+        .bd            = &bdcfg,
+        .prefetch_size = BENCH_PREFETCH_SIZE,
+    };
+    if (prefetch) {
+        cfg.context = &prefetchbd;
+        cfg.read    = lfs_prefetchbd_read;
+        cfg.prog    = lfs_prefetchbd_prog;
+        cfg.erase   = lfs_prefetchbd_erase;
+        cfg.sync    = lfs_prefetchbd_sync;
+    }
+
+    int err = (type == BENCH_RAMBD)
+            ? lfs_rambd_create(&bdcfg)
+            : lfs_filebd_create(&bdcfg, bench_path);
+    if (err) {
+        bench_fail("bd create", err);
+    }
+    if (prefetch) {
+        err = lfs_prefetchbd_createcfg(&cfg, &prefetchcfg);
+        if (err) {
+            bench_fail("prefetchbd create", err);
+        }
+    }
+
+    char name[24];
+    snprintf(name, sizeof(name), "%s%s",
+            (type == BENCH_RAMBD) ? "rambd" : "filebd",
+            prefetch ? "+prefetch" : "");
+
+    lfs_t lfs;
+    lfs_file_t file;
+    uint8_t chunk[BENCH_CHUNK_SIZE];
+    char path[16];
+
+    err = lfs_format(&lfs, &cfg);
+    if (err) {
+        bench_fail("format", err);
+    }
+    err = lfs_mount(&lfs, &cfg);
+    if (err) {
+        bench_fail("mount", err);
+    }
+
+    // sequential write in small chunks, as an application logging data
+    double start = bench_now();
+    err = lfs_file_open(&lfs, &file, "seq", LFS_O_WRONLY | LFS_O_CREAT);
+    for (lfs_size_t i = 0; !err && i < BENCH_FILE_SIZE; i += sizeof(chunk)) {
+        memset(chunk, (int)(i / sizeof(chunk)), sizeof(chunk));
+        lfs_ssize_t res = lfs_file_write(&lfs, &file, chunk, sizeof(chunk));
+        err = (res < 0) ? (int)res : 0;
+    }
+    err = err ? err : lfs_file_close(&lfs, &file);
+    if (err) {
+        bench_fail("write", err);
+    }
+    double elapsed = bench_now() - start;
+    printf("%-16s %-12s %10.1f KiB/s\n", name, "seq write",
+            BENCH_FILE_SIZE / 1024.0 / elapsed);
+
+    // sequential read in small chunks
+    start = bench_now();
+    err = lfs_file_open(&lfs, &file, "seq", LFS_O_RDONLY);
+    for (lfs_size_t i = 0; !err && i < BENCH_FILE_SIZE; i += sizeof(chunk)) {
+        lfs_ssize_t res = lfs_file_read(&lfs, &file, chunk, sizeof(chunk));
+        err = (res != sizeof(chunk)) ? LFS_ERR_CORRUPT : 0;
+    }
+    err = err ? err : lfs_file_close(&lfs, &file);
+    if (err) {
+        bench_fail("read", err);
+    }
+    elapsed = bench_now() - start;
+    printf("%-16s %-12s %10.1f KiB/s\n", name, "seq read",
+            BENCH_FILE_SIZE / 1024.0 / elapsed);
+
+    // small files, then mount time over the populated metadata
+    for (int i = 0; i < BENCH_FILES; i++) {
+        snprintf(path, sizeof(path), "f%d", i);
+        err = lfs_file_open(&lfs, &file, path, LFS_O_WRONLY | LFS_O_CREAT);
+        if (!err) {
+            lfs_ssize_t res = lfs_file_write(&lfs, &file, chunk, sizeof(chunk));
+            err = (res < 0) ? (int)res : lfs_file_close(&lfs, &file);
+        }
+        if (err) {
+            bench_fail("small files", err);
+        }
+    }
+    err = lfs_unmount(&lfs);
+    if (err) {
+        bench_fail("unmount", err);
+    }
+
+    start = bench_now();
+    err = lfs_mount(&lfs, &cfg);
+    lfs_ssize_t used = err ? err : lfs_fs_size(&lfs);
+    elapsed = bench_now() - start;
+    if (used < 0) {
+        bench_fail("mount", (int)used);
+    }
+    printf("%-16s %-12s %10.1f us\n", name, "mount+size", elapsed * 1e6);
+
+    lfs_unmount(&lfs);
+    if (prefetch) {
+        lfs_prefetchbd_destroy(&cfg);
+    }
+    if (type == BENCH_RAMBD) {
+        lfs_rambd_destroy(&bdcfg);
+    } else {
+        lfs_filebd_destroy(&bdcfg);
+        remove(bench_path);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        bench_path = argv[1];
+    }
+
+    bench_crc();
+    bench_run(BENCH_RAMBD, false);
+    bench_run(BENCH_RAMBD, true);
+    bench_run(BENCH_FILEBD, false);
+    bench_run(BENCH_FILEBD, true);
+    return 0;
+}
@@ -59,6 +59,7 @@ void SysTick_Handler(void);
 //void TAMP_STAMP_LSECSS_SSRU_IRQHandler(void);
 //void EXTI0_IRQHandler(void);
 //void EXTI1_IRQHandler(void);
+//void DMA1_Channel4_IRQHandler(void);
 //void DMA1_Channel5_IRQHandler(void);
 //void USART2_IRQHandler(void);
 //void RTC_Alarm_IRQHandler(void);
@@ -161,6 +161,14 @@ void TIMER_IF_BkUp_Write_SubSeconds(uint32_t SubSeconds);
   */
 uint32_t TIMER_IF_BkUp_Read_SubSeconds(void);
 
+/**
+  * @brief Compensates the RTC crystal drift with the RTC smooth calibration
+  * @note The calibration range is -487.1 ppm to +488.5 ppm by steps of 0.954 ppm
+  * @param[in] drift RTC drift in ppb, positive when the RTC runs fast
+  * @return Compensation actually applied in ppb
+  */
+int32_t TIMER_IF_SetDriftCompensation(int32_t drift);
+
 /* USER CODE BEGIN EFP */
 
 /* USER CODE END EFP */
@@ -472,6 +472,43 @@ uint32_t TIMER_IF_BkUp_Read_SubSeconds(void)
   return ret;
 }
 
+int32_t TIMER_IF_SetDriftCompensation(int32_t drift)
+{
+  int32_t pulses = 0;
+  uint32_t plusPulses = RTC_SMOOTHCALIB_PLUSPULSES_RESET;
+  /* USER CODE BEGIN TIMER_IF_SetDriftCompensation */
+
+  /* USER CODE END TIMER_IF_SetDriftCompensation */
+  /* Every CALM pulse masks one RTCCLK cycle out of 2^20, a fast RTC is slowed down by masking pulses */
+  pulses = (int32_t)((((int64_t)drift * 1048576) + ((drift < 0) ? -500000000 : 500000000)) / 1000000000);
+  if (pulses < 0)
+  {
+    /* CALP inserts one pulse every 2^11 cycles, 512 pulses out of 2^20 */
+    plusPulses = RTC_SMOOTHCALIB_PLUSPULSES_SET;
+    pulses += 512;
+  }
+  if (pulses < 0)
+  {
+    pulses = 0;
+  }
+  else if (pulses > 511)
+  {
+    pulses = 511;
+  }
+  if (HAL_RTCEx_SetSmoothCalib(&hrtc, RTC_SMOOTHCALIB_PERIOD_32SEC, plusPulses, (uint32_t)pulses) != HAL_OK)
+  {
+    return 0;
+  }
+  if (plusPulses == RTC_SMOOTHCALIB_PLUSPULSES_SET)
+  {
+    pulses -= 512;
+  }
+  /* USER CODE BEGIN TIMER_IF_SetDriftCompensation_Last */
+
+  /* USER CODE END TIMER_IF_SetDriftCompensation_Last */
+  return (int32_t)(((int64_t)pulses * 1000000000) / 1048576);
+}
+
 /* USER CODE BEGIN EF */
 
 /* USER CODE END EF */
@@ -31,7 +31,9 @@
   * @brief DMA handle
   */
 extern DMA_HandleTypeDef hdma_usart1_tx;
+extern DMA_HandleTypeDef hdma_usart1_rx;
 extern DMA_HandleTypeDef hdma_usart2_tx;
+extern DMA_HandleTypeDef hdma_usart2_rx;
 
 /**
   * @brief UART handle
@@ -39,11 +41,6 @@ extern DMA_HandleTypeDef hdma_usart2_tx;
 extern UART_HandleTypeDef huart1;
 extern UART_HandleTypeDef huart2;
 
-/**
-  * @brief buffer to receive 1 character
-  */
-uint8_t charRx;
-
 /* USER CODE BEGIN EV */
 
 /* USER CODE END EV */
@@ -65,6 +62,11 @@ const UTIL_ADV_TRACE_Driver_s UTIL_TraceDriver =
 /* USER CODE END PTD */
 
 /* Private define ------------------------------------------------------------*/
+/**
+  * @brief size of the circular DMA receive buffer
+  */
+#define VCOM_RX_DMA_SIZE 256U
+
 /* USER CODE BEGIN PD */
 
 /* USER CODE END PD */
@@ -88,12 +90,38 @@ static void (*TxCpltCallback)(void *);
   * @return none
   */
 static void (*RxCpltCallback)(uint8_t *rxChar, uint16_t size, uint8_t error);
+/**
+  * @brief circular buffer written by the RX DMA
+  */
+static uint8_t rxDmaBuffer[VCOM_RX_DMA_SIZE];
+/**
+  * @brief position of the first byte not yet handed to RxCpltCallback
+  */
+static uint16_t rxReadPos;
 
 /* USER CODE BEGIN PV */
 
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
+/**
+  * @brief  (re)start the circular DMA reception with idle line detection
+  * @param  huart UART handle
+  */
+static void vcom_RxDmaStart(UART_HandleTypeDef *huart);
+
+/**
+  * @brief  hand the bytes received since the last call to RxCpltCallback
+  * @param  writePos position of the DMA in rxDmaBuffer
+  */
+static void vcom_RxDeliver(uint16_t writePos);
+
+/**
+  * @brief  check that the UART and its RX DMA kept their settings in stop mode
+  * @param  huart UART handle
+  * @return 1 when the circular reception still runs, 0 otherwise
+  */
+static uint8_t vcom_RxDmaRunning(UART_HandleTypeDef *huart);
 
 /* USER CODE BEGIN PFP */
 
@@ -209,8 +237,8 @@ UTIL_ADV_TRACE_Status_t vcom_ReceiveInit(void (*RxCb)(uint8_t *rxChar, uint16_t
   /*Enable wakeup from stop mode*/
   HAL_UARTEx_EnableStopMode(&huart1);
 
-  /*Start LPUART receive on IT*/
-  HAL_UART_Receive_IT(&huart1, &charRx, 1);
+  /*Start circular DMA receive, completed by the idle line detection*/
+  vcom_RxDmaStart(&huart1);
 #else
   HAL_UARTEx_StopModeWakeUpSourceConfig(&huart2, WakeUpSelection);
 
@@ -226,8 +254,8 @@ UTIL_ADV_TRACE_Status_t vcom_ReceiveInit(void (*RxCb)(uint8_t *rxChar, uint16_t
   /*Enable wakeup from stop mode*/
   HAL_UARTEx_EnableStopMode(&huart2);
 
-  /*Start LPUART receive on IT*/
-  HAL_UART_Receive_IT(&huart2, &charRx, 1);
+  /*Start circular DMA receive, completed by the idle line detection*/
+  vcom_RxDmaStart(&huart2);
 #endif
   return UTIL_ADV_TRACE_OK;
   /* USER CODE BEGIN vcom_ReceiveInit_2 */
@@ -241,28 +269,58 @@ void vcom_Resume(void)
 
   /* USER CODE END vcom_Resume_1 */
 #ifdef USE_USB_SERIAL
-  /*to re-enable lost UART settings*/
-  if (HAL_UART_Init(&huart1) != HAL_OK)
+  if (vcom_RxDmaRunning(&huart1) != 0U)
   {
-	Error_Handler();
+    /*settings retained: keep the circular reception, hand over what came in while waking up*/
+    vcom_RxDeliver(VCOM_RX_DMA_SIZE - (uint16_t)__HAL_DMA_GET_COUNTER(huart1.hdmarx));
   }
-
-  /*to re-enable lost DMA settings*/
-  if (HAL_DMA_Init(&hdma_usart1_tx) != HAL_OK)
+  else
   {
-	Error_Handler();
+    /*to re-enable lost UART settings*/
+    if (HAL_UART_Init(&huart1) != HAL_OK)
+    {
+      Error_Handler();
+    }
+
+    /*to re-enable lost DMA settings*/
+    if (HAL_DMA_Init(&hdma_usart1_tx) != HAL_OK)
+    {
+      Error_Handler();
+    }
+    if (HAL_DMA_Init(&hdma_usart1_rx) != HAL_OK)
+    {
+      Error_Handler();
+    }
+
+    /*to restart the reception*/
+    vcom_RxDmaStart(&huart1);
   }
 #else
-  /*to re-enable lost UART settings*/
-  if (HAL_UART_Init(&huart2) != HAL_OK)
+  if (vcom_RxDmaRunning(&huart2) != 0U)
   {
-    Error_Handler();
+    /*settings retained: keep the circular reception, hand over what came in while waking up*/
+    vcom_RxDeliver(VCOM_RX_DMA_SIZE - (uint16_t)__HAL_DMA_GET_COUNTER(huart2.hdmarx));
   }
-
-  /*to re-enable lost DMA settings*/
-  if (HAL_DMA_Init(&hdma_usart2_tx) != HAL_OK)
+  else
   {
-    Error_Handler();
+    /*to re-enable lost UART settings*/
+    if (HAL_UART_Init(&huart2) != HAL_OK)
+    {
+      Error_Handler();
+    }
+
+    /*to re-enable lost DMA settings*/
+    if (HAL_DMA_Init(&hdma_usart2_tx) != HAL_OK)
+    {
+      Error_Handler();
+    }
+    if (HAL_DMA_Init(&hdma_usart2_rx) != HAL_OK)
+    {
+      Error_Handler();
+    }
+
+    /*to restart the reception*/
+    vcom_RxDmaStart(&huart2);
   }
 #endif
   /* USER CODE BEGIN vcom_Resume_2 */
@@ -282,27 +340,40 @@ void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart2)
   /* USER CODE END HAL_UART_TxCpltCallback_2 */
 }
 
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart2)
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
 {
-  /* USER CODE BEGIN HAL_UART_RxCpltCallback_1 */
+  /* USER CODE BEGIN HAL_UARTEx_RxEventCallback_1 */
 
-  /* USER CODE END HAL_UART_RxCpltCallback_1 */
-#ifdef USE_USB_SERIAL
-  if ((NULL != RxCpltCallback) && (HAL_UART_ERROR_NONE == huart2->ErrorCode))
+  /* USER CODE END HAL_UARTEx_RxEventCallback_1 */
+  /* called on half transfer, transfer complete and idle line. The DMA counter
+     is used rather than Size: an event handled late, e.g. after vcom_Resume
+     delivered the bytes, must not move the read position back */
+  vcom_RxDeliver(VCOM_RX_DMA_SIZE - (uint16_t)__HAL_DMA_GET_COUNTER(huart->hdmarx));
+  /* USER CODE BEGIN HAL_UARTEx_RxEventCallback_2 */
+
+  /* USER CODE END HAL_UARTEx_RxEventCallback_2 */
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+  /* USER CODE BEGIN HAL_UART_ErrorCallback_1 */
+
+  /* USER CODE END HAL_UART_ErrorCallback_1 */
+  /* keep the bytes received before the error, then report it */
+  vcom_RxDeliver(VCOM_RX_DMA_SIZE - (uint16_t)__HAL_DMA_GET_COUNTER(huart->hdmarx));
+  if (NULL != RxCpltCallback)
   {
-	RxCpltCallback(&charRx, 1, 0);
+    RxCpltCallback(NULL, 0, 1);
   }
-  HAL_UART_Receive_IT(huart2, &charRx, 1);
-#else
-  if ((NULL != RxCpltCallback) && (HAL_UART_ERROR_NONE == huart2->ErrorCode))
+
+  /* in DMA mode the HAL aborts the reception on error */
+  if (huart->RxState != HAL_UART_STATE_BUSY_RX)
   {
-    RxCpltCallback(&charRx, 1, 0);
+    vcom_RxDmaStart(huart);
   }
-  HAL_UART_Receive_IT(huart2, &charRx, 1);
-#endif
-  /* USER CODE BEGIN HAL_UART_RxCpltCallback_2 */
+  /* USER CODE BEGIN HAL_UART_ErrorCallback_2 */
 
-  /* USER CODE END HAL_UART_RxCpltCallback_2 */
+  /* USER CODE END HAL_UART_ErrorCallback_2 */
 }
 
 /* USER CODE BEGIN EF */
@@ -311,6 +382,63 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart2)
 
 /* Private Functions Definition -----------------------------------------------*/
 
+static void vcom_RxDmaStart(UART_HandleTypeDef *huart)
+{
+  /* USER CODE BEGIN vcom_RxDmaStart_1 */
+
+  /* USER CODE END vcom_RxDmaStart_1 */
+  rxReadPos = 0;
+  HAL_UART_AbortReceive(huart);
+  HAL_UARTEx_ReceiveToIdle_DMA(huart, rxDmaBuffer, VCOM_RX_DMA_SIZE);
+  /* USER CODE BEGIN vcom_RxDmaStart_2 */
+
+  /* USER CODE END vcom_RxDmaStart_2 */
+}
+
+static void vcom_RxDeliver(uint16_t writePos)
+{
+  /* USER CODE BEGIN vcom_RxDeliver_1 */
+
+  /* USER CODE END vcom_RxDeliver_1 */
+  if ((NULL != RxCpltCallback) && (writePos != rxReadPos))
+  {
+    if (writePos > rxReadPos)
+    {
+      RxCpltCallback(&rxDmaBuffer[rxReadPos], writePos - rxReadPos, 0);
+    }
+    else
+    {
+      /* the DMA wrapped around: tail of the buffer first, then its head */
+      RxCpltCallback(&rxDmaBuffer[rxReadPos], VCOM_RX_DMA_SIZE - rxReadPos, 0);
+      if (writePos != 0)
+      {
+        RxCpltCallback(rxDmaBuffer, writePos, 0);
+      }
+    }
+  }
+  rxReadPos = (writePos == VCOM_RX_DMA_SIZE) ? 0 : writePos;
+  /* USER CODE BEGIN vcom_RxDeliver_2 */
+
+  /* USER CODE END vcom_RxDeliver_2 */
+}
+
+static uint8_t vcom_RxDmaRunning(UART_HandleTypeDef *huart)
+{
+  /* USER CODE BEGIN vcom_RxDmaRunning_1 */
+
+  /* USER CODE END vcom_RxDmaRunning_1 */
+  if ((READ_BIT(huart->Instance->CR1, USART_CR1_UE) != 0U) &&
+      (READ_BIT(huart->Instance->CR3, USART_CR3_DMAR) != 0U) &&
+      (huart->hdmarx != NULL) && (READ_BIT(huart->hdmarx->Instance->CCR, DMA_CCR_EN) != 0U))
+  {
+    return 1U;
+  }
+  return 0U;
+  /* USER CODE BEGIN vcom_RxDmaRunning_2 */
+
+  /* USER CODE END vcom_RxDmaRunning_2 */
+}
+
 /* USER CODE BEGIN PrFD */
 
 /* USER CODE END PrFD */
@@ -33,6 +33,7 @@
 #include "utilities_def.h"
 #include "radio.h"
 #include "lora_info.h"
+#include "lora_command.h"
 
 /* USER CODE BEGIN Includes */
 
@@ -79,6 +80,10 @@ static LmHandlerAppData_t AppData = { 0, 0, AppDataBuffer };
 /* Dummy data sent periodically to let the tester respond with start test command*/
 static UTIL_TIMER_Object_t TxCertifTimer;
 
+/* Port and acknowledge of the AT+SENDB command waiting for its payload */
+static uint8_t SendBinPort;
+static LmHandlerMsgTypes_t SendBinTxConfirmed;
+
 /* USER CODE BEGIN PV */
 
 /* USER CODE END PV */
@@ -162,6 +167,38 @@ static uint8_t Char2Nibble(char Char);
   */
 static int32_t stringToData(const char *str, uint8_t *data, uint32_t Size);
 
+/**
+  * @brief  Decode a hex string, validity is checked once for the whole string
+  * @param  str hex string, 2 characters per byte
+  * @param  length number of characters in str
+  * @param  data output buffer, length / 2 bytes
+  * @retval the number of bytes decoded, -1 if length is odd or a character is not hex
+  */
+static int32_t hexToData(const char *str, uint32_t length, uint8_t *data);
+
+/**
+  * @brief  Parse the <Port>:<Ack>: header of the send commands
+  * @param  param pointer on the command parameters, moved after the header
+  * @param  appPort application port
+  * @param  isTxConfirmed acknowledge flag
+  * @retval AT_OK if OK, or AT_PARAM_ERROR
+  */
+static ATEerror_t AT_SendHeader(const char **param, uint32_t *appPort, LmHandlerMsgTypes_t *isTxConfirmed);
+
+/**
+  * @brief  Send AppData and convert the LmHandler status
+  * @param  isTxConfirmed acknowledge flag
+  * @retval AT_OK if OK, or an appropriate AT_xxx error code
+  */
+static ATEerror_t AT_SendAppData(LmHandlerMsgTypes_t isTxConfirmed);
+
+/**
+  * @brief  Send the payload received after AT+SENDB
+  * @param  size payload size
+  * @retval AT_OK if OK, or an appropriate AT_xxx error code
+  */
+static ATEerror_t AT_SendBinDone(uint16_t size);
+
 /* USER CODE BEGIN PFP */
 
 /* USER CODE END PFP */
@@ -706,122 +743,83 @@ ATEerror_t AT_Send(const char *param)
 
   /* USER CODE END AT_Send_1 */
   const char *buf = param;
-  uint16_t bufSize = strlen(param);
   uint32_t appPort;
   LmHandlerMsgTypes_t isTxConfirmed;
-  unsigned size = 0;
-  char hex[3] = {0, 0, 0};
-  UTIL_TIMER_Time_t nextTxIn = 0;
-  LmHandlerErrorStatus_t lmhStatus = LORAMAC_HANDLER_ERROR;
-  ATEerror_t status = AT_ERROR;
+  uint32_t length;
+  int32_t size;
+  ATEerror_t status;
 
-  /* read and set the application port */
-  if (1 != tiny_sscanf(buf, "%u:", &appPort))
+  status = AT_SendHeader(&buf, &appPort, &isTxConfirmed);
+  if (status != AT_OK)
   {
-    AT_PRINTF("AT+SEND without the application port\r\n");
-    return AT_PARAM_ERROR;
+    return status;
   }
 
-  /* skip the application port */
-  while (('0' <= buf[0]) && (buf[0] <= '9') && bufSize > 1)
-  {
-    buf ++;
-    bufSize --;
-  };
-
-  if ((bufSize == 0) || (':' != buf[0]))
+  length = strlen(buf);
+  if (length > (2 * LORAWAN_APP_DATA_BUFFER_MAX_SIZE))
   {
-    AT_PRINTF("AT+SEND missing : character after app port\r\n");
     return AT_PARAM_ERROR;
   }
-  else
+  size = hexToData(buf, length, AppData.Buffer);
+  if (size < 0)
   {
-    /* skip the char ':' */
-    buf ++;
-    bufSize --;
+    return AT_PARAM_ERROR;
   }
 
-  switch (buf[0])
-  {
-    case '0':
-      isTxConfirmed = LORAMAC_HANDLER_UNCONFIRMED_MSG;
-      break;
-    case '1':
-      isTxConfirmed = LORAMAC_HANDLER_CONFIRMED_MSG;
-      break;
-    default:
-      AT_PRINTF("AT+SEND without the acknowledge flag\r\n");
-      return AT_PARAM_ERROR;
-  }
+  AppData.BufferSize = size;
+  AppData.Port = appPort;
+
+  return AT_SendAppData(isTxConfirmed);
+  /* USER CODE BEGIN AT_Send_2 */
 
-  if (bufSize > 0)
+  /* USER CODE END AT_Send_2 */
+}
+
+ATEerror_t AT_SendBin(const char *param)
+{
+  /* USER CODE BEGIN AT_SendBin_1 */
+
+  /* USER CODE END AT_SendBin_1 */
+  const char *buf = param;
+  uint32_t appPort;
+  LmHandlerMsgTypes_t isTxConfirmed;
+  uint32_t length = 0;
+  ATEerror_t status;
+
+  status = AT_SendHeader(&buf, &appPort, &isTxConfirmed);
+  if (status != AT_OK)
   {
-    /* skip the acknowledge flag */
-    buf ++;
-    bufSize --;
+    return status;
   }
 
-  if ((bufSize == 0) || (':' != buf[0]))
+  /* payload length, in decimal */
+  if (buf[0] == '\0')
   {
-    AT_PRINTF("AT+SEND missing : character after ack flag\r\n");
     return AT_PARAM_ERROR;
   }
-  else
-  {
-    /* skip the char ':' */
-    buf ++;
-    bufSize --;
-  }
-
-  while ((size < LORAWAN_APP_DATA_BUFFER_MAX_SIZE) && (bufSize > 1))
+  while (buf[0] != '\0')
   {
-    hex[0] = buf[size * 2];
-    hex[1] = buf[size * 2 + 1];
-    if (tiny_sscanf(hex, "%hhx", &AppData.Buffer[size]) != 1)
+    if ((buf[0] < '0') || (buf[0] > '9') || (length > LORAWAN_APP_DATA_BUFFER_MAX_SIZE))
     {
       return AT_PARAM_ERROR;
     }
-    size++;
-    bufSize -= 2;
+    length = (length * 10) + (buf[0] - '0');
+    buf++;
   }
-  if (bufSize != 0)
+  if ((length == 0) || (length > LORAWAN_APP_DATA_BUFFER_MAX_SIZE))
   {
     return AT_PARAM_ERROR;
   }
 
-  AppData.BufferSize = size;
-  AppData.Port = appPort;
-
-  lmhStatus = LmHandlerSend(&AppData, isTxConfirmed, &nextTxIn, false);
-
-  switch (lmhStatus)
-  {
-    case LORAMAC_HANDLER_SUCCESS:
-      status = (nextTxIn > 0) ? AT_DUTYCYCLE_RESTRICTED : AT_OK;
-      break;
-    case LORAMAC_HANDLER_BUSY_ERROR:
-    case LORAMAC_HANDLER_COMPLIANCE_RUNNING:
-      status = (LmHandlerJoinStatus() != LORAMAC_HANDLER_SET) ? AT_NO_NET_JOINED : AT_BUSY_ERROR;
-      break;
-    case LORAMAC_HANDLER_NO_NETWORK_JOINED:
-      status = AT_NO_NET_JOINED;
-      break;
-    case LORAMAC_HANDLER_DUTYCYCLE_RESTRICTED:
-      status = AT_DUTYCYCLE_RESTRICTED;
-      break;
-    case LORAMAC_HANDLER_CRYPTO_ERROR:
-      status = AT_CRYPTO_ERROR;
-      break;
-    case LORAMAC_HANDLER_ERROR:
-    default:
-      status = AT_ERROR;
-      break;
-  }
+  /* the payload is written straight into AppData, the status is printed once it is sent */
+  SendBinPort = appPort;
+  SendBinTxConfirmed = isTxConfirmed;
+  CMD_ReadBinary(AppData.Buffer, length, AT_SendBinDone);
 
-  return status;
-  /* USER CODE BEGIN AT_Send_2 */
+  return AT_OK;
+  /* USER CODE BEGIN AT_SendBin_2 */
 
-  /* USER CODE END AT_Send_2 */
+  /* USER CODE END AT_SendBin_2 */
 }
 
 /* --------------- LoRaWAN network management commands --------------- */
@@ -2126,22 +2124,19 @@ static void CertifSend(void)
 
 static uint8_t Char2Nibble(char Char)
 {
-  if (((Char >= '0') && (Char <= '9')))
-  {
-    return Char - '0';
-  }
-  else if (((Char >= 'a') && (Char <= 'f')))
-  {
-    return Char - 'a' + 10;
-  }
-  else if ((Char >= 'A') && (Char <= 'F'))
+  /* unsigned wrap-around turns each range check into a single compare */
+  uint8_t digit = (uint8_t)(Char - '0');
+  uint8_t letter = (uint8_t)((Char | 0x20) - 'a');
+
+  if (digit < 10)
   {
-    return Char - 'A' + 10;
+    return digit;
   }
-  else
+  if (letter < 6)
   {
-    return 0xF0;
+    return letter + 10;
   }
+  return 0xF0;
   /* USER CODE BEGIN CertifSend_2 */
 
   /* USER CODE END CertifSend_2 */
@@ -2201,6 +2196,148 @@ static int32_t isHex(char Char)
   /* USER CODE END isHex_2 */
 }
 
+static int32_t hexToData(const char *str, uint32_t length, uint8_t *data)
+{
+  /* USER CODE BEGIN hexToData_1 */
+
+  /* USER CODE END hexToData_1 */
+  uint8_t invalid = 0;
+  uint8_t high;
+  uint8_t low;
+
+  if ((length & 1) != 0)
+  {
+    return -1;
+  }
+  for (uint32_t ii = 0; ii < (length / 2); ii++)
+  {
+    high = Char2Nibble(str[0]);
+    low = Char2Nibble(str[1]);
+    /* an invalid character sets the 0xF0 bits, checked after the loop */
+    invalid |= high | low;
+    data[ii] = (uint8_t)((high << 4) | (low & 0x0F));
+    str += 2;
+  }
+
+  return ((invalid & 0xF0) != 0) ? -1 : (int32_t)(length / 2);
+  /* USER CODE BEGIN hexToData_2 */
+
+  /* USER CODE END hexToData_2 */
+}
+
+static ATEerror_t AT_SendHeader(const char **param, uint32_t *appPort, LmHandlerMsgTypes_t *isTxConfirmed)
+{
+  /* USER CODE BEGIN AT_SendHeader_1 */
+
+  /* USER CODE END AT_SendHeader_1 */
+  const char *buf = *param;
+
+  /* read and set the application port */
+  if (1 != tiny_sscanf(buf, "%u:", appPort))
+  {
+    AT_PRINTF("AT+SEND without the application port\r\n");
+    return AT_PARAM_ERROR;
+  }
+
+  /* skip the application port */
+  while (('0' <= buf[0]) && (buf[0] <= '9'))
+  {
+    buf ++;
+  };
+
+  if (':' != buf[0])
+  {
+    AT_PRINTF("AT+SEND missing : character after app port\r\n");
+    return AT_PARAM_ERROR;
+  }
+  /* skip the char ':' */
+  buf ++;
+
+  switch (buf[0])
+  {
+    case '0':
+      *isTxConfirmed = LORAMAC_HANDLER_UNCONFIRMED_MSG;
+      break;
+    case '1':
+      *isTxConfirmed = LORAMAC_HANDLER_CONFIRMED_MSG;
+      break;
+    default:
+      AT_PRINTF("AT+SEND without the acknowledge flag\r\n");
+      return AT_PARAM_ERROR;
+  }
+  /* skip the acknowledge flag */
+  buf ++;
+
+  if (':' != buf[0])
+  {
+    AT_PRINTF("AT+SEND missing : character after ack flag\r\n");
+    return AT_PARAM_ERROR;
+  }
+  /* skip the char ':' */
+  buf ++;
+
+  *param = buf;
+  return AT_OK;
+  /* USER CODE BEGIN AT_SendHeader_2 */
+
+  /* USER CODE END AT_SendHeader_2 */
+}
+
+static ATEerror_t AT_SendAppData(LmHandlerMsgTypes_t isTxConfirmed)
+{
+  /* USER CODE BEGIN AT_SendAppData_1 */
+
+  /* USER CODE END AT_SendAppData_1 */
+  UTIL_TIMER_Time_t nextTxIn = 0;
+  LmHandlerErrorStatus_t lmhStatus;
+  ATEerror_t status;
+
+  lmhStatus = LmHandlerSend(&AppData, isTxConfirmed, &nextTxIn, false);
+
+  switch (lmhStatus)
+  {
+    case LORAMAC_HANDLER_SUCCESS:
+      status = (nextTxIn > 0) ? AT_DUTYCYCLE_RESTRICTED : AT_OK;
+      break;
+    case LORAMAC_HANDLER_BUSY_ERROR:
+    case LORAMAC_HANDLER_COMPLIANCE_RUNNING:
+      status = (LmHandlerJoinStatus() != LORAMAC_HANDLER_SET) ? AT_NO_NET_JOINED : AT_BUSY_ERROR;
+      break;
+    case LORAMAC_HANDLER_NO_NETWORK_JOINED:
+      status = AT_NO_NET_JOINED;
+      break;
+    case LORAMAC_HANDLER_DUTYCYCLE_RESTRICTED:
+      status = AT_DUTYCYCLE_RESTRICTED;
+      break;
+    case LORAMAC_HANDLER_CRYPTO_ERROR:
+      status = AT_CRYPTO_ERROR;
+      break;
+    case LORAMAC_HANDLER_ERROR:
+    default:
+      status = AT_ERROR;
+      break;
+  }
+
+  return status;
+  /* USER CODE BEGIN AT_SendAppData_2 */
+
+  /* USER CODE END AT_SendAppData_2 */
+}
+
+static ATEerror_t AT_SendBinDone(uint16_t size)
+{
+  /* USER CODE BEGIN AT_SendBinDone_1 */
+
+  /* USER CODE END AT_SendBinDone_1 */
+  AppData.BufferSize = size;
+  AppData.Port = SendBinPort;
+
+  return AT_SendAppData(SendBinTxConfirmed);
+  /* USER CODE BEGIN AT_SendBinDone_2 */
+
+  /* USER CODE END AT_SendBinDone_2 */
+}
+
 /* USER CODE BEGIN PrFD */
 
 /* USER CODE END PrFD */
@@ -95,6 +95,7 @@ typedef enum eATEerror
 #define AT_JOIN       "+JOIN"
 #define AT_LINKC      "+LINKC"
 #define AT_SEND       "+SEND"
+#define AT_SENDB      "+SENDB"
 
 /* LoRaWAN network management commands */
 #define AT_VER        "+VER"
@@ -330,6 +331,13 @@ ATEerror_t AT_Link_Check(const char *param);
   */
 ATEerror_t AT_Send(const char *param);
 
+/**
+  * @brief  Send a raw binary payload of the given length following the command
+  * @param  param String parameter
+  * @retval AT_OK if OK, or an appropriate AT_xxx error code
+  */
+ATEerror_t AT_SendBin(const char *param);
+
 /* --------------- LoRaWAN network management commands --------------- */
 /**
   * @brief  Print the version of the AT_Slave FW
@@ -24,6 +24,7 @@
 #include "platform.h"
 #include "lora_at.h"
 #include "lora_command.h"
+#include "stm32_timer.h"
 
 /* USER CODE BEGIN Includes */
 
@@ -60,7 +61,10 @@ struct ATCommand_s
 
 /* Private define ------------------------------------------------------------*/
 #define CMD_SIZE                        540
-#define CIRC_BUFF_SIZE                  80
+#define CIRC_BUFF_SIZE                  256
+#define CMD_HASH_SIZE                   128     /* power of 2, above twice the number of AT commands */
+#define CMD_HASH_EMPTY                  0xFF
+#define CMD_BIN_TIMEOUT                 2000    /* ms to receive a binary payload announced by a command */
 
 /* USER CODE BEGIN PD */
 
@@ -253,6 +257,17 @@ static const struct ATCommand_s ATCommand[] =
     .run = AT_return_error,
   },
 
+  {
+    .string = AT_SENDB,
+    .size_string = sizeof(AT_SENDB) - 1,
+#ifndef NO_HELP
+    .help_string = "AT"AT_SENDB"=<Port>:<Ack>:<Length><CR><Payload>. Send <Length> raw bytes following the command with the application Port=[1..199] and Ack=[0:unconfirmed, 1:confirmed]\r\n",
+#endif /* !NO_HELP */
+    .get = AT_return_error,
+    .set = AT_SendBin,
+    .run = AT_return_error,
+  },
+
   /* LoRaWAN network management commands */
   {
     .string = AT_VER,
@@ -546,6 +561,23 @@ static uint32_t widx = 0;
 static uint32_t ridx = 0;
 static uint32_t charCount = 0;
 static uint32_t circBuffOverflow = 0;
+static uint32_t circBuffDropped = 0;
+static uint8_t rxErrorChar = AT_ERROR_RX_CHAR;
+/* open addressing index of ATCommand, by name hash */
+static uint8_t cmdHash[CMD_HASH_SIZE];
+/* binary payload capture requested by CMD_ReadBinary */
+static uint8_t *binData;
+static uint32_t binSize = 0;
+static volatile uint32_t binRemaining = 0;
+static volatile uint8_t binError = 0;
+static volatile uint8_t binTimeout = 0;
+static uint8_t binSkipLf = 0;
+/* LF received right after a CR, one bit per buffer position */
+static uint8_t crLfMap[CIRC_BUFF_SIZE / 8];
+/* last byte received, the UART reads split a CR LF at any byte */
+static uint8_t lastRxChar = 0;
+static ATEerror_t (*binDoneCb)(uint16_t size);
+static UTIL_TIMER_Object_t BinTimer;
 
 /* USER CODE BEGIN PV */
 
@@ -585,6 +617,37 @@ static void (*NotifyCb)(void);
   */
 static int32_t CMD_ProcessBackSpace(char *cmd);
 
+/**
+  * @brief  Hash an AT command name
+  * @param  name command name, after the "AT"
+  * @param  size size of the name
+  * @retval hash value
+  */
+static uint32_t CMD_Hash(const char *name, uint32_t size);
+
+/**
+  * @brief  Build the hash index of the AT command table
+  */
+static void CMD_BuildIndex(void);
+
+/**
+  * @brief  Find the AT command named by the start of a command line
+  * @param  cmd command line, after the "AT"
+  * @retval the command whose name ends at the first '=', '?' or '\0', NULL if none
+  */
+static const struct ATCommand_s *CMD_Find(const char *cmd);
+
+/**
+  * @brief  Copy the received binary payload, then complete or abort the capture
+  */
+static void CMD_ProcessBinary(void);
+
+/**
+  * @brief  Binary payload timeout callback
+  * @param  context not used
+  */
+static void CMD_OnBinTimeout(void *context);
+
 /* USER CODE BEGIN PFP */
 
 /* USER CODE END PFP */
@@ -606,6 +669,11 @@ void CMD_Init(void (*CmdProcessNotify)(void))
   charCount = 0;
   i = 0;
   circBuffOverflow = 0;
+  circBuffDropped = 0;
+  binRemaining = 0;
+  lastRxChar = 0;
+  UTIL_TIMER_Create(&BinTimer, CMD_BIN_TIMEOUT, UTIL_TIMER_ONESHOT, CMD_OnBinTimeout, NULL);
+  CMD_BuildIndex();
   /* USER CODE BEGIN CMD_Init_2 */
 
   /* USER CODE END CMD_Init_2 */
@@ -625,11 +693,15 @@ void CMD_Process(void)
     ridx = widx;
     charCount = 0;
     circBuffOverflow = 0;
+    binRemaining = 0;
     UTILS_EXIT_CRITICAL_SECTION();
     i = 0;
+    UTIL_TIMER_Stop(&BinTimer);
   }
 
-  while (charCount != 0)
+  CMD_ProcessBinary();
+
+  while ((charCount != 0) && (binRemaining == 0))
   {
 #if 0 /* echo On    */
     AT_PPRINTF("%c", circBuffer[ridx]);
@@ -650,6 +722,8 @@ void CMD_Process(void)
     }
     else if ((circBuffer[ridx] == '\r') || (circBuffer[ridx] == '\n'))
     {
+      /* a LF completing a CR LF terminator does not start a binary payload */
+      binSkipLf = (circBuffer[ridx] == '\r') ? 1 : 0;
       ridx++;
       if (ridx == CIRC_BUFF_SIZE)
       {
@@ -667,6 +741,8 @@ void CMD_Process(void)
         UTILS_EXIT_CRITICAL_SECTION();
         parse_cmd(command);
         i = 0;
+        /* the command may announce a binary payload following it */
+        CMD_ProcessBinary();
       }
     }
     else if (i == (CMD_SIZE - 1))
@@ -676,13 +752,22 @@ void CMD_Process(void)
     }
     else
     {
-      command[i++] = circBuffer[ridx++];
-      if (ridx == CIRC_BUFF_SIZE)
+      /* copy the whole run of command characters, then release it at once */
+      uint32_t avail = charCount;
+      uint32_t n = 0;
+
+      while ((n < avail) && (i < (CMD_SIZE - 1)) && (circBuffer[ridx] != '\r') &&
+             (circBuffer[ridx] != '\n') && (circBuffer[ridx] != AT_ERROR_RX_CHAR))
       {
-        ridx = 0;
+        command[i++] = circBuffer[ridx++];
+        if (ridx == CIRC_BUFF_SIZE)
+        {
+          ridx = 0;
+        }
+        n++;
       }
       UTILS_ENTER_CRITICAL_SECTION();
-      charCount--;
+      charCount -= n;
       UTILS_EXIT_CRITICAL_SECTION();
     }
   }
@@ -691,6 +776,38 @@ void CMD_Process(void)
   /* USER CODE END CMD_Process_2 */
 }
 
+void CMD_ReadBinary(uint8_t *data, uint16_t size, ATEerror_t (*DoneCb)(uint16_t size))
+{
+  /* USER CODE BEGIN CMD_ReadBinary_1 */
+
+  /* USER CODE END CMD_ReadBinary_1 */
+  if ((data == NULL) || (size == 0) || (DoneCb == NULL))
+  {
+    return;
+  }
+  binData = data;
+  binSize = size;
+  binDoneCb = DoneCb;
+  binError = 0;
+  binTimeout = 0;
+  binRemaining = size;
+  UTIL_TIMER_Start(&BinTimer);
+  /* USER CODE BEGIN CMD_ReadBinary_2 */
+
+  /* USER CODE END CMD_ReadBinary_2 */
+}
+
+uint32_t CMD_GetRxDropped(void)
+{
+  /* USER CODE BEGIN CMD_GetRxDropped_1 */
+
+  /* USER CODE END CMD_GetRxDropped_1 */
+  return circBuffDropped;
+  /* USER CODE BEGIN CMD_GetRxDropped_2 */
+
+  /* USER CODE END CMD_GetRxDropped_2 */
+}
+
 /* USER CODE BEGIN EF */
 
 /* USER CODE END EF */
@@ -750,19 +867,44 @@ static void CMD_GetChar(uint8_t *rxChar, uint16_t size, uint8_t error)
   /* USER CODE BEGIN CMD_GetChar_1 */
 
   /* USER CODE END CMD_GetChar_1 */
-  charCount++;
-  if (charCount == (CIRC_BUFF_SIZE + 1))
+  if ((error != 0) && (binRemaining != 0))
   {
-    circBuffOverflow = 1;
-    charCount--;
+    /* 0x01 is valid payload data: flag the error out of band */
+    binError = 1;
+    size = 0;
+    lastRxChar = 0;
   }
-  else
+  else if (error != 0)
   {
-    circBuffer[widx++] = *rxChar;
+    /* the receive path lost data: let CMD_Process report it in sequence */
+    rxChar = &rxErrorChar;
+    size = 1;
+  }
+
+  for (uint16_t n = 0; n < size; n++)
+  {
+    if (charCount == CIRC_BUFF_SIZE)
+    {
+      circBuffOverflow = 1;
+      circBuffDropped += size - n;
+      lastRxChar = 0;
+      break;
+    }
+    if ((rxChar[n] == '\n') && (lastRxChar == '\r'))
+    {
+      crLfMap[widx / 8] |= (uint8_t)(1U << (widx % 8));
+    }
+    else
+    {
+      crLfMap[widx / 8] &= (uint8_t)~(1U << (widx % 8));
+    }
+    lastRxChar = rxChar[n];
+    circBuffer[widx++] = rxChar[n];
     if (widx == CIRC_BUFF_SIZE)
     {
       widx = 0;
     }
+    charCount++;
   }
 
   if (NotifyCb != NULL)
@@ -815,51 +957,122 @@ static void parse_cmd(const char *cmd)
     /* point to the start of the command, excluding AT */
     status = AT_ERROR;
     cmd += 2;
-    for (i = 0; i < (sizeof(ATCommand) / sizeof(struct ATCommand_s)); i++)
+    Current_ATCommand = CMD_Find(cmd);
+    if (Current_ATCommand != NULL)
     {
-      if (strncmp(cmd, ATCommand[i].string, ATCommand[i].size_string) == 0)
+      /* point to the string after the command to parse it */
+      cmd += Current_ATCommand->size_string;
+
+      /* parse after the command */
+      switch (cmd[0])
       {
-        Current_ATCommand = &(ATCommand[i]);
-        /* point to the string after the command to parse it */
-        cmd += Current_ATCommand->size_string;
+        case '\0':    /* nothing after the command */
+          status = Current_ATCommand->run(cmd);
+          break;
+        case '=':
+          if ((cmd[1] == '?') && (cmd[2] == '\0'))
+          {
+            status = Current_ATCommand->get(cmd + 1);
+          }
+          else
+          {
+            status = Current_ATCommand->set(cmd + 1);
+          }
+          break;
+        case '?':
+#ifndef NO_HELP
+          AT_PPRINTF(Current_ATCommand->help_string);
+#endif /* !NO_HELP */
+          status = AT_OK;
+          break;
+        default:
+          /* not recognized */
+          break;
+      }
+    }
+  }
 
-        /* parse after the command */
-        switch (cmd[0])
-        {
-          case '\0':    /* nothing after the command */
-            status = Current_ATCommand->run(cmd);
-            break;
-          case '=':
-            if ((cmd[1] == '?') && (cmd[2] == '\0'))
-            {
-              status = Current_ATCommand->get(cmd + 1);
-            }
-            else
-            {
-              status = Current_ATCommand->set(cmd + 1);
-            }
-            break;
-          case '?':
-#ifndef NO_HELP
-            AT_PPRINTF(Current_ATCommand->help_string);
-#endif /* !NO_HELP */
-            status = AT_OK;
-            break;
-          default:
-            /* not recognized */
-            break;
-        }
+  /* a command waiting for its binary payload reports once it is received */
+  if (binRemaining == 0)
+  {
+    com_error(status);
+  }
+  /* USER CODE BEGIN parse_cmd_2 */
+
+  /* USER CODE END parse_cmd_2 */
+}
+
+static uint32_t CMD_Hash(const char *name, uint32_t size)
+{
+  /* FNV-1a */
+  uint32_t hash = 2166136261U;
+  uint32_t n;
+
+  for (n = 0; n < size; n++)
+  {
+    hash ^= (uint8_t)name[n];
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+static void CMD_BuildIndex(void)
+{
+  uint32_t cmd_idx;
+  uint32_t probe;
 
-        /* we end the loop as the command was found */
+  memset(cmdHash, CMD_HASH_EMPTY, sizeof(cmdHash));
+  for (cmd_idx = 0; cmd_idx < (sizeof(ATCommand) / sizeof(struct ATCommand_s)); cmd_idx++)
+  {
+    uint32_t slot = CMD_Hash(ATCommand[cmd_idx].string, ATCommand[cmd_idx].size_string);
+
+    for (probe = 0; probe < CMD_HASH_SIZE; probe++, slot++)
+    {
+      slot &= (CMD_HASH_SIZE - 1);
+      if (cmdHash[slot] == CMD_HASH_EMPTY)
+      {
+        cmdHash[slot] = (uint8_t)cmd_idx;
+        break;
+      }
+      if ((ATCommand[cmdHash[slot]].size_string == ATCommand[cmd_idx].size_string) &&
+          (memcmp(ATCommand[cmdHash[slot]].string, ATCommand[cmd_idx].string, ATCommand[cmd_idx].size_string) == 0))
+      {
+        /* duplicated name: the first entry of the table is kept */
         break;
       }
     }
   }
+}
 
-  com_error(status);
-  /* USER CODE BEGIN parse_cmd_2 */
+static const struct ATCommand_s *CMD_Find(const char *cmd)
+{
+  uint32_t size = 0;
+  uint32_t slot;
+  uint32_t probe;
 
-  /* USER CODE END parse_cmd_2 */
+  /* the name ends where the parameters or the help request start */
+  while ((cmd[size] != '\0') && (cmd[size] != '=') && (cmd[size] != '?'))
+  {
+    size++;
+  }
+
+  slot = CMD_Hash(cmd, size);
+  for (probe = 0; probe < CMD_HASH_SIZE; probe++, slot++)
+  {
+    const struct ATCommand_s *candidate;
+
+    slot &= (CMD_HASH_SIZE - 1);
+    if (cmdHash[slot] == CMD_HASH_EMPTY)
+    {
+      break;
+    }
+    candidate = &ATCommand[cmdHash[slot]];
+    if ((candidate->size_string == size) && (memcmp(candidate->string, cmd, size) == 0))
+    {
+      return candidate;
+    }
+  }
+  return NULL;
 }
 
 static void com_error(ATEerror_t error_type)
@@ -877,6 +1090,84 @@ static void com_error(ATEerror_t error_type)
   /* USER CODE END com_error_2 */
 }
 
+static void CMD_ProcessBinary(void)
+{
+  /* USER CODE BEGIN CMD_ProcessBinary_1 */
+
+  /* USER CODE END CMD_ProcessBinary_1 */
+  uint32_t avail = charCount;
+  uint32_t n = 0;
+  ATEerror_t status;
+
+  if (binRemaining == 0)
+  {
+    return;
+  }
+
+  if ((avail != 0) && (binSkipLf != 0) && (binRemaining == binSize))
+  {
+    binSkipLf = 0;
+    /* skip the LF only when it was received right after the CR, as the second
+       half of a CR LF terminator, whichever reads of the UART they came in.
+       After a LF only line ending a payload may start with 0x0A, after a CR
+       only one it may not */
+    if ((circBuffer[ridx] == '\n') && ((crLfMap[ridx / 8] & (1U << (ridx % 8))) != 0U))
+    {
+      ridx = (ridx + 1 == CIRC_BUFF_SIZE) ? 0 : ridx + 1;
+      avail--;
+      UTILS_ENTER_CRITICAL_SECTION();
+      charCount--;
+      UTILS_EXIT_CRITICAL_SECTION();
+    }
+  }
+
+  while ((n < avail) && (n < binRemaining))
+  {
+    binData[binSize - binRemaining + n] = (uint8_t)circBuffer[ridx++];
+    if (ridx == CIRC_BUFF_SIZE)
+    {
+      ridx = 0;
+    }
+    n++;
+  }
+  UTILS_ENTER_CRITICAL_SECTION();
+  charCount -= n;
+  binRemaining -= n;
+  UTILS_EXIT_CRITICAL_SECTION();
+
+  if ((binError != 0) || ((binTimeout != 0) && (binRemaining != 0)))
+  {
+    /* drop the capture: the rest of the payload is parsed as commands */
+    binRemaining = 0;
+    UTIL_TIMER_Stop(&BinTimer);
+    com_error(AT_RX_ERROR);
+  }
+  else if (binRemaining == 0)
+  {
+    UTIL_TIMER_Stop(&BinTimer);
+    status = binDoneCb((uint16_t)binSize);
+    com_error(status);
+  }
+  /* USER CODE BEGIN CMD_ProcessBinary_2 */
+
+  /* USER CODE END CMD_ProcessBinary_2 */
+}
+
+static void CMD_OnBinTimeout(void *context)
+{
+  /* USER CODE BEGIN CMD_OnBinTimeout_1 */
+
+  /* USER CODE END CMD_OnBinTimeout_1 */
+  binTimeout = 1;
+  if (NotifyCb != NULL)
+  {
+    NotifyCb();
+  }
+  /* USER CODE BEGIN CMD_OnBinTimeout_2 */
+
+  /* USER CODE END CMD_OnBinTimeout_2 */
+}
+
 /* USER CODE BEGIN PrFD */
 
 /* USER CODE END PrFD */
@@ -67,6 +67,24 @@ void CMD_Init(void (*CmdProcessNotify)(void));
   */
 void CMD_Process(void);
 
+/**
+  * @brief Capture the next received bytes as a raw payload instead of commands
+  * @note  Called by a command handler, the status of the command is printed
+  *        once DoneCb returns. The payload follows the command terminator,
+  *        a LF right after a CR terminator is skipped. The capture is dropped with AT_RX_ERROR on a
+  *        receive error or when the payload is not complete within 2s.
+  * @param data buffer receiving the payload
+  * @param size payload size
+  * @param DoneCb called from CMD_Process once the payload is received
+  */
+void CMD_ReadBinary(uint8_t *data, uint16_t size, ATEerror_t (*DoneCb)(uint16_t size));
+
+/**
+  * @brief Number of received characters dropped on receive buffer overflow
+  * @return count since CMD_Init
+  */
+uint32_t CMD_GetRxDropped(void);
+
 /* USER CODE BEGIN EFP */
 
 /* USER CODE END EFP */
@@ -87,10 +87,17 @@ int16_t SYS_GetTemperatureLevel(void);
 
 /**
   * @brief Get the current battery level
+  * @note Served from the cache of the ADC sampling service, see adc_service.h
   * @return value battery level in linear scale
   */
 uint16_t SYS_GetBatteryLevel(void);
 
+/**
+  * @brief Get the voltage of the VBAT pin
+  * @return value VBAT level in mV
+  */
+uint16_t SYS_GetVbatLevel(void);
+
 /* USER CODE BEGIN EFP */
 
 /* USER CODE END EFP */
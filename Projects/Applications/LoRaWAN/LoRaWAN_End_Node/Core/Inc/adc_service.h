@@ -0,0 +1,96 @@
+/**
+ * @file adc_service.h
+ * @brief Cached, non-blocking sampling of VREFINT, temperature and VBAT
+ *
+ * The three internal channels are converted in one DMA scan sequence,
+ * optionally through the 16x hardware oversampler, and the results are
+ * cached with their time. Consumers read the cache: a measurement older than
+ * ADC_SERVICE_MAX_AGE is still served and a background scan is started to
+ * refresh it, so the uplink path never waits for the ADC. Only a read before
+ * the first scan completed waits for it, at most ADC_SERVICE_SCAN_TIMEOUT.
+ *
+ * The service does not touch the hardware. adc_if.c provides the driver: it
+ * starts the scan and reports its end from the DMA interrupt with
+ * AdcService_OnScanComplete or AdcService_OnScanError.
+ */
+
+#ifndef __ADC_SERVICE_H__
+#define __ADC_SERVICE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Service configuration */
+#ifndef ADC_SERVICE_MAX_AGE
+#define ADC_SERVICE_MAX_AGE         60000   /* ms a measurement is served without refresh */
+#endif
+#ifndef ADC_SERVICE_SCAN_TIMEOUT
+#define ADC_SERVICE_SCAN_TIMEOUT    10      /* ms a read waits for the first scan */
+#endif
+#ifndef ADC_SERVICE_OVERSAMPLING
+#define ADC_SERVICE_OVERSAMPLING    1       /* 16x hardware oversampling, shifted back to 12 bits */
+#endif
+
+#define ADC_SERVICE_FULL_SCALE      4095    /* 12 bit conversions */
+#define ADC_SERVICE_VBAT_DIVIDER    3       /* VBAT is converted through a 1/3 bridge */
+
+/* Channels of the scan sequence, in rank order */
+typedef enum {
+    ADC_SERVICE_VREFINT = 0,
+    ADC_SERVICE_TEMPSENSOR,
+    ADC_SERVICE_VBAT,
+    ADC_SERVICE_CHANNELS
+} AdcService_Channel_t;
+
+/* Factory calibration of the internal channels */
+typedef struct {
+    uint16_t vrefintCal;        /* VREFINT conversion at vrefintCalVref */
+    uint16_t vrefintCalVref;    /* mV */
+    uint16_t tsCal1;            /* Temperature sensor conversion at tsCal1Temp, tsCalVref */
+    uint16_t tsCal2;            /* Same at tsCal2Temp, equal to tsCal1 when not calibrated */
+    int16_t tsCal1Temp;         /* Degrees C */
+    int16_t tsCal2Temp;
+    uint16_t tsCalVref;         /* mV */
+} AdcService_Calib_t;
+
+/* Hardware driver */
+typedef struct {
+    bool (*StartScan)(uint16_t *samples);   /* Starts the scan of ADC_SERVICE_CHANNELS channels, false on error */
+    void (*WaitScan)(void);                 /* Waits for an interrupt while a scan is running */
+    void (*AbortScan)(void);                /* Stops a scan which did not complete in time */
+    uint32_t (*GetTime)(void);              /* Current time in ms */
+} AdcService_Driver_t;
+
+/* Measurement */
+typedef struct {
+    uint16_t vddaMv;            /* Analog supply */
+    int16_t temperature;        /* Degrees C */
+    uint16_t vbatMv;            /* VBAT pin */
+    uint32_t time;              /* GetTime of the scan completion */
+} AdcService_Levels_t;
+
+/* Service counters, since start-up */
+typedef struct {
+    uint32_t scans;             /* Scans completed */
+    uint32_t errors;            /* Scans which failed to start or to complete */
+    uint32_t reads;             /* Measurements read */
+    uint32_t waits;             /* Reads which waited for a scan */
+} AdcService_Stats_t;
+
+/* Function Prototypes */
+void AdcService_Init(const AdcService_Driver_t *driver, const AdcService_Calib_t *calib);
+void AdcService_Request(void);
+void AdcService_OnScanComplete(void);
+void AdcService_OnScanError(void);
+bool AdcService_Get(AdcService_Levels_t *levels);
+void AdcService_GetStats(AdcService_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ADC_SERVICE_H__ */
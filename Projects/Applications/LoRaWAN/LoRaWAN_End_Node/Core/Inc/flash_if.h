@@ -0,0 +1,72 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    flash_if.h
+  * @brief   Header for the internal flash program/erase/read interface
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FLASH_IF_H__
+#define __FLASH_IF_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* Includes ------------------------------------------------------------------*/
+#include "platform.h"
+
+/* USER CODE BEGIN Includes */
+
+/* USER CODE END Includes */
+
+/* Exported constants --------------------------------------------------------*/
+/**
+  * @brief Programming granularity in bytes (one double word)
+  */
+#define FLASH_IF_PROG_SIZE          8U
+
+/* USER CODE BEGIN EC */
+
+/* USER CODE END EC */
+
+/* Exported functions prototypes ---------------------------------------------*/
+
+/**
+  * @brief  Erases the flash pages covering an area
+  * @param  pStart start of the area, aligned on FLASH_PAGE_SIZE
+  * @param  uLength length of the area in bytes
+  * @return HAL_OK on success
+  */
+HAL_StatusTypeDef FLASH_Erase(void *pStart, uint32_t uLength);
+
+/**
+  * @brief  Programs an erased flash area
+  * @note   The last double word is padded with 0xFF. A programmed double word
+  *         can only be programmed again with all zeros.
+  * @param  uDestination destination address, aligned on FLASH_IF_PROG_SIZE
+  * @param  pSource data to program
+  * @param  uLength length of the data in bytes
+  * @return HAL_OK on success
+  */
+HAL_StatusTypeDef FLASH_Write(uint32_t uDestination, const void *pSource, uint32_t uLength);
+
+/**
+  * @brief  Reads from the flash
+  * @param  pDestination destination buffer
+  * @param  pSource flash address to read from
+  * @param  uLength length to read in bytes
+  * @return HAL_OK on success
+  */
+HAL_StatusTypeDef FLASH_Read(void *pDestination, const void *pSource, uint32_t uLength);
+
+/* USER CODE BEGIN EFP */
+
+/* USER CODE END EFP */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FLASH_IF_H__ */
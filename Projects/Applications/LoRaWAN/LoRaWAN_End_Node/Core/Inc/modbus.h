@@ -19,8 +19,14 @@ extern "C" {
 #define MODBUS_TIMEOUT_MS       500
 
 /* Modbus Function Codes */
-#define MODBUS_FC_READ_COILS    0x01
-#define MODBUS_FC_WRITE_COIL    0x05
+#define MODBUS_FC_READ_COILS            0x01
+#define MODBUS_FC_READ_DISCRETE_INPUTS  0x02
+#define MODBUS_FC_READ_HOLDING_REGS     0x03
+#define MODBUS_FC_READ_INPUT_REGS       0x04
+#define MODBUS_FC_WRITE_COIL            0x05
+
+/* Largest data section of a read response (PDU limit) */
+#define MODBUS_MAX_READ_BYTES   250
 
 /* Modbus Status */
 typedef enum {
@@ -35,6 +41,8 @@ typedef enum {
 uint16_t Modbus_CRC16(uint8_t *data, uint16_t length);
 Modbus_Status_t Modbus_WriteCoil(uint8_t channel, uint8_t state);
 Modbus_Status_t Modbus_ReadCoils(uint8_t *relayStates);
+Modbus_Status_t Modbus_Read(uint8_t slave, uint8_t function, uint16_t address,
+                            uint16_t quantity, uint8_t *data, uint8_t *byteCount);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,59 @@
+/**
+ * @file modbus_poll.h
+ * @brief Multi-slave Modbus poll scheduler with change detection
+ *
+ * A poll table lists (slave, function, address range, period) entries. The
+ * scheduler reads every entry at its own period, keeps the last value in a
+ * cache and flags an entry for uplink only when the value changed (or moved
+ * by more than its deadband for registers) since the last report. Pending
+ * entries of all slaves are coalesced into a single uplink frame.
+ *
+ * Uplink frame format (one record per changed entry, in table order):
+ *   [index][data...]     index = entry position in the poll table
+ *                        data  = raw response data section of the entry:
+ *                                coils/inputs -> (quantity + 7) / 8 bytes
+ *                                registers    -> quantity * 2 bytes (big endian)
+ *   [index | 0x80]       the entry's slave stopped answering (no data)
+ */
+
+#ifndef __MODBUS_POLL_H__
+#define __MODBUS_POLL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "modbus.h"
+
+/* Poll scheduler configuration */
+#define MODBUS_POLL_MAX_ENTRIES     8
+#define MODBUS_POLL_MAX_DATA        32      /* 256 coils or 16 registers per entry */
+#define MODBUS_POLL_ERROR_FLAG      0x80
+
+/* Poll table entry */
+typedef struct {
+    uint8_t  slave;         /* Slave address (1-247) */
+    uint8_t  function;      /* MODBUS_FC_READ_COILS .. MODBUS_FC_READ_INPUT_REGS */
+    uint16_t address;       /* First coil/register address (0-indexed) */
+    uint16_t quantity;      /* Number of coils/registers */
+    uint32_t periodMs;      /* Poll period */
+    uint16_t deadband;      /* Registers only: report when |delta| > deadband */
+} ModbusPoll_Entry_t;
+
+/* Function Prototypes */
+Modbus_Status_t ModbusPoll_Init(const ModbusPoll_Entry_t *table, uint8_t count, void (*onChange)(void));
+void ModbusPoll_Process(void);
+void ModbusPoll_Refresh(uint8_t slave);
+void ModbusPoll_ForceReport(void);
+bool ModbusPoll_HasPending(void);
+uint8_t ModbusPoll_BuildFrame(uint8_t *buffer, uint8_t maxSize);
+void ModbusPoll_Commit(void);
+bool ModbusPoll_GetCached(uint8_t index, const uint8_t **data, uint8_t *length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MODBUS_POLL_H__ */
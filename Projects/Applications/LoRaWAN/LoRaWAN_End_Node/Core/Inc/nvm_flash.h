@@ -0,0 +1,55 @@
+/**
+ * @file nvm_flash.h
+ * @brief littlefs file system on the internal flash, holds the LoRaWAN context
+ *
+ * The last NVM_FLASH_SIZE bytes of the internal flash are reserved by the
+ * linker script and exposed to littlefs as a block device, one block per
+ * 2 KB flash page. littlefs spreads the writes over all pages (wear leveling)
+ * and commits every file atomically, so a reset during a write keeps the
+ * previous content.
+ *
+ * The frame counter journal of the LoRaWAN context is kept out of littlefs,
+ * in a raw flash page just below the STORE area: each frame counter update
+ * programs one double word, and the page is only erased when the journal is
+ * folded into the littlefs record.
+ */
+
+#ifndef __NVM_FLASH_H__
+#define __NVM_FLASH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "platform.h"
+#include "lfs.h"
+#include "nvmm.h"
+
+/* Flash area configuration (must match the linker script) */
+#define NVM_FLASH_PAGES         8
+#define NVM_FLASH_SIZE          (NVM_FLASH_PAGES * FLASH_PAGE_SIZE)
+#define NVM_FLASH_BASE          0x0803C000UL    /* Last 16 KB of the 256 KB flash */
+#define NVM_FLASH_JOURNAL_BASE  0x08037800UL    /* 2 KB page just below the uplink store */
+
+/* littlefs configuration */
+#define NVM_FLASH_CACHE_SIZE    64      /* Shall match NVMM_FILE_BUFFER_SIZE */
+#define NVM_FLASH_BLOCK_CYCLES  500     /* Erase cycles before a metadata block is moved */
+
+/* NVM flash Status */
+typedef enum {
+    NVM_FLASH_OK = 0,
+    NVM_FLASH_ERROR_MOUNT,
+    NVM_FLASH_ERROR_FORMAT
+} NvmFlash_Status_t;
+
+/* Function Prototypes */
+NvmFlash_Status_t NvmFlash_Init(void);
+lfs_t *NvmFlash_GetFs(void);
+const NvmmJournalPage_t *NvmFlash_GetJournal(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NVM_FLASH_H__ */
@@ -64,7 +64,7 @@ void USART2_IRQHandler(void);
 void RTC_Alarm_IRQHandler(void);
 void SUBGHZ_Radio_IRQHandler(void);
 /* USER CODE BEGIN EFP */
-
+void DMA1_Channel1_IRQHandler(void);
 /* USER CODE END EFP */
 
 #ifdef __cplusplus
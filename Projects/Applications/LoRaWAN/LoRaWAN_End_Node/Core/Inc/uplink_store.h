@@ -0,0 +1,69 @@
+/**
+ * @file uplink_store.h
+ * @brief Store-and-forward flash ring for uplink frames during coverage loss
+ *
+ * Frames that cannot be sent (not joined, duty cycle) are appended to a ring
+ * of flash pages with their SysTime timestamp. Once the link is back they are
+ * backfilled oldest first, as many records per uplink as the current data
+ * rate allows. When the ring is full the oldest page is erased and its unsent
+ * records are counted as dropped.
+ *
+ * Flash layout, per 2 KB page:
+ *   [magic][sequence]                page header, sequence orders the pages
+ *   [sent flag][timestamp][length][crc][data, padded to 8 bytes] ...
+ * The sent flag double word stays erased until the record was uplinked and is
+ * then programmed to zero. A record whose CRC does not match (reset while it
+ * was programmed) is skipped.
+ *
+ * Backfill frame format (one record after the other, oldest first):
+ *   [timestamp, 4 bytes big endian][length][data...]
+ *   timestamp = SysTime seconds when the frame was stored
+ */
+
+#ifndef __UPLINK_STORE_H__
+#define __UPLINK_STORE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Flash area configuration (must match the linker script) */
+#define UPLINK_STORE_BASE           0x08038000UL    /* 16 KB just below the NVM area */
+#define UPLINK_STORE_PAGES          8
+
+/* Record configuration */
+#define UPLINK_STORE_MAX_DATA       46      /* Record fits a 51 byte uplink (lowest DR) */
+#define UPLINK_STORE_RECORD_HEADER  5       /* Timestamp and length in the backfill frame */
+#define UPLINK_STORE_BATCH_MAX      16      /* Records per backfill frame */
+
+/* Uplink store Status */
+typedef enum {
+    UPLINK_STORE_OK = 0,
+    UPLINK_STORE_ERROR_FLASH,
+    UPLINK_STORE_ERROR_INVALID_PARAM
+} UplinkStore_Status_t;
+
+/* Uplink store counters, since start-up except Pending */
+typedef struct {
+    uint32_t stored;        /* Records written to flash */
+    uint32_t sent;          /* Records uplinked by a backfill frame */
+    uint32_t dropped;       /* Unsent records evicted by a full ring or lost to a flash error */
+    uint32_t pending;       /* Records waiting in flash */
+} UplinkStore_Stats_t;
+
+/* Function Prototypes */
+UplinkStore_Status_t UplinkStore_Init(void);
+UplinkStore_Status_t UplinkStore_Put(const uint8_t *data, uint8_t size);
+uint32_t UplinkStore_Pending(void);
+uint8_t UplinkStore_BuildFrame(uint8_t *buffer, uint8_t maxSize);
+void UplinkStore_Commit(void);
+void UplinkStore_GetStats(UplinkStore_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UPLINK_STORE_H__ */
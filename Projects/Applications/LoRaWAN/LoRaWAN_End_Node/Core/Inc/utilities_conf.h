@@ -145,11 +145,22 @@ extern "C" {
 #define UTIL_ADV_TRACE_VSNPRINTF(...)              tiny_vsnprintf_like(__VA_ARGS__)      /*!< vsnprintf utilities interface to trace feature */
 
 /* USER CODE BEGIN EM */
+/******************************************************************************
+  * low power manager
+  * the governor demotes Stop mode to Sleep mode when the next timer event
+  * comes before Stop mode pays back its entry and exit (times in RTC ticks)
+  ******************************************************************************/
+#define UTIL_LPM_GOVERNOR_ENABLE                   1                                     /*!< deadline aware low power mode selection */
+#define UTIL_LPM_GET_TIME( )                       TIMER_IF_GetTimerValue()              /*!< free running time base of the governor */
+#define UTIL_LPM_GET_NEXT_DEADLINE( )              UTIL_TIMER_GetFirstRemainingTime()    /*!< ticks before the next timer event */
+#define UTIL_LPM_STOP_MIN_RESIDENCY                (2UL)                                 /*!< Stop mode break-even on top of the learnt wake up latency */
 
 /* USER CODE END EM */
 
 /* Exported functions prototypes ---------------------------------------------*/
 /* USER CODE BEGIN EFP */
+uint32_t TIMER_IF_GetTimerValue(void);
+uint32_t UTIL_TIMER_GetFirstRemainingTime(void);
 
 /* USER CODE END EFP */
 
@@ -48,7 +48,7 @@ typedef enum
   CFG_LPM_APPLI_Id,
   CFG_LPM_UART_TX_Id,
   /* USER CODE BEGIN CFG_LPM_Id_t */
-
+  CFG_LPM_ADC_Id,
   /* USER CODE END CFG_LPM_Id_t */
 } CFG_LPM_Id_t;
 
@@ -78,6 +78,7 @@ typedef enum
   CFG_SEQ_Task_LmHandlerProcess,
   CFG_SEQ_Task_LoRaSendOnTxTimerOrButtonEvent,
   /* USER CODE BEGIN CFG_SEQ_Task_Id_t */
+  CFG_SEQ_Task_ModbusPoll,
 
   /* USER CODE END CFG_SEQ_Task_Id_t */
   CFG_SEQ_Task_NBR
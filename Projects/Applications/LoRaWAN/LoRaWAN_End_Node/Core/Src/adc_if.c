@@ -24,7 +24,10 @@
 #include "sys_app.h"
 
 /* USER CODE BEGIN Includes */
-
+#include "adc_service.h"
+#include "stm32_lpm.h"
+#include "stm32_timer.h"
+#include "utilities_def.h"
 /* USER CODE END Includes */
 
 /* External variables ---------------------------------------------------------*/
@@ -42,10 +45,8 @@ extern ADC_HandleTypeDef hadc;
 /* USER CODE END PTD */
 
 /* Private define ------------------------------------------------------------*/
-#define TEMPSENSOR_TYP_CAL1_V          (( int32_t)  760)        /*!< Internal temperature sensor, parameter V30 (unit: mV). Refer to device datasheet for min/typ/max values. */
-#define TEMPSENSOR_TYP_AVGSLOPE        (( int32_t) 2500)        /*!< Internal temperature sensor, parameter Avg_Slope (unit: uV/DegCelsius). Refer to device datasheet for min/typ/max values. */
-
 /* USER CODE BEGIN PD */
+#define VREFINT_TYP_CAL                ((uint16_t) 1510)        /*!< VREFINT conversion at VREFINT_CAL_VREF used when the device is not calibrated in production */
 
 /* USER CODE END PD */
 
@@ -57,21 +58,51 @@ extern ADC_HandleTypeDef hadc;
 /* Private variables ---------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
+/**
+  * @brief DMA handle of the scan sequence
+  */
+DMA_HandleTypeDef hdma_adc;
 
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
+/* USER CODE BEGIN PFP */
 /**
-  * @brief This function reads the ADC channel
-  * @param channel channel number to read
-  * @return adc measured level value
+  * @brief Starts the DMA scan of VREFINT, temperature sensor and VBAT
+  * @param samples destination of the conversions, in AdcService_Channel_t order
+  * @return true when the scan is running
   */
-static uint32_t ADC_ReadChannels(uint32_t channel);
+static bool ADC_StartScan(uint16_t *samples);
 
-/* USER CODE BEGIN PFP */
+/**
+  * @brief Waits for the end of the running scan
+  */
+static void ADC_WaitScan(void);
+
+/**
+  * @brief Disables the ADC and allows stop mode again at the end of a scan
+  */
+static void ADC_StopScan(void);
+
+/**
+  * @brief Gets the time base of the measurement cache
+  * @return time in ms
+  */
+static uint32_t ADC_GetTime(void);
 
 /* USER CODE END PFP */
 
+/**
+  * @brief Driver of the ADC sampling service
+  */
+static const AdcService_Driver_t AdcServiceDriver =
+{
+  ADC_StartScan,
+  ADC_WaitScan,
+  ADC_StopScan,
+  ADC_GetTime
+};
+
 /* Exported functions --------------------------------------------------------*/
 /* USER CODE BEGIN EF */
 
@@ -82,7 +113,29 @@ void SYS_InitMeasurement(void)
   /* USER CODE BEGIN SYS_InitMeasurement_1 */
 
   /* USER CODE END SYS_InitMeasurement_1 */
+  AdcService_Calib_t calib;
+
   hadc.Instance = ADC;
+
+  /* check whether device has the reference voltage calibrated in production */
+  if ((uint32_t)*VREFINT_CAL_ADDR != (uint32_t)0xFFFFU)
+  {
+    calib.vrefintCal = *VREFINT_CAL_ADDR;
+  }
+  else
+  {
+    calib.vrefintCal = VREFINT_TYP_CAL;
+  }
+  calib.vrefintCalVref = VREFINT_CAL_VREF;
+  /* equal points select the typical temperature sensor parameters */
+  calib.tsCal1 = *TEMPSENSOR_CAL1_ADDR;
+  calib.tsCal2 = *TEMPSENSOR_CAL2_ADDR;
+  calib.tsCal1Temp = TEMPSENSOR_CAL1_TEMP;
+  calib.tsCal2Temp = TEMPSENSOR_CAL2_TEMP;
+  calib.tsCalVref = TEMPSENSOR_CAL_VREFANALOG;
+
+  /* first scan runs in the background, the uplink path reads the cache */
+  AdcService_Init(&AdcServiceDriver, &calib);
   /* USER CODE BEGIN SYS_InitMeasurement_2 */
 
   /* USER CODE END SYS_InitMeasurement_2 */
@@ -101,31 +154,12 @@ int16_t SYS_GetTemperatureLevel(void)
 
   /* USER CODE END SYS_GetTemperatureLevel_1 */
   int16_t temperatureDegreeC = 0;
-  uint32_t measuredLevel = 0;
-  uint16_t batteryLevelmV = SYS_GetBatteryLevel();
+  AdcService_Levels_t levels;
 
-  measuredLevel = ADC_ReadChannels(ADC_CHANNEL_TEMPSENSOR);
-
-  /* convert ADC level to temperature */
-  /* check whether device has temperature sensor calibrated in production */
-  if (((int32_t)*TEMPSENSOR_CAL2_ADDR - (int32_t)*TEMPSENSOR_CAL1_ADDR) != 0)
+  /* cached measurement, refreshed in the background when too old */
+  if (AdcService_Get(&levels))
   {
-    /* Device with temperature sensor calibrated in production:
-       use device optimized parameters */
-    temperatureDegreeC = __LL_ADC_CALC_TEMPERATURE(batteryLevelmV,
-                                                   measuredLevel,
-                                                   LL_ADC_RESOLUTION_12B);
-  }
-  else
-  {
-    /* Device with temperature sensor not calibrated in production:
-       use generic parameters */
-    temperatureDegreeC = __LL_ADC_CALC_TEMPERATURE_TYP_PARAMS(TEMPSENSOR_TYP_AVGSLOPE,
-                                                              TEMPSENSOR_TYP_CAL1_V,
-                                                              TEMPSENSOR_CAL1_TEMP,
-                                                              batteryLevelmV,
-                                                              measuredLevel,
-                                                              LL_ADC_RESOLUTION_12B);
+    temperatureDegreeC = levels.temperature;
   }
 
   APP_LOG(TS_ON, VLEVEL_L, "temp= %d\n\r", temperatureDegreeC);
@@ -145,29 +179,12 @@ uint16_t SYS_GetBatteryLevel(void)
 
   /* USER CODE END SYS_GetBatteryLevel_1 */
   uint16_t batteryLevelmV = 0;
-  uint32_t measuredLevel = 0;
-
-  measuredLevel = ADC_ReadChannels(ADC_CHANNEL_VREFINT);
+  AdcService_Levels_t levels;
 
-  if (measuredLevel == 0)
+  /* cached measurement, refreshed in the background when too old */
+  if (AdcService_Get(&levels))
   {
-    batteryLevelmV = 0;
-  }
-  else
-  {
-    if ((uint32_t)*VREFINT_CAL_ADDR != (uint32_t)0xFFFFU)
-    {
-      /* Device with Reference voltage calibrated in production:
-         use device optimized parameters */
-      batteryLevelmV = __LL_ADC_CALC_VREFANALOG_VOLTAGE(measuredLevel,
-                                                        ADC_RESOLUTION_12B);
-    }
-    else
-    {
-      /* Device with Reference voltage not calibrated in production:
-         use generic parameters */
-      batteryLevelmV = (VREFINT_CAL_VREF * 1510) / measuredLevel;
-    }
+    batteryLevelmV = levels.vddaMv;
   }
 
   return batteryLevelmV;
@@ -176,55 +193,170 @@ uint16_t SYS_GetBatteryLevel(void)
   /* USER CODE END SYS_GetBatteryLevel_2 */
 }
 
-/* Private Functions Definition -----------------------------------------------*/
-/* USER CODE BEGIN PrFD */
+uint16_t SYS_GetVbatLevel(void)
+{
+  /* USER CODE BEGIN SYS_GetVbatLevel_1 */
 
-/* USER CODE END PrFD */
+  /* USER CODE END SYS_GetVbatLevel_1 */
+  uint16_t vbatLevelmV = 0;
+  AdcService_Levels_t levels;
+
+  if (AdcService_Get(&levels))
+  {
+    vbatLevelmV = levels.vbatMv;
+  }
+
+  return vbatLevelmV;
+  /* USER CODE BEGIN SYS_GetVbatLevel_2 */
+
+  /* USER CODE END SYS_GetVbatLevel_2 */
+}
+
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+  /* USER CODE BEGIN HAL_ADC_ConvCpltCallback_1 */
+
+  /* USER CODE END HAL_ADC_ConvCpltCallback_1 */
+  ADC_StopScan();
+  AdcService_OnScanComplete();
+  /* USER CODE BEGIN HAL_ADC_ConvCpltCallback_2 */
 
-static uint32_t ADC_ReadChannels(uint32_t channel)
+  /* USER CODE END HAL_ADC_ConvCpltCallback_2 */
+}
+
+void HAL_ADC_ErrorCallback(ADC_HandleTypeDef *hadc)
 {
-  /* USER CODE BEGIN ADC_ReadChannels_1 */
+  /* USER CODE BEGIN HAL_ADC_ErrorCallback_1 */
+
+  /* USER CODE END HAL_ADC_ErrorCallback_1 */
+  ADC_StopScan();
+  AdcService_OnScanError();
+  /* USER CODE BEGIN HAL_ADC_ErrorCallback_2 */
+
+  /* USER CODE END HAL_ADC_ErrorCallback_2 */
+}
 
-  /* USER CODE END ADC_ReadChannels_1 */
-  uint32_t ADCxConvertedValues = 0;
+/* Private Functions Definition -----------------------------------------------*/
+/* USER CODE BEGIN PrFD */
+
+static bool ADC_StartScan(uint16_t *samples)
+{
+  static const uint32_t channels[ADC_SERVICE_CHANNELS] =
+  {
+    ADC_CHANNEL_VREFINT,
+    ADC_CHANNEL_TEMPSENSOR,
+    ADC_CHANNEL_VBAT
+  };
+  static const uint32_t ranks[ADC_SERVICE_CHANNELS] =
+  {
+    ADC_REGULAR_RANK_1,
+    ADC_REGULAR_RANK_2,
+    ADC_REGULAR_RANK_3
+  };
   ADC_ChannelConfTypeDef sConfig = {0};
+  uint32_t i;
 
-  MX_ADC_Init();
+  /* the ADC clock is lost in stop mode */
+  UTIL_LPM_SetStopMode((1 << CFG_LPM_ADC_Id), UTIL_LPM_DISABLE);
 
-  /* Start Calibration */
-  if (HAL_ADCEx_Calibration_Start(&hadc) != HAL_OK)
+  /* MX_ADC_Init settings, with the sequencer and DMA for the three channels */
+  hadc.Instance = ADC;
+  hadc.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
+  hadc.Init.Resolution = ADC_RESOLUTION_12B;
+  hadc.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+  hadc.Init.ScanConvMode = ADC_SCAN_ENABLE;
+  hadc.Init.EOCSelection = ADC_EOC_SEQ_CONV;
+  hadc.Init.LowPowerAutoWait = DISABLE;
+  hadc.Init.LowPowerAutoPowerOff = DISABLE;
+  hadc.Init.ContinuousConvMode = DISABLE;
+  hadc.Init.NbrOfConversion = ADC_SERVICE_CHANNELS;
+  hadc.Init.DiscontinuousConvMode = DISABLE;
+  hadc.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+  hadc.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
+  hadc.Init.DMAContinuousRequests = DISABLE;
+  hadc.Init.Overrun = ADC_OVR_DATA_OVERWRITTEN;
+  hadc.Init.SamplingTimeCommon1 = ADC_SAMPLETIME_160CYCLES_5;
+  hadc.Init.SamplingTimeCommon2 = ADC_SAMPLETIME_160CYCLES_5;
+#if (ADC_SERVICE_OVERSAMPLING == 1)
+  /* sum of 16 conversions shifted back to 12 bits */
+  hadc.Init.OversamplingMode = ENABLE;
+  hadc.Init.Oversampling.Ratio = ADC_OVERSAMPLING_RATIO_16;
+  hadc.Init.Oversampling.RightBitShift = ADC_RIGHTBITSHIFT_4;
+  hadc.Init.Oversampling.TriggeredMode = ADC_TRIGGEREDMODE_SINGLE_TRIGGER;
+#else
+  hadc.Init.OversamplingMode = DISABLE;
+#endif /* ADC_SERVICE_OVERSAMPLING == 1 */
+  hadc.Init.TriggerFrequencyMode = ADC_TRIGGER_FREQ_HIGH;
+  if (HAL_ADC_Init(&hadc) != HAL_OK)
+  {
+    ADC_StopScan();
+    return false;
+  }
+
+  __HAL_RCC_DMAMUX1_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  hdma_adc.Instance = DMA1_Channel1;
+  hdma_adc.Init.Request = DMA_REQUEST_ADC;
+  hdma_adc.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_adc.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_adc.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_adc.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_adc.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  hdma_adc.Init.Mode = DMA_NORMAL;
+  hdma_adc.Init.Priority = DMA_PRIORITY_LOW;
+  if (HAL_DMA_Init(&hdma_adc) != HAL_OK)
   {
-    Error_Handler();
+    ADC_StopScan();
+    return false;
   }
+  __HAL_LINKDMA(&hadc, DMA_Handle, hdma_adc);
+  HAL_NVIC_SetPriority(DMA1_Channel1_IRQn, 2, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel1_IRQn);
 
-  /* Configure Regular Channel */
-  sConfig.Channel = channel;
-  sConfig.Rank = ADC_REGULAR_RANK_1;
-  sConfig.SamplingTime = ADC_SAMPLINGTIME_COMMON_1;
-  if (HAL_ADC_ConfigChannel(&hadc, &sConfig) != HAL_OK)
+  if (HAL_ADCEx_Calibration_Start(&hadc) != HAL_OK)
   {
-    Error_Handler();
+    ADC_StopScan();
+    return false;
   }
 
-  if (HAL_ADC_Start(&hadc) != HAL_OK)
+  for (i = 0; i < ADC_SERVICE_CHANNELS; i++)
   {
-    /* Start Error */
-    Error_Handler();
+    sConfig.Channel = channels[i];
+    sConfig.Rank = ranks[i];
+    sConfig.SamplingTime = ADC_SAMPLINGTIME_COMMON_1;
+    if (HAL_ADC_ConfigChannel(&hadc, &sConfig) != HAL_OK)
+    {
+      ADC_StopScan();
+      return false;
+    }
   }
-  /** Wait for end of conversion */
-  HAL_ADC_PollForConversion(&hadc, HAL_MAX_DELAY);
 
-  /** Wait for end of conversion */
-  HAL_ADC_Stop(&hadc) ;   /* it calls also ADC_Disable() */
+  if (HAL_ADC_Start_DMA(&hadc, (uint32_t *)samples, ADC_SERVICE_CHANNELS) != HAL_OK)
+  {
+    ADC_StopScan();
+    return false;
+  }
+  return true;
+}
 
-  ADCxConvertedValues = HAL_ADC_GetValue(&hadc);
+static void ADC_WaitScan(void)
+{
+  /* a scan takes well below a millisecond, the DMA interrupt ends it */
+}
 
+static void ADC_StopScan(void)
+{
+  HAL_ADC_Stop_DMA(&hadc);   /* it calls also ADC_Disable() */
   HAL_ADC_DeInit(&hadc);
+  HAL_DMA_DeInit(&hdma_adc);
+  UTIL_LPM_SetStopMode((1 << CFG_LPM_ADC_Id), UTIL_LPM_ENABLE);
+}
 
-  return ADCxConvertedValues;
-  /* USER CODE BEGIN ADC_ReadChannels_2 */
-
-  /* USER CODE END ADC_ReadChannels_2 */
+static uint32_t ADC_GetTime(void)
+{
+  return UTIL_TIMER_GetCurrentTime();
 }
 
+/* USER CODE END PrFD */
+
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,194 @@
+/**
+ * @file adc_service.c
+ * @brief Cached, non-blocking sampling of VREFINT, temperature and VBAT
+ */
+
+#include "adc_service.h"
+#include <stddef.h>
+
+/* Typical temperature sensor parameters, for devices not calibrated in production */
+#define ADC_SERVICE_TS_TYP_CAL1_V       760     /* V30, mV */
+#define ADC_SERVICE_TS_TYP_AVGSLOPE     2500    /* uV/degree C */
+
+/* Private variables */
+static const AdcService_Driver_t *adcDriver;
+static AdcService_Calib_t adcCalib;
+static uint16_t scanSamples[ADC_SERVICE_CHANNELS];     /* DMA destination */
+static AdcService_Levels_t cachedLevels;
+static volatile uint32_t cacheSequence;                 /* Odd while the cache is written */
+static volatile bool scanBusy;
+static volatile bool cacheValid;
+static AdcService_Stats_t serviceStats;
+
+/**
+ * @brief Convert the VREFINT sample to the analog supply voltage
+ */
+static uint16_t AdcService_CalcVdda(uint16_t sample)
+{
+  if (sample == 0)
+  {
+    return 0;
+  }
+  return (uint16_t)(((uint32_t)adcCalib.vrefintCalVref * adcCalib.vrefintCal) / sample);
+}
+
+/**
+ * @brief Convert the temperature sensor sample
+ * @param sample: Conversion value
+ * @param vddaMv: Analog supply of the conversion
+ * @return Degrees C
+ */
+static int16_t AdcService_CalcTemperature(uint16_t sample, uint16_t vddaMv)
+{
+  int32_t value;
+
+  if (adcCalib.tsCal2 != adcCalib.tsCal1)
+  {
+    /* Rescale to the calibration supply and interpolate between the two points */
+    value = (int32_t)(((uint32_t)sample * vddaMv) / adcCalib.tsCalVref) - adcCalib.tsCal1;
+    value = value * (adcCalib.tsCal2Temp - adcCalib.tsCal1Temp) / ((int32_t)adcCalib.tsCal2 - adcCalib.tsCal1);
+    return (int16_t)(value + adcCalib.tsCal1Temp);
+  }
+  /* Typical V30 and slope */
+  value = (int32_t)(((uint32_t)sample * vddaMv) / ADC_SERVICE_FULL_SCALE) * 1000 - ADC_SERVICE_TS_TYP_CAL1_V * 1000;
+  return (int16_t)(value / ADC_SERVICE_TS_TYP_AVGSLOPE + adcCalib.tsCal1Temp);
+}
+
+/**
+ * @brief Start a scan unless one is running
+ */
+static void AdcService_StartScan(void)
+{
+  if (scanBusy)
+  {
+    return;
+  }
+  scanBusy = true;
+  if (!adcDriver->StartScan(scanSamples))
+  {
+    scanBusy = false;
+    serviceStats.errors++;
+  }
+}
+
+/**
+ * @brief Initialize the service and start the first scan
+ * @param driver: Hardware driver
+ * @param calib: Factory calibration of the internal channels
+ */
+void AdcService_Init(const AdcService_Driver_t *driver, const AdcService_Calib_t *calib)
+{
+  adcDriver = driver;
+  adcCalib = *calib;
+  cacheSequence = 0;
+  scanBusy = false;
+  cacheValid = false;
+  serviceStats = (AdcService_Stats_t){0};
+  AdcService_StartScan();
+}
+
+/**
+ * @brief Refresh the measurement in the background when it is older than ADC_SERVICE_MAX_AGE
+ */
+void AdcService_Request(void)
+{
+  if (adcDriver == NULL)
+  {
+    return;
+  }
+  if (!cacheValid || (uint32_t)(adcDriver->GetTime() - cachedLevels.time) >= ADC_SERVICE_MAX_AGE)
+  {
+    AdcService_StartScan();
+  }
+}
+
+/**
+ * @brief Convert the samples of the completed scan into the cache
+ * @note Called from the DMA interrupt
+ */
+void AdcService_OnScanComplete(void)
+{
+  uint16_t vddaMv = AdcService_CalcVdda(scanSamples[ADC_SERVICE_VREFINT]);
+
+  cacheSequence++;
+  cachedLevels.vddaMv = vddaMv;
+  cachedLevels.temperature = AdcService_CalcTemperature(scanSamples[ADC_SERVICE_TEMPSENSOR], vddaMv);
+  cachedLevels.vbatMv = (uint16_t)(((uint32_t)scanSamples[ADC_SERVICE_VBAT] * vddaMv * ADC_SERVICE_VBAT_DIVIDER) / ADC_SERVICE_FULL_SCALE);
+  cachedLevels.time = adcDriver->GetTime();
+  cacheSequence++;
+
+  cacheValid = true;
+  scanBusy = false;
+  serviceStats.scans++;
+}
+
+/**
+ * @brief Release a scan which failed, the cache keeps the previous measurement
+ * @note Called from the DMA interrupt
+ */
+void AdcService_OnScanError(void)
+{
+  scanBusy = false;
+  serviceStats.errors++;
+}
+
+/**
+ * @brief Read the cached measurement
+ *
+ * A stale measurement is returned as is and a refresh is started. Only when
+ * no scan has completed yet does the call wait for one, at most
+ * ADC_SERVICE_SCAN_TIMEOUT: a scan whose interrupt does not come is aborted.
+ *
+ * @param levels: Measurement
+ * @return false when no measurement could be made
+ */
+bool AdcService_Get(AdcService_Levels_t *levels)
+{
+  uint32_t sequence;
+  uint32_t start;
+
+  if (adcDriver == NULL)
+  {
+    return false;
+  }
+  if (!cacheValid)
+  {
+    serviceStats.waits++;
+    AdcService_StartScan();
+    start = adcDriver->GetTime();
+    while (scanBusy)
+    {
+      if ((uint32_t)(adcDriver->GetTime() - start) >= ADC_SERVICE_SCAN_TIMEOUT)
+      {
+        /* The DMA interrupt is lost or masked by the caller priority */
+        adcDriver->AbortScan();
+        AdcService_OnScanError();
+        break;
+      }
+      adcDriver->WaitScan();
+    }
+    if (!cacheValid)
+    {
+      return false;
+    }
+  }
+
+  /* The interrupt may refresh the cache while it is copied */
+  do
+  {
+    sequence = cacheSequence;
+    *levels = cachedLevels;
+  } while (((sequence & 1U) != 0U) || (sequence != cacheSequence));
+
+  serviceStats.reads++;
+  AdcService_Request();
+  return true;
+}
+
+/**
+ * @brief Get the service counters
+ */
+void AdcService_GetStats(AdcService_Stats_t *stats)
+{
+  *stats = serviceStats;
+}
@@ -0,0 +1,77 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    flash_if.c
+  * @brief   Internal flash program/erase/read interface
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+/* Includes ------------------------------------------------------------------*/
+#include "flash_if.h"
+#include <string.h>
+
+/* USER CODE BEGIN Includes */
+
+/* USER CODE END Includes */
+
+/* Exported functions --------------------------------------------------------*/
+/* USER CODE BEGIN EF */
+
+/* USER CODE END EF */
+
+HAL_StatusTypeDef FLASH_Erase(void *pStart, uint32_t uLength)
+{
+  FLASH_EraseInitTypeDef erase;
+  uint32_t pageError;
+  uint32_t address = (uint32_t)pStart;
+  HAL_StatusTypeDef status;
+
+  if ((address % FLASH_PAGE_SIZE) != 0U || uLength == 0U)
+  {
+    return HAL_ERROR;
+  }
+
+  erase.TypeErase = FLASH_TYPEERASE_PAGES;
+  erase.Page = (address - FLASH_BASE) / FLASH_PAGE_SIZE;
+  erase.NbPages = (uLength + FLASH_PAGE_SIZE - 1U) / FLASH_PAGE_SIZE;
+
+  status = HAL_FLASH_Unlock();
+  if (status == HAL_OK)
+  {
+    status = HAL_FLASHEx_Erase(&erase, &pageError);
+    HAL_FLASH_Lock();
+  }
+
+  return status;
+}
+
+HAL_StatusTypeDef FLASH_Write(uint32_t uDestination, const void *pSource, uint32_t uLength)
+{
+  const uint8_t *data = pSource;
+  HAL_StatusTypeDef status;
+
+  if ((uDestination % FLASH_IF_PROG_SIZE) != 0U)
+  {
+    return HAL_ERROR;
+  }
+
+  status = HAL_FLASH_Unlock();
+  for (uint32_t i = 0; (status == HAL_OK) && (i < uLength); i += FLASH_IF_PROG_SIZE)
+  {
+    uint64_t doubleWord = UINT64_MAX;
+    uint32_t size = ((uLength - i) < FLASH_IF_PROG_SIZE) ? (uLength - i) : FLASH_IF_PROG_SIZE;
+
+    memcpy(&doubleWord, &data[i], size);
+    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, uDestination + i, doubleWord);
+  }
+  HAL_FLASH_Lock();
+
+  return status;
+}
+
+HAL_StatusTypeDef FLASH_Read(void *pDestination, const void *pSource, uint32_t uLength)
+{
+  memcpy(pDestination, pSource, uLength);
+  return HAL_OK;
+}
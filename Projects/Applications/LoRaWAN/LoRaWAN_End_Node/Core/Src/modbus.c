@@ -111,18 +111,58 @@ Modbus_Status_t Modbus_WriteCoil(uint8_t channel, uint8_t state)
  */
 Modbus_Status_t Modbus_ReadCoils(uint8_t *relayStates)
 {
+    uint8_t byteCount = 0;
+
+    /* Read 8 coils starting at address 0 */
+    return Modbus_Read(MODBUS_SLAVE_ADDR, MODBUS_FC_READ_COILS, 0x0000, MODBUS_RELAY_COUNT,
+                       relayStates, &byteCount);
+}
+
+/**
+ * @brief Read a range of coils, discrete inputs or registers with retry mechanism
+ * @param slave: Slave address (1-247)
+ * @param function: MODBUS_FC_READ_COILS .. MODBUS_FC_READ_INPUT_REGS
+ * @param address: First coil/register address (0-indexed)
+ * @param quantity: Number of coils/registers to read
+ * @param data: Buffer for the response data section (raw, as sent on the wire)
+ * @param byteCount: Pointer to store the number of data bytes copied
+ * @return Modbus_Status_t
+ */
+Modbus_Status_t Modbus_Read(uint8_t slave, uint8_t function, uint16_t address,
+                            uint16_t quantity, uint8_t *data, uint8_t *byteCount)
+{
+    static uint8_t rxBuffer[RS485_RX_BUFFER_SIZE];
     uint8_t txBuffer[8];
-    uint8_t rxBuffer[8];
     uint16_t rxLen = 0;
     uint16_t crc;
+    uint16_t expected;
 
-    /* Build Modbus frame: Read 8 coils starting at address 0 */
-    txBuffer[0] = MODBUS_SLAVE_ADDR;           /* Slave address */
-    txBuffer[1] = MODBUS_FC_READ_COILS;        /* Function code 01 */
-    txBuffer[2] = 0x00;                         /* Start address high */
-    txBuffer[3] = 0x00;                         /* Start address low */
-    txBuffer[4] = 0x00;                         /* Quantity high */
-    txBuffer[5] = 0x08;                         /* Quantity low (8 coils) */
+    if (function < MODBUS_FC_READ_COILS || function > MODBUS_FC_READ_INPUT_REGS || quantity == 0)
+    {
+        return MODBUS_ERROR_INVALID_PARAM;
+    }
+
+    /* Expected number of data bytes in the response */
+    if (function <= MODBUS_FC_READ_DISCRETE_INPUTS)
+    {
+        expected = (quantity + 7) / 8;
+    }
+    else
+    {
+        expected = quantity * 2;
+    }
+    if (expected > MODBUS_MAX_READ_BYTES)
+    {
+        return MODBUS_ERROR_INVALID_PARAM;
+    }
+
+    /* Build Modbus frame */
+    txBuffer[0] = slave;                        /* Slave address */
+    txBuffer[1] = function;                     /* Function code 01..04 */
+    txBuffer[2] = (address >> 8) & 0xFF;        /* Start address high */
+    txBuffer[3] = address & 0xFF;               /* Start address low */
+    txBuffer[4] = (quantity >> 8) & 0xFF;       /* Quantity high */
+    txBuffer[5] = quantity & 0xFF;              /* Quantity low */
 
     /* Calculate and append CRC */
     crc = Modbus_CRC16(txBuffer, 6);
@@ -151,11 +191,22 @@ Modbus_Status_t Modbus_ReadCoils(uint8_t *relayStates)
             continue;
         }
 
+        /* Exception response: the slave understood the request and refused it */
+        if (rxBuffer[0] == slave && rxBuffer[1] == (function | 0x80))
+        {
+            return MODBUS_ERROR_RESPONSE;
+        }
+
         /* Verify response header */
-        if (rxBuffer[0] == MODBUS_SLAVE_ADDR && rxBuffer[1] == MODBUS_FC_READ_COILS)
+        if (rxBuffer[0] == slave && rxBuffer[1] == function &&
+            rxBuffer[2] == expected && rxLen >= (uint16_t)(expected + 5))
         {
-            /* Extract relay states (byte 3 contains the coil data) */
-            *relayStates = rxBuffer[3];
+            /* Extract data section */
+            for (uint16_t i = 0; i < expected; i++)
+            {
+                data[i] = rxBuffer[3 + i];
+            }
+            *byteCount = (uint8_t)expected;
             return MODBUS_OK;
         }
 
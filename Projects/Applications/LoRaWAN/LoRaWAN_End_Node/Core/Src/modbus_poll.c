@@ -0,0 +1,371 @@
+/**
+ * @file modbus_poll.c
+ * @brief Multi-slave Modbus poll scheduler with change detection
+ */
+
+#include "modbus_poll.h"
+#include "stm32_timer.h"
+#include "stm32_seq.h"
+#include "utilities_def.h"
+#include "LoRaMacEnergy.h"
+#include <string.h>
+
+/* Per-entry runtime state */
+typedef struct {
+    UTIL_TIMER_Time_t nextDue;                  /* Next poll time */
+    uint8_t current[MODBUS_POLL_MAX_DATA];      /* Last value read */
+    uint8_t reported[MODBUS_POLL_MAX_DATA];     /* Last value sent uplink */
+    uint8_t length;                             /* Data bytes of the entry */
+    bool valid;                                 /* current[] holds a good read */
+    bool reportedValid;                         /* reported[] holds a sent value */
+    bool error;                                 /* Last poll failed */
+    bool reportedError;                         /* Error state last sent uplink */
+    bool forced;                                /* Report next read even if unchanged */
+    bool pending;                               /* Needs to be reported */
+} ModbusPoll_State_t;
+
+/* Private variables */
+static const ModbusPoll_Entry_t *pollTable;
+static uint8_t pollCount;
+static ModbusPoll_State_t pollState[MODBUS_POLL_MAX_ENTRIES];
+static uint8_t lastFrameMask;
+static void (*pollOnChange)(void);
+static UTIL_TIMER_Object_t PollTimer;
+
+/**
+ * @brief Poll timer callback: defer the bus transactions to the sequencer
+ */
+static void OnPollTimerEvent(void *context)
+{
+    UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_ModbusPoll), CFG_SEQ_Prio_0);
+}
+
+/**
+ * @brief Check whether a fresh read must be reported
+ * @param entry: Poll table entry
+ * @param state: Entry state holding both current and reported values
+ * @return true if the change is reportable
+ */
+static bool ModbusPoll_IsReportable(const ModbusPoll_Entry_t *entry, const ModbusPoll_State_t *state)
+{
+    if (state->error != state->reportedError)
+    {
+        return true;
+    }
+    if (state->error)
+    {
+        return false;
+    }
+    if (!state->reportedValid)
+    {
+        return true;
+    }
+
+    /* Coils and discrete inputs: any bit change */
+    if (entry->function <= MODBUS_FC_READ_DISCRETE_INPUTS || entry->deadband == 0)
+    {
+        return memcmp(state->current, state->reported, state->length) != 0;
+    }
+
+    /* Registers: deadband crossing on any register */
+    for (uint8_t i = 0; i < state->length; i += 2)
+    {
+        int32_t now = (state->current[i] << 8) | state->current[i + 1];
+        int32_t last = (state->reported[i] << 8) | state->reported[i + 1];
+        int32_t delta = now - last;
+
+        if (delta < 0)
+        {
+            delta = -delta;
+        }
+        if (delta > entry->deadband)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Arm the poll timer on the earliest entry deadline
+ */
+static void ModbusPoll_ScheduleNext(void)
+{
+    UTIL_TIMER_Time_t now = UTIL_TIMER_GetCurrentTime();
+    int32_t earliest = INT32_MAX;
+
+    for (uint8_t i = 0; i < pollCount; i++)
+    {
+        int32_t delta = (int32_t)(pollState[i].nextDue - now);
+        if (delta < earliest)
+        {
+            earliest = delta;
+        }
+    }
+
+    if (earliest == INT32_MAX)
+    {
+        return;
+    }
+    if (earliest < 1)
+    {
+        earliest = 1;
+    }
+
+    UTIL_TIMER_Stop(&PollTimer);
+    UTIL_TIMER_SetPeriod(&PollTimer, (uint32_t)earliest);
+    UTIL_TIMER_Start(&PollTimer);
+}
+
+/**
+ * @brief Initialize the poll scheduler and start polling
+ * @param table: Poll table (must stay valid while polling)
+ * @param count: Number of entries in table
+ * @param onChange: Called from ModbusPoll_Process when an entry becomes reportable
+ * @return Modbus_Status_t
+ */
+Modbus_Status_t ModbusPoll_Init(const ModbusPoll_Entry_t *table, uint8_t count, void (*onChange)(void))
+{
+    if (table == NULL || count == 0 || count > MODBUS_POLL_MAX_ENTRIES)
+    {
+        return MODBUS_ERROR_INVALID_PARAM;
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint16_t length;
+
+        if (table[i].function < MODBUS_FC_READ_COILS || table[i].function > MODBUS_FC_READ_INPUT_REGS ||
+            table[i].quantity == 0 || table[i].periodMs == 0)
+        {
+            return MODBUS_ERROR_INVALID_PARAM;
+        }
+        length = (table[i].function <= MODBUS_FC_READ_DISCRETE_INPUTS) ?
+                 (table[i].quantity + 7) / 8 : table[i].quantity * 2;
+        if (length > MODBUS_POLL_MAX_DATA)
+        {
+            return MODBUS_ERROR_INVALID_PARAM;
+        }
+    }
+
+    pollTable = table;
+    pollCount = count;
+    pollOnChange = onChange;
+    lastFrameMask = 0;
+    memset(pollState, 0, sizeof(pollState));
+
+    UTIL_SEQ_RegTask((1 << CFG_SEQ_Task_ModbusPoll), UTIL_SEQ_RFU, ModbusPoll_Process);
+    UTIL_TIMER_Create(&PollTimer, 0xFFFFFFFFU, UTIL_TIMER_ONESHOT, OnPollTimerEvent, NULL);
+
+    /* Poll every entry once at start-up */
+    UTIL_TIMER_Time_t now = UTIL_TIMER_GetCurrentTime();
+    for (uint8_t i = 0; i < count; i++)
+    {
+        pollState[i].nextDue = now;
+    }
+    UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_ModbusPoll), CFG_SEQ_Prio_0);
+
+    return MODBUS_OK;
+}
+
+/**
+ * @brief Poll every entry whose deadline has passed, then re-arm the timer
+ * @note  Runs from the sequencer; the Modbus transactions are blocking
+ */
+void ModbusPoll_Process(void)
+{
+    bool changed = false;
+#if (LORAMAC_ENERGY_ENABLED == 1)
+    /* The bus transactions are charged to the application */
+    LoRaMacEnergyActivity_t previousActivity = LoRaMacEnergySetActivity(LORAMAC_ENERGY_APPLICATION);
+#endif
+
+    for (uint8_t i = 0; i < pollCount; i++)
+    {
+        const ModbusPoll_Entry_t *entry = &pollTable[i];
+        ModbusPoll_State_t *state = &pollState[i];
+        UTIL_TIMER_Time_t now = UTIL_TIMER_GetCurrentTime();
+
+        if ((int32_t)(state->nextDue - now) > 0)
+        {
+            continue;
+        }
+
+        Modbus_Status_t status = Modbus_Read(entry->slave, entry->function, entry->address,
+                                             entry->quantity, state->current, &state->length);
+        if (status == MODBUS_OK)
+        {
+            state->valid = true;
+            state->error = false;
+        }
+        else
+        {
+            state->error = true;
+        }
+
+        if (!state->pending && (state->forced || ModbusPoll_IsReportable(entry, state)))
+        {
+            state->pending = true;
+            changed = true;
+        }
+        state->forced = false;
+
+        /* Keep the period stable; skip missed slots rather than bursting */
+        state->nextDue += entry->periodMs;
+        if ((int32_t)(state->nextDue - UTIL_TIMER_GetCurrentTime()) <= 0)
+        {
+            state->nextDue = UTIL_TIMER_GetCurrentTime() + entry->periodMs;
+        }
+    }
+
+    ModbusPoll_ScheduleNext();
+#if (LORAMAC_ENERGY_ENABLED == 1)
+    LoRaMacEnergySetActivity(previousActivity);
+#endif
+
+    if (changed && pollOnChange != NULL)
+    {
+        pollOnChange();
+    }
+}
+
+/**
+ * @brief Poll all entries of a slave now and report them even if unchanged
+ * @param slave: Slave address, 0 for all slaves
+ * @note  Used after a write so the uplink carries the confirmed state
+ */
+void ModbusPoll_Refresh(uint8_t slave)
+{
+    UTIL_TIMER_Time_t now = UTIL_TIMER_GetCurrentTime();
+
+    for (uint8_t i = 0; i < pollCount; i++)
+    {
+        if (slave == 0 || pollTable[i].slave == slave)
+        {
+            pollState[i].nextDue = now;
+            pollState[i].forced = true;
+        }
+    }
+    UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_ModbusPoll), CFG_SEQ_Prio_0);
+}
+
+/**
+ * @brief Mark every entry for reporting with its cached value
+ */
+void ModbusPoll_ForceReport(void)
+{
+    for (uint8_t i = 0; i < pollCount; i++)
+    {
+        if (pollState[i].valid || pollState[i].error)
+        {
+            pollState[i].pending = true;
+        }
+    }
+}
+
+/**
+ * @brief Check whether some entries wait for an uplink
+ * @return true if ModbusPoll_BuildFrame would produce data
+ */
+bool ModbusPoll_HasPending(void)
+{
+    for (uint8_t i = 0; i < pollCount; i++)
+    {
+        if (pollState[i].pending)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Coalesce pending entries of all slaves into one uplink frame
+ * @param buffer: Frame buffer
+ * @param maxSize: Maximum payload for the current data rate
+ * @return Frame size (0 if nothing to report)
+ * @note  Entries are only marked as reported by ModbusPoll_Commit, so a frame
+ *        that could not be sent is rebuilt on the next attempt. Entries that
+ *        do not fit remain pending for the next uplink.
+ */
+uint8_t ModbusPoll_BuildFrame(uint8_t *buffer, uint8_t maxSize)
+{
+    uint8_t size = 0;
+
+    lastFrameMask = 0;
+    for (uint8_t i = 0; i < pollCount; i++)
+    {
+        ModbusPoll_State_t *state = &pollState[i];
+        uint8_t recordSize;
+
+        if (!state->pending)
+        {
+            continue;
+        }
+
+        recordSize = state->error ? 1 : 1 + state->length;
+        if (size + recordSize > maxSize)
+        {
+            continue;
+        }
+
+        if (state->error)
+        {
+            buffer[size++] = i | MODBUS_POLL_ERROR_FLAG;
+        }
+        else
+        {
+            buffer[size++] = i;
+            memcpy(&buffer[size], state->current, state->length);
+            size += state->length;
+        }
+        lastFrameMask |= (1 << i);
+    }
+
+    return size;
+}
+
+/**
+ * @brief Record the entries of the last built frame as reported
+ * @note  Call once the uplink carrying the frame was accepted by the MAC
+ */
+void ModbusPoll_Commit(void)
+{
+    for (uint8_t i = 0; i < pollCount; i++)
+    {
+        ModbusPoll_State_t *state = &pollState[i];
+
+        if ((lastFrameMask & (1 << i)) == 0)
+        {
+            continue;
+        }
+
+        state->reportedError = state->error;
+        if (!state->error)
+        {
+            memcpy(state->reported, state->current, state->length);
+            state->reportedValid = true;
+        }
+        state->pending = false;
+    }
+    lastFrameMask = 0;
+}
+
+/**
+ * @brief Read the cached value of an entry without touching the bus
+ * @param index: Poll table index
+ * @param data: Pointer to store the cached data location
+ * @param length: Pointer to store the cached data length
+ * @return true if the cache holds a good read
+ */
+bool ModbusPoll_GetCached(uint8_t index, const uint8_t **data, uint8_t *length)
+{
+    if (index >= pollCount || !pollState[index].valid)
+    {
+        return false;
+    }
+
+    *data = pollState[index].current;
+    *length = pollState[index].length;
+    return !pollState[index].error;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file nvm_flash.c
+ * @brief littlefs file system on the internal flash, holds the LoRaWAN context
+ */
+
+#include "nvm_flash.h"
+#include "flash_if.h"
+
+/* Private function prototypes */
+static int NvmFlash_Read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size);
+static int NvmFlash_Prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size);
+static int NvmFlash_Erase(const struct lfs_config *c, lfs_block_t block);
+static int NvmFlash_Sync(const struct lfs_config *c);
+static bool NvmFlash_JournalRead(uint32_t offset, uint8_t *buffer, uint32_t size);
+static bool NvmFlash_JournalProg(uint32_t offset, const uint8_t *buffer, uint32_t size);
+static bool NvmFlash_JournalErase(void);
+
+/* Private variables */
+static lfs_t nvmFs;
+static uint8_t readBuffer[NVM_FLASH_CACHE_SIZE];
+static uint8_t progBuffer[NVM_FLASH_CACHE_SIZE];
+static uint32_t lookaheadBuffer[2];
+static bool mounted;
+
+static const struct lfs_config nvmFsConfig = {
+    .read = NvmFlash_Read,
+    .prog = NvmFlash_Prog,
+    .erase = NvmFlash_Erase,
+    .sync = NvmFlash_Sync,
+    .read_size = 1,
+    .prog_size = sizeof(uint64_t),      /* Flash is programmed by double word */
+    .block_size = FLASH_PAGE_SIZE,
+    .block_count = NVM_FLASH_PAGES,
+    .block_cycles = NVM_FLASH_BLOCK_CYCLES,
+    .cache_size = NVM_FLASH_CACHE_SIZE,
+    .lookahead_size = sizeof(lookaheadBuffer),
+    .read_buffer = readBuffer,
+    .prog_buffer = progBuffer,
+    .lookahead_buffer = lookaheadBuffer,
+};
+
+static const NvmmJournalPage_t nvmJournalPage = {
+    .Size = FLASH_PAGE_SIZE,
+    .Read = NvmFlash_JournalRead,
+    .Prog = NvmFlash_JournalProg,
+    .Erase = NvmFlash_JournalErase,
+};
+
+/**
+ * @brief Read from the memory mapped flash
+ */
+static int NvmFlash_Read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size)
+{
+    const void *address = (const void *)(NVM_FLASH_BASE + block * c->block_size + off);
+
+    return (FLASH_Read(buffer, address, size) == HAL_OK) ? LFS_ERR_OK : LFS_ERR_IO;
+}
+
+/**
+ * @brief Program whole double words, littlefs aligns on prog_size
+ */
+static int NvmFlash_Prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size)
+{
+    uint32_t address = NVM_FLASH_BASE + block * c->block_size + off;
+
+    return (FLASH_Write(address, buffer, size) == HAL_OK) ? LFS_ERR_OK : LFS_ERR_IO;
+}
+
+/**
+ * @brief Erase the flash page of a block
+ */
+static int NvmFlash_Erase(const struct lfs_config *c, lfs_block_t block)
+{
+    void *address = (void *)(NVM_FLASH_BASE + block * c->block_size);
+
+    return (FLASH_Erase(address, c->block_size) == HAL_OK) ? LFS_ERR_OK : LFS_ERR_IO;
+}
+
+/**
+ * @brief Nothing buffered below littlefs
+ */
+static int NvmFlash_Sync(const struct lfs_config *c)
+{
+    return LFS_ERR_OK;
+}
+
+/**
+ * @brief Read from the memory mapped journal page
+ */
+static bool NvmFlash_JournalRead(uint32_t offset, uint8_t *buffer, uint32_t size)
+{
+    return FLASH_Read(buffer, (const void *)(NVM_FLASH_JOURNAL_BASE + offset), size) == HAL_OK;
+}
+
+/**
+ * @brief Program a double word of the journal page
+ */
+static bool NvmFlash_JournalProg(uint32_t offset, const uint8_t *buffer, uint32_t size)
+{
+    return FLASH_Write(NVM_FLASH_JOURNAL_BASE + offset, buffer, size) == HAL_OK;
+}
+
+/**
+ * @brief Erase the journal page
+ */
+static bool NvmFlash_JournalErase(void)
+{
+    return FLASH_Erase((void *)NVM_FLASH_JOURNAL_BASE, FLASH_PAGE_SIZE) == HAL_OK;
+}
+
+/**
+ * @brief Mount the file system, format the flash area on first use
+ * @return NvmFlash_Status_t
+ */
+NvmFlash_Status_t NvmFlash_Init(void)
+{
+    mounted = false;
+
+    if (lfs_mount(&nvmFs, &nvmFsConfig) != LFS_ERR_OK)
+    {
+        /* Blank or foreign content: start an empty file system */
+        if (lfs_format(&nvmFs, &nvmFsConfig) != LFS_ERR_OK)
+        {
+            return NVM_FLASH_ERROR_FORMAT;
+        }
+        if (lfs_mount(&nvmFs, &nvmFsConfig) != LFS_ERR_OK)
+        {
+            return NVM_FLASH_ERROR_MOUNT;
+        }
+    }
+
+    mounted = true;
+    return NVM_FLASH_OK;
+}
+
+/**
+ * @brief Get the mounted file system
+ * @return File system, NULL if NvmFlash_Init failed
+ */
+lfs_t *NvmFlash_GetFs(void)
+{
+    return mounted ? &nvmFs : NULL;
+}
+
+/**
+ * @brief Get the raw flash page of the frame counter journal
+ * @return Journal page
+ */
+const NvmmJournalPage_t *NvmFlash_GetJournal(void)
+{
+    return &nvmJournalPage;
+}
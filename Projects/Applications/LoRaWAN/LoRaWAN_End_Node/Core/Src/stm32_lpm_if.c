@@ -26,7 +26,7 @@
 #include "usart_if.h"
 
 /* USER CODE BEGIN Includes */
-
+#include "LoRaMacEnergy.h"
 /* USER CODE END Includes */
 
 /* External variables ---------------------------------------------------------*/
@@ -79,21 +79,21 @@ const struct UTIL_LPM_Driver_s UTIL_PowerDriver =
 void PWR_EnterOffMode(void)
 {
   /* USER CODE BEGIN EnterOffMode_1 */
-
+  LORAMAC_ENERGY_MCU_MODE(LORAMAC_ENERGY_MCU_OFF);
   /* USER CODE END EnterOffMode_1 */
 }
 
 void PWR_ExitOffMode(void)
 {
   /* USER CODE BEGIN ExitOffMode_1 */
-
+  LORAMAC_ENERGY_MCU_MODE(LORAMAC_ENERGY_MCU_RUN);
   /* USER CODE END ExitOffMode_1 */
 }
 
 void PWR_EnterStopMode(void)
 {
   /* USER CODE BEGIN EnterStopMode_1 */
-
+  LORAMAC_ENERGY_MCU_MODE(LORAMAC_ENERGY_MCU_STOP);
   /* USER CODE END EnterStopMode_1 */
   HAL_SuspendTick();
   /* Clear Status Flag before entering STOP/STANDBY Mode */
@@ -111,7 +111,7 @@ void PWR_EnterStopMode(void)
 void PWR_ExitStopMode(void)
 {
   /* USER CODE BEGIN ExitStopMode_1 */
-
+  LORAMAC_ENERGY_MCU_MODE(LORAMAC_ENERGY_MCU_RUN);
   /* USER CODE END ExitStopMode_1 */
   /* Resume sysTick : work around for debugger problem in dual core */
   HAL_ResumeTick();
@@ -130,7 +130,7 @@ void PWR_ExitStopMode(void)
 void PWR_EnterSleepMode(void)
 {
   /* USER CODE BEGIN EnterSleepMode_1 */
-
+  LORAMAC_ENERGY_MCU_MODE(LORAMAC_ENERGY_MCU_SLEEP);
   /* USER CODE END EnterSleepMode_1 */
   /* Suspend sysTick */
   HAL_SuspendTick();
@@ -146,7 +146,7 @@ void PWR_EnterSleepMode(void)
 void PWR_ExitSleepMode(void)
 {
   /* USER CODE BEGIN ExitSleepMode_1 */
-
+  LORAMAC_ENERGY_MCU_MODE(LORAMAC_ENERGY_MCU_RUN);
   /* USER CODE END ExitSleepMode_1 */
   /* Suspend sysTick */
   HAL_ResumeTick();
@@ -61,7 +61,7 @@ extern SUBGHZ_HandleTypeDef hsubghz;
 extern DMA_HandleTypeDef hdma_usart1_tx;
 extern UART_HandleTypeDef huart1;
 /* USER CODE BEGIN EV */
-
+extern DMA_HandleTypeDef hdma_adc;
 /* USER CODE END EV */
 
 /******************************************************************************/
@@ -286,5 +286,13 @@ void SUBGHZ_Radio_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles DMA1 Channel 1 Interrupt (ADC scan).
+  */
+void DMA1_Channel1_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_adc);
+}
+
 /* USER CODE END 1 */
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,432 @@
+/**
+ * @file uplink_store.c
+ * @brief Store-and-forward flash ring for uplink frames during coverage loss
+ */
+
+#include "uplink_store.h"
+#include "flash_if.h"
+#include "stm32_systime.h"
+#include "utilities.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Flash format */
+#define UPLINK_STORE_MAGIC          0x4B4C5055UL    /* "UPLK" */
+#define UPLINK_STORE_PAGE_HEADER    8               /* Magic and sequence */
+#define UPLINK_STORE_FLAG_SIZE      8               /* Sent flag double word */
+#define UPLINK_STORE_ENTRY_HEADER   (UPLINK_STORE_FLAG_SIZE + sizeof(UplinkStore_RecordHeader_t))
+#define UPLINK_STORE_ALIGN(size)    (((size) + FLASH_IF_PROG_SIZE - 1U) & ~(FLASH_IF_PROG_SIZE - 1U))
+
+/* Page header */
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;                          /* 0 is never used */
+} UplinkStore_PageHeader_t;
+
+/* Record header, programmed together with the data */
+typedef struct {
+    uint32_t timestamp;                         /* SysTime seconds */
+    uint8_t length;                             /* Data bytes */
+    uint8_t reserved;
+    uint16_t crc;                               /* Low half of the CRC32 of header and data */
+} UplinkStore_RecordHeader_t;
+
+/* Position in the ring */
+typedef struct {
+    uint8_t page;
+    uint16_t offset;
+} UplinkStore_Cursor_t;
+
+/* Private variables */
+static uint32_t pageSequence[UPLINK_STORE_PAGES];      /* 0: page not in use */
+static uint32_t lastSequence;
+static UplinkStore_Cursor_t writeCursor;
+static UplinkStore_Cursor_t readCursor;
+static uint32_t batchAddress[UPLINK_STORE_BATCH_MAX];
+static uint8_t batchCount;
+static UplinkStore_Stats_t storeStats;
+static bool storeReady;
+
+/**
+ * @brief Get the flash address of a ring position
+ */
+static uint32_t UplinkStore_Address(uint8_t page, uint16_t offset)
+{
+    return UPLINK_STORE_BASE + (uint32_t)page * FLASH_PAGE_SIZE + offset;
+}
+
+/**
+ * @brief Compute the CRC of a record
+ */
+static uint16_t UplinkStore_Crc(const UplinkStore_RecordHeader_t *header, const uint8_t *data)
+{
+    uint32_t crc = Crc32Init();
+
+    crc = Crc32Update(crc, (uint8_t *)header, offsetof(UplinkStore_RecordHeader_t, crc));
+    crc = Crc32Update(crc, (uint8_t *)data, header->length);
+    return (uint16_t)Crc32Finalize(crc);
+}
+
+/**
+ * @brief Read the entry at a ring position
+ * @param cursor: Entry position
+ * @param header: Record header of the entry
+ * @param pending: Set when the entry is a valid record not sent yet
+ * @return Entry size in flash, 0 at the end of the page data
+ */
+static uint16_t UplinkStore_ReadEntry(const UplinkStore_Cursor_t *cursor, UplinkStore_RecordHeader_t *header, bool *pending)
+{
+    uint32_t address = UplinkStore_Address(cursor->page, cursor->offset);
+    uint8_t data[UPLINK_STORE_MAX_DATA];
+    uint64_t flag;
+    uint16_t size;
+
+    if (cursor->offset + UPLINK_STORE_ENTRY_HEADER > FLASH_PAGE_SIZE)
+    {
+        return 0;
+    }
+    FLASH_Read(&flag, (const void *)address, sizeof(flag));
+    FLASH_Read(header, (const void *)(address + UPLINK_STORE_FLAG_SIZE), sizeof(*header));
+
+    /* Erased header: first free slot. Invalid length: the rest of the page cannot be walked */
+    size = UPLINK_STORE_ENTRY_HEADER + UPLINK_STORE_ALIGN(header->length);
+    if (header->length == 0 || header->length > UPLINK_STORE_MAX_DATA ||
+        cursor->offset + size > FLASH_PAGE_SIZE)
+    {
+        return 0;
+    }
+
+    /* A partially cleared flag is still pending: resending beats losing */
+    FLASH_Read(data, (const void *)(address + UPLINK_STORE_ENTRY_HEADER), header->length);
+    *pending = (flag != 0) && (UplinkStore_Crc(header, data) == header->crc);
+
+    return size;
+}
+
+/**
+ * @brief Move a cursor to the next pending record, stopping at the write position
+ * @param cursor: Position to start from, updated to the record found
+ * @param header: Record header of the record found
+ * @return true if a pending record was found
+ */
+static bool UplinkStore_SeekPending(UplinkStore_Cursor_t *cursor, UplinkStore_RecordHeader_t *header)
+{
+    for (;;)
+    {
+        bool pending = false;
+        uint16_t size = 0;
+
+        if (cursor->page == writeCursor.page && cursor->offset >= writeCursor.offset)
+        {
+            return false;
+        }
+        if (pageSequence[cursor->page] != 0)
+        {
+            size = UplinkStore_ReadEntry(cursor, header, &pending);
+        }
+
+        if (size == 0)
+        {
+            if (cursor->page == writeCursor.page)
+            {
+                return false;
+            }
+            cursor->page = (cursor->page + 1) % UPLINK_STORE_PAGES;
+            cursor->offset = UPLINK_STORE_PAGE_HEADER;
+        }
+        else if (pending)
+        {
+            return true;
+        }
+        else
+        {
+            cursor->offset += size;
+        }
+    }
+}
+
+/**
+ * @brief Erase a page and make it the write page, evicting its unsent records
+ * @param page: Page index
+ * @return UplinkStore_Status_t
+ */
+static UplinkStore_Status_t UplinkStore_StartPage(uint8_t page)
+{
+    UplinkStore_PageHeader_t pageHeader;
+
+    if (pageSequence[page] != 0)
+    {
+        UplinkStore_Cursor_t cursor = { page, UPLINK_STORE_PAGE_HEADER };
+        UplinkStore_RecordHeader_t header;
+        uint16_t size;
+        bool pending;
+
+        /* Oldest first eviction */
+        while ((size = UplinkStore_ReadEntry(&cursor, &header, &pending)) != 0)
+        {
+            if (pending)
+            {
+                storeStats.dropped++;
+                storeStats.pending--;
+            }
+            cursor.offset += size;
+        }
+        pageSequence[page] = 0;
+        batchCount = 0;
+
+        if (readCursor.page == page)
+        {
+            readCursor.page = (page + 1) % UPLINK_STORE_PAGES;
+            readCursor.offset = UPLINK_STORE_PAGE_HEADER;
+        }
+    }
+
+    /* Never write into the page while it is not completely set up */
+    writeCursor.page = page;
+    writeCursor.offset = FLASH_PAGE_SIZE;
+
+    pageHeader.magic = UPLINK_STORE_MAGIC;
+    pageHeader.sequence = ++lastSequence;
+    if (FLASH_Erase((void *)UplinkStore_Address(page, 0), FLASH_PAGE_SIZE) != HAL_OK ||
+        FLASH_Write(UplinkStore_Address(page, 0), &pageHeader, sizeof(pageHeader)) != HAL_OK)
+    {
+        return UPLINK_STORE_ERROR_FLASH;
+    }
+
+    pageSequence[page] = pageHeader.sequence;
+    writeCursor.offset = UPLINK_STORE_PAGE_HEADER;
+    return UPLINK_STORE_OK;
+}
+
+/**
+ * @brief Check that a ring position can be programmed
+ */
+static bool UplinkStore_IsFree(const UplinkStore_Cursor_t *cursor)
+{
+    uint32_t header[UPLINK_STORE_ENTRY_HEADER / sizeof(uint32_t)];
+
+    FLASH_Read(header, (const void *)UplinkStore_Address(cursor->page, cursor->offset), sizeof(header));
+    for (uint8_t i = 0; i < sizeof(header) / sizeof(header[0]); i++)
+    {
+        if (header[i] != UINT32_MAX)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Rebuild the ring state from flash
+ * @return UplinkStore_Status_t
+ */
+UplinkStore_Status_t UplinkStore_Init(void)
+{
+    UplinkStore_Cursor_t cursor;
+    UplinkStore_RecordHeader_t header;
+    int8_t newest = -1;
+
+    storeReady = false;
+    lastSequence = 0;
+    batchCount = 0;
+    memset(&storeStats, 0, sizeof(storeStats));
+
+    for (uint8_t page = 0; page < UPLINK_STORE_PAGES; page++)
+    {
+        UplinkStore_PageHeader_t pageHeader;
+
+        FLASH_Read(&pageHeader, (const void *)UplinkStore_Address(page, 0), sizeof(pageHeader));
+        pageSequence[page] = 0;
+        if (pageHeader.magic == UPLINK_STORE_MAGIC &&
+            pageHeader.sequence != 0 && pageHeader.sequence != UINT32_MAX)
+        {
+            pageSequence[page] = pageHeader.sequence;
+            if (pageHeader.sequence > lastSequence)
+            {
+                lastSequence = pageHeader.sequence;
+                newest = page;
+            }
+        }
+    }
+
+    if (newest < 0)
+    {
+        /* Blank or foreign content */
+        readCursor.page = 0;
+        readCursor.offset = UPLINK_STORE_PAGE_HEADER;
+        if (UplinkStore_StartPage(0) != UPLINK_STORE_OK)
+        {
+            return UPLINK_STORE_ERROR_FLASH;
+        }
+        storeReady = true;
+        return UPLINK_STORE_OK;
+    }
+
+    /* Write position: after the last entry of the newest page */
+    writeCursor.page = newest;
+    writeCursor.offset = UPLINK_STORE_PAGE_HEADER;
+    for (;;)
+    {
+        bool pending;
+        uint16_t size = UplinkStore_ReadEntry(&writeCursor, &header, &pending);
+
+        if (size == 0)
+        {
+            break;
+        }
+        writeCursor.offset += size;
+    }
+
+    /* Read position: the oldest page follows the newest one in the ring */
+    for (uint8_t i = 1; i <= UPLINK_STORE_PAGES; i++)
+    {
+        uint8_t page = (newest + i) % UPLINK_STORE_PAGES;
+
+        if (pageSequence[page] != 0)
+        {
+            readCursor.page = page;
+            readCursor.offset = UPLINK_STORE_PAGE_HEADER;
+            break;
+        }
+    }
+
+    cursor = readCursor;
+    while (UplinkStore_SeekPending(&cursor, &header))
+    {
+        storeStats.pending++;
+        cursor.offset += UPLINK_STORE_ENTRY_HEADER + UPLINK_STORE_ALIGN(header.length);
+    }
+    UplinkStore_SeekPending(&readCursor, &header);
+
+    storeReady = true;
+    return UPLINK_STORE_OK;
+}
+
+/**
+ * @brief Append a frame to the ring, with the current SysTime as timestamp
+ * @param data: Frame to store
+ * @param size: Frame size (1 to UPLINK_STORE_MAX_DATA)
+ * @return UplinkStore_Status_t
+ */
+UplinkStore_Status_t UplinkStore_Put(const uint8_t *data, uint8_t size)
+{
+    uint8_t record[sizeof(UplinkStore_RecordHeader_t) + UPLINK_STORE_MAX_DATA];
+    UplinkStore_RecordHeader_t header;
+    uint16_t entrySize = UPLINK_STORE_ENTRY_HEADER + UPLINK_STORE_ALIGN(size);
+
+    if (data == NULL || size == 0 || size > UPLINK_STORE_MAX_DATA)
+    {
+        return UPLINK_STORE_ERROR_INVALID_PARAM;
+    }
+    if (!storeReady)
+    {
+        return UPLINK_STORE_ERROR_FLASH;
+    }
+
+    if (writeCursor.offset + entrySize > FLASH_PAGE_SIZE || !UplinkStore_IsFree(&writeCursor))
+    {
+        if (UplinkStore_StartPage((writeCursor.page + 1) % UPLINK_STORE_PAGES) != UPLINK_STORE_OK)
+        {
+            storeStats.dropped++;
+            return UPLINK_STORE_ERROR_FLASH;
+        }
+    }
+
+    header.timestamp = SysTimeGet().Seconds;
+    header.length = size;
+    header.reserved = 0xFF;
+    header.crc = UplinkStore_Crc(&header, data);
+    memcpy(record, &header, sizeof(header));
+    memcpy(&record[sizeof(header)], data, size);
+
+    /* The sent flag is left erased, the header comes first so a reset leaves a bad CRC */
+    if (FLASH_Write(UplinkStore_Address(writeCursor.page, writeCursor.offset) + UPLINK_STORE_FLAG_SIZE,
+                    record, sizeof(header) + size) != HAL_OK)
+    {
+        writeCursor.offset = FLASH_PAGE_SIZE;
+        storeStats.dropped++;
+        return UPLINK_STORE_ERROR_FLASH;
+    }
+
+    writeCursor.offset += entrySize;
+    storeStats.stored++;
+    storeStats.pending++;
+    return UPLINK_STORE_OK;
+}
+
+/**
+ * @brief Get the number of records waiting in flash
+ */
+uint32_t UplinkStore_Pending(void)
+{
+    return storeStats.pending;
+}
+
+/**
+ * @brief Pack the oldest pending records into one backfill frame
+ * @param buffer: Frame buffer
+ * @param maxSize: Maximum payload for the current data rate
+ * @return Frame size (0 if nothing to send)
+ * @note  Records are only marked as sent by UplinkStore_Commit, so a frame
+ *        that could not be sent is rebuilt on the next attempt
+ */
+uint8_t UplinkStore_BuildFrame(uint8_t *buffer, uint8_t maxSize)
+{
+    UplinkStore_Cursor_t cursor = readCursor;
+    UplinkStore_RecordHeader_t header;
+    uint8_t size = 0;
+
+    batchCount = 0;
+    while (batchCount < UPLINK_STORE_BATCH_MAX && UplinkStore_SeekPending(&cursor, &header))
+    {
+        uint32_t address = UplinkStore_Address(cursor.page, cursor.offset);
+
+        if (size + UPLINK_STORE_RECORD_HEADER + header.length > maxSize)
+        {
+            break;
+        }
+
+        buffer[size++] = (uint8_t)(header.timestamp >> 24);
+        buffer[size++] = (uint8_t)(header.timestamp >> 16);
+        buffer[size++] = (uint8_t)(header.timestamp >> 8);
+        buffer[size++] = (uint8_t)header.timestamp;
+        buffer[size++] = header.length;
+        FLASH_Read(&buffer[size], (const void *)(address + UPLINK_STORE_ENTRY_HEADER), header.length);
+        size += header.length;
+
+        batchAddress[batchCount++] = address;
+        cursor.offset += UPLINK_STORE_ENTRY_HEADER + UPLINK_STORE_ALIGN(header.length);
+    }
+
+    return size;
+}
+
+/**
+ * @brief Mark the records of the last built frame as sent
+ * @note  Call once the uplink carrying the frame was accepted by the MAC
+ */
+void UplinkStore_Commit(void)
+{
+    static const uint64_t sentFlag = 0;
+    UplinkStore_RecordHeader_t header;
+
+    for (uint8_t i = 0; i < batchCount; i++)
+    {
+        /* Zeros may be programmed over a programmed double word */
+        FLASH_Write(batchAddress[i], &sentFlag, sizeof(sentFlag));
+        storeStats.sent++;
+        storeStats.pending--;
+    }
+    batchCount = 0;
+
+    UplinkStore_SeekPending(&readCursor, &header);
+}
+
+/**
+ * @brief Get the store counters
+ * @param stats: Counters copy
+ */
+void UplinkStore_GetStats(UplinkStore_Stats_t *stats)
+{
+    *stats = storeStats;
+}
@@ -41,6 +41,11 @@
 /* USER CODE BEGIN Includes */
 #include "rs485.h"
 #include "modbus.h"
+#include "modbus_poll.h"
+#include "nvm_flash.h"
+#include "nvmm.h"
+#include "uplink_store.h"
+#include "LoRaMacEnergy.h"
 /* USER CODE END Includes */
 
 /* External variables ---------------------------------------------------------*/
@@ -138,6 +143,16 @@ static void OnRxTimerLedEvent(void *context);
   */
 static void OnJoinTimerLedEvent(void *context);
 
+/**
+  * @brief  Modbus poll scheduler notification: some entry changed
+  */
+static void OnModbusChange(void);
+
+/**
+  * @brief  Backfill the frames stored while offline
+  */
+static void SendStoredData(void);
+
 /* USER CODE END PFP */
 
 /* Private variables ---------------------------------------------------------*/
@@ -191,6 +206,16 @@ static uint8_t AppDataBuffer[LORAWAN_APP_DATA_BUFFER_MAX_SIZE];
   */
 static uint8_t relayState = 0;
 
+/**
+  * @brief Modbus poll table: one entry per (slave, function, range, period)
+  * @note  Uplink records reference entries by their index in this table
+  */
+static const ModbusPoll_Entry_t ModbusPollTable[] =
+{
+  /* slave,             function,              address, quantity,           period, deadband */
+  { MODBUS_SLAVE_ADDR,  MODBUS_FC_READ_COILS,  0x0000,  MODBUS_RELAY_COUNT, 10000,  0 },
+};
+
 /**
   * @brief User application data structure
   */
@@ -254,6 +279,26 @@ void LoRaWAN_Init(void)
   UTIL_TIMER_SetPeriod(&RxLedTimer, 500);
   UTIL_TIMER_SetPeriod(&JoinLedTimer, 500);
 
+  /* Mount the context storage before LmHandlerConfigure restores the session */
+  if (NvmFlash_Init() == NVM_FLASH_OK)
+  {
+    NvmmInit(NvmFlash_GetFs(), NvmFlash_GetJournal());
+  }
+  else
+  {
+    APP_LOG(TS_OFF, VLEVEL_M, "NVM flash mount failed, context not stored\r\n");
+  }
+
+  /* Frames stored before the reset are backfilled once joined */
+  if (UplinkStore_Init() == UPLINK_STORE_OK)
+  {
+    APP_LOG(TS_OFF, VLEVEL_M, "Uplink store: %d frame(s) pending\r\n", UplinkStore_Pending());
+  }
+  else
+  {
+    APP_LOG(TS_OFF, VLEVEL_M, "Uplink store init failed, offline frames are lost\r\n");
+  }
+
   /* USER CODE END LoRaWAN_Init_1 */
 
   UTIL_SEQ_RegTask((1 << CFG_SEQ_Task_LmHandlerProcess), UTIL_SEQ_RFU, LmHandlerProcess);
@@ -291,7 +336,9 @@ void LoRaWAN_Init(void)
 
   /* USER CODE BEGIN LoRaWAN_Init_Last */
   /* Enable BOTH periodic timer AND button for RS485 gateway */
-  /* Timer for periodic status uplink */
+  /* Modbus poll scheduler: uplinks are generated on change only */
+  ModbusPoll_Init(ModbusPollTable, sizeof(ModbusPollTable) / sizeof(ModbusPollTable[0]), OnModbusChange);
+  /* Timer to retry pending reports deferred by duty cycle or join */
   UTIL_TIMER_Create(&TxTimer, 0xFFFFFFFFU, UTIL_TIMER_ONESHOT, OnTxTimerEvent, NULL);
   UTIL_TIMER_SetPeriod(&TxTimer, APP_TX_DUTYCYCLE);
   UTIL_TIMER_Start(&TxTimer);
@@ -314,7 +361,8 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
   switch (GPIO_Pin)
   {
     case  BUTTON_SW1_PIN:
-      /* Button press: Trigger immediate relay status uplink */
+      /* Button press: Trigger immediate full status uplink */
+      ModbusPoll_ForceReport();
       UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_LoRaSendOnTxTimerOrButtonEvent), CFG_SEQ_Prio_0);
       BSP_LED_Toggle(LED_RED);
       break;
@@ -424,17 +472,10 @@ static void OnRxData(LmHandlerAppData_t *appData, LmHandlerRxParams_t *params)
             HAL_Delay(100);
           }
 
-          /* Send uplink response with current relay states */
+          /* Re-poll the relay board and report its state even if unchanged */
           if (successCount > 0)
           {
-            uint8_t relayStates = 0;
-            if (Modbus_ReadCoils(&relayStates) == MODBUS_OK)
-            {
-              AppData.Port = LORAWAN_RS485_PORT;
-              AppData.Buffer[0] = relayStates;
-              AppData.BufferSize = 1;
-              UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_LoRaSendOnTxTimerOrButtonEvent), CFG_SEQ_Prio_0);
-            }
+            ModbusPoll_Refresh(MODBUS_SLAVE_ADDR);
           }
         }
         break;
@@ -451,46 +492,51 @@ static void SendTxData(void)
 {
   /* USER CODE BEGIN SendTxData_1 */
   UTIL_TIMER_Time_t nextTxIn = 0;
+  LoRaMacTxInfo_t txInfo;
+  LmHandlerErrorStatus_t status;
+  uint8_t maxSize = 0;
 
-  /* If AppData is already set for RS485 response, send it directly */
-  if (AppData.Port == LORAWAN_RS485_PORT && AppData.BufferSize > 0)
+  /* Only changed Modbus entries are sent, stored frames use the idle slots */
+  if (ModbusPoll_HasPending() == false)
   {
-    /* AppData already contains relay states from OnRxData handler */
-    if (LORAMAC_HANDLER_SUCCESS == LmHandlerSend(&AppData, LORAWAN_DEFAULT_CONFIRMED_MSG_STATE, &nextTxIn, false))
-    {
-      APP_LOG(TS_ON, VLEVEL_L, "RS485 RESPONSE UPLINK\r\n");
-    }
-    /* Reset AppData for normal operation */
-    AppData.Port = LORAWAN_USER_APP_PORT;
-    AppData.BufferSize = 0;
+    SendStoredData();
     return;
   }
 
-  /* Periodic uplink: Read and send relay status */
-  uint8_t relayStates = 0;
-  Modbus_Status_t modbusStatus = Modbus_ReadCoils(&relayStates);
-
-  if (modbusStatus == MODBUS_OK)
+  /* Coalesce as many pending entries as the current data rate allows */
+  LoRaMacQueryTxPossible(0, &txInfo);
+  maxSize = MIN(txInfo.MaxPossibleApplicationDataSize, LORAWAN_APP_DATA_BUFFER_MAX_SIZE);
+  if (LmHandlerJoinStatus() != LORAMAC_HANDLER_SET)
   {
-    AppData.Port = LORAWAN_RS485_PORT;
-    AppData.Buffer[0] = relayStates;
-    AppData.BufferSize = 1;
+    /* Offline frames go to the store, keep them backfillable at any data rate */
+    maxSize = MIN(maxSize, UPLINK_STORE_MAX_DATA);
   }
-  else
+
+  AppData.Port = LORAWAN_RS485_PORT;
+  AppData.BufferSize = ModbusPoll_BuildFrame(AppData.Buffer, maxSize);
+  if (AppData.BufferSize == 0)
   {
-    /* If Modbus read fails, send error indicator */
-    AppData.Port = LORAWAN_RS485_PORT;
-    AppData.Buffer[0] = 0xFF;  /* 0xFF indicates error */
-    AppData.BufferSize = 1;
+    return;
   }
 
-  if (LORAMAC_HANDLER_SUCCESS == LmHandlerSend(&AppData, LORAWAN_DEFAULT_CONFIRMED_MSG_STATE, &nextTxIn, false))
+  status = LmHandlerSend(&AppData, LORAWAN_DEFAULT_CONFIRMED_MSG_STATE, &nextTxIn, false);
+  if (status == LORAMAC_HANDLER_SUCCESS)
   {
-    APP_LOG(TS_ON, VLEVEL_L, "RS485 STATUS UPLINK\r\n");
+    APP_LOG(TS_ON, VLEVEL_L, "RS485 STATUS UPLINK (%d bytes)\r\n", AppData.BufferSize);
+    ModbusPoll_Commit();
     /* Toggle LED to show uplink sent */
     BSP_LED_Toggle(LED_RED);
+    return;
   }
-  else if (nextTxIn > 0)
+
+  /* Not joined or duty cycle restricted: keep the reading with its timestamp */
+  if ((status == LORAMAC_HANDLER_NO_NETWORK_JOINED || status == LORAMAC_HANDLER_DUTYCYCLE_RESTRICTED) &&
+      UplinkStore_Put(AppData.Buffer, AppData.BufferSize) == UPLINK_STORE_OK)
+  {
+    APP_LOG(TS_ON, VLEVEL_L, "RS485 STATUS STORED (%d pending)\r\n", UplinkStore_Pending());
+    ModbusPoll_Commit();
+  }
+  if (nextTxIn > 0)
   {
     APP_LOG(TS_ON, VLEVEL_L, "Next Tx in  : ~%d second(s)\r\n", (nextTxIn / 1000));
   }
@@ -528,6 +574,41 @@ static void OnJoinTimerLedEvent(void *context)
   BSP_LED_Toggle(LED_RED) ;
 }
 
+static void OnModbusChange(void)
+{
+  UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_LoRaSendOnTxTimerOrButtonEvent), CFG_SEQ_Prio_0);
+}
+
+static void SendStoredData(void)
+{
+  UTIL_TIMER_Time_t nextTxIn = 0;
+  LoRaMacTxInfo_t txInfo;
+  uint8_t maxSize = 0;
+
+  if (LmHandlerJoinStatus() != LORAMAC_HANDLER_SET || UplinkStore_Pending() == 0)
+  {
+    return;
+  }
+
+  /* Batch as many stored frames as the current data rate allows */
+  LoRaMacQueryTxPossible(0, &txInfo);
+  maxSize = MIN(txInfo.MaxPossibleApplicationDataSize, LORAWAN_APP_DATA_BUFFER_MAX_SIZE);
+
+  AppData.Port = LORAWAN_STORE_PORT;
+  AppData.BufferSize = UplinkStore_BuildFrame(AppData.Buffer, maxSize);
+  if (AppData.BufferSize == 0)
+  {
+    return;
+  }
+
+  if (LORAMAC_HANDLER_SUCCESS == LmHandlerSend(&AppData, LORAWAN_DEFAULT_CONFIRMED_MSG_STATE, &nextTxIn, false))
+  {
+    UplinkStore_Commit();
+    APP_LOG(TS_ON, VLEVEL_L, "STORED FRAMES UPLINK (%d bytes, %d pending)\r\n", AppData.BufferSize,
+            UplinkStore_Pending());
+  }
+}
+
 /* USER CODE END PrFD_LedEvents */
 
 static void OnTxData(LmHandlerTxParams_t *params)
@@ -554,6 +635,21 @@ static void OnTxData(LmHandlerTxParams_t *params)
       {
         APP_LOG(TS_OFF, VLEVEL_H, "UNCONFIRMED\r\n");
       }
+#if (LORAMAC_ENERGY_ENABLED == 1)
+      LoRaMacEnergyUplink_t uplinkEnergy;
+      if (LoRaMacEnergyGetLastUplink(&uplinkEnergy) == true)
+      {
+        APP_LOG(TS_OFF, VLEVEL_M, "###### ENERGY:%u nAh | TX:%u ms | RX:%u ms | NbTrans:%d\r\n",
+                (unsigned int)uplinkEnergy.Charge, (unsigned int)uplinkEnergy.TxTime,
+                (unsigned int)uplinkEnergy.RxTime, uplinkEnergy.Transmissions);
+      }
+#endif
+
+      /* Send entries that did not fit in the previous frame, then the backlog */
+      if (ModbusPoll_HasPending() || UplinkStore_Pending() > 0)
+      {
+        UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_LoRaSendOnTxTimerOrButtonEvent), CFG_SEQ_Prio_0);
+      }
     }
   }
   /* USER CODE END OnTxData_1 */
@@ -578,6 +674,12 @@ static void OnJoinRequest(LmHandlerJoinParams_t *joinParams)
       {
         APP_LOG(TS_OFF, VLEVEL_M, "OTAA =====================\r\n");
       }
+
+      /* Link is back: start the backfill */
+      if (UplinkStore_Pending() > 0)
+      {
+        UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_LoRaSendOnTxTimerOrButtonEvent), CFG_SEQ_Prio_0);
+      }
     }
     else
     {
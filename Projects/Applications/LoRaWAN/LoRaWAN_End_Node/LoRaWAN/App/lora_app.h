@@ -49,6 +49,8 @@ extern "C" {
 
 /*!
  * Defines the application data transmission duty cycle. 10s, value in [ms].
+ * @note With the Modbus poll scheduler this timer only retries pending reports;
+ *       uplinks are generated on change (see ModbusPollTable in lora_app.c)
  */
 #define APP_TX_DUTYCYCLE                            60000  /* 60 seconds */
 
@@ -109,6 +111,11 @@ extern "C" {
  * LoRaWAN RS485 Modbus port for relay control
  */
 #define LORAWAN_RS485_PORT                          10
+
+/*!
+ * LoRaWAN port for frames stored while offline, see uplink_store.h
+ */
+#define LORAWAN_STORE_PORT                          11
 /* USER CODE END EC */
 
 /* Exported macro ------------------------------------------------------------*/
@@ -69,7 +69,25 @@ extern "C" {
  * Enables/Disables the context storage management storage.
  * Must be enabled for LoRaWAN 1.0.4 or later.
  */
-#define CONTEXT_MANAGEMENT_ENABLED                      0
+#define CONTEXT_MANAGEMENT_ENABLED                      1
+
+/*!
+ * Enables/Disables the downlink processing time instrumentation (LoRaMacProfile).
+ * Uses the DWT cycle counter, keep it disabled in production builds.
+ */
+#define LORAMAC_PROFILE_ENABLED                         0
+
+/*!
+ * Enables/Disables the device side link quality tracker (LoRaMacLinkQuality).
+ * While ADR is off, it adapts the datarate and TX power of the unconfirmed uplinks.
+ */
+#define LORAMAC_LINK_QUALITY_ENABLED                    0
+
+/*!
+ * Enables/Disables the energy ledger (LoRaMacEnergy).
+ * Accounts the radio and MCU charge of each uplink and of the other activities.
+ */
+#define LORAMAC_ENERGY_ENABLED                          0
 
 /* Class B ------------------------------------*/
 #define LORAMAC_CLASSB_ENABLED  0
@@ -95,6 +113,13 @@ extern "C" {
   * \brief Turnover temperature deviation of the clock source
   */
 #define RTC_TEMP_DEV_TURNOVER                           ( 5.0 )
+
+/*!
+ * Enables/Disables the beacon search (LoRaMacBeaconSearch).
+ * Sizes the beacon windows on the RTC drift measured on the beacons and
+ * acquires the beacon again on the RTC time of the last beacon received.
+ */
+#define LORAMAC_CLASSB_BEACON_SEARCH_ENABLED            0
 #endif /* LORAMAC_CLASSB_ENABLED == 1 */
 
 /* USER CODE BEGIN EC */
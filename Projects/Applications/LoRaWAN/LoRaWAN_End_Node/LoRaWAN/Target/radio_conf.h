@@ -101,6 +101,12 @@ extern "C" {
   */
 #define DCDC_ENABLE                 ( 1UL )
 
+/**
+  * @brief Skip radio set commands whose parameters are already programmed
+  * @note override the default configuration of radio_driver.c
+  */
+#define SUBGRF_SHADOW_ENABLE        ( 1UL )
+
 /* USER CODE BEGIN EC */
 
 /* USER CODE END EC */
@@ -74,6 +74,38 @@
   #define UTIL_LPM_EXIT_CRITICAL_SECTION_ELP( )     UTIL_LPM_EXIT_CRITICAL_SECTION( )
 #endif
 
+/**
+ * @brief enable the deadline aware mode selection
+ * @note  when set, UTIL_LPM_GET_TIME( ) shall return a free running tick counter
+ *        and UTIL_LPM_GET_NEXT_DEADLINE( ) the number of the same ticks before
+ *        the next programmed wake up (0xFFFFFFFF when none)
+ */
+#ifndef UTIL_LPM_GOVERNOR_ENABLE
+  #define UTIL_LPM_GOVERNOR_ENABLE                  0
+#endif
+
+#if ( UTIL_LPM_GOVERNOR_ENABLE == 1 )
+#if !defined( UTIL_LPM_GET_TIME ) || !defined( UTIL_LPM_GET_NEXT_DEADLINE )
+  #error "UTIL_LPM_GET_TIME and UTIL_LPM_GET_NEXT_DEADLINE shall be defined when UTIL_LPM_GOVERNOR_ENABLE is set"
+#endif
+
+/**
+ * @brief minimum time, in ticks, to spend in stop mode to pay back its entry and exit
+ *        on top of the measured wake up latency
+ */
+#ifndef UTIL_LPM_STOP_MIN_RESIDENCY
+  #define UTIL_LPM_STOP_MIN_RESIDENCY               (2UL)
+#endif
+
+/**
+ * @brief minimum time, in ticks, to spend in off mode to pay back its entry and exit
+ *        on top of the measured wake up latency
+ */
+#ifndef UTIL_LPM_OFF_MIN_RESIDENCY
+  #define UTIL_LPM_OFF_MIN_RESIDENCY                (20UL)
+#endif
+#endif /* UTIL_LPM_GOVERNOR_ENABLE */
+
 /**
  * @}
  */
@@ -90,6 +122,26 @@
  */
 #define UTIL_LPM_NO_BIT_SET   (0UL)
 
+/**
+ * @brief number of low power modes
+ */
+#define UTIL_LPM_MODE_NB      (UTIL_LPM_OFFMODE + 1)
+
+/**
+ * @brief fractional bits of the wake up latency average
+ */
+#define UTIL_LPM_LATENCY_FRAC (4U)
+
+/**
+ * @brief weight, as a right shift, of a new sample in the wake up latency average
+ */
+#define UTIL_LPM_LATENCY_AVG  (3U)
+
+/**
+ * @brief value returned by UTIL_LPM_GET_NEXT_DEADLINE when no wake up is programmed
+ */
+#define UTIL_LPM_NO_DEADLINE  (0xFFFFFFFFUL)
+
 /**
  * @}
  */
@@ -109,6 +161,14 @@ static UTIL_LPM_bm_t StopModeDisable = UTIL_LPM_NO_BIT_SET;
  */
 static UTIL_LPM_bm_t OffModeDisable = UTIL_LPM_NO_BIT_SET;
 
+#if ( UTIL_LPM_GOVERNOR_ENABLE == 1 )
+/**
+ * @brief residency and transition statistics of each low power mode
+ * @note  WakeUpLatency is kept with UTIL_LPM_LATENCY_FRAC fractional bits
+ */
+static UTIL_LPM_Stats_t ModeStats[UTIL_LPM_MODE_NB];
+#endif /* UTIL_LPM_GOVERNOR_ENABLE */
+
 /**
  * @}
  */
@@ -116,6 +176,62 @@ static UTIL_LPM_bm_t OffModeDisable = UTIL_LPM_NO_BIT_SET;
 /* Private function prototypes -----------------------------------------------*/
 /* Functions Definition ------------------------------------------------------*/
 
+#if ( UTIL_LPM_GOVERNOR_ENABLE == 1 )
+/** @defgroup TINY_LPM_Private_function TINY LPM private functions
+  * @{
+  */
+
+/**
+ * @brief  Returns the time the system shall stay in a mode for the transition to pay back
+ * @param  mode: low power mode
+ * @retval break even time in ticks
+ */
+static uint32_t UTIL_LPM_BreakEven( UTIL_LPM_Mode_t mode )
+{
+  uint32_t latency = ( ModeStats[mode].WakeUpLatency + ( 1UL << UTIL_LPM_LATENCY_FRAC ) - 1U ) >> UTIL_LPM_LATENCY_FRAC;
+
+  if( mode == UTIL_LPM_OFFMODE )
+  {
+    return UTIL_LPM_OFF_MIN_RESIDENCY + latency;
+  }
+  return UTIL_LPM_STOP_MIN_RESIDENCY + latency;
+}
+
+/**
+ * @brief  Records a low power period and learns the wake up latency of the mode
+ * @param  mode: low power mode that was used
+ * @param  elapsed: ticks between the entry request and the end of the exit
+ * @param  deadline: ticks before the programmed wake up when entering
+ */
+static void UTIL_LPM_UpdateStats( UTIL_LPM_Mode_t mode, uint32_t elapsed, uint32_t deadline )
+{
+  UTIL_LPM_Stats_t *stats = &ModeStats[mode];
+
+  stats->Entries++;
+  stats->Residency += elapsed;
+
+  /* Woken up by the programmed deadline: the overshoot is the wake up latency */
+  if( ( deadline != UTIL_LPM_NO_DEADLINE ) && ( elapsed >= deadline ) )
+  {
+    uint32_t sample = ( elapsed - deadline ) << UTIL_LPM_LATENCY_FRAC;
+
+    if( stats->WakeUpLatency == 0U )
+    {
+      stats->WakeUpLatency = sample;
+    }
+    else
+    {
+      stats->WakeUpLatency = stats->WakeUpLatency - ( stats->WakeUpLatency >> UTIL_LPM_LATENCY_AVG )
+                           + ( sample >> UTIL_LPM_LATENCY_AVG );
+    }
+  }
+}
+
+/**
+ * @}
+ */
+#endif /* UTIL_LPM_GOVERNOR_ENABLE */
+
 /** @addtogroup TINY_LPM_Exported_function
   * @{
   */
@@ -123,6 +239,9 @@ void UTIL_LPM_Init( void )
 {
   StopModeDisable = UTIL_LPM_NO_BIT_SET;
   OffModeDisable = UTIL_LPM_NO_BIT_SET;
+#if ( UTIL_LPM_GOVERNOR_ENABLE == 1 )
+  UTIL_LPM_ResetStats( );
+#endif /* UTIL_LPM_GOVERNOR_ENABLE */
   UTIL_LPM_INIT_CRITICAL_SECTION( );
 }
 
@@ -215,6 +334,12 @@ UTIL_LPM_Mode_t UTIL_LPM_GetMode( void )
 
 void UTIL_LPM_EnterLowPower( void )
 {
+  UTIL_LPM_Mode_t mode_selected;
+#if ( UTIL_LPM_GOVERNOR_ENABLE == 1 )
+  uint32_t deadline;
+  uint32_t start;
+#endif /* UTIL_LPM_GOVERNOR_ENABLE */
+
   UTIL_LPM_ENTER_CRITICAL_SECTION_ELP( );
 
   if( StopModeDisable != UTIL_LPM_NO_BIT_SET )
@@ -223,33 +348,99 @@ void UTIL_LPM_EnterLowPower( void )
      * At least one user disallows Stop Mode
      * SLEEP mode is required
      */
-      UTIL_PowerDriver.EnterSleepMode( );
-      UTIL_PowerDriver.ExitSleepMode( );
+    mode_selected = UTIL_LPM_SLEEPMODE;
+  }
+  else if( OffModeDisable != UTIL_LPM_NO_BIT_SET )
+  {
+    /**
+     * At least one user disallows Off Mode
+     * STOP mode is required
+     */
+    mode_selected = UTIL_LPM_STOPMODE;
   }
   else
-  { 
-    if( OffModeDisable != UTIL_LPM_NO_BIT_SET )
+  {
+    /**
+     * OFF mode is required
+     */
+    mode_selected = UTIL_LPM_OFFMODE;
+  }
+
+#if ( UTIL_LPM_GOVERNOR_ENABLE == 1 )
+  /**
+   * Fall back to a lighter mode when the next wake up comes before the
+   * deeper one pays back its transition
+   */
+  deadline = UTIL_LPM_GET_NEXT_DEADLINE( );
+  while( ( mode_selected != UTIL_LPM_SLEEPMODE ) && ( deadline < UTIL_LPM_BreakEven( mode_selected ) ) )
+  {
+    ModeStats[mode_selected].Demotions++;
+    mode_selected = ( UTIL_LPM_Mode_t )( mode_selected - 1 );
+  }
+  start = UTIL_LPM_GET_TIME( );
+#endif /* UTIL_LPM_GOVERNOR_ENABLE */
+
+  switch( mode_selected )
+  {
+  case UTIL_LPM_SLEEPMODE:
     {
-      /**
-       * At least one user disallows Off Mode
-       * STOP mode is required
-       */
-        UTIL_PowerDriver.EnterStopMode( );
-        UTIL_PowerDriver.ExitStopMode( );
+      UTIL_PowerDriver.EnterSleepMode( );
+      UTIL_PowerDriver.ExitSleepMode( );
+      break;
     }
-    else
+  case UTIL_LPM_STOPMODE:
+    {
+      UTIL_PowerDriver.EnterStopMode( );
+      UTIL_PowerDriver.ExitStopMode( );
+      break;
+    }
+  default :
     {
-      /**
-       * OFF mode is required
-       */
       UTIL_PowerDriver.EnterOffMode( );
       UTIL_PowerDriver.ExitOffMode( );
+      break;
     }
   }
-  
+
+#if ( UTIL_LPM_GOVERNOR_ENABLE == 1 )
+  UTIL_LPM_UpdateStats( mode_selected, UTIL_LPM_GET_TIME( ) - start, deadline );
+#endif /* UTIL_LPM_GOVERNOR_ENABLE */
+
   UTIL_LPM_EXIT_CRITICAL_SECTION_ELP( );
 }
 
+#if ( UTIL_LPM_GOVERNOR_ENABLE == 1 )
+void UTIL_LPM_GetStats( UTIL_LPM_Mode_t mode, UTIL_LPM_Stats_t *stats )
+{
+  if( ( stats == NULL ) || ( mode >= UTIL_LPM_MODE_NB ) )
+  {
+    return;
+  }
+
+  UTIL_LPM_ENTER_CRITICAL_SECTION( );
+
+  *stats = ModeStats[mode];
+  stats->WakeUpLatency >>= UTIL_LPM_LATENCY_FRAC;
+
+  UTIL_LPM_EXIT_CRITICAL_SECTION( );
+}
+
+void UTIL_LPM_ResetStats( void )
+{
+  UTIL_LPM_ENTER_CRITICAL_SECTION( );
+
+  for( uint32_t i = 0; i < UTIL_LPM_MODE_NB; i++ )
+  {
+    /* Keep the learnt latency, it describes the hardware and not the period */
+    ModeStats[i].Entries = 0;
+    ModeStats[i].Demotions = 0;
+    ModeStats[i].Residency = 0;
+  }
+
+  UTIL_LPM_EXIT_CRITICAL_SECTION( );
+}
+#endif /* UTIL_LPM_GOVERNOR_ENABLE */
+
 /**
  * @}
  */
@@ -27,6 +27,7 @@ extern "C" {
 
 /* Includes ------------------------------------------------------------------*/
 #include "stdint.h"
+#include "stddef.h"
 
 /** @defgroup TINY_LPM TINY LPM
   * @{
@@ -62,6 +63,18 @@ typedef enum
   UTIL_LPM_OFFMODE,
 } UTIL_LPM_Mode_t;
 
+/**
+ * @brief type definition of the statistics of a low power mode
+ * @note  times are expressed in UTIL_LPM_GET_TIME ticks
+ */
+typedef struct
+{
+  uint32_t Entries;       /*!< number of times the mode was used                             */
+  uint32_t Demotions;     /*!< number of times the mode was allowed but the deadline too close */
+  uint32_t Residency;     /*!< total time spent in the mode, transitions included            */
+  uint32_t WakeUpLatency; /*!< learnt time between the programmed wake up and the exit end    */
+} UTIL_LPM_Stats_t;
+
 /**
  * @}
  */
@@ -152,6 +165,20 @@ void UTIL_LPM_SetOffMode( UTIL_LPM_bm_t lpm_id_bm, UTIL_LPM_State_t state );
  */
 void UTIL_LPM_EnterLowPower( void );
 
+/**
+ * @brief  This API returns the residency and transition statistics of a low power mode
+ * @note   only available when UTIL_LPM_GOVERNOR_ENABLE is set
+ * @param  mode: low power mode based on @ref UTIL_LPM_Mode_t
+ * @param  stats: pointer to the statistics to fill
+ */
+void UTIL_LPM_GetStats( UTIL_LPM_Mode_t mode, UTIL_LPM_Stats_t *stats );
+
+/**
+ * @brief  This API clears the residency and transition statistics, the learnt wake up latencies are kept
+ * @note   only available when UTIL_LPM_GOVERNOR_ENABLE is set
+ */
+void UTIL_LPM_ResetStats( void );
+
 /**
  *@}
  */
@@ -48,6 +48,7 @@
  */
 
 /* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
 #include "stm32_tiny_vsnprintf.h"
 
 /* Private typedef -----------------------------------------------------------*/
@@ -75,6 +76,23 @@
 static char *lower_digits = "0123456789abcdefghijklmnopqrstuvwxyz";
 static char *upper_digits = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
 
+#ifdef TINY_PRINTF
+/* "00" to "99": decimal conversion emits two digits per division by 100 */
+static const char digit_pairs[200] =
+{
+  '0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9',
+  '1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9',
+  '2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9',
+  '3','0','3','1','3','2','3','3','3','4','3','5','3','6','3','7','3','8','3','9',
+  '4','0','4','1','4','2','4','3','4','4','4','5','4','6','4','7','4','8','4','9',
+  '5','0','5','1','5','2','5','3','5','4','5','5','5','6','5','7','5','8','5','9',
+  '6','0','6','1','6','2','6','3','6','4','6','5','6','6','6','7','6','8','6','9',
+  '7','0','7','1','7','2','7','3','7','4','7','5','7','6','7','7','7','8','7','9',
+  '8','0','8','1','8','2','8','3','8','4','8','5','8','6','8','7','8','8','8','9',
+  '9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9',
+};
+#endif
+
 /* Functions Definition ------------------------------------------------------*/
 #ifdef TINY_PRINTF
 #else
@@ -97,6 +115,8 @@ static int ee_skip_atoi(const char **s)
 
 #define ASSIGN_STR(_c)  do { *str++ = (_c); max_size--; if (max_size == 0) return str; } while (0)
 
+#ifdef TINY_PRINTF
+#else
 static char *ee_number(char *str, int max_size, long num, int base, int size, int precision, int type)
 {
   char c;
@@ -190,8 +210,69 @@ static char *ee_number(char *str, int max_size, long num, int base, int size, in
 
   return str;
 }
+#endif
 
 #ifdef TINY_PRINTF
+/*
+ * Fast path of ee_number for the tiny format set (%d, %i, %u, %x, %X with an
+ * optional zero padding and width). The constant divisor lets the compiler
+ * use a multiply instead of a division, and hex digits are plain shifts.
+ */
+static char *ee_number_tiny(char *str, int max_size, unsigned long num, int base, int size, int type)
+{
+  char tmp[12];
+  char *p = &tmp[sizeof(tmp)];
+  char *dig = (type & UPPERCASE) ? upper_digits : lower_digits;
+  uint32_t value = (uint32_t) num;
+  char sign = 0;
+  int len;
+
+  if (base == 16)
+  {
+    do
+    {
+      *--p = dig[value & 0x0F];
+      value >>= 4;
+    } while (value != 0);
+  }
+  else
+  {
+    if ((type & SIGN) && ((int32_t) value < 0))
+    {
+      sign = '-';
+      value = 0U - value;
+      size--;
+    }
+    while (value >= 100)
+    {
+      uint32_t q = value / 100;
+      uint32_t r = value - (q * 100);
+      p -= 2;
+      p[0] = digit_pairs[2 * r];
+      p[1] = digit_pairs[(2 * r) + 1];
+      value = q;
+    }
+    if (value >= 10)
+    {
+      p -= 2;
+      p[0] = digit_pairs[2 * value];
+      p[1] = digit_pairs[(2 * value) + 1];
+    }
+    else
+    {
+      *--p = (char)('0' + value);
+    }
+  }
+
+  len = &tmp[sizeof(tmp)] - p;
+  size -= len;
+  if (!(type & ZEROPAD)) while (size-- > 0) ASSIGN_STR(' ');
+  if (sign) ASSIGN_STR(sign);
+  while (size-- > 0) ASSIGN_STR('0');
+  while (len-- > 0) ASSIGN_STR(*p++);
+
+  return str;
+}
 #else
 static char *eaddr(char *str, unsigned char *addr, int size, int precision, int type)
 {
@@ -494,7 +575,10 @@ int tiny_vsnprintf_like(char *buf, const int size, const char *fmt, va_list args
   int flags;            // Flags to number()
 
   int field_width;      // Width of output field
+#ifdef TINY_PRINTF
+#else
   int precision;        // Min. # of digits for integers; max number of chars for from string
+#endif
   int qualifier;        // 'h', 'l', or 'L' for integer fields
 
   if (size <= 0)
@@ -508,7 +592,17 @@ int tiny_vsnprintf_like(char *buf, const int size, const char *fmt, va_list args
     
     if (*fmt != '%')
     {
+#ifdef TINY_PRINTF
+      /* copy the whole literal run up to the next conversion */
+      char *end = buf + size - 1;
+      do
+      {
+        *str++ = *fmt++;
+      } while ((*fmt != '%') && (*fmt != '\0') && (str < end));
+      fmt--;
+#else
       *str++ = *fmt;
+#endif
       continue;
     }
                   
@@ -554,10 +648,10 @@ repeat:
 #endif
     
     // Get the precision
-    precision = -1;
 #ifdef TINY_PRINTF
     /* Does not support %. */
 #else    
+    precision = -1;
     if (*fmt == '.')
     {
       ++fmt;    
@@ -591,10 +685,12 @@ repeat:
     {
       case 'c':
 #ifdef TINY_PRINTF
+        /* bounded to the buffer as the numbers */
+        while ((--field_width > 0) && ((str - buf) < (size - 2))) *str++ = ' ';
 #else
         if (!(flags & LEFT))
-#endif
           while (--field_width > 0) *str++ = ' ';
+#endif
         *str++ = (unsigned char) va_arg(args, int);
 #ifdef TINY_PRINTF
 #else
@@ -607,14 +703,21 @@ repeat:
         if (!s) s = "<NULL>";
 #ifdef TINY_PRINTF
         len = strlen(s);
+        /* bounded to the buffer as the numbers */
+        i = (size - 1) - (str - buf);
+        while ((len < field_width--) && (i > 0))
+        {
+          *str++ = ' ';
+          i--;
+        }
+        if (len > i) len = i;
+        memcpy(str, s, len);
+        str += len;
 #else
         len = strnlen(s, precision);
         if (!(flags & LEFT))
-#endif
           while (len < field_width--) *str++ = ' ';
         for (i = 0; i < len; ++i) *str++ = *s++;
-#ifdef TINY_PRINTF
-#else        
         while (len < field_width--) *str++ = ' ';
 #endif
         continue;
@@ -687,7 +790,11 @@ repeat:
     else
       num = va_arg(args, unsigned int);
 
+#ifdef TINY_PRINTF
+    str = ee_number_tiny(str, ((size - 1) - (str - buf)), num, base, field_width, flags);
+#else
     str = ee_number(str, ((size - 1) - (str - buf)), num, base, field_width, precision, flags);
+#endif
   }
 
   *str = '\0';
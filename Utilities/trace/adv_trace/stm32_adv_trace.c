@@ -21,6 +21,7 @@
 #include "stm32_adv_trace.h"
 #include "stdarg.h"
 #include "stdio.h"
+#include "string.h"
 
 /** @addtogroup ADV_TRACE
  * @{
@@ -133,7 +134,9 @@ static UTIL_ADV_TRACE_MEMLOCATION uint8_t ADV_TRACE_Buffer[UTIL_ADV_TRACE_FIFO_S
 #if defined(UTIL_ADV_TRACE_CONDITIONNAL) && defined(UTIL_ADV_TRACE_UNCHUNK_MODE)
 /**
  * @brief temporary buffer used by UTIL_ADV_TRACE_COND_FSend
- * a temporary buffers variable used to evaluate a formatted string size.
+ * the string is formatted once in this buffer to get its size, then copied
+ * into the allocated FIFO space. The buffer is shared by all the callers, it
+ * is only used inside the critical section.
  */
 static uint8_t sztmp[UTIL_ADV_TRACE_TMP_BUF_SIZE];
 #endif
@@ -230,8 +233,13 @@ UTIL_ADV_TRACE_Status_t UTIL_ADV_TRACE_COND_FSend(uint32_t VerboseLevel, uint32_
     ADV_TRACE_Ctx.timestamp_func(buf,&timestamp_size);
   }
 
+  /* a trace from an interrupt or from another task must not overwrite sztmp
+     between the format and the copy into the FIFO */
+  UTIL_ADV_TRACE_ENTER_CRITICAL_SECTION();
+
   va_start( vaArgs, strFormat);
   buff_size =(uint16_t)UTIL_ADV_TRACE_VSNPRINTF((char *)sztmp,UTIL_ADV_TRACE_TMP_BUF_SIZE, strFormat, vaArgs);
+  va_end(vaArgs);
 
   TRACE_Lock();
 
@@ -239,13 +247,11 @@ UTIL_ADV_TRACE_Status_t UTIL_ADV_TRACE_COND_FSend(uint32_t VerboseLevel, uint32_
   if (TRACE_AllocateBufer((buff_size+timestamp_size),&writepos) != -1)
   {
 #if defined(UTIL_ADV_TRACE_OVERRUN)
-    UTIL_ADV_TRACE_ENTER_CRITICAL_SECTION();
     if(ADV_TRACE_Ctx.OverRunStatus == TRACE_OVERRUN_EXECUTED)
     {
       /* clear the over run */
       ADV_TRACE_Ctx.OverRunStatus = TRACE_OVERRUN_NONE;
     }
-    UTIL_ADV_TRACE_EXIT_CRITICAL_SECTION();
 #endif
 
     /* copy the timestamp */
@@ -255,26 +261,25 @@ UTIL_ADV_TRACE_Status_t UTIL_ADV_TRACE_COND_FSend(uint32_t VerboseLevel, uint32_
       writepos = writepos + 1u;
     }
 
-    /* copy the data */
-    (void)UTIL_ADV_TRACE_VSNPRINTF((char *)(&ADV_TRACE_Buffer[writepos]), UTIL_ADV_TRACE_TMP_BUF_SIZE, strFormat, vaArgs);
-    va_end(vaArgs);
+    /* copy the data, already formatted: no second format pass, and no
+       terminating '\0' written past the allocated space */
+    (void)memcpy(&ADV_TRACE_Buffer[writepos], sztmp, buff_size);
 
     TRACE_UnLock();
+    UTIL_ADV_TRACE_EXIT_CRITICAL_SECTION();
 
     return TRACE_Send();
   }
 
-  va_end(vaArgs);
   TRACE_UnLock();
 #if defined(UTIL_ADV_TRACE_OVERRUN)
-  UTIL_ADV_TRACE_ENTER_CRITICAL_SECTION();
   if((ADV_TRACE_Ctx.OverRunStatus == TRACE_OVERRUN_NONE ) && (NULL != ADV_TRACE_Ctx.overrun_func))
   {
     UTIL_ADV_TRACE_DEBUG("UTIL_ADV_TRACE_Send:TRACE_OVERRUN_INDICATION");
     ADV_TRACE_Ctx.OverRunStatus = TRACE_OVERRUN_INDICATION;
   }
-  UTIL_ADV_TRACE_EXIT_CRITICAL_SECTION();
 #endif
+  UTIL_ADV_TRACE_EXIT_CRITICAL_SECTION();
 
   return UTIL_ADV_TRACE_MEM_FULL;
 